@@ -0,0 +1,179 @@
+/**
+ * @file json_stream.h
+ * @brief Incremental, allocation-free SAX JSON parser
+ *
+ * The parser consumes a JSON document in arbitrary chunks (e.g. straight
+ * from an HTTP body sink) and reports every value together with its
+ * JSON Pointer path (RFC 6901), e.g. "/items/0/name". All state lives in
+ * json_stream_t; nothing is allocated and the document is never buffered.
+ * Only the current string/number token is held, so its size is bounded
+ * by JSON_STREAM_MAX_TOKEN.
+ *
+ * json_extract_cb() implements pointer-based field extraction on top of
+ * the callback interface.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum nesting depth of objects/arrays
+#define JSON_STREAM_MAX_DEPTH 16
+
+// Maximum decoded length of a single string/number token
+#define JSON_STREAM_MAX_TOKEN 256
+
+// Maximum length of a JSON Pointer path
+#define JSON_STREAM_MAX_PATH  192
+
+/**
+ * @brief Kind of value/event reported to the callback
+ */
+typedef enum {
+    JSON_TYPE_STRING,
+    JSON_TYPE_NUMBER,
+    JSON_TYPE_TRUE,
+    JSON_TYPE_FALSE,
+    JSON_TYPE_NULL,
+    JSON_TYPE_OBJECT_BEGIN,
+    JSON_TYPE_OBJECT_END,
+    JSON_TYPE_ARRAY_BEGIN,
+    JSON_TYPE_ARRAY_END,
+} json_type_t;
+
+/**
+ * @brief Value callback
+ *
+ * @param ctx: User context
+ * @param path: JSON Pointer of the value ("" for the document root)
+ * @param type: Value type
+ * @param value: Decoded string, or the number/literal text. NUL terminated.
+ * @param len: Length of value (strings may contain embedded NULs)
+ *
+ * @return true to continue, false to abort parsing
+ */
+typedef bool (*json_value_cb_t)(void *ctx, const char *path, json_type_t type,
+                                const char *value, size_t len);
+
+/**
+ * @brief Container level on the parser stack
+ */
+typedef struct {
+    bool is_array;
+    uint16_t path_len;   // Length of the container's own path
+    uint32_t index;      // Current element index (arrays)
+} json_stream_level_t;
+
+/**
+ * @brief Parser state (fixed size, no heap)
+ */
+typedef struct {
+    json_value_cb_t cb;
+    void *ctx;
+
+    uint8_t state;
+    uint8_t depth;
+    bool is_key;          // Current string is an object key
+    bool done;            // Complete top-level value parsed
+    esp_err_t error;
+
+    // Literal (true/false/null) matching
+    const char *literal;
+    uint8_t literal_pos;
+    uint8_t literal_type;
+
+    // \uXXXX decoding
+    uint8_t hex_count;
+    uint32_t hex_code;
+    uint32_t high_surrogate;
+
+    uint16_t tok_len;
+    char tok[JSON_STREAM_MAX_TOKEN + 1];
+
+    uint16_t path_len;
+    char path[JSON_STREAM_MAX_PATH + 1];
+
+    json_stream_level_t stack[JSON_STREAM_MAX_DEPTH];
+
+    size_t offset;        // Bytes consumed so far (error position)
+} json_stream_t;
+
+/**
+ * @brief Reset the parser for a new document
+ *
+ * @param p: Parser state
+ * @param cb: Value callback
+ * @param ctx: User context passed to cb
+ */
+void json_stream_init(json_stream_t *p, json_value_cb_t cb, void *ctx);
+
+/**
+ * @brief Feed the next chunk of the document
+ *
+ * Chunk boundaries may fall anywhere, including inside tokens and
+ * escape sequences.
+ *
+ * @param p: Parser state
+ * @param data: Chunk
+ * @param len: Chunk length
+ *
+ * @return
+ *    - ESP_OK: Chunk consumed
+ *    - ESP_ERR_INVALID_RESPONSE: Syntax error (see p->offset)
+ *    - ESP_ERR_INVALID_SIZE: Depth, token or path limit exceeded
+ *    - ESP_FAIL: Aborted by the callback
+ */
+esp_err_t json_stream_feed(json_stream_t *p, const char *data, size_t len);
+
+/**
+ * @brief Signal end of input
+ *
+ * Flushes a pending top-level number and checks the document is complete.
+ *
+ * @param p: Parser state
+ *
+ * @return
+ *    - ESP_OK: A complete document was parsed
+ *    - ESP_ERR_INVALID_STATE: Input ended mid-document
+ *    - Others: Error reported earlier by json_stream_feed
+ */
+esp_err_t json_stream_finish(json_stream_t *p);
+
+/**
+ * @brief Field requested from json_extract_cb
+ */
+typedef struct {
+    const char *pointer;  // JSON Pointer, e.g. "/origin"
+    char *out;            // Receives the value text (truncated to out_size - 1)
+    size_t out_size;
+    json_type_t type;     // Set when found
+    bool found;
+} json_field_t;
+
+/**
+ * @brief Context for json_extract_cb
+ */
+typedef struct {
+    json_field_t *fields;
+    size_t count;
+    size_t found;
+} json_extract_t;
+
+/**
+ * @brief Callback that copies scalar values matching the requested pointers
+ *
+ * Pass a json_extract_t as ctx to json_stream_init().
+ */
+bool json_extract_cb(void *ctx, const char *path, json_type_t type, const char *value,
+                     size_t len);
+
+#ifdef __cplusplus
+}
+#endif
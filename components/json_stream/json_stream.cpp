@@ -0,0 +1,558 @@
+/**
+ * @file json_stream.cpp
+ * @brief Incremental, allocation-free SAX JSON parser
+ */
+
+#include "json_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Parser states
+ */
+enum {
+    ST_VALUE,         // Expecting a value
+    ST_ARRAY_FIRST,   // After '[': value or ']'
+    ST_KEY_FIRST,     // After '{': key or '}'
+    ST_KEY,           // After ',' in an object: key
+    ST_COLON,         // After a key
+    ST_AFTER_VALUE,   // Expecting ',' / ']' / '}' (or end of document)
+    ST_STRING,
+    ST_STRING_ESC,
+    ST_STRING_HEX,
+    ST_NUMBER,
+    ST_LITERAL,
+    ST_DONE,
+    ST_ERROR,
+};
+
+static bool is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static esp_err_t fail(json_stream_t *p, esp_err_t err) {
+    p->error = err;
+    p->state = ST_ERROR;
+    return err;
+}
+
+void json_stream_init(json_stream_t *p, json_value_cb_t cb, void *ctx) {
+    memset(p, 0, sizeof(*p));
+    p->cb = cb;
+    p->ctx = ctx;
+    p->state = ST_VALUE;
+    p->error = ESP_OK;
+}
+
+// ============================================================================
+// Path handling
+// ============================================================================
+
+static bool path_append(json_stream_t *p, const char *s, size_t len) {
+    if (p->path_len + len > JSON_STREAM_MAX_PATH) {
+        return false;
+    }
+    memcpy(p->path + p->path_len, s, len);
+    p->path_len += len;
+    p->path[p->path_len] = '\0';
+    return true;
+}
+
+/**
+ * @brief Append "/<key>" with RFC 6901 escaping ('~' -> "~0", '/' -> "~1")
+ */
+static bool path_append_key(json_stream_t *p, const char *key, size_t len) {
+    if (!path_append(p, "/", 1)) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        bool ok;
+        if (key[i] == '~') {
+            ok = path_append(p, "~0", 2);
+        } else if (key[i] == '/') {
+            ok = path_append(p, "~1", 2);
+        } else {
+            ok = path_append(p, &key[i], 1);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void path_truncate(json_stream_t *p, uint16_t len) {
+    p->path_len = len;
+    p->path[len] = '\0';
+}
+
+/**
+ * @brief Set the path for a value that is about to start
+ *
+ * Inside arrays the element index is appended; inside objects the path
+ * was already extended when the key completed.
+ */
+static bool begin_value(json_stream_t *p) {
+    if (p->depth == 0) {
+        return true;
+    }
+    json_stream_level_t *top = &p->stack[p->depth - 1];
+    if (!top->is_array) {
+        return true;
+    }
+    char idx[12];
+    int n = snprintf(idx, sizeof(idx), "/%lu", (unsigned long)top->index);
+    path_truncate(p, top->path_len);
+    return path_append(p, idx, n);
+}
+
+// ============================================================================
+// Emitting values
+// ============================================================================
+
+static esp_err_t emit(json_stream_t *p, json_type_t type, const char *value, size_t len) {
+    if (p->cb != NULL && !p->cb(p->ctx, p->path, type, value, len)) {
+        return fail(p, ESP_FAIL);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief A scalar value or a container has been completed
+ */
+static void end_value(json_stream_t *p) {
+    if (p->depth == 0) {
+        p->done = true;
+        p->state = ST_DONE;
+    } else {
+        p->state = ST_AFTER_VALUE;
+    }
+}
+
+static bool valid_number(const char *s, size_t len) {
+    size_t i = 0;
+    if (i < len && s[i] == '-') {
+        i++;
+    }
+    if (i >= len) {
+        return false;
+    }
+    if (s[i] == '0') {
+        i++;
+    } else if (s[i] >= '1' && s[i] <= '9') {
+        while (i < len && s[i] >= '0' && s[i] <= '9') {
+            i++;
+        }
+    } else {
+        return false;
+    }
+    if (i < len && s[i] == '.') {
+        i++;
+        size_t start = i;
+        while (i < len && s[i] >= '0' && s[i] <= '9') {
+            i++;
+        }
+        if (i == start) {
+            return false;
+        }
+    }
+    if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < len && (s[i] == '+' || s[i] == '-')) {
+            i++;
+        }
+        size_t start = i;
+        while (i < len && s[i] >= '0' && s[i] <= '9') {
+            i++;
+        }
+        if (i == start) {
+            return false;
+        }
+    }
+    return i == len;
+}
+
+static esp_err_t finish_number(json_stream_t *p) {
+    p->tok[p->tok_len] = '\0';
+    if (!valid_number(p->tok, p->tok_len)) {
+        return fail(p, ESP_ERR_INVALID_RESPONSE);
+    }
+    esp_err_t err = emit(p, JSON_TYPE_NUMBER, p->tok, p->tok_len);
+    end_value(p);
+    return err;
+}
+
+static esp_err_t finish_string(json_stream_t *p) {
+    p->tok[p->tok_len] = '\0';
+
+    if (p->is_key) {
+        json_stream_level_t *top = &p->stack[p->depth - 1];
+        path_truncate(p, top->path_len);
+        if (!path_append_key(p, p->tok, p->tok_len)) {
+            return fail(p, ESP_ERR_INVALID_SIZE);
+        }
+        p->state = ST_COLON;
+        return ESP_OK;
+    }
+
+    esp_err_t err = emit(p, JSON_TYPE_STRING, p->tok, p->tok_len);
+    end_value(p);
+    return err;
+}
+
+static bool tok_push(json_stream_t *p, char c) {
+    if (p->tok_len >= JSON_STREAM_MAX_TOKEN) {
+        return false;
+    }
+    p->tok[p->tok_len++] = c;
+    return true;
+}
+
+/**
+ * @brief Append a code point to the token as UTF-8
+ */
+static bool tok_push_utf8(json_stream_t *p, uint32_t cp) {
+    if (cp < 0x80) {
+        return tok_push(p, (char)cp);
+    }
+    if (cp < 0x800) {
+        return tok_push(p, (char)(0xC0 | (cp >> 6))) && tok_push(p, (char)(0x80 | (cp & 0x3F)));
+    }
+    if (cp < 0x10000) {
+        return tok_push(p, (char)(0xE0 | (cp >> 12))) &&
+               tok_push(p, (char)(0x80 | ((cp >> 6) & 0x3F))) &&
+               tok_push(p, (char)(0x80 | (cp & 0x3F)));
+    }
+    return tok_push(p, (char)(0xF0 | (cp >> 18))) &&
+           tok_push(p, (char)(0x80 | ((cp >> 12) & 0x3F))) &&
+           tok_push(p, (char)(0x80 | ((cp >> 6) & 0x3F))) &&
+           tok_push(p, (char)(0x80 | (cp & 0x3F)));
+}
+
+// ============================================================================
+// Containers
+// ============================================================================
+
+static esp_err_t open_container(json_stream_t *p, bool is_array) {
+    if (p->depth >= JSON_STREAM_MAX_DEPTH) {
+        return fail(p, ESP_ERR_INVALID_SIZE);
+    }
+    esp_err_t err = emit(p, is_array ? JSON_TYPE_ARRAY_BEGIN : JSON_TYPE_OBJECT_BEGIN, "", 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    json_stream_level_t *lvl = &p->stack[p->depth++];
+    lvl->is_array = is_array;
+    lvl->path_len = p->path_len;
+    lvl->index = 0;
+    p->state = is_array ? ST_ARRAY_FIRST : ST_KEY_FIRST;
+    return ESP_OK;
+}
+
+static esp_err_t close_container(json_stream_t *p, bool is_array) {
+    if (p->depth == 0 || p->stack[p->depth - 1].is_array != is_array) {
+        return fail(p, ESP_ERR_INVALID_RESPONSE);
+    }
+    json_stream_level_t *lvl = &p->stack[--p->depth];
+    path_truncate(p, lvl->path_len);
+
+    esp_err_t err = emit(p, is_array ? JSON_TYPE_ARRAY_END : JSON_TYPE_OBJECT_END, "", 0);
+    end_value(p);
+    return err;
+}
+
+// ============================================================================
+// Character dispatch
+// ============================================================================
+
+/**
+ * @brief Start of a value in ST_VALUE / ST_ARRAY_FIRST
+ */
+static esp_err_t start_value(json_stream_t *p, char c) {
+    if (!begin_value(p)) {
+        return fail(p, ESP_ERR_INVALID_SIZE);
+    }
+
+    switch (c) {
+        case '{':
+            return open_container(p, false);
+        case '[':
+            return open_container(p, true);
+        case '"':
+            p->is_key = false;
+            p->tok_len = 0;
+            p->state = ST_STRING;
+            return ESP_OK;
+        case 't':
+            p->literal = "true";
+            p->literal_type = JSON_TYPE_TRUE;
+            break;
+        case 'f':
+            p->literal = "false";
+            p->literal_type = JSON_TYPE_FALSE;
+            break;
+        case 'n':
+            p->literal = "null";
+            p->literal_type = JSON_TYPE_NULL;
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                p->tok_len = 0;
+                tok_push(p, c);
+                p->state = ST_NUMBER;
+                return ESP_OK;
+            }
+            return fail(p, ESP_ERR_INVALID_RESPONSE);
+    }
+
+    p->literal_pos = 1;
+    p->state = ST_LITERAL;
+    return ESP_OK;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Process one character
+ *
+ * Returns ESP_ERR_NOT_FINISHED when the character terminated a number
+ * and must be processed again in the new state.
+ */
+static esp_err_t step(json_stream_t *p, char c) {
+    switch (p->state) {
+        case ST_VALUE:
+            if (is_ws(c)) {
+                return ESP_OK;
+            }
+            return start_value(p, c);
+
+        case ST_ARRAY_FIRST:
+            if (is_ws(c)) {
+                return ESP_OK;
+            }
+            if (c == ']') {
+                return close_container(p, true);
+            }
+            return start_value(p, c);
+
+        case ST_KEY_FIRST:
+        case ST_KEY:
+            if (is_ws(c)) {
+                return ESP_OK;
+            }
+            if (c == '}' && p->state == ST_KEY_FIRST) {
+                return close_container(p, false);
+            }
+            if (c != '"') {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            p->is_key = true;
+            p->tok_len = 0;
+            p->state = ST_STRING;
+            return ESP_OK;
+
+        case ST_COLON:
+            if (is_ws(c)) {
+                return ESP_OK;
+            }
+            if (c != ':') {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            p->state = ST_VALUE;
+            return ESP_OK;
+
+        case ST_AFTER_VALUE: {
+            if (is_ws(c)) {
+                return ESP_OK;
+            }
+            json_stream_level_t *top = &p->stack[p->depth - 1];
+            if (c == ',') {
+                if (top->is_array) {
+                    top->index++;
+                    p->state = ST_VALUE;
+                } else {
+                    p->state = ST_KEY;
+                }
+                return ESP_OK;
+            }
+            if (c == ']' || c == '}') {
+                return close_container(p, c == ']');
+            }
+            return fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+
+        case ST_STRING:
+            if (p->high_surrogate != 0 && c != '\\') {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);  // Unpaired surrogate
+            }
+            if (c == '"') {
+                return finish_string(p);
+            }
+            if (c == '\\') {
+                p->state = ST_STRING_ESC;
+                return ESP_OK;
+            }
+            if ((uint8_t)c < 0x20) {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            return tok_push(p, c) ? ESP_OK : fail(p, ESP_ERR_INVALID_SIZE);
+
+        case ST_STRING_ESC: {
+            if (p->high_surrogate != 0 && c != 'u') {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            char out;
+            switch (c) {
+                case '"':  out = '"'; break;
+                case '\\': out = '\\'; break;
+                case '/':  out = '/'; break;
+                case 'b':  out = '\b'; break;
+                case 'f':  out = '\f'; break;
+                case 'n':  out = '\n'; break;
+                case 'r':  out = '\r'; break;
+                case 't':  out = '\t'; break;
+                case 'u':
+                    p->hex_count = 0;
+                    p->hex_code = 0;
+                    p->state = ST_STRING_HEX;
+                    return ESP_OK;
+                default:
+                    return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            p->state = ST_STRING;
+            return tok_push(p, out) ? ESP_OK : fail(p, ESP_ERR_INVALID_SIZE);
+        }
+
+        case ST_STRING_HEX: {
+            int v = hex_value(c);
+            if (v < 0) {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            p->hex_code = (p->hex_code << 4) | v;
+            if (++p->hex_count < 4) {
+                return ESP_OK;
+            }
+
+            p->state = ST_STRING;
+            uint32_t cp = p->hex_code;
+            if (p->high_surrogate != 0) {
+                if (cp < 0xDC00 || cp > 0xDFFF) {
+                    return fail(p, ESP_ERR_INVALID_RESPONSE);
+                }
+                cp = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+                p->high_surrogate = 0;
+            } else if (cp >= 0xD800 && cp <= 0xDBFF) {
+                p->high_surrogate = cp;
+                return ESP_OK;
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            return tok_push_utf8(p, cp) ? ESP_OK : fail(p, ESP_ERR_INVALID_SIZE);
+        }
+
+        case ST_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' ||
+                c == '-') {
+                return tok_push(p, c) ? ESP_OK : fail(p, ESP_ERR_INVALID_SIZE);
+            }
+            {
+                esp_err_t err = finish_number(p);
+                return (err == ESP_OK) ? ESP_ERR_NOT_FINISHED : err;
+            }
+
+        case ST_LITERAL:
+            if (c != p->literal[p->literal_pos]) {
+                return fail(p, ESP_ERR_INVALID_RESPONSE);
+            }
+            if (p->literal[++p->literal_pos] == '\0') {
+                esp_err_t err =
+                    emit(p, (json_type_t)p->literal_type, p->literal, p->literal_pos);
+                end_value(p);
+                return err;
+            }
+            return ESP_OK;
+
+        case ST_DONE:
+            // Only trailing whitespace is allowed after the document
+            return is_ws(c) ? ESP_OK : fail(p, ESP_ERR_INVALID_RESPONSE);
+
+        default:
+            return p->error;
+    }
+}
+
+esp_err_t json_stream_feed(json_stream_t *p, const char *data, size_t len) {
+    if (p->state == ST_ERROR) {
+        return p->error;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        esp_err_t err = step(p, data[i]);
+        if (err == ESP_ERR_NOT_FINISHED) {
+            err = step(p, data[i]);
+        }
+        if (err != ESP_OK) {
+            p->offset += i;
+            return err;
+        }
+    }
+
+    p->offset += len;
+    return ESP_OK;
+}
+
+esp_err_t json_stream_finish(json_stream_t *p) {
+    if (p->state == ST_ERROR) {
+        return p->error;
+    }
+    if (p->state == ST_NUMBER && p->depth == 0) {
+        esp_err_t err = finish_number(p);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return p->done ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+// ============================================================================
+// Field extraction
+// ============================================================================
+
+bool json_extract_cb(void *ctx, const char *path, json_type_t type, const char *value,
+                     size_t len) {
+    json_extract_t *ex = (json_extract_t *)ctx;
+
+    if (type == JSON_TYPE_OBJECT_BEGIN || type == JSON_TYPE_OBJECT_END ||
+        type == JSON_TYPE_ARRAY_BEGIN || type == JSON_TYPE_ARRAY_END) {
+        return true;
+    }
+
+    for (size_t i = 0; i < ex->count; i++) {
+        json_field_t *f = &ex->fields[i];
+        if (f->found || strcmp(f->pointer, path) != 0) {
+            continue;
+        }
+        if (f->out != NULL && f->out_size > 0) {
+            size_t n = (len < f->out_size - 1) ? len : f->out_size - 1;
+            memcpy(f->out, value, n);
+            f->out[n] = '\0';
+        }
+        f->type = type;
+        f->found = true;
+        ex->found++;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file sd_service.h
+ * @brief Shared SD card service: refcounted mount, hot plug, fast remount
+ *
+ * esp_vfs_fat_sdmmc_mount() / esp_vfs_fat_sdcard_unmount() power the card
+ * up and identify it on every mount (CMD0, CMD8, ACMD41, CID/CSD, bus
+ * width and clock switch: 100 ms and more), and each caller created and
+ * deleted the on-chip LDO around it.
+ *
+ * The service creates the LDO and the SDMMC host once. The card is
+ * identified once and kept initialized while it stays in the slot:
+ *
+ * - ABSENT: no card (or not probed yet)
+ * - IDLE: card initialized, file system not mounted, bus clock lowered.
+ *   Only the clock changes: the card stays selected (transfer state) and
+ *   answers the presence poll. It may be removed
+ * - MOUNTED: FAT mounted at mount_point, held by one or more users
+ * - REMOVED: the card went away while mounted; the file system stays
+ *   registered (open files fail) until the last user releases it
+ *
+ * sd_service_acquire() mounts on the first reference. From IDLE it only
+ * checks that the same card is still there (CMD13), restores the clock
+ * and mounts the FAT; sd_service_release() of the last reference goes
+ * back to IDLE. Card presence comes from a card-detect GPIO if the slot
+ * has one, otherwise from polling (CMD13 while a card is known, an
+ * identification attempt while none is).
+ *
+ * All functions are thread safe. Events are delivered on the service
+ * task.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "sdmmc_cmd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Service state
+ */
+typedef enum {
+    SD_SERVICE_ABSENT,
+    SD_SERVICE_IDLE,
+    SD_SERVICE_MOUNTED,
+    SD_SERVICE_REMOVED,
+} sd_service_state_t;
+
+/**
+ * @brief Hot plug event
+ */
+typedef enum {
+    SD_SERVICE_EVENT_INSERTED,   // A card was found and initialized (now IDLE)
+    SD_SERVICE_EVENT_REMOVED,    // The card went away; users should release it
+} sd_service_event_t;
+
+typedef void (*sd_service_event_cb_t)(sd_service_event_t event, void *arg);
+
+/**
+ * @brief Service configuration
+ */
+typedef struct {
+    const char *mount_point;     // VFS path of the FAT volume
+    int ldo_chan;                // On-chip LDO powering the slot, -1: none
+    uint32_t max_freq_khz;       // Bus clock
+    uint32_t idle_freq_khz;      // Bus clock while IDLE, 0: unchanged
+    int max_files;               // Open files at a time
+    gpio_num_t cd_gpio;          // Card-detect input, GPIO_NUM_NC: poll
+    bool cd_active_low;          // Card present when cd_gpio reads 0
+    uint32_t poll_ms;            // Presence poll without a CD GPIO, 0: off
+    sd_service_event_cb_t on_event;   // Can be NULL
+    void *event_arg;
+    uint32_t stack_size;
+    int task_priority;
+} sd_service_config_t;
+
+#define SD_SERVICE_CONFIG_DEFAULT() {       \
+    .mount_point = "/sdcard",               \
+    .ldo_chan = 4,                          \
+    .max_freq_khz = SDMMC_FREQ_HIGHSPEED,   \
+    .idle_freq_khz = SDMMC_FREQ_PROBING,    \
+    .max_files = 5,                         \
+    .cd_gpio = GPIO_NUM_NC,                 \
+    .cd_active_low = true,                  \
+    .poll_ms = 1000,                        \
+    .on_event = NULL,                       \
+    .event_arg = NULL,                      \
+    .stack_size = 4096,                     \
+    .task_priority = 3,                     \
+}
+
+/**
+ * @brief Service state and mount timing
+ */
+typedef struct {
+    sd_service_state_t state;
+    uint32_t refs;               // Users holding the mount
+    uint32_t card_inits;         // Power-up and identification runs
+    uint32_t mounts;             // File system mounts
+    uint32_t fast_mounts;        // Mounts from IDLE, without identification
+    uint32_t insertions;
+    uint32_t removals;
+    uint32_t last_init_us;       // Last identification
+    uint32_t last_mount_us;      // Last mount, identification included if any
+    bool last_mount_fast;
+    uint32_t max_cold_mount_us;  // Slowest mount that identified the card
+    uint32_t max_fast_mount_us;  // Slowest mount from IDLE
+} sd_service_stats_t;
+
+/**
+ * @brief Create the LDO, the SDMMC host and the service task
+ *
+ * Does not touch the card; the first acquire or presence check does.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_STATE: Already initialized
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - Others: LDO, host or GPIO setup failed
+ */
+esp_err_t sd_service_init(const sd_service_config_t *config);
+
+/**
+ * @brief Take a reference to the mounted card, mounting it if needed
+ *
+ * Blocks for the mount (a few ms from IDLE, 100 ms and more otherwise).
+ *
+ * @param card: Receives the card, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Mounted
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NOT_FOUND: No card, or the card was removed and is still held
+ *    - Others: Identification or FAT mount failed
+ */
+esp_err_t sd_service_acquire(sdmmc_card_t **card);
+
+/**
+ * @brief Drop a reference; the last one unmounts the file system
+ *
+ * The card stays initialized (IDLE) if it is still there.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_STATE: No reference held
+ */
+esp_err_t sd_service_release(void);
+
+/**
+ * @brief Check card presence now instead of at the next poll
+ *
+ * @return true if a card is initialized (IDLE or MOUNTED)
+ */
+bool sd_service_check(void);
+
+/**
+ * @brief Get the state and timing
+ */
+void sd_service_get_stats(sd_service_stats_t *out);
+
+/**
+ * @brief Short name of a state
+ */
+const char *sd_service_state_name(sd_service_state_t state);
+
+/**
+ * @brief Unmount regardless of references, power down and free everything
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ */
+esp_err_t sd_service_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
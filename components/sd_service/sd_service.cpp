@@ -0,0 +1,447 @@
+/**
+ * @file sd_service.cpp
+ * @brief Shared SD card service: refcounted mount, hot plug, fast remount
+ *
+ * Does what esp_vfs_fat_sdmmc_mount() does, split in two: card
+ * identification (sdmmc_card_init) and the FAT mount (diskio driver, VFS
+ * registration, f_mount). Only the second part is undone on release.
+ */
+
+#include "sd_service.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_fat.h"
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
+#include "driver/sdmmc_host.h"
+#include "sd_pwr_ctrl_by_on_chip_ldo.h"
+
+static const char *TAG = "sd_service";
+
+#define CD_DEBOUNCE_MS  50
+#define NO_DRIVE        0xFF
+
+static sd_service_config_t config = {};
+static sd_service_stats_t stats = {};
+static SemaphoreHandle_t lock = NULL;
+static TaskHandle_t task = NULL;
+static volatile bool stopping = false;
+static sdmmc_host_t host;
+static bool host_ready = false;
+static sd_pwr_ctrl_handle_t ldo = NULL;
+static sdmmc_card_t *card = NULL;
+static FATFS *fs = NULL;
+static BYTE pdrv = NO_DRIVE;
+static char drive[4];
+
+static const char *state_names[] = {"absent", "idle", "mounted", "removed"};
+
+// ============================================================================
+// Card and file system
+// ============================================================================
+
+static bool cd_present(void) {
+    if (config.cd_gpio == GPIO_NUM_NC) {
+        return true;
+    }
+    return (gpio_get_level(config.cd_gpio) == 0) == config.cd_active_low;
+}
+
+static void set_clock(uint32_t khz) {
+    if (khz && host.set_card_clk) {
+        host.set_card_clk(host.slot, khz);
+    }
+}
+
+static uint32_t bus_khz(void) {
+    return (uint32_t)card->max_freq_khz < config.max_freq_khz ? (uint32_t)card->max_freq_khz
+                                                               : config.max_freq_khz;
+}
+
+/**
+ * @brief Power-up and identification; leaves the bus at full clock
+ */
+static esp_err_t card_init(void) {
+    memset(card, 0, sizeof(*card));
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = sdmmc_card_init(&host, card);
+    if (err == ESP_OK) {
+        stats.last_init_us = (uint32_t)(esp_timer_get_time() - t0);
+        stats.card_inits++;
+    }
+    return err;
+}
+
+static esp_err_t fs_mount(void) {
+    BYTE pd = NO_DRIVE;
+    if (ff_diskio_get_drive(&pd) != ESP_OK || pd == NO_DRIVE) {
+        ESP_LOGE(TAG, "No free FatFs drive");
+        return ESP_ERR_NO_MEM;
+    }
+    ff_diskio_register_sdmmc(pd, card);
+    snprintf(drive, sizeof(drive), "%u:", (unsigned)pd);
+
+    esp_err_t err = esp_vfs_fat_register(config.mount_point, drive, config.max_files, &fs);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "VFS registration failed: %s", esp_err_to_name(err));
+        ff_diskio_unregister(pd);
+        return err;
+    }
+    FRESULT fr = f_mount(fs, drive, 1);
+    if (fr != FR_OK) {
+        ESP_LOGE(TAG, "f_mount failed: %d", fr);
+        esp_vfs_fat_unregister_path(config.mount_point);
+        ff_diskio_unregister(pd);
+        fs = NULL;
+        return ESP_FAIL;
+    }
+    pdrv = pd;
+    return ESP_OK;
+}
+
+static void fs_unmount(void) {
+    if (pdrv == NO_DRIVE) {
+        return;
+    }
+    f_mount(NULL, drive, 0);
+    esp_vfs_fat_unregister_path(config.mount_point);
+    ff_diskio_unregister(pdrv);
+    pdrv = NO_DRIVE;
+    fs = NULL;
+}
+
+// Only the clock: deselecting the card (CMD7) has no public sdmmc API
+static void enter_idle(void) {
+    stats.state = SD_SERVICE_IDLE;
+    set_clock(config.idle_freq_khz);
+}
+
+/**
+ * @brief Presence check; returns the event to report, or -1
+ */
+static int check_locked(void) {
+    switch (stats.state) {
+        case SD_SERVICE_IDLE:
+        case SD_SERVICE_MOUNTED:
+            // CMD13 also catches a card swapped for another one
+            if (cd_present() && sdmmc_get_status(card) == ESP_OK) {
+                return -1;
+            }
+            ESP_LOGW(TAG, "Card removed");
+            stats.removals++;
+            stats.state = (stats.state == SD_SERVICE_MOUNTED) ? SD_SERVICE_REMOVED
+                                                              : SD_SERVICE_ABSENT;
+            return SD_SERVICE_EVENT_REMOVED;
+
+        case SD_SERVICE_ABSENT:
+            if (!cd_present() || card_init() != ESP_OK) {
+                return -1;
+            }
+            ESP_LOGI(TAG, "Card inserted: %s, identified in %lu ms", card->cid.name,
+                     (unsigned long)(stats.last_init_us / 1000));
+            stats.insertions++;
+            enter_idle();
+            return SD_SERVICE_EVENT_INSERTED;
+
+        case SD_SERVICE_REMOVED:
+            break;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Service task
+// ============================================================================
+
+static void IRAM_ATTR cd_isr(void *arg) {
+    BaseType_t woken = pdFALSE;
+    if (task) {
+        vTaskNotifyGiveFromISR(task, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+static void service_task(void *arg) {
+    bool has_cd = (config.cd_gpio != GPIO_NUM_NC);
+    TickType_t wait = has_cd ? portMAX_DELAY : pdMS_TO_TICKS(config.poll_ms);
+
+    // The first check comes after one period, so a caller that acquires
+    // right after init is not raced by an INSERTED event for the same card
+    while (!stopping) {
+        bool edge = ulTaskNotifyTake(pdTRUE, wait) > 0;
+        if (stopping) {
+            break;
+        }
+        if (edge && has_cd) {
+            // Let the contacts settle, drop the bounces
+            vTaskDelay(pdMS_TO_TICKS(CD_DEBOUNCE_MS));
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        int event = check_locked();
+        xSemaphoreGive(lock);
+        if (event >= 0 && config.on_event) {
+            config.on_event((sd_service_event_t)event, config.event_arg);
+        }
+    }
+
+    task = NULL;
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_service_init(const sd_service_config_t *cfg) {
+    if (lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!cfg || !cfg->mount_point) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config = *cfg;
+    memset(&stats, 0, sizeof(stats));
+    stopping = false;
+
+    card = (sdmmc_card_t *)calloc(1, sizeof(sdmmc_card_t));
+    lock = xSemaphoreCreateMutex();
+    if (!card || !lock) {
+        sd_service_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The LDO and the host live as long as the service
+    host = SDMMC_HOST_DEFAULT();
+    host.slot = SDMMC_HOST_SLOT_0;
+    host.max_freq_khz = config.max_freq_khz;
+    esp_err_t err = ESP_OK;
+    if (config.ldo_chan >= 0) {
+        sd_pwr_ctrl_ldo_config_t ldo_config = {
+            .ldo_chan_id = config.ldo_chan,
+        };
+        err = sd_pwr_ctrl_new_on_chip_ldo(&ldo_config, &ldo);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create LDO power control: %s", esp_err_to_name(err));
+            sd_service_deinit();
+            return err;
+        }
+        host.pwr_ctrl_handle = ldo;
+    }
+
+    err = sdmmc_host_init();
+    if (err == ESP_OK) {
+        const sdmmc_slot_config_t slot_config = {
+            .cd = SDMMC_SLOT_NO_CD,
+            .wp = SDMMC_SLOT_NO_WP,
+            .width = 4,
+            .flags = 0,
+        };
+        host_ready = true;
+        err = sdmmc_host_init_slot(host.slot, &slot_config);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SDMMC host init failed: %s", esp_err_to_name(err));
+        sd_service_deinit();
+        return err;
+    }
+
+    if (config.cd_gpio != GPIO_NUM_NC) {
+        gpio_config_t io = {};
+        io.pin_bit_mask = 1ULL << config.cd_gpio;
+        io.mode = GPIO_MODE_INPUT;
+        io.pull_up_en = config.cd_active_low ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+        io.intr_type = GPIO_INTR_ANYEDGE;
+        err = gpio_config(&io);
+        if (err == ESP_OK) {
+            esp_err_t isr_err = gpio_install_isr_service(0);
+            err = (isr_err == ESP_ERR_INVALID_STATE) ? ESP_OK : isr_err;  // Already installed
+        }
+        if (err == ESP_OK) {
+            err = gpio_isr_handler_add(config.cd_gpio, cd_isr, NULL);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Card-detect GPIO %d setup failed", config.cd_gpio);
+            config.cd_gpio = GPIO_NUM_NC;
+            sd_service_deinit();
+            return err;
+        }
+    }
+
+    if ((config.cd_gpio != GPIO_NUM_NC || config.poll_ms) &&
+        xTaskCreate(service_task, "sd_service", config.stack_size, NULL, config.task_priority,
+                    &task) != pdPASS) {
+        sd_service_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Ready, %s", config.cd_gpio != GPIO_NUM_NC ? "card detect on GPIO"
+                               : config.poll_ms ? "polling for the card" : "no hot plug");
+    return ESP_OK;
+}
+
+esp_err_t sd_service_acquire(sdmmc_card_t **out) {
+    if (!lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    esp_err_t err = ESP_OK;
+    int64_t t0 = esp_timer_get_time();
+    bool fast = false;
+    switch (stats.state) {
+        case SD_SERVICE_MOUNTED:
+            stats.refs++;
+            break;
+
+        case SD_SERVICE_REMOVED:
+            err = ESP_ERR_NOT_FOUND;
+            break;
+
+        case SD_SERVICE_IDLE:
+            // Same card still there: skip identification
+            if (cd_present() && sdmmc_get_status(card) == ESP_OK) {
+                set_clock(bus_khz());
+                fast = true;
+            } else {
+                ESP_LOGW(TAG, "Card changed while idle, identifying");
+                stats.removals++;
+                stats.state = SD_SERVICE_ABSENT;
+            }
+            break;
+
+        case SD_SERVICE_ABSENT:
+            break;
+    }
+
+    if (err == ESP_OK && stats.state == SD_SERVICE_ABSENT) {
+        err = cd_present() ? card_init() : ESP_ERR_NOT_FOUND;
+        if (err == ESP_OK) {
+            stats.state = SD_SERVICE_IDLE;
+        } else if (err == ESP_ERR_TIMEOUT) {
+            err = ESP_ERR_NOT_FOUND;  // Nothing answered
+        }
+    }
+
+    if (err == ESP_OK && stats.state == SD_SERVICE_IDLE) {
+        err = fs_mount();
+        if (err == ESP_OK) {
+            stats.state = SD_SERVICE_MOUNTED;
+            stats.refs = 1;
+            stats.mounts++;
+            stats.last_mount_us = (uint32_t)(esp_timer_get_time() - t0);
+            stats.last_mount_fast = fast;
+            uint32_t *max = fast ? &stats.max_fast_mount_us : &stats.max_cold_mount_us;
+            if (stats.last_mount_us > *max) {
+                *max = stats.last_mount_us;
+            }
+            stats.fast_mounts += fast;
+            ESP_LOGI(TAG, "Mounted %s in %lu us (%s)", config.mount_point,
+                     (unsigned long)stats.last_mount_us, fast ? "from idle" : "card identified");
+        } else {
+            enter_idle();
+        }
+    }
+
+    if (out) {
+        *out = (err == ESP_OK) ? card : NULL;
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+esp_err_t sd_service_release(void) {
+    if (!lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (stats.refs == 0) {
+        err = ESP_ERR_INVALID_STATE;
+    } else if (--stats.refs == 0) {
+        fs_unmount();
+        if (stats.state == SD_SERVICE_MOUNTED) {
+            enter_idle();
+        } else {
+            stats.state = SD_SERVICE_ABSENT;
+        }
+        ESP_LOGI(TAG, "Unmounted %s, card %s", config.mount_point,
+                 state_names[stats.state]);
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+bool sd_service_check(void) {
+    if (!lock) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int event = check_locked();
+    bool ready = (stats.state == SD_SERVICE_IDLE || stats.state == SD_SERVICE_MOUNTED);
+    xSemaphoreGive(lock);
+    if (event >= 0 && config.on_event) {
+        config.on_event((sd_service_event_t)event, config.event_arg);
+    }
+    return ready;
+}
+
+void sd_service_get_stats(sd_service_stats_t *out) {
+    if (!lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(lock);
+}
+
+const char *sd_service_state_name(sd_service_state_t state) {
+    return (unsigned)state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state]
+                                                                          : "?";
+}
+
+esp_err_t sd_service_deinit(void) {
+    if (!lock && !card) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (task) {
+        stopping = true;
+        xTaskNotifyGive(task);
+        while (task) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+    }
+    if (config.cd_gpio != GPIO_NUM_NC) {
+        gpio_isr_handler_remove(config.cd_gpio);
+    }
+
+    fs_unmount();
+    if (host_ready) {
+        sdmmc_host_deinit();
+        host_ready = false;
+    }
+    if (ldo) {
+        sd_pwr_ctrl_del_on_chip_ldo(ldo);
+        ldo = NULL;
+    }
+    free(card);
+    card = NULL;
+    if (lock) {
+        vSemaphoreDelete(lock);
+        lock = NULL;
+    }
+    memset(&host, 0, sizeof(host));
+    memset(&stats, 0, sizeof(stats));
+    return ESP_OK;
+}
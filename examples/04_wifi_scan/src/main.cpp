@@ -5,7 +5,9 @@
  * This example demonstrates:
  * - WiFi scanning via ESP-HOSTED (C6 co-processor)
  * - Displaying scanned networks on the LCD
- * - Periodic network scan refresh
+ * - Periodic network scan refresh using an adaptive channel scheduler
+ *   (see scan_scheduler.h): only recently active channels are rescanned
+ *   at full dwell, full sweeps run periodically or on button press
  *
  * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
  * WiFi: Via ESP32-C6 co-processor using ESP-HOSTED
@@ -20,10 +22,13 @@
 #include "esp_event.h"
 #include "nvs_flash.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
 
 // ESP-HOSTED for WiFi via C6 co-processor
 #include "esp_hosted.h"
 
+#include "scan_scheduler.h"
+
 // BSP includes
 #include "bsp/esp-bsp.h"
 #include "bsp/display.h"
@@ -42,11 +47,16 @@ static lv_obj_t *status_label = NULL;
 static lv_obj_t *network_list = NULL;
 static lv_obj_t *scan_btn = NULL;
 
-// Scan results storage
+// Scan results storage (snapshot of the scheduler's aged AP table)
 #define MAX_SCAN_RESULTS 20
-static wifi_ap_record_t ap_records[MAX_SCAN_RESULTS];
+static scan_ap_entry_t ap_records[MAX_SCAN_RESULTS];
 static uint16_t ap_count = 0;
 
+// Interval between scheduled background scan cycles
+#define SCAN_REFRESH_MS 10000
+
+static lv_obj_t *stats_label = NULL;
+
 /**
  * @brief WiFi event handler
  */
@@ -98,76 +108,56 @@ static esp_err_t wifi_init_sta(void) {
     // Start WiFi
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    ESP_ERROR_CHECK(scan_scheduler_init());
+
     ESP_LOGI(TAG, "WiFi initialized in station mode");
     return ESP_OK;
 }
 
 /**
  * @brief Perform WiFi scan
+ *
+ * @param force_full: Sweep all channels instead of the scheduled subset
  */
-static esp_err_t wifi_scan(void) {
+static esp_err_t wifi_scan(bool force_full) {
     ESP_LOGI(TAG, "Starting WiFi scan...");
 
     // Update UI status
     if (status_label) {
         bsp_display_lock(0);
-        lv_label_set_text(status_label, "Scanning...");
+        lv_label_set_text(status_label, force_full ? "Scanning all channels..." : "Scanning...");
         bsp_display_unlock();
     }
 
-    // Configure scan
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,
-        .show_hidden = true,
-        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
-        .scan_time = {
-            .active = {
-                .min = 100,
-                .max = 300,
-            },
-        },
-    };
-
-    // Clear previous results
-    ap_count = 0;
-    memset(ap_records, 0, sizeof(ap_records));
-
-    // Start BLOCKING scan (required for ESP-HOSTED)
-    // The blocking parameter must be true for ESP-HOSTED WiFi Remote
-    esp_err_t ret = esp_wifi_scan_start(&scan_config, true);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi scan start failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    // Get number of APs found (must call this first with ESP-HOSTED)
-    uint16_t num_aps = 0;
-    ret = esp_wifi_scan_get_ap_num(&num_aps);
+    scan_cycle_stats_t cycle = {};
+    esp_err_t ret = scan_scheduler_run(force_full, &cycle);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get AP count: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(ret));
         return ret;
     }
-    ESP_LOGI(TAG, "Scan found %d APs", num_aps);
-
-    // Limit to our buffer size
-    ap_count = (num_aps > MAX_SCAN_RESULTS) ? MAX_SCAN_RESULTS : num_aps;
 
-    // Get scan records
-    ret = esp_wifi_scan_get_ap_records(&ap_count, ap_records);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get scan results: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    // Debug: print first few SSIDs
-    for (int i = 0; i < ap_count && i < 5; i++) {
-        ESP_LOGI(TAG, "  [%d] SSID: %s, RSSI: %d, CH: %d",
-                 i, (char*)ap_records[i].ssid, ap_records[i].rssi, ap_records[i].primary);
+    // Compare scheduled cycles against full sweeps
+    scan_scheduler_stats_t st;
+    scan_scheduler_get_stats(&st);
+    uint32_t full_ms = st.full_cycles ? (uint32_t)(st.full_time_ms / st.full_cycles) : 0;
+    uint32_t part_ms = st.partial_cycles ? (uint32_t)(st.partial_time_ms / st.partial_cycles) : 0;
+    uint32_t full_b = st.full_cycles ? (uint32_t)(st.full_bus_bytes / st.full_cycles) : 0;
+    uint32_t part_b = st.partial_cycles ? (uint32_t)(st.partial_bus_bytes / st.partial_cycles) : 0;
+    ESP_LOGI(TAG, "Avg full sweep: %lu ms / %lu B, avg partial: %lu ms / %lu B",
+             (unsigned long)full_ms, (unsigned long)full_b,
+             (unsigned long)part_ms, (unsigned long)part_b);
+
+    if (stats_label) {
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(stats_label,
+                              "Last: %s %lu ms | Full avg %lu ms %lu B | Partial avg %lu ms %lu B",
+                              cycle.full_sweep ? "full" : "partial",
+                              (unsigned long)cycle.duration_ms, (unsigned long)full_ms,
+                              (unsigned long)full_b, (unsigned long)part_ms,
+                              (unsigned long)part_b);
+        bsp_display_unlock();
     }
 
-    ESP_LOGI(TAG, "Found %d networks", ap_count);
     return ESP_OK;
 }
 
@@ -179,6 +169,10 @@ static void update_network_list(void) {
 
     bsp_display_lock(0);
 
+    // Snapshot the aged AP table (strongest first)
+    ap_count = scan_scheduler_get_aps(ap_records, MAX_SCAN_RESULTS);
+    ESP_LOGI(TAG, "Found %d networks", ap_count);
+
     // Clear existing items
     lv_obj_clean(network_list);
 
@@ -197,7 +191,7 @@ static void update_network_list(void) {
 
             // SSID label
             lv_obj_t *ssid_label = lv_label_create(item);
-            lv_label_set_text_fmt(ssid_label, "%s", (char*)ap_records[i].ssid);
+            lv_label_set_text_fmt(ssid_label, "%s", ap_records[i].ssid);
             lv_obj_set_style_text_color(ssid_label, lv_color_white(), 0);
             lv_obj_align(ssid_label, LV_ALIGN_TOP_LEFT, 5, 2);
 
@@ -214,10 +208,12 @@ static void update_network_list(void) {
             }
 
             lv_obj_t *info_label = lv_label_create(item);
-            lv_label_set_text_fmt(info_label, "RSSI: %d dBm | %s | CH %d",
+            int64_t age_s = (esp_timer_get_time() - ap_records[i].last_seen_us) / 1000000;
+            lv_label_set_text_fmt(info_label, "RSSI: %d dBm | %s | CH %d | %llds ago",
                                   ap_records[i].rssi,
                                   security,
-                                  ap_records[i].primary);
+                                  ap_records[i].channel,
+                                  (long long)age_s);
             lv_obj_set_style_text_color(info_label, lv_color_hex(0x88CCFF), 0);
             lv_obj_set_style_text_font(info_label, &lv_font_montserrat_14, 0);
             lv_obj_align(info_label, LV_ALIGN_BOTTOM_LEFT, 5, -2);
@@ -239,8 +235,8 @@ static void scan_btn_click_cb(lv_event_t *e) {
     // Disable button during scan
     lv_obj_add_state(scan_btn, LV_STATE_DISABLED);
 
-    // Perform scan
-    if (wifi_scan() == ESP_OK) {
+    // Manual scan always sweeps all channels
+    if (wifi_scan(true) == ESP_OK) {
         update_network_list();
     } else {
         bsp_display_lock(0);
@@ -274,6 +270,15 @@ static void create_ui(void) {
     lv_obj_set_style_text_color(status_label, lv_color_hex(0x88CCFF), 0);
     lv_obj_align(status_label, LV_ALIGN_TOP_MID, 0, 50);
 
+    // Scheduler statistics label
+    stats_label = lv_label_create(scr);
+    lv_label_set_text(stats_label, "");
+    lv_obj_set_width(stats_label, LV_PCT(95));
+    lv_label_set_long_mode(stats_label, LV_LABEL_LONG_WRAP);
+    lv_obj_set_style_text_color(stats_label, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_text_font(stats_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(stats_label, LV_ALIGN_TOP_MID, 0, 140);
+
     // Scan button
     scan_btn = lv_btn_create(scr);
     lv_obj_set_size(scan_btn, 150, 50);
@@ -286,7 +291,7 @@ static void create_ui(void) {
 
     // Network list container
     network_list = lv_obj_create(scr);
-    lv_obj_set_size(network_list, LV_PCT(95), 550);
+    lv_obj_set_size(network_list, LV_PCT(95), 500);
     lv_obj_align(network_list, LV_ALIGN_BOTTOM_MID, 0, -20);
     lv_obj_set_style_bg_color(network_list, lv_color_hex(0x16213e), 0);
     lv_obj_set_style_border_width(network_list, 0, 0);
@@ -377,18 +382,22 @@ extern "C" void app_main(void) {
 
         // Do initial scan
         vTaskDelay(pdMS_TO_TICKS(1000));  // Give WiFi time to stabilize
-        if (wifi_scan() == ESP_OK) {
+        if (wifi_scan(true) == ESP_OK) {
             update_network_list();
         }
     }
+    bool wifi_ready = (ret == ESP_OK);
 
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, "  WiFi Scanner ready!");
     ESP_LOGI(TAG, "========================================");
 
-    // Main loop
+    // Main loop: scheduled (mostly partial) scan refresh
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        vTaskDelay(pdMS_TO_TICKS(SCAN_REFRESH_MS));
+        if (wifi_ready && wifi_scan(false) == ESP_OK) {
+            update_network_list();
+        }
         ESP_LOGI(TAG, "Free heap: %lu bytes", (unsigned long)esp_get_free_heap_size());
     }
 }
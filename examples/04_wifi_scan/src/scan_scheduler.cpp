@@ -0,0 +1,329 @@
+/**
+ * @file scan_scheduler.cpp
+ * @brief Adaptive channel-aware WiFi scan scheduler
+ */
+
+#include "scan_scheduler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "scan_sched";
+
+// Dwell times (ms) for active scans
+#define DWELL_FULL_MIN       100
+#define DWELL_FULL_MAX       300
+#define DWELL_PROBE_MIN      20
+#define DWELL_PROBE_BASE     40
+#define DWELL_PROBE_PER_AP   20
+
+// Records fetched when scanning a single channel. A full sweep fetches
+// every record, so that no channel looks idle because others filled the cap
+#define MAX_RECORDS_PER_SCAN 20
+
+// Rough per-call overhead of an ESP-HOSTED RPC (request + response framing)
+#define RPC_OVERHEAD_BYTES   64
+
+/**
+ * @brief Occupancy history for one channel
+ */
+typedef struct {
+    int64_t last_active_us;   // Last time this channel returned an AP
+    int64_t last_scanned_us;
+    float ap_ewma;            // Smoothed AP count
+} channel_history_t;
+
+static channel_history_t channels[SCAN_NUM_CHANNELS];
+static scan_ap_entry_t ap_table[SCAN_AP_TABLE_SIZE];
+static int ap_table_count = 0;
+
+static uint32_t cycle_count = 0;
+static uint8_t idle_cursor = 0;
+static scan_scheduler_stats_t stats = {};
+
+static SemaphoreHandle_t sched_mutex = NULL;
+
+// Scratch buffer for single-channel results (kept static to stay off the
+// task stack); full sweeps with more records allocate theirs
+static wifi_ap_record_t scan_records[MAX_RECORDS_PER_SCAN];
+
+esp_err_t scan_scheduler_init(void) {
+    if (sched_mutex == NULL) {
+        sched_mutex = xSemaphoreCreateMutex();
+        if (sched_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    memset(channels, 0, sizeof(channels));
+    memset(ap_table, 0, sizeof(ap_table));
+    ap_table_count = 0;
+    cycle_count = 0;
+    idle_cursor = 0;
+    memset(&stats, 0, sizeof(stats));
+    return ESP_OK;
+}
+
+/**
+ * @brief Insert or refresh an AP in the table
+ *
+ * When the table is full the oldest entry is replaced.
+ */
+static void ap_table_merge(const wifi_ap_record_t *rec, int64_t now_us) {
+    int slot = -1;
+    int oldest = 0;
+
+    for (int i = 0; i < ap_table_count; i++) {
+        if (memcmp(ap_table[i].bssid, rec->bssid, sizeof(rec->bssid)) == 0) {
+            slot = i;
+            break;
+        }
+        if (ap_table[i].last_seen_us < ap_table[oldest].last_seen_us) {
+            oldest = i;
+        }
+    }
+
+    if (slot < 0) {
+        slot = (ap_table_count < SCAN_AP_TABLE_SIZE) ? ap_table_count++ : oldest;
+    }
+
+    scan_ap_entry_t *e = &ap_table[slot];
+    memcpy(e->bssid, rec->bssid, sizeof(e->bssid));
+    strncpy(e->ssid, (const char *)rec->ssid, sizeof(e->ssid) - 1);
+    e->ssid[sizeof(e->ssid) - 1] = '\0';
+    e->channel = rec->primary;
+    e->rssi = rec->rssi;
+    e->authmode = rec->authmode;
+    e->last_seen_us = now_us;
+}
+
+/**
+ * @brief Drop entries older than SCAN_AP_MAX_AGE_MS
+ */
+static void ap_table_expire(int64_t now_us) {
+    int w = 0;
+    for (int r = 0; r < ap_table_count; r++) {
+        if (now_us - ap_table[r].last_seen_us <= (int64_t)SCAN_AP_MAX_AGE_MS * 1000) {
+            if (w != r) {
+                ap_table[w] = ap_table[r];
+            }
+            w++;
+        }
+    }
+    ap_table_count = w;
+}
+
+/**
+ * @brief Issue one blocking scan and merge its results
+ *
+ * @param channel: Channel to scan, 0 for all channels
+ * @param dwell_min: Minimum active dwell per channel (ms)
+ * @param dwell_max: Maximum active dwell per channel (ms)
+ * @param cs: Cycle statistics to update
+ */
+static esp_err_t scan_once(uint8_t channel, uint32_t dwell_min, uint32_t dwell_max,
+                           scan_cycle_stats_t *cs) {
+    wifi_scan_config_t scan_config = {};
+    scan_config.channel = channel;
+    scan_config.show_hidden = true;
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = dwell_min;
+    scan_config.scan_time.active.max = dwell_max;
+
+    // Blocking scan is required for ESP-HOSTED WiFi Remote
+    esp_err_t ret = esp_wifi_scan_start(&scan_config, true);
+    cs->rpc_calls++;
+    cs->bus_bytes += RPC_OVERHEAD_BYTES + sizeof(scan_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Scan on channel %d failed: %s", channel, esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint16_t num_aps = 0;
+    ret = esp_wifi_scan_get_ap_num(&num_aps);
+    cs->rpc_calls++;
+    cs->bus_bytes += RPC_OVERHEAD_BYTES;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint16_t count = num_aps;
+    if (channel != 0 && count > MAX_RECORDS_PER_SCAN) {
+        count = MAX_RECORDS_PER_SCAN;
+    }
+    wifi_ap_record_t *records = scan_records;
+    if (count > MAX_RECORDS_PER_SCAN) {
+        records = (wifi_ap_record_t *)malloc(count * sizeof(wifi_ap_record_t));
+        if (records == NULL) {
+            ESP_LOGW(TAG, "No memory for %u records, keeping %d", (unsigned)num_aps,
+                     MAX_RECORDS_PER_SCAN);
+            records = scan_records;
+            count = MAX_RECORDS_PER_SCAN;
+        }
+    }
+    // Frees the driver's list, including records not fetched
+    ret = esp_wifi_scan_get_ap_records(&count, records);
+    cs->rpc_calls++;
+    cs->bus_bytes += RPC_OVERHEAD_BYTES + count * sizeof(wifi_ap_record_t);
+    if (ret != ESP_OK) {
+        if (records != scan_records) {
+            free(records);
+        }
+        return ret;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint8_t per_channel[SCAN_NUM_CHANNELS] = {};
+
+    for (int i = 0; i < count; i++) {
+        ap_table_merge(&records[i], now);
+        uint8_t ch = records[i].primary;
+        if (ch >= 1 && ch <= SCAN_NUM_CHANNELS) {
+            per_channel[ch - 1]++;
+        }
+    }
+    cs->records_fetched += count;
+    if (records != scan_records) {
+        free(records);
+    }
+
+    // Update occupancy history for every channel covered by this scan
+    for (int ch = 1; ch <= SCAN_NUM_CHANNELS; ch++) {
+        if (channel != 0 && ch != channel) {
+            continue;
+        }
+        channel_history_t *h = &channels[ch - 1];
+        h->last_scanned_us = now;
+        h->ap_ewma = 0.7f * h->ap_ewma + 0.3f * per_channel[ch - 1];
+        if (per_channel[ch - 1] > 0) {
+            h->last_active_us = now;
+        }
+    }
+
+    cs->channels_scanned += (channel == 0) ? SCAN_NUM_CHANNELS : 1;
+    return ESP_OK;
+}
+
+/**
+ * @brief Dwell time for a probe, scaled by the channel's AP history
+ */
+static uint32_t probe_dwell_ms(const channel_history_t *h) {
+    uint32_t dwell = DWELL_PROBE_BASE + (uint32_t)(h->ap_ewma * DWELL_PROBE_PER_AP);
+    return (dwell > DWELL_FULL_MAX) ? DWELL_FULL_MAX : dwell;
+}
+
+static bool channel_is_active(const channel_history_t *h, int64_t now_us) {
+    return h->last_active_us != 0 &&
+           (now_us - h->last_active_us) <= (int64_t)SCAN_ACTIVE_WINDOW_MS * 1000;
+}
+
+/**
+ * @brief Scan active channels at full dwell and rotate through idle ones
+ */
+static esp_err_t run_partial(scan_cycle_stats_t *cs) {
+    int64_t now = esp_timer_get_time();
+    bool active[SCAN_NUM_CHANNELS];
+    esp_err_t ret = ESP_OK;
+
+    for (int i = 0; i < SCAN_NUM_CHANNELS; i++) {
+        active[i] = channel_is_active(&channels[i], now);
+    }
+
+    for (int i = 0; i < SCAN_NUM_CHANNELS && ret == ESP_OK; i++) {
+        if (active[i]) {
+            ret = scan_once(i + 1, DWELL_FULL_MIN, DWELL_FULL_MAX, cs);
+        }
+    }
+
+    int probed = 0;
+    for (int n = 0; n < SCAN_NUM_CHANNELS && probed < SCAN_IDLE_PROBES && ret == ESP_OK; n++) {
+        int i = idle_cursor;
+        idle_cursor = (idle_cursor + 1) % SCAN_NUM_CHANNELS;
+        if (active[i]) {
+            continue;
+        }
+        uint32_t dwell = probe_dwell_ms(&channels[i]);
+        ret = scan_once(i + 1, DWELL_PROBE_MIN, dwell, cs);
+        probed++;
+    }
+
+    return ret;
+}
+
+esp_err_t scan_scheduler_run(bool force_full, scan_cycle_stats_t *out_stats) {
+    if (sched_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(sched_mutex, portMAX_DELAY);
+
+    scan_cycle_stats_t cs = {};
+    cs.full_sweep = force_full || ap_table_count == 0 ||
+                    (cycle_count % SCAN_FULL_SWEEP_INTERVAL) == 0;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret;
+    if (cs.full_sweep) {
+        ret = scan_once(0, DWELL_FULL_MIN, DWELL_FULL_MAX, &cs);
+    } else {
+        ret = run_partial(&cs);
+    }
+    cs.duration_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    ap_table_expire(esp_timer_get_time());
+    cycle_count++;
+
+    if (cs.full_sweep) {
+        stats.full_cycles++;
+        stats.full_time_ms += cs.duration_ms;
+        stats.full_bus_bytes += cs.bus_bytes;
+    } else {
+        stats.partial_cycles++;
+        stats.partial_time_ms += cs.duration_ms;
+        stats.partial_bus_bytes += cs.bus_bytes;
+    }
+
+    ESP_LOGI(TAG, "%s cycle: %d ch, %d records, %d RPCs, ~%lu bus bytes, %lu ms, %d APs tracked",
+             cs.full_sweep ? "Full" : "Partial", cs.channels_scanned, cs.records_fetched,
+             cs.rpc_calls, (unsigned long)cs.bus_bytes, (unsigned long)cs.duration_ms,
+             ap_table_count);
+
+    xSemaphoreGive(sched_mutex);
+
+    if (out_stats) {
+        *out_stats = cs;
+    }
+    return ret;
+}
+
+static int compare_rssi(const void *a, const void *b) {
+    return ((const scan_ap_entry_t *)b)->rssi - ((const scan_ap_entry_t *)a)->rssi;
+}
+
+int scan_scheduler_get_aps(scan_ap_entry_t *out, int max_entries) {
+    if (sched_mutex == NULL || out == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(sched_mutex, portMAX_DELAY);
+    int count = (ap_table_count < max_entries) ? ap_table_count : max_entries;
+    qsort(ap_table, ap_table_count, sizeof(scan_ap_entry_t), compare_rssi);
+    memcpy(out, ap_table, count * sizeof(scan_ap_entry_t));
+    xSemaphoreGive(sched_mutex);
+
+    return count;
+}
+
+void scan_scheduler_get_stats(scan_scheduler_stats_t *out) {
+    if (sched_mutex == NULL || out == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(sched_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(sched_mutex);
+}
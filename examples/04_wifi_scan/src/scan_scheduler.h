@@ -0,0 +1,125 @@
+/**
+ * @file scan_scheduler.h
+ * @brief Adaptive channel-aware WiFi scan scheduler
+ *
+ * Instead of sweeping all channels on every refresh, the scheduler keeps a
+ * per-channel occupancy history and:
+ * - scans recently active channels with full dwell time
+ * - probes the remaining channels in rotation with a dwell time scaled
+ *   to the number of APs previously seen there
+ * - falls back to a full sweep (channel = 0) only periodically
+ *
+ * Results are merged into a time-aged AP table keyed by BSSID.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 2.4 GHz channels handled by the scheduler
+#define SCAN_NUM_CHANNELS        13
+
+// Capacity of the merged AP table
+#define SCAN_AP_TABLE_SIZE       32
+
+// Run a full sweep every N cycles (cycle 0 is always a full sweep)
+#define SCAN_FULL_SWEEP_INTERVAL 6
+
+// Idle channels probed per partial cycle
+#define SCAN_IDLE_PROBES         2
+
+// A channel is "active" if it returned an AP within this window
+#define SCAN_ACTIVE_WINDOW_MS    30000
+
+// APs not seen for this long are dropped from the table
+#define SCAN_AP_MAX_AGE_MS       60000
+
+/**
+ * @brief One entry of the merged AP table
+ */
+typedef struct {
+    uint8_t bssid[6];
+    char ssid[33];
+    uint8_t channel;
+    int8_t rssi;
+    wifi_auth_mode_t authmode;
+    int64_t last_seen_us;
+} scan_ap_entry_t;
+
+/**
+ * @brief Statistics for a single scheduler cycle
+ */
+typedef struct {
+    bool full_sweep;
+    uint8_t channels_scanned;
+    uint16_t records_fetched;
+    uint16_t rpc_calls;        // WiFi remote calls issued over ESP-HOSTED
+    uint32_t bus_bytes;        // Estimated SDIO payload for those calls
+    uint32_t duration_ms;
+} scan_cycle_stats_t;
+
+/**
+ * @brief Accumulated statistics, split by cycle type
+ */
+typedef struct {
+    uint32_t full_cycles;
+    uint32_t partial_cycles;
+    uint64_t full_time_ms;
+    uint64_t partial_time_ms;
+    uint64_t full_bus_bytes;
+    uint64_t partial_bus_bytes;
+} scan_scheduler_stats_t;
+
+/**
+ * @brief Initialize the scheduler state
+ *
+ * WiFi must already be started in station mode.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Failed to create the scheduler mutex
+ */
+esp_err_t scan_scheduler_init(void);
+
+/**
+ * @brief Run one scan cycle
+ *
+ * Chooses between a full sweep and a partial (active + rotated idle
+ * channels) scan, executes it and merges results into the AP table.
+ *
+ * @param force_full: Force a full sweep regardless of the schedule
+ * @param out_stats: Statistics for this cycle, can be NULL if not needed
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: Error returned by the WiFi driver
+ */
+esp_err_t scan_scheduler_run(bool force_full, scan_cycle_stats_t *out_stats);
+
+/**
+ * @brief Copy the aged AP table, sorted by RSSI (strongest first)
+ *
+ * @param out: Destination array
+ * @param max_entries: Capacity of the destination array
+ *
+ * @return Number of entries copied
+ */
+int scan_scheduler_get_aps(scan_ap_entry_t *out, int max_entries);
+
+/**
+ * @brief Get accumulated full vs partial cycle statistics
+ *
+ * @param out: Destination structure
+ */
+void scan_scheduler_get_stats(scan_scheduler_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
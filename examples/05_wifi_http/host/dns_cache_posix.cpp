@@ -0,0 +1,72 @@
+/**
+ * @file dns_cache_posix.cpp
+ * @brief dns_cache.h on Linux: no cache, every lookup is a getaddrinfo()
+ *
+ * Keeps the per-task record of the last lookup, so the pool's trace reads
+ * back the client's own lookup as it does on the target. Single-threaded
+ * callers only (the statistics are not locked).
+ */
+
+#include "dns_cache.h"
+
+#include <string.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "esp_timer.h"
+
+static thread_local dns_cache_info_t task_last;
+static thread_local bool task_last_valid;
+static dns_cache_stats_t stats = {};
+
+esp_err_t dns_cache_init(bool persist) {
+    (void)persist;
+    return ESP_OK;
+}
+
+esp_err_t dns_cache_resolve(const char *host, uint32_t *addr, dns_cache_info_t *info) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    int64_t start = esp_timer_get_time();
+    int ret = getaddrinfo(host, NULL, &hints, &res);
+
+    dns_cache_info_t local = {};
+    local.lookup_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    stats.lookups++;
+    stats.misses++;
+    task_last = local;
+    task_last_valid = true;
+    if (info != NULL) {
+        *info = local;
+    }
+    if (ret != 0 || res == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    return ESP_OK;
+}
+
+esp_err_t dns_cache_peek(const char *host, uint32_t *addr) {
+    (void)host;
+    (void)addr;
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool dns_cache_take_last(dns_cache_info_t *out) {
+    bool valid = task_last_valid;
+    if (out != NULL) {
+        *out = valid ? task_last : dns_cache_info_t{};
+    }
+    task_last_valid = false;
+    return valid;
+}
+
+void dns_cache_flush(void) {
+}
+
+void dns_cache_get_stats(dns_cache_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file esp_http_client.h
+ * @brief The part of esp_http_client used by the pool, on Linux sockets
+ *
+ * Plain http:// only, HTTP/1.1 with keep-alive, Content-Length and chunked
+ * bodies. Names and semantics follow ESP-IDF so the pool builds unchanged:
+ * esp_http_client_open() reuses the open connection if there is one, and
+ * the host name is resolved through dns_cache_resolve() the way lwIP's
+ * resolve hook does on the target.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum {
+    HTTP_METHOD_GET = 0,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD,
+} esp_http_client_method_t;
+
+typedef enum {
+    HTTP_EVENT_ERROR = 0,
+    HTTP_EVENT_ON_CONNECTED,
+    HTTP_EVENT_HEADERS_SENT,
+    HTTP_EVENT_ON_HEADER,
+    HTTP_EVENT_ON_DATA,
+    HTTP_EVENT_ON_FINISH,
+    HTTP_EVENT_DISCONNECTED,
+    HTTP_EVENT_REDIRECT,
+} esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event {
+    esp_http_client_event_id_t event_id;
+    esp_http_client_handle_t client;
+    void *data;
+    int data_len;
+    void *user_data;
+    char *header_key;
+    char *header_value;
+} esp_http_client_event_t;
+
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef struct {
+    const char *url;
+    esp_http_client_method_t method;
+    int timeout_ms;
+    http_event_handle_cb event_handler;
+    void *user_data;
+    int buffer_size;
+    bool keep_alive_enable;
+    esp_err_t (*crt_bundle_attach)(void *conf);  // Ignored
+    bool save_client_session;                    // Ignored
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url);
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client,
+                                     esp_http_client_method_t method);
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key,
+                                     const char *value);
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key);
+
+/**
+ * @brief Connect if not connected, then send the request line and headers
+ */
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+
+/**
+ * @brief Read the response headers
+ *
+ * @return Content-Length, 0 for chunked or unknown, -1 on error
+ */
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client);
+
+/**
+ * @brief Read body bytes (chunked encoding removed)
+ *
+ * @return Bytes read, 0 at the end of the body, -1 on error
+ */
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client);
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len);
+
+/**
+ * @brief Point the client at the Location of the last response
+ */
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,500 @@
+/**
+ * @file esp_http_client_posix.cpp
+ * @brief The part of esp_http_client used by the pool, on Linux sockets
+ */
+
+#include "esp_http_client.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "dns_cache.h"
+
+#define URL_LEN      512
+#define HOST_LEN     256
+#define MAX_HEADERS  16
+#define KEY_LEN      64
+#define VALUE_LEN    256
+#define LINE_LEN     1024
+#define RX_BUF_SIZE  4096
+
+typedef struct {
+    char key[KEY_LEN];
+    char value[VALUE_LEN];
+} header_t;
+
+struct esp_http_client {
+    esp_http_client_config_t config;
+    char url[URL_LEN];
+    esp_http_client_method_t method;
+    header_t headers[MAX_HEADERS];
+    int header_count;
+
+    // Connection
+    int fd;
+    char conn_host[HOST_LEN];
+    int conn_port;
+
+    // Response
+    int status;
+    int64_t content_length;
+    bool chunked;
+    bool close_after;        // Connection: close, or no keep-alive
+    bool until_close;        // No length: the body ends with the connection
+    bool body_done;
+    int64_t remaining;       // Of the body, or of the current chunk
+    char location[URL_LEN];
+
+    uint8_t rx[RX_BUF_SIZE];
+    size_t rx_pos;
+    size_t rx_len;
+};
+
+static const char *const method_names[] = {"GET", "POST", "PUT", "PATCH", "DELETE", "HEAD"};
+
+static void fire(esp_http_client_handle_t c, esp_http_client_event_id_t id, char *key,
+                 char *value) {
+    if (c->config.event_handler == NULL) {
+        return;
+    }
+    esp_http_client_event_t evt = {};
+    evt.event_id = id;
+    evt.client = c;
+    evt.user_data = c->config.user_data;
+    evt.header_key = key;
+    evt.header_value = value;
+    c->config.event_handler(&evt);
+}
+
+/**
+ * @brief Split http://host[:port][/path]
+ */
+static bool parse_url(const char *url, char *host, int *port, const char **path) {
+    if (strncmp(url, "http://", 7) != 0) {
+        return false;
+    }
+    const char *h = url + 7;
+    size_t n = strcspn(h, ":/?#");
+    if (n == 0 || n >= HOST_LEN) {
+        return false;
+    }
+    memcpy(host, h, n);
+    host[n] = '\0';
+    *port = 80;
+    if (h[n] == ':') {
+        *port = atoi(h + n + 1);
+    }
+    *path = strchr(h + n, '/');
+    if (*path == NULL) {
+        *path = "/";
+    }
+    return true;
+}
+
+static void conn_close(esp_http_client_handle_t c) {
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+        fire(c, HTTP_EVENT_DISCONNECTED, NULL, NULL);
+    }
+    c->rx_pos = c->rx_len = 0;
+}
+
+static void set_timeouts(int fd, int timeout_ms) {
+    struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static esp_err_t conn_open(esp_http_client_handle_t c, const char *host, int port) {
+    // On the target the name goes through the cache via lwIP's resolve hook
+    uint32_t addr = 0;
+    if (dns_cache_resolve(host, &addr, NULL) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    set_timeouts(fd, c->config.timeout_ms);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = addr;
+    if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        close(fd);
+        return ESP_FAIL;
+    }
+
+    c->fd = fd;
+    snprintf(c->conn_host, sizeof(c->conn_host), "%s", host);
+    c->conn_port = port;
+    c->rx_pos = c->rx_len = 0;
+    fire(c, HTTP_EVENT_ON_CONNECTED, NULL, NULL);
+    return ESP_OK;
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Refill the receive buffer
+ *
+ * @return Bytes available, 0 if the peer closed, -1 on error
+ */
+static int rx_fill(esp_http_client_handle_t c) {
+    if (c->rx_pos < c->rx_len) {
+        return (int)(c->rx_len - c->rx_pos);
+    }
+    ssize_t n = recv(c->fd, c->rx, sizeof(c->rx), 0);
+    if (n < 0) {
+        return -1;
+    }
+    c->rx_pos = 0;
+    c->rx_len = n;
+    return (int)n;
+}
+
+/**
+ * @brief Read one CRLF (or LF) terminated line
+ */
+static bool read_line(esp_http_client_handle_t c, char *line, size_t len) {
+    size_t n = 0;
+    for (;;) {
+        if (rx_fill(c) <= 0) {
+            return false;
+        }
+        char ch = (char)c->rx[c->rx_pos++];
+        if (ch == '\n') {
+            break;
+        }
+        if (n + 1 < len) {
+            line[n++] = ch;
+        }
+    }
+    if (n > 0 && line[n - 1] == '\r') {
+        n--;
+    }
+    line[n] = '\0';
+    return true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    esp_http_client_handle_t c = (esp_http_client_handle_t)calloc(1, sizeof(*c));
+    if (c == NULL) {
+        return NULL;
+    }
+    c->config = *config;
+    if (c->config.timeout_ms <= 0) {
+        c->config.timeout_ms = 5000;
+    }
+    c->fd = -1;
+    c->method = config->method;
+    snprintf(c->url, sizeof(c->url), "%s", config->url);
+    return c;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c) {
+    conn_close(c);
+    free(c);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t c, const char *url) {
+    snprintf(c->url, sizeof(c->url), "%s", url);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t c,
+                                     esp_http_client_method_t method) {
+    c->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t c, int timeout_ms) {
+    c->config.timeout_ms = timeout_ms;
+    if (c->fd >= 0) {
+        set_timeouts(c->fd, timeout_ms);  // Also for an open connection
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key,
+                                     const char *value) {
+    header_t *h = NULL;
+    for (int i = 0; i < c->header_count; i++) {
+        if (strcasecmp(c->headers[i].key, key) == 0) {
+            h = &c->headers[i];
+        }
+    }
+    if (h == NULL) {
+        if (c->header_count == MAX_HEADERS) {
+            return ESP_ERR_NO_MEM;
+        }
+        h = &c->headers[c->header_count++];
+    }
+    snprintf(h->key, sizeof(h->key), "%s", key);
+    snprintf(h->value, sizeof(h->value), "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t c, const char *key) {
+    for (int i = 0; i < c->header_count; i++) {
+        if (strcasecmp(c->headers[i].key, key) == 0) {
+            c->headers[i] = c->headers[--c->header_count];
+            return ESP_OK;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len) {
+    (void)write_len;  // Requests have no body here
+    char host[HOST_LEN];
+    int port = 0;
+    const char *path = NULL;
+    if (!parse_url(c->url, host, &port, &path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Keep the connection if it goes to the same server
+    if (c->fd >= 0 && (c->conn_port != port || strcmp(c->conn_host, host) != 0)) {
+        conn_close(c);
+    }
+    if (c->fd < 0) {
+        esp_err_t err = conn_open(c, host, port);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    char req[LINE_LEN * 4];
+    int n = snprintf(req, sizeof(req), "%s %s HTTP/1.1\r\nHost: %s:%d\r\n"
+                     "User-Agent: ESP32 HTTP Client/1.0\r\n%s",
+                     method_names[c->method], path, host, port,
+                     c->config.keep_alive_enable ? "" : "Connection: close\r\n");
+    for (int i = 0; i < c->header_count && n < (int)sizeof(req); i++) {
+        n += snprintf(req + n, sizeof(req) - n, "%s: %s\r\n", c->headers[i].key,
+                      c->headers[i].value);
+    }
+    if (n + 2 >= (int)sizeof(req)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    n += snprintf(req + n, sizeof(req) - n, "\r\n");
+    if (!send_all(c->fd, req, n)) {
+        conn_close(c);
+        return ESP_FAIL;
+    }
+
+    c->status = 0;
+    c->content_length = 0;
+    c->chunked = false;
+    c->until_close = false;
+    c->close_after = !c->config.keep_alive_enable;
+    c->body_done = false;
+    c->remaining = 0;
+    c->location[0] = '\0';
+    fire(c, HTTP_EVENT_HEADERS_SENT, NULL, NULL);
+    return ESP_OK;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c) {
+    char line[LINE_LEN];
+    if (c->fd < 0 || !read_line(c, line, sizeof(line))) {
+        conn_close(c);
+        return -1;
+    }
+    int minor = 0;
+    if (sscanf(line, "HTTP/1.%d %d", &minor, &c->status) != 2) {
+        conn_close(c);
+        return -1;
+    }
+    c->close_after |= (minor == 0);
+
+    bool has_length = false;
+    for (;;) {
+        if (!read_line(c, line, sizeof(line))) {
+            conn_close(c);
+            return -1;
+        }
+        if (line[0] == '\0') {
+            break;
+        }
+        char *colon = strchr(line, ':');
+        if (colon == NULL) {
+            continue;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ') {
+            value++;
+        }
+        if (strcasecmp(line, "Content-Length") == 0) {
+            c->content_length = strtoll(value, NULL, 10);
+            has_length = true;
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0 &&
+                   strcasecmp(value, "chunked") == 0) {
+            c->chunked = true;
+        } else if (strcasecmp(line, "Connection") == 0 && strcasecmp(value, "close") == 0) {
+            c->close_after = true;
+        } else if (strcasecmp(line, "Location") == 0) {
+            snprintf(c->location, sizeof(c->location), "%s", value);
+        }
+        fire(c, HTTP_EVENT_ON_HEADER, line, value);
+    }
+
+    bool no_body = c->method == HTTP_METHOD_HEAD || c->status == 204 || c->status == 304 ||
+                   (c->status >= 100 && c->status < 200);
+    if (no_body) {
+        c->content_length = 0;
+        c->body_done = true;
+    } else if (c->chunked) {
+        c->content_length = 0;
+        c->remaining = -1;  // Chunk size line next
+    } else if (has_length) {
+        c->remaining = c->content_length;
+        c->body_done = c->remaining == 0;
+    } else {
+        c->until_close = true;
+        c->close_after = true;
+    }
+    if (c->body_done && c->close_after) {
+        conn_close(c);
+    }
+    return c->content_length;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c) {
+    return c->status;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t c) {
+    return c->chunked;
+}
+
+int esp_http_client_read(esp_http_client_handle_t c, char *buffer, int len) {
+    int total = 0;
+    while (total < len && !c->body_done) {
+        if (c->chunked && c->remaining <= 0) {
+            char line[LINE_LEN];
+            if (c->remaining == 0 && !read_line(c, line, sizeof(line))) {
+                return -1;  // CRLF after the chunk data
+            }
+            if (!read_line(c, line, sizeof(line))) {
+                return -1;
+            }
+            c->remaining = strtoll(line, NULL, 16);
+            if (c->remaining == 0) {
+                // Trailers up to the blank line
+                while (read_line(c, line, sizeof(line)) && line[0] != '\0') {
+                }
+                c->body_done = true;
+                break;
+            }
+        }
+
+        int avail = rx_fill(c);
+        if (avail < 0) {
+            return -1;
+        }
+        if (avail == 0) {
+            if (c->until_close) {
+                c->body_done = true;
+                break;
+            }
+            return total > 0 ? total : -1;  // Closed mid-body
+        }
+        int64_t n = len - total;
+        if (n > avail) {
+            n = avail;
+        }
+        if (!c->until_close && n > c->remaining) {
+            n = c->remaining;
+        }
+        memcpy(buffer + total, c->rx + c->rx_pos, n);
+        c->rx_pos += n;
+        total += n;
+        if (!c->until_close) {
+            c->remaining -= n;
+            if (!c->chunked && c->remaining == 0) {
+                c->body_done = true;
+            }
+        }
+        // Return what a single receive gave, like the target client
+        if (c->rx_pos == c->rx_len) {
+            break;
+        }
+    }
+    if (c->body_done && c->close_after) {
+        conn_close(c);
+    }
+    return total;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t c) {
+    return c->body_done;
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t c, int *len) {
+    char buf[512];
+    int total = 0;
+    int n;
+    while ((n = esp_http_client_read(c, buf, sizeof(buf))) > 0) {
+        total += n;
+    }
+    if (len != NULL) {
+        *len = total;
+    }
+    return n < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t c) {
+    if (c->location[0] == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (c->location[0] != '/') {
+        return esp_http_client_set_url(c, c->location);
+    }
+    // Relative: same server
+    char host[HOST_LEN];
+    int port = 0;
+    const char *path = NULL;
+    if (!parse_url(c->url, host, &port, &path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char url[URL_LEN];
+    int n = snprintf(url, sizeof(url), "http://%s:%d%s", host, port, c->location);
+    if (n < 0 || n >= (int)sizeof(url)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return esp_http_client_set_url(c, url);
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c) {
+    conn_close(c);
+    return ESP_OK;
+}
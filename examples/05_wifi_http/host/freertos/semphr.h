@@ -0,0 +1,35 @@
+/**
+ * @file semphr.h
+ * @brief FreeRTOS mutexes on pthreads for building the HTTP modules on Linux
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    pthread_mutex_t *m = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+    if (m) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+// Only portMAX_DELAY is supported
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t ticks) {
+    (void)ticks;
+    return pthread_mutex_lock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m) {
+    return pthread_mutex_unlock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t m) {
+    pthread_mutex_destroy(m);
+    free(m);
+}
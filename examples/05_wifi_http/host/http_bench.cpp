@@ -0,0 +1,1166 @@
+/**
+ * @file http_bench.cpp
+ * @brief Linux bench for the HTTP modules of the WiFi HTTP example
+ *
+ * Pool mode runs src/http_pool.cpp against local HTTP/1.1 servers on
+ * loopback, with host/esp_http_client_posix.cpp standing in for
+ * esp_http_client (plain http:// only, so no TLS session handling). It
+ * checks that follow-up requests reuse the open connection (one accept per
+ * server), that chunked bodies and redirects stay on it, that the least
+ * recently used client is evicted when the pool is full, that a
+ * connection the server closed while idle is reopened once, and that each
+ * new connection resolves the host exactly once.
+ *
+ * Cache mode runs src/http_cache.cpp in front of the pool against a local
+ * server that honours If-None-Match and If-Modified-Since, with a temp
+ * directory as the SD tier. A stale entry must come back as a 304 and be
+ * served from the cache, a max-age entry must be served without a request
+ * until it expires, no-store must never be cached, and the hit counters
+ * and bytes saved must add up. Entries pushed out of PSRAM come back from
+ * the SD tier, and the cache can be cleared from inside a sink while the
+ * body is still being delivered.
+ *
+ * JSON mode times json_stream.cpp against jsoncpp, the DOM parser at
+ * hand on Linux (cJSON on the target), and reports the heap each one
+ * holds. It then feeds a document with escapes, surrogate pairs and
+ * numbers split at every byte offset, and one byte at a time, and checks
+ * the events match a single-chunk parse, and that truncated and malformed
+ * input is rejected.
+ *
+ * Inflate mode decodes zlib's gzip, zlib and raw deflate output (levels 0,
+ * 1, 6 and 9) with src/http_inflate.cpp and compares the bytes, times it
+ * against zlib's inflate() and compares the heap each one holds. Every
+ * prefix of a stream must fail as truncated, and a stream with one bit
+ * flipped must be accepted or rejected exactly as zlib does.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -I../../components/json_stream/include \
+ *       $(pkg-config --cflags jsoncpp) -o http_bench host/http_bench.cpp \
+ *       host/dns_cache_posix.cpp host/esp_http_client_posix.cpp \
+ *       src/http_pool.cpp src/http_trace.cpp src/http_inflate.cpp \
+ *       src/http_cache.cpp ../../components/json_stream/json_stream.cpp \
+ *       -lpthread -ljsoncpp -lz
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "dns_cache.h"
+#include "esp_timer.h"
+#include "http_cache.h"
+#include "http_inflate.h"
+#include "http_pool.h"
+#include "json_stream.h"
+#include <json/json.h>
+#include <zlib.h>
+
+int esp_log_verbose = 0;
+
+#define MAX_SERVERS    (HTTP_POOL_SIZE + 1)
+#define MAX_CONNS      8
+#define SMALL_BODY     "Hello from the pool test server\n"
+#define SLOW_MS        500   // /slow answers after this long
+#define CHUNK_PARTS    5
+#define CHUNK_PART     "0123456789abcdef0123456789abcdef\n"
+#define CACHE_BODY     "Cacheable body from the test server, served once per version\n"
+#define LAST_MODIFIED  "Wed, 21 Oct 2015 07:28:00 GMT"
+#define MAX_AGE_S      1     // Cache-Control max-age of /max-age
+#define JSON_ITERATIONS 10
+#define JSON_CHUNK_SIZE 1436  // Roughly one TCP segment, as on the target
+#define CORRUPT_PAYLOAD 8192  // Bytes compressed for the bit flip pass
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "  -m <mode>     pool (default), json, inflate, cache\n"
+            "  -n <KB>       JSON/inflate payload size (default 1024)\n"
+            "  -v            Log module steps (-vv for more)\n",
+            prog);
+}
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                        \
+        }                                                                    \
+    } while (0)
+
+// ============================================================================
+// Test server
+// ============================================================================
+
+typedef struct {
+    int listen_fd;
+    int port;
+    pthread_mutex_t lock;
+    int accepted;
+    int requests;
+    int conns[MAX_CONNS];  // Open connections, -1 = free
+} test_server_t;
+
+typedef struct {
+    test_server_t *server;
+    int fd;
+} conn_arg_t;
+
+// ETag version of the cacheable paths; bumped to change the resource
+static int cache_version = 1;
+
+static bool send_str(int fd, const char *s, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, s, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        s += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Find a request header; false if the request does not carry it
+ */
+static bool request_header(const char *head, const char *name, char *value, size_t size) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(head, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *v = line + name_len + 1;
+            v += strspn(v, " ");
+            size_t n = strcspn(v, "\r\n");
+            if (n >= size) {
+                n = size - 1;
+            }
+            memcpy(value, v, n);
+            value[n] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Answer with CACHE_BODY, or a bodyless 304 if the validator matched
+ */
+static bool send_cacheable(int fd, const char *headers, bool not_modified) {
+    char hdr[256];
+    if (not_modified) {
+        int n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 304 Not Modified\r\n%s\r\n", headers);
+        return send_str(fd, hdr, n);
+    }
+    int n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n%s\r\n",
+                     strlen(CACHE_BODY), headers);
+    return send_str(fd, hdr, n) && send_str(fd, CACHE_BODY, strlen(CACHE_BODY));
+}
+
+/**
+ * @brief Answer one request; false to close the connection
+ *
+ * @param head: Request line and headers, for the conditional requests
+ */
+static bool serve_request(int fd, const char *path, const char *head) {
+    char hdr[256];
+    if (strcmp(path, "/small") == 0 || strcmp(path, "/close") == 0) {
+        bool close_conn = strcmp(path, "/close") == 0;
+        int n = snprintf(hdr, sizeof(hdr),
+                         "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n%s\r\n",
+                         strlen(SMALL_BODY), close_conn ? "Connection: close\r\n" : "");
+        return send_str(fd, hdr, n) && send_str(fd, SMALL_BODY, strlen(SMALL_BODY)) &&
+               !close_conn;
+    }
+    if (strcmp(path, "/chunked") == 0) {
+        const char *head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        bool ok = send_str(fd, head, strlen(head));
+        for (int i = 0; ok && i < CHUNK_PARTS; i++) {
+            int n = snprintf(hdr, sizeof(hdr), "%zx\r\n", strlen(CHUNK_PART));
+            ok = send_str(fd, hdr, n) && send_str(fd, CHUNK_PART, strlen(CHUNK_PART)) &&
+                 send_str(fd, "\r\n", 2);
+        }
+        return ok && send_str(fd, "0\r\n\r\n", 5);
+    }
+    if (strcmp(path, "/slow") == 0) {
+        usleep(SLOW_MS * 1000);
+        return serve_request(fd, "/small", head);
+    }
+    if (strcmp(path, "/etag") == 0 || strcmp(path, "/max-age") == 0 ||
+        strcmp(path, "/no-store") == 0) {
+        char etag[16];
+        char value[64];
+        char cache_control[32] = "no-cache";
+        snprintf(etag, sizeof(etag), "\"v%d\"", cache_version);
+        if (strcmp(path, "/max-age") == 0) {
+            snprintf(cache_control, sizeof(cache_control), "max-age=%d", MAX_AGE_S);
+        } else if (strcmp(path, "/no-store") == 0) {
+            strcpy(cache_control, "no-store");
+        }
+        snprintf(hdr, sizeof(hdr), "ETag: %s\r\nCache-Control: %s\r\n", etag, cache_control);
+        return send_cacheable(fd, hdr, request_header(head, "If-None-Match", value, sizeof(value)) &&
+                                           strcmp(value, etag) == 0);
+    }
+    if (strcmp(path, "/last-modified") == 0) {
+        char value[64];
+        return send_cacheable(fd, "Last-Modified: " LAST_MODIFIED "\r\n",
+                              request_header(head, "If-Modified-Since", value, sizeof(value)) &&
+                                  strcmp(value, LAST_MODIFIED) == 0);
+    }
+    if (strcmp(path, "/redirect") == 0) {
+        const char *r = "HTTP/1.1 302 Found\r\nLocation: /small\r\nContent-Length: 0\r\n\r\n";
+        return send_str(fd, r, strlen(r));
+    }
+    const char *nf = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    return send_str(fd, nf, strlen(nf));
+}
+
+static void *conn_task(void *arg) {
+    conn_arg_t *ca = (conn_arg_t *)arg;
+    test_server_t *s = ca->server;
+    int fd = ca->fd;
+    free(ca);
+
+    char buf[2048];
+    size_t len = 0;
+    for (;;) {
+        ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+        buf[len] = '\0';
+        char *end = strstr(buf, "\r\n\r\n");
+        if (end == NULL) {
+            if (len == sizeof(buf) - 1) {
+                break;
+            }
+            continue;
+        }
+        char path[256] = "";
+        sscanf(buf, "%*s %255s", path);
+        path[strcspn(path, "?")] = '\0';  // The query only makes URLs distinct
+        pthread_mutex_lock(&s->lock);
+        s->requests++;
+        pthread_mutex_unlock(&s->lock);
+        // Requests carry no body: keep what follows the header
+        size_t used = end + 4 - buf;
+        end[2] = '\0';
+        if (!serve_request(fd, path, buf)) {
+            break;
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < MAX_CONNS; i++) {
+        if (s->conns[i] == fd) {
+            s->conns[i] = -1;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    close(fd);
+    return NULL;
+}
+
+static void *accept_task(void *arg) {
+    test_server_t *s = (test_server_t *)arg;
+    for (;;) {
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        pthread_mutex_lock(&s->lock);
+        s->accepted++;
+        for (int i = 0; i < MAX_CONNS; i++) {
+            if (s->conns[i] < 0) {
+                s->conns[i] = fd;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&s->lock);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        conn_arg_t *ca = (conn_arg_t *)malloc(sizeof(conn_arg_t));
+        ca->server = s;
+        ca->fd = fd;
+        pthread_t t;
+        pthread_create(&t, NULL, conn_task, ca);
+        pthread_detach(t);
+    }
+}
+
+static bool server_start(test_server_t *s) {
+    memset(s, 0, sizeof(*s));
+    pthread_mutex_init(&s->lock, NULL);
+    for (int i = 0; i < MAX_CONNS; i++) {
+        s->conns[i] = -1;
+    }
+    s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t sa_len = sizeof(sa);
+    if (s->listen_fd < 0 || bind(s->listen_fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+        listen(s->listen_fd, 8) != 0 ||
+        getsockname(s->listen_fd, (struct sockaddr *)&sa, &sa_len) != 0) {
+        return false;
+    }
+    s->port = ntohs(sa.sin_port);
+    pthread_t t;
+    pthread_create(&t, NULL, accept_task, s);
+    pthread_detach(t);
+    return true;
+}
+
+/**
+ * @brief Close every open connection, as a server does with idle keep-alives
+ */
+static void server_drop(test_server_t *s) {
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < MAX_CONNS; i++) {
+        if (s->conns[i] >= 0) {
+            shutdown(s->conns[i], SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    usleep(20000);  // Let the FIN arrive
+}
+
+static int server_accepted(test_server_t *s) {
+    pthread_mutex_lock(&s->lock);
+    int n = s->accepted;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
+
+static int server_requests(test_server_t *s) {
+    pthread_mutex_lock(&s->lock);
+    int n = s->requests;
+    pthread_mutex_unlock(&s->lock);
+    return n;
+}
+
+// ============================================================================
+// Pool test
+// ============================================================================
+
+typedef struct {
+    char data[512];
+    size_t len;
+} body_t;
+
+static esp_err_t body_data(void *ctx, const uint8_t *data, size_t len) {
+    body_t *b = (body_t *)ctx;
+    if (b->len + len >= sizeof(b->data)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return ESP_OK;
+}
+
+static esp_err_t get_timeout(test_server_t *s, const char *path, int timeout_ms,
+                             body_t *body, http_pool_result_t *res) {
+    char url[128];
+    snprintf(url, sizeof(url), "http://localhost:%d%s", s->port, path);
+    memset(body, 0, sizeof(*body));
+    http_body_sink_t sink = {};
+    sink.on_data = body_data;
+    sink.ctx = body;
+    http_pool_request_t req = {};
+    req.url = url;
+    req.method = HTTP_METHOD_GET;
+    req.sink = &sink;
+    req.timeout_ms = timeout_ms;
+    return http_pool_perform(&req, res);
+}
+
+static esp_err_t get(test_server_t *s, const char *path, body_t *body,
+                     http_pool_result_t *res) {
+    return get_timeout(s, path, 2000, body, res);
+}
+
+static void print_result(const char *name, const http_pool_result_t *r) {
+    printf("%-22s %3d  %-5s %4lu B  dns %lu ms, connect %lu ms, ttfb %lu ms, total %lu ms\n",
+           name, r->status, r->reused ? "warm" : "cold", (unsigned long)r->body_bytes,
+           (unsigned long)r->phases.dns_ms, (unsigned long)r->phases.connect_ms,
+           (unsigned long)r->phases.ttfb_ms, (unsigned long)r->phases.total_ms);
+}
+
+static int pool_test(void) {
+    static test_server_t servers[MAX_SERVERS];
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        CHECK(server_start(&servers[i]));
+    }
+    CHECK(http_pool_init() == ESP_OK);
+
+    body_t body;
+    http_pool_result_t res;
+    http_pool_stats_t ps;
+    dns_cache_stats_t ds;
+    test_server_t *a = &servers[0];
+
+    // Cold, then warm over the same connection
+    CHECK(get(a, "/small", &body, &res) == ESP_OK);
+    print_result("cold", &res);
+    CHECK(res.status == 200 && !res.reused && res.phases.new_connection);
+    CHECK(strcmp(body.data, SMALL_BODY) == 0);
+    CHECK(get(a, "/small", &body, &res) == ESP_OK);
+    print_result("warm", &res);
+    CHECK(res.status == 200 && res.reused && !res.phases.new_connection);
+    CHECK(strcmp(body.data, SMALL_BODY) == 0);
+
+    // Chunked body and a redirect stay on the connection
+    CHECK(get(a, "/chunked", &body, &res) == ESP_OK);
+    print_result("warm, chunked", &res);
+    CHECK(res.reused && res.content_length == -1 && body.len == CHUNK_PARTS * strlen(CHUNK_PART));
+    CHECK(get(a, "/redirect", &body, &res) == ESP_OK);
+    print_result("warm, redirect", &res);
+    CHECK(res.status == 200 && strcmp(body.data, SMALL_BODY) == 0);
+    CHECK(server_accepted(a) == 1);
+
+    // One lookup per new connection, none for warm requests
+    dns_cache_get_stats(&ds);
+    CHECK(ds.lookups == 1);
+
+    // Fill the pool: the next host evicts the least recently used client (a)
+    for (int i = 1; i < MAX_SERVERS; i++) {
+        CHECK(get(&servers[i], "/small", &body, &res) == ESP_OK && !res.reused);
+    }
+    http_pool_get_stats(&ps);
+    printf("%-22s %lu eviction(s), %u open clients\n", "pool full + 1",
+           (unsigned long)ps.evictions, ps.open_clients);
+    CHECK(ps.evictions == 1 && ps.open_clients == HTTP_POOL_SIZE);
+    CHECK(get(a, "/small", &body, &res) == ESP_OK);
+    print_result("evicted host again", &res);
+    CHECK(!res.reused && server_accepted(a) == 2);
+    http_pool_get_stats(&ps);
+    CHECK(ps.evictions == 2);
+
+    // servers[1] was least recently used and is gone; servers[2] is still warm
+    CHECK(get(&servers[2], "/small", &body, &res) == ESP_OK && res.reused);
+    CHECK(server_accepted(&servers[2]) == 1);
+
+    // The server closes an idle keep-alive: one transparent reconnect
+    server_drop(&servers[2]);
+    CHECK(get(&servers[2], "/small", &body, &res) == ESP_OK);
+    print_result("server closed idle", &res);
+    CHECK(res.status == 200 && res.phases.new_connection);
+    CHECK(strcmp(body.data, SMALL_BODY) == 0);
+    CHECK(server_accepted(&servers[2]) == 2);
+    http_pool_get_stats(&ps);
+    CHECK(ps.reconnects == 1);
+
+    // Connection: close from the server: the next request opens a new one
+    CHECK(get(&servers[3], "/close", &body, &res) == ESP_OK);
+    CHECK(get(&servers[3], "/small", &body, &res) == ESP_OK);
+    print_result("after Connection: close", &res);
+    CHECK(res.phases.new_connection && server_accepted(&servers[3]) == 2);
+
+    // Lookups: a, 4 more hosts, a again, the reconnect and the reopen
+    dns_cache_get_stats(&ds);
+    http_pool_get_stats(&ps);
+    printf("%-22s cold %lu, warm %lu (avg %lu / %lu ms), %lu DNS lookups\n", "totals",
+           (unsigned long)ps.cold_requests, (unsigned long)ps.warm_requests,
+           (unsigned long)(ps.cold_requests ? ps.cold_total_ms / ps.cold_requests : 0),
+           (unsigned long)(ps.warm_requests ? ps.warm_total_ms / ps.warm_requests : 0),
+           (unsigned long)ds.lookups);
+    CHECK(ds.lookups == 1 + (MAX_SERVERS - 1) + 1 + 1 + 1);
+
+    // A warm request gets its own timeout, not the one the client was created with
+    test_server_t *t = &servers[MAX_SERVERS - 1];
+    CHECK(get(t, "/slow", &body, &res) == ESP_OK);
+    CHECK(server_accepted(t) == 1);
+    int64_t start = esp_timer_get_time();
+    CHECK(get_timeout(t, "/slow", SLOW_MS / 5, &body, &res) != ESP_OK);
+    int64_t waited_ms = (esp_timer_get_time() - start) / 1000;
+    printf("%-22s failed after %lld ms (timeout %d ms, reply after %d ms)\n",
+           "warm, shorter timeout", (long long)waited_ms, SLOW_MS / 5, SLOW_MS);
+    CHECK(waited_ms < SLOW_MS);  // A retry on a fresh connection times out as well
+
+    printf("Pool test passed\n");
+    return 0;
+}
+
+// ============================================================================
+// Cache test
+// ============================================================================
+
+typedef struct {
+    body_t body;
+    int status;          // As reported to on_begin
+    int ends;            // on_end calls
+    bool clear_on_begin; // Clear the cache while the body is being served
+} cache_body_t;
+
+static esp_err_t cache_begin(void *ctx, int status, int64_t content_length) {
+    (void)content_length;
+    cache_body_t *b = (cache_body_t *)ctx;
+    b->status = status;
+    // Sinks run without the cache mutex, so they may use the cache
+    http_cache_stats_t cs;
+    http_cache_get_stats(&cs);
+    if (b->clear_on_begin) {
+        http_cache_clear();
+    }
+    return ESP_OK;
+}
+
+static esp_err_t cache_data(void *ctx, const uint8_t *data, size_t len) {
+    return body_data(&((cache_body_t *)ctx)->body, data, len);
+}
+
+static void cache_end(void *ctx, esp_err_t result) {
+    (void)result;
+    ((cache_body_t *)ctx)->ends++;
+}
+
+static esp_err_t cache_get(test_server_t *s, const char *path, cache_body_t *b,
+                           http_cache_result_t *res) {
+    char url[128];
+    snprintf(url, sizeof(url), "http://localhost:%d%s", s->port, path);
+    bool clear_on_begin = b->clear_on_begin;
+    memset(b, 0, sizeof(*b));
+    b->clear_on_begin = clear_on_begin;
+    http_body_sink_t sink = {};
+    sink.on_begin = cache_begin;
+    sink.on_data = cache_data;
+    sink.on_end = cache_end;
+    sink.ctx = b;
+    http_pool_request_t req = {};
+    req.url = url;
+    req.method = HTTP_METHOD_GET;
+    req.sink = &sink;
+    req.timeout_ms = 2000;
+    return http_cache_perform(&req, res);
+}
+
+static void print_cache_result(const char *name, const http_cache_result_t *r,
+                               test_server_t *s) {
+    static const char *const sources[] = {"network", "fresh", "revalidated"};
+    printf("%-22s %-11s %3d  %4lu B%s, %d server request(s)\n", name, sources[r->source],
+           r->http.status, (unsigned long)r->body_bytes, r->from_sd ? " from SD" : "",
+           server_requests(s));
+}
+
+/**
+ * @brief The body reached the sink once, as a complete 200 response
+ */
+static bool cache_body_ok(const cache_body_t *b) {
+    return b->status == 200 && b->ends == 1 && strcmp(b->body.data, CACHE_BODY) == 0;
+}
+
+/**
+ * @brief Remove the SD tier directory the cache left behind
+ */
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+    char path[PATH_MAX];
+    for (struct dirent *de = readdir(d); de != NULL; de = readdir(d)) {
+        if (strcmp(de->d_name, ".") != 0 && strcmp(de->d_name, "..") != 0) {
+            snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+static int cache_run(test_server_t *s) {
+    cache_body_t b = {};
+    http_cache_result_t res;
+    http_cache_stats_t cs;
+    int requests;
+
+    // ETag: downloaded once, then revalidated with If-None-Match
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    print_cache_result("etag, miss", &res, s);
+    CHECK(res.source == HTTP_CACHE_NETWORK && cache_body_ok(&b));
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    print_cache_result("etag, 304", &res, s);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && res.http.status == 304 && cache_body_ok(&b));
+    CHECK(res.body_bytes == strlen(CACHE_BODY) && server_requests(s) == 2);
+
+    // The resource changes: the new body replaces the entry and is revalidated next
+    cache_version++;
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    print_cache_result("etag changed", &res, s);
+    CHECK(res.source == HTTP_CACHE_NETWORK && res.http.status == 200 && cache_body_ok(&b));
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && cache_body_ok(&b));
+
+    // Last-Modified: revalidated with If-Modified-Since
+    CHECK(cache_get(s, "/last-modified", &b, &res) == ESP_OK);
+    CHECK(res.source == HTTP_CACHE_NETWORK && cache_body_ok(&b));
+    CHECK(cache_get(s, "/last-modified", &b, &res) == ESP_OK);
+    print_cache_result("last-modified, 304", &res, s);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && res.http.status == 304 && cache_body_ok(&b));
+
+    // max-age: no request until it expires, then a 304 makes it fresh again
+    CHECK(cache_get(s, "/max-age", &b, &res) == ESP_OK);
+    CHECK(res.source == HTTP_CACHE_NETWORK && cache_body_ok(&b));
+    requests = server_requests(s);
+    CHECK(cache_get(s, "/max-age", &b, &res) == ESP_OK);
+    print_cache_result("max-age, fresh", &res, s);
+    CHECK(res.source == HTTP_CACHE_FRESH && res.http.status == 0 && cache_body_ok(&b));
+    CHECK(server_requests(s) == requests);
+    usleep(MAX_AGE_S * 1000000 + 100000);
+    CHECK(cache_get(s, "/max-age", &b, &res) == ESP_OK);
+    print_cache_result("max-age, expired", &res, s);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && cache_body_ok(&b));
+    CHECK(server_requests(s) == requests + 1);
+    CHECK(cache_get(s, "/max-age", &b, &res) == ESP_OK);
+    CHECK(res.source == HTTP_CACHE_FRESH && server_requests(s) == requests + 1);
+
+    // no-store: never stored, so never sent conditionally (the server would answer 304)
+    for (int i = 0; i < 2; i++) {
+        CHECK(cache_get(s, "/no-store", &b, &res) == ESP_OK);
+        CHECK(res.source == HTTP_CACHE_NETWORK && res.http.status == 200 && cache_body_ok(&b));
+    }
+    print_cache_result("no-store", &res, s);
+
+    // 6 misses (no-store twice), 4 revalidated, 2 fresh
+    http_cache_get_stats(&cs);
+    printf("%-22s %lu requests, %lu fresh, %lu revalidated, %lu misses, %llu B saved\n",
+           "totals", (unsigned long)cs.requests, (unsigned long)cs.fresh_hits,
+           (unsigned long)cs.revalidated, (unsigned long)cs.misses,
+           (unsigned long long)cs.bytes_saved);
+    CHECK(cs.requests == 12 && cs.fresh_hits == 2 && cs.revalidated == 4 && cs.misses == 6);
+    CHECK(cs.bytes_saved == 6 * strlen(CACHE_BODY));
+    CHECK(cs.bytes_downloaded == 6 * strlen(CACHE_BODY));
+    CHECK(cs.mem_entries == 3 && cs.mem_bytes == 3 * strlen(CACHE_BODY));
+
+    // Push everything out of PSRAM: /etag comes back from the SD tier
+    char path[32];
+    for (int i = 0; i < HTTP_CACHE_MEM_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "/etag?%d", i);
+        CHECK(cache_get(s, path, &b, &res) == ESP_OK && res.source == HTTP_CACHE_NETWORK);
+    }
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    print_cache_result("etag, evicted", &res, s);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && res.from_sd && cache_body_ok(&b));
+    http_cache_get_stats(&cs);
+    CHECK(cs.sd_hits == 1 && cs.sd_entries == HTTP_CACHE_MEM_ENTRIES + 3);
+
+    // Cleared while a sink is reading the entry: the body outlives the entry
+    b.clear_on_begin = true;
+    CHECK(cache_get(s, "/etag", &b, &res) == ESP_OK);
+    CHECK(res.source == HTTP_CACHE_REVALIDATED && cache_body_ok(&b));
+    http_cache_get_stats(&cs);
+    printf("%-22s %u entries, %lu B in PSRAM, %u on SD\n", "cleared while serving",
+           cs.mem_entries, (unsigned long)cs.mem_bytes, cs.sd_entries);
+    CHECK(cs.mem_entries == 0 && cs.mem_bytes == 0 && cs.sd_entries == 0);
+    return 0;
+}
+
+static int cache_test(void) {
+    static test_server_t server;
+    CHECK(server_start(&server));
+    CHECK(http_pool_init() == ESP_OK);
+    char dir[] = "/tmp/http_bench_cache.XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    CHECK(http_cache_init(dir) == ESP_OK);
+
+    int ret = cache_run(&server);
+    remove_dir(dir);
+    if (ret == 0) {
+        printf("Cache test passed\n");
+    }
+    return ret;
+}
+
+// ============================================================================
+// JSON: streaming parser vs DOM
+// ============================================================================
+
+/**
+ * @brief Build an array of API-like records (the records of src/json_bench.cpp)
+ */
+static size_t build_payload(char *buf, size_t size) {
+    size_t len = snprintf(buf, size, "{\"items\":[");
+    for (int i = 0; len < size - 256; i++) {
+        len += snprintf(buf + len, size - len,
+                        "%s{\"id\":%d,\"name\":\"sensor-%d\",\"value\":%d.%02d,"
+                        "\"ok\":%s,\"tags\":[\"a\",\"b\\u00e9\"],\"meta\":null}",
+                        i ? "," : "", i, i, i * 7 % 1000, i % 100, (i & 1) ? "true" : "false");
+    }
+    len += snprintf(buf + len, size - len, "]}");
+    return len;
+}
+
+static bool count_cb(void *ctx, const char *path, json_type_t type, const char *value,
+                     size_t len) {
+    (void)path;
+    (void)type;
+    (void)value;
+    (void)len;
+    (*(uint32_t *)ctx)++;
+    return true;
+}
+
+static double mb_per_s(size_t bytes, int64_t us) {
+    return us > 0 ? (double)bytes / (double)us : 0.0;  // bytes/us == MB/s
+}
+
+static size_t heap_in_use(void) {
+    return mallinfo2().uordblks;
+}
+
+/**
+ * @brief Text of every event, to compare parses of the same document
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t size;
+} event_log_t;
+
+static bool log_cb(void *ctx, const char *path, json_type_t type, const char *value,
+                   size_t len) {
+    event_log_t *log = (event_log_t *)ctx;
+    size_t need = strlen(path) + len + 16;
+    if (log->len + need > log->size) {
+        log->size = (log->len + need) * 2;
+        log->data = (char *)realloc(log->data, log->size);
+    }
+    log->len += snprintf(log->data + log->len, log->size - log->len, "%s %d ", path, type);
+    memcpy(log->data + log->len, value, len);  // Strings may hold NULs
+    log->len += len;
+    log->data[log->len++] = '\n';
+    return true;
+}
+
+/**
+ * @brief Parse doc in pieces of at most step bytes, with one extra split at
+ *        cut (0 = none), logging the events
+ */
+static esp_err_t parse_split(const char *doc, size_t len, size_t cut, size_t step,
+                             event_log_t *log) {
+    static json_stream_t parser;
+    log->len = 0;
+    json_stream_init(&parser, log_cb, log);
+    esp_err_t err = ESP_OK;
+    for (size_t off = 0; off < len && err == ESP_OK;) {
+        size_t end = off + step < len ? off + step : len;
+        if (cut > off && cut < end) {
+            end = cut;
+        }
+        err = json_stream_feed(&parser, doc + off, end - off);
+        off = end;
+    }
+    return err == ESP_OK ? json_stream_finish(&parser) : err;
+}
+
+static int chunk_test(void) {
+    // Every token kind, with splits landing inside escapes and \uXXXX pairs
+    static const char *const docs[] = {
+        "{\"s\":\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\",\"u\":\"\\u00e9\\u20ac\\ud83d\\ude00\","
+        "\"n\":[0,-1,3.25,-0.5e-3,1E+10,12345678901234],\"l\":[true,false,null],"
+        "\"o\":{\"a~b\":{\"c/d\":[[],{}]}},\"z\":\"x\\u0000y\"}",
+        " [ 1 , \"two\" , { \"three\" : 3 } ] ",
+        "-12.5e3",
+        "\"top\"",
+    };
+    event_log_t ref = {};
+    event_log_t log = {};
+
+    for (size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++) {
+        const char *doc = docs[d];
+        size_t len = strlen(doc);
+        CHECK(parse_split(doc, len, 0, len, &ref) == ESP_OK);
+        CHECK(ref.len > 0);
+        for (size_t cut = 1; cut < len; cut++) {
+            CHECK(parse_split(doc, len, cut, len, &log) == ESP_OK);
+            CHECK(log.len == ref.len && memcmp(log.data, ref.data, ref.len) == 0);
+        }
+        CHECK(parse_split(doc, len, 0, 1, &log) == ESP_OK);
+        CHECK(log.len == ref.len && memcmp(log.data, ref.data, ref.len) == 0);
+        printf("%-22s %zu bytes, %zu splits + byte by byte: same events\n",
+               d == 0 ? "chunk boundaries" : "", len, len - 1);
+    }
+
+    // Input that ends early, and input that is wrong wherever it is split
+    const char *doc = docs[0];
+    size_t len = strlen(doc);
+    for (size_t cut = 1; cut < len; cut++) {
+        CHECK(parse_split(doc, cut, 0, 7, &log) == ESP_ERR_INVALID_STATE);
+    }
+    static const char *const bad[] = {
+        "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "[tru]", "\"\\x\"", "[01]", "{\"a\":1}}",
+        "\"\\ud83d\"", "[1,]",
+    };
+    for (size_t b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+        size_t blen = strlen(bad[b]);
+        for (size_t step = 1; step <= blen; step++) {
+            CHECK(parse_split(bad[b], blen, 0, step, &log) == ESP_ERR_INVALID_RESPONSE);
+        }
+    }
+    char deep[JSON_STREAM_MAX_DEPTH + 2];
+    memset(deep, '[', sizeof(deep) - 1);
+    deep[sizeof(deep) - 1] = '\0';
+    CHECK(parse_split(deep, strlen(deep), 0, 3, &log) == ESP_ERR_INVALID_SIZE);
+    printf("%-22s %zu truncations, %zu malformed documents, depth limit: rejected\n",
+           "bad input", len - 1, sizeof(bad) / sizeof(bad[0]));
+
+    free(ref.data);
+    free(log.data);
+    return 0;
+}
+
+static int json_bench(size_t payload_kb) {
+    size_t size = payload_kb * 1024;
+    char *payload = (char *)malloc(size);
+    json_stream_t *parser = (json_stream_t *)malloc(sizeof(json_stream_t));
+    CHECK(payload != NULL && parser != NULL);
+    size_t len = build_payload(payload, size);
+
+    // Streaming parser, fed in TCP-sized chunks
+    uint32_t values = 0;
+    esp_err_t err = ESP_OK;
+    int64_t start = esp_timer_get_time();
+    for (int it = 0; it < JSON_ITERATIONS && err == ESP_OK; it++) {
+        json_stream_init(parser, count_cb, &values);
+        for (size_t off = 0; off < len && err == ESP_OK; off += JSON_CHUNK_SIZE) {
+            size_t n = (len - off < JSON_CHUNK_SIZE) ? len - off : JSON_CHUNK_SIZE;
+            err = json_stream_feed(parser, payload + off, n);
+        }
+        if (err == ESP_OK) {
+            err = json_stream_finish(parser);
+        }
+    }
+    int64_t sax_us = esp_timer_get_time() - start;
+    CHECK(err == ESP_OK);
+
+    // The DOM parser needs the whole document and builds a tree on the heap
+    Json::CharReaderBuilder builder;
+    Json::CharReader *reader = builder.newCharReader();
+    size_t tree_bytes = 0;
+    start = esp_timer_get_time();
+    for (int it = 0; it < JSON_ITERATIONS; it++) {
+        size_t before = heap_in_use();
+        Json::Value *root = new Json::Value();
+        bool ok = reader->parse(payload, payload + len, root, NULL);
+        tree_bytes = heap_in_use() - before;
+        delete root;
+        CHECK(ok);
+    }
+    int64_t dom_us = esp_timer_get_time() - start;
+    delete reader;
+
+    size_t total = len * JSON_ITERATIONS;
+    printf("%-22s %zu bytes, %lu values\n", "payload", len,
+           (unsigned long)(values / JSON_ITERATIONS));
+    printf("%-22s %.1f MB/s, state %zu bytes (fixed)\n", "SAX stream", mb_per_s(total, sax_us),
+           sizeof(json_stream_t));
+    printf("%-22s %.1f MB/s, tree %zu bytes + %zu bytes input buffer\n", "jsoncpp DOM",
+           mb_per_s(total, dom_us), tree_bytes, len);
+
+    free(parser);
+    free(payload);
+    return 0;
+}
+
+static int json_test(size_t payload_kb) {
+    if (chunk_test() != 0 || json_bench(payload_kb) != 0) {
+        return 1;
+    }
+    printf("JSON test passed\n");
+    return 0;
+}
+
+// ============================================================================
+// Inflate: http_inflate vs zlib
+// ============================================================================
+
+typedef struct {
+    const char *name;
+    http_inflate_format_t format;
+    int window_bits;  // For zlib's deflateInit2()/inflateInit2()
+} inflate_format_t;
+
+static const inflate_format_t inflate_formats[] = {
+    {"gzip", HTTP_INFLATE_GZIP, 15 + 16},
+    {"zlib", HTTP_INFLATE_DEFLATE, 15},
+    {"raw deflate", HTTP_INFLATE_DEFLATE, -15},
+};
+
+/**
+ * @brief Checks the inflated output against the original
+ */
+typedef struct {
+    const uint8_t *expect;
+    size_t expect_len;
+    size_t offset;
+    bool mismatch;
+} verify_t;
+
+static esp_err_t verify_cb(void *ctx, const uint8_t *data, size_t len) {
+    verify_t *v = (verify_t *)ctx;
+    if (v->offset + len > v->expect_len || memcmp(v->expect + v->offset, data, len) != 0) {
+        v->mismatch = true;
+    }
+    v->offset += len;
+    return ESP_OK;
+}
+
+static esp_err_t discard_cb(void *ctx, const uint8_t *data, size_t len) {
+    (void)data;
+    *(size_t *)ctx += len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Compress with zlib
+ *
+ * @return Compressed size, 0 on failure
+ */
+static size_t z_compress(const uint8_t *in, size_t len, int level, int window_bits,
+                         uint8_t *out, size_t cap) {
+    z_stream zs = {};
+    if (deflateInit2(&zs, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = len;
+    zs.next_out = out;
+    zs.avail_out = cap;
+    int ret = deflate(&zs, Z_FINISH);
+    size_t n = zs.total_out;
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END ? n : 0;
+}
+
+/**
+ * @brief Decode with http_inflate in pieces of at most step bytes
+ */
+static esp_err_t inflate_run(http_inflate_format_t format, const uint8_t *in, size_t len,
+                             size_t step, http_inflate_out_cb_t out, void *ctx) {
+    http_inflate_t *inf = http_inflate_create(format, out, ctx);
+    if (inf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_OK;
+    for (size_t off = 0; off < len && err == ESP_OK; off += step) {
+        err = http_inflate_feed(inf, in + off, len - off < step ? len - off : step);
+    }
+    if (err == ESP_OK) {
+        err = http_inflate_finish(inf);
+    }
+    http_inflate_destroy(inf);
+    return err;
+}
+
+/**
+ * @brief Decode with zlib in pieces of at most step bytes
+ *
+ * @return true if the stream ended cleanly with a valid trailer
+ */
+static bool z_inflate_run(int window_bits, const uint8_t *in, size_t len, size_t step,
+                          size_t *out_len, size_t *state_bytes) {
+    static uint8_t out[16384];
+    size_t before = heap_in_use();
+    z_stream zs = {};
+    if (inflateInit2(&zs, window_bits) != Z_OK) {
+        return false;
+    }
+    int ret = Z_OK;
+    for (size_t off = 0; off < len && ret == Z_OK; off += step) {
+        zs.next_in = (Bytef *)in + off;
+        zs.avail_in = len - off < step ? len - off : step;
+        do {
+            zs.next_out = out;
+            zs.avail_out = sizeof(out);
+            ret = inflate(&zs, Z_NO_FLUSH);
+        } while (ret == Z_OK && zs.avail_out == 0);
+        if (ret == Z_BUF_ERROR) {
+            ret = Z_OK;  // Needs more input
+        }
+    }
+    if (state_bytes != NULL) {
+        *state_bytes = heap_in_use() - before;  // The window is allocated on first use
+    }
+    if (out_len != NULL) {
+        *out_len = zs.total_out;
+    }
+    inflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+static int inflate_check(const uint8_t *payload, size_t len, uint8_t *buf, size_t cap) {
+    static const int levels[] = {0, 1, 6, 9};
+    for (size_t f = 0; f < sizeof(inflate_formats) / sizeof(inflate_formats[0]); f++) {
+        const inflate_format_t *fmt = &inflate_formats[f];
+        for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            size_t n = z_compress(payload, len, levels[l], fmt->window_bits, buf, cap);
+            CHECK(n > 0);
+            for (size_t step = 1; step <= 65536; step *= 16) {
+                verify_t v = {payload, len, 0, false};
+                CHECK(inflate_run(fmt->format, buf, n, step, verify_cb, &v) == ESP_OK);
+                CHECK(!v.mismatch && v.offset == len);
+            }
+        }
+    }
+    printf("%-22s gzip, zlib, raw at levels 0/1/6/9, chunks of 1 B to 64 KB: identical\n",
+           "round trip");
+
+    // Truncated: every prefix of a small stream must fail as such
+    size_t small = len < CORRUPT_PAYLOAD ? len : CORRUPT_PAYLOAD;
+    size_t cuts = 0;
+    for (size_t f = 0; f < sizeof(inflate_formats) / sizeof(inflate_formats[0]); f++) {
+        const inflate_format_t *fmt = &inflate_formats[f];
+        size_t n = z_compress(payload, small, 6, fmt->window_bits, buf, cap);
+        CHECK(n > 0);
+        for (size_t cut = 1; cut < n; cut++, cuts++) {
+            verify_t v = {payload, small, 0, false};
+            CHECK(inflate_run(fmt->format, buf, cut, 512, verify_cb, &v) ==
+                  ESP_ERR_INVALID_STATE);
+            CHECK(!v.mismatch);
+        }
+    }
+    printf("%-22s %zu prefixes: all ESP_ERR_INVALID_STATE\n", "truncated", cuts);
+
+    // Corrupt: one bit flipped per byte; the verdict must be zlib's. A zlib
+    // header that no longer checks out reads as raw deflate (the decoder
+    // accepts both for "deflate"), so those two bytes are left alone.
+    size_t flips = 0;
+    size_t rejected = 0;
+    for (size_t f = 0; f < 2; f++) {
+        const inflate_format_t *fmt = &inflate_formats[f];
+        size_t n = z_compress(payload, small, 6, fmt->window_bits, buf, cap);
+        CHECK(n > 0);
+        for (size_t pos = fmt->format == HTTP_INFLATE_GZIP ? 0 : 2; pos < n; pos++) {
+            uint8_t bit = 1 << (pos % 8);
+            buf[pos] ^= bit;
+            size_t z_len = 0;
+            bool z_ok = z_inflate_run(fmt->window_bits, buf, n, 512, &z_len, NULL) &&
+                        z_len == small;
+            size_t out = 0;
+            esp_err_t err = inflate_run(fmt->format, buf, n, 512, discard_cb, &out);
+            buf[pos] ^= bit;
+            if ((err == ESP_OK) != z_ok) {
+                fprintf(stderr, "%s byte %zu of %zu: http_inflate %s, zlib %s\n", fmt->name,
+                        pos, n, esp_err_to_name(err), z_ok ? "ok" : "error");
+            }
+            CHECK((err == ESP_OK) == z_ok);
+            // A flag bit that adds a header field eats the body: truncated
+            CHECK(err == ESP_OK || err == ESP_ERR_INVALID_RESPONSE ||
+                  err == ESP_ERR_INVALID_STATE);
+            flips++;
+            rejected += err != ESP_OK;
+        }
+    }
+    printf("%-22s %zu bit flips in gzip and zlib: %zu rejected, same verdict as zlib\n",
+           "corrupt", flips, rejected);
+    return 0;
+}
+
+static int inflate_bench(const uint8_t *payload, size_t len, uint8_t *buf, size_t cap) {
+    size_t n = z_compress(payload, len, 6, inflate_formats[0].window_bits, buf, cap);
+    CHECK(n > 0);
+
+    size_t before = heap_in_use();
+    http_inflate_t *inf = http_inflate_create(HTTP_INFLATE_GZIP, discard_cb, NULL);
+    CHECK(inf != NULL);
+    size_t inf_state = heap_in_use() - before;
+    http_inflate_destroy(inf);
+
+    size_t out = 0;
+    esp_err_t err = ESP_OK;
+    int64_t start = esp_timer_get_time();
+    for (int it = 0; it < JSON_ITERATIONS && err == ESP_OK; it++) {
+        err = inflate_run(HTTP_INFLATE_GZIP, buf, n, JSON_CHUNK_SIZE, discard_cb, &out);
+    }
+    int64_t inf_us = esp_timer_get_time() - start;
+    CHECK(err == ESP_OK && out == len * JSON_ITERATIONS);
+
+    size_t z_state = 0;
+    bool ok = true;
+    start = esp_timer_get_time();
+    for (int it = 0; it < JSON_ITERATIONS && ok; it++) {
+        size_t z_len = 0;
+        ok = z_inflate_run(inflate_formats[0].window_bits, buf, n, JSON_CHUNK_SIZE, &z_len,
+                           &z_state) &&
+             z_len == len;
+    }
+    int64_t z_us = esp_timer_get_time() - start;
+    CHECK(ok);
+
+    size_t total = len * JSON_ITERATIONS;
+    printf("%-22s %zu bytes, gzip -6 %zu bytes (%zu%% of the transfer)\n", "payload", len, n,
+           n * 100 / len);
+    printf("%-22s %.1f MB/s out, state %zu bytes\n", "http_inflate", mb_per_s(total, inf_us),
+           inf_state);
+    printf("%-22s %.1f MB/s out, state %zu bytes\n", "zlib inflate()", mb_per_s(total, z_us),
+           z_state);
+    return 0;
+}
+
+static int inflate_test(size_t payload_kb) {
+    size_t size = payload_kb * 1024;
+    char *payload = (char *)malloc(size);
+    size_t cap = size + size / 100 + 1024;  // Stored blocks grow a little
+    uint8_t *buf = (uint8_t *)malloc(cap);
+    CHECK(payload != NULL && buf != NULL);
+    size_t len = build_payload(payload, size);
+
+    int ret = inflate_check((const uint8_t *)payload, len, buf, cap);
+    if (ret == 0) {
+        ret = inflate_bench((const uint8_t *)payload, len, buf, cap);
+    }
+    free(buf);
+    free(payload);
+    if (ret == 0) {
+        printf("Inflate test passed\n");
+    }
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    const char *mode = "pool";
+    size_t payload_kb = 1024;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:v")) != -1) {
+        switch (opt) {
+            case 'm': mode = optarg; break;
+            case 'n': payload_kb = strtoul(optarg, NULL, 10); break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+
+    // A server that goes away must not kill us in send()
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (strcmp(mode, "pool") == 0) {
+        return pool_test();
+    }
+    if (strcmp(mode, "cache") == 0) {
+        return cache_test();
+    }
+    if (strcmp(mode, "json") == 0 && payload_kb > 0) {
+        return json_test(payload_kb);
+    }
+    if (strcmp(mode, "inflate") == 0 && payload_kb > 0) {
+        return inflate_test(payload_kb);
+    }
+    usage(argv[0]);
+    return 2;
+}
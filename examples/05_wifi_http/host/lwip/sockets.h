@@ -0,0 +1,12 @@
+/**
+ * @file sockets.h
+ * @brief lwIP socket API mapped to the BSD sockets of Linux
+ */
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
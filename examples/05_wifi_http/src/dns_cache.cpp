@@ -0,0 +1,661 @@
+/**
+ * @file dns_cache.cpp
+ * @brief TTL-aware DNS cache with background prefetch
+ */
+
+#include "dns_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/api.h"
+#include "lwip/dns.h"
+#include "lwip/ip_addr.h"
+#include "lwip/sockets.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+static const char *TAG = "dns_cache";
+
+#define NAME_LEN             64
+#define QUERY_TIMEOUT_MS     1500
+#define QUERY_TRIES          2
+#define DNS_PORT             53
+#define DNS_PACKET_SIZE      512
+
+#define PREFETCH_STACK_SIZE  4096
+#define PREFETCH_PRIORITY    2
+#define PREFETCH_INTERVAL_MS 2000
+#define PREFETCH_MARGIN_S    10     // Refresh at least this long before expiry
+#define PREFETCH_RETRY_S     30     // Back-off after a failed refresh
+
+#define NVS_NAMESPACE        "dns_cache"
+#define NVS_KEY              "entries"
+#define NVS_SAVE_INTERVAL_S  60
+
+// Wall clock before this is treated as not set (no SNTP yet)
+#define CLOCK_VALID_EPOCH    1700000000
+
+/**
+ * @brief One cached name
+ */
+typedef struct {
+    char name[NAME_LEN];
+    uint32_t addr;           // Network byte order
+    uint32_t ttl_s;          // TTL as received
+    int64_t expires_us;      // esp_timer time; 0 = no valid address
+    int64_t last_used_us;
+    int64_t retry_us;        // No prefetch attempt before this
+    uint32_t resolve_ms;     // Duration of the last real lookup
+    uint32_t hits;           // Lookups since the last refresh
+    bool used;
+} dns_entry_t;
+
+/**
+ * @brief Entry as stored in NVS
+ */
+typedef struct {
+    char name[NAME_LEN];
+    uint32_t addr;
+    uint32_t expires_epoch;  // 0 if the clock was not set
+    uint32_t resolve_ms;
+} dns_record_t;
+
+static dns_entry_t entries[DNS_CACHE_SIZE];
+static dns_cache_stats_t stats = {};
+static SemaphoreHandle_t cache_mutex = NULL;
+static bool persist_enabled = false;
+static bool dirty = false;
+static int64_t last_save_us = 0;
+
+// Last lookup of each task (see dns_cache_take_last)
+static __thread dns_cache_info_t task_last;
+static __thread bool task_last_valid;
+
+// ============================================================================
+// DNS query
+// ============================================================================
+
+static uint32_t elapsed_ms(int64_t start_us) {
+    return (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+}
+
+/**
+ * @brief Build an A/IN query for host
+ *
+ * @return Packet length, 0 if the name is not valid
+ */
+static size_t build_query(uint8_t *buf, uint16_t id, const char *host) {
+    memset(buf, 0, 12);
+    buf[0] = id >> 8;
+    buf[1] = id & 0xff;
+    buf[2] = 0x01;  // RD: recursion desired
+    buf[5] = 1;     // QDCOUNT
+
+    size_t off = 12;
+    const char *label = host;
+    while (*label != '\0') {
+        size_t n = strcspn(label, ".");
+        if (n == 0 || n > 63 || off + n + 1 > DNS_PACKET_SIZE - 5) {
+            return 0;
+        }
+        buf[off++] = (uint8_t)n;
+        memcpy(buf + off, label, n);
+        off += n;
+        label += n;
+        if (*label == '.') {
+            label++;
+        }
+    }
+    buf[off++] = 0;
+    buf[off++] = 0;  // QTYPE A
+    buf[off++] = 1;
+    buf[off++] = 0;  // QCLASS IN
+    buf[off++] = 1;
+    return off;
+}
+
+/**
+ * @brief Skip a (possibly compressed) name
+ *
+ * @return Offset after the name, 0 if malformed
+ */
+static size_t skip_name(const uint8_t *buf, size_t len, size_t off) {
+    while (off < len) {
+        uint8_t b = buf[off];
+        if ((b & 0xc0) == 0xc0) {
+            return off + 2 <= len ? off + 2 : 0;
+        }
+        if (b == 0) {
+            return off + 1;
+        }
+        off += b + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Take the first A record of a response and the lowest TTL of the
+ *        answer chain (CNAMEs included)
+ */
+static esp_err_t parse_response(const uint8_t *buf, size_t len, uint16_t id, uint32_t *addr,
+                                uint32_t *ttl) {
+    if (len < 12 || buf[0] != (id >> 8) || buf[1] != (id & 0xff) || !(buf[2] & 0x80)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    uint8_t rcode = buf[3] & 0x0f;
+    if (rcode == 3) {
+        return ESP_ERR_NOT_FOUND;  // NXDOMAIN
+    }
+    if (rcode != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint16_t qdcount = (buf[4] << 8) | buf[5];
+    uint16_t ancount = (buf[6] << 8) | buf[7];
+    size_t off = 12;
+    for (int i = 0; i < qdcount; i++) {
+        off = skip_name(buf, len, off);
+        if (off == 0 || off + 4 > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        off += 4;
+    }
+
+    bool found = false;
+    uint32_t min_ttl = DNS_CACHE_MAX_TTL_S;
+    for (int i = 0; i < ancount; i++) {
+        off = skip_name(buf, len, off);
+        if (off == 0 || off + 10 > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        uint16_t type = (buf[off] << 8) | buf[off + 1];
+        uint16_t cls = (buf[off + 2] << 8) | buf[off + 3];
+        uint32_t rr_ttl = ((uint32_t)buf[off + 4] << 24) | (buf[off + 5] << 16) |
+                          (buf[off + 6] << 8) | buf[off + 7];
+        uint16_t rdlen = (buf[off + 8] << 8) | buf[off + 9];
+        off += 10;
+        if (off + rdlen > len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (cls == 1 && (type == 1 || type == 5)) {
+            if (rr_ttl < min_ttl) {
+                min_ttl = rr_ttl;
+            }
+            if (type == 1 && rdlen == 4 && !found) {
+                memcpy(addr, buf + off, 4);
+                found = true;
+            }
+        }
+        off += rdlen;
+    }
+
+    if (!found) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *ttl = min_ttl;
+    return ESP_OK;
+}
+
+/**
+ * @brief Ask the first configured DNS server for the A record of host
+ */
+static esp_err_t dns_query(const char *host, uint32_t *addr, uint32_t *ttl) {
+    const ip_addr_t *server = dns_getserver(0);
+    if (server == NULL || !IP_IS_V4(server) || ip_addr_isany(server)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t query[DNS_PACKET_SIZE];
+    uint16_t id = esp_random() & 0xffff;
+    size_t qlen = build_query(query, id, host);
+    if (qlen == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return ESP_FAIL;
+    }
+    struct timeval tv = {QUERY_TIMEOUT_MS / 1000, (QUERY_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(DNS_PORT);
+    to.sin_addr.s_addr = ip_2_ip4(server)->addr;
+
+    uint8_t buf[DNS_PACKET_SIZE];
+    esp_err_t err = ESP_ERR_TIMEOUT;
+    for (int attempt = 0; attempt < QUERY_TRIES && err == ESP_ERR_TIMEOUT; attempt++) {
+        if (sendto(sock, query, qlen, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        while (1) {
+            int n = recv(sock, buf, sizeof(buf), 0);
+            if (n < 0) {
+                break;  // Timed out, send again
+            }
+            // Skip stray answers (e.g. to an earlier, timed out query)
+            if (n < 2 || buf[0] != (id >> 8) || buf[1] != (id & 0xff)) {
+                continue;
+            }
+            err = parse_response(buf, n, id, addr, ttl);
+            break;
+        }
+    }
+    close(sock);
+    return err;
+}
+
+// ============================================================================
+// Cache
+// ============================================================================
+
+static bool clock_valid(void) {
+    return time(NULL) > CLOCK_VALID_EPOCH;
+}
+
+/**
+ * @brief Must be called with the cache mutex held
+ */
+static dns_entry_t *cache_find(const char *host) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].used && strcasecmp(entries[i].name, host) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find or make room for host (free slot, else least recently used)
+ *
+ * Must be called with the cache mutex held.
+ */
+static dns_entry_t *cache_slot(const char *host) {
+    dns_entry_t *e = cache_find(host);
+    if (e != NULL) {
+        return e;
+    }
+    dns_entry_t *victim = NULL;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_entry_t *c = &entries[i];
+        if (!c->used) {
+            victim = c;
+            break;
+        }
+        if (victim == NULL || c->last_used_us < victim->last_used_us) {
+            victim = c;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    strncpy(victim->name, host, sizeof(victim->name) - 1);
+    victim->used = true;
+    return victim;
+}
+
+/**
+ * @brief Store a fresh answer, keeping the lookup count of an existing entry
+ *
+ * Must be called with the cache mutex held.
+ */
+static dns_entry_t *cache_store(const char *host, uint32_t addr, uint32_t ttl,
+                                uint32_t resolve_ms) {
+    dns_entry_t *e = cache_slot(host);
+    // Only a new name or address is worth an NVS write
+    if (e->addr != addr) {
+        dirty = true;
+    }
+    e->addr = addr;
+    e->ttl_s = ttl > DNS_CACHE_MAX_TTL_S ? DNS_CACHE_MAX_TTL_S : ttl;
+    e->expires_us = esp_timer_get_time() + (int64_t)e->ttl_s * 1000000;
+    e->resolve_ms = resolve_ms;
+    e->retry_us = 0;
+    return e;
+}
+
+static esp_err_t save_nvs(void) {
+    dns_record_t *recs = (dns_record_t *)calloc(DNS_CACHE_SIZE, sizeof(dns_record_t));
+    if (recs == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t epoch = clock_valid() ? (uint32_t)time(NULL) : 0;
+    size_t n = 0;
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        const dns_entry_t *e = &entries[i];
+        if (!e->used || e->addr == 0) {
+            continue;
+        }
+        dns_record_t *r = &recs[n++];
+        strcpy(r->name, e->name);
+        r->addr = e->addr;
+        r->resolve_ms = e->resolve_ms;
+        if (epoch != 0 && e->expires_us > now) {
+            r->expires_epoch = epoch + (uint32_t)((e->expires_us - now) / 1000000);
+        }
+    }
+    dirty = false;
+    xSemaphoreGive(cache_mutex);
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, NVS_KEY, recs, n * sizeof(dns_record_t));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    free(recs);
+    return ret;
+}
+
+static void load_nvs(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    dns_record_t *recs = (dns_record_t *)calloc(DNS_CACHE_SIZE, sizeof(dns_record_t));
+    size_t len = DNS_CACHE_SIZE * sizeof(dns_record_t);
+    esp_err_t ret = recs != NULL ? nvs_get_blob(nvs, NVS_KEY, recs, &len) : ESP_ERR_NO_MEM;
+    nvs_close(nvs);
+    if (ret != ESP_OK || len % sizeof(dns_record_t) != 0) {
+        free(recs);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t epoch = clock_valid() ? (uint32_t)time(NULL) : 0;
+    size_t n = len / sizeof(dns_record_t);
+    size_t valid = 0;
+    for (size_t i = 0; i < n; i++) {
+        const dns_record_t *r = &recs[i];
+        dns_entry_t *e = &entries[i];
+        memcpy(e->name, r->name, NAME_LEN);
+        e->name[NAME_LEN - 1] = '\0';
+        e->addr = r->addr;
+        e->resolve_ms = r->resolve_ms;
+        e->used = true;
+        e->last_used_us = now;
+        // Names are worth prefetching even when their records have expired
+        e->hits = DNS_CACHE_PREFETCH_HITS;
+        if (epoch != 0 && r->expires_epoch > epoch) {
+            e->ttl_s = r->expires_epoch - epoch;
+            e->expires_us = now + (int64_t)e->ttl_s * 1000000;
+            valid++;
+        }
+    }
+    free(recs);
+    ESP_LOGI(TAG, "Loaded %u names from NVS (%u still valid)", (unsigned)n, (unsigned)valid);
+}
+
+// ============================================================================
+// Prefetch
+// ============================================================================
+
+/**
+ * @brief Pick a name that is in use and about to expire
+ *
+ * Must be called with the cache mutex held.
+ */
+static dns_entry_t *prefetch_candidate(int64_t now) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_entry_t *e = &entries[i];
+        if (!e->used || e->hits < DNS_CACHE_PREFETCH_HITS || now < e->retry_us ||
+            now - e->last_used_us > (int64_t)DNS_CACHE_PREFETCH_IDLE_S * 1000000) {
+            continue;
+        }
+        // Refresh in the last tenth of the TTL, but no later than the margin
+        int64_t margin_s = e->ttl_s / 10;
+        if (margin_s < PREFETCH_MARGIN_S) {
+            margin_s = PREFETCH_MARGIN_S;
+        }
+        if (e->expires_us - now < margin_s * 1000000) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void prefetch_task(void *arg) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(PREFETCH_INTERVAL_MS));
+
+        char name[NAME_LEN];
+        name[0] = '\0';
+        int64_t now = esp_timer_get_time();
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+        dns_entry_t *e = prefetch_candidate(now);
+        if (e != NULL) {
+            strcpy(name, e->name);
+            e->retry_us = now + (int64_t)PREFETCH_RETRY_S * 1000000;
+        }
+        xSemaphoreGive(cache_mutex);
+
+        if (name[0] != '\0') {
+            uint32_t addr = 0;
+            uint32_t ttl = 0;
+            int64_t start = esp_timer_get_time();
+            esp_err_t err = dns_query(name, &addr, &ttl);
+            uint32_t ms = elapsed_ms(start);
+
+            xSemaphoreTake(cache_mutex, portMAX_DELAY);
+            if (err == ESP_OK && ttl > 0) {
+                e = cache_store(name, addr, ttl, ms);
+                e->hits = 0;  // Must be looked up again to earn the next refresh
+                stats.prefetches++;
+            } else if (err != ESP_ERR_INVALID_STATE) {
+                stats.prefetch_failures++;
+            }
+            xSemaphoreGive(cache_mutex);
+
+            if (err == ESP_OK) {
+                ESP_LOGD(TAG, "Prefetched %s (ttl %lu s, %lu ms)", name, (unsigned long)ttl,
+                         (unsigned long)ms);
+            }
+        }
+
+        if (persist_enabled && dirty &&
+            esp_timer_get_time() - last_save_us > (int64_t)NVS_SAVE_INTERVAL_S * 1000000) {
+            last_save_us = esp_timer_get_time();
+            esp_err_t err = save_nvs();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Saving to NVS failed: %s", esp_err_to_name(err));
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t dns_cache_init(bool persist) {
+    if (cache_mutex != NULL) {
+        return ESP_OK;
+    }
+    cache_mutex = xSemaphoreCreateMutex();
+    if (cache_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(entries, 0, sizeof(entries));
+    memset(&stats, 0, sizeof(stats));
+    persist_enabled = persist;
+    if (persist) {
+        load_nvs();
+    }
+
+    if (xTaskCreate(prefetch_task, "dns_prefetch", PREFETCH_STACK_SIZE, NULL, PREFETCH_PRIORITY,
+                    NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Lookup through the cache (dns_cache_resolve without the task record)
+ */
+static esp_err_t cache_resolve(const char *host, uint32_t *addr, dns_cache_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    if (cache_mutex == NULL || host == NULL || strlen(host) >= NAME_LEN) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool expired = false;
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.lookups++;
+    dns_entry_t *e = cache_find(host);
+    if (e != NULL) {
+        e->last_used_us = start;
+        e->hits++;
+        if (e->expires_us > start) {
+            *addr = e->addr;
+            info->hit = true;
+            info->ttl_s = (uint32_t)((e->expires_us - start) / 1000000);
+            info->saved_ms = e->resolve_ms;
+            stats.hits++;
+            stats.saved_ms += e->resolve_ms;
+            xSemaphoreGive(cache_mutex);
+            info->lookup_ms = elapsed_ms(start);
+            return ESP_OK;
+        }
+        expired = true;
+    }
+    stats.misses++;
+    stats.expired += expired;
+    xSemaphoreGive(cache_mutex);
+
+    uint32_t ttl = 0;
+    esp_err_t err = dns_query(host, addr, &ttl);
+    info->lookup_ms = elapsed_ms(start);
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.miss_ms += info->lookup_ms;
+    if (err == ESP_OK) {
+        info->ttl_s = ttl;
+        if (ttl > 0) {
+            e = cache_store(host, *addr, ttl, info->lookup_ms);
+            e->last_used_us = start;
+            if (e->hits == 0) {
+                e->hits = 1;
+            }
+        }
+    } else if (err != ESP_ERR_NOT_FOUND) {
+        stats.fallbacks++;
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+esp_err_t dns_cache_resolve(const char *host, uint32_t *addr, dns_cache_info_t *info) {
+    dns_cache_info_t local;
+    esp_err_t err = cache_resolve(host, addr, &local);
+    if (err != ESP_ERR_INVALID_STATE) {
+        task_last = local;
+        task_last_valid = true;
+    }
+    if (info != NULL) {
+        *info = local;
+    }
+    return err;
+}
+
+esp_err_t dns_cache_peek(const char *host, uint32_t *addr) {
+    if (cache_mutex == NULL || host == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    const dns_entry_t *e = cache_find(host);
+    if (e != NULL && e->expires_us > esp_timer_get_time()) {
+        *addr = e->addr;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+bool dns_cache_take_last(dns_cache_info_t *out) {
+    bool valid = task_last_valid;
+    if (out != NULL) {
+        *out = valid ? task_last : dns_cache_info_t{};
+    }
+    task_last_valid = false;
+    return valid;
+}
+
+void dns_cache_flush(void) {
+    if (cache_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    memset(entries, 0, sizeof(entries));
+    dirty = false;
+    xSemaphoreGive(cache_mutex);
+
+    if (persist_enabled) {
+        nvs_handle_t nvs;
+        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+            nvs_erase_key(nvs, NVS_KEY);
+            nvs_commit(nvs);
+            nvs_close(nvs);
+        }
+    }
+}
+
+void dns_cache_get_stats(dns_cache_stats_t *out) {
+    if (cache_mutex == NULL || out == NULL) {
+        return;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = stats;
+    out->entries = 0;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (entries[i].used) {
+            out->entries++;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+// ============================================================================
+// lwIP hook
+// ============================================================================
+
+/**
+ * @brief Called by lwIP for every netconn_gethostbyname() (and so getaddrinfo)
+ *
+ * @return 1 if the name was resolved here, 0 to let lwIP resolve it
+ */
+extern "C" int lwip_hook_netconn_external_resolve(const char *name, ip_addr_t *addr,
+                                                  u8_t addrtype, err_t *err) {
+    if (cache_mutex == NULL || addrtype == NETCONN_DNS_IPV6) {
+        return 0;
+    }
+    // Address literals are lwIP's business
+    ip_addr_t literal;
+    if (ipaddr_aton(name, &literal)) {
+        return 0;
+    }
+
+    uint32_t v4 = 0;
+    if (dns_cache_resolve(name, &v4, NULL) != ESP_OK) {
+        return 0;
+    }
+    ip_addr_set_ip4_u32(addr, v4);
+    *err = ERR_OK;
+    return 1;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file dns_cache.h
+ * @brief TTL-aware DNS cache with background prefetch
+ *
+ * Every name lookup on the P4 is a round trip through the C6 to the
+ * resolver. This cache answers A-record lookups from memory for as long as
+ * the record's TTL allows. It is installed as lwIP's external resolve hook
+ * (CONFIG_LWIP_HOOK_NETCONN_EXT_RESOLVE_CUSTOM), so getaddrinfo() calls made
+ * by esp_http_client/esp-tls go through it too.
+ *
+ * Misses are resolved with a direct query to the configured DNS server,
+ * which is how the record TTL is learned (getaddrinfo does not report it).
+ * If that fails the lookup falls through to lwIP's own resolver.
+ *
+ * A background task re-resolves names that are in use shortly before they
+ * expire, so popular hosts never see a miss. Optionally the cached names
+ * are kept in NVS: after a reboot they are served while still valid (when
+ * the wall clock is set) and prefetched as soon as the network is up.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Names kept (least recently used is replaced)
+#define DNS_CACHE_SIZE            16
+
+// Upper bound on the TTL taken from a record
+#define DNS_CACHE_MAX_TTL_S       86400
+
+// Lookups since the last refresh that make a name worth prefetching
+#define DNS_CACHE_PREFETCH_HITS   2
+
+// Names not looked up for this long are left to expire
+#define DNS_CACHE_PREFETCH_IDLE_S 600
+
+/**
+ * @brief Details of one lookup
+ */
+typedef struct {
+    bool hit;            // Answered from the cache
+    uint32_t ttl_s;      // Remaining TTL
+    uint32_t lookup_ms;  // Time this lookup took
+    uint32_t saved_ms;   // On a hit: time the last real lookup of this name took
+} dns_cache_info_t;
+
+/**
+ * @brief Accumulated statistics
+ */
+typedef struct {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t expired;            // Misses on a name whose entry had expired
+    uint32_t fallbacks;          // Misses left to lwIP's resolver
+    uint32_t prefetches;
+    uint32_t prefetch_failures;
+    uint64_t miss_ms;            // Time spent resolving misses
+    uint64_t saved_ms;           // Sum of saved_ms over all hits
+    uint8_t entries;
+} dns_cache_stats_t;
+
+/**
+ * @brief Initialize the cache and start the prefetch task
+ *
+ * Call before the first lookup. Lookups before init go to lwIP directly.
+ *
+ * @param persist: Load names from NVS and keep them there
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Failed to create the mutex or the task
+ */
+esp_err_t dns_cache_init(bool persist);
+
+/**
+ * @brief Resolve a host name to an IPv4 address
+ *
+ * @param host: Host name
+ * @param addr: IPv4 address in network byte order
+ * @param info: Lookup details, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Resolved
+ *    - ESP_ERR_INVALID_STATE: Cache not initialized or no DNS server yet
+ *    - ESP_ERR_NOT_FOUND: Name does not resolve
+ *    - ESP_ERR_TIMEOUT: DNS server did not answer
+ */
+esp_err_t dns_cache_resolve(const char *host, uint32_t *addr, dns_cache_info_t *info);
+
+/**
+ * @brief Get the cached address of a name without counting a lookup
+ *
+ * Sends no query and leaves the statistics and the prefetch bookkeeping
+ * alone, for callers that only observe (e.g. measurement probes).
+ *
+ * @return
+ *    - ESP_OK: Valid entry, address in addr
+ *    - ESP_ERR_NOT_FOUND: Not cached or expired
+ *    - ESP_ERR_INVALID_STATE: Cache not initialized
+ */
+esp_err_t dns_cache_peek(const char *host, uint32_t *addr);
+
+/**
+ * @brief Take the details of the calling task's last lookup
+ *
+ * Lookups made through the lwIP hook count too, so the time esp-tls spent
+ * resolving a new connection can be read back once it is open. The record
+ * is cleared by the call; call with NULL before a connect to clear it.
+ *
+ * @param out: Receives the details, can be NULL
+ *
+ * @return true if the task resolved a name through the cache since the
+ *         last call
+ */
+bool dns_cache_take_last(dns_cache_info_t *out);
+
+/**
+ * @brief Drop all entries (and the NVS copy when persisting)
+ */
+void dns_cache_flush(void);
+
+/**
+ * @brief Get accumulated statistics
+ *
+ * @param out: Destination structure
+ */
+void dns_cache_get_stats(dns_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,950 @@
+/**
+ * @file http_cache.cpp
+ * @brief HTTP response cache with conditional revalidation (PSRAM + SD)
+ */
+
+#include "http_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+static const char *TAG = "http_cache";
+
+#define ETAG_LEN          64
+#define LAST_MODIFIED_LEN 32
+#define SD_DIR_LEN        48
+
+#define INDEX_MAGIC       0x48434931  // "HCI1"
+#define INDEX_VERSION     1
+
+// Wall clock before this is treated as not set (no SNTP yet)
+#define CLOCK_VALID_EPOCH 1700000000
+
+/**
+ * @brief Validators and freshness of a stored response
+ */
+typedef struct {
+    char etag[ETAG_LEN];
+    char last_modified[LAST_MODIFIED_LEN];
+    uint32_t stored_at;  // Wall clock seconds when stored/revalidated, 0: clock not set
+    uint32_t max_age;    // Seconds the entry is fresh, 0 = always revalidate
+} cache_meta_t;
+
+/**
+ * @brief PSRAM tier entry
+ */
+typedef struct {
+    bool used;
+    bool dropped;            // Evicted or replaced while pinned, freed on unpin
+    uint16_t pins;           // Sinks reading the body without the mutex
+    uint32_t url_hash;
+    char url[HTTP_CACHE_URL_LEN];
+    cache_meta_t meta;
+    uint8_t *body;
+    uint32_t size;
+    int64_t fresh_until_us;  // esp_timer time the entry goes stale, 0: stale
+    int64_t last_access_us;
+} mem_entry_t;
+
+/**
+ * @brief SD tier index record (persisted as is)
+ *
+ * Body files are named after the URL hash and start with the full URL,
+ * which is checked on load to rule out hash collisions.
+ */
+typedef struct {
+    uint32_t url_hash;  // 0 = unused
+    uint32_t size;
+    uint32_t last_access;
+    cache_meta_t meta;
+} sd_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} sd_index_header_t;
+
+/**
+ * @brief Per-request state shared by the event handler and the sink wrapper
+ */
+typedef struct {
+    const http_pool_request_t *req;
+    bool have_entry;             // A validator was sent
+
+    // Headers of the final response
+    char etag[ETAG_LEN];
+    char last_modified[LAST_MODIFIED_LEN];
+    int32_t max_age;             // -1 if not given
+    bool no_store;
+    bool no_cache;
+
+    // Body capture for storing
+    bool not_modified;
+    bool capture;
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t cap;
+} cache_req_t;
+
+static mem_entry_t mem_entries[HTTP_CACHE_MEM_ENTRIES];
+static uint32_t mem_bytes = 0;
+
+static sd_record_t *sd_index = NULL;  // HTTP_CACHE_SD_ENTRIES records, in PSRAM
+static char sd_dir[SD_DIR_LEN];
+static bool sd_enabled = false;
+
+static http_cache_stats_t stats = {};
+
+// cache_mutex guards the PSRAM tier and the statistics, sd_mutex the SD
+// index and files. Neither is taken while holding the other, so card I/O
+// never holds up requests served from PSRAM.
+static SemaphoreHandle_t cache_mutex = NULL;
+static SemaphoreHandle_t sd_mutex = NULL;
+
+static uint32_t now_s(void) {
+    return (uint32_t)time(NULL);
+}
+
+static uint32_t url_hash(const char *url) {
+    uint32_t h = esp_rom_crc32_le(0, (const uint8_t *)url, strlen(url));
+    return h != 0 ? h : 1;
+}
+
+static bool clock_valid(void) {
+    return time(NULL) > CLOCK_VALID_EPOCH;
+}
+
+/**
+ * @brief stored_at for a response stored or revalidated now
+ */
+static uint32_t stored_now(void) {
+    return clock_valid() ? now_s() : 0;
+}
+
+/**
+ * @brief End of freshness of a response stored or revalidated now
+ *
+ * Timed with esp_timer, so it holds while the wall clock is not set and
+ * does not move when SNTP sets it.
+ */
+static int64_t fresh_from_now(uint32_t max_age) {
+    return max_age > 0 ? esp_timer_get_time() + (int64_t)max_age * 1000000 : 0;
+}
+
+/**
+ * @brief End of freshness of an entry loaded from the SD tier
+ *
+ * What is left of max-age is only known when the clock is set now and was
+ * set when the entry was stored. Otherwise the entry is stale, so it is
+ * revalidated instead of trusting an unknown age.
+ */
+static int64_t fresh_from_meta(const cache_meta_t *m) {
+    if (m->max_age == 0 || m->stored_at <= CLOCK_VALID_EPOCH || !clock_valid()) {
+        return 0;
+    }
+    uint32_t now = now_s();
+    if (now < m->stored_at || now - m->stored_at >= m->max_age) {
+        return 0;
+    }
+    return fresh_from_now(m->max_age - (now - m->stored_at));
+}
+
+static bool meta_has_validator(const cache_meta_t *m) {
+    return m->etag[0] != '\0' || m->last_modified[0] != '\0';
+}
+
+static void copy_str(char *dst, size_t dst_len, const char *src) {
+    snprintf(dst, dst_len, "%s", src);
+}
+
+// ============================================================================
+// SD tier
+// ============================================================================
+
+// The helpers here expect sd_mutex to be held, except sd_store(),
+// sd_load(), sd_update_meta(), sd_clear() and sd_usage(), which take it.
+
+static void sd_body_path(uint32_t hash, char *path, size_t len) {
+    snprintf(path, len, "%s/%08lx.bin", sd_dir, (unsigned long)hash);
+}
+
+static void sd_index_path(const char *name, char *path, size_t len) {
+    snprintf(path, len, "%s/%s", sd_dir, name);
+}
+
+/**
+ * @brief Persist the index (write a temp file, then swap it in)
+ */
+static void sd_save_index(void) {
+    char tmp_path[SD_DIR_LEN + 16];
+    char path[SD_DIR_LEN + 16];
+    sd_index_path("index.tmp", tmp_path, sizeof(tmp_path));
+    sd_index_path("index.bin", path, sizeof(path));
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "Cannot write %s", tmp_path);
+        return;
+    }
+    sd_index_header_t hdr = {INDEX_MAGIC, INDEX_VERSION, HTTP_CACHE_SD_ENTRIES};
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(sd_index, sizeof(sd_record_t), HTTP_CACHE_SD_ENTRIES, f) ==
+                  HTTP_CACHE_SD_ENTRIES;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        unlink(tmp_path);
+        return;
+    }
+
+    // FAT cannot rename over an existing file
+    unlink(path);
+    rename(tmp_path, path);
+}
+
+static bool sd_read_index(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    sd_index_header_t hdr = {};
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == INDEX_MAGIC &&
+              hdr.version == INDEX_VERSION && hdr.count == HTTP_CACHE_SD_ENTRIES &&
+              fread(sd_index, sizeof(sd_record_t), HTTP_CACHE_SD_ENTRIES, f) ==
+                  HTTP_CACHE_SD_ENTRIES;
+    fclose(f);
+    if (!ok) {
+        memset(sd_index, 0, sizeof(sd_record_t) * HTTP_CACHE_SD_ENTRIES);
+    }
+    return ok;
+}
+
+static void sd_load_index(void) {
+    char path[SD_DIR_LEN + 16];
+    sd_index_path("index.bin", path, sizeof(path));
+    if (sd_read_index(path)) {
+        return;
+    }
+    // Power lost between unlink and rename of the previous save
+    sd_index_path("index.tmp", path, sizeof(path));
+    if (sd_read_index(path)) {
+        sd_save_index();
+    }
+}
+
+static int sd_find(uint32_t hash) {
+    for (int i = 0; i < HTTP_CACHE_SD_ENTRIES; i++) {
+        if (sd_index[i].url_hash == hash) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void sd_remove(int i) {
+    char path[SD_DIR_LEN + 16];
+    sd_body_path(sd_index[i].url_hash, path, sizeof(path));
+    unlink(path);
+    memset(&sd_index[i], 0, sizeof(sd_index[i]));
+}
+
+/**
+ * @brief Write a body to the SD tier, evicting least recently used records
+ */
+static void sd_store_locked(const char *url, uint32_t hash, const cache_meta_t *meta,
+                            const uint8_t *body, uint32_t size) {
+    int slot = sd_find(hash);
+    if (slot >= 0) {
+        sd_remove(slot);
+    }
+
+    for (;;) {
+        uint32_t total = 0;
+        int free_slot = -1;
+        int lru = -1;
+        for (int i = 0; i < HTTP_CACHE_SD_ENTRIES; i++) {
+            if (sd_index[i].url_hash == 0) {
+                if (free_slot < 0) {
+                    free_slot = i;
+                }
+                continue;
+            }
+            total += sd_index[i].size;
+            if (lru < 0 || sd_index[i].last_access < sd_index[lru].last_access) {
+                lru = i;
+            }
+        }
+        if (free_slot >= 0 && total + size <= HTTP_CACHE_SD_BYTES) {
+            slot = free_slot;
+            break;
+        }
+        if (lru < 0) {
+            return;
+        }
+        sd_remove(lru);
+    }
+
+    char path[SD_DIR_LEN + 16];
+    sd_body_path(hash, path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "Cannot write %s", path);
+        return;
+    }
+    uint16_t url_len = strlen(url);
+    bool ok = fwrite(&url_len, sizeof(url_len), 1, f) == 1 &&
+              fwrite(url, 1, url_len, f) == url_len &&
+              (size == 0 || fwrite(body, 1, size, f) == size);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        unlink(path);
+        return;
+    }
+
+    sd_record_t *r = &sd_index[slot];
+    r->url_hash = hash;
+    r->size = size;
+    r->last_access = now_s();
+    r->meta = *meta;
+    sd_save_index();
+}
+
+static void sd_store(const char *url, uint32_t hash, const cache_meta_t *meta,
+                     const uint8_t *body, uint32_t size) {
+    if (!sd_enabled) {
+        return;
+    }
+    xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    sd_store_locked(url, hash, meta, body, size);
+    xSemaphoreGive(sd_mutex);
+}
+
+/**
+ * @brief Read a body from the SD tier into a PSRAM buffer
+ *
+ * @return Buffer (caller frees), or NULL if missing/unreadable
+ */
+static uint8_t *sd_load_locked(const char *url, uint32_t hash, cache_meta_t *meta,
+                               uint32_t *size) {
+    int i = sd_find(hash);
+    if (i < 0) {
+        return NULL;
+    }
+
+    char path[SD_DIR_LEN + 16];
+    sd_body_path(hash, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        memset(&sd_index[i], 0, sizeof(sd_index[i]));
+        return NULL;
+    }
+
+    char stored_url[HTTP_CACHE_URL_LEN];
+    uint16_t url_len = 0;
+    bool ok = fread(&url_len, sizeof(url_len), 1, f) == 1 && url_len < sizeof(stored_url) &&
+              fread(stored_url, 1, url_len, f) == url_len;
+    if (ok) {
+        stored_url[url_len] = '\0';
+        ok = strcmp(stored_url, url) == 0;
+    }
+
+    uint32_t n = sd_index[i].size;
+    uint8_t *body = NULL;
+    if (ok) {
+        body = (uint8_t *)heap_caps_malloc(n ? n : 1, MALLOC_CAP_SPIRAM);
+        ok = body != NULL && (n == 0 || fread(body, 1, n, f) == n);
+    }
+    fclose(f);
+
+    if (!ok) {
+        free(body);
+        return NULL;
+    }
+
+    sd_index[i].last_access = now_s();  // Persisted with the next index save
+    *meta = sd_index[i].meta;
+    *size = n;
+    return body;
+}
+
+static uint8_t *sd_load(const char *url, uint32_t hash, cache_meta_t *meta, uint32_t *size) {
+    if (!sd_enabled) {
+        return NULL;
+    }
+    xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    uint8_t *body = sd_load_locked(url, hash, meta, size);
+    xSemaphoreGive(sd_mutex);
+    return body;
+}
+
+static void sd_update_meta(uint32_t hash, const cache_meta_t *meta) {
+    if (!sd_enabled) {
+        return;
+    }
+    xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    int i = sd_find(hash);
+    if (i >= 0) {
+        sd_index[i].meta = *meta;
+        sd_index[i].last_access = now_s();
+        sd_save_index();
+    }
+    xSemaphoreGive(sd_mutex);
+}
+
+static void sd_clear(void) {
+    if (!sd_enabled) {
+        return;
+    }
+    xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    for (int i = 0; i < HTTP_CACHE_SD_ENTRIES; i++) {
+        if (sd_index[i].url_hash != 0) {
+            sd_remove(i);
+        }
+    }
+    sd_save_index();
+    xSemaphoreGive(sd_mutex);
+}
+
+static void sd_usage(uint16_t *entries, uint32_t *bytes) {
+    *entries = 0;
+    *bytes = 0;
+    if (!sd_enabled) {
+        return;
+    }
+    xSemaphoreTake(sd_mutex, portMAX_DELAY);
+    for (int i = 0; i < HTTP_CACHE_SD_ENTRIES; i++) {
+        if (sd_index[i].url_hash != 0) {
+            (*entries)++;
+            *bytes += sd_index[i].size;
+        }
+    }
+    xSemaphoreGive(sd_mutex);
+}
+
+// ============================================================================
+// PSRAM tier
+// ============================================================================
+
+static mem_entry_t *mem_find(const char *url, uint32_t hash) {
+    for (int i = 0; i < HTTP_CACHE_MEM_ENTRIES; i++) {
+        mem_entry_t *e = &mem_entries[i];
+        if (e->used && !e->dropped && e->url_hash == hash && strcmp(e->url, url) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void mem_remove(mem_entry_t *e) {
+    mem_bytes -= e->size;
+    free(e->body);
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Remove an entry, or only unlink it while a sink still reads it
+ */
+static void mem_drop(mem_entry_t *e) {
+    if (e->pins > 0) {
+        e->dropped = true;
+    } else {
+        mem_remove(e);
+    }
+}
+
+/**
+ * @brief Insert a body (takes ownership), evicting least recently used entries
+ */
+static mem_entry_t *mem_insert(const char *url, uint32_t hash, const cache_meta_t *meta,
+                               int64_t fresh_until_us, uint8_t *body, uint32_t size) {
+    mem_entry_t *e = mem_find(url, hash);
+    if (e != NULL) {
+        mem_drop(e);
+    }
+
+    for (;;) {
+        mem_entry_t *free_entry = NULL;
+        mem_entry_t *lru = NULL;  // Pinned entries cannot make room
+        for (int i = 0; i < HTTP_CACHE_MEM_ENTRIES; i++) {
+            mem_entry_t *m = &mem_entries[i];
+            if (!m->used) {
+                if (free_entry == NULL) {
+                    free_entry = m;
+                }
+            } else if (m->pins == 0 && (lru == NULL || m->last_access_us < lru->last_access_us)) {
+                lru = m;
+            }
+        }
+        if (free_entry != NULL && mem_bytes + size <= HTTP_CACHE_MEM_BYTES) {
+            e = free_entry;
+            break;
+        }
+        if (lru == NULL) {
+            free(body);
+            return NULL;
+        }
+        mem_remove(lru);
+    }
+
+    e->used = true;
+    e->url_hash = hash;
+    copy_str(e->url, sizeof(e->url), url);
+    e->meta = *meta;
+    e->body = body;
+    e->size = size;
+    e->fresh_until_us = fresh_until_us;
+    e->last_access_us = esp_timer_get_time();
+    mem_bytes += size;
+    return e;
+}
+
+/**
+ * @brief Find an entry in PSRAM, promoting it from SD if necessary
+ *
+ * Called with the cache mutex held. It is released while the body is read
+ * from the card.
+ */
+static mem_entry_t *cache_lookup(const char *url, uint32_t hash, bool *from_sd) {
+    *from_sd = false;
+    mem_entry_t *e = mem_find(url, hash);
+    if (e != NULL || !sd_enabled) {
+        return e;
+    }
+
+    xSemaphoreGive(cache_mutex);
+    cache_meta_t meta;
+    uint32_t size = 0;
+    uint8_t *body = sd_load(url, hash, &meta, &size);
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    if (body == NULL) {
+        return NULL;
+    }
+
+    // Another request may have put it in PSRAM in the meantime
+    e = mem_find(url, hash);
+    if (e != NULL) {
+        free(body);
+        return e;
+    }
+    *from_sd = true;
+    return mem_insert(url, hash, &meta, fresh_from_meta(&meta), body, size);
+}
+
+/**
+ * @brief Deliver a cached body to the caller's sink as a 200 response
+ *
+ * Called with the cache mutex held. The entry is pinned and the mutex
+ * released while the sink runs, so a slow sink (a file on the card) does
+ * not hold up other requests and a sink may use the cache itself. The
+ * entry may be gone when this returns.
+ */
+static esp_err_t cache_serve(mem_entry_t *e, const http_body_sink_t *sink) {
+    e->pins++;
+    const uint8_t *body = e->body;
+    uint32_t size = e->size;
+    xSemaphoreGive(cache_mutex);
+
+    esp_err_t err = ESP_OK;
+    if (sink != NULL && sink->on_begin != NULL) {
+        err = sink->on_begin(sink->ctx, 200, size);
+    }
+    for (uint32_t off = 0; err == ESP_OK && off < size; off += HTTP_POOL_BUFFER_SIZE) {
+        uint32_t n = size - off;
+        if (n > HTTP_POOL_BUFFER_SIZE) {
+            n = HTTP_POOL_BUFFER_SIZE;
+        }
+        if (sink != NULL && sink->on_data != NULL) {
+            err = sink->on_data(sink->ctx, body + off, n);
+        }
+    }
+    if (sink != NULL && sink->on_end != NULL) {
+        sink->on_end(sink->ctx, err);
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    if (--e->pins == 0 && e->dropped) {
+        mem_remove(e);
+    }
+    return err;
+}
+
+// ============================================================================
+// Request wrappers
+// ============================================================================
+
+/**
+ * @brief Parse the directives of a Cache-Control header
+ */
+static void parse_cache_control(cache_req_t *c, const char *value) {
+    while (*value != '\0') {
+        while (*value == ' ' || *value == ',') {
+            value++;
+        }
+        size_t len = strcspn(value, ",");
+        if (len == 8 && strncasecmp(value, "no-store", 8) == 0) {
+            c->no_store = true;
+        } else if (len == 8 && strncasecmp(value, "no-cache", 8) == 0) {
+            c->no_cache = true;
+        } else if (len > 8 && strncasecmp(value, "max-age=", 8) == 0) {
+            c->max_age = atoi(value + 8);
+        }
+        value += len;
+    }
+}
+
+/**
+ * @brief Event handler: record caching headers, then forward to the caller
+ */
+static esp_err_t cache_event_handler(esp_http_client_event_t *evt) {
+    cache_req_t *c = (cache_req_t *)evt->user_data;
+
+    if (evt->event_id == HTTP_EVENT_HEADERS_SENT) {
+        // New request on the wire (also after a redirect): forget earlier headers
+        c->etag[0] = '\0';
+        c->last_modified[0] = '\0';
+        c->max_age = -1;
+        c->no_store = false;
+        c->no_cache = false;
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        if (strcasecmp(evt->header_key, "ETag") == 0) {
+            copy_str(c->etag, sizeof(c->etag), evt->header_value);
+        } else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+            copy_str(c->last_modified, sizeof(c->last_modified), evt->header_value);
+        } else if (strcasecmp(evt->header_key, "Cache-Control") == 0) {
+            parse_cache_control(c, evt->header_value);
+        }
+    }
+
+    if (c->req->event_handler == NULL) {
+        return ESP_OK;
+    }
+    evt->user_data = c->req->user_data;
+    esp_err_t ret = c->req->event_handler(evt);
+    evt->user_data = c;
+    return ret;
+}
+
+static bool response_cacheable(const cache_req_t *c) {
+    return !c->no_store && (c->etag[0] != '\0' || c->last_modified[0] != '\0' ||
+                            (c->max_age > 0 && !c->no_cache));
+}
+
+static esp_err_t wrap_sink_begin(void *ctx, int status, int64_t content_length) {
+    cache_req_t *c = (cache_req_t *)ctx;
+    const http_body_sink_t *sink = c->req->sink;
+
+    if (status == 304 && c->have_entry) {
+        // Body comes from the cache once the request is done
+        c->not_modified = true;
+        return ESP_OK;
+    }
+
+    c->capture = status == 200 && response_cacheable(c) &&
+                 content_length <= HTTP_CACHE_MAX_BODY;
+    if (c->capture) {
+        c->cap = content_length >= 0 ? (uint32_t)content_length : 4096;
+        c->buf = (uint8_t *)heap_caps_malloc(c->cap ? c->cap : 1, MALLOC_CAP_SPIRAM);
+        c->capture = c->buf != NULL;
+    }
+
+    if (sink != NULL && sink->on_begin != NULL) {
+        return sink->on_begin(sink->ctx, status, content_length);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t wrap_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    cache_req_t *c = (cache_req_t *)ctx;
+    const http_body_sink_t *sink = c->req->sink;
+
+    if (c->not_modified) {
+        return ESP_OK;
+    }
+
+    if (c->capture && c->len + len > c->cap) {
+        uint32_t cap = c->cap * 2;
+        if (cap < c->len + len) {
+            cap = c->len + len;
+        }
+        uint8_t *buf = NULL;
+        if (cap <= HTTP_CACHE_MAX_BODY) {
+            buf = (uint8_t *)heap_caps_realloc(c->buf, cap, MALLOC_CAP_SPIRAM);
+        }
+        if (buf == NULL) {
+            // Too large (or out of memory): stop capturing, keep streaming
+            free(c->buf);
+            c->buf = NULL;
+            c->capture = false;
+        } else {
+            c->buf = buf;
+            c->cap = cap;
+        }
+    }
+    if (c->capture) {
+        memcpy(c->buf + c->len, data, len);
+        c->len += len;
+    }
+
+    if (sink != NULL && sink->on_data != NULL) {
+        return sink->on_data(sink->ctx, data, len);
+    }
+    return ESP_OK;
+}
+
+static void wrap_sink_end(void *ctx, esp_err_t result) {
+    cache_req_t *c = (cache_req_t *)ctx;
+    const http_body_sink_t *sink = c->req->sink;
+
+    // A successful 304 is completed by cache_serve()
+    if (c->not_modified && result == ESP_OK) {
+        return;
+    }
+    if (sink != NULL && sink->on_end != NULL) {
+        sink->on_end(sink->ctx, result);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t http_cache_init(const char *dir) {
+    if (cache_mutex == NULL) {
+        cache_mutex = xSemaphoreCreateMutex();
+        sd_mutex = xSemaphoreCreateMutex();
+        if (cache_mutex == NULL || sd_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    sd_enabled = false;
+    if (dir != NULL) {
+        copy_str(sd_dir, sizeof(sd_dir), dir);
+        if (mkdir(sd_dir, 0775) != 0 && errno != EEXIST) {
+            ESP_LOGW(TAG, "Cannot create %s, SD tier disabled", sd_dir);
+        } else {
+            if (sd_index == NULL) {
+                sd_index = (sd_record_t *)heap_caps_calloc(HTTP_CACHE_SD_ENTRIES,
+                                                           sizeof(sd_record_t),
+                                                           MALLOC_CAP_SPIRAM);
+            }
+            if (sd_index != NULL) {
+                sd_load_index();
+                sd_enabled = true;
+            }
+        }
+    }
+
+    ESP_LOGI(TAG, "Cache ready: PSRAM %d KB%s%s", HTTP_CACHE_MEM_BYTES / 1024,
+             sd_enabled ? ", SD " : "", sd_enabled ? sd_dir : "");
+    return ESP_OK;
+}
+
+/**
+ * @param conditional: Allow a conditional request for a stale entry
+ */
+static esp_err_t cache_perform(const http_pool_request_t *req, http_cache_result_t *out,
+                               bool conditional) {
+    uint32_t hash = url_hash(req->url);
+
+    cache_req_t c = {};
+    c.req = req;
+    c.max_age = -1;
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    bool from_sd = false;
+    mem_entry_t *e = cache_lookup(req->url, hash, &from_sd);
+    if (e != NULL) {
+        e->last_access_us = esp_timer_get_time();
+        if (e->fresh_until_us > e->last_access_us) {
+            stats.fresh_hits++;
+            stats.sd_hits += from_sd;
+            stats.bytes_saved += e->size;
+            out->source = HTTP_CACHE_FRESH;
+            out->from_sd = from_sd;
+            out->body_bytes = e->size;
+            esp_err_t err = cache_serve(e, req->sink);
+            xSemaphoreGive(cache_mutex);
+            return err;
+        }
+        if (conditional && meta_has_validator(&e->meta)) {
+            copy_str(c.etag, sizeof(c.etag), e->meta.etag);
+            copy_str(c.last_modified, sizeof(c.last_modified), e->meta.last_modified);
+            c.have_entry = true;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+
+    // Caller's headers plus the validators
+    int header_count = 0;
+    http_pool_header_t *headers =
+        (http_pool_header_t *)malloc((req->header_count + 2) * sizeof(http_pool_header_t));
+    if (headers == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < req->header_count; i++) {
+        headers[header_count++] = req->headers[i];
+    }
+    char etag[ETAG_LEN];
+    char last_modified[LAST_MODIFIED_LEN];
+    if (c.have_entry) {
+        copy_str(etag, sizeof(etag), c.etag);
+        copy_str(last_modified, sizeof(last_modified), c.last_modified);
+        if (etag[0] != '\0') {
+            headers[header_count++] = {"If-None-Match", etag};
+        }
+        if (last_modified[0] != '\0') {
+            headers[header_count++] = {"If-Modified-Since", last_modified};
+        }
+    }
+
+    http_body_sink_t wrap = {};
+    wrap.on_begin = wrap_sink_begin;
+    wrap.on_data = wrap_sink_data;
+    wrap.on_end = wrap_sink_end;
+    wrap.ctx = &c;
+
+    http_pool_request_t pool_req = *req;
+    pool_req.event_handler = cache_event_handler;
+    pool_req.user_data = &c;
+    pool_req.sink = &wrap;
+    pool_req.headers = headers;
+    pool_req.header_count = header_count;
+
+    esp_err_t err = http_pool_perform(&pool_req, &out->http);
+    free(headers);
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.bytes_downloaded += out->http.wire_bytes;
+
+    if (err == ESP_OK && c.not_modified) {
+        // Already promoted by the first lookup if it came from SD
+        bool reloaded = false;
+        e = cache_lookup(req->url, hash, &reloaded);
+        from_sd = from_sd || reloaded;
+        if (e == NULL) {
+            // Evicted while the request was in flight
+            xSemaphoreGive(cache_mutex);
+            return cache_perform(req, out, false);
+        }
+
+        // A 304 refreshes the stored headers
+        if (c.etag[0] != '\0') {
+            copy_str(e->meta.etag, sizeof(e->meta.etag), c.etag);
+        }
+        if (c.max_age >= 0) {
+            e->meta.max_age = c.no_cache ? 0 : c.max_age;
+        }
+        e->meta.stored_at = stored_now();
+        e->fresh_until_us = fresh_from_now(e->meta.max_age);
+        e->last_access_us = esp_timer_get_time();
+        cache_meta_t meta = e->meta;
+
+        stats.revalidated++;
+        stats.sd_hits += from_sd;
+        stats.bytes_saved += e->size;
+        out->source = HTTP_CACHE_REVALIDATED;
+        out->from_sd = from_sd;
+        out->body_bytes = e->size;
+        err = cache_serve(e, req->sink);
+        xSemaphoreGive(cache_mutex);
+
+        sd_update_meta(hash, &meta);
+        return err;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    cache_meta_t meta = {};
+    bool store = err == ESP_OK && c.capture;
+    if (store) {
+        copy_str(meta.etag, sizeof(meta.etag), c.etag);
+        copy_str(meta.last_modified, sizeof(meta.last_modified), c.last_modified);
+        meta.stored_at = stored_now();
+        meta.max_age = (c.no_cache || c.max_age < 0) ? 0 : c.max_age;
+        // Written before the PSRAM tier takes ownership of the buffer
+        sd_store(req->url, hash, &meta, c.buf, c.len);
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    if (store) {
+        mem_insert(req->url, hash, &meta, fresh_from_now(meta.max_age), c.buf, c.len);
+    } else {
+        free(c.buf);
+    }
+    stats.misses++;
+    out->source = HTTP_CACHE_NETWORK;
+    out->body_bytes = out->http.body_bytes;
+    xSemaphoreGive(cache_mutex);
+    return err;
+}
+
+esp_err_t http_cache_perform(const http_pool_request_t *req, http_cache_result_t *out) {
+    if (cache_mutex == NULL || req == NULL || req->url == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    http_cache_result_t res = {};
+    esp_err_t err;
+    if (req->method != HTTP_METHOD_GET || strlen(req->url) >= HTTP_CACHE_URL_LEN) {
+        err = http_pool_perform(req, &res.http);
+        res.body_bytes = res.http.body_bytes;
+    } else {
+        err = cache_perform(req, &res, true);
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.requests++;
+    xSemaphoreGive(cache_mutex);
+
+    static const char *const source_names[] = {"network", "fresh hit", "revalidated (304)"};
+    ESP_LOGI(TAG, "%s: %s%s, %lu bytes", req->url, source_names[res.source],
+             res.from_sd ? " from SD" : "", (unsigned long)res.body_bytes);
+
+    if (out != NULL) {
+        *out = res;
+    }
+    return err;
+}
+
+void http_cache_clear(void) {
+    if (cache_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < HTTP_CACHE_MEM_ENTRIES; i++) {
+        if (mem_entries[i].used && !mem_entries[i].dropped) {
+            mem_drop(&mem_entries[i]);
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+    sd_clear();
+}
+
+void http_cache_get_stats(http_cache_stats_t *out) {
+    if (cache_mutex == NULL || out == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = stats;
+    out->mem_entries = 0;
+    for (int i = 0; i < HTTP_CACHE_MEM_ENTRIES; i++) {
+        out->mem_entries += mem_entries[i].used && !mem_entries[i].dropped;
+    }
+    out->mem_bytes = mem_bytes;
+    xSemaphoreGive(cache_mutex);
+    sd_usage(&out->sd_entries, &out->sd_bytes);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file http_cache.h
+ * @brief HTTP response cache with conditional revalidation (PSRAM + SD)
+ *
+ * Sits in front of the client pool. Successful GET responses that carry a
+ * validator (ETag / Last-Modified) or a max-age are kept in two tiers:
+ *
+ * - PSRAM: LRU of complete bodies, served without touching the network
+ * - SD card (optional): one file per body plus a compact index file, so
+ *   entries survive a reboot. SD hits are promoted back into PSRAM.
+ *
+ * Fresh entries (Cache-Control max-age not yet expired) are served
+ * directly. Entries loaded from SD are only fresh if the wall clock is set
+ * (SNTP) and was set when they were stored; otherwise they are revalidated. Stale entries are revalidated with If-None-Match /
+ * If-Modified-Since; a 304 answer is served from the cache, so only the
+ * headers cross the network.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "http_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PSRAM tier limits
+#define HTTP_CACHE_MEM_ENTRIES 16
+#define HTTP_CACHE_MEM_BYTES   (512 * 1024)
+
+// SD tier limits
+#define HTTP_CACHE_SD_ENTRIES  64
+#define HTTP_CACHE_SD_BYTES    (8 * 1024 * 1024)
+
+// Larger responses are passed through without being cached
+#define HTTP_CACHE_MAX_BODY    (64 * 1024)
+
+// Longest cacheable URL
+#define HTTP_CACHE_URL_LEN     160
+
+/**
+ * @brief Where a response came from
+ */
+typedef enum {
+    HTTP_CACHE_NETWORK,      // Downloaded (miss, or stale entry replaced)
+    HTTP_CACHE_FRESH,        // Served from cache, no request sent
+    HTTP_CACHE_REVALIDATED,  // Server answered 304, served from cache
+} http_cache_source_t;
+
+/**
+ * @brief Outcome of a cached request
+ */
+typedef struct {
+    http_pool_result_t http;     // Network result (status 0 if no request was sent)
+    http_cache_source_t source;
+    bool from_sd;                // Entry was loaded from the SD tier
+    uint32_t body_bytes;         // Bytes delivered to the caller's sink
+} http_cache_result_t;
+
+/**
+ * @brief Accumulated cache statistics
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t fresh_hits;
+    uint32_t revalidated;
+    uint32_t misses;
+    uint32_t sd_hits;           // Hits that had to be loaded from SD
+    uint64_t bytes_saved;       // Body bytes served from cache
+    uint64_t bytes_downloaded;  // Body bytes received over the network
+    uint8_t mem_entries;
+    uint32_t mem_bytes;
+    uint16_t sd_entries;
+    uint32_t sd_bytes;
+} http_cache_stats_t;
+
+/**
+ * @brief Initialize the cache
+ *
+ * @param sd_dir: Directory on a mounted SD card for the persistent tier
+ *                (created if missing), or NULL for PSRAM only
+ *
+ * @return
+ *    - ESP_OK: Success (the SD tier is disabled if the directory is unusable)
+ *    - ESP_ERR_NO_MEM: Failed to create the cache mutex
+ */
+esp_err_t http_cache_init(const char *sd_dir);
+
+/**
+ * @brief Execute a GET request through the cache
+ *
+ * Same contract as http_pool_perform(): the body is delivered to
+ * req->sink, whether it comes from the network or the cache. A
+ * revalidated or fresh response is reported to the sink as status 200.
+ * Methods other than GET bypass the cache.
+ *
+ * @param req: Request description
+ * @param out: Result, can be NULL if not needed
+ *
+ * @return Same as http_pool_perform()
+ */
+esp_err_t http_cache_perform(const http_pool_request_t *req, http_cache_result_t *out);
+
+/**
+ * @brief Drop all entries from both tiers
+ */
+void http_cache_clear(void);
+
+/**
+ * @brief Get accumulated cache statistics
+ *
+ * @param out: Destination structure
+ */
+void http_cache_get_stats(http_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,347 @@
+/**
+ * @file http_download.cpp
+ * @brief Download a file to the SD card with overlapped network/SD stages
+ */
+
+#include "http_download.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "http_pool.h"
+
+static const char *TAG = "http_download";
+
+// Cache line alignment keeps the SDMMC DMA from bouncing
+#define BUFFER_ALIGN      64
+#define WRITER_STACK_SIZE 4096
+#define WRITER_PRIORITY   5
+
+/**
+ * @brief Buffer handed from the network side to the writer
+ */
+typedef struct {
+    int index;   // -1 stops the writer
+    size_t len;
+} dl_chunk_t;
+
+/**
+ * @brief State of one download
+ */
+typedef struct {
+    const http_download_config_t *cfg;
+    FILE *file;
+
+    uint8_t *bufs[HTTP_DOWNLOAD_MAX_BUFFERS];
+    QueueHandle_t free_q;      // Buffer indices ready to be filled
+    QueueHandle_t full_q;      // dl_chunk_t ready to be written
+    SemaphoreHandle_t writer_done;
+    volatile esp_err_t write_err;
+
+    // Buffer being filled
+    int cur;
+    size_t cur_len;
+    size_t cur_cap;
+
+    int status;
+    int64_t range_total;       // From Content-Range, -1 if absent
+    bool already_complete;     // 416 for a file that is already whole
+    int64_t offset;            // File size so far
+    int64_t next_progress;
+
+    http_download_result_t res;
+    int64_t first_data_us;
+} dl_t;
+
+// ============================================================================
+// Writer task
+// ============================================================================
+
+static void writer_task(void *arg) {
+    dl_t *d = (dl_t *)arg;
+    dl_chunk_t chunk;
+
+    while (1) {
+        int64_t wait_start = esp_timer_get_time();
+        xQueueReceive(d->full_q, &chunk, portMAX_DELAY);
+        // Only count idle time once data has started flowing
+        if (d->first_data_us != 0 && wait_start > d->first_data_us) {
+            d->res.writer_idle_ms += (uint32_t)((esp_timer_get_time() - wait_start) / 1000);
+        }
+        if (chunk.index < 0) {
+            break;
+        }
+
+        if (d->write_err == ESP_OK) {
+            int64_t t = esp_timer_get_time();
+            if (fwrite(d->bufs[chunk.index], 1, chunk.len, d->file) != chunk.len) {
+                ESP_LOGE(TAG, "SD write failed");
+                d->write_err = ESP_FAIL;
+            }
+            d->res.write_ms += (uint32_t)((esp_timer_get_time() - t) / 1000);
+            d->res.writes++;
+        }
+        xQueueSend(d->free_q, &chunk.index, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(d->writer_done);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// Network side
+// ============================================================================
+
+/**
+ * @brief Take a free buffer, sized so the next write ends on a buffer boundary
+ */
+static void take_buffer(dl_t *d) {
+    int64_t t = esp_timer_get_time();
+    xQueueReceive(d->free_q, &d->cur, portMAX_DELAY);
+    d->res.net_stall_ms += (uint32_t)((esp_timer_get_time() - t) / 1000);
+
+    size_t size = d->cfg->buffer_size;
+    d->cur_len = 0;
+    d->cur_cap = size - (size_t)(d->offset % size);
+}
+
+static void submit_buffer(dl_t *d) {
+    dl_chunk_t chunk = {d->cur, d->cur_len};
+    xQueueSend(d->full_q, &chunk, portMAX_DELAY);
+    d->cur = -1;
+    d->cur_len = 0;
+}
+
+static esp_err_t dl_event_handler(esp_http_client_event_t *evt) {
+    dl_t *d = (dl_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER &&
+        strcasecmp(evt->header_key, "Content-Range") == 0) {
+        // "bytes 100-199/1000" or "bytes */1000"
+        const char *slash = strchr(evt->header_value, '/');
+        if (slash != NULL && slash[1] != '*') {
+            d->range_total = strtoll(slash + 1, NULL, 10);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t dl_begin(void *ctx, int status, int64_t content_length) {
+    dl_t *d = (dl_t *)ctx;
+    d->status = status;
+
+    const char *mode;
+    if (status == 206 && d->res.resumed_from > 0) {
+        mode = "ab";
+        d->res.total = d->range_total >= 0 ? d->range_total
+                       : content_length >= 0 ? d->res.resumed_from + content_length
+                                             : -1;
+    } else if (status == 200) {
+        if (d->res.resumed_from > 0) {
+            ESP_LOGW(TAG, "Server ignored the range, restarting from 0");
+        }
+        mode = "wb";
+        d->res.resumed_from = 0;
+        d->res.total = content_length;
+    } else if (status == 416 && d->range_total == d->res.resumed_from) {
+        d->already_complete = true;
+        d->res.total = d->range_total;
+        return ESP_OK;
+    } else {
+        ESP_LOGE(TAG, "Unexpected HTTP status %d", status);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    d->file = fopen(d->cfg->path, mode);
+    if (d->file == NULL) {
+        ESP_LOGE(TAG, "Cannot open %s", d->cfg->path);
+        return ESP_FAIL;
+    }
+    // Buffers are already cluster sized, stdio buffering would only copy
+    setvbuf(d->file, NULL, _IONBF, 0);
+
+    d->offset = d->res.resumed_from;
+    take_buffer(d);
+    return ESP_OK;
+}
+
+static esp_err_t dl_data(void *ctx, const uint8_t *data, size_t len) {
+    dl_t *d = (dl_t *)ctx;
+    if (d->already_complete) {
+        return ESP_OK;
+    }
+    if (d->write_err != ESP_OK) {
+        return d->write_err;
+    }
+    if (d->first_data_us == 0) {
+        d->first_data_us = esp_timer_get_time();
+    }
+
+    while (len > 0) {
+        size_t n = d->cur_cap - d->cur_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(d->bufs[d->cur] + d->cur_len, data, n);
+        d->cur_len += n;
+        d->offset += n;
+        d->res.bytes += n;
+        data += n;
+        len -= n;
+
+        if (d->cur_len == d->cur_cap) {
+            submit_buffer(d);
+            take_buffer(d);
+
+            if (d->cfg->progress != NULL && d->offset >= d->next_progress) {
+                d->cfg->progress(d->cfg->ctx, d->offset, d->res.total);
+                d->next_progress = d->offset + 4 * d->cfg->buffer_size;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static void dl_end(void *ctx, esp_err_t result) {
+    dl_t *d = (dl_t *)ctx;
+    // Keep whatever arrived, even on error, so the download can be resumed
+    if (d->cur >= 0 && d->cur_len > 0) {
+        submit_buffer(d);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t http_download(const http_download_config_t *cfg, http_download_result_t *out) {
+    if (cfg == NULL || cfg->url == NULL || cfg->path == NULL ||
+        cfg->buffer_count < HTTP_DOWNLOAD_MIN_BUFFERS ||
+        cfg->buffer_count > HTTP_DOWNLOAD_MAX_BUFFERS || cfg->buffer_size == 0 ||
+        cfg->buffer_size % 4096 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    dl_t *d = (dl_t *)calloc(1, sizeof(dl_t));
+    if (d == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    d->cfg = cfg;
+    d->cur = -1;
+    d->range_total = -1;
+    d->res.total = -1;
+
+    esp_err_t err = ESP_OK;
+    d->free_q = xQueueCreate(cfg->buffer_count, sizeof(int));
+    d->full_q = xQueueCreate(cfg->buffer_count + 1, sizeof(dl_chunk_t));
+    d->writer_done = xSemaphoreCreateBinary();
+    if (d->free_q == NULL || d->full_q == NULL || d->writer_done == NULL) {
+        err = ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; err == ESP_OK && i < cfg->buffer_count; i++) {
+        d->bufs[i] = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, cfg->buffer_size,
+                                                        MALLOC_CAP_DMA);
+        if (d->bufs[i] == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        xQueueSend(d->free_q, &i, 0);
+    }
+    if (err == ESP_OK && xTaskCreate(writer_task, "sd_writer", WRITER_STACK_SIZE, d,
+                                     WRITER_PRIORITY, NULL) != pdPASS) {
+        err = ESP_ERR_NO_MEM;
+    }
+
+    if (err == ESP_OK) {
+        // Resume from the size of an existing partial file
+        char range[40];
+        http_pool_header_t range_header = {"Range", range};
+        struct stat st;
+        if (cfg->resume && stat(cfg->path, &st) == 0 && st.st_size > 0) {
+            d->res.resumed_from = st.st_size;
+            d->offset = st.st_size;
+            snprintf(range, sizeof(range), "bytes=%lld-", (long long)st.st_size);
+            ESP_LOGI(TAG, "Resuming %s at %lld bytes", cfg->path, (long long)st.st_size);
+        }
+
+        http_body_sink_t sink = {};
+        sink.on_begin = dl_begin;
+        sink.on_data = dl_data;
+        sink.on_end = dl_end;
+        sink.ctx = d;
+
+        http_pool_request_t req = {};
+        req.url = cfg->url;
+        req.method = HTTP_METHOD_GET;
+        req.event_handler = dl_event_handler;
+        req.user_data = d;
+        req.sink = &sink;
+        req.timeout_ms = cfg->timeout_ms;
+        if (d->res.resumed_from > 0) {
+            req.headers = &range_header;
+            req.header_count = 1;
+        }
+
+        int64_t start = esp_timer_get_time();
+        http_pool_result_t pres = {};
+        err = http_pool_perform(&req, &pres);
+
+        // Drain the writer
+        dl_chunk_t stop = {-1, 0};
+        xQueueSend(d->full_q, &stop, portMAX_DELAY);
+        xSemaphoreTake(d->writer_done, portMAX_DELAY);
+        if (d->file != NULL && fclose(d->file) != 0 && d->write_err == ESP_OK) {
+            d->write_err = ESP_FAIL;
+        }
+        d->res.elapsed_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+        if (err == ESP_OK) {
+            err = d->write_err;
+        }
+        if (err == ESP_OK && d->res.total >= 0 && !d->already_complete &&
+            d->offset != d->res.total) {
+            err = ESP_FAIL;
+        }
+        d->res.status = d->status;
+        if (d->res.elapsed_ms > 0) {
+            d->res.kb_per_s = (uint32_t)(d->res.bytes * 1000 / 1024 / d->res.elapsed_ms);
+        }
+
+        ESP_LOGI(TAG, "%s: %lld bytes in %lu ms (%lu KB/s), %lu writes, write %lu ms, "
+                 "net stalled %lu ms, writer idle %lu ms: %s",
+                 cfg->path, (long long)d->res.bytes, (unsigned long)d->res.elapsed_ms,
+                 (unsigned long)d->res.kb_per_s, (unsigned long)d->res.writes,
+                 (unsigned long)d->res.write_ms, (unsigned long)d->res.net_stall_ms,
+                 (unsigned long)d->res.writer_idle_ms, esp_err_to_name(err));
+        if (cfg->progress != NULL && err == ESP_OK) {
+            cfg->progress(cfg->ctx, d->offset, d->res.total);
+        }
+    }
+
+    if (out != NULL) {
+        *out = d->res;
+    }
+
+    for (int i = 0; i < HTTP_DOWNLOAD_MAX_BUFFERS; i++) {
+        heap_caps_free(d->bufs[i]);
+    }
+    if (d->free_q != NULL) {
+        vQueueDelete(d->free_q);
+    }
+    if (d->full_q != NULL) {
+        vQueueDelete(d->full_q);
+    }
+    if (d->writer_done != NULL) {
+        vSemaphoreDelete(d->writer_done);
+    }
+    free(d);
+    return err;
+}
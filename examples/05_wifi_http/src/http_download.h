@@ -0,0 +1,102 @@
+/**
+ * @file http_download.h
+ * @brief Download a file to the SD card with overlapped network/SD stages
+ *
+ * The response body is copied into a ring of DMA-capable buffers. Full
+ * buffers are handed to a writer task that flushes them to FAT while the
+ * network side fills the next one, so receiving and writing overlap
+ * instead of alternating. Writes are whole buffers at buffer-aligned file
+ * offsets (one partial write at the start of a resumed download and one
+ * at the end), which keeps FATFS on its multi-sector path.
+ *
+ * An interrupted download can be resumed with a Range request; if the
+ * server ignores the range the file is rewritten from the start.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Limits for the buffer ring
+#define HTTP_DOWNLOAD_MIN_BUFFERS 2
+#define HTTP_DOWNLOAD_MAX_BUFFERS 4
+
+/**
+ * @brief Progress callback, called from the downloading task
+ *
+ * @param ctx: User context
+ * @param received: Bytes of the file present so far (including a resumed part)
+ * @param total: File size, or -1 if unknown
+ */
+typedef void (*http_download_progress_cb_t)(void *ctx, int64_t received, int64_t total);
+
+/**
+ * @brief Download parameters
+ */
+typedef struct {
+    const char *url;
+    const char *path;             // Destination file on a mounted FAT volume
+    int buffer_count;             // HTTP_DOWNLOAD_MIN_BUFFERS..HTTP_DOWNLOAD_MAX_BUFFERS
+    size_t buffer_size;           // Multiple of 4096, e.g. the cluster size
+    bool resume;                  // Continue an existing partial file
+    int timeout_ms;               // Network timeout per read
+    http_download_progress_cb_t progress;  // Can be NULL
+    void *ctx;
+} http_download_config_t;
+
+#define HTTP_DOWNLOAD_CONFIG_DEFAULT() {  \
+    .url = NULL,                          \
+    .path = NULL,                         \
+    .buffer_count = 3,                    \
+    .buffer_size = 32 * 1024,             \
+    .resume = true,                       \
+    .timeout_ms = 10000,                  \
+    .progress = NULL,                     \
+    .ctx = NULL,                          \
+}
+
+/**
+ * @brief Download statistics
+ */
+typedef struct {
+    int status;              // HTTP status (200 or 206)
+    int64_t total;           // File size, -1 if unknown
+    int64_t resumed_from;    // Bytes already present before this run
+    int64_t bytes;           // Bytes received in this run
+    uint32_t elapsed_ms;
+    uint32_t kb_per_s;       // Sustained throughput of this run
+    uint32_t net_stall_ms;   // Network side waiting for a free buffer (SD bound)
+    uint32_t writer_idle_ms; // Writer waiting for data (network bound)
+    uint32_t write_ms;       // Time spent in fwrite
+    uint32_t writes;
+} http_download_result_t;
+
+/**
+ * @brief Download a URL to a file (blocking)
+ *
+ * Runs on the calling task; the SD writer runs on its own task for the
+ * duration of the download.
+ *
+ * @param config: Download parameters
+ * @param out: Statistics, can be NULL
+ *
+ * @return
+ *    - ESP_OK: File complete
+ *    - ESP_ERR_INVALID_ARG: Bad configuration
+ *    - ESP_ERR_NO_MEM: Buffer or task allocation failed
+ *    - ESP_ERR_INVALID_RESPONSE: Unexpected HTTP status
+ *    - ESP_FAIL: File I/O error
+ *    - Others: Network error from the client pool
+ */
+esp_err_t http_download(const http_download_config_t *config, http_download_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
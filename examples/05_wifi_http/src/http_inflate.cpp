@@ -0,0 +1,700 @@
+/**
+ * @file http_inflate.cpp
+ * @brief Streaming gzip/zlib/deflate decoder for Content-Encoding
+ *
+ * A resumable state machine over RFC 1951. Huffman codes are decoded
+ * canonically, one bit length at a time, which needs only the count and
+ * symbol tables and makes it easy to stop at any input boundary: a code
+ * that is not complete yet leaves its bits in the bit buffer and is
+ * decoded again once more input arrives.
+ */
+
+#include "http_inflate.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+
+#define MAX_BITS    15
+#define MAX_LCODES  286
+#define MAX_DCODES  30
+#define FIX_LCODES  288
+#define WINDOW_MASK (HTTP_INFLATE_WINDOW_SIZE - 1)
+
+/**
+ * @brief Canonical Huffman code: number of codes per length, sorted symbols
+ */
+typedef struct {
+    int16_t count[MAX_BITS + 1];
+    int16_t symbol[FIX_LCODES];
+} huffman_t;
+
+typedef enum {
+    // Wrapper headers
+    ST_GZIP_HEADER,
+    ST_GZIP_EXTRA_LEN,
+    ST_GZIP_EXTRA,
+    ST_GZIP_NAME,
+    ST_GZIP_COMMENT,
+    ST_GZIP_HCRC,
+    ST_ZLIB_HEADER,
+
+    // Deflate blocks
+    ST_BLOCK,
+    ST_STORED_LEN,
+    ST_STORED_COPY,
+    ST_TABLE,
+    ST_CODE_LENS,
+    ST_LENS,
+    ST_LENS_REPEAT,
+    ST_CODES,
+    ST_LEN_EXTRA,
+    ST_DIST,
+    ST_DIST_EXTRA,
+
+    // Trailer
+    ST_TRAILER,
+    ST_DONE,
+} inflate_state_t;
+
+struct http_inflate {
+    http_inflate_format_t format;
+    inflate_state_t state;
+    esp_err_t error;
+    bool zlib;           // Deflate stream has a zlib wrapper (else raw)
+    bool last_block;
+
+    http_inflate_out_cb_t out;
+    void *ctx;
+
+    // Input of the current feed call
+    const uint8_t *in;
+    size_t in_len;
+    uint32_t bitbuf;
+    uint8_t bitcnt;
+
+    // Header parsing
+    uint8_t hdr[10];
+    uint8_t hdr_have;
+    uint8_t gzip_flags;
+    uint16_t skip;
+
+    // Dynamic table construction
+    uint16_t nlen;
+    uint16_t ndist;
+    uint16_t ncode;
+    uint16_t have;
+    uint16_t sym;
+    uint8_t lens[MAX_LCODES + MAX_DCODES];
+
+    // Current match / stored block
+    uint16_t length;
+    uint16_t stored_left;
+
+    huffman_t lencode;
+    huffman_t distcode;
+
+    // History window; decoded bytes are written here and flushed to out
+    uint8_t *window;
+    uint32_t wpos;
+    uint32_t wflushed;   // Start of the not yet flushed part of the window
+    uint32_t whave;      // Valid history, up to the window size
+
+    uint32_t crc;        // CRC-32 (gzip) of flushed output
+    uint32_t adler_a;    // Adler-32 (zlib) of flushed output
+    uint32_t adler_b;
+    uint32_t total_out;
+};
+
+// Length/distance base values and extra bits (RFC 1951 3.2.5)
+static const uint16_t len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+                                      258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                       6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order of code length code lengths
+static const uint8_t clen_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+                                       11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// ============================================================================
+// Bit input
+// ============================================================================
+
+/**
+ * @brief Make at least n bits available
+ *
+ * @return false if the input ran out first (bits gathered so far are kept)
+ */
+static bool need_bits(http_inflate_t *p, uint8_t n) {
+    while (p->bitcnt < n) {
+        if (p->in_len == 0) {
+            return false;
+        }
+        p->bitbuf |= (uint32_t)*p->in++ << p->bitcnt;
+        p->bitcnt += 8;
+        p->in_len--;
+    }
+    return true;
+}
+
+static uint32_t get_bits(http_inflate_t *p, uint8_t n) {
+    uint32_t v = p->bitbuf & ((1UL << n) - 1);
+    p->bitbuf >>= n;
+    p->bitcnt -= n;
+    return v;
+}
+
+static bool need_byte(http_inflate_t *p, uint8_t *b) {
+    if (!need_bits(p, 8)) {
+        return false;
+    }
+    *b = (uint8_t)get_bits(p, 8);
+    return true;
+}
+
+/**
+ * @brief Decode one symbol
+ *
+ * @return Symbol, -1 if more input is needed, -2 for an invalid code
+ */
+static int decode(http_inflate_t *p, const huffman_t *h) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= MAX_BITS; len++) {
+        if (!need_bits(p, len)) {
+            return -1;
+        }
+        code |= (p->bitbuf >> (len - 1)) & 1;
+        int count = h->count[len];
+        if (code - count < first) {
+            get_bits(p, len);
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+/**
+ * @brief Build a canonical code from code lengths
+ *
+ * @return false if the lengths over-subscribe the code space
+ */
+static bool build(huffman_t *h, const uint8_t *lengths, int n) {
+    memset(h->count, 0, sizeof(h->count));
+    for (int i = 0; i < n; i++) {
+        h->count[lengths[i]]++;
+    }
+    if (h->count[0] == n) {
+        return true;  // No codes: only an error if a symbol is ever decoded
+    }
+
+    int left = 1;
+    for (int len = 1; len <= MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    int16_t offs[MAX_BITS + 1];
+    offs[1] = 0;
+    for (int len = 1; len < MAX_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (int i = 0; i < n; i++) {
+        if (lengths[i] != 0) {
+            h->symbol[offs[lengths[i]]++] = i;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+static void adler_update(http_inflate_t *p, const uint8_t *data, size_t len) {
+    uint32_t a = p->adler_a;
+    uint32_t b = p->adler_b;
+    while (len > 0) {
+        size_t n = len < 5552 ? len : 5552;  // Largest n without 32-bit overflow
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    p->adler_a = a;
+    p->adler_b = b;
+}
+
+/**
+ * @brief Pass the unflushed part of the window to the output callback
+ */
+static esp_err_t flush(http_inflate_t *p) {
+    uint32_t n = p->wpos - p->wflushed;
+    if (n == 0) {
+        return ESP_OK;
+    }
+    const uint8_t *data = p->window + p->wflushed;
+    if (p->format == HTTP_INFLATE_GZIP) {
+        p->crc = esp_rom_crc32_le(p->crc, data, n);
+    } else if (p->zlib) {
+        adler_update(p, data, n);
+    }
+    p->wflushed = p->wpos;
+    return p->out(p->ctx, data, n);
+}
+
+static esp_err_t put_byte(http_inflate_t *p, uint8_t b) {
+    p->window[p->wpos++] = b;
+    p->total_out++;
+    if (p->whave < HTTP_INFLATE_WINDOW_SIZE) {
+        p->whave++;
+    }
+    if (p->wpos == HTTP_INFLATE_WINDOW_SIZE) {
+        esp_err_t err = flush(p);
+        p->wpos = 0;
+        p->wflushed = 0;
+        return err;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Decoder
+// ============================================================================
+
+static void fixed_tables(http_inflate_t *p) {
+    uint8_t lengths[FIX_LCODES];
+    int i = 0;
+    for (; i < 144; i++) {
+        lengths[i] = 8;
+    }
+    for (; i < 256; i++) {
+        lengths[i] = 9;
+    }
+    for (; i < 280; i++) {
+        lengths[i] = 7;
+    }
+    for (; i < FIX_LCODES; i++) {
+        lengths[i] = 8;
+    }
+    build(&p->lencode, lengths, FIX_LCODES);
+    for (i = 0; i < MAX_DCODES; i++) {
+        lengths[i] = 5;
+    }
+    build(&p->distcode, lengths, MAX_DCODES);
+}
+
+/**
+ * @brief Advance the state machine until the input is exhausted
+ *
+ * @return ESP_OK when more input is needed (or the stream is done)
+ */
+static esp_err_t run(http_inflate_t *p) {
+    esp_err_t err;
+    uint8_t b;
+    int sym;
+
+    while (1) {
+        switch (p->state) {
+            case ST_GZIP_HEADER:
+                while (p->hdr_have < 10) {
+                    if (!need_byte(p, &b)) {
+                        return ESP_OK;
+                    }
+                    p->hdr[p->hdr_have++] = b;
+                }
+                // Magic, CM = deflate, no reserved flags
+                if (p->hdr[0] != 0x1f || p->hdr[1] != 0x8b || p->hdr[2] != 8 ||
+                    (p->hdr[3] & 0xe0) != 0) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->gzip_flags = p->hdr[3];
+                p->hdr_have = 0;
+                p->state = ST_GZIP_EXTRA_LEN;
+                break;
+
+            case ST_GZIP_EXTRA_LEN:
+                if (p->gzip_flags & 0x04) {  // FEXTRA
+                    if (!need_bits(p, 16)) {
+                        return ESP_OK;
+                    }
+                    p->skip = (uint16_t)get_bits(p, 16);
+                }
+                p->state = ST_GZIP_EXTRA;
+                break;
+
+            case ST_GZIP_EXTRA:
+                while (p->skip > 0) {
+                    if (!need_byte(p, &b)) {
+                        return ESP_OK;
+                    }
+                    p->skip--;
+                }
+                p->state = ST_GZIP_NAME;
+                break;
+
+            case ST_GZIP_NAME:
+            case ST_GZIP_COMMENT: {
+                uint8_t flag = p->state == ST_GZIP_NAME ? 0x08 : 0x10;  // FNAME / FCOMMENT
+                if (p->gzip_flags & flag) {
+                    do {
+                        if (!need_byte(p, &b)) {
+                            return ESP_OK;
+                        }
+                    } while (b != 0);
+                }
+                p->state = p->state == ST_GZIP_NAME ? ST_GZIP_COMMENT : ST_GZIP_HCRC;
+                break;
+            }
+
+            case ST_GZIP_HCRC:
+                if (p->gzip_flags & 0x02) {  // FHCRC
+                    if (!need_bits(p, 16)) {
+                        return ESP_OK;
+                    }
+                    get_bits(p, 16);
+                }
+                p->state = ST_BLOCK;
+                break;
+
+            case ST_ZLIB_HEADER:
+                if (!need_bits(p, 16)) {
+                    return ESP_OK;
+                }
+                {
+                    uint8_t cmf = p->bitbuf & 0xff;
+                    uint8_t flg = (p->bitbuf >> 8) & 0xff;
+                    // "deflate" is supposed to be zlib wrapped, but some
+                    // servers send raw deflate: only strip a valid header
+                    p->zlib = (cmf & 0x0f) == 8 && (cmf >> 4) <= 7 &&
+                              ((cmf << 8) | flg) % 31 == 0 && !(flg & 0x20);
+                    if (p->zlib) {
+                        get_bits(p, 16);
+                    }
+                }
+                p->state = ST_BLOCK;
+                break;
+
+            case ST_BLOCK:
+                if (!need_bits(p, 3)) {
+                    return ESP_OK;
+                }
+                p->last_block = get_bits(p, 1);
+                switch (get_bits(p, 2)) {
+                    case 0:
+                        get_bits(p, p->bitcnt & 7);  // Align to a byte
+                        p->state = ST_STORED_LEN;
+                        break;
+                    case 1:
+                        fixed_tables(p);
+                        p->state = ST_CODES;
+                        break;
+                    case 2:
+                        p->state = ST_TABLE;
+                        break;
+                    default:
+                        return ESP_ERR_INVALID_RESPONSE;
+                }
+                break;
+
+            case ST_STORED_LEN: {
+                // Byte aligned here, so 32 bits fit the bit buffer
+                if (!need_bits(p, 32)) {
+                    return ESP_OK;
+                }
+                p->stored_left = (uint16_t)get_bits(p, 16);
+                uint16_t nlen = (uint16_t)get_bits(p, 16);
+                if (nlen != (uint16_t)~p->stored_left) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->state = ST_STORED_COPY;
+                break;
+            }
+
+            case ST_STORED_COPY:
+                while (p->stored_left > 0) {
+                    if (!need_byte(p, &b)) {
+                        return ESP_OK;
+                    }
+                    if ((err = put_byte(p, b)) != ESP_OK) {
+                        return err;
+                    }
+                    p->stored_left--;
+                }
+                p->state = p->last_block ? ST_TRAILER : ST_BLOCK;
+                break;
+
+            case ST_TABLE:
+                if (!need_bits(p, 14)) {
+                    return ESP_OK;
+                }
+                p->nlen = get_bits(p, 5) + 257;
+                p->ndist = get_bits(p, 5) + 1;
+                p->ncode = get_bits(p, 4) + 4;
+                if (p->nlen > MAX_LCODES || p->ndist > MAX_DCODES) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->have = 0;
+                p->state = ST_CODE_LENS;
+                break;
+
+            case ST_CODE_LENS:
+                while (p->have < p->ncode) {
+                    if (!need_bits(p, 3)) {
+                        return ESP_OK;
+                    }
+                    p->lens[clen_order[p->have++]] = get_bits(p, 3);
+                }
+                while (p->have < 19) {
+                    p->lens[clen_order[p->have++]] = 0;
+                }
+                // The code length code temporarily lives in lencode
+                if (!build(&p->lencode, p->lens, 19)) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->have = 0;
+                p->state = ST_LENS;
+                break;
+
+            case ST_LENS:
+                while (p->have < p->nlen + p->ndist) {
+                    sym = decode(p, &p->lencode);
+                    if (sym == -1) {
+                        return ESP_OK;
+                    }
+                    if (sym < 0) {
+                        return ESP_ERR_INVALID_RESPONSE;
+                    }
+                    if (sym < 16) {
+                        p->lens[p->have++] = sym;
+                    } else {
+                        if (sym == 16 && p->have == 0) {
+                            return ESP_ERR_INVALID_RESPONSE;  // Nothing to repeat
+                        }
+                        p->sym = sym;
+                        p->state = ST_LENS_REPEAT;
+                        break;
+                    }
+                }
+                if (p->state == ST_LENS_REPEAT) {
+                    break;
+                }
+                if (p->lens[256] == 0) {
+                    return ESP_ERR_INVALID_RESPONSE;  // No end-of-block code
+                }
+                if (!build(&p->lencode, p->lens, p->nlen) ||
+                    !build(&p->distcode, p->lens + p->nlen, p->ndist)) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->state = ST_CODES;
+                break;
+
+            case ST_LENS_REPEAT: {
+                uint8_t bits = p->sym == 16 ? 2 : p->sym == 17 ? 3 : 7;
+                if (!need_bits(p, bits)) {
+                    return ESP_OK;
+                }
+                uint8_t len = 0;
+                uint16_t repeat;
+                if (p->sym == 16) {
+                    len = p->lens[p->have - 1];
+                    repeat = 3 + get_bits(p, 2);
+                } else if (p->sym == 17) {
+                    repeat = 3 + get_bits(p, 3);
+                } else {
+                    repeat = 11 + get_bits(p, 7);
+                }
+                if (p->have + repeat > p->nlen + p->ndist) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                while (repeat--) {
+                    p->lens[p->have++] = len;
+                }
+                p->state = ST_LENS;
+                break;
+            }
+
+            case ST_CODES:
+                while (1) {
+                    sym = decode(p, &p->lencode);
+                    if (sym == -1) {
+                        return ESP_OK;
+                    }
+                    if (sym < 0) {
+                        return ESP_ERR_INVALID_RESPONSE;
+                    }
+                    if (sym < 256) {
+                        if ((err = put_byte(p, sym)) != ESP_OK) {
+                            return err;
+                        }
+                        continue;
+                    }
+                    break;
+                }
+                if (sym == 256) {
+                    p->state = p->last_block ? ST_TRAILER : ST_BLOCK;
+                    break;
+                }
+                sym -= 257;
+                if (sym >= 29) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->sym = sym;
+                p->state = ST_LEN_EXTRA;
+                break;
+
+            case ST_LEN_EXTRA:
+                if (!need_bits(p, len_extra[p->sym])) {
+                    return ESP_OK;
+                }
+                p->length = len_base[p->sym] + get_bits(p, len_extra[p->sym]);
+                p->state = ST_DIST;
+                break;
+
+            case ST_DIST:
+                sym = decode(p, &p->distcode);
+                if (sym == -1) {
+                    return ESP_OK;
+                }
+                if (sym < 0 || sym >= MAX_DCODES) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                p->sym = sym;
+                p->state = ST_DIST_EXTRA;
+                break;
+
+            case ST_DIST_EXTRA: {
+                if (!need_bits(p, dist_extra[p->sym])) {
+                    return ESP_OK;
+                }
+                uint32_t dist = dist_base[p->sym] + get_bits(p, dist_extra[p->sym]);
+                if (dist > p->whave) {
+                    return ESP_ERR_INVALID_RESPONSE;  // Before the start of the output
+                }
+                // Copying needs no input, so the match completes here
+                for (uint16_t i = 0; i < p->length; i++) {
+                    err = put_byte(p, p->window[(p->wpos - dist) & WINDOW_MASK]);
+                    if (err != ESP_OK) {
+                        return err;
+                    }
+                }
+                p->state = ST_CODES;
+                break;
+            }
+
+            case ST_TRAILER: {
+                // Flush first so the checksum covers all output
+                if ((err = flush(p)) != ESP_OK) {
+                    return err;
+                }
+                if (p->format == HTTP_INFLATE_DEFLATE && !p->zlib) {
+                    p->state = ST_DONE;
+                    break;
+                }
+                get_bits(p, p->bitcnt & 7);
+                uint8_t need = p->format == HTTP_INFLATE_GZIP ? 8 : 4;
+                while (p->hdr_have < need) {
+                    if (!need_byte(p, &b)) {
+                        return ESP_OK;
+                    }
+                    p->hdr[p->hdr_have++] = b;
+                }
+                if (p->format == HTTP_INFLATE_GZIP) {
+                    uint32_t crc = p->hdr[0] | (p->hdr[1] << 8) | (p->hdr[2] << 16) |
+                                   ((uint32_t)p->hdr[3] << 24);
+                    uint32_t isize = p->hdr[4] | (p->hdr[5] << 8) | (p->hdr[6] << 16) |
+                                     ((uint32_t)p->hdr[7] << 24);
+                    if (crc != p->crc || isize != p->total_out) {
+                        return ESP_ERR_INVALID_RESPONSE;
+                    }
+                } else {
+                    uint32_t adler = ((uint32_t)p->hdr[0] << 24) | (p->hdr[1] << 16) |
+                                     (p->hdr[2] << 8) | p->hdr[3];
+                    if (adler != ((p->adler_b << 16) | p->adler_a)) {
+                        return ESP_ERR_INVALID_RESPONSE;
+                    }
+                }
+                p->state = ST_DONE;
+                break;
+            }
+
+            case ST_DONE:
+                // Trailing bytes after the stream are ignored
+                p->in_len = 0;
+                return ESP_OK;
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+http_inflate_t *http_inflate_create(http_inflate_format_t format, http_inflate_out_cb_t out,
+                                    void *ctx) {
+    http_inflate_t *p = (http_inflate_t *)calloc(1, sizeof(http_inflate_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    p->window = (uint8_t *)heap_caps_malloc(HTTP_INFLATE_WINDOW_SIZE, MALLOC_CAP_SPIRAM);
+    if (p->window == NULL) {
+        free(p);
+        return NULL;
+    }
+    p->format = format;
+    p->state = format == HTTP_INFLATE_GZIP ? ST_GZIP_HEADER : ST_ZLIB_HEADER;
+    p->out = out;
+    p->ctx = ctx;
+    p->adler_a = 1;
+    return p;
+}
+
+esp_err_t http_inflate_feed(http_inflate_t *p, const uint8_t *data, size_t len) {
+    if (p->error != ESP_OK) {
+        return p->error;
+    }
+    p->in = data;
+    p->in_len = len;
+    esp_err_t err = run(p);
+    if (err == ESP_OK) {
+        err = flush(p);
+    }
+    p->error = err;
+    return err;
+}
+
+esp_err_t http_inflate_finish(http_inflate_t *p) {
+    if (p->error != ESP_OK) {
+        return p->error;
+    }
+    return p->state == ST_DONE ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+uint32_t http_inflate_total_out(const http_inflate_t *p) {
+    return p->total_out;
+}
+
+void http_inflate_destroy(http_inflate_t *p) {
+    if (p != NULL) {
+        free(p->window);
+        free(p);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * @file http_inflate.h
+ * @brief Streaming gzip/zlib/deflate decoder for Content-Encoding
+ *
+ * Decodes a compressed body fed in arbitrary chunks and passes the
+ * decompressed bytes on as they are produced. The only large allocation
+ * is the 32 KB history window deflate requires, placed in PSRAM; the
+ * decoder state itself is about 2 KB. Every input byte is consumed on each
+ * call, so the decoder never holds back input.
+ *
+ * The gzip CRC-32 / zlib Adler-32 trailer is verified.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// History window required by deflate
+#define HTTP_INFLATE_WINDOW_SIZE 32768
+
+/**
+ * @brief Container format of the compressed stream
+ */
+typedef enum {
+    HTTP_INFLATE_GZIP,     // Content-Encoding: gzip (RFC 1952)
+    HTTP_INFLATE_DEFLATE,  // Content-Encoding: deflate, zlib wrapped or raw
+} http_inflate_format_t;
+
+/**
+ * @brief Receives decompressed data
+ *
+ * @return ESP_OK to continue, anything else aborts decoding
+ */
+typedef esp_err_t (*http_inflate_out_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+// Opaque decoder state
+typedef struct http_inflate http_inflate_t;
+
+/**
+ * @brief Create a decoder
+ *
+ * @param format: Container format
+ * @param out: Output callback
+ * @param ctx: Passed to out
+ *
+ * @return Decoder, or NULL if out of memory
+ */
+http_inflate_t *http_inflate_create(http_inflate_format_t format, http_inflate_out_cb_t out,
+                                    void *ctx);
+
+/**
+ * @brief Decode the next chunk of compressed input
+ *
+ * @return
+ *    - ESP_OK: Chunk consumed
+ *    - ESP_ERR_INVALID_RESPONSE: Corrupt stream or checksum mismatch
+ *    - Others: Error returned by the output callback
+ */
+esp_err_t http_inflate_feed(http_inflate_t *inf, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check the stream ended cleanly after the last chunk
+ *
+ * @return
+ *    - ESP_OK: Complete stream with a valid trailer
+ *    - ESP_ERR_INVALID_STATE: Input ended mid-stream
+ *    - Others: Error reported earlier by http_inflate_feed
+ */
+esp_err_t http_inflate_finish(http_inflate_t *inf);
+
+/**
+ * @brief Decompressed bytes produced so far
+ */
+uint32_t http_inflate_total_out(const http_inflate_t *inf);
+
+/**
+ * @brief Free a decoder
+ */
+void http_inflate_destroy(http_inflate_t *inf);
+
+#ifdef __cplusplus
+}
+#endif
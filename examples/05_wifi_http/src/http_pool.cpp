@@ -0,0 +1,592 @@
+/**
+ * @file http_pool.cpp
+ * @brief Keep-alive HTTP client pool keyed by host
+ */
+
+#include "http_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "http_inflate.h"
+
+static const char *TAG = "http_pool";
+
+#define HOST_KEY_LEN 96
+
+#define ACCEPT_ENCODING "gzip, deflate"
+
+// Content-Encoding of the current response
+typedef enum {
+    ENCODING_IDENTITY,
+    ENCODING_GZIP,
+    ENCODING_DEFLATE,
+    ENCODING_UNSUPPORTED,
+} encoding_t;
+
+/**
+ * @brief One pooled client
+ */
+typedef struct {
+    esp_http_client_handle_t client;
+    uint8_t *rx_buf;               // Body buffer handed to sinks, reused
+    char key[HOST_KEY_LEN];        // "scheme://host:port"
+    bool in_use;
+    bool dormant;                  // Connection closed, client kept for its TLS session
+    bool tls_session;              // A handshake succeeded, the next one can resume
+    int64_t last_used_us;
+    uint32_t requests;
+
+    // Per-request routing for the shared event handler
+    http_event_handle_cb handler;
+    void *user_data;
+
+    http_trace_t trace;            // Phase timestamps of the current request
+    encoding_t encoding;
+} pool_slot_t;
+
+/**
+ * @brief Routes inflated output to the request's sink
+ */
+typedef struct {
+    const http_body_sink_t *sink;
+    http_pool_result_t *res;
+    int64_t sink_us;               // Time spent in the sink, not decoding
+} inflate_ctx_t;
+
+static pool_slot_t slots[HTTP_POOL_SIZE];
+static http_pool_stats_t stats = {};
+static SemaphoreHandle_t pool_mutex = NULL;
+
+/**
+ * @brief Build the pool key ("scheme://host:port") from a URL
+ */
+static bool url_to_key(const char *url, char *key, size_t key_len) {
+    const char *sep = strstr(url, "://");
+    if (sep == NULL) {
+        return false;
+    }
+
+    size_t scheme_len = sep - url;
+    bool https = (scheme_len == 5 && strncmp(url, "https", 5) == 0);
+    if (!https && !(scheme_len == 4 && strncmp(url, "http", 4) == 0)) {
+        return false;
+    }
+
+    const char *host = sep + 3;
+    size_t host_len = strcspn(host, ":/?#");
+    if (host_len == 0) {
+        return false;
+    }
+
+    int port = https ? 443 : 80;
+    if (host[host_len] == ':') {
+        port = atoi(host + host_len + 1);
+    }
+
+    int n = snprintf(key, key_len, "%.*s://%.*s:%d", (int)scheme_len, url, (int)host_len,
+                     host, port);
+    return n > 0 && (size_t)n < key_len;
+}
+
+/**
+ * @brief Split a pool key into host and port
+ */
+static void key_to_host(const char *key, char *host, size_t host_len, int *port) {
+    const char *start = strstr(key, "://") + 3;
+    const char *colon = strrchr(start, ':');
+    size_t n = colon - start;
+    if (n >= host_len) {
+        n = host_len - 1;
+    }
+    memcpy(host, start, n);
+    host[n] = '\0';
+    *port = atoi(colon + 1);
+}
+
+/**
+ * @brief Event handler installed on every pooled client
+ *
+ * Timestamps the request phases and forwards events to the handler of the
+ * request currently using the slot.
+ */
+static esp_err_t pool_event_handler(esp_http_client_event_t *evt) {
+    pool_slot_t *slot = (pool_slot_t *)evt->user_data;
+    if (slot == NULL) {
+        return ESP_OK;
+    }
+
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            slot->trace.connected_us = esp_timer_get_time();
+            break;
+        case HTTP_EVENT_HEADERS_SENT:
+            // Also after a redirect: time to first byte of the final response
+            slot->trace.sent_us = esp_timer_get_time();
+            slot->trace.first_byte_us = 0;
+            slot->encoding = ENCODING_IDENTITY;
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            if (slot->trace.first_byte_us == 0) {
+                slot->trace.first_byte_us = esp_timer_get_time();
+            }
+            if (strcasecmp(evt->header_key, "Content-Encoding") == 0) {
+                if (strcasecmp(evt->header_value, "gzip") == 0 ||
+                    strcasecmp(evt->header_value, "x-gzip") == 0) {
+                    slot->encoding = ENCODING_GZIP;
+                } else if (strcasecmp(evt->header_value, "deflate") == 0) {
+                    slot->encoding = ENCODING_DEFLATE;
+                } else if (strcasecmp(evt->header_value, "identity") != 0) {
+                    slot->encoding = ENCODING_UNSUPPORTED;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (slot->handler == NULL) {
+        return ESP_OK;
+    }
+
+    evt->user_data = slot->user_data;
+    esp_err_t ret = slot->handler(evt);
+    evt->user_data = slot;
+    return ret;
+}
+
+static void slot_destroy(pool_slot_t *slot) {
+    if (slot->client != NULL) {
+        esp_http_client_cleanup(slot->client);
+    }
+    free(slot->rx_buf);
+    memset(slot, 0, sizeof(*slot));
+}
+
+esp_err_t http_pool_init(void) {
+    if (pool_mutex == NULL) {
+        pool_mutex = xSemaphoreCreateMutex();
+        if (pool_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    return http_trace_init();
+}
+
+/**
+ * @brief Reserve a slot for the key, reusing an idle client when possible
+ *
+ * A dormant client for the key is reused too (a new connection that can
+ * resume its TLS session), but *reused only reports a warm connection.
+ * Must be called with the pool mutex held.
+ */
+static pool_slot_t *slot_acquire(const char *key, bool *reused) {
+    pool_slot_t *free_slot = NULL;
+    pool_slot_t *victim = NULL;  // Dormant clients go first, then the least recently used
+
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        pool_slot_t *s = &slots[i];
+        if (s->in_use) {
+            continue;
+        }
+        if (s->client == NULL) {
+            if (free_slot == NULL) {
+                free_slot = s;
+            }
+            continue;
+        }
+        if (strcmp(s->key, key) == 0) {
+            s->in_use = true;
+            *reused = !s->dormant;
+            s->dormant = false;
+            return s;
+        }
+        if (victim == NULL || (s->dormant && !victim->dormant) ||
+            (s->dormant == victim->dormant && s->last_used_us < victim->last_used_us)) {
+            victim = s;
+        }
+    }
+
+    if (free_slot == NULL && victim != NULL) {
+        ESP_LOGI(TAG, "Evicting %s to make room for %s", victim->key, key);
+        slot_destroy(victim);
+        stats.evictions++;
+        free_slot = victim;
+    }
+
+    if (free_slot != NULL) {
+        snprintf(free_slot->key, sizeof(free_slot->key), "%s", key);
+        free_slot->in_use = true;
+        *reused = false;
+    }
+    return free_slot;
+}
+
+/**
+ * @brief Inflater output: pass decoded data on to the sink
+ */
+static esp_err_t inflate_to_sink(void *ctx, const uint8_t *data, size_t len) {
+    inflate_ctx_t *ictx = (inflate_ctx_t *)ctx;
+    ictx->res->body_bytes += len;
+    if (ictx->sink == NULL || ictx->sink->on_data == NULL) {
+        return ESP_OK;
+    }
+    int64_t t = esp_timer_get_time();
+    esp_err_t err = ictx->sink->on_data(ictx->sink->ctx, data, len);
+    ictx->sink_us += esp_timer_get_time() - t;
+    return err;
+}
+
+/**
+ * @brief Send the request and stream the response body to the sink
+ *
+ * Follows redirects. On success the body has been fully drained, so the
+ * connection can be reused for the next request. Compressed bodies are
+ * inflated between the receive buffer and the sink.
+ */
+static esp_err_t slot_exchange(pool_slot_t *slot, const http_body_sink_t *sink,
+                               http_pool_result_t *res) {
+    esp_http_client_handle_t client = slot->client;
+    int64_t content_length = 0;
+    int status = 0;
+
+    for (int redirects = 0;; redirects++) {
+        esp_err_t err = esp_http_client_open(client, 0);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        content_length = esp_http_client_fetch_headers(client);
+        if (content_length < 0) {
+            return ESP_FAIL;
+        }
+
+        status = esp_http_client_get_status_code(client);
+        bool redirect = (status == 301 || status == 302 || status == 303 ||
+                         status == 307 || status == 308);
+        if (!redirect || redirects >= HTTP_POOL_MAX_REDIRECTS) {
+            break;
+        }
+
+        int flushed = 0;
+        esp_http_client_flush_response(client, &flushed);
+        err = esp_http_client_set_redirection(client);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    // The decoded length is only known at the end
+    bool chunked = esp_http_client_is_chunked_response(client);
+    res->status = status;
+    if (slot->encoding == ENCODING_UNSUPPORTED) {
+        ESP_LOGE(TAG, "Unsupported Content-Encoding from %s", slot->key);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    res->compressed = slot->encoding != ENCODING_IDENTITY;
+    res->content_length = chunked || res->compressed ? -1 : content_length;
+
+    inflate_ctx_t ictx = {sink, res, 0};
+    http_inflate_t *inflate = NULL;
+    if (res->compressed) {
+        http_inflate_format_t format =
+            slot->encoding == ENCODING_GZIP ? HTTP_INFLATE_GZIP : HTTP_INFLATE_DEFLATE;
+        inflate = http_inflate_create(format, inflate_to_sink, &ictx);
+        if (inflate == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    if (sink != NULL && sink->on_begin != NULL) {
+        err = sink->on_begin(sink->ctx, status, res->content_length);
+    }
+
+    // Pull loop: the next read only happens once the sink has consumed
+    // the previous chunk, which gives natural backpressure
+    while (err == ESP_OK) {
+        int n = esp_http_client_read(client, (char *)slot->rx_buf, HTTP_POOL_BUFFER_SIZE);
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (n == 0) {
+            if (!esp_http_client_is_complete_data_received(client)) {
+                err = ESP_FAIL;  // Connection closed mid-body
+            }
+            break;
+        }
+        res->wire_bytes += n;
+        if (inflate != NULL) {
+            int64_t t = esp_timer_get_time();
+            int64_t sink_us = ictx.sink_us;
+            err = http_inflate_feed(inflate, slot->rx_buf, n);
+            res->inflate_us += (uint32_t)(esp_timer_get_time() - t - (ictx.sink_us - sink_us));
+            continue;
+        }
+        res->body_bytes += n;
+        if (sink != NULL && sink->on_data != NULL) {
+            err = sink->on_data(sink->ctx, slot->rx_buf, n);
+        }
+    }
+
+    if (inflate != NULL) {
+        // A body-less response (304, HEAD) carries the header but no stream
+        if (err == ESP_OK && res->wire_bytes > 0) {
+            err = http_inflate_finish(inflate);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Corrupt %s body from %s",
+                         slot->encoding == ENCODING_GZIP ? "gzip" : "deflate", slot->key);
+            }
+        }
+        http_inflate_destroy(inflate);
+    }
+
+    return err;
+}
+
+esp_err_t http_pool_perform(const http_pool_request_t *req, http_pool_result_t *out) {
+    if (pool_mutex == NULL || req == NULL || req->url == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char key[HOST_KEY_LEN];
+    if (!url_to_key(req->url, key, sizeof(key))) {
+        ESP_LOGE(TAG, "Unsupported URL: %s", req->url);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    bool reused = false;
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+    pool_slot_t *slot = slot_acquire(key, &reused);
+    xSemaphoreGive(pool_mutex);
+
+    if (slot == NULL) {
+        ESP_LOGW(TAG, "No free client for %s", key);
+        return ESP_ERR_NO_MEM;
+    }
+
+    slot->handler = req->event_handler;
+    slot->user_data = req->user_data;
+
+    memset(&slot->trace, 0, sizeof(slot->trace));
+    slot->trace.start_us = start;
+    slot->trace.https = strncmp(key, "https", 5) == 0;
+    slot->trace.tls_session = slot->tls_session;
+
+    if (HTTP_TRACE_PROBE_TCP && !reused && slot->trace.https) {
+        // Time the TCP handshake on its own, see http_trace.h
+        char host[HOST_KEY_LEN];
+        int port = 0;
+        key_to_host(key, host, sizeof(host), &port);
+        http_trace_probe(&slot->trace, host, port);
+    }
+
+    int timeout_ms = req->timeout_ms > 0 ? req->timeout_ms : HTTP_POOL_DEFAULT_TIMEOUT_MS;
+    if (slot->client == NULL) {
+        esp_http_client_config_t config = {};
+        config.url = req->url;
+        config.method = req->method;
+        config.timeout_ms = timeout_ms;
+        config.event_handler = pool_event_handler;
+        config.user_data = slot;
+        config.buffer_size = HTTP_POOL_BUFFER_SIZE;
+        config.keep_alive_enable = true;
+        config.crt_bundle_attach = esp_crt_bundle_attach;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // Keep the session of each handshake and offer it on reconnect
+        config.save_client_session = true;
+#endif
+        slot->client = esp_http_client_init(&config);
+        slot->rx_buf = (uint8_t *)malloc(HTTP_POOL_BUFFER_SIZE);
+    } else {
+        // The client keeps the settings of the request that created it
+        esp_http_client_set_url(slot->client, req->url);
+        esp_http_client_set_method(slot->client, req->method);
+        esp_http_client_set_timeout_ms(slot->client, timeout_ms);
+    }
+
+    if (slot->client != NULL) {
+        for (int i = 0; i < req->header_count; i++) {
+            esp_http_client_set_header(slot->client, req->headers[i].name, req->headers[i].value);
+        }
+        if (req->accept_encoding) {
+            esp_http_client_set_header(slot->client, "Accept-Encoding", ACCEPT_ENCODING);
+        }
+    }
+
+    http_pool_result_t res = {};
+    esp_err_t err = ESP_ERR_NO_MEM;
+    bool reconnected = false;
+    if (slot->client != NULL && slot->rx_buf != NULL) {
+        http_trace_connect_begin(&slot->trace);
+        err = slot_exchange(slot, req->sink, &res);
+
+        // The server may have closed an idle keep-alive connection. Only
+        // retry if nothing reached the sink yet.
+        if (err != ESP_OK && reused && res.status == 0) {
+            ESP_LOGI(TAG, "Reused connection to %s failed (%s), reconnecting", key,
+                     esp_err_to_name(err));
+            esp_http_client_close(slot->client);
+            reconnected = true;
+            res = {};
+            http_trace_connect_begin(&slot->trace);
+            err = slot_exchange(slot, req->sink, &res);
+        }
+        http_trace_connect_end(&slot->trace);
+    }
+
+    // Headers belong to this request only, the client is reused
+    if (slot->client != NULL) {
+        for (int i = 0; i < req->header_count; i++) {
+            esp_http_client_delete_header(slot->client, req->headers[i].name);
+        }
+        if (req->accept_encoding) {
+            esp_http_client_delete_header(slot->client, "Accept-Encoding");
+        }
+    }
+
+    if (req->sink != NULL && req->sink->on_end != NULL) {
+        req->sink->on_end(req->sink->ctx, err);
+    }
+
+    slot->trace.end_us = esp_timer_get_time();
+    http_trace_phases(&slot->trace, &res.phases);
+    if (err == ESP_OK) {
+        http_trace_record(key, &res.phases);
+    }
+
+    uint32_t elapsed_ms = res.phases.total_ms;
+    res.reused = reused;
+    res.tls_offered = res.phases.tls_offered;
+    res.elapsed_ms = elapsed_ms;
+    if (out != NULL) {
+        *out = res;
+    }
+
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+    if (reconnected) {
+        stats.reconnects++;
+    }
+    if (err == ESP_OK) {
+        slot->in_use = false;
+        slot->handler = NULL;
+        slot->user_data = NULL;
+        slot->last_used_us = esp_timer_get_time();
+        slot->requests++;
+        if (slot->trace.https && res.phases.new_connection) {
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            slot->tls_session = true;
+#endif
+            uint32_t handshake_ms = 0;
+            bool measured = http_trace_handshake_ms(&res.phases, &handshake_ms);
+            if (measured && res.phases.tls_offered) {
+                stats.tls_offered++;
+                stats.tls_offered_ms += handshake_ms;
+            } else if (measured) {
+                stats.tls_full++;
+                stats.tls_full_ms += handshake_ms;
+            }
+        }
+        if (res.compressed) {
+            stats.compressed_responses++;
+            stats.compressed_wire_bytes += res.wire_bytes;
+            stats.compressed_body_bytes += res.body_bytes;
+            stats.inflate_us += res.inflate_us;
+        }
+        if (reused) {
+            stats.warm_requests++;
+            stats.warm_total_ms += elapsed_ms;
+        } else {
+            stats.cold_requests++;
+            stats.cold_total_ms += elapsed_ms;
+        }
+    } else {
+        // Don't keep clients in an unknown state
+        slot_destroy(slot);
+    }
+    xSemaphoreGive(pool_mutex);
+
+    char tls[24] = "n/a";  // Included in connect without the probe
+    if (res.phases.tls_split) {
+        snprintf(tls, sizeof(tls), "%lu%s", (unsigned long)res.phases.tls_ms,
+                 res.phases.tls_offered ? " offered" : "");
+    }
+    char dns[32] = "";
+    if (res.phases.dns_cached) {
+        snprintf(dns, sizeof(dns), " cached, saved %lu", (unsigned long)res.phases.dns_saved_ms);
+    }
+    ESP_LOGI(TAG, "%s request to %s: %lu ms (dns %lu%s, connect %lu, tls %s, ttfb %lu, "
+             "transfer %lu) %s", reused ? "Warm" : "Cold", key, (unsigned long)elapsed_ms,
+             (unsigned long)res.phases.dns_ms, dns, (unsigned long)res.phases.connect_ms, tls, (unsigned long)res.phases.ttfb_ms,
+             (unsigned long)res.phases.transfer_ms, esp_err_to_name(err));
+    if (res.compressed) {
+        ESP_LOGI(TAG, "Inflated %lu -> %lu bytes in %lu us", (unsigned long)res.wire_bytes,
+                 (unsigned long)res.body_bytes, (unsigned long)res.inflate_us);
+    }
+    return err;
+}
+
+void http_pool_evict_idle(void) {
+    if (pool_mutex == NULL) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        pool_slot_t *s = &slots[i];
+        if (s->client == NULL || s->in_use) {
+            continue;
+        }
+        int64_t idle_us = now - s->last_used_us;
+        if (s->dormant) {
+            if (idle_us > (int64_t)HTTP_POOL_TLS_SESSION_TIMEOUT_S * 1000000) {
+                ESP_LOGI(TAG, "Dropping TLS session for %s", s->key);
+                slot_destroy(s);
+            }
+        } else if (idle_us > (int64_t)HTTP_POOL_IDLE_TIMEOUT_MS * 1000) {
+            if (s->tls_session) {
+                ESP_LOGI(TAG, "Closing idle connection to %s, keeping its TLS session", s->key);
+                esp_http_client_close(s->client);
+                s->dormant = true;
+            } else {
+                ESP_LOGI(TAG, "Closing idle client %s after %lu requests", s->key,
+                         (unsigned long)s->requests);
+                slot_destroy(s);
+            }
+            stats.evictions++;
+        }
+    }
+    xSemaphoreGive(pool_mutex);
+}
+
+void http_pool_get_stats(http_pool_stats_t *out) {
+    if (pool_mutex == NULL || out == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(pool_mutex, portMAX_DELAY);
+    *out = stats;
+    out->open_clients = 0;
+    out->tls_sessions = 0;
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (slots[i].client != NULL && !slots[i].dormant) {
+            out->open_clients++;
+        }
+        if (slots[i].tls_session) {
+            out->tls_sessions++;
+        }
+    }
+    xSemaphoreGive(pool_mutex);
+}
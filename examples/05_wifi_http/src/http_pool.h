@@ -0,0 +1,174 @@
+/**
+ * @file http_pool.h
+ * @brief Keep-alive HTTP client pool keyed by host
+ *
+ * Creating an esp_http_client per request pays for client allocation,
+ * DNS and the TCP handshake every time. The pool keeps a small number of
+ * initialized clients per scheme/host/port and reuses them, so follow-up
+ * requests go over the already open connection with the same buffers.
+ * Idle connections are closed after HTTP_POOL_IDLE_TIMEOUT_MS.
+ *
+ * Response bodies are streamed to an http_body_sink_t (see http_sink.h)
+ * straight from the slot's receive buffer; nothing is accumulated.
+ *
+ * Each request is timed per phase (see http_trace.h) and recorded per host.
+ *
+ * HTTPS uses the ESP x509 certificate bundle. Each client keeps the TLS
+ * session (session ID and ticket) of its last handshake and offers it on
+ * the next connect, so reconnects skip the full ECDHE/RSA handshake. Idle
+ * HTTPS clients close their connection but stay in the pool for
+ * HTTP_POOL_TLS_SESSION_TIMEOUT_S as a per-host session cache.
+ *
+ * With accept_encoding set, the request advertises gzip/deflate and a
+ * compressed response is inflated on the fly (see http_inflate.h): sinks
+ * only ever see the decoded body.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "http_sink.h"
+#include "http_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum number of pooled clients (open connections)
+#define HTTP_POOL_SIZE            4
+
+// Idle clients are closed after this time
+#define HTTP_POOL_IDLE_TIMEOUT_MS 30000
+
+// Receive buffer size of each pooled client
+#define HTTP_POOL_BUFFER_SIZE     2048
+
+// Maximum number of redirects followed per request
+#define HTTP_POOL_MAX_REDIRECTS   3
+
+// Idle HTTPS clients are kept this long for their TLS session
+#define HTTP_POOL_TLS_SESSION_TIMEOUT_S 3600
+
+// Network timeout of a request that sets none (esp_http_client's default)
+#define HTTP_POOL_DEFAULT_TIMEOUT_MS 5000
+
+/**
+ * @brief Extra request header
+ */
+typedef struct {
+    const char *name;
+    const char *value;
+} http_pool_header_t;
+
+/**
+ * @brief A single request executed through the pool
+ */
+typedef struct {
+    const char *url;
+    esp_http_client_method_t method;
+    http_event_handle_cb event_handler;  // Client events (headers etc.), can be NULL
+    void *user_data;                     // Passed as evt->user_data
+    const http_body_sink_t *sink;        // Body consumer, NULL to discard the body
+    const http_pool_header_t *headers;   // Extra request headers, can be NULL
+    int header_count;
+    int timeout_ms;                      // Applies to this request only, 0 for the default
+    bool accept_encoding;                // Ask for gzip/deflate, decoded transparently
+} http_pool_request_t;
+
+/**
+ * @brief Outcome of a pooled request
+ */
+typedef struct {
+    int status;
+    int64_t content_length;   // -1 for chunked or compressed responses
+    uint32_t body_bytes;      // Bytes delivered to the sink (decoded)
+    uint32_t wire_bytes;      // Body bytes received from the network
+    bool compressed;          // Body was gzip/deflate encoded
+    uint32_t inflate_us;      // CPU time spent decoding, excluding the sink
+    bool reused;              // Served over an existing connection (warm)
+    bool tls_offered;         // New TLS connection that offered a cached session
+                              // (esp_http_client does not say if it was accepted)
+    uint32_t elapsed_ms;
+    http_phases_t phases;     // DNS/connect/TLS/TTFB/transfer breakdown
+} http_pool_result_t;
+
+/**
+ * @brief Accumulated pool statistics
+ */
+typedef struct {
+    uint32_t cold_requests;
+    uint32_t warm_requests;
+    uint64_t cold_total_ms;
+    uint64_t warm_total_ms;
+    uint32_t reconnects;    // Warm attempts that had to reopen the connection
+    uint32_t evictions;
+    uint8_t open_clients;     // Clients with an open connection
+    uint8_t tls_sessions;     // Clients holding a TLS session
+
+    // New HTTPS connections, see http_trace_handshake_ms(): the handshake with
+    // HTTP_TRACE_PROBE_TCP, else TCP + TLS. "Offered" handshakes sent a cached
+    // session; a server that declined it did a full one
+    uint32_t tls_full;
+    uint32_t tls_offered;
+    uint64_t tls_full_ms;
+    uint64_t tls_offered_ms;
+
+    // Compressed responses
+    uint32_t compressed_responses;
+    uint64_t compressed_wire_bytes;  // As received
+    uint64_t compressed_body_bytes;  // After inflating
+    uint64_t inflate_us;
+} http_pool_stats_t;
+
+/**
+ * @brief Initialize the pool
+ *
+ * Also initializes the latency trace store.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Failed to create the pool mutex
+ */
+esp_err_t http_pool_init(void);
+
+/**
+ * @brief Execute a request on a pooled client
+ *
+ * Reuses an idle client for the same host if one exists, otherwise
+ * creates one (evicting the least recently used idle client when full).
+ * A failed request on a reused connection is retried once on a fresh one.
+ *
+ * @param req: Request description
+ * @param out: Result, can be NULL if not needed
+ *
+ * @return
+ *    - ESP_OK: Request completed (check out->status for the HTTP status)
+ *    - ESP_ERR_INVALID_ARG: Bad URL
+ *    - ESP_ERR_NO_MEM: No free slot or client allocation failed
+ *    - Others: Transport error, or the error returned by the sink
+ */
+esp_err_t http_pool_perform(const http_pool_request_t *req, http_pool_result_t *out);
+
+/**
+ * @brief Close clients idle for longer than HTTP_POOL_IDLE_TIMEOUT_MS
+ *
+ * HTTPS clients only close the connection and keep their TLS session until
+ * HTTP_POOL_TLS_SESSION_TIMEOUT_S.
+ *
+ * Call periodically (e.g. from the main loop).
+ */
+void http_pool_evict_idle(void);
+
+/**
+ * @brief Get accumulated pool statistics
+ *
+ * @param out: Destination structure
+ */
+void http_pool_get_stats(http_pool_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
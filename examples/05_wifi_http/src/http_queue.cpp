@@ -0,0 +1,341 @@
+/**
+ * @file http_queue.cpp
+ * @brief Prioritized HTTP request queue served by worker tasks
+ */
+
+#include "http_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "http_queue";
+
+/**
+ * @brief Queued or running job
+ */
+typedef struct {
+    bool used;
+    bool running;
+    volatile bool cancel;
+    http_job_id_t id;
+    uint32_t seq;            // Submission order within a priority
+    int64_t queued_us;
+    http_job_t job;
+    char url[HTTP_QUEUE_URL_LEN];
+    http_body_sink_t wrap;   // Forwards to job.req.sink unless cancelled
+} job_slot_t;
+
+/**
+ * @brief Completion handed to the dispatch function
+ */
+typedef struct {
+    http_job_result_t result;
+    http_job_done_cb_t on_done;
+} completion_t;
+
+static job_slot_t jobs[HTTP_QUEUE_MAX_JOBS];
+static http_queue_stats_t stats = {};
+static http_queue_dispatch_t dispatch = NULL;
+static SemaphoreHandle_t queue_mutex = NULL;
+static SemaphoreHandle_t work_sem = NULL;  // Counts submitted jobs
+static http_job_id_t next_id = 1;
+static uint32_t next_seq = 0;
+
+// ============================================================================
+// Completion
+// ============================================================================
+
+static void completion_run(void *arg) {
+    completion_t *c = (completion_t *)arg;
+    if (c->on_done != NULL) {
+        c->on_done(&c->result);
+    }
+    free(c);
+}
+
+/**
+ * @brief Report a finished job through the dispatch function
+ */
+static void complete(http_job_done_cb_t on_done, const http_job_result_t *result) {
+    if (on_done == NULL) {
+        return;
+    }
+
+    completion_t *c = (completion_t *)malloc(sizeof(completion_t));
+    if (c == NULL) {
+        ESP_LOGE(TAG, "Out of memory, completion of job %lu lost", (unsigned long)result->id);
+        return;
+    }
+    c->result = *result;
+    c->on_done = on_done;
+
+    if (dispatch != NULL) {
+        dispatch(completion_run, c);
+    } else {
+        completion_run(c);
+    }
+}
+
+// ============================================================================
+// Cancel-aware sink
+// ============================================================================
+
+static esp_err_t wrap_begin(void *ctx, int status, int64_t content_length) {
+    job_slot_t *slot = (job_slot_t *)ctx;
+    const http_body_sink_t *sink = slot->job.req.sink;
+    if (slot->cancel) {
+        return ESP_FAIL;
+    }
+    if (sink != NULL && sink->on_begin != NULL) {
+        return sink->on_begin(sink->ctx, status, content_length);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t wrap_data(void *ctx, const uint8_t *data, size_t len) {
+    job_slot_t *slot = (job_slot_t *)ctx;
+    const http_body_sink_t *sink = slot->job.req.sink;
+    if (slot->cancel) {
+        return ESP_FAIL;
+    }
+    if (sink != NULL && sink->on_data != NULL) {
+        return sink->on_data(sink->ctx, data, len);
+    }
+    return ESP_OK;
+}
+
+static void wrap_end(void *ctx, esp_err_t result) {
+    job_slot_t *slot = (job_slot_t *)ctx;
+    const http_body_sink_t *sink = slot->job.req.sink;
+    if (sink != NULL && sink->on_end != NULL) {
+        sink->on_end(sink->ctx, result);
+    }
+}
+
+// ============================================================================
+// Workers
+// ============================================================================
+
+/**
+ * @brief Pick the next pending job: highest priority, then oldest
+ *
+ * Must be called with the queue mutex held.
+ */
+static job_slot_t *next_job(void) {
+    job_slot_t *best = NULL;
+    for (int i = 0; i < HTTP_QUEUE_MAX_JOBS; i++) {
+        job_slot_t *s = &jobs[i];
+        if (!s->used || s->running) {
+            continue;
+        }
+        if (best == NULL || s->job.priority < best->job.priority ||
+            (s->job.priority == best->job.priority && (int32_t)(s->seq - best->seq) < 0)) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+static void worker_task(void *arg) {
+    while (1) {
+        xSemaphoreTake(work_sem, portMAX_DELAY);
+
+        xSemaphoreTake(queue_mutex, portMAX_DELAY);
+        job_slot_t *slot = next_job();
+        if (slot == NULL) {
+            // The job was cancelled before a worker got to it
+            xSemaphoreGive(queue_mutex);
+            continue;
+        }
+        int64_t start = esp_timer_get_time();
+        uint32_t wait_ms = (uint32_t)((start - slot->queued_us) / 1000);
+        slot->running = true;
+        stats.pending--;
+        stats.running++;
+        stats.started++;
+        stats.total_wait_ms += wait_ms;
+        if (wait_ms > stats.max_wait_ms) {
+            stats.max_wait_ms = wait_ms;
+        }
+        xSemaphoreGive(queue_mutex);
+
+        http_pool_request_t req = slot->job.req;
+        req.url = slot->url;
+        req.sink = &slot->wrap;
+
+        http_job_result_t result = {};
+        esp_err_t err;
+        if (slot->job.use_cache) {
+            err = http_cache_perform(&req, &result.result);
+        } else {
+            err = http_pool_perform(&req, &result.result.http);
+            result.result.body_bytes = result.result.http.body_bytes;
+        }
+
+        result.id = slot->id;
+        result.err = err;
+        result.cancelled = slot->cancel && err != ESP_OK;
+        result.wait_ms = wait_ms;
+        result.run_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+        result.ctx = slot->job.ctx;
+
+        ESP_LOGD(TAG, "Job %lu done: %s (waited %lu ms, ran %lu ms)", (unsigned long)result.id,
+                 esp_err_to_name(err), (unsigned long)wait_ms, (unsigned long)result.run_ms);
+
+        http_job_done_cb_t on_done = slot->job.on_done;
+
+        xSemaphoreTake(queue_mutex, portMAX_DELAY);
+        stats.running--;
+        if (result.cancelled) {
+            stats.cancelled++;
+        } else if (err != ESP_OK) {
+            stats.failed++;
+        } else {
+            stats.completed++;
+        }
+        memset(slot, 0, sizeof(*slot));
+        xSemaphoreGive(queue_mutex);
+
+        complete(on_done, &result);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t http_queue_init(const http_queue_config_t *config) {
+    if (config == NULL || config->workers < 1 || config->workers > HTTP_QUEUE_MAX_WORKERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (queue_mutex != NULL) {
+        return ESP_OK;  // Already running
+    }
+
+    queue_mutex = xSemaphoreCreateMutex();
+    work_sem = xSemaphoreCreateCounting(HTTP_QUEUE_MAX_JOBS, 0);
+    if (queue_mutex == NULL || work_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dispatch = config->dispatch;
+
+    for (int i = 0; i < config->workers; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "http_worker%d", i);
+        if (xTaskCreate(worker_task, name, config->stack_size, NULL, config->task_priority,
+                        NULL) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(TAG, "Started %d HTTP workers", config->workers);
+    return ESP_OK;
+}
+
+esp_err_t http_queue_submit(const http_job_t *job, http_job_id_t *id) {
+    if (queue_mutex == NULL || job == NULL || job->req.url == NULL ||
+        strlen(job->req.url) >= HTTP_QUEUE_URL_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    job_slot_t *slot = NULL;
+    for (int i = 0; i < HTTP_QUEUE_MAX_JOBS; i++) {
+        if (!jobs[i].used) {
+            slot = &jobs[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        xSemaphoreGive(queue_mutex);
+        ESP_LOGW(TAG, "Queue full, rejecting %s", job->req.url);
+        return ESP_ERR_NO_MEM;
+    }
+
+    slot->used = true;
+    slot->id = next_id++;
+    if (next_id == 0) {
+        next_id = 1;
+    }
+    slot->seq = next_seq++;
+    slot->queued_us = esp_timer_get_time();
+    slot->job = *job;
+    strcpy(slot->url, job->req.url);
+    slot->wrap.on_begin = wrap_begin;
+    slot->wrap.on_data = wrap_data;
+    slot->wrap.on_end = wrap_end;
+    slot->wrap.ctx = slot;
+
+    stats.submitted++;
+    stats.pending++;
+    if (stats.pending > stats.max_pending) {
+        stats.max_pending = stats.pending;
+    }
+    if (id != NULL) {
+        *id = slot->id;
+    }
+    xSemaphoreGive(queue_mutex);
+
+    xSemaphoreGive(work_sem);
+    return ESP_OK;
+}
+
+esp_err_t http_queue_cancel(http_job_id_t id) {
+    if (queue_mutex == NULL || id == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    job_slot_t *slot = NULL;
+    for (int i = 0; i < HTTP_QUEUE_MAX_JOBS; i++) {
+        if (jobs[i].used && jobs[i].id == id) {
+            slot = &jobs[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        xSemaphoreGive(queue_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (slot->running) {
+        // The worker reports the cancellation once the transfer stops
+        slot->cancel = true;
+        xSemaphoreGive(queue_mutex);
+        return ESP_OK;
+    }
+
+    // Still pending: drop it now
+    http_job_done_cb_t on_done = slot->job.on_done;
+    int64_t queued_us = slot->queued_us;
+    void *ctx = slot->job.ctx;
+    memset(slot, 0, sizeof(*slot));
+    stats.pending--;
+    stats.cancelled++;
+    xSemaphoreGive(queue_mutex);
+
+    http_job_result_t result = {};
+    result.id = id;
+    result.err = ESP_FAIL;
+    result.cancelled = true;
+    result.wait_ms = (uint32_t)((esp_timer_get_time() - queued_us) / 1000);
+    result.ctx = ctx;
+    complete(on_done, &result);
+    return ESP_OK;
+}
+
+void http_queue_get_stats(http_queue_stats_t *out) {
+    if (queue_mutex == NULL || out == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(queue_mutex);
+}
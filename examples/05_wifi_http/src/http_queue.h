@@ -0,0 +1,169 @@
+/**
+ * @file http_queue.h
+ * @brief Prioritized HTTP request queue served by worker tasks
+ *
+ * Requests are submitted without blocking and executed by a small pool of
+ * worker tasks (one connection each), so the caller - typically an LVGL
+ * event callback - never waits on the network. Pending requests are served
+ * highest priority first, in submission order within a priority.
+ *
+ * Completion callbacks are handed to a dispatch function, which lets the
+ * application run them on its UI thread (e.g. with lv_async_call) so they
+ * can update widgets directly.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "http_cache.h"
+#include "http_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Upper limit for parallel requests
+#define HTTP_QUEUE_MAX_WORKERS 3
+
+// Maximum number of pending + running requests
+#define HTTP_QUEUE_MAX_JOBS    16
+
+// Longest URL accepted (copied on submit)
+#define HTTP_QUEUE_URL_LEN     256
+
+/**
+ * @brief Request priority
+ */
+typedef enum {
+    HTTP_PRIO_HIGH,
+    HTTP_PRIO_NORMAL,
+    HTTP_PRIO_LOW,
+} http_priority_t;
+
+// Request handle, 0 is never a valid id
+typedef uint32_t http_job_id_t;
+
+/**
+ * @brief Completion report
+ */
+typedef struct {
+    http_job_id_t id;
+    esp_err_t err;               // Result of the request (ESP_FAIL if cancelled)
+    bool cancelled;
+    http_cache_result_t result;  // Status, bytes and cache source
+    uint32_t wait_ms;            // Time spent in the queue
+    uint32_t run_ms;             // Time spent executing
+    void *ctx;                   // Job context
+} http_job_result_t;
+
+/**
+ * @brief Completion callback, called exactly once per submitted job
+ */
+typedef void (*http_job_done_cb_t)(const http_job_result_t *result);
+
+/**
+ * @brief A request to execute
+ *
+ * The URL is copied on submit. The sink, headers and event handler in req
+ * must stay valid until the completion callback has run.
+ */
+typedef struct {
+    http_pool_request_t req;
+    bool use_cache;              // Go through http_cache (GET only)
+    http_priority_t priority;
+    http_job_done_cb_t on_done;  // Can be NULL
+    void *ctx;
+} http_job_t;
+
+/**
+ * @brief Runs fn(arg) on the thread that should see completions
+ */
+typedef void (*http_queue_dispatch_t)(void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Queue configuration
+ */
+typedef struct {
+    int workers;                     // Parallel requests, 1..HTTP_QUEUE_MAX_WORKERS
+    int task_priority;
+    uint32_t stack_size;
+    http_queue_dispatch_t dispatch;  // NULL: completions run on the worker task
+} http_queue_config_t;
+
+#define HTTP_QUEUE_CONFIG_DEFAULT() {  \
+    .workers = 2,                      \
+    .task_priority = 4,                \
+    .stack_size = 8192,                \
+    .dispatch = NULL,                  \
+}
+
+/**
+ * @brief Queue depth and wait time metrics
+ */
+typedef struct {
+    uint8_t pending;         // Current queue depth
+    uint8_t running;
+    uint8_t max_pending;     // High-water mark of the queue depth
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t cancelled;
+    uint32_t failed;
+    uint64_t total_wait_ms;  // Sum of queue wait over all started jobs
+    uint32_t max_wait_ms;
+    uint32_t started;
+} http_queue_stats_t;
+
+/**
+ * @brief Start the worker tasks
+ *
+ * http_pool_init() (and http_cache_init() for cached jobs) must have been
+ * called before.
+ *
+ * @param config: Queue configuration
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Bad worker count
+ *    - ESP_ERR_NO_MEM: Failed to create tasks or semaphores
+ */
+esp_err_t http_queue_init(const http_queue_config_t *config);
+
+/**
+ * @brief Queue a request
+ *
+ * @param job: Request and completion callback
+ * @param id: Receives the job id, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Queued
+ *    - ESP_ERR_INVALID_ARG: Missing or too long URL
+ *    - ESP_ERR_NO_MEM: Queue is full
+ */
+esp_err_t http_queue_submit(const http_job_t *job, http_job_id_t *id);
+
+/**
+ * @brief Cancel a pending or running request
+ *
+ * A pending job is removed immediately. A running job is aborted at the
+ * next body chunk. Either way its completion callback reports cancelled.
+ *
+ * @param id: Job id from http_queue_submit()
+ *
+ * @return
+ *    - ESP_OK: Cancellation requested
+ *    - ESP_ERR_NOT_FOUND: Unknown or already completed job
+ */
+esp_err_t http_queue_cancel(http_job_id_t id);
+
+/**
+ * @brief Get queue metrics
+ *
+ * @param out: Destination structure
+ */
+void http_queue_get_stats(http_queue_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file http_sink.cpp
+ * @brief Stock HTTP body sinks (file, SHA-256, tee)
+ */
+
+#include "http_sink.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/sha256.h"
+
+// ============================================================================
+// File sink
+// ============================================================================
+
+static esp_err_t file_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    http_file_sink_t *s = (http_file_sink_t *)ctx;
+    if (fwrite(data, 1, len, s->file) != len) {
+        return ESP_FAIL;
+    }
+    s->bytes_written += len;
+    return ESP_OK;
+}
+
+http_body_sink_t http_sink_file(http_file_sink_t *state) {
+    http_body_sink_t sink = {};
+    state->bytes_written = 0;
+    sink.on_data = file_sink_data;
+    sink.ctx = state;
+    return sink;
+}
+
+// ============================================================================
+// SHA-256 sink
+// ============================================================================
+
+static esp_err_t sha256_sink_begin(void *ctx, int status, int64_t content_length) {
+    http_sha256_sink_t *s = (http_sha256_sink_t *)ctx;
+    mbedtls_sha256_context *md = (mbedtls_sha256_context *)malloc(sizeof(*md));
+    if (md == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    mbedtls_sha256_init(md);
+    mbedtls_sha256_starts(md, 0);
+    s->md_ctx = md;
+    s->bytes_hashed = 0;
+    return ESP_OK;
+}
+
+static esp_err_t sha256_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    http_sha256_sink_t *s = (http_sha256_sink_t *)ctx;
+    mbedtls_sha256_update((mbedtls_sha256_context *)s->md_ctx, data, len);
+    s->bytes_hashed += len;
+    return ESP_OK;
+}
+
+static void sha256_sink_end(void *ctx, esp_err_t result) {
+    http_sha256_sink_t *s = (http_sha256_sink_t *)ctx;
+    mbedtls_sha256_context *md = (mbedtls_sha256_context *)s->md_ctx;
+    if (md == NULL) {
+        return;
+    }
+    if (result == ESP_OK) {
+        mbedtls_sha256_finish(md, s->digest);
+    }
+    mbedtls_sha256_free(md);
+    free(md);
+    s->md_ctx = NULL;
+}
+
+http_body_sink_t http_sink_sha256(http_sha256_sink_t *state) {
+    http_body_sink_t sink = {};
+    memset(state, 0, sizeof(*state));
+    sink.on_begin = sha256_sink_begin;
+    sink.on_data = sha256_sink_data;
+    sink.on_end = sha256_sink_end;
+    sink.ctx = state;
+    return sink;
+}
+
+// ============================================================================
+// Tee sink
+// ============================================================================
+
+static esp_err_t tee_sink_begin(void *ctx, int status, int64_t content_length) {
+    http_tee_sink_t *t = (http_tee_sink_t *)ctx;
+    esp_err_t err = ESP_OK;
+    if (t->a->on_begin != NULL) {
+        err = t->a->on_begin(t->a->ctx, status, content_length);
+    }
+    if (err == ESP_OK && t->b->on_begin != NULL) {
+        err = t->b->on_begin(t->b->ctx, status, content_length);
+    }
+    return err;
+}
+
+static esp_err_t tee_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    http_tee_sink_t *t = (http_tee_sink_t *)ctx;
+    esp_err_t err = ESP_OK;
+    if (t->a->on_data != NULL) {
+        err = t->a->on_data(t->a->ctx, data, len);
+    }
+    if (err == ESP_OK && t->b->on_data != NULL) {
+        err = t->b->on_data(t->b->ctx, data, len);
+    }
+    return err;
+}
+
+static void tee_sink_end(void *ctx, esp_err_t result) {
+    http_tee_sink_t *t = (http_tee_sink_t *)ctx;
+    if (t->a->on_end != NULL) {
+        t->a->on_end(t->a->ctx, result);
+    }
+    if (t->b->on_end != NULL) {
+        t->b->on_end(t->b->ctx, result);
+    }
+}
+
+http_body_sink_t http_sink_tee(http_tee_sink_t *state) {
+    http_body_sink_t sink = {};
+    sink.on_begin = tee_sink_begin;
+    sink.on_data = tee_sink_data;
+    sink.on_end = tee_sink_end;
+    sink.ctx = state;
+    return sink;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file http_sink.h
+ * @brief Streaming HTTP body consumer interface
+ *
+ * A sink receives the response body chunk by chunk as it is read from the
+ * connection, instead of the body being accumulated into a fixed buffer.
+ * Chunks point directly into the client's receive buffer and are only
+ * valid for the duration of on_data. The next chunk is not read until
+ * on_data returns, so a slow sink throttles the transfer (TCP flow control
+ * does the rest). Returning an error from any callback aborts the request.
+ *
+ * Chunked transfer encoding is decoded before data reaches the sink.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Body consumer callbacks (all optional)
+ */
+typedef struct {
+    /**
+     * @brief Called once the response headers have been parsed
+     *
+     * @param ctx: Sink context
+     * @param status: HTTP status code
+     * @param content_length: Body length, or -1 for chunked responses
+     */
+    esp_err_t (*on_begin)(void *ctx, int status, int64_t content_length);
+
+    /**
+     * @brief Called for each body chunk as it arrives
+     */
+    esp_err_t (*on_data)(void *ctx, const uint8_t *data, size_t len);
+
+    /**
+     * @brief Called once at the end, also when the request failed
+     *
+     * @param ctx: Sink context
+     * @param result: ESP_OK if the whole body was delivered
+     */
+    void (*on_end)(void *ctx, esp_err_t result);
+
+    void *ctx;
+} http_body_sink_t;
+
+/**
+ * @brief State for the file sink
+ */
+typedef struct {
+    FILE *file;
+    size_t bytes_written;
+} http_file_sink_t;
+
+/**
+ * @brief State for the SHA-256 sink
+ */
+typedef struct {
+    void *md_ctx;        // mbedtls_sha256_context, allocated on begin
+    uint8_t digest[32];
+    size_t bytes_hashed;
+} http_sha256_sink_t;
+
+/**
+ * @brief State for the tee sink
+ */
+typedef struct {
+    const http_body_sink_t *a;
+    const http_body_sink_t *b;
+} http_tee_sink_t;
+
+/**
+ * @brief Create a sink that writes the body to an open file
+ *
+ * @param state: Sink state with `file` already opened for writing
+ *
+ * @return Sink bound to state
+ */
+http_body_sink_t http_sink_file(http_file_sink_t *state);
+
+/**
+ * @brief Create a sink that computes the SHA-256 of the body
+ *
+ * The digest is valid in state->digest after a successful on_end.
+ *
+ * @param state: Sink state
+ *
+ * @return Sink bound to state
+ */
+http_body_sink_t http_sink_sha256(http_sha256_sink_t *state);
+
+/**
+ * @brief Create a sink that forwards every callback to two sinks
+ *
+ * Useful to e.g. parse a body and show a preview of it at the same time.
+ *
+ * @param state: Sink state with both targets set
+ *
+ * @return Sink bound to state
+ */
+http_body_sink_t http_sink_tee(http_tee_sink_t *state);
+
+#ifdef __cplusplus
+}
+#endif
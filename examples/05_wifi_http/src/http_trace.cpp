@@ -0,0 +1,348 @@
+/**
+ * @file http_trace.cpp
+ * @brief Per-phase HTTP latency breakdown with per-host percentiles
+ */
+
+#include "http_trace.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dns_cache.h"
+
+static const char *TAG = "http_trace";
+
+#define HOST_LEN         64
+#define PROBE_TIMEOUT_MS 3000
+
+/**
+ * @brief One request, compacted
+ */
+typedef struct {
+    uint32_t seq;
+    uint16_t dns_ms;
+    uint16_t dns_saved_ms;
+    uint16_t connect_ms;
+    uint16_t tls_ms;
+    uint16_t ttfb_ms;
+    uint16_t transfer_ms;
+    uint16_t total_ms;
+    bool new_connection;
+    bool tls_split;
+    bool https;
+    bool tls_offered;
+} sample_t;
+
+/**
+ * @brief Sample ring of one host
+ */
+typedef struct {
+    char host[HOST_LEN];
+    uint32_t count;   // Total samples recorded
+    uint32_t last_seq;
+    sample_t samples[HTTP_TRACE_SAMPLES];
+} host_trace_t;
+
+static host_trace_t *hosts = NULL;  // HTTP_TRACE_MAX_HOSTS entries, in PSRAM
+static uint32_t next_seq = 0;
+static SemaphoreHandle_t trace_mutex = NULL;
+
+static uint16_t clamp16(uint32_t v) {
+    return v > UINT16_MAX ? UINT16_MAX : (uint16_t)v;
+}
+
+static uint32_t us_to_ms(int64_t us) {
+    return us > 0 ? (uint32_t)(us / 1000) : 0;
+}
+
+/**
+ * @brief Reduce a URL ("scheme://host:port/path") or host to the host name
+ */
+static void host_name(const char *url_or_host, char *out, size_t len) {
+    const char *sep = strstr(url_or_host, "://");
+    const char *host = sep != NULL ? sep + 3 : url_or_host;
+    size_t n = strcspn(host, ":/?#");
+    if (n >= len) {
+        n = len - 1;
+    }
+    memcpy(out, host, n);
+    out[n] = '\0';
+}
+
+esp_err_t http_trace_init(void) {
+    if (trace_mutex == NULL) {
+        trace_mutex = xSemaphoreCreateMutex();
+        if (trace_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (hosts == NULL) {
+        hosts = (host_trace_t *)heap_caps_calloc(HTTP_TRACE_MAX_HOSTS, sizeof(host_trace_t),
+                                                 MALLOC_CAP_SPIRAM);
+        if (hosts == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void http_trace_probe(http_trace_t *trace, const char *host, int port) {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (dns_cache_peek(host, &addr.sin_addr.s_addr) != ESP_OK) {
+        return;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        return;
+    }
+    struct timeval tv = {PROBE_TIMEOUT_MS / 1000, 0};
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int64_t start = esp_timer_get_time();
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        trace->tcp_probe_ms = us_to_ms(esp_timer_get_time() - start);
+        if (trace->tcp_probe_ms == 0) {
+            trace->tcp_probe_ms = 1;  // 0 means "not probed"
+        }
+    } else {
+        ESP_LOGD(TAG, "TCP probe to %s failed", host);
+    }
+    close(sock);
+}
+
+void http_trace_connect_begin(http_trace_t *trace) {
+    trace->connect_start_us = esp_timer_get_time();
+    trace->connected_us = 0;
+    dns_cache_take_last(NULL);
+}
+
+void http_trace_connect_end(http_trace_t *trace) {
+    dns_cache_info_t info;
+    if (dns_cache_take_last(&info)) {
+        trace->dns_ms = info.lookup_ms;
+        trace->dns_cached = info.hit;
+        trace->dns_saved_ms = info.saved_ms;
+    }
+}
+
+void http_trace_phases(const http_trace_t *t, http_phases_t *out) {
+    memset(out, 0, sizeof(*out));
+
+    out->new_connection = t->connected_us != 0;
+    if (out->new_connection) {
+        out->dns_ms = t->dns_ms;
+        out->dns_cached = t->dns_cached;
+        out->dns_saved_ms = t->dns_saved_ms;
+        out->https = t->https;
+        out->tls_offered = t->https && t->tls_session;
+        // The client resolved the name inside its connect
+        uint32_t connect_ms = us_to_ms(t->connected_us - t->connect_start_us);
+        connect_ms = connect_ms > t->dns_ms ? connect_ms - t->dns_ms : 0;
+        if (t->https && t->tcp_probe_ms != 0) {
+            out->connect_ms = t->tcp_probe_ms < connect_ms ? t->tcp_probe_ms : connect_ms;
+            out->tls_ms = connect_ms - out->connect_ms;
+            out->tls_split = true;
+        } else {
+            out->connect_ms = connect_ms;
+        }
+    }
+    if (t->sent_us != 0 && t->first_byte_us != 0) {
+        out->ttfb_ms = us_to_ms(t->first_byte_us - t->sent_us);
+    }
+    if (t->first_byte_us != 0 && t->end_us != 0) {
+        out->transfer_ms = us_to_ms(t->end_us - t->first_byte_us);
+    }
+
+    // The probe is measurement overhead, not part of the request
+    uint32_t total = us_to_ms(t->end_us - t->start_us);
+    out->total_ms = total > t->tcp_probe_ms ? total - t->tcp_probe_ms : 0;
+}
+
+bool http_trace_handshake_ms(const http_phases_t *p, uint32_t *ms) {
+    // With the probe on, a host not in the DNS cache yet is not split: skip
+    // it rather than mix connect times into the handshake times
+    if (!p->new_connection || !p->https || (HTTP_TRACE_PROBE_TCP && !p->tls_split)) {
+        return false;
+    }
+    *ms = p->tls_split ? p->tls_ms : p->connect_ms;
+    return true;
+}
+
+void http_trace_record(const char *url_or_host, const http_phases_t *p) {
+    if (hosts == NULL) {
+        return;
+    }
+    char host[HOST_LEN];
+    host_name(url_or_host, host, sizeof(host));
+
+    xSemaphoreTake(trace_mutex, portMAX_DELAY);
+    host_trace_t *h = NULL;
+    host_trace_t *victim = NULL;  // Unused entry, else least recently updated host
+    for (int i = 0; i < HTTP_TRACE_MAX_HOSTS; i++) {
+        host_trace_t *c = &hosts[i];
+        if (c->count == 0) {
+            if (victim == NULL || victim->count != 0) {
+                victim = c;
+            }
+            continue;
+        }
+        if (strcmp(c->host, host) == 0) {
+            h = c;
+            break;
+        }
+        if (victim == NULL || (victim->count != 0 && c->last_seq < victim->last_seq)) {
+            victim = c;
+        }
+    }
+    if (h == NULL) {
+        h = victim;
+        memset(h, 0, sizeof(*h));
+        strcpy(h->host, host);
+    }
+
+    sample_t *s = &h->samples[h->count % HTTP_TRACE_SAMPLES];
+    s->seq = next_seq++;
+    s->dns_ms = clamp16(p->dns_ms);
+    s->dns_saved_ms = clamp16(p->dns_saved_ms);
+    s->connect_ms = clamp16(p->connect_ms);
+    s->tls_ms = clamp16(p->tls_ms);
+    s->ttfb_ms = clamp16(p->ttfb_ms);
+    s->transfer_ms = clamp16(p->transfer_ms);
+    s->total_ms = clamp16(p->total_ms);
+    s->new_connection = p->new_connection;
+    s->tls_split = p->tls_split;
+    s->https = p->https;
+    s->tls_offered = p->tls_offered;
+    h->count++;
+    h->last_seq = s->seq;
+    xSemaphoreGive(trace_mutex);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void percentiles(uint32_t *v, size_t n, http_percentiles_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (n == 0) {
+        return;
+    }
+    qsort(v, n, sizeof(v[0]), cmp_u32);
+    out->p50 = v[(n - 1) * 50 / 100];
+    out->p90 = v[(n - 1) * 90 / 100];
+    out->p99 = v[(n - 1) * 99 / 100];
+}
+
+// Which samples take part in a phase's percentiles
+enum { ALL_SAMPLES, NEW_CONNECTIONS, TLS_FULL, TLS_OFFERED };
+
+static void phase_percentiles(const host_trace_t *h, size_t offset, int filter,
+                              http_percentiles_t *out) {
+    uint32_t v[HTTP_TRACE_SAMPLES];
+    size_t n = 0;
+    size_t count = h->count < HTTP_TRACE_SAMPLES ? h->count : HTTP_TRACE_SAMPLES;
+    for (size_t i = 0; i < count; i++) {
+        const sample_t *s = &h->samples[i];
+        if (filter == TLS_FULL || filter == TLS_OFFERED) {
+            http_phases_t p = {};
+            p.connect_ms = s->connect_ms;
+            p.tls_ms = s->tls_ms;
+            p.new_connection = s->new_connection;
+            p.tls_split = s->tls_split;
+            p.https = s->https;
+            uint32_t ms;
+            if (s->tls_offered == (filter == TLS_OFFERED) && http_trace_handshake_ms(&p, &ms)) {
+                v[n++] = ms;
+            }
+            continue;
+        }
+        if (filter == NEW_CONNECTIONS && !s->new_connection) {
+            continue;
+        }
+        v[n++] = *(const uint16_t *)((const uint8_t *)s + offset);
+    }
+    percentiles(v, n, out);
+}
+
+esp_err_t http_trace_get_summary(const char *url_or_host, http_host_summary_t *out) {
+    if (hosts == NULL || out == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    char host[HOST_LEN];
+    host_name(url_or_host, host, sizeof(host));
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(trace_mutex, portMAX_DELAY);
+    for (int i = 0; i < HTTP_TRACE_MAX_HOSTS; i++) {
+        const host_trace_t *h = &hosts[i];
+        if (h->count == 0 || strcmp(h->host, host) != 0) {
+            continue;
+        }
+        memset(out, 0, sizeof(*out));
+        strcpy(out->host, h->host);
+        out->count = h->count < HTTP_TRACE_SAMPLES ? h->count : HTTP_TRACE_SAMPLES;
+        phase_percentiles(h, offsetof(sample_t, dns_ms), NEW_CONNECTIONS, &out->dns);
+        phase_percentiles(h, offsetof(sample_t, connect_ms), NEW_CONNECTIONS, &out->connect);
+        phase_percentiles(h, offsetof(sample_t, tls_ms), TLS_FULL, &out->tls);
+        phase_percentiles(h, offsetof(sample_t, tls_ms), TLS_OFFERED, &out->tls_offered);
+        phase_percentiles(h, offsetof(sample_t, ttfb_ms), ALL_SAMPLES, &out->ttfb);
+        phase_percentiles(h, offsetof(sample_t, transfer_ms), ALL_SAMPLES, &out->transfer);
+        phase_percentiles(h, offsetof(sample_t, total_ms), ALL_SAMPLES, &out->total);
+        ret = ESP_OK;
+        break;
+    }
+    xSemaphoreGive(trace_mutex);
+    return ret;
+}
+
+uint32_t http_trace_sample_count(void) {
+    if (trace_mutex == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(trace_mutex, portMAX_DELAY);
+    uint32_t n = next_seq;
+    xSemaphoreGive(trace_mutex);
+    return n;
+}
+
+esp_err_t http_trace_export_csv(FILE *f) {
+    if (hosts == NULL || f == NULL) {
+        return ESP_FAIL;
+    }
+
+    bool ok = fprintf(f, "host,seq,dns_ms,connect_ms,tls_ms,ttfb_ms,transfer_ms,total_ms,"
+                         "new_connection,tls_offered,dns_saved_ms\n") > 0;
+
+    xSemaphoreTake(trace_mutex, portMAX_DELAY);
+    for (int i = 0; ok && i < HTTP_TRACE_MAX_HOSTS; i++) {
+        const host_trace_t *h = &hosts[i];
+        size_t count = h->count < HTTP_TRACE_SAMPLES ? h->count : HTTP_TRACE_SAMPLES;
+        // Oldest first
+        size_t first = h->count < HTTP_TRACE_SAMPLES ? 0 : h->count % HTTP_TRACE_SAMPLES;
+        for (size_t j = 0; ok && j < count; j++) {
+            const sample_t *s = &h->samples[(first + j) % HTTP_TRACE_SAMPLES];
+            // tls_ms stays empty when TLS was not split from connect
+            char tls[8] = "";
+            if (s->tls_split) {
+                snprintf(tls, sizeof(tls), "%u", s->tls_ms);
+            }
+            ok = fprintf(f, "%s,%lu,%u,%u,%s,%u,%u,%u,%d,%d,%u\n", h->host,
+                         (unsigned long)s->seq, s->dns_ms, s->connect_ms, tls, s->ttfb_ms,
+                         s->transfer_ms, s->total_ms, s->new_connection, s->tls_offered,
+                         s->dns_saved_ms) > 0;
+        }
+    }
+    xSemaphoreGive(trace_mutex);
+
+    return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file http_trace.h
+ * @brief Per-phase HTTP latency breakdown with per-host percentiles
+ *
+ * Every request through the pool is split into phases:
+ *
+ *   DNS       name resolution (new connections only)
+ *   Connect   TCP handshake
+ *   TLS       TLS handshake (HTTPS, new connections only)
+ *   TTFB      request sent -> first response byte (server + link latency)
+ *   Transfer  first byte -> body fully received
+ *
+ * DNS is the client's own lookup, read back from the DNS cache after the
+ * connection is open (see dns_cache_take_last); connect is the rest of the
+ * time to HTTP_EVENT_ON_CONNECTED.
+ *
+ * esp_http_client connects TCP and TLS in one step, so HTTPS connect
+ * includes TLS. With HTTP_TRACE_PROBE_TCP set, a new HTTPS connection is
+ * preceded by a short TCP probe to the cached address of the host and TLS
+ * is the remainder of the client's connect time. The probe is an extra TCP
+ * connection per new HTTPS connection, so it is off by default.
+ *
+ * The last HTTP_TRACE_SAMPLES samples are kept per host for percentiles
+ * and can be exported as CSV.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hosts tracked (least recently used host is replaced)
+#define HTTP_TRACE_MAX_HOSTS 8
+
+// Samples kept per host
+#define HTTP_TRACE_SAMPLES   64
+
+// Measure the TCP handshake separately before new HTTPS connections
+#define HTTP_TRACE_PROBE_TCP 0
+
+/**
+ * @brief Phase durations of one request, in milliseconds
+ */
+typedef struct {
+    uint32_t dns_ms;
+    uint32_t connect_ms;
+    uint32_t tls_ms;
+    uint32_t ttfb_ms;
+    uint32_t transfer_ms;
+    uint32_t total_ms;
+    bool new_connection;  // DNS/connect/TLS happened for this request
+    bool tls_split;       // tls_ms measured separately from connect_ms
+    bool dns_cached;      // Name answered by the DNS cache
+    uint32_t dns_saved_ms;  // Lookup time the DNS cache saved
+    bool https;           // New connection was HTTPS
+    bool tls_offered;     // Handshake offered a cached TLS session
+} http_phases_t;
+
+/**
+ * @brief Timestamps collected while a request runs (microseconds)
+ */
+typedef struct {
+    int64_t start_us;
+    int64_t connect_start_us;
+    int64_t connected_us;     // HTTP_EVENT_ON_CONNECTED
+    int64_t sent_us;          // HTTP_EVENT_HEADERS_SENT
+    int64_t first_byte_us;    // First HTTP_EVENT_ON_HEADER
+    int64_t end_us;
+    uint32_t dns_ms;          // Lookup made by the client while connecting
+    uint32_t dns_saved_ms;    // See dns_cache_info_t
+    bool dns_cached;
+    uint32_t tcp_probe_ms;    // 0 if not probed
+    bool https;
+    bool tls_session;         // Client holds a session from an earlier handshake
+} http_trace_t;
+
+/**
+ * @brief Latency percentiles of one phase
+ */
+typedef struct {
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+} http_percentiles_t;
+
+/**
+ * @brief Per-host summary
+ */
+typedef struct {
+    char host[64];
+    uint32_t count;              // Samples available (<= HTTP_TRACE_SAMPLES)
+    http_percentiles_t dns;      // New connections only
+    http_percentiles_t connect;  // New connections only
+    http_percentiles_t tls;      // Full TLS handshakes only (see http_trace_handshake_ms)
+    http_percentiles_t tls_offered;  // Handshakes that offered a cached session
+    http_percentiles_t ttfb;
+    http_percentiles_t transfer;
+    http_percentiles_t total;
+} http_host_summary_t;
+
+/**
+ * @brief Initialize the trace store
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Failed to allocate the sample store
+ */
+esp_err_t http_trace_init(void);
+
+/**
+ * @brief Measure the TCP handshake to a host on its own
+ *
+ * Called before a new HTTPS connection is opened (HTTP_TRACE_PROBE_TCP).
+ * The address comes from the DNS cache without counting a lookup; a host
+ * that is not cached yet is not probed.
+ *
+ * @param trace: Trace to fill (tcp_probe_ms)
+ * @param host: Host name
+ * @param port: Port to connect to
+ */
+void http_trace_probe(http_trace_t *trace, const char *host, int port);
+
+/**
+ * @brief Mark the start of a connect attempt
+ *
+ * Sets connect_start_us and forgets earlier DNS lookups of the calling task.
+ */
+void http_trace_connect_begin(http_trace_t *trace);
+
+/**
+ * @brief Take the DNS timing of the lookup the client made while connecting
+ *
+ * Call on the task that ran the request, after it completed.
+ */
+void http_trace_connect_end(http_trace_t *trace);
+
+/**
+ * @brief Turn collected timestamps into phase durations
+ */
+void http_trace_phases(const http_trace_t *trace, http_phases_t *out);
+
+/**
+ * @brief Time of the handshake of a new HTTPS connection, for full vs offered
+ *
+ * The TLS handshake alone with HTTP_TRACE_PROBE_TCP. Without the probe it is
+ * the whole connect (TCP + TLS): to the same host the TCP part is the same
+ * round trip either way, so full and offered still differ by the handshake.
+ *
+ * @param phases: Phases of the request
+ * @param ms: Receives the time
+ *
+ * @return false if the request made no handshake that counts
+ */
+bool http_trace_handshake_ms(const http_phases_t *phases, uint32_t *ms);
+
+/**
+ * @brief Add a sample for a host
+ */
+void http_trace_record(const char *host, const http_phases_t *phases);
+
+/**
+ * @brief Get percentiles for a host
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NOT_FOUND: No samples for the host
+ */
+esp_err_t http_trace_get_summary(const char *host, http_host_summary_t *out);
+
+/**
+ * @brief Total number of samples recorded since init
+ */
+uint32_t http_trace_sample_count(void);
+
+/**
+ * @brief Write all samples as CSV
+ *
+ * Columns: host,seq,dns_ms,connect_ms,tls_ms,ttfb_ms,transfer_ms,total_ms,new_connection,
+ * tls_offered,dns_saved_ms. tls_ms is empty unless TLS was measured apart from connect;
+ * dns_saved_ms is the lookup time the DNS cache saved the request
+ *
+ * @param f: Open file (e.g. on the SD card, or stdout)
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_FAIL: Write error
+ */
+esp_err_t http_trace_export_csv(FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,268 @@
+/**
+ * @file inflate_bench.cpp
+ * @brief On-device benchmark: streaming gzip inflate throughput and CPU cost
+ *
+ * There is no compressor on the device, so the test stream is produced by
+ * a small greedy LZ77 encoder with the fixed Huffman code. Its output is
+ * larger than what gzip -6 would send, but it exercises the same decode
+ * paths (literals, length/distance pairs, window copies).
+ */
+
+#include "inflate_bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "http_inflate.h"
+
+static const char *TAG = "inflate_bench";
+
+// Payload size and number of timed iterations
+#define BENCH_PAYLOAD_SIZE (64 * 1024)
+#define BENCH_ITERATIONS   10
+
+// Feed size for the inflater (roughly one TCP segment)
+#define BENCH_CHUNK_SIZE   1436
+
+// Encoder match finder
+#define HASH_BITS   12
+#define MAX_MATCH   258
+#define MIN_MATCH   3
+#define MAX_DIST    32768
+
+static const uint16_t len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+                                      258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                       6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/**
+ * @brief LSB-first bit writer
+ */
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    uint32_t bitbuf;
+    int bitcnt;
+} bit_writer_t;
+
+/**
+ * @brief Checks the inflated output against the original
+ */
+typedef struct {
+    const uint8_t *expect;
+    size_t offset;
+    bool mismatch;
+} verify_t;
+
+static void put_bits(bit_writer_t *w, uint32_t value, int n) {
+    w->bitbuf |= value << w->bitcnt;
+    w->bitcnt += n;
+    while (w->bitcnt >= 8) {
+        if (w->len < w->cap) {
+            w->out[w->len] = w->bitbuf & 0xff;
+        }
+        w->len++;
+        w->bitbuf >>= 8;
+        w->bitcnt -= 8;
+    }
+}
+
+// Huffman codes are stored most significant bit first
+static void put_code(bit_writer_t *w, uint32_t code, int n) {
+    uint32_t rev = 0;
+    for (int i = 0; i < n; i++) {
+        rev = (rev << 1) | ((code >> i) & 1);
+    }
+    put_bits(w, rev, n);
+}
+
+static void put_literal_length(bit_writer_t *w, int sym) {
+    if (sym < 144) {
+        put_code(w, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        put_code(w, 0x190 + sym - 144, 9);
+    } else if (sym < 280) {
+        put_code(w, sym - 256, 7);
+    } else {
+        put_code(w, 0xc0 + sym - 280, 8);
+    }
+}
+
+static void put_match(bit_writer_t *w, int len, int dist) {
+    int i = 28;
+    while (len_base[i] > len) {
+        i--;
+    }
+    put_literal_length(w, 257 + i);
+    put_bits(w, len - len_base[i], len_extra[i]);
+
+    i = 29;
+    while (dist_base[i] > dist) {
+        i--;
+    }
+    put_code(w, i, 5);
+    put_bits(w, dist - dist_base[i], dist_extra[i]);
+}
+
+static uint32_t hash3(const uint8_t *p) {
+    return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Gzip in as a single fixed Huffman block
+ *
+ * @return Compressed size, 0 if out is too small
+ */
+static size_t gzip_fixed(const uint8_t *in, size_t len, uint8_t *out, size_t cap,
+                         int32_t *head) {
+    static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+    if (cap < sizeof(header) + 8) {
+        return 0;
+    }
+    memcpy(out, header, sizeof(header));
+    bit_writer_t w = {out, cap - 8, sizeof(header), 0, 0};
+
+    for (int i = 0; i < (1 << HASH_BITS); i++) {
+        head[i] = -1;
+    }
+
+    put_bits(&w, 1, 1);  // BFINAL
+    put_bits(&w, 1, 2);  // BTYPE = fixed Huffman
+    size_t pos = 0;
+    while (pos < len) {
+        int best = 0;
+        if (pos + MIN_MATCH <= len) {
+            uint32_t h = hash3(in + pos);
+            int32_t cand = head[h];
+            head[h] = pos;
+            if (cand >= 0 && pos - cand <= MAX_DIST) {
+                size_t max = len - pos < MAX_MATCH ? len - pos : MAX_MATCH;
+                while ((size_t)best < max && in[cand + best] == in[pos + best]) {
+                    best++;
+                }
+            }
+            if (best >= MIN_MATCH) {
+                put_match(&w, best, pos - cand);
+                // Index the skipped positions too, for the next matches
+                for (size_t j = pos + 1; j < pos + best && j + MIN_MATCH <= len; j++) {
+                    head[hash3(in + j)] = j;
+                }
+                pos += best;
+                continue;
+            }
+        }
+        put_literal_length(&w, in[pos++]);
+    }
+    put_literal_length(&w, 256);
+    put_bits(&w, 0, 7);  // Pad to a byte
+    if (w.len > w.cap) {
+        return 0;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, in, len);
+    uint8_t trailer[8] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16),
+                          (uint8_t)(crc >> 24), (uint8_t)len, (uint8_t)(len >> 8),
+                          (uint8_t)(len >> 16), (uint8_t)(len >> 24)};
+    memcpy(out + w.len, trailer, sizeof(trailer));
+    return w.len + sizeof(trailer);
+}
+
+/**
+ * @brief Build an array of API-like records into buf
+ */
+static size_t build_payload(char *buf, size_t size) {
+    size_t len = snprintf(buf, size, "{\"items\":[");
+    for (int i = 0; len < size - 256; i++) {
+        len += snprintf(buf + len, size - len,
+                        "%s{\"id\":%d,\"name\":\"sensor-%d\",\"value\":%d.%02d,"
+                        "\"ok\":%s,\"tags\":[\"a\",\"b\\u00e9\"],\"meta\":null}",
+                        i ? "," : "", i, i, i * 7 % 1000, i % 100, (i & 1) ? "true" : "false");
+    }
+    len += snprintf(buf + len, size - len, "]}");
+    return len;
+}
+
+static esp_err_t verify_cb(void *ctx, const uint8_t *data, size_t len) {
+    verify_t *v = (verify_t *)ctx;
+    if (memcmp(v->expect + v->offset, data, len) != 0) {
+        v->mismatch = true;
+    }
+    v->offset += len;
+    return ESP_OK;
+}
+
+static double mb_per_s(size_t bytes, int64_t us) {
+    return us > 0 ? (double)bytes / (double)us : 0.0;  // bytes/us == MB/s
+}
+
+void inflate_bench_run(void) {
+    char *payload = (char *)heap_caps_malloc(BENCH_PAYLOAD_SIZE, MALLOC_CAP_SPIRAM);
+    uint8_t *gz = (uint8_t *)heap_caps_malloc(BENCH_PAYLOAD_SIZE, MALLOC_CAP_SPIRAM);
+    int32_t *head = (int32_t *)heap_caps_malloc((1 << HASH_BITS) * sizeof(int32_t),
+                                                MALLOC_CAP_SPIRAM);
+    if (payload == NULL || gz == NULL || head == NULL) {
+        ESP_LOGE(TAG, "Out of memory");
+        heap_caps_free(payload);
+        heap_caps_free(gz);
+        heap_caps_free(head);
+        return;
+    }
+
+    size_t len = build_payload(payload, BENCH_PAYLOAD_SIZE);
+    size_t gz_len = gzip_fixed((const uint8_t *)payload, len, gz, BENCH_PAYLOAD_SIZE, head);
+    heap_caps_free(head);
+    if (gz_len == 0) {
+        ESP_LOGE(TAG, "Payload does not compress");
+        heap_caps_free(gz);
+        heap_caps_free(payload);
+        return;
+    }
+
+    esp_err_t err = ESP_OK;
+    verify_t v = {};
+    int64_t start = esp_timer_get_time();
+    for (int it = 0; it < BENCH_ITERATIONS && err == ESP_OK; it++) {
+        v.expect = (const uint8_t *)payload;
+        v.offset = 0;
+        http_inflate_t *inf = http_inflate_create(HTTP_INFLATE_GZIP, verify_cb, &v);
+        if (inf == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        for (size_t off = 0; off < gz_len && err == ESP_OK; off += BENCH_CHUNK_SIZE) {
+            size_t n = (gz_len - off < BENCH_CHUNK_SIZE) ? gz_len - off : BENCH_CHUNK_SIZE;
+            err = http_inflate_feed(inf, gz + off, n);
+        }
+        if (err == ESP_OK) {
+            err = http_inflate_finish(inf);
+        }
+        http_inflate_destroy(inf);
+    }
+    int64_t us = esp_timer_get_time() - start;
+
+    if (err != ESP_OK || v.mismatch || v.offset != len) {
+        ESP_LOGE(TAG, "Inflate failed: %s%s", esp_err_to_name(err),
+                 v.mismatch ? " (output mismatch)" : "");
+    } else {
+        int64_t per_iter_us = us / BENCH_ITERATIONS;
+        ESP_LOGI(TAG, "Payload: %u bytes, gzip %u bytes (%u%% of the transfer)",
+                 (unsigned)len, (unsigned)gz_len, (unsigned)(gz_len * 100 / len));
+        ESP_LOGI(TAG, "Inflate: %.2f MB/s out, %lu us per KB received, window %u bytes PSRAM",
+                 mb_per_s(len * BENCH_ITERATIONS, us),
+                 (unsigned long)(per_iter_us * 1024 / gz_len),
+                 (unsigned)HTTP_INFLATE_WINDOW_SIZE);
+    }
+
+    heap_caps_free(gz);
+    heap_caps_free(payload);
+}
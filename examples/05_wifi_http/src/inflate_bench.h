@@ -0,0 +1,24 @@
+/**
+ * @file inflate_bench.h
+ * @brief On-device benchmark: streaming gzip inflate throughput and CPU cost
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compress a synthetic payload, inflate it in TCP-sized chunks and
+ *        log the results
+ *
+ * Reports the compression ratio (the transfer-size reduction on the link),
+ * inflate throughput (MB/s of decoded output) and the CPU cost per KB
+ * received, which is what enabling Accept-Encoding adds to a request.
+ */
+void inflate_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
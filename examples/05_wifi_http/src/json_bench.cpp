@@ -0,0 +1,109 @@
+/**
+ * @file json_bench.cpp
+ * @brief On-device benchmark: streaming SAX parser vs cJSON (DOM)
+ */
+
+#include "json_bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "cJSON.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "json_stream.h"
+
+static const char *TAG = "json_bench";
+
+// Payload size and number of timed iterations
+#define BENCH_PAYLOAD_SIZE (64 * 1024)
+#define BENCH_ITERATIONS   10
+
+// Feed size for the streaming parser (roughly one TCP segment)
+#define BENCH_CHUNK_SIZE   1436
+
+/**
+ * @brief Build an array of API-like records into buf
+ */
+static size_t build_payload(char *buf, size_t size) {
+    size_t len = snprintf(buf, size, "{\"items\":[");
+    for (int i = 0; len < size - 256; i++) {
+        len += snprintf(buf + len, size - len,
+                        "%s{\"id\":%d,\"name\":\"sensor-%d\",\"value\":%d.%02d,"
+                        "\"ok\":%s,\"tags\":[\"a\",\"b\\u00e9\"],\"meta\":null}",
+                        i ? "," : "", i, i, i * 7 % 1000, i % 100, (i & 1) ? "true" : "false");
+    }
+    len += snprintf(buf + len, size - len, "]}");
+    return len;
+}
+
+static bool count_cb(void *ctx, const char *path, json_type_t type, const char *value,
+                     size_t len) {
+    (*(uint32_t *)ctx)++;
+    return true;
+}
+
+static double mb_per_s(size_t bytes, int64_t us) {
+    return us > 0 ? (double)bytes / (double)us : 0.0;  // bytes/us == MB/s
+}
+
+void json_bench_run(void) {
+    char *payload = (char *)heap_caps_malloc(BENCH_PAYLOAD_SIZE, MALLOC_CAP_SPIRAM);
+    json_stream_t *parser = (json_stream_t *)heap_caps_malloc(sizeof(json_stream_t),
+                                                             MALLOC_CAP_INTERNAL);
+    if (payload == NULL || parser == NULL) {
+        ESP_LOGE(TAG, "Out of memory");
+        heap_caps_free(payload);
+        heap_caps_free(parser);
+        return;
+    }
+
+    size_t len = build_payload(payload, BENCH_PAYLOAD_SIZE);
+
+    // Streaming SAX parser, fed in TCP-sized chunks
+    uint32_t values = 0;
+    esp_err_t err = ESP_OK;
+    int64_t start = esp_timer_get_time();
+    for (int it = 0; it < BENCH_ITERATIONS && err == ESP_OK; it++) {
+        json_stream_init(parser, count_cb, &values);
+        for (size_t off = 0; off < len && err == ESP_OK; off += BENCH_CHUNK_SIZE) {
+            size_t n = (len - off < BENCH_CHUNK_SIZE) ? len - off : BENCH_CHUNK_SIZE;
+            err = json_stream_feed(parser, payload + off, n);
+        }
+        if (err == ESP_OK) {
+            err = json_stream_finish(parser);
+        }
+    }
+    int64_t sax_us = esp_timer_get_time() - start;
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SAX parse failed at %u: %s", (unsigned)parser->offset,
+                 esp_err_to_name(err));
+    }
+
+    // cJSON needs the complete document and builds a tree on the heap
+    size_t tree_bytes = 0;
+    start = esp_timer_get_time();
+    for (int it = 0; it < BENCH_ITERATIONS; it++) {
+        size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+        cJSON *root = cJSON_ParseWithLength(payload, len);
+        if (root == NULL) {
+            ESP_LOGE(TAG, "cJSON parse failed");
+            break;
+        }
+        tree_bytes = free_before - heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+        cJSON_Delete(root);
+    }
+    int64_t dom_us = esp_timer_get_time() - start;
+
+    size_t total = len * BENCH_ITERATIONS;
+    ESP_LOGI(TAG, "Payload: %u bytes, %lu values", (unsigned)len,
+             (unsigned long)(values / BENCH_ITERATIONS));
+    ESP_LOGI(TAG, "SAX stream: %.2f MB/s, state %u bytes (fixed)", mb_per_s(total, sax_us),
+             (unsigned)sizeof(json_stream_t));
+    ESP_LOGI(TAG, "cJSON DOM:  %.2f MB/s, tree %u bytes + %u bytes input buffer",
+             mb_per_s(total, dom_us), (unsigned)tree_bytes, (unsigned)len);
+
+    heap_caps_free(parser);
+    heap_caps_free(payload);
+}
@@ -0,0 +1,22 @@
+/**
+ * @file json_bench.h
+ * @brief On-device benchmark: streaming SAX parser vs cJSON (DOM)
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parse a synthetic payload with both parsers and log the results
+ *
+ * Reports throughput (MB/s) and memory: the fixed parser state for the
+ * SAX parser vs the heap consumed by the cJSON tree.
+ */
+void json_bench_run(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,8 +4,17 @@
  *
  * This example demonstrates:
  * - WiFi connection via ESP-HOSTED (C6 co-processor)
- * - HTTP GET request to a public API
- * - Displaying response on the LCD
+ * - Fast reconnect from a cached BSSID/channel/PMK/lease in NVS
+ * - HTTPS GET request to a public API over a keep-alive client pool
+ * - TLS session resumption (session IDs and tickets) on reconnect
+ * - DNS cache with TTLs, background prefetch and NVS persistence
+ * - Requests queued to worker tasks so the UI never blocks on the network
+ * - Per-phase latency (DNS/connect/TLS/TTFB/transfer) with per-host percentiles
+ * - Resumable large-file download to the SD card
+ * - Response cache (PSRAM + SD) with ETag/Last-Modified revalidation
+ * - Streaming the response body into sinks (the LCD is one of them)
+ * - gzip/deflate responses inflated on the fly
+ * - Incremental JSON parsing of the body as it arrives
  * - Connection status and response time
  *
  * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
@@ -29,6 +38,19 @@
 // ESP-HOSTED for WiFi via C6 co-processor
 #include "esp_hosted.h"
 
+// SD card for the persistent cache tier
+#include "sd_service.h"
+
+#include "dns_cache.h"
+#include "http_cache.h"
+#include "http_download.h"
+#include "http_pool.h"
+#include "http_queue.h"
+#include "inflate_bench.h"
+#include "json_bench.h"
+#include "json_stream.h"
+#include "wifi_fast_connect.h"
+
 // BSP includes
 #include "bsp/esp-bsp.h"
 #include "bsp/display.h"
@@ -44,8 +66,35 @@ static const char *TAG = "wifi_http";
 #define WIFI_SSID      "YOUR_WIFI_SSID"
 #define WIFI_PASSWORD  "YOUR_WIFI_PASSWORD"
 
-// API URL for testing (returns JSON with IP info)
-#define HTTP_URL       "http://httpbin.org/ip"
+// Reuse the cached DHCP lease as a static IP on fast reconnect.
+// Only enable on networks where the lease is reserved for this device.
+#define WIFI_FAST_STATIC_IP 0
+
+// API URL for testing (returns JSON with IP info). /cache answers
+// conditional requests with 304 Not Modified. Over HTTPS, reconnects resume
+// the TLS session instead of a full handshake.
+#define HTTP_URL       "https://httpbin.org/cache"
+
+// Keep cached responses on the SD card as well (falls back to PSRAM only
+// if no card is inserted)
+#define HTTP_CACHE_USE_SD   1
+#define HTTP_CACHE_SD_DIR   BSP_SD_MOUNT_POINT "/httpc"
+
+// Keep resolved host names in NVS across reboots
+#define DNS_CACHE_PERSIST   1
+
+// Latency samples are exported here (when the SD card is mounted)
+#define HTTP_TRACE_CSV      BSP_SD_MOUNT_POINT "/httptrc.csv"
+
+// Large file fetched by the Download button (use a server close to you)
+#define DOWNLOAD_URL        "http://speedtest.tele2.net/10MB.zip"
+#define DOWNLOAD_PATH       BSP_SD_MOUNT_POINT "/download.bin"
+
+// Compare the streaming JSON parser against cJSON once after connecting
+#define RUN_JSON_BENCHMARK 0
+
+// Measure gzip inflate throughput and CPU cost once after connecting
+#define RUN_INFLATE_BENCHMARK 0
 
 // ============================================================================
 
@@ -60,16 +109,127 @@ static lv_obj_t *ip_label = NULL;
 static lv_obj_t *response_label = NULL;
 static lv_obj_t *time_label = NULL;
 static lv_obj_t *fetch_btn = NULL;
+static lv_obj_t *download_btn = NULL;
+static lv_obj_t *pool_label = NULL;
+static lv_obj_t *cache_label = NULL;
+static lv_obj_t *phase_label = NULL;
+
+// Fetch in flight (0 if none)
+static http_job_id_t fetch_job = 0;
+
+// Download start, for the throughput shown while it runs
+static int64_t download_start_us = 0;
+
+// SD card, held for the lifetime of the app (see sd_service)
+static bool sd_mounted = false;
 
-// HTTP response buffer
-#define HTTP_BUFFER_SIZE 2048
-static char http_buffer[HTTP_BUFFER_SIZE];
-static int http_buffer_len = 0;
+// Response preview shown on screen. The body itself is streamed through
+// the display sink and never stored in full.
+#define RESPONSE_PREVIEW_LEN 500
+
+typedef struct {
+    char text[RESPONSE_PREVIEW_LEN + 4];  // Preview + "..." + terminator
+    size_t len;
+    size_t total;
+} display_sink_t;
+
+static display_sink_t display_state;
+
+// Fields picked out of the JSON body while it streams in
+typedef struct {
+    json_stream_t parser;
+    json_extract_t extract;
+    json_field_t origin;
+    char origin_buf[64];
+    esp_err_t result;
+} json_sink_t;
+
+static json_sink_t json_state;
 
 // WiFi retry counter
 static int wifi_retry_count = 0;
 #define WIFI_MAX_RETRY 5
 
+// Fast reconnect state
+static esp_netif_t *sta_netif = NULL;
+static wifi_conn_cache_t conn_cache;
+static bool using_cache = false;
+static bool cache_attempt_pending = false;  // Cached connect not yet confirmed
+static bool using_static_ip = false;
+static esp_netif_ip_info_t last_ip_info;
+static int64_t connect_start_us = 0;
+
+/**
+ * @brief Apply the plain (scan-based, DHCP) station configuration
+ */
+static void wifi_apply_full_config(void) {
+    wifi_config_t wifi_config = {};
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+
+/**
+ * @brief Apply the cached configuration: known BSSID/channel, PMK, lease
+ */
+static void wifi_apply_cached_config(void) {
+    wifi_config_t wifi_config = {};
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+
+    // A 64 hex character password is used as the PSK directly, which skips
+    // the 4096-round PBKDF2 on the co-processor (WPA/WPA2-PSK only)
+    bool psk_auth = conn_cache.authmode == WIFI_AUTH_WPA_PSK ||
+                    conn_cache.authmode == WIFI_AUTH_WPA2_PSK ||
+                    conn_cache.authmode == WIFI_AUTH_WPA_WPA2_PSK;
+    if (conn_cache.pmk_valid && psk_auth) {
+        char psk_hex[65];
+        wifi_cache_pmk_to_hex(conn_cache.pmk, psk_hex);
+        memcpy(wifi_config.sta.password, psk_hex, sizeof(wifi_config.sta.password));
+    } else {
+        strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD,
+                sizeof(wifi_config.sta.password) - 1);
+    }
+
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, conn_cache.bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = conn_cache.channel;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+
+#if WIFI_FAST_STATIC_IP
+    if (conn_cache.ip_info.ip.addr != 0) {
+        esp_netif_dhcpc_stop(sta_netif);
+        esp_netif_set_ip_info(sta_netif, &conn_cache.ip_info);
+        esp_netif_dns_info_t dns = {};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4 = conn_cache.dns;
+        esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+        using_static_ip = true;
+    }
+#endif
+}
+
+/**
+ * @brief Drop the cached path and retry with a full scan + DHCP
+ */
+static void wifi_fallback_to_full(void) {
+    ESP_LOGW(TAG, "Cached connect failed, falling back to full scan");
+    using_cache = false;
+    cache_attempt_pending = false;
+    wifi_cache_clear();
+
+    if (using_static_ip) {
+        esp_netif_dhcpc_start(sta_netif);
+        using_static_ip = false;
+    }
+
+    wifi_apply_full_config();
+    wifi_retry_count = 0;
+    esp_wifi_connect();
+}
+
 /**
  * @brief WiFi event handler
  */
@@ -83,7 +243,9 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 break;
 
             case WIFI_EVENT_STA_DISCONNECTED:
-                if (wifi_retry_count < WIFI_MAX_RETRY) {
+                if (cache_attempt_pending) {
+                    wifi_fallback_to_full();
+                } else if (wifi_retry_count < WIFI_MAX_RETRY) {
                     ESP_LOGI(TAG, "WiFi disconnected, retrying (%d/%d)...",
                              wifi_retry_count + 1, WIFI_MAX_RETRY);
                     esp_wifi_connect();
@@ -99,19 +261,68 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        int64_t time_to_ip_ms = (esp_timer_get_time() - connect_start_us) / 1000;
+        const char *path = using_cache ? (using_static_ip ? "cached+static" : "cached") : "cold";
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        ESP_LOGI(TAG, "Time to IP: %lld ms (%s path)", (long long)time_to_ip_ms, path);
+        last_ip_info = event->ip_info;
+        cache_attempt_pending = false;
         wifi_retry_count = 0;
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
 
         // Update IP label
         if (ip_label) {
             bsp_display_lock(0);
-            lv_label_set_text_fmt(ip_label, "IP: " IPSTR, IP2STR(&event->ip_info.ip));
+            lv_label_set_text_fmt(ip_label, "IP: " IPSTR " (%s, %lld ms)",
+                                  IP2STR(&event->ip_info.ip), path, (long long)time_to_ip_ms);
             bsp_display_unlock();
         }
     }
 }
 
+/**
+ * @brief Store the current AP, PMK and lease for the next boot
+ *
+ * Runs after the connection is up so the PMK derivation is off the
+ * critical path.
+ */
+static void wifi_update_cache(void) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+
+    bool had_pmk = using_cache && conn_cache.pmk_valid;
+    uint8_t pmk[32];
+    if (had_pmk) {
+        memcpy(pmk, conn_cache.pmk, sizeof(pmk));
+    }
+
+    wifi_cache_init(&conn_cache, WIFI_SSID, WIFI_PASSWORD);
+    memcpy(conn_cache.bssid, ap_info.bssid, sizeof(conn_cache.bssid));
+    conn_cache.channel = ap_info.primary;
+    conn_cache.authmode = ap_info.authmode;
+    conn_cache.ip_info = last_ip_info;
+
+    esp_netif_dns_info_t dns;
+    if (esp_netif_get_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+        conn_cache.dns = dns.ip.u_addr.ip4;
+    }
+
+    if (had_pmk) {
+        memcpy(conn_cache.pmk, pmk, sizeof(pmk));
+        conn_cache.pmk_valid = true;
+    } else {
+        conn_cache.pmk_valid =
+            (wifi_cache_compute_pmk(WIFI_SSID, WIFI_PASSWORD, conn_cache.pmk) == ESP_OK);
+    }
+
+    esp_err_t ret = wifi_cache_save(&conn_cache);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save connection cache: %s", esp_err_to_name(ret));
+    }
+}
+
 /**
  * @brief Initialize WiFi in station mode and connect
  */
@@ -125,7 +336,7 @@ static esp_err_t wifi_init_and_connect(void) {
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
     // Create default WiFi station
-    esp_netif_create_default_wifi_sta();
+    sta_netif = esp_netif_create_default_wifi_sta();
 
     // Initialize WiFi with default config
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
@@ -137,14 +348,22 @@ static esp_err_t wifi_init_and_connect(void) {
     ESP_ERROR_CHECK(esp_event_handler_instance_register(
         IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
 
-    // Configure WiFi
-    wifi_config_t wifi_config = {};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
-    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
-
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+
+    // Configure WiFi: cached BSSID/channel if available, full scan otherwise
+    using_cache = (wifi_cache_load(WIFI_SSID, WIFI_PASSWORD, &conn_cache) == ESP_OK);
+    if (using_cache) {
+        ESP_LOGI(TAG, "Using cached AP %02x:%02x:%02x:%02x:%02x:%02x on channel %d",
+                 conn_cache.bssid[0], conn_cache.bssid[1], conn_cache.bssid[2],
+                 conn_cache.bssid[3], conn_cache.bssid[4], conn_cache.bssid[5],
+                 conn_cache.channel);
+        wifi_apply_cached_config();
+        cache_attempt_pending = true;
+    } else {
+        wifi_apply_full_config();
+    }
+
+    connect_start_us = esp_timer_get_time();
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "WiFi init complete, waiting for connection...");
@@ -156,6 +375,7 @@ static esp_err_t wifi_init_and_connect(void) {
 
     if (bits & WIFI_CONNECTED_BIT) {
         ESP_LOGI(TAG, "Connected to WiFi SSID: %s", WIFI_SSID);
+        wifi_update_cache();
         return ESP_OK;
     } else if (bits & WIFI_FAIL_BIT) {
         ESP_LOGE(TAG, "Failed to connect to SSID: %s", WIFI_SSID);
@@ -166,26 +386,31 @@ static esp_err_t wifi_init_and_connect(void) {
     }
 }
 
+/**
+ * @brief Mount the SD card for the persistent cache tier
+ */
+static esp_err_t sd_mount(void) {
+    sd_service_config_t cfg = SD_SERVICE_CONFIG_DEFAULT();
+    cfg.mount_point = BSP_SD_MOUNT_POINT;
+    cfg.poll_ms = 0;  // Mounted once at boot, no hot plug
+    esp_err_t ret = sd_service_init(&cfg);
+    if (ret == ESP_OK) {
+        ret = sd_service_acquire(NULL);
+        if (ret != ESP_OK) {
+            sd_service_deinit();  // Powers the slot down again
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No SD card (%s), cache is PSRAM only", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 /**
  * @brief HTTP event handler
  */
 static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     switch (evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // Append data to buffer
-                int copy_len = evt->data_len;
-                if (http_buffer_len + copy_len >= HTTP_BUFFER_SIZE) {
-                    copy_len = HTTP_BUFFER_SIZE - http_buffer_len - 1;
-                }
-                if (copy_len > 0) {
-                    memcpy(http_buffer + http_buffer_len, evt->data, copy_len);
-                    http_buffer_len += copy_len;
-                    http_buffer[http_buffer_len] = '\0';
-                }
-            }
-            break;
-
         case HTTP_EVENT_ON_FINISH:
             ESP_LOGI(TAG, "HTTP request finished");
             break;
@@ -201,99 +426,371 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
 }
 
 /**
- * @brief Perform HTTP GET request
+ * @brief Display sink: keep the first RESPONSE_PREVIEW_LEN bytes for the label
  */
-static esp_err_t http_fetch(void) {
-    ESP_LOGI(TAG, "Fetching: %s", HTTP_URL);
+static esp_err_t display_sink_begin(void *ctx, int status, int64_t content_length) {
+    display_sink_t *d = (display_sink_t *)ctx;
+    d->len = 0;
+    d->total = 0;
+    d->text[0] = '\0';
+    if (content_length < 0) {
+        ESP_LOGI(TAG, "Chunked response, streaming");
+    }
+    return ESP_OK;
+}
 
-    // Clear buffer
-    http_buffer_len = 0;
-    memset(http_buffer, 0, sizeof(http_buffer));
+static esp_err_t display_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    display_sink_t *d = (display_sink_t *)ctx;
+    if (d->len < RESPONSE_PREVIEW_LEN) {
+        size_t n = RESPONSE_PREVIEW_LEN - d->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(d->text + d->len, data, n);
+        d->len += n;
+        d->text[d->len] = '\0';
+    }
+    d->total += len;
+    return ESP_OK;
+}
 
-    // Record start time
-    int64_t start_time = esp_timer_get_time();
+static void display_sink_end(void *ctx, esp_err_t result) {
+    display_sink_t *d = (display_sink_t *)ctx;
+    if (d->total > d->len) {
+        // Truncated for display
+        strcpy(d->text + d->len, "...");
+    }
+}
 
-    // Configure HTTP client
-    esp_http_client_config_t config = {};
-    config.url = HTTP_URL;
-    config.event_handler = http_event_handler;
-    config.timeout_ms = 10000;
+/**
+ * @brief JSON sink: parse the body incrementally and extract "/origin"
+ */
+static esp_err_t json_sink_begin(void *ctx, int status, int64_t content_length) {
+    json_sink_t *j = (json_sink_t *)ctx;
+    j->origin_buf[0] = '\0';
+    j->origin.pointer = "/origin";
+    j->origin.out = j->origin_buf;
+    j->origin.out_size = sizeof(j->origin_buf);
+    j->origin.found = false;
+    j->extract.fields = &j->origin;
+    j->extract.count = 1;
+    j->extract.found = 0;
+    j->result = ESP_ERR_INVALID_STATE;
+    json_stream_init(&j->parser, json_extract_cb, &j->extract);
+    return ESP_OK;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
+static esp_err_t json_sink_data(void *ctx, const uint8_t *data, size_t len) {
+    json_sink_t *j = (json_sink_t *)ctx;
+    // A malformed body is reported but does not abort the transfer
+    if (j->parser.error == ESP_OK) {
+        json_stream_feed(&j->parser, (const char *)data, len);
     }
+    return ESP_OK;
+}
 
-    // Perform request
-    esp_err_t err = esp_http_client_perform(client);
+static void json_sink_end(void *ctx, esp_err_t result) {
+    json_sink_t *j = (json_sink_t *)ctx;
+    if (result == ESP_OK) {
+        j->result = json_stream_finish(&j->parser);
+        if (j->result != ESP_OK) {
+            ESP_LOGW(TAG, "JSON parse failed at byte %u: %s", (unsigned)j->parser.offset,
+                     esp_err_to_name(j->result));
+        }
+    }
+}
 
-    // Calculate elapsed time
-    int64_t elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+/**
+ * @brief Run a function on the LVGL task (used for request completions)
+ */
+static void ui_dispatch(void (*fn)(void *arg), void *arg) {
+    bsp_display_lock(0);
+    lv_async_call(fn, arg);
+    bsp_display_unlock();
+}
 
-    if (err == ESP_OK) {
-        int status = esp_http_client_get_status_code(client);
-        int content_len = esp_http_client_get_content_length(client);
-        ESP_LOGI(TAG, "HTTP Status: %d, Content-Length: %d", status, content_len);
-        ESP_LOGI(TAG, "Response: %s", http_buffer);
+/**
+ * @brief Fetch completion, runs on the LVGL task
+ */
+static void http_fetch_done(const http_job_result_t *job) {
+    const http_cache_result_t *cres = &job->result;
+    esp_err_t err = job->err;
+    fetch_job = 0;
+
+    const char *source = "cold";
+    if (cres->source == HTTP_CACHE_FRESH) {
+        source = "cached";
+    } else if (cres->source == HTTP_CACHE_REVALIDATED) {
+        source = "304";
+    } else if (cres->http.reused) {
+        source = "warm";
+    } else if (cres->http.tls_offered) {
+        source = "offered";
+    }
 
-        // Update UI
-        bsp_display_lock(0);
-        if (status_label) {
+    if (job->cancelled) {
+        ESP_LOGI(TAG, "Fetch cancelled");
+        lv_label_set_text(status_label, "Status: Cancelled");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+    } else if (err == ESP_OK) {
+        int status = cres->source == HTTP_CACHE_NETWORK ? cres->http.status : 200;
+        ESP_LOGI(TAG, "HTTP Status: %d, body: %lu bytes (%s)", status,
+                 (unsigned long)cres->body_bytes, source);
+        ESP_LOGI(TAG, "Response: %s", display_state.text);
+        bool have_origin = json_state.result == ESP_OK && json_state.origin.found;
+        if (have_origin) {
+            ESP_LOGI(TAG, "Origin: %s", json_state.origin_buf);
+            lv_label_set_text_fmt(status_label, "Status: %d OK  Origin: %s", status,
+                                  json_state.origin_buf);
+        } else {
             lv_label_set_text_fmt(status_label, "Status: %d OK", status);
-            lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
-        }
-        if (time_label) {
-            lv_label_set_text_fmt(time_label, "Time: %lld ms", (long long)elapsed_ms);
         }
-        if (response_label) {
-            // Truncate if too long for display
-            if (strlen(http_buffer) > 500) {
-                http_buffer[500] = '\0';
-                strcat(http_buffer, "...");
-            }
-            lv_label_set_text(response_label, http_buffer);
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
+        const http_pool_result_t *http = &cres->http;
+        if (cres->source == HTTP_CACHE_NETWORK && http->compressed && http->body_bytes > 0) {
+            ESP_LOGI(TAG, "Compressed: %lu bytes on the wire for %lu, inflate %lu us",
+                     (unsigned long)http->wire_bytes, (unsigned long)http->body_bytes,
+                     (unsigned long)http->inflate_us);
+            lv_label_set_text_fmt(time_label, "Time: %lu ms (%s, gzip %lu%%)",
+                                  (unsigned long)job->run_ms, source,
+                                  (unsigned long)(http->wire_bytes * 100 / http->body_bytes));
+        } else {
+            lv_label_set_text_fmt(time_label, "Time: %lu ms (%s)", (unsigned long)job->run_ms,
+                                  source);
         }
-        bsp_display_unlock();
-
+        lv_label_set_text(response_label, display_state.text);
     } else {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        lv_label_set_text(status_label, "Status: ERROR");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        lv_label_set_text_fmt(response_label, "Error: %s", esp_err_to_name(err));
+    }
 
-        bsp_display_lock(0);
-        if (status_label) {
-            lv_label_set_text(status_label, "Status: ERROR");
-            lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
-        }
-        if (response_label) {
-            lv_label_set_text_fmt(response_label, "Error: %s", esp_err_to_name(err));
+    // Cold vs warm latency
+    http_pool_stats_t ps;
+    http_pool_get_stats(&ps);
+    uint32_t cold_avg = ps.cold_requests ? (uint32_t)(ps.cold_total_ms / ps.cold_requests) : 0;
+    uint32_t warm_avg = ps.warm_requests ? (uint32_t)(ps.warm_total_ms / ps.warm_requests) : 0;
+    ESP_LOGI(TAG, "Pool: cold avg %lu ms (%lu), warm avg %lu ms (%lu), %d open",
+             (unsigned long)cold_avg, (unsigned long)ps.cold_requests,
+             (unsigned long)warm_avg, (unsigned long)ps.warm_requests, ps.open_clients);
+    if (ps.compressed_responses > 0) {
+        ESP_LOGI(TAG, "Pool: %lu compressed responses, %llu -> %llu bytes, inflate %llu us",
+                 (unsigned long)ps.compressed_responses,
+                 (unsigned long long)ps.compressed_wire_bytes,
+                 (unsigned long long)ps.compressed_body_bytes,
+                 (unsigned long long)ps.inflate_us);
+    }
+    lv_label_set_text_fmt(pool_label, "Cold avg: %lu ms (%lu)  Warm avg: %lu ms (%lu)",
+                          (unsigned long)cold_avg, (unsigned long)ps.cold_requests,
+                          (unsigned long)warm_avg, (unsigned long)ps.warm_requests);
+
+    // Full handshakes vs those that offered a session (accepted or not). Without
+    // the probe both include the TCP connect, which is the same for either
+    const char *tls_measure = HTTP_TRACE_PROBE_TCP ? "handshake" : "TCP + TLS connect";
+    if (ps.tls_full + ps.tls_offered > 0) {
+        ESP_LOGI(TAG, "TLS: full avg %lu ms (%lu), offered avg %lu ms (%lu), %d sessions (%s)",
+                 (unsigned long)(ps.tls_full ? ps.tls_full_ms / ps.tls_full : 0),
+                 (unsigned long)ps.tls_full,
+                 (unsigned long)(ps.tls_offered ? ps.tls_offered_ms / ps.tls_offered : 0),
+                 (unsigned long)ps.tls_offered, ps.tls_sessions, tls_measure);
+    }
+
+    // Hit ratio and bytes the cache kept off the network
+    http_cache_stats_t cs;
+    http_cache_get_stats(&cs);
+    uint32_t hits = cs.fresh_hits + cs.revalidated;
+    uint32_t hit_pct = cs.requests ? hits * 100 / cs.requests : 0;
+    ESP_LOGI(TAG, "Cache: %lu/%lu hits (%lu fresh, %lu 304), saved %llu bytes, "
+             "downloaded %llu bytes, PSRAM %u entries, SD %u entries",
+             (unsigned long)hits, (unsigned long)cs.requests, (unsigned long)cs.fresh_hits,
+             (unsigned long)cs.revalidated, (unsigned long long)cs.bytes_saved,
+             (unsigned long long)cs.bytes_downloaded, cs.mem_entries, cs.sd_entries);
+    lv_label_set_text_fmt(cache_label, "Cache: %lu%% hits (%lu/%lu)  Saved: %llu bytes",
+                          (unsigned long)hit_pct, (unsigned long)hits,
+                          (unsigned long)cs.requests, (unsigned long long)cs.bytes_saved);
+
+    ESP_LOGI(TAG, "Queue: waited %lu ms", (unsigned long)job->wait_ms);
+
+    dns_cache_stats_t ds;
+    dns_cache_get_stats(&ds);
+    ESP_LOGI(TAG, "DNS cache: %lu/%lu hits, %lu prefetched, saved %llu ms (misses took %llu ms)",
+             (unsigned long)ds.hits, (unsigned long)ds.lookups, (unsigned long)ds.prefetches,
+             (unsigned long long)ds.saved_ms, (unsigned long long)ds.miss_ms);
+
+    // Where the time went: this request, and the p90 for the host
+    if (err == ESP_OK && cres->http.status != 0) {
+        const http_phases_t *ph = &cres->http.phases;
+        http_host_summary_t sum;
+        if (http_trace_get_summary(HTTP_URL, &sum) == ESP_OK) {
+            ESP_LOGI(TAG, "%s p50/p90/p99 over %lu: ttfb %lu/%lu/%lu ms, total %lu/%lu/%lu ms",
+                     sum.host, (unsigned long)sum.count, (unsigned long)sum.ttfb.p50,
+                     (unsigned long)sum.ttfb.p90, (unsigned long)sum.ttfb.p99,
+                     (unsigned long)sum.total.p50, (unsigned long)sum.total.p90,
+                     (unsigned long)sum.total.p99);
+            ESP_LOGI(TAG, "%s TLS p50/p90: full %lu/%lu ms, offered %lu/%lu ms (%s)", sum.host,
+                     (unsigned long)sum.tls.p50, (unsigned long)sum.tls.p90,
+                     (unsigned long)sum.tls_offered.p50, (unsigned long)sum.tls_offered.p90,
+                     tls_measure);
+            // Without the probe TLS is part of Conn and has no time of its own
+            char tls[24] = "n/a";
+            if (ph->tls_split) {
+                snprintf(tls, sizeof(tls), "%lu%s", (unsigned long)ph->tls_ms,
+                         ph->tls_offered ? " (offered)" : "");
+            }
+            char dns[32] = "";
+            if (ph->dns_cached) {
+                snprintf(dns, sizeof(dns), " (cached, saved %lu)",
+                         (unsigned long)ph->dns_saved_ms);
+            }
+            lv_label_set_text_fmt(phase_label,
+                                  "DNS %lu%s  Conn %lu  TLS %s  TTFB %lu  Xfer %lu ms  "
+                                  "(p90 %lu ms)",
+                                  (unsigned long)ph->dns_ms, dns,
+                                  (unsigned long)ph->connect_ms, tls, (unsigned long)ph->ttfb_ms,
+                                  (unsigned long)ph->transfer_ms, (unsigned long)sum.total.p90);
         }
-        bsp_display_unlock();
     }
 
-    esp_http_client_cleanup(client);
+    lv_label_set_text(lv_obj_get_child(fetch_btn, 0), "Fetch");
+}
+
+/**
+ * @brief Queue an HTTP GET request, the result arrives in http_fetch_done()
+ */
+static esp_err_t http_fetch(void) {
+    ESP_LOGI(TAG, "Fetching: %s", HTTP_URL);
+
+    // Sinks must outlive the call, the request runs on a worker task
+    static http_body_sink_t display_sink;
+    static http_body_sink_t json_sink;
+    static http_tee_sink_t tee;
+    static http_body_sink_t sink;
+
+    display_sink.on_begin = display_sink_begin;
+    display_sink.on_data = display_sink_data;
+    display_sink.on_end = display_sink_end;
+    display_sink.ctx = &display_state;
+
+    json_sink.on_begin = json_sink_begin;
+    json_sink.on_data = json_sink_data;
+    json_sink.on_end = json_sink_end;
+    json_sink.ctx = &json_state;
+
+    // Preview and parse the body in a single pass
+    tee.a = &display_sink;
+    tee.b = &json_sink;
+    sink = http_sink_tee(&tee);
+
+    // Served from cache when fresh, revalidated over a pooled (keep-alive)
+    // client otherwise
+    http_job_t job = {};
+    job.req.url = HTTP_URL;
+    job.req.method = HTTP_METHOD_GET;
+    job.req.event_handler = http_event_handler;
+    job.req.sink = &sink;
+    job.req.timeout_ms = 10000;
+    job.req.accept_encoding = true;
+    job.use_cache = true;
+    job.priority = HTTP_PRIO_HIGH;  // User initiated
+    job.on_done = http_fetch_done;
+
+    bsp_display_lock(0);
+    esp_err_t err = http_queue_submit(&job, &fetch_job);
+    if (err == ESP_OK) {
+        lv_label_set_text(status_label, "Status: Fetching...");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+        lv_label_set_text(lv_obj_get_child(fetch_btn, 0), "Cancel");
+    } else {
+        ESP_LOGE(TAG, "Failed to queue request: %s", esp_err_to_name(err));
+    }
+    bsp_display_unlock();
     return err;
 }
 
 /**
- * @brief Fetch button click callback
+ * @brief Fetch button click callback: start a fetch, or cancel the running one
  */
 static void fetch_btn_click_cb(lv_event_t *e) {
+    if (fetch_job != 0) {
+        ESP_LOGI(TAG, "Cancel button clicked");
+        http_queue_cancel(fetch_job);
+        return;
+    }
+
     ESP_LOGI(TAG, "Fetch button clicked");
 
-    // Disable button during fetch
-    lv_obj_add_state(fetch_btn, LV_STATE_DISABLED);
+    // Perform HTTP request in the background
+    http_fetch();
+}
+
+/**
+ * @brief Download progress, called from the download task
+ */
+static void download_progress(void *ctx, int64_t received, int64_t total) {
+    int64_t elapsed_us = esp_timer_get_time() - download_start_us;
+    uint32_t kb_per_s = elapsed_us > 0 ? (uint32_t)(received * 1000000 / 1024 / elapsed_us) : 0;
 
-    // Update status
     bsp_display_lock(0);
-    lv_label_set_text(status_label, "Status: Fetching...");
-    lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+    if (total > 0) {
+        lv_label_set_text_fmt(status_label, "Download: %d%% (%lu KB/s)",
+                              (int)(received * 100 / total), (unsigned long)kb_per_s);
+    } else {
+        lv_label_set_text_fmt(status_label, "Download: %lld KB (%lu KB/s)",
+                              (long long)(received / 1024), (unsigned long)kb_per_s);
+    }
     bsp_display_unlock();
+}
 
-    // Perform HTTP request
-    http_fetch();
+/**
+ * @brief Download DOWNLOAD_URL to the SD card, resuming a partial file
+ */
+static void download_task(void *arg) {
+    http_download_config_t cfg = HTTP_DOWNLOAD_CONFIG_DEFAULT();
+    cfg.url = DOWNLOAD_URL;
+    cfg.path = DOWNLOAD_PATH;
+    cfg.progress = download_progress;
 
-    // Re-enable button
-    lv_obj_clear_state(fetch_btn, LV_STATE_DISABLED);
+    download_start_us = esp_timer_get_time();
+    http_download_result_t res = {};
+    esp_err_t err = http_download(&cfg, &res);
+
+    bsp_display_lock(0);
+    if (err == ESP_OK) {
+        lv_label_set_text_fmt(status_label, "Download: %lld KB, %lu KB/s",
+                              (long long)(res.bytes / 1024), (unsigned long)res.kb_per_s);
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
+        lv_label_set_text_fmt(phase_label, "SD write %lu ms, net stalled %lu ms, idle %lu ms",
+                              (unsigned long)res.write_ms, (unsigned long)res.net_stall_ms,
+                              (unsigned long)res.writer_idle_ms);
+    } else {
+        lv_label_set_text_fmt(status_label, "Download failed: %s", esp_err_to_name(err));
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+    }
+    lv_obj_clear_state(download_btn, LV_STATE_DISABLED);
+    bsp_display_unlock();
+
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Download button click callback
+ */
+static void download_btn_click_cb(lv_event_t *e) {
+    ESP_LOGI(TAG, "Download button clicked");
+
+    if (!sd_mounted) {
+        lv_label_set_text(status_label, "Download: no SD card");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        return;
+    }
+
+    // Runs on its own task; the SD writer gets another one
+    if (xTaskCreate(download_task, "download", 6144, NULL, 4, NULL) == pdPASS) {
+        lv_obj_add_state(download_btn, LV_STATE_DISABLED);
+        lv_label_set_text(status_label, "Download: starting...");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+    }
 }
 
 /**
@@ -346,16 +843,47 @@ static void create_ui(void) {
     // Fetch button
     fetch_btn = lv_btn_create(scr);
     lv_obj_set_size(fetch_btn, 150, 50);
-    lv_obj_align(fetch_btn, LV_ALIGN_TOP_MID, 0, 160);
+    lv_obj_align(fetch_btn, LV_ALIGN_TOP_MID, -85, 160);
     lv_obj_add_event_cb(fetch_btn, fetch_btn_click_cb, LV_EVENT_CLICKED, NULL);
 
     lv_obj_t *btn_label = lv_label_create(fetch_btn);
     lv_label_set_text(btn_label, "Fetch");
     lv_obj_center(btn_label);
 
+    // Download button
+    download_btn = lv_btn_create(scr);
+    lv_obj_set_size(download_btn, 150, 50);
+    lv_obj_align(download_btn, LV_ALIGN_TOP_MID, 85, 160);
+    lv_obj_add_event_cb(download_btn, download_btn_click_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *dl_label = lv_label_create(download_btn);
+    lv_label_set_text(dl_label, "Download");
+    lv_obj_center(dl_label);
+
+    // Connection pool statistics
+    pool_label = lv_label_create(scr);
+    lv_label_set_text(pool_label, "Cold avg: --- ms  Warm avg: --- ms");
+    lv_obj_set_style_text_color(pool_label, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_text_font(pool_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(pool_label, LV_ALIGN_TOP_LEFT, 10, 225);
+
+    // Cache statistics
+    cache_label = lv_label_create(scr);
+    lv_label_set_text(cache_label, "Cache: ---");
+    lv_obj_set_style_text_color(cache_label, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_text_font(cache_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(cache_label, LV_ALIGN_TOP_LEFT, 10, 245);
+
+    // Latency breakdown of the last request
+    phase_label = lv_label_create(scr);
+    lv_label_set_text(phase_label, "DNS -  Conn -  TLS -  TTFB -  Xfer - ms");
+    lv_obj_set_style_text_color(phase_label, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_text_font(phase_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(phase_label, LV_ALIGN_TOP_LEFT, 10, 265);
+
     // Response container
     lv_obj_t *response_container = lv_obj_create(scr);
-    lv_obj_set_size(response_container, LV_PCT(95), 520);
+    lv_obj_set_size(response_container, LV_PCT(95), 470);
     lv_obj_align(response_container, LV_ALIGN_BOTTOM_MID, 0, -20);
     lv_obj_set_style_bg_color(response_container, lv_color_hex(0x16213e), 0);
     lv_obj_set_style_border_width(response_container, 0, 0);
@@ -439,6 +967,22 @@ extern "C" void app_main(void) {
     // Wait for transport to stabilize
     vTaskDelay(pdMS_TO_TICKS(500));
 
+    // Host names are resolved through the cache from here on
+    ESP_ERROR_CHECK(dns_cache_init(DNS_CACHE_PERSIST));
+    ESP_ERROR_CHECK(http_pool_init());
+
+#if HTTP_CACHE_USE_SD
+    sd_mounted = (sd_mount() == ESP_OK);
+    ESP_ERROR_CHECK(http_cache_init(sd_mounted ? HTTP_CACHE_SD_DIR : NULL));
+#else
+    ESP_ERROR_CHECK(http_cache_init(NULL));
+#endif
+
+    // Requests run on worker tasks, completions come back on the LVGL task
+    http_queue_config_t queue_cfg = HTTP_QUEUE_CONFIG_DEFAULT();
+    queue_cfg.dispatch = ui_dispatch;
+    ESP_ERROR_CHECK(http_queue_init(&queue_cfg));
+
     // Initialize WiFi and connect
     ret = wifi_init_and_connect();
     if (ret != ESP_OK) {
@@ -455,6 +999,13 @@ extern "C" void app_main(void) {
         lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
         bsp_display_unlock();
 
+#if RUN_JSON_BENCHMARK
+        json_bench_run();
+#endif
+#if RUN_INFLATE_BENCHMARK
+        inflate_bench_run();
+#endif
+
         // Do initial fetch
         vTaskDelay(pdMS_TO_TICKS(1000));
         http_fetch();
@@ -465,8 +1016,28 @@ extern "C" void app_main(void) {
     ESP_LOGI(TAG, "========================================");
 
     // Main loop
+    uint32_t exported_samples = 0;
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(5000));
+        http_pool_evict_idle();
+
+        // Keep the latency CSV on the SD card up to date
+        uint32_t samples = http_trace_sample_count();
+        if (sd_mounted && samples != exported_samples) {
+            FILE *f = fopen(HTTP_TRACE_CSV, "w");
+            if (f != NULL) {
+                http_trace_export_csv(f);
+                fclose(f);
+                exported_samples = samples;
+            }
+        }
+
+        http_queue_stats_t qs;
+        http_queue_get_stats(&qs);
+        ESP_LOGI(TAG, "Queue: %u pending (max %u), %u running, avg wait %lu ms, max %lu ms",
+                 qs.pending, qs.max_pending, qs.running,
+                 (unsigned long)(qs.started ? qs.total_wait_ms / qs.started : 0),
+                 (unsigned long)qs.max_wait_ms);
         ESP_LOGI(TAG, "Free heap: %lu bytes", (unsigned long)esp_get_free_heap_size());
     }
 }
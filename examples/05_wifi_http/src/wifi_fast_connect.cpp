@@ -0,0 +1,111 @@
+/**
+ * @file wifi_fast_connect.cpp
+ * @brief Connection-state cache in NVS for fast WiFi reconnect
+ */
+
+#include "wifi_fast_connect.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
+#include "nvs.h"
+
+static const char *TAG = "wifi_cache";
+
+#define CACHE_NAMESPACE "wifi_cache"
+#define CACHE_KEY       "conn"
+#define CACHE_VERSION   1
+
+static uint32_t password_crc(const char *password) {
+    return esp_rom_crc32_le(0, (const uint8_t *)password, strlen(password));
+}
+
+void wifi_cache_init(wifi_conn_cache_t *cache, const char *ssid, const char *password) {
+    memset(cache, 0, sizeof(*cache));
+    cache->version = CACHE_VERSION;
+    strncpy(cache->ssid, ssid, sizeof(cache->ssid) - 1);
+    cache->password_crc = password_crc(password);
+}
+
+esp_err_t wifi_cache_load(const char *ssid, const char *password, wifi_conn_cache_t *out) {
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    size_t len = sizeof(*out);
+    ret = nvs_get_blob(nvs, CACHE_KEY, out, &len);
+    nvs_close(nvs);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (len != sizeof(*out) || out->version != CACHE_VERSION ||
+        strncmp(out->ssid, ssid, sizeof(out->ssid)) != 0 ||
+        out->password_crc != password_crc(password) || out->channel == 0) {
+        ESP_LOGI(TAG, "Cached state is stale, ignoring");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t wifi_cache_save(const wifi_conn_cache_t *cache) {
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = nvs_set_blob(nvs, CACHE_KEY, cache, sizeof(*cache));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t wifi_cache_clear(void) {
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = nvs_erase_key(nvs, CACHE_KEY);
+    if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t wifi_cache_compute_pmk(const char *ssid, const char *password, uint8_t pmk[32]) {
+    int rc = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA1,
+                                           (const unsigned char *)password, strlen(password),
+                                           (const unsigned char *)ssid, strlen(ssid),
+                                           4096, 32, pmk);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "PMK derivation failed: -0x%04x", -rc);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void wifi_cache_pmk_to_hex(const uint8_t pmk[32], char *out) {
+    for (int i = 0; i < 32; i++) {
+        sprintf(out + i * 2, "%02x", pmk[i]);
+    }
+    out[64] = '\0';
+}
@@ -0,0 +1,105 @@
+/**
+ * @file wifi_fast_connect.h
+ * @brief Connection-state cache in NVS for fast WiFi reconnect
+ *
+ * After a successful connection the BSSID, channel, auth mode, PMK and
+ * DHCP lease are stored in NVS. On the next boot the station can connect
+ * directly to the known BSSID on the known channel (no all-channel scan),
+ * skip PBKDF2 by passing the cached PMK, and optionally reuse the lease
+ * as a static IP instead of waiting for DHCP.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cached connection state (stored as a single NVS blob)
+ */
+typedef struct {
+    uint32_t version;
+    char ssid[33];
+    uint32_t password_crc;     // Detects credential changes
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;          // wifi_auth_mode_t
+    bool pmk_valid;
+    uint8_t pmk[32];
+    esp_netif_ip_info_t ip_info;
+    esp_ip4_addr_t dns;
+} wifi_conn_cache_t;
+
+/**
+ * @brief Load the cache for the given credentials
+ *
+ * @param ssid: SSID the cache must belong to
+ * @param password: Password the cache must have been created with
+ * @param out: Loaded cache
+ *
+ * @return
+ *    - ESP_OK: Cache found and matches the credentials
+ *    - ESP_ERR_NOT_FOUND: No cache, or it belongs to other credentials
+ *    - Others: NVS error
+ */
+esp_err_t wifi_cache_load(const char *ssid, const char *password, wifi_conn_cache_t *out);
+
+/**
+ * @brief Store the cache in NVS
+ *
+ * @param cache: Cache to store
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: NVS error
+ */
+esp_err_t wifi_cache_save(const wifi_conn_cache_t *cache);
+
+/**
+ * @brief Erase the cache (e.g. after a failed cached connect)
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: NVS error
+ */
+esp_err_t wifi_cache_clear(void);
+
+/**
+ * @brief Fill identity fields (SSID, password CRC, version) of a cache
+ *
+ * @param cache: Cache to initialize
+ * @param ssid: Network SSID
+ * @param password: Network password
+ */
+void wifi_cache_init(wifi_conn_cache_t *cache, const char *ssid, const char *password);
+
+/**
+ * @brief Derive the WPA2 PMK (PBKDF2-SHA1, 4096 rounds) for SSID/password
+ *
+ * @param ssid: Network SSID
+ * @param password: Network passphrase
+ * @param pmk: Output, 32 bytes
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_FAIL: Derivation failed
+ */
+esp_err_t wifi_cache_compute_pmk(const char *ssid, const char *password, uint8_t pmk[32]);
+
+/**
+ * @brief Format a PMK as the 64 hex character PSK accepted by sta.password
+ *
+ * @param pmk: 32 byte PMK
+ * @param out: Output buffer, at least 65 bytes
+ */
+void wifi_cache_pmk_to_hex(const uint8_t pmk[32], char *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief CRC-32 as in the ESP ROM for building the SD modules on Linux
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Same result as esp_rom_crc32_le(): zlib CRC-32, chainable
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c >> 1) ^ (0xEDB88320 & (0 - (c & 1)));
+            }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
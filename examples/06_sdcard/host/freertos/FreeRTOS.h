@@ -0,0 +1,16 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Minimal FreeRTOS.h for building the SD modules on Linux
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define portMAX_DELAY   ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
@@ -0,0 +1,540 @@
+/**
+ * @file sd_bench.cpp
+ * @brief Linux bench for the SD modules of the SD card example
+ *
+ * IO mode runs the sweep of src/sd_io_bench.cpp against a test file,
+ * for example on a card in a USB reader (the page cache makes reads of a
+ * file just written look fast; use a file larger than RAM or drop caches).
+ *
+ * Rec mode records to a new file with fwrite(), fwrite() with a large
+ * stdio buffer and src/sd_writer.cpp (preallocated, whole-cluster writes)
+ * and compares the worst-case append latency. Linux takes the POSIX path
+ * of the writer, with posix_fallocate() for the reservation.
+ *
+ * Ringlog mode appends small records with fopen() / fprintf() / fclose(),
+ * with src/sd_log.cpp flushed after each record and batched, then times
+ * the recovery scan of a wrapped log. It also checks crash tolerance on
+ * the file image: one block in the middle of the last batch is torn, with
+ * the rest of the batch either written or still old, and the log must
+ * reopen with every record before the torn block, consecutive, and keep
+ * appending after it.
+ *
+ * Index mode fills directories with 10, 1,000 and 10,000 files and times
+ * a listing with stat() per entry, with d_type only and through
+ * src/sd_index.cpp (first page cold, then a page from the cache).
+ * Linux takes the portable readdir() path; the FatFs fast path only
+ * exists on the device.
+ *
+ * Catalog mode fills a music / photos / docs tree (20,000 files by
+ * default), builds the src/sd_catalog.cpp index of it, reopens the index
+ * file and times a lookup, a prefix page, a name substring and a type
+ * query, then the same substring search by walking the tree. The walk and
+ * the index must find the same number of matches.
+ *
+ * Browse mode lists the index mode directories through src/sd_browser.cpp
+ * by name, largest first and newest first: time to the first page, time
+ * to the final order, and whether every page came back in order. Above
+ * 2,048 entries the sort spills runs to <dir>/.browse and merges them.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -o sd_bench host/sd_bench.cpp \
+ *       src/sd_browser.cpp src/sd_browser_bench.cpp src/sd_catalog.cpp src/sd_catalog_bench.cpp \
+ *       src/sd_index.cpp src/sd_index_bench.cpp src/sd_io_bench.cpp \
+ *       src/sd_log.cpp src/sd_log_bench.cpp src/sd_writer.cpp \
+ *       src/sd_writer_bench.cpp -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sd_browser.h"
+#include "sd_browser_bench.h"
+#include "sd_catalog_bench.h"
+#include "sd_index.h"
+#include "sd_index_bench.h"
+#include "sd_io_bench.h"
+#include "sd_log_bench.h"
+#include "sd_writer_bench.h"
+
+int esp_log_verbose = 0;
+
+#define DEFAULT_DIR "/tmp/sd_bench"
+#define PAGE_SIZE   15
+#define IO_FILE_SIZE (4 * 1024 * 1024)
+#define IO_BUDGET_MS 5000
+#define REC_CHUNK    4096
+#define REC_TOTAL    (32 * 1024 * 1024)
+#define LOG_RECORDS  5000
+#define LOG_RECORD   64
+#define LOG_SIZE     (1024 * 1024)
+#define CRASH_LOG_SIZE (256 * 1024)
+#define CAT_FILES    20000
+#define CAT_STEP_MS  50
+#define BROWSE_STEP_MS 20
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "  -m <mode>     index (default), io, rec, ringlog, catalog or browse\n"
+            "  -d <dir>      Scratch directory (default %s)\n"
+            "  -n <count>    index, browse: directory size, repeatable (default 10, 1000, 10000);\n"
+            "                catalog: files in the tree (default 20000)\n"
+            "  -s <bytes>    io: test file size (default 4 MB); rec: recording size (32 MB);\n"
+            "                ringlog: log size (1 MB)\n"
+            "  -c <file>     io: also write CSV to this file\n"
+            "  -v            Log steps\n",
+            prog, DEFAULT_DIR);
+}
+
+static int run_index(const char *base, const uint32_t *counts, size_t n_counts) {
+    sd_index_config_t cfg = SD_INDEX_CONFIG_DEFAULT();
+    cfg.mount_point = base;
+    cfg.fatfs_drive = NULL;
+    sd_index_t *idx = NULL;
+    if (sd_index_create(&cfg, &idx) != ESP_OK) {
+        return 1;
+    }
+
+    mkdir(base, 0755);
+    printf("%8s %10s %10s %10s %10s %10s\n", "entries", "stat us", "/entry", "d_type us",
+           "cold us", "page us");
+
+    int failed = 0;
+    for (size_t i = 0; i < n_counts; i++) {
+        char dir[256];
+        snprintf(dir, sizeof(dir), "%s/d%lu", base, (unsigned long)counts[i]);
+        sd_index_bench_result_t r;
+        if (sd_index_bench_prepare(dir, counts[i]) != ESP_OK ||
+            sd_index_bench_run(idx, dir, PAGE_SIZE, &r) != ESP_OK) {
+            fprintf(stderr, "%s failed\n", dir);
+            failed = 1;
+            continue;
+        }
+        printf("%8lu %10lu %10.2f %10lu %10lu %10lu\n", (unsigned long)r.entries,
+               (unsigned long)r.stat_us,
+               r.stat_entries ? (double)r.stat_us / r.stat_entries : 0.0,
+               (unsigned long)r.dtype_us, (unsigned long)r.index_cold_us,
+               (unsigned long)r.index_page_us);
+    }
+
+    sd_index_stats_t st;
+    sd_index_get_stats(idx, &st);
+    printf("\nIndex: %lu loads, %lu hits, %lu stat() calls, %lu bytes cached\n",
+           (unsigned long)st.loads, (unsigned long)st.hits, (unsigned long)st.stat_calls,
+           (unsigned long)st.cached_bytes);
+    sd_index_destroy(idx);
+    return failed;
+}
+
+static int run_io(const char *base, uint32_t file_size, const char *csv_path) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/sdperf.bin", base);
+    mkdir(base, 0755);
+
+    FILE *csv = NULL;
+    if (csv_path && (csv = fopen(csv_path, "w")) == NULL) {
+        perror(csv_path);
+        return 1;
+    }
+    if (csv) {
+        sd_io_bench_csv_header(csv);
+    }
+
+    static sd_io_params_t plan[SD_IO_PLAN_MAX];
+    size_t n = sd_io_bench_plan(file_size, IO_BUDGET_MS, plan);
+    printf("%-28s %8s %9s %7s %7s %7s %7s\n", "run", "MB/s", "IOPS", "avg us", "p50 us",
+           "p99 us", "max us");
+
+    int failed = 0;
+    for (size_t i = 0; i < n; i++) {
+        char name[40];
+        sd_io_bench_describe(&plan[i], name, sizeof(name));
+        sd_io_result_t r;
+        esp_err_t err = sd_io_bench_run(path, &plan[i], &r);
+        if (err != ESP_OK) {
+            printf("%-28s %s\n", name, esp_err_to_name(err));
+            failed = 1;
+            continue;
+        }
+        printf("%-28s %8.2f %9.0f %7lu %7lu %7lu %7lu\n", name, r.mb_per_s, r.iops,
+               (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p50_us,
+               (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us);
+        if (csv) {
+            sd_io_bench_csv_row(csv, &plan[i], &r);
+        }
+    }
+
+    if (csv) {
+        fclose(csv);
+    }
+    unlink(path);
+    return failed;
+}
+
+static int run_rec(const char *base, uint32_t total) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/rec.bin", base);
+    mkdir(base, 0755);
+
+    sd_writer_config_t wcfg = SD_WRITER_CONFIG_DEFAULT();
+    wcfg.mount_point = base;
+    printf("%-12s %8s %7s %7s %7s %7s %9s\n", "method", "MB/s", "avg us", "p50 us", "p99 us",
+           "max us", "close us");
+
+    int failed = 0;
+    for (int m = 0; m < SD_REC_METHOD_COUNT; m++) {
+        sd_rec_params_t p = {(sd_rec_method_t)m, REC_CHUNK, total};
+        sd_io_result_t r;
+        sd_writer_stats_t ws = {};
+        esp_err_t err = sd_writer_bench_run(path, &p, &wcfg, &r, &ws);
+        const char *name = sd_writer_bench_method_name(p.method);
+        if (err != ESP_OK) {
+            printf("%-12s %s\n", name, esp_err_to_name(err));
+            failed = 1;
+            continue;
+        }
+        printf("%-12s %8.2f %7lu %7lu %7lu %7lu %9lu\n", name, r.mb_per_s,
+               (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p50_us,
+               (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us,
+               (unsigned long)r.sync_us);
+        if (p.method == SD_REC_WRITER) {
+            printf("\nWriter: cluster %lu, buffer %lu, reserved %llu, %lu flushes, "
+                   "max flush %lu us\n",
+                   (unsigned long)ws.cluster_size, (unsigned long)ws.buffer_size,
+                   (unsigned long long)ws.reserved, (unsigned long)ws.flushes,
+                   (unsigned long)ws.flush_max_us);
+        }
+    }
+    return failed;
+}
+
+static bool read_image(const char *path, uint8_t **data, long *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    *data = (uint8_t *)malloc(*size);
+    bool ok = *data && fread(*data, 1, *size, f) == (size_t)*size;
+    fclose(f);
+    return ok;
+}
+
+static bool write_image(const char *path, const uint8_t *data, long size) {
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fwrite(data, 1, size, f) == (size_t)size;
+    return f && fclose(f) == 0 && ok;
+}
+
+// Appends records first..last and closes the log
+static bool append_records(const char *path, const sd_log_config_t *cfg, uint32_t first,
+                           uint32_t last) {
+    sd_log_t *log = NULL;
+    if (sd_log_open(path, cfg, &log) != ESP_OK) {
+        return false;
+    }
+    uint8_t rec[LOG_RECORD];
+    uint32_t seq = 0;
+    bool ok = true;
+    for (uint32_t i = first; i <= last && ok; i++) {
+        sd_log_bench_record(i, rec, sizeof(rec));
+        ok = sd_log_append(log, rec, sizeof(rec), &seq) == ESP_OK && seq == i;
+    }
+    return sd_log_close(log) == ESP_OK && ok;
+}
+
+// Reopens the log and reads it back; the records must be consecutive
+// with the content written
+static bool check_log(const char *path, const sd_log_config_t *cfg, sd_log_stats_t *st,
+                      uint32_t *records) {
+    sd_log_t *log = NULL;
+    if (sd_log_open(path, cfg, &log) != ESP_OK) {
+        return false;
+    }
+    sd_log_get_stats(log, st);
+    uint8_t buf[512];
+    uint8_t expect[LOG_RECORD];
+    sd_log_cursor_t cur;
+    sd_log_cursor_init(&cur, 0);
+    size_t len = 0;
+    uint32_t seq = 0;
+    uint32_t n = 0;
+    bool ok = !st->created;
+    while (ok && sd_log_read(log, &cur, buf, sizeof(buf), &len, &seq) == ESP_OK) {
+        sd_log_bench_record(seq, expect, sizeof(expect));
+        ok = seq == st->first_seq + n && len == sizeof(expect) && memcmp(buf, expect, len) == 0;
+        n++;
+    }
+    *records = n;
+    sd_log_close(log);
+    return ok && st->first_seq + n == st->next_seq;
+}
+
+// Tears one block in the middle of the last batch, the blocks after it
+// either written (`rest_written`) or still holding the old content
+static bool crash_test(const char *path, bool rest_written) {
+    sd_log_config_t cfg = SD_LOG_CONFIG_DEFAULT();
+    cfg.size = CRASH_LOG_SIZE;
+    cfg.flush_ms = 0;
+    unlink(path);
+
+    // Past one wrap, then one more batch and a partial block
+    uint32_t per_block = 512 / (LOG_RECORD + 2);
+    uint32_t blocks = CRASH_LOG_SIZE / 512 - 1;
+    uint32_t before = per_block * blocks * 3 / 2;
+    uint32_t batch = per_block * (cfg.batch_blocks + 1);
+    uint8_t *old_img = NULL;
+    uint8_t *img = NULL;
+    long old_size = 0;
+    long size = 0;
+    bool ok = append_records(path, &cfg, 1, before) && read_image(path, &old_img, &old_size) &&
+              append_records(path, &cfg, before + 1, before + batch) &&
+              read_image(path, &img, &size) && size == old_size;
+
+    // Blocks the last session changed
+    long changed[64];
+    int n_changed = 0;
+    for (long b = 0; ok && b < size / 512 && n_changed < 64; b++) {
+        if (memcmp(img + b * 512, old_img + b * 512, 512) != 0) {
+            changed[n_changed++] = b;
+        }
+    }
+    ok = ok && n_changed >= (int)cfg.batch_blocks;
+
+    // The block that tears, and the first record it holds
+    long torn = ok ? changed[n_changed / 2] : 0;
+    uint32_t torn_seq = before + 1 + (uint32_t)(n_changed / 2) * per_block;
+    if (ok) {
+        img[torn * 512 + 100] ^= 0xFF;
+        for (int i = n_changed / 2 + 1; !rest_written && i < n_changed; i++) {
+            memcpy(img + changed[i] * 512, old_img + changed[i] * 512, 512);
+        }
+        ok = write_image(path, img, size);
+    }
+
+    // Everything before the torn block survives, nothing after it
+    sd_log_stats_t st = {};
+    uint32_t records = 0;
+    ok = ok && check_log(path, &cfg, &st, &records) && st.next_seq == torn_seq &&
+         st.torn_blocks == 1 && (st.discarded_blocks > 0) == rest_written;
+    printf("torn batch, rest %-7s %s: records %lu..%lu, %lu torn, %lu discarded\n",
+           rest_written ? "written" : "old", ok ? "ok" : "FAIL", (unsigned long)st.first_seq,
+           (unsigned long)(st.next_seq - 1), (unsigned long)st.torn_blocks,
+           (unsigned long)st.discarded_blocks);
+
+    // Appending carries on from the torn block
+    uint32_t next = st.next_seq;
+    bool cont = ok && append_records(path, &cfg, next, next + batch) &&
+                check_log(path, &cfg, &st, &records) && st.next_seq == next + batch + 1 &&
+                st.torn_blocks == 0;
+    printf("appending after recovery   %s: records %lu..%lu\n", cont ? "ok" : "FAIL",
+           (unsigned long)st.first_seq, (unsigned long)(st.next_seq - 1));
+
+    free(old_img);
+    free(img);
+    unlink(path);
+    return ok && cont;
+}
+
+static int run_ringlog(const char *base, uint32_t log_size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/ring.log", base);
+    mkdir(base, 0755);
+
+    sd_log_config_t cfg = SD_LOG_CONFIG_DEFAULT();
+    cfg.size = log_size;
+    printf("%-10s %9s %7s %7s %7s %7s %9s\n", "method", "rec/s", "avg us", "p50 us",
+           "p99 us", "max us", "close us");
+
+    int failed = 0;
+    for (int m = 0; m < SD_LOG_BENCH_METHOD_COUNT; m++) {
+        sd_log_bench_params_t p = {(sd_log_bench_method_t)m, LOG_RECORDS, LOG_RECORD, 10000};
+        sd_io_result_t r;
+        esp_err_t err = sd_log_bench_run(path, &p, &cfg, &r);
+        const char *name = sd_log_bench_method_name(p.method);
+        if (err != ESP_OK) {
+            printf("%-10s %s\n", name, esp_err_to_name(err));
+            failed = 1;
+            continue;
+        }
+        printf("%-10s %9.0f %7lu %7lu %7lu %7lu %9lu\n", name, r.iops,
+               (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p50_us,
+               (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us,
+               (unsigned long)r.sync_us);
+    }
+
+    sd_log_recovery_result_t rr;
+    esp_err_t err = sd_log_bench_recovery(path, &cfg, LOG_RECORD, &rr);
+    if (err != ESP_OK || !rr.verified) {
+        failed = 1;
+    }
+    printf("\nRecovery: %lu blocks scanned in %lu us, %lu records read back in %lu us, %s\n\n",
+           (unsigned long)rr.blocks, (unsigned long)rr.open_us, (unsigned long)rr.records,
+           (unsigned long)rr.read_us, err != ESP_OK ? esp_err_to_name(err)
+                                      : rr.verified ? "ok" : "FAIL");
+
+    if (!crash_test(path, true) || !crash_test(path, false)) {
+        failed = 1;
+    }
+    return failed;
+}
+
+static int run_catalog(const char *base, uint32_t count) {
+    char tree[256];
+    char index_path[256];
+    snprintf(tree, sizeof(tree), "%s/cat", base);
+    snprintf(index_path, sizeof(index_path), "%s/cat.idx", base);
+    mkdir(base, 0755);
+    if (sd_catalog_bench_prepare(tree, count) != ESP_OK) {
+        fprintf(stderr, "%s failed\n", tree);
+        return 1;
+    }
+
+    sd_catalog_config_t cfg = SD_CATALOG_CONFIG_DEFAULT();
+    cfg.mount_point = base;
+    cfg.root = "/cat";
+    cfg.index_path = index_path;
+    sd_catalog_bench_params_t p = {"/cat/music/a001/t00050.mp3", "/cat/music/a001/", "0042",
+                                   CAT_STEP_MS};
+    sd_catalog_bench_result_t r;
+    esp_err_t err = sd_catalog_bench_run(&cfg, &p, &r);
+    if (err != ESP_OK) {
+        printf("catalog: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+
+    printf("Index: %lu entries, %lu dirs, %lu bytes on disk\n\n", (unsigned long)r.entries,
+           (unsigned long)r.dirs, (unsigned long)r.file_bytes);
+    printf("%-22s %10s %8s\n", "operation", "us", "matches");
+    printf("%-22s %10lu %8s\n", "build (walk + sort)", (unsigned long)r.build_us, "");
+    printf("%-22s %10lu %8s\n", "save", (unsigned long)r.save_us, "");
+    printf("%-22s %10lu %8s\n", r.load_current ? "load" : "load (volume changed)",
+           (unsigned long)r.load_us, "");
+    printf("%-22s %10lu %8s\n", "find", (unsigned long)r.find_us, "");
+    printf("%-22s %10lu %8lu\n", "prefix page", (unsigned long)r.prefix_us,
+           (unsigned long)r.prefix_matches);
+    printf("%-22s %10lu %8lu\n", "name contains", (unsigned long)r.contains_us,
+           (unsigned long)r.contains_matches);
+    printf("%-22s %10lu %8lu\n", "type audio", (unsigned long)r.type_us,
+           (unsigned long)r.type_matches);
+    printf("%-22s %10lu %8lu\n", "walk contains", (unsigned long)r.walk_us,
+           (unsigned long)r.walk_matches);
+    printf("\n%lu build steps of %d ms, %s\n", (unsigned long)r.build_steps, CAT_STEP_MS,
+           r.verified ? "ok" : "FAIL");
+    return r.verified ? 0 : 1;
+}
+
+static int run_browse(const char *base, const uint32_t *counts, size_t n_counts) {
+    char spill[256];
+    snprintf(spill, sizeof(spill), "%s/.browse", base);
+    sd_browser_config_t cfg = SD_BROWSER_CONFIG_DEFAULT();
+    cfg.mount_point = base;
+    cfg.fatfs_drive = NULL;
+    cfg.spill_dir = spill;
+    sd_browser_t *b = NULL;
+    if (sd_browser_create(&cfg, &b) != ESP_OK) {
+        return 1;
+    }
+
+    static const struct {
+        sd_browse_key_t key;
+        bool descending;
+        const char *name;
+    } orders[] = {
+        {SD_BROWSE_NAME, false, "name"},
+        {SD_BROWSE_SIZE, true, "largest"},
+        {SD_BROWSE_DATE, true, "newest"},
+    };
+
+    mkdir(base, 0755);
+    printf("%8s %-8s %10s %7s %10s %6s %6s %8s %s\n", "entries", "order", "first us", "shown",
+           "sorted us", "runs", "merges", "page us", "check");
+
+    int failed = 0;
+    for (size_t i = 0; i < n_counts; i++) {
+        char dir[256];
+        snprintf(dir, sizeof(dir), "%s/d%lu", base, (unsigned long)counts[i]);
+        if (sd_index_bench_prepare(dir, counts[i]) != ESP_OK) {
+            fprintf(stderr, "%s failed\n", dir);
+            failed = 1;
+            continue;
+        }
+        for (size_t o = 0; o < sizeof(orders) / sizeof(orders[0]); o++) {
+            sd_browser_bench_result_t r;
+            esp_err_t err = sd_browser_bench_run(b, dir, orders[o].key, orders[o].descending,
+                                                 PAGE_SIZE, BROWSE_STEP_MS, &r);
+            if (err != ESP_OK) {
+                printf("%8lu %-8s %s\n", (unsigned long)counts[i], orders[o].name,
+                       esp_err_to_name(err));
+                failed = 1;
+                continue;
+            }
+            printf("%8lu %-8s %10lu %7lu %10lu %6lu %6lu %8lu %s\n", (unsigned long)r.entries,
+                   orders[o].name, (unsigned long)r.first_page_us, (unsigned long)r.first_count,
+                   (unsigned long)r.sorted_us, (unsigned long)r.runs, (unsigned long)r.merges,
+                   (unsigned long)r.page_us, r.verified ? "ok" : "FAIL");
+            failed |= !r.verified;
+        }
+    }
+    sd_browser_destroy(b);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const char *mode = "index";
+    const char *base = DEFAULT_DIR;
+    uint32_t counts[8];
+    size_t n_counts = 0;
+    uint32_t file_size = 0;
+    const char *csv_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:d:n:s:c:v")) != -1) {
+        switch (opt) {
+            case 'm': mode = optarg; break;
+            case 'd': base = optarg; break;
+            case 'n':
+                if (n_counts < sizeof(counts) / sizeof(counts[0])) {
+                    counts[n_counts++] = (uint32_t)atoi(optarg);
+                }
+                break;
+            case 's': file_size = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'c': csv_path = optarg; break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    uint32_t cat_files = n_counts ? counts[0] : CAT_FILES;
+    if (n_counts == 0) {
+        counts[0] = 10;
+        counts[1] = 1000;
+        counts[2] = 10000;
+        n_counts = 3;
+    }
+
+    if (strcmp(mode, "index") == 0) {
+        return run_index(base, counts, n_counts);
+    }
+    if (strcmp(mode, "io") == 0) {
+        return run_io(base, file_size ? file_size : IO_FILE_SIZE, csv_path);
+    }
+    if (strcmp(mode, "rec") == 0) {
+        return run_rec(base, file_size ? file_size : REC_TOTAL);
+    }
+    if (strcmp(mode, "browse") == 0) {
+        return run_browse(base, counts, n_counts);
+    }
+    if (strcmp(mode, "catalog") == 0) {
+        return run_catalog(base, cat_files);
+    }
+    if (strcmp(mode, "ringlog") == 0) {
+        return run_ringlog(base, file_size ? file_size : LOG_SIZE);
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -3,9 +3,24 @@
  * @brief Example 06: SD Card for JC4880P443C (ESP32-P4)
  *
  * This example demonstrates:
- * - microSD card mounting
+ * - microSD card mounting through a shared service: refcounted, card kept
+ *   initialized between mounts, hot plug by polling
  * - File read/write operations
- * - Directory listing
+ * - File list sorted by name, size or date, loaded a step at a time so the
+ *   first page shows at once; large directories are sorted through runs
+ *   merged on the card, in bounded memory
+ * - Listing benchmark: stat() per entry vs the index, and time to the
+ *   first page vs the final order of the sorted list
+ * - Content catalog of the whole card, built in the background and kept in
+ *   an index file: lookup, prefix, name and type queries without walking
+ * - I/O benchmark: block size, pattern, buffer and setvbuf sweeps with
+ *   MB/s, IOPS and latency histograms, saved as CSV on the card
+ * - Recording benchmark: fwrite() vs a preallocated, cluster-aligned writer
+ * - Ring log benchmark: fprintf() per record vs a crash-tolerant ring log
+ * - Card health: latency histogram per sector command, slow commands,
+ *   retries and bytes written per card, on screen and as CSV
+ * - All card access on one worker task behind a request queue with
+ *   priority lanes; LVGL callbacks only submit requests
  * - Display results on LCD
  *
  * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
@@ -13,18 +28,19 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "nvs_flash.h"
-#include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
-#include "driver/sdmmc_host.h"
-#include "sd_pwr_ctrl_by_on_chip_ldo.h"
+#include "diskio_sdmmc.h"
 
 // BSP includes
 #include "bsp/esp-bsp.h"
@@ -33,171 +49,708 @@
 // LVGL
 #include "lvgl.h"
 
+#include "sd_browser.h"
+#include "sd_browser_bench.h"
+#include "sd_catalog.h"
+#include "sd_catalog_bench.h"
+#include "sd_index.h"
+#include "sd_index_bench.h"
+#include "sd_io_bench.h"
+#include "sd_log_bench.h"
+#include "sd_queue.h"
+#include "sd_service.h"
+#include "sd_trace.h"
+#include "sd_writer_bench.h"
+
 static const char *TAG = "sdcard";
 
-// SD card handles (managed locally to fix LDO leak in BSP)
+// ============================================================================
+// Configuration
+// ============================================================================
+#define PAGE_SIZE           15      // Entries per page of the file list
+#define BENCH_DIR           BSP_SD_MOUNT_POINT "/idxbench"
+
+// Directory sizes of the listing benchmark
+static const uint32_t bench_counts[] = {10, 1000, 10000};
+
+// Sorted file list: runs of large directories, and read / merge time per step
+#define BROWSE_SPILL_DIR    BSP_SD_MOUNT_POINT "/.browse"
+#define BROWSE_STEP_MS      30
+
+// Content catalog: index file, and walk time per background step
+#define CATALOG_FILE        BSP_SD_MOUNT_POINT "/.catalog"
+#define CATALOG_STEP_MS     50
+
+// Catalog benchmark: a music / photos / docs tree of its own
+#define CAT_BENCH_ROOT      "/catbench"
+#define CAT_BENCH_FILE      BSP_SD_MOUNT_POINT "/catbench.idx"
+#define CAT_BENCH_FILES     2000
+
+// I/O benchmark: test file, results, file size and time limit per run
+#define IO_BENCH_FILE       BSP_SD_MOUNT_POINT "/sdperf.bin"
+#define IO_BENCH_CSV        BSP_SD_MOUNT_POINT "/sdperf.csv"
+#define IO_FILE_SIZE        (4 * 1024 * 1024)
+#define IO_BUDGET_MS        5000
+
+// Stream simulation: one READ of STREAM_CHUNK bytes per period (800 KB/s)
+#define STREAM_FILE         BSP_SD_MOUNT_POINT "/stream.bin"
+#define STREAM_FILE_SIZE    (1024 * 1024)
+#define STREAM_CHUNK        (16 * 1024)
+#define STREAM_PERIOD_MS    20
+
+// Recording benchmark: 4 KB appends to a 16 MB file per method
+#define REC_BENCH_FILE      BSP_SD_MOUNT_POINT "/rec.bin"
+#define REC_CHUNK           4096
+#define REC_TOTAL           (16 * 1024 * 1024)
+
+// Ring log benchmark: 64-byte records into a 1 MB log, 10 s per method
+#define LOG_BENCH_FILE      BSP_SD_MOUNT_POINT "/ring.log"
+#define LOG_RECORDS         2000
+#define LOG_RECORD          64
+#define LOG_BUDGET_MS       10000
+
+// Card health report
+#define HEALTH_CSV          BSP_SD_MOUNT_POINT "/sdhealth.csv"
+
+// ============================================================================
+
+// Card held by this app while mounted (see sd_service)
 static sdmmc_card_t* sd_card = NULL;
-static sd_pwr_ctrl_handle_t sd_pwr_ctrl_handle = NULL;
 
 // LVGL UI elements
 static lv_obj_t *status_label = NULL;
 static lv_obj_t *file_list = NULL;
 static lv_obj_t *mount_btn = NULL;
 static lv_obj_t *write_btn = NULL;
-
-// SD card state
+static lv_obj_t *prev_btn = NULL;
+static lv_obj_t *next_btn = NULL;
+static lv_obj_t *bench_btn = NULL;
+static lv_obj_t *io_btn = NULL;
+static lv_obj_t *stream_btn = NULL;
+static lv_obj_t *rec_btn = NULL;
+static lv_obj_t *log_btn = NULL;
+static lv_obj_t *health_btn = NULL;
+static lv_obj_t *sort_btn = NULL;
+static lv_obj_t *page_label = NULL;
+static lv_obj_t *stats_label = NULL;
+
+// SD card state, as seen by the UI (set by the mount completion)
 static bool sd_mounted = false;
 
+// Directory index of the mounted card (used on the worker)
+static sd_index_t *dir_index = NULL;
+static char fatfs_drive[4];
+
+// Sorted listing of the root (used on the worker), and the page shown
+static sd_browser_t *browser = NULL;
+static sd_browse_key_t browse_key = SD_BROWSE_NAME;
+static volatile uint32_t browse_gen = 0;    // Bumped by every reopen; older load steps stop
+static uint32_t page_offset = 0;
+static uint32_t list_total = 0;
+static bool list_pending = false;
+static bool list_again = false;
+static sd_index_entry_t page_entries[PAGE_SIZE];
+static size_t page_count = 0;
+static sd_browser_info_t page_info;
+
+// Rows of the file list, created once and refilled for every page
+static lv_obj_t *rows[PAGE_SIZE];
+static bool rows_shown = false;
+
+// Content catalog of the mounted card (used on the worker), and its summary
+static sd_catalog_t *catalog = NULL;
+static char catalog_text[96] = "";
+
+// Stream simulation
+static volatile bool stream_on = false;
+static volatile bool stream_task_running = false;
+static volatile bool stream_busy = false;    // READ in flight
+static uint8_t *stream_buf = NULL;
+static uint32_t stream_offset = 0;
+static volatile uint32_t stream_reads = 0;
+static volatile uint32_t stream_missed = 0;
+static volatile uint32_t stream_max_us = 0;
+
+// ============================================================================
+// Card access (runs on the SD worker)
+// ============================================================================
+
 /**
- * @brief Mount SD card with proper LDO power control
- * This replaces bsp_sdcard_mount() to fix LDO leak on unmount/remount
+ * @brief Take the card from the SD service; fast if it stayed initialized
  */
-static esp_err_t sd_mount(void) {
-    const esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 5,
-        .allocation_unit_size = 64 * 1024
-    };
-
-    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
-    host.slot = SDMMC_HOST_SLOT_0;
-    host.max_freq_khz = SDMMC_FREQ_HIGHSPEED;
-
-    // Create LDO power control
-    sd_pwr_ctrl_ldo_config_t ldo_config = {
-        .ldo_chan_id = 4,
-    };
-    esp_err_t ret = sd_pwr_ctrl_new_on_chip_ldo(&ldo_config, &sd_pwr_ctrl_handle);
+static esp_err_t sd_mount(void *arg) {
+    esp_err_t ret = sd_service_acquire(&sd_card);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create LDO power control: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to mount SD card: %s", esp_err_to_name(ret));
         return ret;
     }
-    host.pwr_ctrl_handle = sd_pwr_ctrl_handle;
 
-    const sdmmc_slot_config_t slot_config = {
-        .cd = SDMMC_SLOT_NO_CD,
-        .wp = SDMMC_SLOT_NO_WP,
-        .width = 4,
-        .flags = 0,
-    };
+    // Time every sector command from here on
+    if (sd_trace_attach(sd_card) != ESP_OK) {
+        ESP_LOGW(TAG, "SD commands not traced");
+    }
 
-    ret = esp_vfs_fat_sdmmc_mount(BSP_SD_MOUNT_POINT, &host, &slot_config, &mount_config, &sd_card);
-    if (ret != ESP_OK) {
-        // Clean up LDO on mount failure
-        sd_pwr_ctrl_del_on_chip_ldo(sd_pwr_ctrl_handle);
-        sd_pwr_ctrl_handle = NULL;
-        ESP_LOGE(TAG, "Failed to mount SD card: %s", esp_err_to_name(ret));
+    // Index with the FatFs fast path on this card's drive
+    snprintf(fatfs_drive, sizeof(fatfs_drive), "%u:", (unsigned)ff_diskio_get_pdrv_card(sd_card));
+    sd_index_config_t index_cfg = SD_INDEX_CONFIG_DEFAULT();
+    index_cfg.mount_point = BSP_SD_MOUNT_POINT;
+    index_cfg.fatfs_drive = fatfs_drive;
+    if (sd_index_create(&index_cfg, &dir_index) != ESP_OK) {
+        ESP_LOGW(TAG, "No directory index");
+    }
+    sd_queue_set_index(dir_index);
+
+    // Sorted file list, same fast path
+    sd_browser_config_t browse_cfg = SD_BROWSER_CONFIG_DEFAULT();
+    browse_cfg.mount_point = BSP_SD_MOUNT_POINT;
+    browse_cfg.fatfs_drive = fatfs_drive;
+    browse_cfg.spill_dir = BROWSE_SPILL_DIR;
+    if (sd_browser_create(&browse_cfg, &browser) != ESP_OK) {
+        ESP_LOGW(TAG, "No file browser, listing disabled");
     }
-    return ret;
+
+    // Catalog from the index file; rebuilt in the background if the card changed
+    sd_catalog_config_t cat_cfg = SD_CATALOG_CONFIG_DEFAULT();
+    cat_cfg.mount_point = BSP_SD_MOUNT_POINT;
+    cat_cfg.fatfs_drive = fatfs_drive;
+    cat_cfg.index_path = CATALOG_FILE;
+    if (sd_catalog_create(&cat_cfg, &catalog) != ESP_OK) {
+        ESP_LOGW(TAG, "No content catalog");
+    }
+    return ESP_OK;
 }
 
 /**
- * @brief Unmount SD card and release LDO power control
- * This replaces bsp_sdcard_unmount() to properly release the LDO
+ * @brief Release the card; the service keeps it initialized while it stays in
  */
-static esp_err_t sd_unmount(void) {
-    esp_err_t ret = esp_vfs_fat_sdcard_unmount(BSP_SD_MOUNT_POINT, sd_card);
+static esp_err_t sd_unmount(void *arg) {
+    // Cached listings belong to this card
+    sd_queue_set_index(NULL);
+    sd_index_destroy(dir_index);
+    dir_index = NULL;
+    sd_browser_destroy(browser);
+    browser = NULL;
+
+    // Saves the index file if it changed
+    sd_catalog_destroy(catalog);
+    catalog = NULL;
+    bsp_display_lock(0);
+    catalog_text[0] = '\0';
+    bsp_display_unlock();
+
+    // Bytes written to this card, kept in NVS
+    sd_trace_detach();
+
     sd_card = NULL;
+    return sd_service_release();
+}
+
+/**
+ * @brief A file in the root was created or changed, runs on the worker
+ *
+ * FAT does not bump the directory's mtime, so the index is told; the
+ * sorted list is closed and reopened by the next page request.
+ */
+static void root_changed(const char *path) {
+    sd_index_invalidate_parent(dir_index, path);
+    sd_browser_close(browser);
+    sd_catalog_update(catalog, path);
+}
+
+/**
+ * @brief Run completions on the LVGL task
+ */
+static void ui_dispatch(void (*fn)(void *arg), void *arg) {
+    bsp_display_lock(0);
+    lv_async_call(fn, arg);
+    bsp_display_unlock();
+}
+
+// ============================================================================
+// File list
+// ============================================================================
+
+static void add_message(const char *text, uint32_t color) {
+    lv_obj_t *label = lv_label_create(file_list);
+    lv_label_set_text(label, text);
+    lv_obj_set_style_text_color(label, lv_color_hex(color), 0);
+}
+
+/**
+ * @brief Empty the list for a message; the next page creates the rows again
+ */
+static void clear_list(void) {
+    lv_obj_clean(file_list);
+    rows_shown = false;
+    lv_label_set_text(page_label, "");
+}
+
+/**
+ * @brief Create the PAGE_SIZE rows once: name on top, size and date below
+ *
+ * Pages only change the text of the rows, so paging and the refreshes
+ * while a directory loads do not create or delete widgets.
+ */
+static void show_rows(void) {
+    if (rows_shown) {
+        return;
+    }
+    lv_obj_clean(file_list);
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        lv_obj_t *item = lv_obj_create(file_list);
+        lv_obj_set_size(item, LV_PCT(95), 45);
+        lv_obj_set_style_bg_color(item, lv_color_hex(0x1a1a2e), 0);
+        lv_obj_set_style_border_width(item, 0, 0);
+        lv_obj_set_style_pad_all(item, 5, 0);
+
+        lv_obj_t *name_label = lv_label_create(item);
+        lv_obj_set_style_text_color(name_label, lv_color_white(), 0);
+        lv_obj_align(name_label, LV_ALIGN_TOP_LEFT, 5, 2);
 
-    // Release LDO power control (fixes the remount bug)
-    if (sd_pwr_ctrl_handle != NULL) {
-        sd_pwr_ctrl_del_on_chip_ldo(sd_pwr_ctrl_handle);
-        sd_pwr_ctrl_handle = NULL;
+        lv_obj_t *detail_label = lv_label_create(item);
+        lv_obj_set_style_text_color(detail_label, lv_color_hex(0x88CCFF), 0);
+        lv_obj_set_style_text_font(detail_label, &lv_font_montserrat_14, 0);
+        lv_obj_align(detail_label, LV_ALIGN_BOTTOM_LEFT, 5, -2);
+        rows[i] = item;
     }
+    rows_shown = true;
+}
 
-    return ret;
+static void fill_row(lv_obj_t *item, const sd_index_entry_t *entry) {
+    if (entry->type == SD_ENTRY_DIR) {
+        lv_label_set_text_fmt(lv_obj_get_child(item, 0), "[DIR] %s", entry->name);
+    } else {
+        lv_label_set_text(lv_obj_get_child(item, 0), entry->name);
+    }
+
+    // Size for files, date when known (FAT keeps local time, shown as is)
+    char detail[48] = "";
+    int len = 0;
+    if (entry->type != SD_ENTRY_DIR) {
+        sd_browser_format_size(entry->size, detail, sizeof(detail));
+        len = strlen(detail);
+    }
+    if (entry->mtime) {
+        time_t t = entry->mtime;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(detail + len, sizeof(detail) - len, len ? "   %Y-%m-%d %H:%M" : "%Y-%m-%d %H:%M",
+                 &tm);
+    }
+    lv_label_set_text(lv_obj_get_child(item, 1), detail);
+    lv_obj_clear_flag(item, LV_OBJ_FLAG_HIDDEN);
 }
 
+static void request_list(void);
+static void request_browse(void);
+
 /**
- * @brief Update the file list UI
+ * @brief Page completion, runs on the LVGL task
  */
-static void update_file_list(void) {
+static void list_done(const sd_job_result_t *r) {
+    list_pending = false;
+    if (list_again) {
+        // Mount state or page changed while this listing ran
+        list_again = false;
+        request_list();
+        return;
+    }
+    if (r->err == ESP_ERR_INVALID_STATE && sd_mounted) {
+        // Closed because a file in the root changed; read it again
+        request_browse();
+        return;
+    }
+    if (r->err == ESP_OK && page_count == 0 && page_offset > 0 && page_info.complete) {
+        // Entries were removed; go back to the first page
+        page_offset = 0;
+        request_list();
+        return;
+    }
+
+    if (!sd_mounted) {
+        clear_list();
+        add_message("SD card not mounted", 0x888888);
+        return;
+    }
+    if (r->err != ESP_OK) {
+        clear_list();
+        add_message("Failed to read directory", 0xFF4444);
+        return;
+    }
+    list_total = page_info.total;
+    if (page_count == 0) {
+        clear_list();
+        add_message(page_info.complete ? "SD card is empty" : "Loading...", 0x888888);
+        return;
+    }
+
+    show_rows();
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        if (i < page_count) {
+            fill_row(rows[i], &page_entries[i]);
+        } else {
+            lv_obj_add_flag(rows[i], LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+
+    // Until the order is final the page is what is sorted so far
+    unsigned long first = page_offset + 1;
+    unsigned long last = page_offset + page_count;
+    if (page_info.complete) {
+        lv_label_set_text_fmt(page_label, "%lu-%lu of %lu", first, last,
+                              (unsigned long)page_info.total);
+    } else if (page_info.spilled) {
+        lv_label_set_text_fmt(page_label, "%lu-%lu, sorting %lu", first, last,
+                              (unsigned long)page_info.loaded);
+    } else {
+        lv_label_set_text_fmt(page_label, "%lu-%lu of %lu+", first, last,
+                              (unsigned long)page_info.loaded);
+    }
+}
+
+/**
+ * @brief Copy the page at `arg` from the sorted listing, runs on the worker
+ */
+static esp_err_t page_job(void *arg) {
+    if (browser == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return sd_browser_page(browser, (uint32_t)(uintptr_t)arg, page_entries, PAGE_SIZE,
+                           &page_count, &page_info);
+}
+
+/**
+ * @brief Queue a page of the listing
+ *
+ * The worker copies the page into page_entries: from RAM, or one seek and
+ * read in the sorted file of a large directory. One page at a time, since
+ * they share page_entries.
+ */
+static void request_list(void) {
     if (file_list == NULL) return;
+    if (list_pending) {
+        list_again = true;
+        return;
+    }
 
-    bsp_display_lock(0);
+    if (!sd_mounted) {
+        clear_list();
+        add_message("SD card not mounted", 0x888888);
+        return;
+    }
 
-    // Clear existing items
-    lv_obj_clean(file_list);
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_UI;
+    job.fn = page_job;
+    job.fn_arg = (void *)(uintptr_t)page_offset;
+    job.on_done = list_done;
+    if (sd_queue_submit(&job, NULL) == ESP_OK) {
+        list_pending = true;
+    }
+}
+
+/**
+ * @brief Open the root in the order `arg` and read the first batch, runs on the worker
+ */
+static esp_err_t browse_open_job(void *arg) {
+    if (browser == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Size and date: largest and newest first
+    sd_browse_key_t key = (sd_browse_key_t)(uintptr_t)arg;
+    esp_err_t err = sd_browser_open(browser, BSP_SD_MOUNT_POINT, key, key != SD_BROWSE_NAME);
+    return err == ESP_OK ? sd_browser_step(browser, BROWSE_STEP_MS) : err;
+}
+
+/**
+ * @brief One load step of listing `arg`, runs on the worker
+ */
+static esp_err_t browse_step_job(void *arg) {
+    if (browser == NULL || (uint32_t)(uintptr_t)arg != browse_gen) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return sd_browser_step(browser, BROWSE_STEP_MS);
+}
+
+static void browse_step_done(const sd_job_result_t *r);
+
+static void request_browse_step(uint32_t gen) {
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_BACKGROUND;
+    job.fn = browse_step_job;
+    job.fn_arg = (void *)(uintptr_t)gen;
+    job.on_done = browse_step_done;
+    job.ctx = (void *)(uintptr_t)gen;
+    sd_queue_submit(&job, NULL);
+}
 
+/**
+ * @brief Open and load step completions, run on the LVGL task: queue the
+ *        next step and refresh the page with what is sorted so far
+ */
+static void browse_step_done(const sd_job_result_t *r) {
+    uint32_t gen = (uint32_t)(uintptr_t)r->ctx;
+    if (gen != browse_gen || r->err == ESP_ERR_INVALID_STATE) {
+        return;  // Reopened or closed meanwhile
+    }
+    if (r->err != ESP_OK && r->err != ESP_ERR_NOT_FINISHED) {
+        clear_list();
+        add_message(r->err == ESP_FAIL ? "Failed to read directory" : esp_err_to_name(r->err),
+                    0xFF4444);
+        return;
+    }
+    if (r->err == ESP_ERR_NOT_FINISHED) {
+        request_browse_step(gen);
+    }
+    request_list();
+}
+
+/**
+ * @brief Read the root again in the current order
+ *
+ * The open and the first batch go on the UI lane, so the first page
+ * follows right away; the rest is loaded and sorted by steps of
+ * BROWSE_STEP_MS on the background lane, each refreshing the page.
+ */
+static void request_browse(void) {
     if (!sd_mounted) {
-        lv_obj_t *label = lv_label_create(file_list);
-        lv_label_set_text(label, "SD card not mounted");
-        lv_obj_set_style_text_color(label, lv_color_hex(0x888888), 0);
-        bsp_display_unlock();
+        request_list();
         return;
     }
+    uint32_t gen = ++browse_gen;
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_UI;
+    job.fn = browse_open_job;
+    job.fn_arg = (void *)(uintptr_t)browse_key;
+    job.on_done = browse_step_done;
+    job.ctx = (void *)(uintptr_t)gen;
+    sd_queue_submit(&job, NULL);
+}
 
-    // Open directory
-    DIR *dir = opendir(BSP_SD_MOUNT_POINT);
-    if (dir == NULL) {
-        lv_obj_t *label = lv_label_create(file_list);
-        lv_label_set_text(label, "Failed to open directory");
-        lv_obj_set_style_text_color(label, lv_color_hex(0xFF4444), 0);
-        bsp_display_unlock();
+// ============================================================================
+// Content catalog
+// ============================================================================
+
+/**
+ * @brief One build step, runs on the worker; nothing to do if the catalog is current
+ */
+static esp_err_t catalog_job(void *arg) {
+    if (catalog == NULL) {
+        return ESP_OK;
+    }
+    sd_catalog_stats_t st;
+    sd_catalog_get_stats(catalog, &st);
+    if (!st.needs_build && !st.building) {
+        return ESP_OK;
+    }
+    return sd_catalog_build_step(catalog, CATALOG_STEP_MS);
+}
+
+static void request_catalog_build(void);
+
+/**
+ * @brief Build step completion, runs on the worker: queue the next step or
+ *        summarize the catalog
+ */
+static void catalog_done(const sd_job_result_t *r) {
+    if (catalog == NULL) {
+        return;
+    }
+    if (r->err == ESP_ERR_NOT_FINISHED) {
+        request_catalog_build();
         return;
     }
 
-    // Read directory entries
-    struct dirent *entry;
-    int file_count = 0;
+    // Counts per type: queries on the index in RAM, not the card
+    uint32_t counts[SD_CAT_TYPE_COUNT] = {};
+    for (int t = 0; t < SD_CAT_TYPE_COUNT; t++) {
+        sd_catalog_query_t q = {};
+        q.types = SD_CAT_MASK(t);
+        size_t n;
+        sd_catalog_query(catalog, &q, 0, NULL, 0, &n, &counts[t]);
+    }
+    sd_catalog_stats_t st;
+    sd_catalog_get_stats(catalog, &st);
 
-    while ((entry = readdir(dir)) != NULL && file_count < 15) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+    char text[sizeof(catalog_text)];
+    bool built = st.build_us > 0;
+    if (r->err != ESP_OK) {
+        snprintf(text, sizeof(text), "catalog: %s", esp_err_to_name(r->err));
+    } else {
+        snprintf(text, sizeof(text), "catalog %lu files, %lu audio, %lu images, %s in %lu ms%s",
+                 (unsigned long)(st.entries - st.dirs), (unsigned long)counts[SD_CAT_AUDIO],
+                 (unsigned long)counts[SD_CAT_IMAGE], built ? "built" : "loaded",
+                 (unsigned long)((built ? st.build_us : st.load_us) / 1000),
+                 st.truncated ? " (truncated)" : "");
+    }
+    bsp_display_lock(0);
+    strcpy(catalog_text, text);
+    bsp_display_unlock();
+}
 
-        // Get file info
-        char filepath[256];
-        snprintf(filepath, sizeof(filepath), "%s/%s", BSP_SD_MOUNT_POINT, entry->d_name);
+/**
+ * @brief Queue a catalog build step on the background lane
+ *
+ * Each step walks for CATALOG_STEP_MS and queues the next from its
+ * completion, so listings and the stream get the card in between.
+ */
+static void request_catalog_build(void) {
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_BACKGROUND;
+    job.fn = catalog_job;
+    job.on_done = catalog_done;
+    job.done_on_worker = true;
+    sd_queue_submit(&job, NULL);
+}
 
-        struct stat st;
-        stat(filepath, &st);
+// ============================================================================
+// Stream simulation
+// ============================================================================
 
-        // Create item
-        lv_obj_t *item = lv_obj_create(file_list);
-        lv_obj_set_size(item, LV_PCT(95), 45);
-        lv_obj_set_style_bg_color(item, lv_color_hex(0x1a1a2e), 0);
-        lv_obj_set_style_border_width(item, 0, 0);
-        lv_obj_set_style_pad_all(item, 5, 0);
+/**
+ * @brief Create the stream test file if needed, runs on the worker
+ */
+static esp_err_t stream_prepare(void *arg) {
+    struct stat st;
+    if (stat(STREAM_FILE, &st) == 0 && st.st_size == STREAM_FILE_SIZE) {
+        return ESP_OK;
+    }
 
-        // File name
-        lv_obj_t *name_label = lv_label_create(item);
-        if (S_ISDIR(st.st_mode)) {
-            lv_label_set_text_fmt(name_label, "[DIR] %s", entry->d_name);
-        } else {
-            lv_label_set_text(name_label, entry->d_name);
-        }
-        lv_obj_set_style_text_color(name_label, lv_color_white(), 0);
-        lv_obj_align(name_label, LV_ALIGN_TOP_LEFT, 5, 2);
+    FILE *f = fopen(STREAM_FILE, "wb");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    memset(stream_buf, 0x55, STREAM_CHUNK);
+    size_t written = 0;
+    while (written < STREAM_FILE_SIZE && fwrite(stream_buf, 1, STREAM_CHUNK, f) == STREAM_CHUNK) {
+        written += STREAM_CHUNK;
+    }
+    fclose(f);
+    root_changed(STREAM_FILE);
+    return written == STREAM_FILE_SIZE ? ESP_OK : ESP_FAIL;
+}
 
-        // File size
-        if (!S_ISDIR(st.st_mode)) {
-            lv_obj_t *size_label = lv_label_create(item);
-            if (st.st_size < 1024) {
-                lv_label_set_text_fmt(size_label, "%ld bytes", (long)st.st_size);
-            } else if (st.st_size < 1024 * 1024) {
-                lv_label_set_text_fmt(size_label, "%.1f KB", (float)st.st_size / 1024);
-            } else {
-                lv_label_set_text_fmt(size_label, "%.1f MB", (float)st.st_size / (1024 * 1024));
+/**
+ * @brief Stream READ completion, runs on the worker
+ */
+static void stream_read_done(const sd_job_result_t *r) {
+    uint32_t latency = r->wait_us + r->run_us;
+    if (latency > stream_max_us) {
+        stream_max_us = latency;
+    }
+    stream_reads++;
+    stream_offset = (r->err == ESP_OK && r->bytes == STREAM_CHUNK) ? stream_offset + STREAM_CHUNK : 0;
+    if (stream_offset >= STREAM_FILE_SIZE) {
+        stream_offset = 0;
+    }
+    stream_busy = false;
+}
+
+/**
+ * @brief Requests one chunk per period, like an audio decoder would
+ *
+ * A period that finds the previous read still in flight is a missed
+ * deadline: a player with one chunk of buffering would have run dry.
+ */
+static void stream_task(void *arg) {
+    TickType_t last = xTaskGetTickCount();
+    while (stream_on) {
+        if (stream_busy) {
+            stream_missed++;
+        } else {
+            sd_job_t job = {};
+            job.op = SD_OP_READ;
+            job.lane = SD_LANE_STREAM;
+            job.path = STREAM_FILE;
+            job.offset = stream_offset;
+            job.buf = stream_buf;
+            job.len = STREAM_CHUNK;
+            job.on_done = stream_read_done;
+            job.done_on_worker = true;
+            stream_busy = true;
+            if (sd_queue_submit(&job, NULL) != ESP_OK) {
+                stream_busy = false;
             }
-            lv_obj_set_style_text_color(size_label, lv_color_hex(0x88CCFF), 0);
-            lv_obj_set_style_text_font(size_label, &lv_font_montserrat_14, 0);
-            lv_obj_align(size_label, LV_ALIGN_BOTTOM_LEFT, 5, -2);
         }
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(STREAM_PERIOD_MS));
+    }
+    stream_task_running = false;
+    vTaskDelete(NULL);
+}
 
-        file_count++;
+static void stream_stop(void) {
+    if (!stream_on) return;
+    stream_on = false;
+    lv_label_set_text(lv_obj_get_child(stream_btn, 0), "Stream");
+}
+
+/**
+ * @brief Stream preparation completion, runs on the LVGL task
+ */
+static void stream_prepare_done(const sd_job_result_t *r) {
+    lv_obj_clear_state(stream_btn, LV_STATE_DISABLED);
+    if (r->err != ESP_OK || !sd_mounted) {
+        lv_label_set_text(status_label, "Failed to create " STREAM_FILE);
+        return;
     }
+    stream_reads = 0;
+    stream_missed = 0;
+    stream_max_us = 0;
+    stream_offset = 0;
+    stream_on = true;
+    lv_label_set_text(lv_obj_get_child(stream_btn, 0), "Stop");
+    lv_label_set_text(status_label, "Streaming 16 KB every 20 ms");
+    if (!stream_task_running) {
+        stream_task_running = true;
+        xTaskCreate(stream_task, "stream", 3072, NULL, 7, NULL);
+    }
+    request_list();
+}
 
-    closedir(dir);
+// ============================================================================
+// Button callbacks
+// ============================================================================
+
+/**
+ * @brief Mount / unmount completion, runs on the LVGL task
+ */
+static void mount_done(const sd_job_result_t *r) {
+    lv_obj_clear_state(mount_btn, LV_STATE_DISABLED);
 
-    if (file_count == 0) {
-        lv_obj_t *label = lv_label_create(file_list);
-        lv_label_set_text(label, "SD card is empty");
-        lv_obj_set_style_text_color(label, lv_color_hex(0x888888), 0);
+    if (r->op == SD_OP_UNMOUNT) {
+        // The card is released even if unmounting reported an error
+        lv_label_set_text(lv_obj_get_child(mount_btn, 0), "Mount");
+        if (r->err == ESP_OK) {
+            lv_label_set_text(status_label, "SD card unmounted");
+            ESP_LOGI(TAG, "SD card unmounted");
+        } else {
+            lv_label_set_text(status_label, "Unmount failed!");
+            ESP_LOGE(TAG, "Failed to unmount: %s", esp_err_to_name(r->err));
+        }
+    } else if (r->err == ESP_OK) {
+        sd_mounted = true;
+        page_offset = 0;
+        sd_service_stats_t st;
+        sd_service_get_stats(&st);
+        lv_label_set_text_fmt(status_label, "Mounted: %s (%.1f MB) in %lu ms%s",
+                              sd_card->cid.name,
+                              (float)((uint64_t)sd_card->csd.capacity * sd_card->csd.sector_size) / (1024 * 1024),
+                              (unsigned long)(st.last_mount_us / 1000),
+                              st.last_mount_fast ? ", card kept initialized" : "");
+        lv_label_set_text(lv_obj_get_child(mount_btn, 0), "Unmount");
+        ESP_LOGI(TAG, "SD card mounted");
+        request_catalog_build();
+    } else {
+        lv_label_set_text(status_label, "Mount failed! Insert SD card");
+        ESP_LOGE(TAG, "Failed to mount: %s", esp_err_to_name(r->err));
     }
 
-    bsp_display_unlock();
+    // Update file list
+    request_browse();
 }
 
 /**
@@ -206,45 +759,88 @@ static void update_file_list(void) {
 static void mount_btn_click_cb(lv_event_t *e) {
     ESP_LOGI(TAG, "Mount button clicked");
 
-    bsp_display_lock(0);
+    sd_job_t job = {};
+    job.op = sd_mounted ? SD_OP_UNMOUNT : SD_OP_MOUNT;
+    job.lane = SD_LANE_UI;
+    job.on_done = mount_done;
+    if (sd_queue_submit(&job, NULL) != ESP_OK) {
+        lv_label_set_text(status_label, "SD queue full");
+        return;
+    }
 
     if (sd_mounted) {
-        // Unmount
-        esp_err_t ret = sd_unmount();
-        if (ret == ESP_OK) {
-            sd_mounted = false;
-            lv_label_set_text(status_label, "SD card unmounted");
-            lv_label_set_text(lv_obj_get_child(mount_btn, 0), "Mount");
-            ESP_LOGI(TAG, "SD card unmounted");
-        } else {
-            lv_label_set_text(status_label, "Unmount failed!");
-            ESP_LOGE(TAG, "Failed to unmount: %s", esp_err_to_name(ret));
-        }
+        // Nothing new is queued for the card from here on
+        stream_stop();
+        sd_mounted = false;
+        lv_label_set_text(status_label, "Unmounting...");
     } else {
-        // Mount
         lv_label_set_text(status_label, "Mounting...");
-        bsp_display_unlock();
+    }
+    lv_obj_add_state(mount_btn, LV_STATE_DISABLED);
+}
 
-        esp_err_t ret = sd_mount();
+/**
+ * @brief Hot plug, runs on the LVGL task: mount a new card, let go of a removed one
+ */
+static void card_event_ui(void *arg) {
+    sd_service_event_t event = (sd_service_event_t)(intptr_t)arg;
+    bool busy = lv_obj_has_state(mount_btn, LV_STATE_DISABLED);  // Mount or benchmark running
 
-        bsp_display_lock(0);
-        if (ret == ESP_OK) {
-            sd_mounted = true;
-            lv_label_set_text_fmt(status_label, "Mounted: %s (%.1f MB)",
-                                   sd_card->cid.name,
-                                   (float)((uint64_t)sd_card->csd.capacity * sd_card->csd.sector_size) / (1024 * 1024));
-            lv_label_set_text(lv_obj_get_child(mount_btn, 0), "Unmount");
-            ESP_LOGI(TAG, "SD card mounted");
-        } else {
-            lv_label_set_text(status_label, "Mount failed! Insert SD card");
-            ESP_LOGE(TAG, "Failed to mount: %s", esp_err_to_name(ret));
+    if (event == SD_SERVICE_EVENT_INSERTED) {
+        if (!sd_mounted && !busy) {
+            mount_btn_click_cb(NULL);
         }
+    } else {
+        if (sd_mounted && !busy) {
+            mount_btn_click_cb(NULL);
+        }
+        lv_label_set_text(status_label, "SD card removed");
     }
+}
 
-    bsp_display_unlock();
+/**
+ * @brief SD service events, on the service task
+ */
+static void card_event(sd_service_event_t event, void *arg) {
+    ui_dispatch(card_event_ui, (void *)(intptr_t)event);
+}
+
+/**
+ * @brief Test file being written
+ */
+typedef struct {
+    char path[64];
+    char text[256];
+    esp_err_t err;
+} write_ctx_t;
+
+/**
+ * @brief Test file completion, runs on the LVGL task
+ */
+static void write_ui_done(void *arg) {
+    write_ctx_t *w = (write_ctx_t *)arg;
+    if (w->err == ESP_OK) {
+        ESP_LOGI(TAG, "Test file created: %s", w->path);
+        lv_label_set_text(status_label, "Test file created!");
+    } else {
+        ESP_LOGE(TAG, "Failed to create file");
+        lv_label_set_text(status_label, "Failed to create file!");
+    }
+    free(w);
 
     // Update file list
-    update_file_list();
+    request_list();
+}
+
+/**
+ * @brief Test file WRITE completion, runs on the worker
+ */
+static void write_done(const sd_job_result_t *r) {
+    write_ctx_t *w = (write_ctx_t *)r->ctx;
+    w->err = r->err;
+
+    root_changed(w->path);
+    ui_dispatch(write_ui_done, w);
 }
 
 /**
@@ -254,44 +850,607 @@ static void write_btn_click_cb(lv_event_t *e) {
     ESP_LOGI(TAG, "Write button clicked");
 
     if (!sd_mounted) {
-        bsp_display_lock(0);
         lv_label_set_text(status_label, "Mount SD card first!");
-        bsp_display_unlock();
         return;
     }
 
-    // Create test file
-    char filepath[64];
-    snprintf(filepath, sizeof(filepath), "%s/test_%lu.txt", BSP_SD_MOUNT_POINT, (unsigned long)(esp_timer_get_time() / 1000000));
+    write_ctx_t *w = (write_ctx_t *)malloc(sizeof(write_ctx_t));
+    if (w == NULL) {
+        lv_label_set_text(status_label, "Out of memory!");
+        return;
+    }
 
-    FILE *f = fopen(filepath, "w");
-    if (f == NULL) {
-        ESP_LOGE(TAG, "Failed to create file");
-        bsp_display_lock(0);
-        lv_label_set_text(status_label, "Failed to create file!");
-        bsp_display_unlock();
+    // Test content, written by the worker
+    snprintf(w->path, sizeof(w->path), "%s/test_%lu.txt", BSP_SD_MOUNT_POINT, (unsigned long)(esp_timer_get_time() / 1000000));
+    int len = snprintf(w->text, sizeof(w->text),
+                       "JC4880P443C SD Card Test\n"
+                       "========================\n"
+                       "ESP32-P4 Development Board\n"
+                       "Guition JC-ESP32P4-M3-C6 Module\n"
+                       "\n"
+                       "Timestamp: %llu ms\n"
+                       "Free heap: %lu bytes\n",
+                       (unsigned long long)(esp_timer_get_time() / 1000),
+                       (unsigned long)esp_get_free_heap_size());
+
+    sd_job_t job = {};
+    job.op = SD_OP_WRITE;
+    job.lane = SD_LANE_UI;
+    job.path = w->path;
+    job.buf = w->text;
+    job.len = (size_t)len;
+    job.flags = SD_JOB_CREATE;
+    job.on_done = write_done;
+    job.done_on_worker = true;
+    job.ctx = w;
+    if (sd_queue_submit(&job, NULL) != ESP_OK) {
+        free(w);
+        lv_label_set_text(status_label, "SD queue full");
         return;
     }
+    lv_label_set_text(status_label, "Writing test file...");
+}
 
-    // Write test content
-    fprintf(f, "JC4880P443C SD Card Test\n");
-    fprintf(f, "========================\n");
-    fprintf(f, "ESP32-P4 Development Board\n");
-    fprintf(f, "Guition JC-ESP32P4-M3-C6 Module\n");
-    fprintf(f, "\n");
-    fprintf(f, "Timestamp: %llu ms\n", (unsigned long long)(esp_timer_get_time() / 1000));
-    fprintf(f, "Free heap: %lu bytes\n", (unsigned long)esp_get_free_heap_size());
+/**
+ * @brief Previous / next page callbacks
+ */
+static void prev_btn_click_cb(lv_event_t *e) {
+    page_offset = page_offset > PAGE_SIZE ? page_offset - PAGE_SIZE : 0;
+    request_list();
+}
 
-    fclose(f);
+static void next_btn_click_cb(lv_event_t *e) {
+    // Total of the last listing; a stale value is fixed by the next one
+    if (page_offset + PAGE_SIZE < list_total) {
+        page_offset += PAGE_SIZE;
+    }
+    request_list();
+}
+
+/**
+ * @brief Sort button callback: name, then largest first, then newest first
+ */
+static void sort_btn_click_cb(lv_event_t *e) {
+    browse_key = (sd_browse_key_t)((browse_key + 1) % SD_BROWSE_KEY_COUNT);
+    lv_label_set_text_fmt(lv_obj_get_child(sort_btn, 0), "Sort: %s",
+                          sd_browser_key_name(browse_key));
+    page_offset = 0;
+    request_browse();
+}
+
+/**
+ * @brief Stream button callback
+ */
+static void stream_btn_click_cb(lv_event_t *e) {
+    if (stream_on) {
+        stream_stop();
+        lv_label_set_text(status_label, "Stream stopped");
+        return;
+    }
+    if (!sd_mounted) {
+        lv_label_set_text(status_label, "Mount SD card first!");
+        return;
+    }
+    if (stream_buf == NULL) {
+        stream_buf = (uint8_t *)heap_caps_malloc(STREAM_CHUNK, MALLOC_CAP_DMA);
+        if (stream_buf == NULL) {
+            lv_label_set_text(status_label, "Out of memory!");
+            return;
+        }
+    }
+
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_UI;
+    job.fn = stream_prepare;
+    job.on_done = stream_prepare_done;
+    if (sd_queue_submit(&job, NULL) == ESP_OK) {
+        lv_obj_add_state(stream_btn, LV_STATE_DISABLED);
+        lv_label_set_text(status_label, "Preparing " STREAM_FILE "...");
+    }
+}
 
-    ESP_LOGI(TAG, "Test file created: %s", filepath);
+static void set_buttons_enabled(bool enabled) {
+    lv_obj_t *buttons[] = {mount_btn, write_btn, prev_btn, next_btn, bench_btn, io_btn,
+                           stream_btn, rec_btn, log_btn, health_btn, sort_btn};
+    for (size_t i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+        if (enabled) {
+            lv_obj_clear_state(buttons[i], LV_STATE_DISABLED);
+        } else {
+            lv_obj_add_state(buttons[i], LV_STATE_DISABLED);
+        }
+    }
+}
 
+static void show_report(const char *text, const char *status) {
     bsp_display_lock(0);
-    lv_label_set_text(status_label, "Test file created!");
+    lv_obj_clean(file_list);
+    rows_shown = false;
+    lv_label_set_text(page_label, "");
+    lv_obj_t *label = lv_label_create(file_list);
+    lv_label_set_text(label, text);
+    lv_obj_set_style_text_color(label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(label, &lv_font_montserrat_14, 0);
+    lv_label_set_text(status_label, status);
+    set_buttons_enabled(true);
     bsp_display_unlock();
+}
 
-    // Update file list
-    update_file_list();
+/**
+ * @brief Queue a benchmark on the background lane
+ *
+ * A benchmark is one CALL and holds the card until it is done, so the
+ * stream is stopped and the buttons stay disabled meanwhile.
+ */
+static void submit_bench(sd_job_fn_t fn) {
+    if (!sd_mounted || !dir_index) {
+        lv_label_set_text(status_label, "Mount SD card first!");
+        return;
+    }
+    stream_stop();
+
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_BACKGROUND;
+    job.fn = fn;
+    if (sd_queue_submit(&job, NULL) == ESP_OK) {
+        set_buttons_enabled(false);
+    }
+}
+
+// ============================================================================
+// Benchmarks (run on the worker)
+// ============================================================================
+
+/**
+ * @brief Listing benchmark: 10 / 1,000 / 10,000-entry directories
+ */
+static esp_err_t list_bench_job(void *arg) {
+    static char text[1536];
+    int len = snprintf(text, sizeof(text), "%6s %9s %9s %9s %8s\n", "files", "stat ms",
+                       "d_type ms", "cold ms", "page us");
+    esp_err_t err = ESP_OK;
+
+    mkdir(BENCH_DIR, 0755);
+    for (size_t i = 0; i < sizeof(bench_counts) / sizeof(bench_counts[0]) && err == ESP_OK; i++) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%s/d%lu", BENCH_DIR, (unsigned long)bench_counts[i]);
+
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "Preparing %lu files (first run is slow)...",
+                              (unsigned long)bench_counts[i]);
+        bsp_display_unlock();
+        err = sd_index_bench_prepare(dir, bench_counts[i]);
+
+        sd_index_bench_result_t r;
+        if (err == ESP_OK) {
+            bsp_display_lock(0);
+            lv_label_set_text_fmt(status_label, "Listing %lu files...",
+                                  (unsigned long)bench_counts[i]);
+            bsp_display_unlock();
+            err = sd_index_bench_run(dir_index, dir, PAGE_SIZE, &r);
+        }
+        if (err == ESP_OK && len < (int)sizeof(text)) {
+            // The stat() listing may have stopped early; show how far it got
+            char stat_ms[16];
+            if (r.stat_entries < r.entries) {
+                snprintf(stat_ms, sizeof(stat_ms), ">%lu", (unsigned long)(r.stat_us / 1000));
+            } else {
+                snprintf(stat_ms, sizeof(stat_ms), "%lu", (unsigned long)(r.stat_us / 1000));
+            }
+            len += snprintf(text + len, sizeof(text) - len, "%6lu %9s %9lu %9lu %8lu\n",
+                            (unsigned long)r.entries, stat_ms,
+                            (unsigned long)(r.dtype_us / 1000),
+                            (unsigned long)(r.index_cold_us / 1000),
+                            (unsigned long)r.index_page_us);
+        }
+    }
+
+    // Sorted list of the same directories, largest first; closes the root listing
+    if (err == ESP_OK && browser && len < (int)sizeof(text)) {
+        len += snprintf(text + len, sizeof(text) - len, "\nby size: %6s %9s %9s %5s\n",
+                        "files", "first ms", "sorted ms", "runs");
+    }
+    for (size_t i = 0; i < sizeof(bench_counts) / sizeof(bench_counts[0]) && err == ESP_OK &&
+                       browser; i++) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%s/d%lu", BENCH_DIR, (unsigned long)bench_counts[i]);
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "Sorting %lu files...", (unsigned long)bench_counts[i]);
+        bsp_display_unlock();
+
+        sd_browser_bench_result_t br;
+        err = sd_browser_bench_run(browser, dir, SD_BROWSE_SIZE, true, PAGE_SIZE,
+                                   BROWSE_STEP_MS, &br);
+        if (err == ESP_OK && len < (int)sizeof(text)) {
+            len += snprintf(text + len, sizeof(text) - len, "%15lu %9.1f %9lu %5lu%s\n",
+                            (unsigned long)br.entries, br.first_page_us / 1000.0,
+                            (unsigned long)(br.sorted_us / 1000), (unsigned long)br.runs,
+                            br.verified ? "" : " FAIL");
+        }
+    }
+
+    // Catalog of a tree of its own: build, reopen, queries vs a walk
+    sd_catalog_bench_result_t cr = {};
+    if (err == ESP_OK) {
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "Preparing %d catalog files (first run is slow)...",
+                              CAT_BENCH_FILES);
+        bsp_display_unlock();
+        err = sd_catalog_bench_prepare(BSP_SD_MOUNT_POINT CAT_BENCH_ROOT, CAT_BENCH_FILES);
+    }
+    if (err == ESP_OK) {
+        bsp_display_lock(0);
+        lv_label_set_text(status_label, "Building catalog...");
+        bsp_display_unlock();
+        sd_catalog_config_t cfg = SD_CATALOG_CONFIG_DEFAULT();
+        cfg.mount_point = BSP_SD_MOUNT_POINT;
+        cfg.fatfs_drive = fatfs_drive;
+        cfg.root = CAT_BENCH_ROOT;
+        cfg.index_path = CAT_BENCH_FILE;
+        sd_catalog_bench_params_t p = {CAT_BENCH_ROOT "/music/a001/t00050.mp3",
+                                       CAT_BENCH_ROOT "/music/a001/", "0042", CATALOG_STEP_MS};
+        err = sd_catalog_bench_run(&cfg, &p, &cr);
+    }
+    if (err == ESP_OK && len < (int)sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len,
+                 "\ncatalog of %lu entries (%lu KB file):\n"
+                 "build %lu ms, load %lu ms, find %lu us,\n"
+                 "prefix %lu us, name %lu us, type %lu us,\n"
+                 "name by walking %lu ms, %s\n",
+                 (unsigned long)cr.entries, (unsigned long)(cr.file_bytes / 1024),
+                 (unsigned long)(cr.build_us / 1000), (unsigned long)(cr.load_us / 1000),
+                 (unsigned long)cr.find_us, (unsigned long)cr.prefix_us,
+                 (unsigned long)cr.contains_us, (unsigned long)cr.type_us,
+                 (unsigned long)(cr.walk_us / 1000), cr.verified ? "same matches" : "MISMATCH");
+    }
+
+    // The card catalog has not seen the benchmark trees yet
+    if (catalog) {
+        sd_catalog_invalidate(catalog);
+        request_catalog_build();
+    }
+
+    show_report(text, err == ESP_OK ? "Benchmark done" : "Benchmark failed");
+    return err;
+}
+
+/**
+ * @brief Bench button callback
+ */
+static void bench_btn_click_cb(lv_event_t *e) {
+    submit_bench(list_bench_job);
+}
+
+/**
+ * @brief I/O benchmark: the sd_io_bench_plan() sweep, results on screen and as CSV
+ */
+static esp_err_t io_bench_job(void *arg) {
+    static sd_io_params_t plan[SD_IO_PLAN_MAX];
+    static sd_io_result_t results[SD_IO_PLAN_MAX];
+    static bool ok[SD_IO_PLAN_MAX];
+    static char text[4096];
+    uint32_t hist_write[SD_IO_HIST_BUCKETS] = {};
+    uint32_t hist_read[SD_IO_HIST_BUCKETS] = {};
+
+    size_t n = sd_io_bench_plan(IO_FILE_SIZE, IO_BUDGET_MS, plan);
+    int len = snprintf(text, sizeof(text), "%-22s %7s %7s %6s %6s\n", "run", "MB/s", "IOPS",
+                       "p99us", "maxus");
+
+    for (size_t i = 0; i < n; i++) {
+        char name[40];
+        sd_io_bench_describe(&plan[i], name, sizeof(name));
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "I/O %u/%u: %s", (unsigned)i + 1, (unsigned)n, name);
+        bsp_display_unlock();
+
+        esp_err_t err = sd_io_bench_run(IO_BENCH_FILE, &plan[i], &results[i]);
+        ok[i] = (err == ESP_OK);
+        const sd_io_result_t *r = &results[i];
+        if (ok[i]) {
+            bool write = (plan[i].pattern == SD_IO_SEQ_WRITE ||
+                          plan[i].pattern == SD_IO_RAND_WRITE);
+            for (int b = 0; b < SD_IO_HIST_BUCKETS; b++) {
+                (write ? hist_write : hist_read)[b] += r->hist[b];
+            }
+        }
+        if (len < (int)sizeof(text)) {
+            if (ok[i]) {
+                len += snprintf(text + len, sizeof(text) - len, "%-22s %7.2f %7.0f %6lu %6lu\n",
+                                name, r->mb_per_s, r->iops, (unsigned long)r->lat_p99_us,
+                                (unsigned long)r->lat_max_us);
+            } else {
+                len += snprintf(text + len, sizeof(text) - len, "%-22s %s\n", name,
+                                esp_err_to_name(err));
+            }
+        }
+    }
+    unlink(IO_BENCH_FILE);
+
+    // Latency histogram of all runs, writes and reads
+    if (len < (int)sizeof(text)) {
+        len += snprintf(text + len, sizeof(text) - len, "\n%-9s %9s %9s\n", "latency",
+                        "writes", "reads");
+    }
+    for (int b = 0; b < SD_IO_HIST_BUCKETS && len < (int)sizeof(text); b++) {
+        char range[12];
+        unsigned long limit = SD_IO_HIST_LIMIT_US(b < SD_IO_HIST_BUCKETS - 1 ? b : b - 1);
+        snprintf(range, sizeof(range), "%s%lu%s", b < SD_IO_HIST_BUCKETS - 1 ? "<" : ">=",
+                 limit >= 1000 ? limit / 1000 : limit, limit >= 1000 ? "ms" : "us");
+        len += snprintf(text + len, sizeof(text) - len, "%-9s %9lu %9lu\n", range,
+                        (unsigned long)hist_write[b], (unsigned long)hist_read[b]);
+    }
+
+    FILE *csv = fopen(IO_BENCH_CSV, "w");
+    if (csv) {
+        sd_io_bench_csv_header(csv);
+        for (size_t i = 0; i < n; i++) {
+            if (ok[i]) {
+                sd_io_bench_csv_row(csv, &plan[i], &results[i]);
+            }
+        }
+        fclose(csv);
+    }
+    root_changed(IO_BENCH_FILE);
+    sd_catalog_update(catalog, IO_BENCH_CSV);
+
+    show_report(text, csv ? "I/O benchmark done, saved " IO_BENCH_CSV : "I/O benchmark done");
+    return ESP_OK;
+}
+
+/**
+ * @brief I/O bench button callback
+ */
+static void io_btn_click_cb(lv_event_t *e) {
+    submit_bench(io_bench_job);
+}
+
+/**
+ * @brief Recording benchmark: worst-case append latency per method
+ */
+static esp_err_t rec_bench_job(void *arg) {
+    static char text[1024];
+    uint32_t stalls[SD_REC_METHOD_COUNT] = {};
+    sd_writer_stats_t ws = {};
+    esp_err_t err = ESP_OK;
+
+    int len = snprintf(text, sizeof(text), "%d KB appends, %d MB per run\n\n%-11s %6s %6s %6s %7s %5s\n",
+                       REC_CHUNK / 1024, REC_TOTAL / (1024 * 1024), "method", "MB/s", "avgus",
+                       "p99us", "maxus", ">4ms");
+
+    sd_writer_config_t wcfg = SD_WRITER_CONFIG_DEFAULT();
+    wcfg.mount_point = BSP_SD_MOUNT_POINT;
+    wcfg.fatfs_drive = fatfs_drive;
+
+    for (int m = 0; m < SD_REC_METHOD_COUNT && err == ESP_OK; m++) {
+        sd_rec_params_t p = {(sd_rec_method_t)m, REC_CHUNK, REC_TOTAL};
+        const char *name = sd_writer_bench_method_name(p.method);
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "Recording with %s...", name);
+        bsp_display_unlock();
+
+        sd_io_result_t r;
+        err = sd_writer_bench_run(REC_BENCH_FILE, &p, &wcfg, &r,
+                                  p.method == SD_REC_WRITER ? &ws : NULL);
+        if (err != ESP_OK) {
+            break;
+        }
+        // Buckets from 4096 us up
+        for (int b = 7; b < SD_IO_HIST_BUCKETS; b++) {
+            stalls[m] += r.hist[b];
+        }
+        if (len < (int)sizeof(text)) {
+            len += snprintf(text + len, sizeof(text) - len, "%-11s %6.2f %6lu %6lu %7lu %5lu\n",
+                            name, r.mb_per_s, (unsigned long)r.lat_avg_us,
+                            (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us,
+                            (unsigned long)stalls[m]);
+        }
+    }
+
+    if (err == ESP_OK && len < (int)sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len,
+                 "\nwriter: cluster %lu KB, %s reservation,\n"
+                 "%lu flushes, max %lu us, open %lu us, close %lu us\n",
+                 (unsigned long)(ws.cluster_size / 1024),
+                 ws.contiguous ? "contiguous" : "no", (unsigned long)ws.flushes,
+                 (unsigned long)ws.flush_max_us, (unsigned long)ws.open_us,
+                 (unsigned long)ws.close_us);
+    }
+    root_changed(REC_BENCH_FILE);
+
+    show_report(text, err == ESP_OK ? "Recording benchmark done" : "Recording benchmark failed");
+    return err;
+}
+
+/**
+ * @brief Rec bench button callback
+ */
+static void rec_btn_click_cb(lv_event_t *e) {
+    submit_bench(rec_bench_job);
+}
+
+/**
+ * @brief Ring log benchmark: records per second per method, then recovery
+ */
+static esp_err_t log_bench_job(void *arg) {
+    static char text[1024];
+    esp_err_t err = ESP_OK;
+
+    int len = snprintf(text, sizeof(text), "%d-byte records, up to %d per method\n\n"
+                       "%-10s %7s %6s %6s %7s\n", LOG_RECORD, LOG_RECORDS, "method", "rec/s",
+                       "avgus", "p99us", "maxus");
+
+    sd_log_config_t cfg = SD_LOG_CONFIG_DEFAULT();
+    for (int m = 0; m < SD_LOG_BENCH_METHOD_COUNT && err == ESP_OK; m++) {
+        sd_log_bench_params_t p = {(sd_log_bench_method_t)m, LOG_RECORDS, LOG_RECORD,
+                                   LOG_BUDGET_MS};
+        const char *name = sd_log_bench_method_name(p.method);
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(status_label, "Logging with %s...", name);
+        bsp_display_unlock();
+
+        sd_io_result_t r;
+        err = sd_log_bench_run(LOG_BENCH_FILE, &p, &cfg, &r);
+        if (err == ESP_OK && len < (int)sizeof(text)) {
+            len += snprintf(text + len, sizeof(text) - len, "%-10s %7.0f %6lu %6lu %7lu\n",
+                            name, r.iops, (unsigned long)r.lat_avg_us,
+                            (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us);
+        }
+    }
+
+    sd_log_recovery_result_t rr = {};
+    if (err == ESP_OK) {
+        bsp_display_lock(0);
+        lv_label_set_text(status_label, "Filling and recovering the log...");
+        bsp_display_unlock();
+        err = sd_log_bench_recovery(LOG_BENCH_FILE, &cfg, LOG_RECORD, &rr);
+    }
+    if (err == ESP_OK && len < (int)sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len,
+                 "\nrecovery: %lu blocks scanned in %lu ms,\n"
+                 "%lu records read back in %lu ms, %s\n",
+                 (unsigned long)rr.blocks, (unsigned long)(rr.open_us / 1000),
+                 (unsigned long)rr.records, (unsigned long)(rr.read_us / 1000),
+                 rr.verified ? "all intact" : "MISMATCH");
+    }
+    root_changed(LOG_BENCH_FILE);
+
+    show_report(text, err == ESP_OK ? "Log benchmark done" : "Log benchmark failed");
+    return err;
+}
+
+/**
+ * @brief Log bench button callback
+ */
+static void log_btn_click_cb(lv_event_t *e) {
+    submit_bench(log_bench_job);
+}
+
+/**
+ * @brief Card health: sector command latencies, slow commands, retries, wear
+ */
+static esp_err_t health_job(void *arg) {
+    static char text[2048];
+    sd_trace_stats_t st;
+    sd_trace_get_stats(&st);
+
+    int len = snprintf(text, sizeof(text), "%-6s %6s %4s %5s %4s %7s %7s %7s\n", "cmd", "count",
+                       "err", "retry", "slow", "avg us", "max ms", "MB");
+    for (int op = 0; op < SD_TRACE_OP_COUNT && len < (int)sizeof(text); op++) {
+        const sd_trace_op_stats_t *o = &st.ops[op];
+        len += snprintf(text + len, sizeof(text) - len, "%-6s %6lu %4lu %5lu %4lu %7lu %7.1f %7.1f\n",
+                        sd_trace_op_name((sd_trace_op_t)op), (unsigned long)o->count,
+                        (unsigned long)o->errors, (unsigned long)o->retries,
+                        (unsigned long)o->slow,
+                        (unsigned long)(o->count ? o->total_us / o->count : 0),
+                        o->max_us / 1000.0,
+                        (double)(o->sectors * st.sector_size) / (1024 * 1024));
+    }
+
+    // Latency histogram of the data commands, empty buckets left out
+    if (len < (int)sizeof(text)) {
+        len += snprintf(text + len, sizeof(text) - len, "\n%-9s %8s %8s %8s\n", "latency",
+                        "read", "write", "erase");
+    }
+    for (int b = 0; b < SD_TRACE_HIST_BUCKETS && len < (int)sizeof(text); b++) {
+        const sd_trace_op_stats_t *ops = st.ops;
+        if (!ops[SD_TRACE_READ].hist[b] && !ops[SD_TRACE_WRITE].hist[b] &&
+            !ops[SD_TRACE_ERASE].hist[b]) {
+            continue;
+        }
+        char range[12];
+        unsigned long limit = SD_TRACE_HIST_LIMIT_US(b < SD_TRACE_HIST_BUCKETS - 1 ? b : b - 1);
+        snprintf(range, sizeof(range), "%s%lu%s", b < SD_TRACE_HIST_BUCKETS - 1 ? "<" : ">=",
+                 limit >= 1000 ? limit / 1000 : limit, limit >= 1000 ? "ms" : "us");
+        len += snprintf(text + len, sizeof(text) - len, "%-9s %8lu %8lu %8lu\n", range,
+                        (unsigned long)ops[SD_TRACE_READ].hist[b],
+                        (unsigned long)ops[SD_TRACE_WRITE].hist[b],
+                        (unsigned long)ops[SD_TRACE_ERASE].hist[b]);
+    }
+
+    // The commands behind stalls, with the time since boot to match the log
+    if (st.n_slow && len < (int)sizeof(text)) {
+        len += snprintf(text + len, sizeof(text) - len, "\nslow commands, newest first:\n");
+    }
+    for (uint32_t i = 0; i < st.n_slow && len < (int)sizeof(text); i++) {
+        const sd_trace_slow_t *e = &st.slow[i];
+        len += snprintf(text + len, sizeof(text) - len, "%s %lu sectors at %lu: %lu ms, at %.1f s%s\n",
+                        sd_trace_op_name((sd_trace_op_t)e->op), (unsigned long)e->count,
+                        (unsigned long)e->sector, (unsigned long)(e->us / 1000),
+                        e->at_ms / 1000.0, e->failed ? ", failed" : "");
+    }
+
+    if (len < (int)sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len,
+                 "\nwritten to this card: %.2f GB, %.3f full-card writes\n"
+                 "counters since %lu s after boot\n",
+                 (double)st.card_written / (1024.0 * 1024 * 1024),
+                 st.capacity ? (double)st.card_written / st.capacity : 0.0,
+                 (unsigned long)(st.since_ms / 1000));
+    }
+
+    FILE *csv = fopen(HEALTH_CSV, "w");
+    if (csv) {
+        sd_trace_write_csv(csv, &st);
+        fclose(csv);
+        root_changed(HEALTH_CSV);
+    }
+
+    show_report(text, csv ? "Card health, saved " HEALTH_CSV : "Card health");
+    return ESP_OK;
+}
+
+/**
+ * @brief Health button callback
+ *
+ * Runs on the UI lane and leaves the stream running: the report is most
+ * useful while the card is busy.
+ */
+static void health_btn_click_cb(lv_event_t *e) {
+    if (!sd_mounted) {
+        lv_label_set_text(status_label, "Mount SD card first!");
+        return;
+    }
+    sd_job_t job = {};
+    job.op = SD_OP_CALL;
+    job.lane = SD_LANE_UI;
+    job.fn = health_job;
+    if (sd_queue_submit(&job, NULL) == ESP_OK) {
+        set_buttons_enabled(false);
+    }
+}
+
+/**
+ * @brief Queue metrics: wait per lane, run time per operation, stream deadlines
+ */
+static void stats_timer_cb(lv_timer_t *timer) {
+    sd_queue_stats_t st;
+    sd_queue_get_stats(&st);
+
+    char wait[96];
+    int len = snprintf(wait, sizeof(wait), "wait avg/max ms");
+    for (int l = 0; l < SD_LANE_COUNT && len < (int)sizeof(wait); l++) {
+        const sd_lane_stats_t *ls = &st.lanes[l];
+        len += snprintf(wait + len, sizeof(wait) - len, "  %s %.1f/%.1f",
+                        sd_queue_lane_name((sd_lane_t)l),
+                        ls->started ? (double)ls->total_wait_us / ls->started / 1000 : 0.0,
+                        ls->max_wait_us / 1000.0);
+    }
+
+    char run[96];
+    len = snprintf(run, sizeof(run), "run avg/max ms");
+    const sd_op_t shown[] = {SD_OP_READ, SD_OP_WRITE, SD_OP_CALL, SD_OP_MOUNT};
+    for (size_t i = 0; i < sizeof(shown) / sizeof(shown[0]) && len < (int)sizeof(run); i++) {
+        const sd_op_stats_t *os = &st.ops[shown[i]];
+        len += snprintf(run + len, sizeof(run) - len, "  %s %.1f/%.1f",
+                        sd_queue_op_name(shown[i]),
+                        os->count ? (double)os->total_us / os->count / 1000 : 0.0,
+                        os->max_us / 1000.0);
+    }
+
+    lv_label_set_text_fmt(stats_label, "%s\n%s\nstream %lu reads, %lu missed, max %.1f ms, %lu preempted\n%s",
+                          wait, run, (unsigned long)stream_reads, (unsigned long)stream_missed,
+                          stream_max_us / 1000.0, (unsigned long)st.preempted, catalog_text);
 }
 
 /**
@@ -318,8 +1477,8 @@ static void create_ui(void) {
 
     // Mount button
     mount_btn = lv_btn_create(scr);
-    lv_obj_set_size(mount_btn, 140, 50);
-    lv_obj_align(mount_btn, LV_ALIGN_TOP_LEFT, 30, 85);
+    lv_obj_set_size(mount_btn, 84, 50);
+    lv_obj_align(mount_btn, LV_ALIGN_TOP_LEFT, 10, 85);
     lv_obj_add_event_cb(mount_btn, mount_btn_click_cb, LV_EVENT_CLICKED, NULL);
 
     lv_obj_t *mount_label = lv_label_create(mount_btn);
@@ -328,18 +1487,126 @@ static void create_ui(void) {
 
     // Write test file button
     write_btn = lv_btn_create(scr);
-    lv_obj_set_size(write_btn, 140, 50);
-    lv_obj_align(write_btn, LV_ALIGN_TOP_RIGHT, -30, 85);
+    lv_obj_set_size(write_btn, 84, 50);
+    lv_obj_align(write_btn, LV_ALIGN_TOP_LEFT, 103, 85);
     lv_obj_add_event_cb(write_btn, write_btn_click_cb, LV_EVENT_CLICKED, NULL);
     lv_obj_set_style_bg_color(write_btn, lv_color_hex(0x2d8659), 0);
 
     lv_obj_t *write_label = lv_label_create(write_btn);
-    lv_label_set_text(write_label, "Write Test");
+    lv_label_set_text(write_label, "Write");
     lv_obj_center(write_label);
 
+    // Stream simulation toggle
+    stream_btn = lv_btn_create(scr);
+    lv_obj_set_size(stream_btn, 84, 50);
+    lv_obj_align(stream_btn, LV_ALIGN_TOP_LEFT, 196, 85);
+    lv_obj_add_event_cb(stream_btn, stream_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(stream_btn, lv_color_hex(0x2d5986), 0);
+
+    lv_obj_t *stream_label = lv_label_create(stream_btn);
+    lv_label_set_text(stream_label, "Stream");
+    lv_obj_center(stream_label);
+
+    // Listing benchmark button
+    bench_btn = lv_btn_create(scr);
+    lv_obj_set_size(bench_btn, 84, 50);
+    lv_obj_align(bench_btn, LV_ALIGN_TOP_LEFT, 289, 85);
+    lv_obj_add_event_cb(bench_btn, bench_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(bench_btn, lv_color_hex(0x865a2d), 0);
+
+    lv_obj_t *bench_label = lv_label_create(bench_btn);
+    lv_label_set_text(bench_label, "List Bench");
+    lv_obj_center(bench_label);
+
+    // I/O benchmark button
+    io_btn = lv_btn_create(scr);
+    lv_obj_set_size(io_btn, 84, 50);
+    lv_obj_align(io_btn, LV_ALIGN_TOP_LEFT, 382, 85);
+    lv_obj_add_event_cb(io_btn, io_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(io_btn, lv_color_hex(0x865a2d), 0);
+
+    lv_obj_t *io_label = lv_label_create(io_btn);
+    lv_label_set_text(io_label, "I/O Bench");
+    lv_obj_center(io_label);
+
+    // Page navigation
+    prev_btn = lv_btn_create(scr);
+    lv_obj_set_size(prev_btn, 84, 45);
+    lv_obj_align(prev_btn, LV_ALIGN_TOP_LEFT, 10, 150);
+    lv_obj_add_event_cb(prev_btn, prev_btn_click_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *prev_label = lv_label_create(prev_btn);
+    lv_label_set_text(prev_label, LV_SYMBOL_LEFT " Prev");
+    lv_obj_center(prev_label);
+
+    next_btn = lv_btn_create(scr);
+    lv_obj_set_size(next_btn, 84, 45);
+    lv_obj_align(next_btn, LV_ALIGN_TOP_LEFT, 103, 150);
+    lv_obj_add_event_cb(next_btn, next_btn_click_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *next_label = lv_label_create(next_btn);
+    lv_label_set_text(next_label, "Next " LV_SYMBOL_RIGHT);
+    lv_obj_center(next_label);
+
+    // Sort order of the file list
+    sort_btn = lv_btn_create(scr);
+    lv_obj_set_size(sort_btn, 110, 36);
+    lv_obj_align(sort_btn, LV_ALIGN_TOP_LEFT, 10, 12);
+    lv_obj_add_event_cb(sort_btn, sort_btn_click_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *sort_label = lv_label_create(sort_btn);
+    lv_label_set_text(sort_label, "Sort: name");
+    lv_obj_center(sort_label);
+
+    page_label = lv_label_create(scr);
+    lv_label_set_text(page_label, "");
+    lv_obj_set_style_text_color(page_label, lv_color_hex(0x888888), 0);
+    lv_obj_align(page_label, LV_ALIGN_TOP_RIGHT, -15, 23);
+
+    // Recording benchmark button
+    rec_btn = lv_btn_create(scr);
+    lv_obj_set_size(rec_btn, 84, 45);
+    lv_obj_align(rec_btn, LV_ALIGN_TOP_LEFT, 289, 150);
+    lv_obj_add_event_cb(rec_btn, rec_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(rec_btn, lv_color_hex(0x865a2d), 0);
+
+    lv_obj_t *rec_label = lv_label_create(rec_btn);
+    lv_label_set_text(rec_label, "Rec Bench");
+    lv_obj_center(rec_label);
+
+    // Ring log benchmark button
+    log_btn = lv_btn_create(scr);
+    lv_obj_set_size(log_btn, 84, 45);
+    lv_obj_align(log_btn, LV_ALIGN_TOP_LEFT, 382, 150);
+    lv_obj_add_event_cb(log_btn, log_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(log_btn, lv_color_hex(0x865a2d), 0);
+
+    lv_obj_t *log_label = lv_label_create(log_btn);
+    lv_label_set_text(log_label, "Log Bench");
+    lv_obj_center(log_label);
+
+    // Card health report
+    health_btn = lv_btn_create(scr);
+    lv_obj_set_size(health_btn, 84, 45);
+    lv_obj_align(health_btn, LV_ALIGN_TOP_LEFT, 196, 150);
+    lv_obj_add_event_cb(health_btn, health_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_set_style_bg_color(health_btn, lv_color_hex(0x2d8686), 0);
+
+    lv_obj_t *health_label = lv_label_create(health_btn);
+    lv_label_set_text(health_label, "Health");
+    lv_obj_center(health_label);
+
+    // Queue metrics and the catalog summary, refreshed every second
+    stats_label = lv_label_create(scr);
+    lv_label_set_text(stats_label, "");
+    lv_obj_set_style_text_color(stats_label, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_text_font(stats_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(stats_label, LV_ALIGN_TOP_LEFT, 12, 202);
+    lv_timer_create(stats_timer_cb, 1000, NULL);
+
     // File list container
     file_list = lv_obj_create(scr);
-    lv_obj_set_size(file_list, LV_PCT(95), 520);
+    lv_obj_set_size(file_list, LV_PCT(95), 500);
     lv_obj_align(file_list, LV_ALIGN_BOTTOM_MID, 0, -20);
     lv_obj_set_style_bg_color(file_list, lv_color_hex(0x16213e), 0);
     lv_obj_set_style_border_width(file_list, 0, 0);
@@ -393,6 +1660,23 @@ extern "C" void app_main(void) {
     bsp_display_backlight_on();
     bsp_display_brightness_set(100);
 
+    // Card power, identification and hot plug; the worker mounts through it
+    sd_service_config_t service_cfg = SD_SERVICE_CONFIG_DEFAULT();
+    service_cfg.mount_point = BSP_SD_MOUNT_POINT;
+    service_cfg.on_event = card_event;
+    ESP_ERROR_CHECK(sd_service_init(&service_cfg));
+
+    // Latency tracing of the card's sector commands, attached at each mount
+    sd_trace_config_t trace_cfg = SD_TRACE_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(sd_trace_init(&trace_cfg));
+
+    // SD worker: mount, unmount and all file access run there
+    sd_queue_config_t queue_cfg = SD_QUEUE_CONFIG_DEFAULT();
+    queue_cfg.mount = sd_mount;
+    queue_cfg.unmount = sd_unmount;
+    queue_cfg.dispatch = ui_dispatch;
+    ESP_ERROR_CHECK(sd_queue_init(&queue_cfg));
+
     // Create UI
     bsp_display_lock(0);
     create_ui();
@@ -401,7 +1685,7 @@ extern "C" void app_main(void) {
 
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, "  SD Card demo ready!");
-    ESP_LOGI(TAG, "  Insert SD card and press Mount");
+    ESP_LOGI(TAG, "  Insert SD card (mounts when found)");
     ESP_LOGI(TAG, "========================================");
 
     // Main loop
@@ -0,0 +1,695 @@
+/**
+ * @file sd_browser.cpp
+ * @brief Sorted, paged view of one directory, loaded a step at a time
+ *
+ * Entries are kept as sd_index_entry_t everywhere: in the RAM buffer, in
+ * the runs and in the sorted file, so a page of the sorted file is one
+ * fseek() and one fread().
+ *
+ * Runs wait in a FIFO. A merge takes up to merge_ways runs from the front
+ * and appends the merged run to the back, until one run is left: that is
+ * the sorted file. The merge keeps one head entry and one read buffer per
+ * input, which bounds its memory whatever the directory size.
+ */
+
+#include "sd_browser.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#ifdef ESP_PLATFORM
+#include "ff.h"
+#endif
+
+static const char *TAG = "sd_browser";
+
+#define PATH_MAX_LEN        256
+#define MERGE_WAYS_MAX      16
+#define MERGE_BUF_SIZE      4096        // stdio buffer per merge input and output
+#define CHECK_EVERY         32          // Entries between budget checks
+
+typedef int (*cmp_fn_t)(const void *a, const void *b);
+
+typedef enum {
+    STATE_IDLE,
+    STATE_READING,
+    STATE_MERGING,
+    STATE_DONE,
+} state_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t count;
+} run_t;
+
+struct sd_browser {
+    char mount_point[32];
+    char drive[8];              // Empty: portable path only
+    char spill_dir[96];
+    uint32_t run_entries;
+    uint32_t first_batch;
+    uint32_t preview_max;
+    uint32_t merge_ways;
+
+    // Open listing
+    state_t state;
+    char path[PATH_MAX_LEN];
+    const char *skip;           // Name of spill_dir when listing its parent
+    sd_browse_key_t key;
+    bool descending;
+    cmp_fn_t cmp;
+    int64_t opened_at;
+#ifdef ESP_PLATFORM
+    FF_DIR fdir;
+    FILINFO fno;
+#endif
+    bool fat_open;
+    DIR *dir;
+
+    // Entries read and not yet spilled
+    sd_index_entry_t *buf;
+    uint32_t n_buf;
+    bool buf_sorted;
+
+    // Head of the first run, served while runs are merged
+    sd_index_entry_t *preview;
+    uint32_t n_preview;
+
+    // Runs on the card, oldest first
+    run_t *runs;
+    uint32_t n_runs;
+    uint32_t runs_cap;
+    uint32_t next_id;
+    bool spill_made;
+
+    // Merge in progress
+    FILE *in[MERGE_WAYS_MAX];
+    char *in_buf[MERGE_WAYS_MAX];
+    uint32_t in_id[MERGE_WAYS_MAX];
+    sd_index_entry_t *heads;
+    uint32_t n_in;
+    FILE *out;
+    char *out_buf;
+    run_t out_run;
+
+    // Sorted result on the card; NULL if it fit in RAM
+    FILE *sorted;
+    uint32_t sorted_id;
+    uint32_t total;
+
+    sd_browser_info_t info;
+};
+
+// ============================================================================
+// Order
+// ============================================================================
+
+static int by_name(const sd_index_entry_t *a, const sd_index_entry_t *b) {
+    int c = strcasecmp(a->name, b->name);
+    return c ? c : strcmp(a->name, b->name);
+}
+
+int sd_browser_compare(sd_browse_key_t key, bool descending, const sd_index_entry_t *a,
+                       const sd_index_entry_t *b) {
+    if (a->type != b->type) {
+        return a->type == SD_ENTRY_DIR ? -1 : 1;
+    }
+    int c = 0;
+    if (key == SD_BROWSE_SIZE && a->size != b->size) {
+        c = a->size < b->size ? -1 : 1;
+    } else if (key == SD_BROWSE_DATE && a->mtime != b->mtime) {
+        c = a->mtime < b->mtime ? -1 : 1;
+    } else {
+        c = by_name(a, b);
+    }
+    return descending ? -c : c;
+}
+
+// qsort() takes no context, so one comparator per order
+#define DEFINE_CMP(fn, key, descending)                                                   \
+    static int fn(const void *a, const void *b) {                                         \
+        return sd_browser_compare(key, descending, (const sd_index_entry_t *)a,           \
+                                  (const sd_index_entry_t *)b);                           \
+    }
+
+DEFINE_CMP(cmp_name_up, SD_BROWSE_NAME, false)
+DEFINE_CMP(cmp_name_down, SD_BROWSE_NAME, true)
+DEFINE_CMP(cmp_size_up, SD_BROWSE_SIZE, false)
+DEFINE_CMP(cmp_size_down, SD_BROWSE_SIZE, true)
+DEFINE_CMP(cmp_date_up, SD_BROWSE_DATE, false)
+DEFINE_CMP(cmp_date_down, SD_BROWSE_DATE, true)
+
+static const cmp_fn_t comparators[SD_BROWSE_KEY_COUNT][2] = {
+    {cmp_name_up, cmp_name_down},
+    {cmp_size_up, cmp_size_down},
+    {cmp_date_up, cmp_date_down},
+};
+
+const char *sd_browser_key_name(sd_browse_key_t key) {
+    static const char *names[] = {"name", "size", "date"};
+    return key < SD_BROWSE_KEY_COUNT ? names[key] : "?";
+}
+
+void sd_browser_format_size(uint64_t size, char *out, size_t len) {
+    if (size < 1024) {
+        snprintf(out, len, "%lu B", (unsigned long)size);
+    } else if (size < 1024 * 1024) {
+        snprintf(out, len, "%.1f KB", (double)size / 1024);
+    } else if (size < 1024ULL * 1024 * 1024) {
+        snprintf(out, len, "%.1f MB", (double)size / (1024 * 1024));
+    } else {
+        snprintf(out, len, "%.1f GB", (double)size / (1024 * 1024 * 1024));
+    }
+}
+
+// ============================================================================
+// Runs on the card
+// ============================================================================
+
+static void run_path(const sd_browser_t *b, uint32_t id, char *out, size_t len) {
+    snprintf(out, len, "%s/r%05lu.bin", b->spill_dir, (unsigned long)id);
+}
+
+static void run_delete(const sd_browser_t *b, uint32_t id) {
+    char path[128];
+    run_path(b, id, path, sizeof(path));
+    unlink(path);
+}
+
+static FILE *run_open(const sd_browser_t *b, uint32_t id, const char *mode, char *buf) {
+    char path[128];
+    run_path(b, id, path, sizeof(path));
+    FILE *f = fopen(path, mode);
+    if (f && buf) {
+        setvbuf(f, buf, _IOFBF, MERGE_BUF_SIZE);
+    }
+    return f;
+}
+
+static esp_err_t runs_push(sd_browser_t *b, run_t run) {
+    if (b->n_runs == b->runs_cap) {
+        uint32_t cap = b->runs_cap ? b->runs_cap * 2 : 16;
+        run_t *runs = (run_t *)realloc(b->runs, cap * sizeof(run_t));
+        if (!runs) {
+            return ESP_ERR_NO_MEM;
+        }
+        b->runs = runs;
+        b->runs_cap = cap;
+    }
+    b->runs[b->n_runs++] = run;
+    return ESP_OK;
+}
+
+/**
+ * @brief Sort the RAM buffer and write it as a run
+ */
+static esp_err_t spill(sd_browser_t *b) {
+    if (!b->spill_made) {
+        if (mkdir(b->spill_dir, 0755) != 0 && errno != EEXIST) {
+            ESP_LOGE(TAG, "Cannot create %s", b->spill_dir);
+            return ESP_FAIL;
+        }
+        b->spill_made = true;
+    }
+    qsort(b->buf, b->n_buf, sizeof(sd_index_entry_t), b->cmp);
+    if (b->info.runs == 0) {
+        b->n_preview = b->n_buf < b->preview_max ? b->n_buf : b->preview_max;
+        memcpy(b->preview, b->buf, b->n_preview * sizeof(sd_index_entry_t));
+    }
+
+    run_t run = {b->next_id++, b->n_buf};
+    FILE *f = run_open(b, run.id, "wb", NULL);
+    bool ok = f && fwrite(b->buf, sizeof(sd_index_entry_t), b->n_buf, f) == b->n_buf;
+    if (f && fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Writing run %lu failed", (unsigned long)run.id);
+        run_delete(b, run.id);
+        return ESP_FAIL;
+    }
+    b->info.runs++;
+    b->n_buf = 0;
+    return runs_push(b, run);
+}
+
+// ============================================================================
+// Merge
+// ============================================================================
+
+static void merge_close(sd_browser_t *b) {
+    for (uint32_t i = 0; i < b->n_in; i++) {
+        if (b->in[i]) {
+            fclose(b->in[i]);
+            b->in[i] = NULL;
+        }
+        run_delete(b, b->in_id[i]);
+    }
+    b->n_in = 0;
+    if (b->out) {
+        fclose(b->out);
+        b->out = NULL;
+        run_delete(b, b->out_run.id);
+    }
+}
+
+/**
+ * @brief Take the next group of runs from the FIFO, or finish with the last one
+ */
+static esp_err_t merge_start(sd_browser_t *b) {
+    if (b->n_runs == 1) {
+        b->sorted_id = b->runs[0].id;
+        b->total = b->runs[0].count;
+        b->n_runs = 0;
+        b->sorted = run_open(b, b->sorted_id, "rb", NULL);
+        return b->sorted ? ESP_OK : ESP_FAIL;
+    }
+
+    uint32_t n = b->n_runs < b->merge_ways ? b->n_runs : b->merge_ways;
+    for (uint32_t i = 0; i < n; i++) {
+        b->in_id[i] = b->runs[i].id;
+        b->in[i] = run_open(b, b->in_id[i], "rb", b->in_buf[i]);
+        b->n_in = i + 1;
+        if (!b->in[i]) {
+            return ESP_FAIL;
+        }
+        if (fread(&b->heads[i], sizeof(sd_index_entry_t), 1, b->in[i]) != 1) {
+            fclose(b->in[i]);
+            b->in[i] = NULL;
+        }
+    }
+    b->n_runs -= n;
+    memmove(b->runs, b->runs + n, b->n_runs * sizeof(run_t));
+
+    b->out_run.id = b->next_id++;
+    b->out_run.count = 0;
+    b->out = run_open(b, b->out_run.id, "wb", b->out_buf);
+    return b->out ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Merge entries of the current group until it ends or the deadline
+ */
+static esp_err_t merge_some(sd_browser_t *b, int64_t deadline) {
+    for (uint32_t n = 0;; n++) {
+        if (n % CHECK_EVERY == 0 && n > 0 && esp_timer_get_time() >= deadline) {
+            return ESP_ERR_NOT_FINISHED;
+        }
+
+        // Smallest head; a linear scan is enough for merge_ways inputs
+        int best = -1;
+        for (uint32_t i = 0; i < b->n_in; i++) {
+            if (b->in[i] && (best < 0 || b->cmp(&b->heads[i], &b->heads[best]) < 0)) {
+                best = (int)i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+
+        if (fwrite(&b->heads[best], sizeof(sd_index_entry_t), 1, b->out) != 1) {
+            return ESP_FAIL;
+        }
+        b->out_run.count++;
+        if (fread(&b->heads[best], sizeof(sd_index_entry_t), 1, b->in[best]) != 1) {
+            fclose(b->in[best]);
+            b->in[best] = NULL;
+        }
+    }
+
+    // Group done: its runs are no longer needed
+    bool ok = fclose(b->out) == 0;
+    b->out = NULL;
+    for (uint32_t i = 0; i < b->n_in; i++) {
+        run_delete(b, b->in_id[i]);
+    }
+    b->n_in = 0;
+    if (!ok) {
+        run_delete(b, b->out_run.id);
+        return ESP_FAIL;
+    }
+    b->info.merges++;
+    return runs_push(b, b->out_run);
+}
+
+// ============================================================================
+// Directory readers
+// ============================================================================
+
+/**
+ * @brief Next entry of the directory
+ *
+ * @return ESP_OK with an entry, ESP_ERR_NOT_FOUND at the end, ESP_FAIL on error
+ */
+static esp_err_t read_entry(sd_browser_t *b, sd_index_entry_t *e) {
+#ifdef ESP_PLATFORM
+    if (b->fat_open) {
+        for (;;) {
+            FRESULT fr = f_readdir(&b->fdir, &b->fno);
+            if (fr != FR_OK) {
+                ESP_LOGW(TAG, "f_readdir(%s): %d", b->path, fr);
+                return ESP_FAIL;
+            }
+            if (!b->fno.fname[0]) {
+                return ESP_ERR_NOT_FOUND;
+            }
+            if (b->skip && strcmp(b->fno.fname, b->skip) == 0) {
+                continue;
+            }
+            bool is_dir = (b->fno.fattrib & AM_DIR) != 0;
+            snprintf(e->name, sizeof(e->name), "%s", b->fno.fname);
+            e->type = is_dir ? SD_ENTRY_DIR : SD_ENTRY_FILE;
+            e->size = is_dir ? 0
+                             : (b->fno.fsize > UINT32_MAX ? UINT32_MAX : (uint32_t)b->fno.fsize);
+            e->mtime = sd_index_fat_to_unix(b->fno.fdate, b->fno.ftime);
+            return ESP_OK;
+        }
+    }
+#endif
+
+    struct dirent *d;
+    while ((d = readdir(b->dir)) != NULL) {
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0 ||
+            (b->skip && strcmp(d->d_name, b->skip) == 0)) {
+            continue;
+        }
+        snprintf(e->name, sizeof(e->name), "%s", d->d_name);
+        e->type = d->d_type == DT_DIR ? SD_ENTRY_DIR : SD_ENTRY_FILE;
+        e->size = 0;
+        e->mtime = 0;
+
+        // Size and date are sort keys, so files are stat()ed
+        if (d->d_type != DT_DIR) {
+            char full[PATH_MAX_LEN + SD_INDEX_NAME_MAX + 1];
+            snprintf(full, sizeof(full), "%s/%s", b->path, d->d_name);
+            struct stat st;
+            if (stat(full, &st) == 0) {
+                e->type = S_ISDIR(st.st_mode) ? SD_ENTRY_DIR : SD_ENTRY_FILE;
+                e->size = e->type == SD_ENTRY_FILE ? (uint32_t)st.st_size : 0;
+                e->mtime = (uint32_t)st.st_mtime;
+            }
+        }
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void reader_close(sd_browser_t *b) {
+#ifdef ESP_PLATFORM
+    if (b->fat_open) {
+        f_closedir(&b->fdir);
+    }
+#endif
+    b->fat_open = false;
+    if (b->dir) {
+        closedir(b->dir);
+        b->dir = NULL;
+    }
+}
+
+static esp_err_t reader_open(sd_browser_t *b) {
+#ifdef ESP_PLATFORM
+    size_t len = strlen(b->mount_point);
+    if (b->drive[0] && strncmp(b->path, b->mount_point, len) == 0 &&
+        (b->path[len] == '/' || b->path[len] == '\0')) {
+        char fpath[PATH_MAX_LEN + 8];
+        snprintf(fpath, sizeof(fpath), "%s%s", b->drive, b->path[len] ? b->path + len : "/");
+        FRESULT fr = f_opendir(&b->fdir, fpath);
+        if (fr == FR_NO_PATH || fr == FR_NO_FILE || fr == FR_INVALID_NAME) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (fr != FR_OK) {
+            ESP_LOGW(TAG, "f_opendir(%s): %d", fpath, fr);
+            return ESP_FAIL;
+        }
+        b->fat_open = true;
+        return ESP_OK;
+    }
+#endif
+    b->dir = opendir(b->path);
+    if (!b->dir) {
+        return (errno == ENOENT || errno == ENOTDIR) ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_browser_create(const sd_browser_config_t *config, sd_browser_t **out) {
+    if (!config || !out || !config->mount_point || !config->spill_dir ||
+        config->run_entries == 0 || config->merge_ways < 2 ||
+        config->merge_ways > MERGE_WAYS_MAX ||
+        strlen(config->mount_point) >= sizeof(((sd_browser_t *)0)->mount_point) ||
+        strlen(config->spill_dir) >= sizeof(((sd_browser_t *)0)->spill_dir) ||
+        (config->fatfs_drive && strlen(config->fatfs_drive) >= sizeof(((sd_browser_t *)0)->drive))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sd_browser_t *b = (sd_browser_t *)calloc(1, sizeof(sd_browser_t));
+    if (!b) {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(b->mount_point, config->mount_point);
+    strcpy(b->spill_dir, config->spill_dir);
+    if (config->fatfs_drive) {
+        strcpy(b->drive, config->fatfs_drive);
+    }
+    b->run_entries = config->run_entries;
+    b->first_batch = config->first_batch;
+    b->preview_max = config->preview_entries;
+    b->merge_ways = config->merge_ways;
+
+    // All buffers up front: the memory of a browser does not grow with the directory
+    b->buf = (sd_index_entry_t *)heap_caps_malloc(b->run_entries * sizeof(sd_index_entry_t),
+                                                  MALLOC_CAP_SPIRAM);
+    b->preview = (sd_index_entry_t *)heap_caps_malloc(
+        (b->preview_max ? b->preview_max : 1) * sizeof(sd_index_entry_t), MALLOC_CAP_SPIRAM);
+    b->heads = (sd_index_entry_t *)heap_caps_malloc(b->merge_ways * sizeof(sd_index_entry_t),
+                                                    MALLOC_CAP_SPIRAM);
+    b->out_buf = (char *)heap_caps_malloc(MERGE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    bool ok = b->buf && b->preview && b->heads && b->out_buf;
+    for (uint32_t i = 0; ok && i < b->merge_ways; i++) {
+        b->in_buf[i] = (char *)heap_caps_malloc(MERGE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        ok = b->in_buf[i] != NULL;
+    }
+    if (!ok) {
+        sd_browser_destroy(b);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *out = b;
+    return ESP_OK;
+}
+
+void sd_browser_destroy(sd_browser_t *b) {
+    if (!b) {
+        return;
+    }
+    sd_browser_close(b);
+    for (uint32_t i = 0; i < MERGE_WAYS_MAX; i++) {
+        heap_caps_free(b->in_buf[i]);
+    }
+    heap_caps_free(b->out_buf);
+    heap_caps_free(b->heads);
+    heap_caps_free(b->preview);
+    heap_caps_free(b->buf);
+    free(b->runs);
+    free(b);
+}
+
+void sd_browser_close(sd_browser_t *b) {
+    if (!b) {
+        return;
+    }
+    reader_close(b);
+    merge_close(b);
+    for (uint32_t i = 0; i < b->n_runs; i++) {
+        run_delete(b, b->runs[i].id);
+    }
+    b->n_runs = 0;
+    if (b->sorted) {
+        fclose(b->sorted);
+        b->sorted = NULL;
+        run_delete(b, b->sorted_id);
+    }
+    if (b->spill_made) {
+        rmdir(b->spill_dir);
+        b->spill_made = false;
+    }
+    b->state = STATE_IDLE;
+    b->n_buf = 0;
+    b->n_preview = 0;
+    b->total = 0;
+}
+
+esp_err_t sd_browser_open(sd_browser_t *b, const char *path, sd_browse_key_t key,
+                          bool descending) {
+    if (!b || !path || key >= SD_BROWSE_KEY_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    if (len == 0 || len >= sizeof(b->path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sd_browser_close(b);
+    memcpy(b->path, path, len);
+    b->path[len] = '\0';
+    b->key = key;
+    b->descending = descending;
+    b->cmp = comparators[key][descending ? 1 : 0];
+    memset(&b->info, 0, sizeof(b->info));
+    b->buf_sorted = true;
+    b->next_id = 0;
+
+    // The spill directory is not part of its parent's listing
+    const char *slash = strrchr(b->spill_dir, '/');
+    b->skip = (slash && (size_t)(slash - b->spill_dir) == len &&
+               strncmp(b->spill_dir, b->path, len) == 0) ? slash + 1 : NULL;
+
+    b->opened_at = esp_timer_get_time();
+    esp_err_t err = reader_open(b);
+    if (err != ESP_OK) {
+        return err;
+    }
+    b->state = STATE_READING;
+    return ESP_OK;
+}
+
+esp_err_t sd_browser_step(sd_browser_t *b, uint32_t budget_ms) {
+    if (!b || b->state == STATE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (b->state == STATE_DONE) {
+        return ESP_OK;
+    }
+    int64_t start = esp_timer_get_time();
+    int64_t deadline = start + (int64_t)budget_ms * 1000;
+    bool first = b->info.steps == 0;
+    esp_err_t err = ESP_ERR_NOT_FINISHED;
+
+    // Read until the first batch, the budget or the end of the directory
+    for (uint32_t n = 0; b->state == STATE_READING; n++) {
+        if (first ? n >= b->first_batch
+                  : (n % CHECK_EVERY == 0 && n > 0 && esp_timer_get_time() >= deadline)) {
+            break;
+        }
+        esp_err_t r = read_entry(b, &b->buf[b->n_buf]);
+        if (r == ESP_ERR_NOT_FOUND) {
+            reader_close(b);
+            if (b->info.runs == 0) {
+                qsort(b->buf, b->n_buf, sizeof(sd_index_entry_t), b->cmp);
+                b->buf_sorted = true;
+                b->total = b->n_buf;
+                b->state = STATE_DONE;
+            } else {
+                err = b->n_buf ? spill(b) : ESP_OK;
+                b->state = STATE_MERGING;
+            }
+            break;
+        }
+        if (r != ESP_OK) {
+            err = r;
+            break;
+        }
+        b->info.loaded++;
+        b->buf_sorted = false;
+        if (++b->n_buf == b->run_entries && (err = spill(b)) != ESP_OK) {
+            break;
+        }
+        err = ESP_ERR_NOT_FINISHED;
+    }
+
+    // Merge for the rest of the budget
+    while (b->state == STATE_MERGING && (err == ESP_OK || err == ESP_ERR_NOT_FINISHED) &&
+           !first && esp_timer_get_time() < deadline) {
+        err = b->out ? merge_some(b, deadline) : merge_start(b);
+        if (err == ESP_OK && b->sorted) {
+            b->state = STATE_DONE;
+        }
+    }
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    b->info.steps++;
+    b->info.work_us += us;
+    if (first) {
+        b->info.first_page_us = (uint32_t)(esp_timer_get_time() - b->opened_at);
+    }
+    if (err != ESP_OK && err != ESP_ERR_NOT_FINISHED) {
+        ESP_LOGE(TAG, "%s: %s", b->path, esp_err_to_name(err));
+        sd_browser_close(b);
+        return err;
+    }
+    if (b->state != STATE_DONE) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    b->info.total_us = (uint32_t)(esp_timer_get_time() - b->opened_at);
+    ESP_LOGI(TAG, "%s: %lu entries by %s%s, first page %lu us, sorted in %lu us "
+             "(%lu runs, %lu merges)", b->path, (unsigned long)b->total,
+             sd_browser_key_name(b->key), b->descending ? " (reversed)" : "",
+             (unsigned long)b->info.first_page_us, (unsigned long)b->info.total_us,
+             (unsigned long)b->info.runs, (unsigned long)b->info.merges);
+    return ESP_OK;
+}
+
+esp_err_t sd_browser_page(sd_browser_t *b, uint32_t offset, sd_index_entry_t *entries,
+                          size_t max, size_t *count, sd_browser_info_t *info) {
+    if (!b || (max && !entries) || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+    if (b->state == STATE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Source in sort order: the sorted file, the RAM buffer or the preview
+    esp_err_t err = ESP_OK;
+    uint32_t total;
+    if (b->sorted) {
+        total = b->total;
+        uint32_t n = offset < total ? total - offset : 0;
+        n = n < max ? n : (uint32_t)max;
+        if (n && (fseek(b->sorted, (long)(offset * sizeof(sd_index_entry_t)), SEEK_SET) != 0 ||
+                  fread(entries, sizeof(sd_index_entry_t), n, b->sorted) != n)) {
+            err = ESP_FAIL;
+            n = 0;
+        }
+        *count = n;
+    } else {
+        const sd_index_entry_t *src = b->buf;
+        total = b->n_buf;
+        if (b->info.runs) {
+            src = b->preview;
+            total = b->n_preview;
+        } else if (!b->buf_sorted) {
+            qsort(b->buf, b->n_buf, sizeof(sd_index_entry_t), b->cmp);
+            b->buf_sorted = true;
+        }
+        for (uint32_t i = offset; i < total && *count < max; i++) {
+            entries[(*count)++] = src[i];
+        }
+    }
+
+    if (info) {
+        *info = b->info;
+        info->total = total;
+        info->complete = b->state == STATE_DONE;
+        info->spilled = b->info.runs > 0;
+    }
+    return err;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file sd_browser.h
+ * @brief Sorted, paged view of one directory, loaded a step at a time
+ *
+ * A file browser model for directories of any size:
+ *
+ * - The directory is read in steps on the caller's task (the SD worker),
+ *   with the FatFs fast path of sd_index where it applies. The first step
+ *   stops after first_batch entries, so a page can be shown right away
+ *   and fills up while later steps read the rest.
+ * - Entries are sorted by name, size or date, directories first.
+ * - Memory is bounded: up to run_entries entries are sorted in RAM. A
+ *   larger directory is cut into sorted runs written to spill_dir on the
+ *   card, which later steps merge merge_ways at a time into one sorted
+ *   file. Pages of the result are read from that file by offset.
+ * - Until the order is final, pages come from what is sorted so far: the
+ *   entries read, or the head of the first run once runs are spilled.
+ *
+ * Not thread safe: open, step and page from one task.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sort order
+ */
+typedef enum {
+    SD_BROWSE_NAME,          // A-Z, any case
+    SD_BROWSE_SIZE,          // Smallest first
+    SD_BROWSE_DATE,          // Oldest first
+    SD_BROWSE_KEY_COUNT,
+} sd_browse_key_t;
+
+/**
+ * @brief State of the open listing
+ */
+typedef struct {
+    uint32_t total;          // Entries pages can return now
+    uint32_t loaded;         // Entries read from the directory
+    bool complete;           // Directory read and sorted: the order is final
+    bool spilled;            // Sorted through runs on the card
+    uint32_t runs;           // Runs written
+    uint32_t merges;         // Groups of runs merged
+    uint32_t steps;
+    uint32_t first_page_us;  // sd_browser_open() to the end of the first step
+    uint32_t work_us;        // Time spent in steps
+    uint32_t total_us;       // sd_browser_open() to complete
+} sd_browser_info_t;
+
+/**
+ * @brief Browser configuration
+ */
+typedef struct {
+    const char *mount_point;     // VFS path of the FAT volume, e.g. "/sdcard"
+    const char *fatfs_drive;     // Its FatFs drive ("0:"), NULL for the portable path
+    const char *spill_dir;       // Directory for sorted runs (created when needed)
+    uint32_t run_entries;        // Entries sorted in RAM (PSRAM, 268 bytes each)
+    uint32_t first_batch;        // Entries read by the first step
+    uint32_t preview_entries;    // Head of the first run served while merging
+    uint8_t merge_ways;          // Runs merged at once (2..16)
+} sd_browser_config_t;
+
+#define SD_BROWSER_CONFIG_DEFAULT() {       \
+    .mount_point = "/sdcard",               \
+    .fatfs_drive = "0:",                    \
+    .spill_dir = "/sdcard/.browse",         \
+    .run_entries = 2048,                    \
+    .first_batch = 64,                      \
+    .preview_entries = 150,                 \
+    .merge_ways = 8,                        \
+}
+
+typedef struct sd_browser sd_browser_t;
+
+/**
+ * @brief Create a browser
+ *
+ * @param config: Configuration (strings are copied)
+ * @param out: Receives the browser handle
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing argument or value out of range
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t sd_browser_create(const sd_browser_config_t *config, sd_browser_t **out);
+
+/**
+ * @brief Close the listing and free the browser
+ */
+void sd_browser_destroy(sd_browser_t *b);
+
+/**
+ * @brief Start a listing of a directory
+ *
+ * Closes the previous listing. Nothing is read until sd_browser_step().
+ *
+ * @param b: Browser handle
+ * @param path: Directory (VFS path)
+ * @param key: Sort order
+ * @param descending: Reverse the order (directories stay first)
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_NOT_FOUND: Directory does not exist
+ *    - ESP_FAIL: Could not open the directory
+ */
+esp_err_t sd_browser_open(sd_browser_t *b, const char *path, sd_browse_key_t key,
+                          bool descending);
+
+/**
+ * @brief Read and sort for up to budget_ms
+ *
+ * The first step after sd_browser_open() returns after first_batch
+ * entries. Spilling a run may overrun the budget by one run write.
+ *
+ * @return
+ *    - ESP_OK: Complete, the order is final
+ *    - ESP_ERR_NOT_FINISHED: Call again
+ *    - ESP_ERR_INVALID_STATE: No listing open
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: Read error, or a run could not be written (card full)
+ */
+esp_err_t sd_browser_step(sd_browser_t *b, uint32_t budget_ms);
+
+/**
+ * @brief Copy a page of the listing in sort order
+ *
+ * @param b: Browser handle
+ * @param offset: First entry to copy
+ * @param entries: Destination array
+ * @param max: Size of the destination array
+ * @param count: Receives the number of entries copied
+ * @param info: Listing state, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Success (count is 0 past the entries available)
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: No listing open
+ *    - ESP_FAIL: Read error on the sorted file
+ */
+esp_err_t sd_browser_page(sd_browser_t *b, uint32_t offset, sd_index_entry_t *entries,
+                          size_t max, size_t *count, sd_browser_info_t *info);
+
+/**
+ * @brief Close the listing and delete its runs
+ *
+ * For callers that changed the directory; the next page returns
+ * ESP_ERR_INVALID_STATE until it is opened again.
+ */
+void sd_browser_close(sd_browser_t *b);
+
+/**
+ * @brief Compare two entries in the order of a key, directories first
+ */
+int sd_browser_compare(sd_browse_key_t key, bool descending, const sd_index_entry_t *a,
+                       const sd_index_entry_t *b);
+
+/**
+ * @brief Short name of a sort key
+ */
+const char *sd_browser_key_name(sd_browse_key_t key);
+
+/**
+ * @brief Format a file size: "512 B", "1.5 KB", "12.0 MB", "1.2 GB"
+ */
+void sd_browser_format_size(uint64_t size, char *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file sd_browser_bench.cpp
+ * @brief Time to the first page and to the final order of a sorted listing
+ */
+
+#include "sd_browser_bench.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_browser_bench";
+
+/**
+ * @brief Entries of a directory by readdir(), to check the listing against
+ */
+static uint32_t count_entries(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+    uint32_t n = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        n += strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0;
+    }
+    closedir(d);
+    return n;
+}
+
+esp_err_t sd_browser_bench_run(sd_browser_t *b, const char *dir, sd_browse_key_t key,
+                               bool descending, uint32_t page_size, uint32_t step_ms,
+                               sd_browser_bench_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    sd_index_entry_t *page = (sd_index_entry_t *)heap_caps_malloc(
+        (page_size + 1) * sizeof(sd_index_entry_t), MALLOC_CAP_SPIRAM);
+    if (!page) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // First page: open, one step, one page
+    size_t n = 0;
+    sd_browser_info_t info;
+    esp_err_t err = sd_browser_open(b, dir, key, descending);
+    if (err == ESP_OK) {
+        err = sd_browser_step(b, step_ms);
+    }
+    if (err == ESP_OK || err == ESP_ERR_NOT_FINISHED) {
+        err = sd_browser_page(b, 0, page, page_size, &n, &info);
+        out->first_page_us = info.first_page_us;
+        out->first_count = (uint32_t)n;
+    }
+
+    // The rest, back to back
+    if (err == ESP_OK) {
+        while ((err = sd_browser_step(b, step_ms)) == ESP_ERR_NOT_FINISHED) {
+        }
+    }
+    if (err == ESP_OK) {
+        sd_browser_page(b, 0, NULL, 0, &n, &info);
+        out->entries = info.total;
+        out->sorted_us = info.total_us;
+        out->steps = info.steps;
+        out->runs = info.runs;
+        out->merges = info.merges;
+
+        int64_t start = esp_timer_get_time();
+        uint32_t last = info.total > page_size ? (info.total - 1) / page_size * page_size : 0;
+        err = sd_browser_page(b, last, page, page_size, &n, NULL);
+        out->page_us = (uint32_t)(esp_timer_get_time() - start);
+    }
+
+    // Every page in order; page[0] holds the last entry of the previous page
+    bool ok = err == ESP_OK && info.complete && info.total == count_entries(dir);
+    uint32_t seen = 0;
+    for (uint32_t offset = 0; ok && offset < info.total; offset += page_size) {
+        ok = sd_browser_page(b, offset, page + 1, page_size, &n, NULL) == ESP_OK && n > 0;
+        for (size_t i = 0; ok && i < n; i++) {
+            ok = (offset == 0 && i == 0) ||
+                 sd_browser_compare(key, descending, &page[i], &page[i + 1]) < 0;
+        }
+        page[0] = page[n];
+        seen += (uint32_t)n;
+    }
+    out->verified = ok && seen == info.total;
+    heap_caps_free(page);
+
+    ESP_LOGI(TAG, "%s by %s: %lu entries, first page %lu us, sorted %lu us, %lu runs, %s",
+             dir, sd_browser_key_name(key), (unsigned long)out->entries,
+             (unsigned long)out->first_page_us, (unsigned long)out->sorted_us,
+             (unsigned long)out->runs, out->verified ? "ok" : "FAIL");
+    return err;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file sd_browser_bench.h
+ * @brief Time to the first page and to the final order of a sorted listing
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_browser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Times of one listing
+ */
+typedef struct {
+    uint32_t entries;
+    uint32_t first_page_us;  // Open and first step: a page can be shown
+    uint32_t first_count;    // Entries on that first page
+    uint32_t sorted_us;      // Open to the final order
+    uint32_t steps;
+    uint32_t runs;           // Runs spilled to the card, 0 if sorted in RAM
+    uint32_t merges;
+    uint32_t page_us;        // Last page of the final order
+    bool verified;           // All pages in order, no entry lost or repeated
+} sd_browser_bench_result_t;
+
+/**
+ * @brief Open a directory, step it to the end and read every page back
+ *
+ * @param b: Browser to use (its open listing is closed)
+ * @param dir: Directory
+ * @param key: Sort order
+ * @param descending: Reverse order
+ * @param page_size: Entries per page
+ * @param step_ms: Budget per sd_browser_step()
+ * @param out: Results
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: Error from sd_browser_open(), sd_browser_step() or sd_browser_page()
+ */
+esp_err_t sd_browser_bench_run(sd_browser_t *b, const char *dir, sd_browse_key_t key,
+                               bool descending, uint32_t page_size, uint32_t step_ms,
+                               sd_browser_bench_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,956 @@
+/**
+ * @file sd_catalog.cpp
+ * @brief Content index of the card: every path, sorted, in one file
+ *
+ * A table is an array of fixed-size records sorted by path (any case) plus
+ * one pool of NUL-terminated paths, both grown by doubling in PSRAM. The
+ * live table serves queries and updates under the mutex. A build fills a
+ * second table in walk order without the mutex, sorts it once at the end
+ * and swaps it in; paths updated while it ran are applied to it again.
+ *
+ * The walk is breadth-first over the build table itself: every directory
+ * record appended is visited later, so no separate stack is needed.
+ *
+ * Index file: header, records, path pool. The CRC covers records and pool.
+ */
+
+#include "sd_catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "sd_index.h"
+
+#ifdef ESP_PLATFORM
+#include "ff.h"
+#else
+#include <sys/statvfs.h>
+#endif
+
+static const char *TAG = "sd_catalog";
+
+#define CATALOG_MAGIC       0x54414353  // "SCAT"
+#define CATALOG_VERSION     1
+#define CATALOG_ROOT_MAX    64
+#define WALK_PAGE           16          // Entries copied from sd_index at a time
+#define PENDING_MAX         16          // Paths updated during a build, applied again after it
+
+// Index file flags
+#define FILE_TRUNCATED      (1 << 0)
+
+// One record; also the layout in the index file
+typedef struct {
+    uint32_t path_off;          // Into the path pool
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t hash;
+    uint8_t type;
+    uint8_t reserved[3];
+} record_t;
+
+typedef struct {
+    record_t *recs;
+    char *pool;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t pool_len;
+    uint32_t pool_cap;
+    uint32_t garbage;           // Pool bytes of removed paths
+    uint32_t dirs;
+} table_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;
+    uint32_t pool_len;
+    uint32_t dirs;
+    uint32_t flags;
+    uint64_t volume_used;       // Used bytes of the volume once the file was written
+    char root[CATALOG_ROOT_MAX];
+    uint32_t crc;
+    uint32_t reserved;
+} file_header_t;
+
+struct sd_catalog {
+    char mount_point[32];
+    char root[CATALOG_ROOT_MAX];
+    char index_path[128];
+    char drive[8];              // Empty: no FatFs free-space check
+    uint32_t max_entries;
+    SemaphoreHandle_t lock;
+
+    // Live index, under the lock
+    table_t live;
+    bool dirty;
+    bool truncated;
+    char pending[PENDING_MAX][SD_CATALOG_PATH_MAX];
+    uint32_t n_pending;
+    bool pending_overflow;
+
+    // Build in progress, owned by the task calling sd_catalog_build_step()
+    table_t build;
+    bool build_truncated;
+    bool root_done;
+    uint32_t walk_pos;          // Next build record to check for a directory
+    uint32_t build_work_us;
+    sd_index_t *walker;
+    sd_index_entry_t *page;
+
+    sd_catalog_stats_t stats;
+};
+
+// ============================================================================
+// Types
+// ============================================================================
+
+static const struct {
+    const char *ext;
+    sd_cat_type_t type;
+} ext_types[] = {
+    {"mp3", SD_CAT_AUDIO}, {"wav", SD_CAT_AUDIO}, {"flac", SD_CAT_AUDIO},
+    {"aac", SD_CAT_AUDIO}, {"m4a", SD_CAT_AUDIO}, {"ogg", SD_CAT_AUDIO},
+    {"jpg", SD_CAT_IMAGE}, {"jpeg", SD_CAT_IMAGE}, {"png", SD_CAT_IMAGE},
+    {"bmp", SD_CAT_IMAGE}, {"gif", SD_CAT_IMAGE},
+    {"mp4", SD_CAT_VIDEO}, {"avi", SD_CAT_VIDEO}, {"mjpeg", SD_CAT_VIDEO},
+    {"mkv", SD_CAT_VIDEO},
+    {"txt", SD_CAT_TEXT}, {"csv", SD_CAT_TEXT}, {"json", SD_CAT_TEXT},
+    {"log", SD_CAT_TEXT}, {"md", SD_CAT_TEXT},
+};
+
+sd_cat_type_t sd_catalog_type_of(const char *name, bool is_dir) {
+    if (is_dir) {
+        return SD_CAT_DIR;
+    }
+    const char *dot = strrchr(name, '.');
+    if (dot) {
+        for (size_t i = 0; i < sizeof(ext_types) / sizeof(ext_types[0]); i++) {
+            if (strcasecmp(dot + 1, ext_types[i].ext) == 0) {
+                return ext_types[i].type;
+            }
+        }
+    }
+    return SD_CAT_OTHER;
+}
+
+const char *sd_catalog_type_name(sd_cat_type_t type) {
+    static const char *names[] = {"dir", "audio", "image", "video", "text", "other"};
+    return type < SD_CAT_TYPE_COUNT ? names[type] : "?";
+}
+
+// ============================================================================
+// Tables
+// ============================================================================
+
+static const char *rec_path(const table_t *t, uint32_t i) {
+    return t->pool + t->recs[i].path_off;
+}
+
+static void table_free(table_t *t) {
+    heap_caps_free(t->recs);
+    heap_caps_free(t->pool);
+    memset(t, 0, sizeof(*t));
+}
+
+static bool table_reserve(table_t *t, uint32_t count, uint32_t pool_len) {
+    if (count > t->cap) {
+        uint32_t cap = t->cap ? t->cap : 256;
+        while (cap < count) {
+            cap *= 2;
+        }
+        record_t *recs = (record_t *)heap_caps_realloc(t->recs, cap * sizeof(record_t),
+                                                       MALLOC_CAP_SPIRAM);
+        if (!recs) {
+            return false;
+        }
+        t->recs = recs;
+        t->cap = cap;
+    }
+    if (pool_len > t->pool_cap) {
+        uint32_t cap = t->pool_cap ? t->pool_cap : 8192;
+        while (cap < pool_len) {
+            cap *= 2;
+        }
+        char *pool = (char *)heap_caps_realloc(t->pool, cap, MALLOC_CAP_SPIRAM);
+        if (!pool) {
+            return false;
+        }
+        t->pool = pool;
+        t->pool_cap = cap;
+    }
+    return true;
+}
+
+/**
+ * @brief FNV-1a over path, size and mtime
+ */
+static uint32_t fingerprint(const char *path, uint32_t size, uint32_t mtime) {
+    uint32_t h = 2166136261u;
+    for (const char *p = path; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    uint32_t words[2] = {size, mtime};
+    const uint8_t *b = (const uint8_t *)words;
+    for (size_t i = 0; i < sizeof(words); i++) {
+        h = (h ^ b[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void rec_set(table_t *t, record_t *r, uint32_t size, uint32_t mtime, uint8_t type) {
+    if ((r->type == SD_CAT_DIR) != (type == SD_CAT_DIR)) {
+        t->dirs += (type == SD_CAT_DIR) ? 1 : -1;
+    }
+    r->size = size;
+    r->mtime = mtime;
+    r->type = type;
+    r->hash = fingerprint(t->pool + r->path_off, size, mtime);
+}
+
+/**
+ * @brief Insert a record at position `at` (at == count appends)
+ */
+static esp_err_t table_insert(table_t *t, uint32_t at, const char *path, uint32_t size,
+                              uint32_t mtime, uint8_t type) {
+    size_t len = strlen(path) + 1;
+    if (!table_reserve(t, t->count + 1, t->pool_len + len)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memmove(&t->recs[at + 1], &t->recs[at], (t->count - at) * sizeof(record_t));
+    record_t *r = &t->recs[at];
+    memset(r, 0, sizeof(*r));
+    r->path_off = t->pool_len;
+    r->type = SD_CAT_OTHER;
+    memcpy(t->pool + t->pool_len, path, len);
+    t->pool_len += len;
+    t->count++;
+    rec_set(t, r, size, mtime, type);
+    return ESP_OK;
+}
+
+static void table_remove(table_t *t, uint32_t lo, uint32_t hi) {
+    for (uint32_t i = lo; i < hi; i++) {
+        t->garbage += strlen(rec_path(t, i)) + 1;
+        t->dirs -= t->recs[i].type == SD_CAT_DIR;
+    }
+    memmove(&t->recs[lo], &t->recs[hi], (t->count - hi) * sizeof(record_t));
+    t->count -= hi - lo;
+}
+
+/**
+ * @brief First record whose path is not below `path` (any case)
+ */
+static uint32_t table_lower_bound(const table_t *t, const char *path) {
+    uint32_t lo = 0;
+    uint32_t hi = t->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strcasecmp(rec_path(t, mid), path) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool table_find(const table_t *t, const char *path, uint32_t *at) {
+    *at = table_lower_bound(t, path);
+    return *at < t->count && strcasecmp(rec_path(t, *at), path) == 0;
+}
+
+/**
+ * @brief Records starting with `prefix` (any case): one contiguous range
+ */
+static void table_prefix_range(const table_t *t, const char *prefix, uint32_t *first,
+                               uint32_t *end) {
+    size_t len = strlen(prefix);
+    uint32_t lo = 0;
+    uint32_t hi = t->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncasecmp(rec_path(t, mid), prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *first = lo;
+    hi = t->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncasecmp(rec_path(t, mid), prefix, len) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *end = lo;
+}
+
+typedef struct {
+    const char *path;
+    uint32_t index;
+} sort_key_t;
+
+static int cmp_key(const void *a, const void *b) {
+    return strcasecmp(((const sort_key_t *)a)->path, ((const sort_key_t *)b)->path);
+}
+
+/**
+ * @brief Sort a table built in walk order
+ */
+static esp_err_t table_sort(table_t *t) {
+    if (t->count < 2) {
+        return ESP_OK;
+    }
+    sort_key_t *keys = (sort_key_t *)heap_caps_malloc(t->count * sizeof(sort_key_t),
+                                                      MALLOC_CAP_SPIRAM);
+    record_t *recs = (record_t *)heap_caps_malloc(t->cap * sizeof(record_t), MALLOC_CAP_SPIRAM);
+    if (!keys || !recs) {
+        heap_caps_free(keys);
+        heap_caps_free(recs);
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < t->count; i++) {
+        keys[i].path = rec_path(t, i);
+        keys[i].index = i;
+    }
+    qsort(keys, t->count, sizeof(sort_key_t), cmp_key);
+    for (uint32_t i = 0; i < t->count; i++) {
+        recs[i] = t->recs[keys[i].index];
+    }
+    heap_caps_free(keys);
+    heap_caps_free(t->recs);
+    t->recs = recs;
+    return ESP_OK;
+}
+
+/**
+ * @brief Drop the paths of removed records from the pool
+ */
+static esp_err_t table_compact(table_t *t) {
+    if (t->garbage == 0) {
+        return ESP_OK;
+    }
+    uint32_t cap = t->pool_len - t->garbage;
+    char *pool = (char *)heap_caps_malloc(cap ? cap : 1, MALLOC_CAP_SPIRAM);
+    if (!pool) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < t->count; i++) {
+        size_t n = strlen(rec_path(t, i)) + 1;
+        memcpy(pool + len, rec_path(t, i), n);
+        t->recs[i].path_off = len;
+        len += n;
+    }
+    heap_caps_free(t->pool);
+    t->pool = pool;
+    t->pool_len = len;
+    t->pool_cap = cap;
+    t->garbage = 0;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Used bytes of the volume, to notice changes made elsewhere
+ *
+ * On FatFs the first call after mounting can scan the whole FAT if the
+ * card has no valid FSINFO sector; later calls are cached by FatFs.
+ */
+static bool volume_used(const sd_catalog_t *cat, uint64_t *out) {
+#ifdef ESP_PLATFORM
+    if (cat->drive[0] == '\0') {
+        return false;
+    }
+    FATFS *fs;
+    DWORD free_clusters;
+    if (f_getfree(cat->drive, &free_clusters, &fs) != FR_OK) {
+        return false;
+    }
+#if FF_MAX_SS == FF_MIN_SS
+    uint64_t cluster = (uint64_t)fs->csize * FF_MAX_SS;
+#else
+    uint64_t cluster = (uint64_t)fs->csize * fs->ssize;
+#endif
+    *out = (uint64_t)(fs->n_fatent - 2 - free_clusters) * cluster;
+    return true;
+#else
+    struct statvfs sv;
+    if (statvfs(cat->mount_point, &sv) != 0) {
+        return false;
+    }
+    *out = (uint64_t)(sv.f_blocks - sv.f_bfree) * sv.f_frsize;
+    return true;
+#endif
+}
+
+/**
+ * @brief Path below the mount point, or NULL if outside the indexed root
+ */
+static const char *relative_path(const sd_catalog_t *cat, const char *path) {
+    size_t mlen = strlen(cat->mount_point);
+    size_t rlen = strlen(cat->root);
+    if (strncmp(path, cat->mount_point, mlen) != 0) {
+        return NULL;
+    }
+    const char *rel = path + mlen;
+    if (strncasecmp(rel, cat->root, rlen) != 0 || rel[rlen] != '/' || rel[rlen + 1] == '\0' ||
+        strlen(rel) >= SD_CATALOG_PATH_MAX) {
+        return NULL;
+    }
+    return rel;
+}
+
+/**
+ * @brief The index file or its temporary copy?
+ */
+static bool is_index_file(const sd_catalog_t *cat, const char *path) {
+    size_t len = strlen(cat->index_path);
+    return strncmp(path, cat->index_path, len) == 0 &&
+           (path[len] == '\0' || strcmp(path + len, ".tmp") == 0);
+}
+
+static bool contains_nocase(const char *hay, const char *needle) {
+    size_t n = strlen(needle);
+    for (; *hay; hay++) {
+        if (strncasecmp(hay, needle, n) == 0) {
+            return true;
+        }
+    }
+    return n == 0;
+}
+
+static bool query_match(const sd_catalog_query_t *q, const char *path, uint8_t type) {
+    if (q->types && !(q->types & SD_CAT_MASK(type))) {
+        return false;
+    }
+    const char *name = strrchr(path, '/') + 1;
+    if (q->ext) {
+        const char *dot = strrchr(name, '.');
+        if (!dot || strcasecmp(dot + 1, q->ext) != 0) {
+            return false;
+        }
+    }
+    return !q->contains || contains_nocase(name, q->contains);
+}
+
+static void entry_from(const table_t *t, uint32_t i, sd_catalog_entry_t *out) {
+    const record_t *r = &t->recs[i];
+    snprintf(out->path, sizeof(out->path), "%s", rec_path(t, i));
+    out->size = r->size;
+    out->mtime = r->mtime;
+    out->hash = r->hash;
+    out->type = r->type;
+}
+
+// ============================================================================
+// Index file
+// ============================================================================
+
+static esp_err_t load_file(sd_catalog_t *cat) {
+    FILE *f = fopen(cat->index_path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int64_t start = esp_timer_get_time();
+    file_header_t h;
+    table_t t = {};
+    esp_err_t err = ESP_ERR_INVALID_RESPONSE;
+    if (fread(&h, sizeof(h), 1, f) == 1 && h.magic == CATALOG_MAGIC &&
+        h.version == CATALOG_VERSION && h.header_size == sizeof(h) &&
+        strncmp(h.root, cat->root, sizeof(h.root)) == 0 && h.count <= cat->max_entries) {
+        if (!table_reserve(&t, h.count, h.pool_len)) {
+            err = ESP_ERR_NO_MEM;
+        } else if (fread(t.recs, sizeof(record_t), h.count, f) == h.count &&
+                   fread(t.pool, 1, h.pool_len, f) == h.pool_len) {
+            uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)t.recs, h.count * sizeof(record_t));
+            crc = esp_rom_crc32_le(crc, (const uint8_t *)t.pool, h.pool_len);
+            if (crc == h.crc) {
+                err = ESP_OK;
+            }
+        }
+    }
+    fclose(f);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: unusable (%s)", cat->index_path, esp_err_to_name(err));
+        table_free(&t);
+        return err;
+    }
+    t.count = h.count;
+    t.pool_len = h.pool_len;
+    t.dirs = h.dirs;
+    cat->live = t;
+    cat->truncated = (h.flags & FILE_TRUNCATED) != 0;
+
+    // Same used space as when saved: assume nothing changed behind our back
+    uint64_t used;
+    cat->stats.needs_build = !volume_used(cat, &used) || used != h.volume_used;
+    cat->stats.loaded = true;
+    cat->stats.load_us = (uint32_t)(esp_timer_get_time() - start);
+    cat->stats.file_bytes = sizeof(h) + h.count * sizeof(record_t) + h.pool_len;
+    ESP_LOGI(TAG, "Loaded %lu entries in %lu us%s", (unsigned long)h.count,
+             (unsigned long)cat->stats.load_us,
+             cat->stats.needs_build ? ", volume changed" : "");
+    return ESP_OK;
+}
+
+/**
+ * @brief Write the live table to the index file, lock held
+ *
+ * Written to a temporary file and renamed, so a power loss leaves the old
+ * or the new index. The used space is measured once the file is in place
+ * and patched into the header; that rewrite allocates nothing.
+ */
+static esp_err_t save_locked(sd_catalog_t *cat) {
+    if (!cat->dirty) {
+        return ESP_OK;
+    }
+    int64_t start = esp_timer_get_time();
+    table_t *t = &cat->live;
+    if (table_compact(t) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    file_header_t h = {};
+    h.magic = CATALOG_MAGIC;
+    h.version = CATALOG_VERSION;
+    h.header_size = sizeof(h);
+    h.count = t->count;
+    h.pool_len = t->pool_len;
+    h.dirs = t->dirs;
+    h.flags = cat->truncated ? FILE_TRUNCATED : 0;
+    strcpy(h.root, cat->root);
+    h.crc = esp_rom_crc32_le(0, (const uint8_t *)t->recs, t->count * sizeof(record_t));
+    h.crc = esp_rom_crc32_le(h.crc, (const uint8_t *)t->pool, t->pool_len);
+
+    char tmp[sizeof(cat->index_path) + 4];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cat->index_path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to create %s", tmp);
+        return ESP_FAIL;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(t->recs, sizeof(record_t), t->count, f) == t->count &&
+              fwrite(t->pool, 1, t->pool_len, f) == t->pool_len;
+    ok = fclose(f) == 0 && ok;
+
+    // FAT cannot rename onto an existing file
+    unlink(cat->index_path);
+    if (!ok || rename(tmp, cat->index_path) != 0) {
+        ESP_LOGE(TAG, "Failed to write %s", cat->index_path);
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+
+    if (volume_used(cat, &h.volume_used) && (f = fopen(cat->index_path, "r+b")) != NULL) {
+        fwrite(&h, sizeof(h), 1, f);
+        fclose(f);
+    }
+
+    cat->dirty = false;
+    cat->stats.save_us = (uint32_t)(esp_timer_get_time() - start);
+    cat->stats.file_bytes = sizeof(h) + t->count * sizeof(record_t) + t->pool_len;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Updates
+// ============================================================================
+
+/**
+ * @brief Add or refresh one record from stat(), lock held
+ */
+static esp_err_t upsert_locked(sd_catalog_t *cat, const char *rel, const struct stat *st) {
+    table_t *t = &cat->live;
+    bool is_dir = S_ISDIR(st->st_mode);
+    uint32_t size = is_dir ? 0 : (uint32_t)st->st_size;
+    uint8_t type = sd_catalog_type_of(strrchr(rel, '/') + 1, is_dir);
+
+    uint32_t at;
+    if (table_find(t, rel, &at)) {
+        rec_set(t, &t->recs[at], size, (uint32_t)st->st_mtime, type);
+        return ESP_OK;
+    }
+    if (t->count >= cat->max_entries) {
+        cat->truncated = true;
+        return ESP_OK;
+    }
+    return table_insert(t, at, rel, size, (uint32_t)st->st_mtime, type);
+}
+
+static esp_err_t update_locked(sd_catalog_t *cat, const char *rel) {
+    table_t *t = &cat->live;
+    char path[sizeof(cat->mount_point) + SD_CATALOG_PATH_MAX];
+    snprintf(path, sizeof(path), "%s%s", cat->mount_point, rel);
+    cat->dirty = true;
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        // Gone: the record and, for a directory, everything below it
+        char prefix[SD_CATALOG_PATH_MAX + 1];
+        snprintf(prefix, sizeof(prefix), "%s/", rel);
+        uint32_t first;
+        uint32_t end;
+        table_prefix_range(t, prefix, &first, &end);
+        table_remove(t, first, end);
+        if (table_find(t, rel, &first)) {
+            table_remove(t, first, first + 1);
+        }
+        return ESP_OK;
+    }
+
+    // Parent directories below the root first
+    char parent[SD_CATALOG_PATH_MAX];
+    strcpy(parent, rel);
+    for (char *slash = strchr(parent + strlen(cat->root) + 1, '/'); slash;
+         slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        uint32_t at;
+        struct stat pst;
+        snprintf(path, sizeof(path), "%s%s", cat->mount_point, parent);
+        if (!table_find(t, parent, &at) && stat(path, &pst) == 0) {
+            esp_err_t err = upsert_locked(cat, parent, &pst);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        *slash = '/';
+    }
+    return upsert_locked(cat, rel, &st);
+}
+
+// ============================================================================
+// Build
+// ============================================================================
+
+/**
+ * @brief Append the entries of one directory to the build table
+ */
+static esp_err_t walk_dir(sd_catalog_t *cat, const char *rel) {
+    char dir[sizeof(cat->mount_point) + SD_CATALOG_PATH_MAX];
+    char path[SD_CATALOG_PATH_MAX];
+    char full[sizeof(dir)];
+    snprintf(dir, sizeof(dir), "%s%s", cat->mount_point, rel);
+
+    esp_err_t err;
+    uint32_t offset = 0;
+    size_t n;
+    sd_index_dir_info_t info;
+    do {
+        err = sd_index_list(cat->walker, dir, offset, cat->page, WALK_PAGE, &n, &info);
+        for (size_t i = 0; err == ESP_OK && i < n; i++) {
+            const sd_index_entry_t *e = &cat->page[i];
+            if (snprintf(path, sizeof(path), "%s/%s", rel, e->name) >= (int)sizeof(path)) {
+                continue;  // Too deep to index
+            }
+            snprintf(full, sizeof(full), "%s%s", cat->mount_point, path);
+            if (is_index_file(cat, full)) {
+                continue;
+            }
+            if (cat->build.count >= cat->max_entries) {
+                cat->build_truncated = true;
+                break;
+            }
+            err = table_insert(&cat->build, cat->build.count, path, e->size, e->mtime,
+                               sd_catalog_type_of(e->name, e->type == SD_ENTRY_DIR));
+        }
+        offset += n;
+    } while (err == ESP_OK && n == WALK_PAGE && !cat->build_truncated);
+
+    if (err == ESP_OK && info.truncated) {
+        cat->build_truncated = true;
+    }
+    sd_index_invalidate(cat->walker, dir);
+    cat->stats.build_dirs++;
+    return err;
+}
+
+/**
+ * @brief Swap the finished build in, lock held
+ */
+static esp_err_t finish_build_locked(sd_catalog_t *cat) {
+    table_t old = cat->live;
+    cat->live = cat->build;
+    memset(&cat->build, 0, sizeof(cat->build));
+    table_free(&old);
+    cat->truncated = cat->build_truncated;
+    cat->dirty = true;
+
+    // Changes the walk may have missed
+    esp_err_t err = ESP_OK;
+    for (uint32_t i = 0; i < cat->n_pending && err == ESP_OK; i++) {
+        err = update_locked(cat, cat->pending[i]);
+    }
+    cat->stats.needs_build = cat->pending_overflow || err != ESP_OK;
+    cat->n_pending = 0;
+    cat->pending_overflow = false;
+    cat->stats.building = false;
+    cat->stats.build_us = cat->build_work_us;
+
+    ESP_LOGI(TAG, "Built: %lu entries, %lu dirs in %lu ms, %lu steps%s",
+             (unsigned long)cat->live.count, (unsigned long)cat->stats.build_dirs,
+             (unsigned long)(cat->build_work_us / 1000), (unsigned long)cat->stats.build_steps,
+             cat->truncated ? " (truncated)" : "");
+    return save_locked(cat);
+}
+
+static void abandon_build(sd_catalog_t *cat) {
+    table_free(&cat->build);
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    cat->stats.building = false;
+    cat->n_pending = 0;
+    cat->pending_overflow = false;
+    xSemaphoreGive(cat->lock);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_catalog_create(const sd_catalog_config_t *config, sd_catalog_t **out) {
+    const char *root = (config && config->root) ? config->root : "";
+    if (!config || !out || !config->mount_point || !config->index_path ||
+        config->max_entries == 0 ||
+        strlen(config->mount_point) >= sizeof(((sd_catalog_t *)0)->mount_point) ||
+        strlen(config->index_path) >= sizeof(((sd_catalog_t *)0)->index_path) ||
+        strlen(root) >= CATALOG_ROOT_MAX || (root[0] && root[0] != '/') ||
+        (root[0] && root[strlen(root) - 1] == '/') ||
+        (config->fatfs_drive && strlen(config->fatfs_drive) >= sizeof(((sd_catalog_t *)0)->drive))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sd_catalog_t *cat = (sd_catalog_t *)calloc(1, sizeof(sd_catalog_t));
+    if (!cat) {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(cat->mount_point, config->mount_point);
+    strcpy(cat->root, root);
+    strcpy(cat->index_path, config->index_path);
+    if (config->fatfs_drive) {
+        strcpy(cat->drive, config->fatfs_drive);
+    }
+    cat->max_entries = config->max_entries;
+
+    // The walk reads one directory at a time and drops it afterwards
+    sd_index_config_t walk_cfg = SD_INDEX_CONFIG_DEFAULT();
+    walk_cfg.mount_point = config->mount_point;
+    walk_cfg.fatfs_drive = config->fatfs_drive;
+    walk_cfg.max_dirs = 1;
+    walk_cfg.max_entries = config->max_entries;
+    walk_cfg.max_age_ms = 0;
+
+    cat->lock = xSemaphoreCreateMutex();
+    cat->page = (sd_index_entry_t *)malloc(WALK_PAGE * sizeof(sd_index_entry_t));
+    if (!cat->lock || !cat->page || sd_index_create(&walk_cfg, &cat->walker) != ESP_OK) {
+        sd_catalog_destroy(cat);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (load_file(cat) != ESP_OK) {
+        cat->stats.needs_build = true;
+    }
+    *out = cat;
+    return ESP_OK;
+}
+
+void sd_catalog_destroy(sd_catalog_t *cat) {
+    if (!cat) {
+        return;
+    }
+    if (cat->lock) {
+        xSemaphoreTake(cat->lock, portMAX_DELAY);
+        save_locked(cat);
+        xSemaphoreGive(cat->lock);
+        vSemaphoreDelete(cat->lock);
+    }
+    table_free(&cat->live);
+    table_free(&cat->build);
+    sd_index_destroy(cat->walker);
+    free(cat->page);
+    free(cat);
+}
+
+esp_err_t sd_catalog_build_step(sd_catalog_t *cat, uint32_t budget_ms) {
+    int64_t start = esp_timer_get_time();
+    if (!cat->stats.building) {
+        table_free(&cat->build);
+        cat->build_truncated = false;
+        cat->root_done = false;
+        cat->walk_pos = 0;
+        cat->build_work_us = 0;
+        xSemaphoreTake(cat->lock, portMAX_DELAY);
+        cat->stats.building = true;
+        cat->stats.build_steps = 0;
+        cat->stats.build_dirs = 0;
+        cat->n_pending = 0;
+        cat->pending_overflow = false;
+        xSemaphoreGive(cat->lock);
+    }
+    cat->stats.build_steps++;
+
+    char dir[SD_CATALOG_PATH_MAX];
+    esp_err_t err = ESP_OK;
+    bool done = false;
+    while (!done && err == ESP_OK &&
+           esp_timer_get_time() - start < (int64_t)budget_ms * 1000) {
+        if (!cat->root_done) {
+            cat->root_done = true;
+            err = walk_dir(cat, cat->root);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Cannot read %s%s: %s", cat->mount_point, cat->root,
+                         esp_err_to_name(err));
+                err = err == ESP_ERR_NO_MEM ? err : ESP_FAIL;
+            }
+            continue;
+        }
+
+        // Next directory found so far, breadth first
+        while (cat->walk_pos < cat->build.count &&
+               cat->build.recs[cat->walk_pos].type != SD_CAT_DIR) {
+            cat->walk_pos++;
+        }
+        if (cat->walk_pos == cat->build.count || cat->build_truncated) {
+            done = true;
+            break;
+        }
+        strcpy(dir, rec_path(&cat->build, cat->walk_pos++));
+        err = walk_dir(cat, dir);
+        if (err != ESP_OK && err != ESP_ERR_NO_MEM) {
+            ESP_LOGW(TAG, "Skipping %s: %s", dir, esp_err_to_name(err));
+            err = ESP_OK;  // Removed or unreadable meanwhile
+        }
+    }
+
+    if (err == ESP_OK && done) {
+        err = table_sort(&cat->build);
+    }
+    cat->build_work_us += (uint32_t)(esp_timer_get_time() - start);
+    if (err != ESP_OK) {
+        abandon_build(cat);
+        return err;
+    }
+    if (!done) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    err = finish_build_locked(cat);
+    xSemaphoreGive(cat->lock);
+    return err;
+}
+
+esp_err_t sd_catalog_update(sd_catalog_t *cat, const char *path) {
+    const char *rel = (cat && path) ? relative_path(cat, path) : NULL;
+    if (!rel || is_index_file(cat, path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    cat->stats.updates++;
+    esp_err_t err = update_locked(cat, rel);
+    if (cat->stats.building) {
+        if (cat->n_pending < PENDING_MAX) {
+            strcpy(cat->pending[cat->n_pending++], rel);
+        } else {
+            cat->pending_overflow = true;
+        }
+    }
+    xSemaphoreGive(cat->lock);
+    return err;
+}
+
+void sd_catalog_invalidate(sd_catalog_t *cat) {
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    cat->stats.needs_build = true;
+    if (cat->stats.building) {
+        cat->pending_overflow = true;  // Build again once this one is done
+    }
+    xSemaphoreGive(cat->lock);
+}
+
+esp_err_t sd_catalog_save(sd_catalog_t *cat) {
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    esp_err_t err = save_locked(cat);
+    xSemaphoreGive(cat->lock);
+    return err;
+}
+
+esp_err_t sd_catalog_find(sd_catalog_t *cat, const char *path, sd_catalog_entry_t *out) {
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    uint32_t at;
+    bool found = table_find(&cat->live, path, &at);
+    if (found && out) {
+        entry_from(&cat->live, at, out);
+    }
+    cat->stats.queries++;
+    cat->stats.last_query_us = (uint32_t)(esp_timer_get_time() - start);
+    xSemaphoreGive(cat->lock);
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t sd_catalog_query(sd_catalog_t *cat, const sd_catalog_query_t *query, uint32_t offset,
+                           sd_catalog_entry_t *out, size_t max, size_t *count, uint32_t *total) {
+    if (!cat || !query || (max && !out) || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    const table_t *t = &cat->live;
+    uint32_t first = 0;
+    uint32_t end = t->count;
+    if (query->prefix && query->prefix[0]) {
+        table_prefix_range(t, query->prefix, &first, &end);
+    }
+
+    uint32_t matches = 0;
+    for (uint32_t i = first; i < end; i++) {
+        if (!query_match(query, rec_path(t, i), t->recs[i].type)) {
+            continue;
+        }
+        if (matches >= offset && *count < max) {
+            entry_from(t, i, &out[(*count)++]);
+        } else if (*count == max && !total) {
+            break;  // Page full, nobody wants the total
+        }
+        matches++;
+    }
+    if (total) {
+        *total = matches;
+    }
+    cat->stats.queries++;
+    cat->stats.last_query_us = (uint32_t)(esp_timer_get_time() - start);
+    xSemaphoreGive(cat->lock);
+    return ESP_OK;
+}
+
+void sd_catalog_get_stats(sd_catalog_t *cat, sd_catalog_stats_t *out) {
+    xSemaphoreTake(cat->lock, portMAX_DELAY);
+    *out = cat->stats;
+    out->entries = cat->live.count;
+    out->dirs = cat->live.dirs;
+    out->pool_bytes = cat->live.pool_len - cat->live.garbage;
+    out->truncated = cat->truncated;
+    xSemaphoreGive(cat->lock);
+}
@@ -0,0 +1,230 @@
+/**
+ * @file sd_catalog.h
+ * @brief Content index of the card: every path, sorted, in one file
+ *
+ * Finding a file by walking directories costs a directory read per level
+ * and a full walk for any search. The catalog keeps one record per file
+ * and directory (path, size, mtime, type, fingerprint), sorted by path,
+ * in RAM and in an index file on the card:
+ *
+ * - A path prefix ("/music/") is one contiguous range, found by binary
+ *   search
+ * - Name substring and type queries ("all audio", extension "mp3") scan
+ *   the records in RAM, not the card
+ * - Opening reads the index file front to back (header, records, paths);
+ *   nothing is walked if the volume looks unchanged since it was saved
+ *
+ * The index is built by walking the tree through sd_index (FatFs fast
+ * path), a bounded amount of work per sd_catalog_build_step() call, so it
+ * can run as background jobs between other card access. Queries keep
+ * using the previous index until the new one is complete.
+ *
+ * After that it is kept current by the application: sd_catalog_update()
+ * for each path it creates, changes or deletes. A change made elsewhere
+ * (card edited on a PC) is detected at open from the volume's used space,
+ * which then asks for a rebuild; a change that leaves the used space
+ * exactly as it was goes unnoticed until the next rebuild.
+ *
+ * Thread safe: queries can run on one task while another builds.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest path below the mount point, including the terminator
+#define SD_CATALOG_PATH_MAX 256
+
+/**
+ * @brief Content type, from the extension
+ */
+typedef enum {
+    SD_CAT_DIR,
+    SD_CAT_AUDIO,            // mp3, wav, flac, aac, m4a, ogg
+    SD_CAT_IMAGE,            // jpg, jpeg, png, bmp, gif
+    SD_CAT_VIDEO,            // mp4, avi, mjpeg, mkv
+    SD_CAT_TEXT,             // txt, csv, json, log, md
+    SD_CAT_OTHER,
+    SD_CAT_TYPE_COUNT,
+} sd_cat_type_t;
+
+#define SD_CAT_MASK(type) (1u << (type))
+
+/**
+ * @brief One record, as returned by queries
+ */
+typedef struct {
+    char path[SD_CATALOG_PATH_MAX];  // Below the mount point, e.g. "/music/a.mp3"
+    uint32_t size;           // Bytes, 0 for directories
+    uint32_t mtime;          // Seconds since the epoch, 0 if unknown
+    uint32_t hash;           // Fingerprint of path, size and mtime
+    uint8_t type;            // sd_cat_type_t
+} sd_catalog_entry_t;
+
+/**
+ * @brief Query; all given conditions must match
+ */
+typedef struct {
+    const char *prefix;      // Path prefix, e.g. "/music/"; NULL: whole card
+    const char *contains;    // Substring of the name, any case; NULL: any
+    const char *ext;         // Extension without the dot, any case; NULL: any
+    uint32_t types;          // SD_CAT_MASK() bits; 0: any
+} sd_catalog_query_t;
+
+/**
+ * @brief Catalog configuration
+ */
+typedef struct {
+    const char *mount_point;     // VFS path of the volume
+    const char *fatfs_drive;     // FatFs drive for the walk, NULL: portable path
+    const char *root;            // Directory to index below the mount point, "" for all
+    const char *index_path;      // Index file (VFS path); skipped by the walk
+    uint32_t max_entries;        // Records kept; the walk stops there
+} sd_catalog_config_t;
+
+#define SD_CATALOG_CONFIG_DEFAULT() {       \
+    .mount_point = "/sdcard",               \
+    .fatfs_drive = NULL,                    \
+    .root = "",                             \
+    .index_path = "/sdcard/.catalog",       \
+    .max_entries = 100000,                  \
+}
+
+/**
+ * @brief Catalog state and timing
+ */
+typedef struct {
+    uint32_t entries;            // Records in the live index
+    uint32_t dirs;
+    uint32_t pool_bytes;         // Path storage
+    bool loaded;                 // Index came from the file at create
+    bool needs_build;            // No index, or the volume changed since it was saved
+    bool building;
+    bool truncated;              // max_entries reached
+    uint32_t load_us;            // Reading the index file
+    uint32_t build_us;           // Last complete build, walk and sort
+    uint32_t build_steps;
+    uint32_t build_dirs;         // Directories walked by the last / current build
+    uint32_t save_us;
+    uint32_t file_bytes;         // Size of the index file
+    uint32_t updates;            // sd_catalog_update() calls
+    uint32_t queries;
+    uint32_t last_query_us;
+} sd_catalog_stats_t;
+
+typedef struct sd_catalog sd_catalog_t;
+
+/**
+ * @brief Create a catalog, loading the index file if it is current
+ *
+ * @return
+ *    - ESP_OK: Success (see needs_build in the stats)
+ *    - ESP_ERR_INVALID_ARG: Missing argument
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t sd_catalog_create(const sd_catalog_config_t *config, sd_catalog_t **out);
+
+/**
+ * @brief Save if changed, then free the catalog
+ */
+void sd_catalog_destroy(sd_catalog_t *cat);
+
+/**
+ * @brief Walk for up to `budget_ms`, starting a build if none is running
+ *
+ * Whole directories are read per step, so a step can overrun the budget
+ * by one directory. The finished index replaces the live one and is saved.
+ *
+ * @return
+ *    - ESP_OK: Build complete
+ *    - ESP_ERR_NOT_FINISHED: Call again
+ *    - ESP_ERR_NO_MEM: Out of memory (build abandoned)
+ *    - ESP_FAIL: Root directory unreadable, or the save failed
+ */
+esp_err_t sd_catalog_build_step(sd_catalog_t *cat, uint32_t budget_ms);
+
+/**
+ * @brief Bring one path up to date after creating, changing or deleting it
+ *
+ * stat()s the path: adds or updates its record (and missing parent
+ * directories), or removes it, with everything below it for a directory.
+ * Saved with the next sd_catalog_save().
+ *
+ * @param path: VFS path
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Path outside the indexed root
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t sd_catalog_update(sd_catalog_t *cat, const char *path);
+
+/**
+ * @brief Ask for a rebuild, after changing more than sd_catalog_update() covers
+ *
+ * For example after creating a whole directory tree. The next
+ * sd_catalog_build_step() starts the build.
+ */
+void sd_catalog_invalidate(sd_catalog_t *cat);
+
+/**
+ * @brief Write the index file if it changed
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_FAIL: Write error
+ */
+esp_err_t sd_catalog_save(sd_catalog_t *cat);
+
+/**
+ * @brief Look up one path (below the mount point, any case)
+ *
+ * @return
+ *    - ESP_OK: Found
+ *    - ESP_ERR_NOT_FOUND: Not in the index
+ */
+esp_err_t sd_catalog_find(sd_catalog_t *cat, const char *path, sd_catalog_entry_t *out);
+
+/**
+ * @brief Copy a page of the records matching a query, in path order
+ *
+ * @param cat: Catalog
+ * @param query: Conditions
+ * @param offset: First match to copy
+ * @param out: Destination array
+ * @param max: Size of the destination array
+ * @param count: Receives the number of records copied
+ * @param total: Receives the number of matches, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing argument
+ */
+esp_err_t sd_catalog_query(sd_catalog_t *cat, const sd_catalog_query_t *query, uint32_t offset,
+                           sd_catalog_entry_t *out, size_t max, size_t *count, uint32_t *total);
+
+/**
+ * @brief Type of a name, from its extension
+ */
+sd_cat_type_t sd_catalog_type_of(const char *name, bool is_dir);
+
+/**
+ * @brief Short name of a type
+ */
+const char *sd_catalog_type_name(sd_cat_type_t type);
+
+/**
+ * @brief Get state and timing
+ */
+void sd_catalog_get_stats(sd_catalog_t *cat, sd_catalog_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
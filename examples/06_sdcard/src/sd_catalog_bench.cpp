@@ -0,0 +1,197 @@
+/**
+ * @file sd_catalog_bench.cpp
+ * @brief Catalog build, load and query times vs searching by walking
+ */
+
+#include "sd_catalog_bench.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_catalog_bench";
+
+#define PAGE 16
+
+static const struct {
+    const char *dir;         // Below the bench directory
+    const char *sub;         // Subdirectory, numbered
+    const char *file;        // File name format, numbered
+    uint32_t percent;
+    uint32_t per_dir;
+} layout[] = {
+    {"music", "a%03lu", "t%05lu.mp3", 50, 50},
+    {"photos", "p%03lu", "img%05lu.jpg", 30, 100},
+    {"docs", "d%03lu", "note%05lu.txt", 20, 100},
+};
+
+/**
+ * @brief Path of file `i` of group `g`; creates directories if asked
+ */
+static bool file_path(const char *dir, size_t g, uint32_t i, char *out, size_t size, bool mk) {
+    char sub[16];
+    char name[24];
+    snprintf(sub, sizeof(sub), layout[g].sub, (unsigned long)(i / layout[g].per_dir));
+    snprintf(name, sizeof(name), layout[g].file, (unsigned long)i);
+    if (mk) {
+        snprintf(out, size, "%s/%s", dir, layout[g].dir);
+        mkdir(out, 0755);
+        snprintf(out, size, "%s/%s/%s", dir, layout[g].dir, sub);
+        if (mkdir(out, 0755) != 0) {
+            struct stat st;
+            if (stat(out, &st) != 0) {
+                return false;
+            }
+        }
+    }
+    return snprintf(out, size, "%s/%s/%s/%s", dir, layout[g].dir, sub, name) < (int)size;
+}
+
+esp_err_t sd_catalog_bench_prepare(const char *dir, uint32_t count) {
+    char path[300];
+    size_t groups = sizeof(layout) / sizeof(layout[0]);
+    uint32_t last = count * layout[groups - 1].percent / 100;
+    struct stat st;
+    if (last > 0 && file_path(dir, groups - 1, last - 1, path, sizeof(path), false) &&
+        stat(path, &st) == 0) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Creating %lu files in %s", (unsigned long)count, dir);
+    mkdir(dir, 0755);
+    for (size_t g = 0; g < groups; g++) {
+        uint32_t n = count * layout[g].percent / 100;
+        for (uint32_t i = 0; i < n; i++) {
+            bool mk = (i % layout[g].per_dir) == 0;
+            if (!file_path(dir, g, i, path, sizeof(path), mk)) {
+                ESP_LOGE(TAG, "Failed to create the directory of %s", path);
+                return ESP_FAIL;
+            }
+            FILE *f = fopen(path, "w");
+            if (!f) {
+                ESP_LOGE(TAG, "Failed to create %s", path);
+                return ESP_FAIL;
+            }
+            fclose(f);
+        }
+    }
+    return ESP_OK;
+}
+
+static bool name_contains(const char *name, const char *needle) {
+    size_t n = strlen(needle);
+    for (; *name; name++) {
+        if (strncasecmp(name, needle, n) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Search by walking, as a file manager without an index would
+ */
+static uint32_t walk_search(const char *dir, const char *needle) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+    uint32_t matches = 0;
+    struct dirent *e;
+    char path[300];
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+            continue;
+        }
+        matches += name_contains(e->d_name, needle);
+        if (e->d_type == DT_DIR) {
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            matches += walk_search(path, needle);
+        }
+    }
+    closedir(d);
+    return matches;
+}
+
+esp_err_t sd_catalog_bench_run(const sd_catalog_config_t *config,
+                               const sd_catalog_bench_params_t *params,
+                               sd_catalog_bench_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    unlink(config->index_path);
+
+    // Build from scratch; sd_catalog_destroy() keeps the saved file
+    sd_catalog_t *cat = NULL;
+    esp_err_t err = sd_catalog_create(config, &cat);
+    if (err != ESP_OK) {
+        return err;
+    }
+    while ((err = sd_catalog_build_step(cat, params->step_ms)) == ESP_ERR_NOT_FINISHED) {
+    }
+    sd_catalog_stats_t st;
+    sd_catalog_get_stats(cat, &st);
+    out->entries = st.entries;
+    out->dirs = st.dirs;
+    out->build_us = st.build_us;
+    out->build_steps = st.build_steps;
+    out->save_us = st.save_us;
+    out->file_bytes = st.file_bytes;
+    sd_catalog_destroy(cat);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Reopen from the file
+    int64_t start = esp_timer_get_time();
+    err = sd_catalog_create(config, &cat);
+    out->load_us = (uint32_t)(esp_timer_get_time() - start);
+    if (err != ESP_OK) {
+        return err;
+    }
+    sd_catalog_get_stats(cat, &st);
+    out->load_current = st.loaded && !st.needs_build;
+
+    static sd_catalog_entry_t page[PAGE];
+    start = esp_timer_get_time();
+    bool found = sd_catalog_find(cat, params->find, &page[0]) == ESP_OK;
+    out->find_us = (uint32_t)(esp_timer_get_time() - start);
+
+    size_t n;
+    sd_catalog_query_t q = {};
+    q.prefix = params->prefix;
+    start = esp_timer_get_time();
+    sd_catalog_query(cat, &q, 0, page, PAGE, &n, &out->prefix_matches);
+    out->prefix_us = (uint32_t)(esp_timer_get_time() - start);
+
+    q = {};
+    q.contains = params->contains;
+    start = esp_timer_get_time();
+    sd_catalog_query(cat, &q, 0, page, PAGE, &n, &out->contains_matches);
+    out->contains_us = (uint32_t)(esp_timer_get_time() - start);
+
+    q = {};
+    q.types = SD_CAT_MASK(SD_CAT_AUDIO);
+    start = esp_timer_get_time();
+    sd_catalog_query(cat, &q, 0, NULL, 0, &n, &out->type_matches);
+    out->type_us = (uint32_t)(esp_timer_get_time() - start);
+    sd_catalog_destroy(cat);
+
+    char root[300];
+    snprintf(root, sizeof(root), "%s%s", config->mount_point, config->root ? config->root : "");
+    start = esp_timer_get_time();
+    out->walk_matches = walk_search(root, params->contains);
+    out->walk_us = (uint32_t)(esp_timer_get_time() - start);
+
+    out->verified = found && out->walk_matches == out->contains_matches;
+    ESP_LOGI(TAG, "%lu entries: build %lu us, load %lu us, find %lu us, prefix %lu us, "
+             "contains %lu us, type %lu us, walk %lu us",
+             (unsigned long)out->entries, (unsigned long)out->build_us,
+             (unsigned long)out->load_us, (unsigned long)out->find_us,
+             (unsigned long)out->prefix_us, (unsigned long)out->contains_us,
+             (unsigned long)out->type_us, (unsigned long)out->walk_us);
+    return ESP_OK;
+}
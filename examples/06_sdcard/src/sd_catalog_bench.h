@@ -0,0 +1,83 @@
+/**
+ * @file sd_catalog_bench.h
+ * @brief Catalog build, load and query times vs searching by walking
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_catalog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Queries of one run
+ */
+typedef struct {
+    const char *find;        // One path below the mount point
+    const char *prefix;      // A directory prefix, e.g. "/catbench/music/a001/"
+    const char *contains;    // Name substring searched over the whole tree
+    uint32_t step_ms;        // Budget per sd_catalog_build_step()
+} sd_catalog_bench_params_t;
+
+/**
+ * @brief Times of one run
+ */
+typedef struct {
+    uint32_t entries;
+    uint32_t dirs;
+    uint32_t build_us;       // Complete build: walk and sort
+    uint32_t build_steps;
+    uint32_t save_us;
+    uint32_t file_bytes;
+    uint32_t load_us;        // Reopening with the index file
+    bool load_current;       // Reopened index did not ask for a rebuild
+    uint32_t find_us;
+    uint32_t prefix_us;      // First page of the prefix, with the total
+    uint32_t prefix_matches;
+    uint32_t contains_us;
+    uint32_t contains_matches;
+    uint32_t type_us;        // All audio files, count only
+    uint32_t type_matches;
+    uint32_t walk_us;        // The substring search by opendir() / readdir()
+    uint32_t walk_matches;
+    bool verified;           // Found the path, and the walk matched the index
+} sd_catalog_bench_result_t;
+
+/**
+ * @brief Fill `dir` with a tree of `count` empty files
+ *
+ * Half are music/aNNN/tNNNNN.mp3 (50 per directory), 30 % photos/pNNN/
+ * imgNNNNN.jpg and 20 % docs/dNNN/noteNNNNN.txt (100 per directory).
+ * Nothing is created if the last file already exists.
+ *
+ * @return
+ *    - ESP_OK: Tree complete
+ *    - ESP_FAIL: Could not create a directory or a file
+ */
+esp_err_t sd_catalog_bench_prepare(const char *dir, uint32_t count);
+
+/**
+ * @brief Build an index from scratch, reopen it and time the queries
+ *
+ * The index file of `config` is deleted first and left in place afterwards.
+ *
+ * @param config: Catalog configuration (root is the tree to index)
+ * @param params: Queries
+ * @param out: Results
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: Error from sd_catalog_create() or sd_catalog_build_step()
+ */
+esp_err_t sd_catalog_bench_run(const sd_catalog_config_t *config,
+                               const sd_catalog_bench_params_t *params,
+                               sd_catalog_bench_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,458 @@
+/**
+ * @file sd_index.cpp
+ * @brief Cached directory index for SD card listings
+ *
+ * A cached listing is an array of fixed-size entries plus one pool of
+ * NUL-terminated names, both grown by doubling in PSRAM. One mutex covers
+ * the cache; a caller that triggers a load holds it while the directory is
+ * read, so concurrent callers of the same directory wait for that read
+ * instead of starting their own.
+ */
+
+#include "sd_index.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#ifdef ESP_PLATFORM
+#include "ff.h"
+#endif
+
+static const char *TAG = "sd_index";
+
+// Longest directory path handled
+#define PATH_MAX_LEN 256
+
+typedef struct {
+    uint32_t name_off;          // Into the name pool
+    uint32_t size;
+    uint32_t mtime;
+    uint8_t type;
+} cached_entry_t;
+
+typedef struct {
+    char path[PATH_MAX_LEN];    // Empty: slot unused
+    cached_entry_t *entries;
+    char *names;
+    uint32_t count;             // Entries kept
+    uint32_t total;             // Entries in the directory
+    uint32_t entries_cap;
+    uint32_t names_len;
+    uint32_t names_cap;
+    int64_t loaded_at;
+    int64_t dir_mtime;          // -1 if not checked (FatFs path)
+    uint32_t load_us;
+    uint32_t last_used;
+} dir_cache_t;
+
+struct sd_index {
+    char mount_point[32];
+    char drive[8];              // Empty: portable path only
+    size_t max_dirs;
+    size_t max_entries;
+    uint32_t max_age_ms;
+    bool need_size;
+    SemaphoreHandle_t lock;
+    dir_cache_t *dirs;
+    uint32_t use_clock;
+    sd_index_stats_t stats;
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void dir_free(dir_cache_t *d) {
+    heap_caps_free(d->entries);
+    heap_caps_free(d->names);
+    memset(d, 0, sizeof(*d));
+}
+
+static size_t dir_bytes(const dir_cache_t *d) {
+    return d->entries_cap * sizeof(cached_entry_t) + d->names_cap;
+}
+
+static esp_err_t dir_add(dir_cache_t *d, size_t max_entries, const char *name,
+                         uint32_t size, uint32_t mtime, uint8_t type) {
+    d->total++;
+    if (d->count >= max_entries) {
+        return ESP_OK;  // Counted, not kept
+    }
+
+    size_t name_len = strlen(name) + 1;
+    if (d->names_len + name_len > d->names_cap) {
+        uint32_t cap = d->names_cap ? d->names_cap * 2 : 1024;
+        while (cap < d->names_len + name_len) {
+            cap *= 2;
+        }
+        char *names = (char *)heap_caps_realloc(d->names, cap, MALLOC_CAP_SPIRAM);
+        if (!names) {
+            return ESP_ERR_NO_MEM;
+        }
+        d->names = names;
+        d->names_cap = cap;
+    }
+    if (d->count == d->entries_cap) {
+        uint32_t cap = d->entries_cap ? d->entries_cap * 2 : 64;
+        cached_entry_t *entries = (cached_entry_t *)heap_caps_realloc(
+            d->entries, cap * sizeof(cached_entry_t), MALLOC_CAP_SPIRAM);
+        if (!entries) {
+            return ESP_ERR_NO_MEM;
+        }
+        d->entries = entries;
+        d->entries_cap = cap;
+    }
+
+    cached_entry_t *e = &d->entries[d->count++];
+    e->name_off = d->names_len;
+    e->size = size;
+    e->mtime = mtime;
+    e->type = type;
+    memcpy(d->names + d->names_len, name, name_len);
+    d->names_len += name_len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Copy a directory path without trailing slashes
+ */
+static bool normalize_path(const char *path, char *out) {
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    if (len == 0 || len >= PATH_MAX_LEN) {
+        return false;
+    }
+    memcpy(out, path, len);
+    out[len] = '\0';
+    return true;
+}
+
+/**
+ * @brief Path relative to the FAT volume, or NULL if the fast path does not apply
+ */
+static const char *fatfs_relative(const sd_index_t *idx, const char *path) {
+    size_t len = strlen(idx->mount_point);
+    if (idx->drive[0] == '\0' || strncmp(path, idx->mount_point, len) != 0 ||
+        (path[len] != '/' && path[len] != '\0')) {
+        return NULL;
+    }
+    return path + len;
+}
+
+// ============================================================================
+// Directory readers
+// ============================================================================
+
+uint32_t sd_index_fat_to_unix(uint16_t date, uint16_t time) {
+    int y = 1980 + (date >> 9);
+    int m = (date >> 5) & 0x0F;
+    int d = date & 0x1F;
+    if (m < 1 || m > 12 || d < 1) {
+        return 0;
+    }
+
+    // Days since 1970-01-01 for a proleptic Gregorian date
+    y -= m <= 2;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int days = era * 146097 + doe - 719468;
+
+    return (uint32_t)days * 86400 + (time >> 11) * 3600 + ((time >> 5) & 0x3F) * 60 +
+           (time & 0x1F) * 2;
+}
+
+#ifdef ESP_PLATFORM
+static esp_err_t load_fatfs(sd_index_t *idx, const char *rel, dir_cache_t *d) {
+    char fpath[PATH_MAX_LEN + 8];
+    snprintf(fpath, sizeof(fpath), "%s%s", idx->drive, rel[0] ? rel : "/");
+
+    FF_DIR dir;
+    FRESULT fr = f_opendir(&dir, fpath);
+    if (fr == FR_NO_PATH || fr == FR_NO_FILE || fr == FR_INVALID_NAME) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (fr != FR_OK) {
+        ESP_LOGW(TAG, "f_opendir(%s): %d", fpath, fr);
+        return ESP_FAIL;
+    }
+
+    // One directory entry read per file: name, attributes, size and date
+    esp_err_t err = ESP_OK;
+    FILINFO fno;
+    while (err == ESP_OK && (fr = f_readdir(&dir, &fno)) == FR_OK && fno.fname[0]) {
+        bool is_dir = (fno.fattrib & AM_DIR) != 0;
+        uint32_t size = is_dir ? 0 : (fno.fsize > UINT32_MAX ? UINT32_MAX : (uint32_t)fno.fsize);
+        err = dir_add(d, idx->max_entries, fno.fname, size,
+                      sd_index_fat_to_unix(fno.fdate, fno.ftime),
+                      is_dir ? SD_ENTRY_DIR : SD_ENTRY_FILE);
+    }
+    f_closedir(&dir);
+
+    if (err == ESP_OK && fr != FR_OK) {
+        ESP_LOGW(TAG, "f_readdir(%s): %d", fpath, fr);
+        err = ESP_FAIL;
+    }
+    return err;
+}
+#endif
+
+static esp_err_t load_portable(sd_index_t *idx, const char *path, dir_cache_t *d) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return (errno == ENOENT || errno == ENOTDIR) ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+
+    esp_err_t err = ESP_OK;
+    struct dirent *e;
+    char full[PATH_MAX_LEN + SD_INDEX_NAME_MAX + 1];
+    while (err == ESP_OK && (e = readdir(dir)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+            continue;
+        }
+
+        uint8_t type = (e->d_type == DT_DIR) ? SD_ENTRY_DIR : SD_ENTRY_FILE;
+        uint32_t size = 0;
+        uint32_t mtime = 0;
+
+        // d_type is enough for directories; stat() only when it is missing
+        // or the size of a file is wanted
+        if (e->d_type == DT_UNKNOWN || (idx->need_size && type == SD_ENTRY_FILE)) {
+            snprintf(full, sizeof(full), "%s/%s", path, e->d_name);
+            struct stat st;
+            idx->stats.stat_calls++;
+            if (stat(full, &st) == 0) {
+                type = S_ISDIR(st.st_mode) ? SD_ENTRY_DIR : SD_ENTRY_FILE;
+                size = (type == SD_ENTRY_FILE) ? (uint32_t)st.st_size : 0;
+                mtime = (uint32_t)st.st_mtime;
+            }
+        }
+        err = dir_add(d, idx->max_entries, e->d_name, size, mtime, type);
+    }
+    closedir(dir);
+    return err;
+}
+
+/**
+ * @brief Directory mtime for validation, -1 on the FatFs path
+ */
+static int64_t dir_mtime(const sd_index_t *idx, const char *path) {
+    if (fatfs_relative(idx, path)) {
+        return -1;  // FAT does not bump directory timestamps
+    }
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_mtime : -1;
+}
+
+static esp_err_t load_dir(sd_index_t *idx, const char *path, dir_cache_t *d) {
+    int64_t start = esp_timer_get_time();
+    esp_err_t err;
+
+#ifdef ESP_PLATFORM
+    const char *rel = fatfs_relative(idx, path);
+    err = rel ? load_fatfs(idx, rel, d) : load_portable(idx, path, d);
+#else
+    err = load_portable(idx, path, d);
+#endif
+
+    if (err != ESP_OK) {
+        dir_free(d);
+        return err;
+    }
+
+    strcpy(d->path, path);
+    d->loaded_at = esp_timer_get_time();
+    d->load_us = (uint32_t)(d->loaded_at - start);
+    d->dir_mtime = dir_mtime(idx, path);
+
+    idx->stats.loads++;
+    idx->stats.entries_read += d->total;
+    idx->stats.last_load_us = d->load_us;
+    ESP_LOGI(TAG, "%s: %lu entries in %lu us%s", path, (unsigned long)d->total,
+             (unsigned long)d->load_us, d->total > d->count ? " (truncated)" : "");
+    return ESP_OK;
+}
+
+/**
+ * @brief Cached listing still valid?
+ */
+static bool dir_fresh(sd_index_t *idx, const dir_cache_t *d) {
+    if (idx->max_age_ms &&
+        esp_timer_get_time() - d->loaded_at > (int64_t)idx->max_age_ms * 1000) {
+        return false;
+    }
+    return d->dir_mtime < 0 || dir_mtime(idx, d->path) == d->dir_mtime;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_index_create(const sd_index_config_t *config, sd_index_t **out) {
+    if (!config || !out || !config->mount_point || config->max_dirs == 0 ||
+        strlen(config->mount_point) >= sizeof(((sd_index_t *)0)->mount_point) ||
+        (config->fatfs_drive && strlen(config->fatfs_drive) >= sizeof(((sd_index_t *)0)->drive))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sd_index_t *idx = (sd_index_t *)calloc(1, sizeof(sd_index_t));
+    if (!idx) {
+        return ESP_ERR_NO_MEM;
+    }
+    idx->dirs = (dir_cache_t *)calloc(config->max_dirs, sizeof(dir_cache_t));
+    idx->lock = xSemaphoreCreateMutex();
+    if (!idx->dirs || !idx->lock) {
+        free(idx->dirs);
+        if (idx->lock) {
+            vSemaphoreDelete(idx->lock);
+        }
+        free(idx);
+        return ESP_ERR_NO_MEM;
+    }
+
+    strcpy(idx->mount_point, config->mount_point);
+    if (config->fatfs_drive) {
+        strcpy(idx->drive, config->fatfs_drive);
+    }
+    idx->max_dirs = config->max_dirs;
+    idx->max_entries = config->max_entries;
+    idx->max_age_ms = config->max_age_ms;
+    idx->need_size = config->need_size;
+
+    *out = idx;
+    return ESP_OK;
+}
+
+void sd_index_destroy(sd_index_t *idx) {
+    if (!idx) {
+        return;
+    }
+    for (size_t i = 0; i < idx->max_dirs; i++) {
+        dir_free(&idx->dirs[i]);
+    }
+    vSemaphoreDelete(idx->lock);
+    free(idx->dirs);
+    free(idx);
+}
+
+esp_err_t sd_index_list(sd_index_t *idx, const char *path, uint32_t offset,
+                        sd_index_entry_t *entries, size_t max, size_t *count,
+                        sd_index_dir_info_t *info) {
+    char norm[PATH_MAX_LEN];
+    if (!idx || !path || (max && !entries) || !count || !normalize_path(path, norm)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    xSemaphoreTake(idx->lock, portMAX_DELAY);
+    idx->stats.lists++;
+
+    // Look up, or take the least recently used slot
+    dir_cache_t *d = NULL;
+    dir_cache_t *victim = &idx->dirs[0];
+    for (size_t i = 0; i < idx->max_dirs; i++) {
+        dir_cache_t *c = &idx->dirs[i];
+        if (c->path[0] && strcmp(c->path, norm) == 0) {
+            d = c;
+            break;
+        }
+        if (victim->path[0] && (!c->path[0] || c->last_used < victim->last_used)) {
+            victim = c;
+        }
+    }
+
+    bool from_cache = false;
+    esp_err_t err = ESP_OK;
+    if (d && dir_fresh(idx, d)) {
+        idx->stats.hits++;
+        from_cache = true;
+    } else {
+        if (d) {
+            idx->stats.stale++;
+        } else {
+            d = victim;
+        }
+        dir_free(d);
+        err = load_dir(idx, norm, d);
+    }
+
+    if (err == ESP_OK) {
+        d->last_used = ++idx->use_clock;
+        for (uint32_t i = offset; i < d->count && *count < max; i++) {
+            const cached_entry_t *e = &d->entries[i];
+            sd_index_entry_t *out = &entries[(*count)++];
+            snprintf(out->name, sizeof(out->name), "%s", d->names + e->name_off);
+            out->size = e->size;
+            out->mtime = e->mtime;
+            out->type = e->type;
+        }
+        if (info) {
+            info->total = d->count;
+            info->truncated = d->total > d->count;
+            info->from_cache = from_cache;
+            info->load_us = d->load_us;
+        }
+    }
+
+    xSemaphoreGive(idx->lock);
+    return err;
+}
+
+void sd_index_invalidate(sd_index_t *idx, const char *path) {
+    char norm[PATH_MAX_LEN];
+    if (!idx || (path && !normalize_path(path, norm))) {
+        return;
+    }
+
+    xSemaphoreTake(idx->lock, portMAX_DELAY);
+    for (size_t i = 0; i < idx->max_dirs; i++) {
+        dir_cache_t *d = &idx->dirs[i];
+        if (d->path[0] && (!path || strcmp(d->path, norm) == 0)) {
+            dir_free(d);
+            idx->stats.invalidated++;
+        }
+    }
+    xSemaphoreGive(idx->lock);
+}
+
+void sd_index_invalidate_parent(sd_index_t *idx, const char *file_path) {
+    char parent[PATH_MAX_LEN];
+    if (!file_path || !normalize_path(file_path, parent)) {
+        return;
+    }
+    char *slash = strrchr(parent, '/');
+    if (!slash) {
+        return;
+    }
+    if (slash == parent) {
+        slash++;  // Keep "/" for files in the root
+    }
+    *slash = '\0';
+    sd_index_invalidate(idx, parent);
+}
+
+void sd_index_get_stats(sd_index_t *idx, sd_index_stats_t *out) {
+    xSemaphoreTake(idx->lock, portMAX_DELAY);
+    *out = idx->stats;
+    out->cached_dirs = 0;
+    out->cached_bytes = 0;
+    for (size_t i = 0; i < idx->max_dirs; i++) {
+        if (idx->dirs[i].path[0]) {
+            out->cached_dirs++;
+            out->cached_bytes += dir_bytes(&idx->dirs[i]);
+        }
+    }
+    xSemaphoreGive(idx->lock);
+}
@@ -0,0 +1,174 @@
+/**
+ * @file sd_index.h
+ * @brief Cached directory index for SD card listings
+ *
+ * Reads a directory in one pass and keeps the result, so listing a page
+ * of a large directory does not touch the card again:
+ *
+ * - FatFs fast path: f_readdir() returns type, size and date straight from
+ *   the directory entry. stat() per entry would search the directory once
+ *   for every file, which makes a full listing quadratic.
+ * - Portable path (other file systems, Linux): readdir() with d_type;
+ *   stat() only where the type is unknown or a size is wanted.
+ *
+ * Listings are kept in PSRAM for the most recently used directories and
+ * served in pages. A cached listing is reloaded when the directory's mtime
+ * changes (portable path), when it is older than max_age_ms, or after
+ * sd_index_invalidate(). FAT does not update a directory's timestamp when
+ * entries are added or removed, so code writing to the card through this
+ * application calls sd_index_invalidate() for the directory it changed.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest name, including the terminator (FatFs LFN limit + 1)
+#define SD_INDEX_NAME_MAX 256
+
+/**
+ * @brief Entry type
+ */
+typedef enum {
+    SD_ENTRY_FILE = 0,
+    SD_ENTRY_DIR = 1,
+} sd_entry_type_t;
+
+/**
+ * @brief One directory entry, as returned by sd_index_list()
+ */
+typedef struct {
+    char name[SD_INDEX_NAME_MAX];
+    uint32_t size;              // Bytes, 0 for directories
+    uint32_t mtime;             // Seconds since the epoch, 0 if unknown
+    uint8_t type;               // sd_entry_type_t
+} sd_index_entry_t;
+
+/**
+ * @brief Information about the listing a page came from
+ */
+typedef struct {
+    uint32_t total;             // Entries in the cached listing
+    bool truncated;             // Directory has more than max_entries
+    bool from_cache;            // No directory read was needed
+    uint32_t load_us;           // Time the listing took to read
+} sd_index_dir_info_t;
+
+/**
+ * @brief Accumulated statistics
+ */
+typedef struct {
+    uint32_t lists;             // sd_index_list() calls
+    uint32_t hits;              // Served from a cached listing
+    uint32_t loads;             // Directory reads
+    uint32_t stale;             // Reloads because of mtime or age
+    uint32_t invalidated;       // Listings dropped by sd_index_invalidate()
+    uint32_t stat_calls;        // stat() calls on the portable path
+    uint64_t entries_read;
+    uint32_t last_load_us;
+    uint32_t cached_dirs;
+    uint32_t cached_bytes;      // PSRAM held by cached listings
+} sd_index_stats_t;
+
+/**
+ * @brief Index configuration
+ */
+typedef struct {
+    const char *mount_point;    // VFS path of the FAT volume, e.g. "/sdcard"
+    const char *fatfs_drive;    // Its FatFs drive ("0:"), NULL for the portable path
+    size_t max_dirs;            // Directories kept cached
+    size_t max_entries;         // Entries kept per directory (the rest are counted)
+    uint32_t max_age_ms;        // Reload older listings, 0 = no age limit
+    bool need_size;             // Portable path: stat() files for size and mtime
+} sd_index_config_t;
+
+#define SD_INDEX_CONFIG_DEFAULT() {     \
+    .mount_point = "/sdcard",           \
+    .fatfs_drive = "0:",                \
+    .max_dirs = 4,                      \
+    .max_entries = 20000,               \
+    .max_age_ms = 30000,                \
+    .need_size = true,                  \
+}
+
+typedef struct sd_index sd_index_t;
+
+/**
+ * @brief Create an index
+ *
+ * @param config: Configuration (strings are copied)
+ * @param out: Receives the index handle
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing argument or max_dirs is 0
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t sd_index_create(const sd_index_config_t *config, sd_index_t **out);
+
+/**
+ * @brief Free an index and all cached listings
+ */
+void sd_index_destroy(sd_index_t *idx);
+
+/**
+ * @brief Copy a page of a directory listing
+ *
+ * Entries are in directory order; "." and ".." are left out. The first
+ * call for a directory reads all of it, later pages come from the cache.
+ * Safe to call from several tasks.
+ *
+ * @param idx: Index handle
+ * @param path: Directory (VFS path)
+ * @param offset: First entry to copy
+ * @param entries: Destination array
+ * @param max: Size of the destination array
+ * @param count: Receives the number of entries copied
+ * @param info: Listing information, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Success (count is 0 past the end)
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_NOT_FOUND: Directory does not exist
+ *    - ESP_ERR_NO_MEM: Listing does not fit in memory
+ *    - ESP_FAIL: Read error
+ */
+esp_err_t sd_index_list(sd_index_t *idx, const char *path, uint32_t offset,
+                        sd_index_entry_t *entries, size_t max, size_t *count,
+                        sd_index_dir_info_t *info);
+
+/**
+ * @brief Drop the cached listing of a directory
+ *
+ * @param idx: Index handle
+ * @param path: Directory, or NULL for all
+ */
+void sd_index_invalidate(sd_index_t *idx, const char *path);
+
+/**
+ * @brief Drop the cached listing of the directory containing a file
+ *
+ * For callers that just created, renamed or deleted `file_path`.
+ */
+void sd_index_invalidate_parent(sd_index_t *idx, const char *file_path);
+
+/**
+ * @brief Get accumulated statistics
+ */
+void sd_index_get_stats(sd_index_t *idx, sd_index_stats_t *out);
+
+/**
+ * @brief FAT date and time (2 s resolution) to seconds since the epoch, 0 if invalid
+ */
+uint32_t sd_index_fat_to_unix(uint16_t date, uint16_t time);
+
+#ifdef __cplusplus
+}
+#endif
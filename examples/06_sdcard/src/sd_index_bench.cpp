@@ -0,0 +1,117 @@
+/**
+ * @file sd_index_bench.cpp
+ * @brief Listing time of a directory: stat() per entry vs the index
+ */
+
+#include "sd_index_bench.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_index_bench";
+
+static uint32_t count_entries(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+    uint32_t n = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") != 0 && strcmp(e->d_name, "..") != 0) {
+            n++;
+        }
+    }
+    closedir(d);
+    return n;
+}
+
+esp_err_t sd_index_bench_prepare(const char *dir, uint32_t count) {
+    mkdir(dir, 0755);
+    uint32_t have = count_entries(dir);
+    if (have >= count) {
+        return ESP_OK;
+    }
+
+    // Files are created in order, so an interrupted run resumes where it stopped
+    ESP_LOGI(TAG, "Creating %lu files in %s", (unsigned long)(count - have), dir);
+    char path[300];
+    static const char fill[100] = {0};
+    for (uint32_t i = have; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/f%05lu.dat", dir, (unsigned long)i);
+        FILE *f = fopen(path, "w");
+        if (!f) {
+            ESP_LOGE(TAG, "Failed to create %s", path);
+            return ESP_FAIL;
+        }
+        if (i % 100 == 0) {
+            fwrite(fill, 1, sizeof(fill), f);
+        }
+        fclose(f);
+    }
+    return ESP_OK;
+}
+
+esp_err_t sd_index_bench_run(sd_index_t *idx, const char *dir, uint32_t page_size,
+                             sd_index_bench_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    char path[300];
+
+    // readdir() + stat(), within the time budget
+    int64_t start = esp_timer_get_time();
+    DIR *d = opendir(dir);
+    if (!d) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        struct stat st;
+        stat(path, &st);
+        out->stat_entries++;
+        if (esp_timer_get_time() - start > SD_INDEX_BENCH_STAT_BUDGET_US) {
+            break;
+        }
+    }
+    closedir(d);
+    out->stat_us = (uint32_t)(esp_timer_get_time() - start);
+
+    // readdir() with d_type only
+    start = esp_timer_get_time();
+    out->entries = count_entries(dir);
+    out->dtype_us = (uint32_t)(esp_timer_get_time() - start);
+
+    // Index: a cold first page, then a page from the middle
+    sd_index_entry_t *page = (sd_index_entry_t *)malloc(page_size * sizeof(sd_index_entry_t));
+    if (!page) {
+        return ESP_ERR_NO_MEM;
+    }
+    sd_index_invalidate(idx, dir);
+    size_t n;
+    sd_index_dir_info_t info;
+    start = esp_timer_get_time();
+    esp_err_t err = sd_index_list(idx, dir, 0, page, page_size, &n, &info);
+    out->index_cold_us = (uint32_t)(esp_timer_get_time() - start);
+
+    if (err == ESP_OK) {
+        start = esp_timer_get_time();
+        err = sd_index_list(idx, dir, info.total / 2, page, page_size, &n, NULL);
+        out->index_page_us = (uint32_t)(esp_timer_get_time() - start);
+    }
+    free(page);
+
+    ESP_LOGI(TAG, "%s: %lu entries, stat %lu us (%lu entries), d_type %lu us, index cold "
+             "%lu us, page %lu us",
+             dir, (unsigned long)out->entries, (unsigned long)out->stat_us,
+             (unsigned long)out->stat_entries, (unsigned long)out->dtype_us,
+             (unsigned long)out->index_cold_us, (unsigned long)out->index_page_us);
+    return err;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file sd_index_bench.h
+ * @brief Listing time of a directory: stat() per entry vs the index
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The stat() listing is stopped after this long; on FAT it is quadratic
+#define SD_INDEX_BENCH_STAT_BUDGET_US (20 * 1000 * 1000)
+
+/**
+ * @brief Listing times for one directory
+ */
+typedef struct {
+    uint32_t entries;
+    uint32_t stat_entries;      // Entries listed before the stat() budget ran out
+    uint32_t stat_us;           // readdir() + stat() per entry, as 06 used to list
+    uint32_t dtype_us;          // readdir() with d_type only
+    uint32_t index_cold_us;     // First page through the index (reads the directory)
+    uint32_t index_page_us;     // Another page, from the cache
+} sd_index_bench_result_t;
+
+/**
+ * @brief Fill a directory with `count` files (f00000.dat ...)
+ *
+ * Files already there from an earlier run are kept. Every 100th file gets
+ * 100 bytes, the others are empty, so no clusters are spent on them.
+ *
+ * @return
+ *    - ESP_OK: Directory holds at least `count` entries
+ *    - ESP_FAIL: Could not create the directory or a file
+ */
+esp_err_t sd_index_bench_prepare(const char *dir, uint32_t count);
+
+/**
+ * @brief Time the listing methods on a directory
+ *
+ * @param idx: Index to use (the directory's cached listing is dropped first)
+ * @param dir: Directory
+ * @param page_size: Entries per index page
+ * @param out: Results
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - Others: Error from sd_index_list()
+ */
+esp_err_t sd_index_bench_run(sd_index_t *idx, const char *dir, uint32_t page_size,
+                             sd_index_bench_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
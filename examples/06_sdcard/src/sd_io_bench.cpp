@@ -0,0 +1,289 @@
+/**
+ * @file sd_io_bench.cpp
+ * @brief SD card I/O benchmark: block size, pattern, buffer and stdio sweeps
+ */
+
+#include "sd_io_bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_io_bench";
+
+#define BUFFER_ALIGN 64
+
+static const char *pattern_names[] = {"seq-w", "seq-r", "rand-w", "rand-r"};
+
+static uint32_t xorshift32(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void sd_io_bench_fill_latency(sd_io_result_t *out, uint32_t *lat, uint32_t n) {
+    if (n == 0) {
+        return;
+    }
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += lat[i];
+        uint32_t b = 0;
+        while (b < SD_IO_HIST_BUCKETS - 1 && lat[i] >= SD_IO_HIST_LIMIT_US(b)) {
+            b++;
+        }
+        out->hist[b]++;
+    }
+    qsort(lat, n, sizeof(uint32_t), cmp_u32);
+    out->lat_min_us = lat[0];
+    out->lat_avg_us = (uint32_t)(sum / n);
+    out->lat_p50_us = lat[n / 2];
+    out->lat_p99_us = lat[(uint32_t)((n - 1) * 0.99)];
+    out->lat_max_us = lat[n - 1];
+}
+
+static FILE *open_for(const char *path, const sd_io_params_t *p) {
+    bool write = (p->pattern == SD_IO_SEQ_WRITE || p->pattern == SD_IO_RAND_WRITE);
+    if (!write) {
+        return fopen(path, "rb");
+    }
+    if (p->fresh && p->pattern == SD_IO_SEQ_WRITE) {
+        unlink(path);
+        return fopen(path, "wb");
+    }
+    // Rewrite in place, so no clusters are allocated
+    FILE *f = fopen(path, "r+b");
+    return f ? f : fopen(path, "wb");
+}
+
+esp_err_t sd_io_bench_run(const char *path, const sd_io_params_t *p, sd_io_result_t *out) {
+    if (!path || !p || !out || p->block_size == 0 || p->file_size < p->block_size ||
+        p->misalign >= BUFFER_ALIGN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+
+    bool write = (p->pattern == SD_IO_SEQ_WRITE || p->pattern == SD_IO_RAND_WRITE);
+    bool random = (p->pattern == SD_IO_RAND_WRITE || p->pattern == SD_IO_RAND_READ);
+    uint32_t blocks = p->file_size / p->block_size;
+    uint32_t max_ops = p->max_ops ? p->max_ops : blocks;
+
+    uint32_t caps = p->psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    uint8_t *raw = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, p->block_size + BUFFER_ALIGN,
+                                                      caps);
+    uint32_t *lat = (uint32_t *)heap_caps_malloc(max_ops * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    char *vbuf = NULL;
+    if (p->vbuf_size != SD_IO_VBUF_DEFAULT && p->vbuf_size != SD_IO_VBUF_NONE) {
+        vbuf = (char *)malloc(p->vbuf_size);
+    }
+    if (!raw || !lat || (p->vbuf_size != SD_IO_VBUF_DEFAULT &&
+                         p->vbuf_size != SD_IO_VBUF_NONE && !vbuf)) {
+        heap_caps_free(raw);
+        heap_caps_free(lat);
+        free(vbuf);
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t *buf = raw + p->misalign;
+    for (uint32_t i = 0; i < p->block_size; i++) {
+        buf[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    esp_err_t err = ESP_OK;
+    FILE *f = open_for(path, p);
+    if (!f) {
+        err = write ? ESP_FAIL : ESP_ERR_NOT_FOUND;
+    }
+    if (err == ESP_OK && !write) {
+        fseek(f, 0, SEEK_END);
+        if (ftell(f) < (long)(blocks * p->block_size)) {
+            err = ESP_ERR_NOT_FOUND;
+        }
+        fseek(f, 0, SEEK_SET);
+    }
+    if (err == ESP_OK && p->vbuf_size == SD_IO_VBUF_NONE) {
+        setvbuf(f, NULL, _IONBF, 0);
+    } else if (err == ESP_OK && vbuf) {
+        setvbuf(f, vbuf, _IOFBF, p->vbuf_size);
+    }
+
+    uint32_t rng = 0x12345678;
+    int64_t start = esp_timer_get_time();
+    uint32_t n = 0;
+    while (err == ESP_OK && n < max_ops) {
+        int64_t t0 = esp_timer_get_time();
+        if (random) {
+            uint32_t block = xorshift32(&rng) % blocks;
+            if (fseek(f, (long)block * p->block_size, SEEK_SET) != 0) {
+                err = ESP_FAIL;
+                break;
+            }
+        } else if (n > 0 && n % blocks == 0) {
+            fseek(f, 0, SEEK_SET);  // max_ops beyond the file: wrap around
+        }
+        size_t done = write ? fwrite(buf, 1, p->block_size, f) : fread(buf, 1, p->block_size, f);
+        int64_t t1 = esp_timer_get_time();
+        if (done != p->block_size) {
+            ESP_LOGW(TAG, "%s: short %s at op %lu", path, write ? "write" : "read",
+                     (unsigned long)n);
+            err = ESP_FAIL;
+            break;
+        }
+        lat[n++] = (uint32_t)(t1 - t0);
+        if (p->budget_ms && t1 - start > (int64_t)p->budget_ms * 1000) {
+            break;
+        }
+    }
+
+    if (f) {
+        if (err == ESP_OK && write) {
+            int64_t t0 = esp_timer_get_time();
+            fflush(f);
+            fsync(fileno(f));
+            out->sync_us = (uint32_t)(esp_timer_get_time() - t0);
+        }
+        out->elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+        fclose(f);
+    }
+
+    if (err == ESP_OK) {
+        out->ops = n;
+        out->bytes = (uint64_t)n * p->block_size;
+        double secs = out->elapsed_us / 1e6;
+        if (secs > 0) {
+            out->mb_per_s = (float)(out->bytes / 1e6 / secs);
+            out->iops = (float)(n / secs);
+        }
+        sd_io_bench_fill_latency(out, lat, n);
+    }
+
+    heap_caps_free(raw);
+    heap_caps_free(lat);
+    free(vbuf);
+    return err;
+}
+
+size_t sd_io_bench_plan(uint32_t file_size, uint32_t budget_ms, sd_io_params_t *out) {
+    static const uint32_t sizes[] = {512, 4096, 16384, 65536, 262144, 1048576};
+    size_t n = 0;
+
+    sd_io_params_t base = {};
+    base.file_size = file_size;
+    base.budget_ms = budget_ms;
+
+    // Create the file (cluster allocation included)
+    out[n] = base;
+    out[n].pattern = SD_IO_SEQ_WRITE;
+    out[n].block_size = 65536;
+    out[n++].fresh = true;
+
+    // Block size sweep; internal RAM cannot hold the largest buffers
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (int pat = SD_IO_SEQ_WRITE; pat <= SD_IO_RAND_READ; pat++) {
+            out[n] = base;
+            out[n].pattern = (sd_io_pattern_t)pat;
+            out[n].block_size = sizes[i];
+            out[n++].psram = sizes[i] > 65536;
+        }
+    }
+
+    // Misaligned and PSRAM buffers against the aligned internal runs above
+    static const uint32_t cmp_sizes[] = {4096, 65536};
+    for (size_t i = 0; i < 2; i++) {
+        for (int pat = SD_IO_SEQ_WRITE; pat <= SD_IO_SEQ_READ; pat++) {
+            out[n] = base;
+            out[n].pattern = (sd_io_pattern_t)pat;
+            out[n].block_size = cmp_sizes[i];
+            out[n++].misalign = 1;
+
+            out[n] = base;
+            out[n].pattern = (sd_io_pattern_t)pat;
+            out[n].block_size = cmp_sizes[i];
+            out[n++].psram = true;
+        }
+    }
+
+    // stdio buffering of small writes
+    static const uint32_t vbufs[] = {SD_IO_VBUF_NONE, 4096, 16384, 65536};
+    for (size_t i = 0; i < sizeof(vbufs) / sizeof(vbufs[0]); i++) {
+        out[n] = base;
+        out[n].pattern = SD_IO_SEQ_WRITE;
+        out[n].block_size = 512;
+        out[n++].vbuf_size = vbufs[i];
+    }
+
+    // Fresh file against the 4 KB rewrite above
+    out[n] = base;
+    out[n].pattern = SD_IO_SEQ_WRITE;
+    out[n].block_size = 4096;
+    out[n++].fresh = true;
+
+    return n;
+}
+
+static void format_size(uint32_t size, char *buf, size_t len) {
+    if (size >= 1048576 && size % 1048576 == 0) {
+        snprintf(buf, len, "%luM", (unsigned long)(size / 1048576));
+    } else if (size >= 1024 && size % 1024 == 0) {
+        snprintf(buf, len, "%luK", (unsigned long)(size / 1024));
+    } else {
+        snprintf(buf, len, "%lu", (unsigned long)size);
+    }
+}
+
+void sd_io_bench_describe(const sd_io_params_t *p, char *buf, size_t size) {
+    char block[12];
+    char vbuf[16] = "";
+    format_size(p->block_size, block, sizeof(block));
+    if (p->vbuf_size == SD_IO_VBUF_NONE) {
+        snprintf(vbuf, sizeof(vbuf), " vb:none");
+    } else if (p->vbuf_size != SD_IO_VBUF_DEFAULT) {
+        char v[12];
+        format_size(p->vbuf_size, v, sizeof(v));
+        snprintf(vbuf, sizeof(vbuf), " vb:%s", v);
+    }
+    snprintf(buf, size, "%s %s%s%s%s%s", pattern_names[p->pattern], block,
+             p->psram ? " psram" : "", p->misalign ? " +1" : "", vbuf, p->fresh ? " new" : "");
+}
+
+void sd_io_bench_csv_header(FILE *f) {
+    fprintf(f, "pattern,block,buffer,misalign,vbuf,fresh,ops,bytes,elapsed_us,sync_us,"
+               "mb_per_s,iops,lat_min_us,lat_avg_us,lat_p50_us,lat_p99_us,lat_max_us");
+    for (int i = 0; i < SD_IO_HIST_BUCKETS - 1; i++) {
+        fprintf(f, ",lt_%lu_us", SD_IO_HIST_LIMIT_US(i));
+    }
+    fprintf(f, ",ge_%lu_us\n", SD_IO_HIST_LIMIT_US(SD_IO_HIST_BUCKETS - 2));
+}
+
+void sd_io_bench_csv_row(FILE *f, const sd_io_params_t *p, const sd_io_result_t *r) {
+    char vbuf[12];
+    if (p->vbuf_size == SD_IO_VBUF_NONE) {
+        snprintf(vbuf, sizeof(vbuf), "none");
+    } else if (p->vbuf_size == SD_IO_VBUF_DEFAULT) {
+        snprintf(vbuf, sizeof(vbuf), "default");
+    } else {
+        snprintf(vbuf, sizeof(vbuf), "%lu", (unsigned long)p->vbuf_size);
+    }
+    fprintf(f, "%s,%lu,%s,%lu,%s,%d,%lu,%llu,%lu,%lu,%.3f,%.1f,%lu,%lu,%lu,%lu,%lu",
+            pattern_names[p->pattern], (unsigned long)p->block_size,
+            p->psram ? "psram" : "internal", (unsigned long)p->misalign, vbuf, p->fresh ? 1 : 0,
+            (unsigned long)r->ops, (unsigned long long)r->bytes, (unsigned long)r->elapsed_us,
+            (unsigned long)r->sync_us, r->mb_per_s, r->iops, (unsigned long)r->lat_min_us,
+            (unsigned long)r->lat_avg_us, (unsigned long)r->lat_p50_us,
+            (unsigned long)r->lat_p99_us, (unsigned long)r->lat_max_us);
+    for (int i = 0; i < SD_IO_HIST_BUCKETS; i++) {
+        fprintf(f, ",%lu", (unsigned long)r->hist[i]);
+    }
+    fprintf(f, "\n");
+}
@@ -0,0 +1,144 @@
+/**
+ * @file sd_io_bench.h
+ * @brief SD card I/O benchmark: block size, pattern, buffer and stdio sweeps
+ *
+ * Each run opens one test file through stdio and issues fread()/fwrite()
+ * of a fixed block size, sequentially or at random block-aligned offsets,
+ * timing every call. Variables per run:
+ *
+ * - Block size (512 B - 1 MB)
+ * - Buffer placement: internal DMA-capable RAM or PSRAM
+ * - Buffer alignment: 64-byte aligned or offset; the SDMMC driver bounces
+ *   buffers it cannot DMA from through a sector-sized internal buffer
+ * - stdio buffer (setvbuf): newlib default, none, or a given size
+ * - Fresh file vs rewrite: writing a new file allocates clusters as it
+ *   grows, rewriting an existing one does not
+ *
+ * Results: MB/s, IOPS, latency min/avg/p50/p99/max and a log2 histogram,
+ * and a CSV line per run.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Latency histogram: bucket i counts ops below (64 << i) us, the last one the rest
+#define SD_IO_HIST_BUCKETS      12
+#define SD_IO_HIST_LIMIT_US(i)  (64UL << (i))
+
+// vbuf_size values besides a buffer size
+#define SD_IO_VBUF_DEFAULT      0           // Leave the newlib buffer alone
+#define SD_IO_VBUF_NONE         UINT32_MAX  // setvbuf(_IONBF)
+
+// Upper bound for the runs of sd_io_bench_plan()
+#define SD_IO_PLAN_MAX          48
+
+/**
+ * @brief Access pattern
+ */
+typedef enum {
+    SD_IO_SEQ_WRITE,
+    SD_IO_SEQ_READ,
+    SD_IO_RAND_WRITE,
+    SD_IO_RAND_READ,
+} sd_io_pattern_t;
+
+/**
+ * @brief Parameters of one run
+ */
+typedef struct {
+    sd_io_pattern_t pattern;
+    uint32_t block_size;        // Bytes per fread()/fwrite()
+    uint32_t file_size;         // Test file size (rounded down to whole blocks)
+    bool psram;                 // Buffer in PSRAM instead of internal DMA RAM
+    uint32_t misalign;          // Buffer offset from 64-byte alignment
+    uint32_t vbuf_size;         // stdio buffer, or SD_IO_VBUF_DEFAULT / _NONE
+    bool fresh;                 // SEQ_WRITE: delete the file first
+    uint32_t max_ops;           // 0: file_size / block_size
+    uint32_t budget_ms;         // Stop after this long, 0: no limit
+} sd_io_params_t;
+
+/**
+ * @brief Result of one run
+ */
+typedef struct {
+    uint32_t ops;
+    uint64_t bytes;
+    uint32_t elapsed_us;        // Including the final fflush() + fsync() of writes
+    uint32_t sync_us;           // The final fflush() + fsync()
+    float mb_per_s;             // MB = 1,000,000 bytes
+    float iops;
+    uint32_t lat_min_us;
+    uint32_t lat_avg_us;
+    uint32_t lat_p50_us;
+    uint32_t lat_p99_us;
+    uint32_t lat_max_us;
+    uint32_t hist[SD_IO_HIST_BUCKETS];
+} sd_io_result_t;
+
+/**
+ * @brief Run one test against `path`
+ *
+ * Read patterns need the file to hold file_size bytes already (run a
+ * SEQ_WRITE of the same size first).
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid parameters
+ *    - ESP_ERR_NO_MEM: Buffer allocation failed
+ *    - ESP_ERR_NOT_FOUND: File missing or too short for a read pattern
+ *    - ESP_FAIL: I/O error
+ */
+esp_err_t sd_io_bench_run(const char *path, const sd_io_params_t *params, sd_io_result_t *out);
+
+/**
+ * @brief Fill the latency fields and histogram of `out`
+ *
+ * For other benchmarks that time calls the same way. Sorts `lat`.
+ *
+ * @param out: Result to update
+ * @param lat: Latency of each call in us
+ * @param n: Number of calls
+ */
+void sd_io_bench_fill_latency(sd_io_result_t *out, uint32_t *lat, uint32_t n);
+
+/**
+ * @brief Fill `out` with the default sweep
+ *
+ * Block sizes 512 B - 1 MB for the four patterns, then alignment, buffer
+ * placement, setvbuf and fresh-file comparisons. Runs that read come after
+ * a write of the same file size.
+ *
+ * @param file_size: Test file size
+ * @param budget_ms: Time limit per run
+ * @param out: Array of at least SD_IO_PLAN_MAX entries
+ *
+ * @return Number of runs
+ */
+size_t sd_io_bench_plan(uint32_t file_size, uint32_t budget_ms, sd_io_params_t *out);
+
+/**
+ * @brief Short label for a run, e.g. "rand-r 4K psram +1 vb:none"
+ */
+void sd_io_bench_describe(const sd_io_params_t *params, char *buf, size_t size);
+
+/**
+ * @brief Write the CSV header line
+ */
+void sd_io_bench_csv_header(FILE *f);
+
+/**
+ * @brief Write one CSV line
+ */
+void sd_io_bench_csv_row(FILE *f, const sd_io_params_t *params, const sd_io_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,556 @@
+/**
+ * @file sd_log.cpp
+ * @brief Crash-tolerant append-only ring log in a preallocated file
+ *
+ * File layout: block 0 holds the file header, blocks 1..n the ring. Each
+ * ring block starts with a block header followed by records, each a
+ * 16-bit length and the data; the rest of the block is zero.
+ */
+
+#include "sd_log.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_log";
+
+#define LOG_MAGIC       0x474C4453  // "SDLG"
+#define LOG_VERSION     1
+#define BLOCK_MAGIC     0x4B4C4253  // "SBLK"
+
+#define BUFFER_ALIGN    64          // Cache line, for DMA straight from the buffers
+#define SCAN_BYTES      (32 * 1024) // Read size of the recovery scan
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t blocks;                // Ring blocks after this one
+    uint32_t crc;                   // Over all fields above
+} file_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t block_seq;             // 1, 2, ... in write order
+    uint32_t first_seq;             // Sequence number of the first record
+    uint16_t count;                 // Records in the block
+    uint16_t used;                  // Record bytes after this header
+    uint32_t crc;                   // Over the fields above and the record bytes
+} block_header_t;
+
+#define RECORD_LEN_SIZE 2
+
+struct sd_log {
+    FILE *f;
+    uint32_t bs;                    // Block size
+    uint32_t n;                     // Ring blocks
+    uint32_t batch_blocks;
+    uint32_t flush_ms;
+    uint32_t *first_seqs;           // First record of each ring block on the card
+    uint32_t oldest;                // Ring index of the oldest block of the log
+    uint32_t used;                  // Blocks in the log
+    uint32_t head;                  // Ring index of the next block to write
+    uint32_t next_block_seq;
+    uint32_t next_seq;              // Next record to append
+    uint32_t written_seq;           // First record not on the card
+    uint8_t *batch;                 // batch_blocks blocks
+    uint32_t full;                  // Sealed blocks in the batch
+    uint32_t fill;                  // Bytes in the current block, 0: none started
+    int64_t pending_since;          // Append time of the oldest pending record
+    uint8_t *rbuf;                  // One block for sd_log_read() and recovery
+    int64_t rbuf_index;             // Ring index held in rbuf, -1: none
+    sd_log_stats_t stats;
+};
+
+// ============================================================================
+// Blocks
+// ============================================================================
+
+static uint32_t block_crc(const block_header_t *h) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(block_header_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)(h + 1), h->used);
+}
+
+static bool block_valid(const uint8_t *b, uint32_t bs) {
+    const block_header_t *h = (const block_header_t *)b;
+    return h->magic == BLOCK_MAGIC && h->block_seq != 0 &&
+           h->used <= bs - sizeof(block_header_t) && block_crc(h) == h->crc;
+}
+
+static uint32_t file_header_crc(const file_header_t *h) {
+    return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(file_header_t, crc));
+}
+
+static esp_err_t write_at(sd_log_t *log, uint32_t block, const void *data, uint32_t blocks) {
+    log->stats.writes++;
+    if (fseek(log->f, (long)block * log->bs, SEEK_SET) != 0 ||
+        fwrite(data, log->bs, blocks, log->f) != blocks) {
+        ESP_LOGE(TAG, "Write of %lu blocks at %lu failed", (unsigned long)blocks,
+                 (unsigned long)block);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Finish the current block: sequence number, padding and CRC
+ */
+static void seal_block(sd_log_t *log) {
+    uint8_t *b = log->batch + log->full * log->bs;
+    block_header_t *h = (block_header_t *)b;
+    memset(b + log->fill, 0, log->bs - log->fill);
+    h->magic = BLOCK_MAGIC;
+    h->block_seq = log->next_block_seq++;
+    h->used = (uint16_t)(log->fill - sizeof(block_header_t));
+    h->crc = block_crc(h);
+    log->full++;
+    log->fill = 0;
+}
+
+/**
+ * @brief Write the sealed blocks of the batch at the head of the ring
+ */
+static esp_err_t write_batch(sd_log_t *log) {
+    if (log->full == 0) {
+        return ESP_OK;
+    }
+
+    // The blocks written replace the oldest ones once the ring is full
+    for (uint32_t k = 0; k < log->full; k++) {
+        uint32_t idx = (log->head + k) % log->n;
+        if (log->used == 0) {
+            log->oldest = idx;
+        }
+        if (log->used == log->n) {
+            uint32_t next = (log->oldest + 1) % log->n;
+            log->stats.dropped += log->first_seqs[next] - log->first_seqs[log->oldest];
+            log->oldest = next;
+        } else {
+            log->used++;
+        }
+        log->first_seqs[idx] = ((const block_header_t *)(log->batch + k * log->bs))->first_seq;
+    }
+
+    // One write, two where the batch wraps around the end of the ring
+    uint32_t first = log->n - log->head;
+    if (first > log->full) {
+        first = log->full;
+    }
+    esp_err_t err = write_at(log, 1 + log->head, log->batch, first);
+    if (err == ESP_OK && first < log->full) {
+        err = write_at(log, 1, log->batch + first * log->bs, log->full - first);
+    }
+
+    log->head = (log->head + log->full) % log->n;
+    log->stats.blocks_written += log->full;
+    log->full = 0;
+    log->written_seq = log->next_seq;  // Called with no block started
+    log->rbuf_index = -1;
+    return err;
+}
+
+/**
+ * @brief Write everything pending, ending the current block early
+ */
+static esp_err_t write_pending(sd_log_t *log) {
+    if (log->fill) {
+        log->stats.padding_bytes += log->bs - log->fill;
+        seal_block(log);
+    }
+    log->pending_since = 0;
+    return write_batch(log);
+}
+
+// ============================================================================
+// Create and recover
+// ============================================================================
+
+static esp_err_t create(sd_log_t *log, const char *path) {
+    log->f = fopen(path, "w+b");
+    if (!log->f) {
+        ESP_LOGE(TAG, "Cannot create %s", path);
+        return ESP_FAIL;
+    }
+    setvbuf(log->f, NULL, _IONBF, 0);
+
+    memset(log->batch, 0, log->batch_blocks * log->bs);
+    file_header_t *h = (file_header_t *)log->batch;
+    h->magic = LOG_MAGIC;
+    h->version = LOG_VERSION;
+    h->block_size = log->bs;
+    h->blocks = log->n;
+    h->crc = file_header_crc(h);
+    esp_err_t err = write_at(log, 0, log->batch, 1);
+
+    // Empty blocks, a batch per write
+    memset(log->batch, 0, log->bs);
+    for (uint32_t i = 0; i < log->n && err == ESP_OK; i += log->batch_blocks) {
+        uint32_t k = log->n - i < log->batch_blocks ? log->n - i : log->batch_blocks;
+        err = write_at(log, 1 + i, log->batch, k);
+    }
+    if (err == ESP_OK && (fflush(log->f) != 0 || fsync(fileno(log->f)) != 0)) {
+        err = ESP_FAIL;
+    }
+
+    log->stats.created = true;
+    log->stats.writes = 0;
+    return err;
+}
+
+/**
+ * @brief A run of ring blocks whose sequence numbers follow each other
+ */
+typedef struct {
+    uint32_t start;
+    uint32_t len;
+    uint32_t start_bseq;
+    uint32_t end_bseq;
+} run_t;
+
+/**
+ * @brief Block j continues block i: both valid, sequence numbers follow on
+ */
+static bool links(const uint32_t *bseq, const uint32_t *first_seqs, const uint16_t *count,
+                  uint32_t i, uint32_t j) {
+    return bseq[i] && bseq[j] && bseq[j] == bseq[i] + 1 &&
+           first_seqs[j] == first_seqs[i] + count[i];
+}
+
+/**
+ * @brief Scan all blocks and pick the log
+ *
+ * The log is the run ending with the newest block, except that a short
+ * run right after a gap of less than a batch is the rest of a batch torn
+ * by a power loss; its blocks are cleared so they cannot be mistaken for
+ * log blocks later.
+ */
+static esp_err_t recover(sd_log_t *log) {
+    uint32_t n = log->n;
+    uint32_t *bseq = (uint32_t *)heap_caps_calloc(n, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    uint16_t *count = (uint16_t *)heap_caps_calloc(n, sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    run_t *runs = (run_t *)heap_caps_malloc(n * sizeof(run_t), MALLOC_CAP_SPIRAM);
+    uint32_t scan_blocks = SCAN_BYTES / log->bs;
+    uint8_t *scan = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, scan_blocks * log->bs,
+                                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (!scan) {
+        scan = log->batch;  // Smaller reads, same result
+        scan_blocks = log->batch_blocks;
+    }
+    esp_err_t err = (bseq && count && runs) ? ESP_OK : ESP_ERR_NO_MEM;
+
+    // One forward pass over the file
+    if (err == ESP_OK && fseek(log->f, (long)log->bs, SEEK_SET) != 0) {
+        err = ESP_FAIL;
+    }
+    for (uint32_t i = 0; i < n && err == ESP_OK; i += scan_blocks) {
+        uint32_t k = n - i < scan_blocks ? n - i : scan_blocks;
+        if (fread(scan, log->bs, k, log->f) != k) {
+            ESP_LOGE(TAG, "Read of blocks %lu..%lu failed", (unsigned long)i,
+                     (unsigned long)(i + k - 1));
+            err = ESP_FAIL;
+            break;
+        }
+        for (uint32_t j = 0; j < k; j++) {
+            const uint8_t *b = scan + j * log->bs;
+            const block_header_t *h = (const block_header_t *)b;
+            if (block_valid(b, log->bs)) {
+                bseq[i + j] = h->block_seq;
+                log->first_seqs[i + j] = h->first_seq;
+                count[i + j] = h->count;
+            } else if (h->magic == BLOCK_MAGIC) {
+                log->stats.torn_blocks++;
+            }
+        }
+    }
+
+    // Runs of linked blocks, each starting at a block that continues none
+    const uint32_t *first = log->first_seqs;
+    uint32_t n_runs = 0;
+    for (uint32_t i = 0; i < n && err == ESP_OK; i++) {
+        if (!bseq[i] || links(bseq, first, count, (i + n - 1) % n, i)) {
+            continue;
+        }
+        run_t r = {i, 1, bseq[i], bseq[i]};
+        for (uint32_t k = i; r.len < n && links(bseq, first, count, k, (k + 1) % n);
+             k = (k + 1) % n) {
+            r.len++;
+            r.end_bseq = bseq[(k + 1) % n];
+        }
+        runs[n_runs++] = r;
+    }
+
+    const run_t *log_run = NULL;
+    for (uint32_t a = 0; a < n_runs; a++) {
+        bool torn_rest = false;
+        for (uint32_t b = 0; b < n_runs && runs[a].len < log->batch_blocks; b++) {
+            if (runs[a].start_bseq > runs[b].end_bseq &&
+                runs[a].start_bseq - runs[b].end_bseq <= log->batch_blocks) {
+                torn_rest = true;
+            }
+        }
+        if (!torn_rest && (!log_run || runs[a].end_bseq > log_run->end_bseq)) {
+            log_run = &runs[a];
+        }
+    }
+
+    if (err == ESP_OK && log_run) {
+        log->oldest = log_run->start;
+        log->used = log_run->len;
+        uint32_t newest = (log->oldest + log->used - 1) % n;
+        log->head = (newest + 1) % n;
+        log->next_block_seq = bseq[newest] + 1;
+        log->next_seq = log->first_seqs[newest] + count[newest];
+
+        // Clear newer blocks outside the log
+        memset(log->rbuf, 0, log->bs);
+        for (uint32_t i = 0; i < n && err == ESP_OK; i++) {
+            bool in_log = (i + n - log->oldest) % n < log->used;
+            if (!in_log && bseq[i] > log_run->end_bseq) {
+                err = write_at(log, 1 + i, log->rbuf, 1);
+                log->stats.discarded_blocks++;
+            }
+        }
+        if (log->stats.discarded_blocks) {
+            fflush(log->f);
+            fsync(fileno(log->f));
+        }
+    }
+    log->written_seq = log->next_seq;
+
+    if (scan != log->batch) {
+        heap_caps_free(scan);
+    }
+    heap_caps_free(bseq);
+    heap_caps_free(count);
+    heap_caps_free(runs);
+    return err;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_log_open(const char *path, const sd_log_config_t *config, sd_log_t **out) {
+    if (!path || !config || !out || config->block_size < 512 || config->block_size > 4096 ||
+        config->block_size % 512 || config->batch_blocks == 0 ||
+        config->size / config->block_size < 1 + 2 * config->batch_blocks) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    sd_log_t *log = (sd_log_t *)calloc(1, sizeof(sd_log_t));
+    if (!log) {
+        return ESP_ERR_NO_MEM;
+    }
+    log->bs = config->block_size;
+    log->n = config->size / config->block_size - 1;
+    log->batch_blocks = config->batch_blocks;
+    log->flush_ms = config->flush_ms;
+    log->next_block_seq = 1;
+    log->next_seq = 1;
+    log->written_seq = 1;
+    log->rbuf_index = -1;
+    log->first_seqs = (uint32_t *)heap_caps_calloc(log->n, sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    log->batch = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, log->batch_blocks * log->bs,
+                                                    MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    log->rbuf = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, log->bs,
+                                                   MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (!log->first_seqs || !log->batch || !log->rbuf) {
+        sd_log_close(log);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = ESP_FAIL;
+    log->f = fopen(path, "r+b");
+    if (log->f) {
+        setvbuf(log->f, NULL, _IONBF, 0);
+        file_header_t h = {};
+        if (fread(log->rbuf, log->bs, 1, log->f) == 1) {
+            memcpy(&h, log->rbuf, sizeof(h));
+        }
+        if (h.magic == LOG_MAGIC && h.version == LOG_VERSION && h.crc == file_header_crc(&h) &&
+            h.block_size == log->bs && h.blocks == log->n) {
+            err = recover(log);
+        } else {
+            ESP_LOGW(TAG, "%s: not a log of this size, recreating", path);
+            fclose(log->f);
+            log->f = NULL;
+        }
+    }
+    if (!log->f) {
+        err = create(log, path);
+    }
+    log->stats.open_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    if (err != ESP_OK) {
+        sd_log_close(log);
+        return err;
+    }
+    ESP_LOGI(TAG, "%s: %lu blocks, %lu in use, records %lu..%lu, %lu torn, %lu ms", path,
+             (unsigned long)log->n, (unsigned long)log->used,
+             (unsigned long)(log->used ? log->first_seqs[log->oldest] : log->next_seq),
+             (unsigned long)(log->next_seq - 1), (unsigned long)log->stats.torn_blocks,
+             (unsigned long)(log->stats.open_us / 1000));
+    *out = log;
+    return ESP_OK;
+}
+
+esp_err_t sd_log_append(sd_log_t *log, const void *data, size_t len, uint32_t *seq) {
+    uint32_t max_record = log->bs - sizeof(block_header_t) - RECORD_LEN_SIZE;
+    if (!data || len == 0 || len > max_record) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (log->fill && log->fill + RECORD_LEN_SIZE + len > log->bs) {
+        seal_block(log);
+        if (log->full == log->batch_blocks) {
+            err = write_batch(log);
+        }
+    }
+
+    uint8_t *b = log->batch + log->full * log->bs;
+    block_header_t *h = (block_header_t *)b;
+    if (log->fill == 0) {
+        memset(h, 0, sizeof(*h));
+        h->first_seq = log->next_seq;
+        log->fill = sizeof(block_header_t);
+    }
+    uint16_t len16 = (uint16_t)len;
+    memcpy(b + log->fill, &len16, RECORD_LEN_SIZE);
+    memcpy(b + log->fill + RECORD_LEN_SIZE, data, len);
+    log->fill += RECORD_LEN_SIZE + len;
+    h->count++;
+
+    int64_t now = esp_timer_get_time();
+    if (log->pending_since == 0) {
+        log->pending_since = now;
+    }
+    if (seq) {
+        *seq = log->next_seq;
+    }
+    log->next_seq++;
+    log->stats.appended++;
+
+    if (err == ESP_OK && log->flush_ms &&
+        now - log->pending_since >= (int64_t)log->flush_ms * 1000) {
+        err = write_pending(log);
+    }
+    return err;
+}
+
+esp_err_t sd_log_flush(sd_log_t *log) {
+    esp_err_t err = write_pending(log);
+    if (fflush(log->f) != 0 || fsync(fileno(log->f)) != 0) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+void sd_log_cursor_init(sd_log_cursor_t *cursor, uint32_t seq) {
+    cursor->seq = seq;
+}
+
+esp_err_t sd_log_read(sd_log_t *log, sd_log_cursor_t *cursor, void *buf, size_t max,
+                      size_t *len, uint32_t *seq) {
+    if (log->used == 0 || cursor->seq >= log->written_seq) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (cursor->seq < log->first_seqs[log->oldest]) {
+        cursor->seq = log->first_seqs[log->oldest];
+    }
+
+    // Last block whose first record is at or before the cursor
+    uint32_t lo = 0;
+    uint32_t hi = log->used - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1) / 2;
+        if (log->first_seqs[(log->oldest + mid) % log->n] <= cursor->seq) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    uint32_t idx = (log->oldest + lo) % log->n;
+
+    if (log->rbuf_index != (int64_t)idx) {
+        log->rbuf_index = -1;
+        if (fseek(log->f, (long)(1 + idx) * log->bs, SEEK_SET) != 0 ||
+            fread(log->rbuf, log->bs, 1, log->f) != 1 || !block_valid(log->rbuf, log->bs)) {
+            ESP_LOGE(TAG, "Block %lu unreadable", (unsigned long)idx);
+            return ESP_FAIL;
+        }
+        log->rbuf_index = idx;
+    }
+
+    const block_header_t *h = (const block_header_t *)log->rbuf;
+    uint32_t skip = cursor->seq - h->first_seq;
+    if (skip >= h->count) {
+        return ESP_FAIL;
+    }
+    uint32_t off = sizeof(block_header_t);
+    uint32_t end = sizeof(block_header_t) + h->used;
+    uint16_t rlen = 0;
+    for (uint32_t r = 0;; r++) {
+        if (off + RECORD_LEN_SIZE > end) {
+            return ESP_FAIL;
+        }
+        memcpy(&rlen, log->rbuf + off, RECORD_LEN_SIZE);
+        if (off + RECORD_LEN_SIZE + rlen > end) {
+            return ESP_FAIL;
+        }
+        if (r == skip) {
+            break;
+        }
+        off += RECORD_LEN_SIZE + rlen;
+    }
+
+    *len = rlen;
+    if (rlen > max) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, log->rbuf + off + RECORD_LEN_SIZE, rlen);
+    if (seq) {
+        *seq = cursor->seq;
+    }
+    cursor->seq++;
+    return ESP_OK;
+}
+
+void sd_log_get_stats(const sd_log_t *log, sd_log_stats_t *out) {
+    *out = log->stats;
+    out->first_seq = log->used ? log->first_seqs[log->oldest] : log->written_seq;
+    out->next_seq = log->next_seq;
+    out->pending = log->next_seq - log->written_seq;
+    out->blocks = log->n;
+    out->used_blocks = log->used;
+    out->max_record = log->bs - sizeof(block_header_t) - RECORD_LEN_SIZE;
+}
+
+esp_err_t sd_log_close(sd_log_t *log) {
+    if (!log) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    if (log->f) {
+        if (log->batch) {
+            err = sd_log_flush(log);
+        }
+        if (fclose(log->f) != 0) {
+            err = ESP_FAIL;
+        }
+    }
+    heap_caps_free(log->first_seqs);
+    heap_caps_free(log->batch);
+    heap_caps_free(log->rbuf);
+    free(log);
+    return err;
+}
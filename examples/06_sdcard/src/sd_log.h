@@ -0,0 +1,185 @@
+/**
+ * @file sd_log.h
+ * @brief Crash-tolerant append-only ring log in a preallocated file
+ *
+ * fopen() / fprintf() / fclose() per record costs a directory update, a
+ * FAT lookup and a partial sector write each time, and a power loss in
+ * between can leave the file size, the FAT and the data disagreeing.
+ *
+ * The log is one file of fixed size, created once. Records are packed
+ * into blocks (512 bytes by default); every block carries a block sequence
+ * number, the sequence number of its first record and a CRC over the
+ * block. Full blocks are collected in RAM and written batch_blocks at a
+ * time with one sector-aligned write, at the head of the ring; when the
+ * ring is full the oldest blocks are overwritten. Nothing else is ever
+ * rewritten: there is no header to keep up to date and the file never
+ * changes size.
+ *
+ * At open the file is scanned forward once. Valid blocks whose block and
+ * record sequence numbers follow each other form the log; the longest
+ * such chain wins, so a block torn by a power loss ends the log there and
+ * the blocks written after it in the same batch are discarded.
+ *
+ * Records still in RAM are lost on a power loss: at most one batch, or
+ * flush_ms worth of records. sd_log_flush() writes them, ending the
+ * current block early.
+ *
+ * Uses stdio only, so it also builds for Linux (see host/). Not thread
+ * safe: use a log from one task, e.g. the SD worker.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sd_log sd_log_t;
+
+/**
+ * @brief Log configuration, fixed when the file is created
+ */
+typedef struct {
+    uint32_t size;               // File size (rounded down to whole blocks)
+    uint32_t block_size;         // 512 - 4096, a multiple of 512
+    uint32_t batch_blocks;       // Full blocks written together
+    uint32_t flush_ms;           // On append, write a partial batch this old; 0: never
+} sd_log_config_t;
+
+#define SD_LOG_CONFIG_DEFAULT() {       \
+    .size = 1024 * 1024,                \
+    .block_size = 512,                  \
+    .batch_blocks = 8,                  \
+    .flush_ms = 1000,                   \
+}
+
+/**
+ * @brief Log state and metrics
+ */
+typedef struct {
+    uint32_t first_seq;          // Oldest record on the card
+    uint32_t next_seq;           // Sequence number of the next append
+    uint32_t pending;            // Records not written yet
+    uint32_t blocks;             // Data blocks in the file
+    uint32_t used_blocks;        // Blocks holding the log
+    uint32_t max_record;         // Largest record that fits a block
+    // Open
+    bool created;                // The file was created or reformatted
+    uint32_t open_us;            // Including recovery
+    uint32_t torn_blocks;        // Blocks with a CRC error
+    uint32_t discarded_blocks;   // Valid blocks not part of the log, cleared
+    // Appends
+    uint32_t appended;
+    uint32_t dropped;            // Records overwritten by the ring
+    uint32_t writes;             // Write calls to the file
+    uint32_t blocks_written;
+    uint32_t padding_bytes;      // Unused block space (blocks ended early by a flush)
+} sd_log_stats_t;
+
+/**
+ * @brief Read position, see sd_log_read()
+ */
+typedef struct {
+    uint32_t seq;                // Next record to read
+} sd_log_cursor_t;
+
+/**
+ * @brief Open a log file, recovering its content, or create it
+ *
+ * A missing file, or one with a different size or block size, is created
+ * (written full of empty blocks, which takes as long as writing `size`
+ * bytes).
+ *
+ * @param path: File path
+ * @param config: Log configuration
+ * @param out: Receives the log
+ *
+ * @return
+ *    - ESP_OK: Log ready
+ *    - ESP_ERR_INVALID_ARG: Invalid configuration (needs 2 batches of blocks)
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: File cannot be opened, created or read
+ */
+esp_err_t sd_log_open(const char *path, const sd_log_config_t *config, sd_log_t **out);
+
+/**
+ * @brief Append a record
+ *
+ * Usually only copies into RAM; writes a batch when batch_blocks blocks
+ * are full or the oldest pending record is flush_ms old.
+ *
+ * @param log: Log
+ * @param data: Record
+ * @param len: Record length, 1 - max_record bytes
+ * @param seq: Receives the record's sequence number, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Record appended
+ *    - ESP_ERR_INVALID_SIZE: Record empty or larger than a block
+ *    - ESP_FAIL: Write error
+ */
+esp_err_t sd_log_append(sd_log_t *log, const void *data, size_t len, uint32_t *seq);
+
+/**
+ * @brief Write pending records and sync the file
+ *
+ * A partly filled block is written as it is; the next append starts a new
+ * block.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_FAIL: Write error
+ */
+esp_err_t sd_log_flush(sd_log_t *log);
+
+/**
+ * @brief Start reading at record `seq`, or at the oldest record if it is gone
+ */
+void sd_log_cursor_init(sd_log_cursor_t *cursor, uint32_t seq);
+
+/**
+ * @brief Read the record at the cursor and advance it
+ *
+ * Reads written records only; flush first to see pending ones. If the
+ * cursor's record has been overwritten, reading continues at the oldest
+ * one (`seq` tells which).
+ *
+ * @param log: Log
+ * @param cursor: Read position
+ * @param buf: Destination
+ * @param max: Size of buf
+ * @param len: Receives the record length
+ * @param seq: Receives the record's sequence number, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Record read
+ *    - ESP_ERR_NOT_FOUND: No more written records
+ *    - ESP_ERR_INVALID_SIZE: buf too small (len holds the size needed)
+ *    - ESP_FAIL: Read error or corrupt block
+ */
+esp_err_t sd_log_read(sd_log_t *log, sd_log_cursor_t *cursor, void *buf, size_t max,
+                      size_t *len, uint32_t *seq);
+
+/**
+ * @brief Get the log state
+ */
+void sd_log_get_stats(const sd_log_t *log, sd_log_stats_t *out);
+
+/**
+ * @brief Flush and close the log
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: NULL log
+ *    - ESP_FAIL: The final write failed
+ */
+esp_err_t sd_log_close(sd_log_t *log);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @file sd_log_bench.cpp
+ * @brief Ring log benchmark: records per second and recovery time
+ */
+
+#include "sd_log_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_log_bench";
+
+#define MIN_RECORD      16          // Sequence number and some text
+#define RECORD_LEN_SIZE 2           // Length prefix of a record in a block
+
+static const char *method_names[SD_LOG_BENCH_METHOD_COUNT] = {"fprintf", "log+flush",
+                                                              "log"};
+
+void sd_log_bench_record(uint32_t seq, uint8_t *buf, uint32_t size) {
+    // Printable, so the same content works as a text line
+    int n = snprintf((char *)buf, size, "%08lx ", (unsigned long)seq);
+    for (uint32_t i = (uint32_t)n; i < size; i++) {
+        buf[i] = (uint8_t)('a' + (seq + i) % 26);
+    }
+}
+
+static esp_err_t append_line(const char *path, const uint8_t *rec, uint32_t size) {
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    // fclose() syncs on FatFs; fsync() makes it the same elsewhere
+    bool ok = fprintf(f, "%.*s\n", (int)size, (const char *)rec) == (int)size + 1;
+    ok = (fflush(f) == 0 && fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_log_bench_run(const char *path, const sd_log_bench_params_t *p,
+                           const sd_log_config_t *config, sd_io_result_t *out) {
+    if (!path || !p || !config || !out || p->method >= SD_LOG_BENCH_METHOD_COUNT ||
+        p->records == 0 || p->record_size < MIN_RECORD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+
+    uint8_t *rec = (uint8_t *)malloc(p->record_size);
+    uint32_t *lat = (uint32_t *)heap_caps_malloc(p->records * sizeof(uint32_t),
+                                                 MALLOC_CAP_SPIRAM);
+    if (!rec || !lat) {
+        free(rec);
+        heap_caps_free(lat);
+        return ESP_ERR_NO_MEM;
+    }
+    unlink(path);
+
+    // Creating the log is a one-off, not part of the run
+    esp_err_t err = ESP_OK;
+    sd_log_t *log = NULL;
+    if (p->method != SD_LOG_BENCH_FPRINTF) {
+        err = sd_log_open(path, config, &log);
+    }
+
+    int64_t start = esp_timer_get_time();
+    int64_t deadline = p->budget_ms ? start + (int64_t)p->budget_ms * 1000 : 0;
+    uint32_t n = 0;
+    while (err == ESP_OK && n < p->records) {
+        sd_log_bench_record(n + 1, rec, p->record_size);
+        int64_t t0 = esp_timer_get_time();
+        if (!log) {
+            err = append_line(path, rec, p->record_size);
+        } else {
+            err = sd_log_append(log, rec, p->record_size, NULL);
+            if (err == ESP_OK && p->method == SD_LOG_BENCH_SYNC_EACH) {
+                err = sd_log_flush(log);
+            }
+        }
+        int64_t t1 = esp_timer_get_time();
+        lat[n++] = (uint32_t)(t1 - t0);
+        if (deadline && t1 >= deadline) {
+            break;
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: %s failed at record %lu", path, method_names[p->method],
+                 (unsigned long)n);
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (log) {
+        esp_err_t cerr = sd_log_close(log);
+        err = (err == ESP_OK) ? cerr : err;
+    }
+    int64_t end = esp_timer_get_time();
+    out->sync_us = (uint32_t)(end - t0);
+    out->elapsed_us = (uint32_t)(end - start);
+
+    if (err == ESP_OK) {
+        out->ops = n;
+        out->bytes = (uint64_t)n * p->record_size;
+        double secs = out->elapsed_us / 1e6;
+        if (secs > 0) {
+            out->mb_per_s = (float)(out->bytes / 1e6 / secs);
+            out->iops = (float)(n / secs);
+        }
+        sd_io_bench_fill_latency(out, lat, n);
+    }
+
+    unlink(path);
+    free(rec);
+    heap_caps_free(lat);
+    return err;
+}
+
+/**
+ * @brief Read the whole log, checking order and content
+ */
+static bool verify(sd_log_t *log, uint32_t record_size, uint32_t *records) {
+    sd_log_stats_t st;
+    sd_log_get_stats(log, &st);
+
+    uint8_t *buf = (uint8_t *)malloc(st.max_record);
+    uint8_t *expect = (uint8_t *)malloc(record_size);
+    bool ok = buf && expect;
+    sd_log_cursor_t cur;
+    sd_log_cursor_init(&cur, 0);
+    uint32_t n = 0;
+    size_t len = 0;
+    uint32_t seq = 0;
+    while (ok && sd_log_read(log, &cur, buf, st.max_record, &len, &seq) == ESP_OK) {
+        sd_log_bench_record(seq, expect, record_size);
+        if (seq != st.first_seq + n || len != record_size || memcmp(buf, expect, len) != 0) {
+            ESP_LOGE(TAG, "Record %lu: seq %lu, %lu bytes", (unsigned long)n,
+                     (unsigned long)seq, (unsigned long)len);
+            ok = false;
+        }
+        n++;
+    }
+    *records = n;
+    free(buf);
+    free(expect);
+    return ok && st.first_seq + n == st.next_seq;
+}
+
+esp_err_t sd_log_bench_recovery(const char *path, const sd_log_config_t *config,
+                                uint32_t record_size, sd_log_recovery_result_t *out) {
+    if (!path || !config || !out || record_size < MIN_RECORD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    unlink(path);
+
+    sd_log_t *log = NULL;
+    esp_err_t err = sd_log_open(path, config, &log);
+    if (err != ESP_OK) {
+        return err;
+    }
+    sd_log_stats_t st;
+    sd_log_get_stats(log, &st);
+    if (record_size > st.max_record) {
+        sd_log_close(log);
+        unlink(path);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // One and a half times around the ring
+    uint8_t *rec = (uint8_t *)malloc(record_size);
+    if (!rec) {
+        sd_log_close(log);
+        unlink(path);
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t per_block = (st.max_record + RECORD_LEN_SIZE) / (record_size + RECORD_LEN_SIZE);
+    uint32_t total = per_block * st.blocks / 2 * 3;
+    int64_t t0 = esp_timer_get_time();
+    for (uint32_t seq = 1; seq <= total && err == ESP_OK; seq++) {
+        sd_log_bench_record(seq, rec, record_size);
+        err = sd_log_append(log, rec, record_size, NULL);
+    }
+    free(rec);
+    esp_err_t cerr = sd_log_close(log);
+    err = (err == ESP_OK) ? cerr : err;
+    out->fill_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    if (err == ESP_OK) {
+        err = sd_log_open(path, config, &log);
+    }
+    if (err == ESP_OK) {
+        sd_log_get_stats(log, &st);
+        out->open_us = st.open_us;
+        out->blocks = st.blocks;
+        t0 = esp_timer_get_time();
+        out->verified = verify(log, record_size, &out->records) && !st.created &&
+                        st.next_seq == total + 1 && st.first_seq > 1;
+        out->read_us = (uint32_t)(esp_timer_get_time() - t0);
+        sd_log_close(log);
+    }
+    unlink(path);
+    return err;
+}
+
+const char *sd_log_bench_method_name(sd_log_bench_method_t method) {
+    return method < SD_LOG_BENCH_METHOD_COUNT ? method_names[method] : "?";
+}
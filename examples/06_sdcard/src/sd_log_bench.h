@@ -0,0 +1,101 @@
+/**
+ * @file sd_log_bench.h
+ * @brief Ring log benchmark: records per second and recovery time
+ *
+ * Appends fixed-size records three ways, timing each append:
+ *
+ * - fopen("a") / fprintf() / fclose() per record, the usual way to log
+ *   to a file
+ * - sd_log_append() + sd_log_flush() per record: every record on the card
+ *   before the call returns
+ * - sd_log_append() alone: batched block writes, one flush at the end
+ *
+ * The recovery test fills a log until the ring has wrapped, reopens it,
+ * times the scan and reads every record back.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_io_bench.h"
+#include "sd_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How records are written
+ */
+typedef enum {
+    SD_LOG_BENCH_FPRINTF,        // fopen() / fprintf() / fclose() per record
+    SD_LOG_BENCH_SYNC_EACH,      // sd_log, flushed after every record
+    SD_LOG_BENCH_BATCHED,        // sd_log, batched
+    SD_LOG_BENCH_METHOD_COUNT,
+} sd_log_bench_method_t;
+
+/**
+ * @brief Parameters of one run
+ */
+typedef struct {
+    sd_log_bench_method_t method;
+    uint32_t records;            // Records to append
+    uint32_t record_size;        // Bytes per record
+    uint32_t budget_ms;          // Stop after this long, 0: no limit
+} sd_log_bench_params_t;
+
+/**
+ * @brief Result of the recovery test
+ */
+typedef struct {
+    uint32_t fill_us;            // Filling the log until it wrapped
+    uint32_t open_us;            // Reopening, including the scan
+    uint32_t read_us;            // Reading every record back
+    uint32_t records;            // Records in the log after reopening
+    uint32_t blocks;             // Ring blocks scanned
+    bool verified;               // Records consecutive, with the content written
+} sd_log_recovery_result_t;
+
+/**
+ * @brief Append records, timing each one
+ *
+ * The log (or text file for SD_LOG_BENCH_FPRINTF) is opened before timing
+ * starts and deleted afterwards; elapsed_us includes the final flush.
+ * iops is records per second.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid parameters
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: I/O error
+ */
+esp_err_t sd_log_bench_run(const char *path, const sd_log_bench_params_t *params,
+                           const sd_log_config_t *config, sd_io_result_t *out);
+
+/**
+ * @brief Fill a new log past wrap-around, reopen it and read it back
+ *
+ * @return
+ *    - ESP_OK: Test ran (see verified)
+ *    - ESP_ERR_INVALID_ARG: Invalid parameters
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: I/O error
+ */
+esp_err_t sd_log_bench_recovery(const char *path, const sd_log_config_t *config,
+                                uint32_t record_size, sd_log_recovery_result_t *out);
+
+/**
+ * @brief Fill `buf` with the content of record `seq`
+ */
+void sd_log_bench_record(uint32_t seq, uint8_t *buf, uint32_t size);
+
+/**
+ * @brief Short name of a method
+ */
+const char *sd_log_bench_method_name(sd_log_bench_method_t method);
+
+#ifdef __cplusplus
+}
+#endif
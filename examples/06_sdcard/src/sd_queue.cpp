@@ -0,0 +1,472 @@
+/**
+ * @file sd_queue.cpp
+ * @brief Asynchronous SD card I/O: request queue with priority lanes
+ *
+ * Jobs live in a fixed slot array. The work semaphore counts runnable
+ * steps: one per submitted job, plus one each time a READ / WRITE goes
+ * back to the queue after a chunk. A paused job keeps its FILE open.
+ */
+
+#include "sd_queue.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_queue";
+
+/**
+ * @brief Queued, paused or running job
+ */
+typedef struct {
+    bool used;
+    bool running;
+    bool started;
+    volatile bool cancel;
+    sd_job_id_t id;
+    uint32_t seq;            // Submission order within a lane
+    int64_t queued_us;
+    uint32_t wait_us;
+    uint32_t run_us;
+    size_t done;             // READ / WRITE progress
+    FILE *f;                 // Open between chunks
+    sd_job_t job;
+    char path[SD_QUEUE_PATH_LEN];
+} job_slot_t;
+
+/**
+ * @brief Completion handed to the dispatch function
+ */
+typedef struct {
+    sd_job_result_t result;
+    sd_job_done_cb_t on_done;
+} completion_t;
+
+static job_slot_t jobs[SD_QUEUE_MAX_JOBS];
+static sd_queue_stats_t stats = {};
+static sd_queue_config_t config = {};
+static SemaphoreHandle_t queue_mutex = NULL;
+static SemaphoreHandle_t work_sem = NULL;
+static sd_index_t *list_index = NULL;  // Only touched on the worker
+static sd_job_id_t next_id = 1;
+static uint32_t next_seq = 0;
+
+static const char *lane_names[SD_LANE_COUNT] = {"stream", "ui", "background"};
+static const char *op_names[SD_OP_COUNT] = {"mount", "unmount", "read", "write", "list", "call"};
+
+// ============================================================================
+// Completion
+// ============================================================================
+
+static void completion_run(void *arg) {
+    completion_t *c = (completion_t *)arg;
+    c->on_done(&c->result);
+    free(c);
+}
+
+static void complete(sd_job_done_cb_t on_done, bool on_worker, const sd_job_result_t *result) {
+    if (on_done == NULL) {
+        return;
+    }
+    if (on_worker || config.dispatch == NULL) {
+        on_done(result);
+        return;
+    }
+
+    completion_t *c = (completion_t *)malloc(sizeof(completion_t));
+    if (c == NULL) {
+        ESP_LOGE(TAG, "Out of memory, completion of job %lu lost", (unsigned long)result->id);
+        return;
+    }
+    c->result = *result;
+    c->on_done = on_done;
+    config.dispatch(completion_run, c);
+}
+
+// ============================================================================
+// Worker
+// ============================================================================
+
+/**
+ * @brief Pick the next runnable job: highest lane, then oldest
+ *
+ * UNMOUNT waits until no paused READ / WRITE holds a file open.
+ *
+ * Must be called with the queue mutex held.
+ */
+static job_slot_t *next_job(void) {
+    bool file_open = false;
+    for (int i = 0; i < SD_QUEUE_MAX_JOBS; i++) {
+        file_open |= (jobs[i].used && jobs[i].f != NULL);
+    }
+
+    job_slot_t *best = NULL;
+    for (int i = 0; i < SD_QUEUE_MAX_JOBS; i++) {
+        job_slot_t *s = &jobs[i];
+        if (!s->used || s->running) {
+            continue;
+        }
+        if (s->job.op == SD_OP_UNMOUNT && file_open) {
+            continue;  // The paused READ / WRITE is runnable and goes first
+        }
+        if (best == NULL || s->job.lane < best->job.lane ||
+            (s->job.lane == best->job.lane && (int32_t)(s->seq - best->seq) < 0)) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+static FILE *open_file(job_slot_t *slot) {
+    const sd_job_t *job = &slot->job;
+    FILE *f;
+    if (job->op == SD_OP_READ) {
+        f = fopen(slot->path, "rb");
+    } else if (job->flags & SD_JOB_CREATE) {
+        f = fopen(slot->path, "wb");
+    } else {
+        f = fopen(slot->path, "r+b");
+        if (f == NULL && errno == ENOENT) {
+            f = fopen(slot->path, "wb");
+        }
+    }
+    if (f == NULL) {
+        return NULL;
+    }
+
+    int rc = (job->op == SD_OP_WRITE && job->offset == SD_QUEUE_APPEND)
+                 ? fseek(f, 0, SEEK_END)
+                 : fseek(f, (long)job->offset, SEEK_SET);
+    if (rc != 0) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @brief Run a job, or one chunk of a READ / WRITE
+ *
+ * @return true when the job is finished (result filled in)
+ */
+static bool run_step(job_slot_t *slot, sd_job_result_t *result) {
+    const sd_job_t *job = &slot->job;
+
+    switch (job->op) {
+        case SD_OP_MOUNT:
+        case SD_OP_UNMOUNT: {
+            sd_job_fn_t fn = (job->op == SD_OP_MOUNT) ? config.mount : config.unmount;
+            result->err = fn ? fn(config.mount_arg) : ESP_ERR_NOT_SUPPORTED;
+            return true;
+        }
+
+        case SD_OP_CALL:
+            result->err = job->fn(job->fn_arg);
+            return true;
+
+        case SD_OP_LIST:
+            result->err = list_index
+                              ? sd_index_list(list_index, slot->path, job->offset,
+                                              (sd_index_entry_t *)job->buf, job->len,
+                                              &result->count, &result->dir)
+                              : ESP_ERR_INVALID_STATE;
+            return true;
+
+        case SD_OP_READ:
+        case SD_OP_WRITE:
+            break;
+
+        default:
+            result->err = ESP_ERR_INVALID_ARG;
+            return true;
+    }
+
+    if (slot->f == NULL) {
+        slot->f = open_file(slot);
+        if (slot->f == NULL) {
+            result->err = (job->op == SD_OP_READ && errno == ENOENT) ? ESP_ERR_NOT_FOUND
+                                                                      : ESP_FAIL;
+            return true;
+        }
+    }
+
+    size_t chunk = job->len - slot->done;
+    if (config.max_chunk && chunk > config.max_chunk) {
+        chunk = config.max_chunk;
+    }
+    uint8_t *p = (uint8_t *)job->buf + slot->done;
+    size_t n = (job->op == SD_OP_READ) ? fread(p, 1, chunk, slot->f)
+                                       : fwrite(p, 1, chunk, slot->f);
+    slot->done += n;
+
+    bool finished = (slot->done == job->len) || (n < chunk);
+    result->err = ESP_OK;
+    if (n < chunk && (job->op == SD_OP_WRITE || ferror(slot->f))) {
+        result->err = ESP_FAIL;  // A short read is the end of the file
+    }
+    if (!finished) {
+        return false;
+    }
+
+    if (result->err == ESP_OK && job->op == SD_OP_WRITE && (job->flags & SD_JOB_SYNC)) {
+        if (fflush(slot->f) != 0 || fsync(fileno(slot->f)) != 0) {
+            result->err = ESP_FAIL;
+        }
+    }
+    if (fclose(slot->f) != 0 && result->err == ESP_OK) {
+        result->err = ESP_FAIL;
+    }
+    slot->f = NULL;
+    result->bytes = slot->done;
+    return true;
+}
+
+static void worker_task(void *arg) {
+    job_slot_t *paused = NULL;  // READ / WRITE whose last chunk just ran
+
+    while (1) {
+        xSemaphoreTake(work_sem, portMAX_DELAY);
+
+        xSemaphoreTake(queue_mutex, portMAX_DELAY);
+        job_slot_t *slot = next_job();
+        if (slot == NULL) {
+            // The job was cancelled before the worker got to it
+            xSemaphoreGive(queue_mutex);
+            continue;
+        }
+        if (paused != NULL && slot != paused) {
+            stats.preempted++;  // Another job goes before the paused one
+        }
+        paused = NULL;
+        sd_lane_stats_t *lane = &stats.lanes[slot->job.lane];
+        int64_t start = esp_timer_get_time();
+        if (!slot->started) {
+            slot->started = true;
+            slot->wait_us = (uint32_t)(start - slot->queued_us);
+            lane->started++;
+            lane->total_wait_us += slot->wait_us;
+            if (slot->wait_us > lane->max_wait_us) {
+                lane->max_wait_us = slot->wait_us;
+            }
+        }
+        slot->running = true;
+        lane->pending--;
+        bool cancel = slot->cancel;
+        xSemaphoreGive(queue_mutex);
+
+        sd_job_result_t result = {};
+        bool finished = true;
+        if (cancel) {
+            if (slot->f) {
+                fclose(slot->f);
+                slot->f = NULL;
+            }
+            result.bytes = slot->done;
+        } else {
+            finished = run_step(slot, &result);
+        }
+        slot->run_us += (uint32_t)(esp_timer_get_time() - start);
+
+        xSemaphoreTake(queue_mutex, portMAX_DELAY);
+        slot->running = false;
+        if (!finished) {
+            // Back to the queue; a higher lane goes first
+            paused = slot;
+            lane->pending++;
+            xSemaphoreGive(queue_mutex);
+            xSemaphoreGive(work_sem);
+            continue;
+        }
+
+        result.id = slot->id;
+        result.op = slot->job.op;
+        result.lane = slot->job.lane;
+        result.cancelled = cancel;
+        if (cancel) {
+            result.err = ESP_FAIL;
+        }
+        result.wait_us = slot->wait_us;
+        result.run_us = slot->run_us;
+        result.ctx = slot->job.ctx;
+
+        sd_op_stats_t *op = &stats.ops[slot->job.op];
+        op->count++;
+        op->total_us += slot->run_us;
+        op->bytes += result.bytes;
+        if (slot->run_us > op->max_us) {
+            op->max_us = slot->run_us;
+        }
+        if (cancel) {
+            lane->cancelled++;
+        } else if (result.err != ESP_OK) {
+            lane->failed++;
+            op->errors++;
+        } else {
+            lane->completed++;
+        }
+
+        sd_job_done_cb_t on_done = slot->job.on_done;
+        bool on_worker = slot->job.done_on_worker;
+        memset(slot, 0, sizeof(*slot));
+        xSemaphoreGive(queue_mutex);
+
+        ESP_LOGD(TAG, "Job %lu %s/%s: %s (waited %lu us, ran %lu us)", (unsigned long)result.id,
+                 lane_names[result.lane], op_names[result.op], esp_err_to_name(result.err),
+                 (unsigned long)result.wait_us, (unsigned long)result.run_us);
+        complete(on_done, on_worker, &result);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_queue_init(const sd_queue_config_t *cfg) {
+    if (cfg == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (queue_mutex != NULL) {
+        return ESP_OK;  // Already running
+    }
+
+    queue_mutex = xSemaphoreCreateMutex();
+    work_sem = xSemaphoreCreateCounting(SD_QUEUE_MAX_JOBS, 0);
+    if (queue_mutex == NULL || work_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    config = *cfg;
+
+    if (xTaskCreate(worker_task, "sd_worker", config.stack_size, NULL, config.task_priority,
+                    NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "SD worker started (chunk %u bytes)", (unsigned)config.max_chunk);
+    return ESP_OK;
+}
+
+esp_err_t sd_queue_submit(const sd_job_t *job, sd_job_id_t *id) {
+    if (queue_mutex == NULL || job == NULL || job->op >= SD_OP_COUNT ||
+        job->lane >= SD_LANE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool needs_path = (job->op == SD_OP_READ || job->op == SD_OP_WRITE || job->op == SD_OP_LIST);
+    if ((needs_path && (job->path == NULL || strlen(job->path) >= SD_QUEUE_PATH_LEN)) ||
+        ((job->op == SD_OP_READ || job->op == SD_OP_WRITE || job->op == SD_OP_LIST) &&
+         job->len && job->buf == NULL) ||
+        (job->op == SD_OP_CALL && job->fn == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    job_slot_t *slot = NULL;
+    for (int i = 0; i < SD_QUEUE_MAX_JOBS; i++) {
+        if (!jobs[i].used) {
+            slot = &jobs[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        xSemaphoreGive(queue_mutex);
+        ESP_LOGW(TAG, "Queue full, rejecting %s", op_names[job->op]);
+        return ESP_ERR_NO_MEM;
+    }
+
+    slot->used = true;
+    slot->id = next_id++;
+    if (next_id == 0) {
+        next_id = 1;
+    }
+    slot->seq = next_seq++;
+    slot->queued_us = esp_timer_get_time();
+    slot->job = *job;
+    if (needs_path) {
+        strcpy(slot->path, job->path);
+    }
+
+    sd_lane_stats_t *lane = &stats.lanes[job->lane];
+    lane->submitted++;
+    lane->pending++;
+    if (lane->pending > lane->max_pending) {
+        lane->max_pending = lane->pending;
+    }
+    if (id != NULL) {
+        *id = slot->id;
+    }
+    xSemaphoreGive(queue_mutex);
+
+    xSemaphoreGive(work_sem);
+    return ESP_OK;
+}
+
+esp_err_t sd_queue_cancel(sd_job_id_t id) {
+    if (queue_mutex == NULL || id == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    job_slot_t *slot = NULL;
+    for (int i = 0; i < SD_QUEUE_MAX_JOBS; i++) {
+        if (jobs[i].used && jobs[i].id == id) {
+            slot = &jobs[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        xSemaphoreGive(queue_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (slot->started) {
+        // Running or paused with a file open: the worker finishes it
+        slot->cancel = true;
+        xSemaphoreGive(queue_mutex);
+        return ESP_OK;
+    }
+
+    // Still pending: drop it now (its work_sem count finds no job)
+    sd_job_result_t result = {};
+    result.id = id;
+    result.op = slot->job.op;
+    result.lane = slot->job.lane;
+    result.err = ESP_FAIL;
+    result.cancelled = true;
+    result.wait_us = (uint32_t)(esp_timer_get_time() - slot->queued_us);
+    result.ctx = slot->job.ctx;
+    sd_job_done_cb_t on_done = slot->job.on_done;
+    bool on_worker = slot->job.done_on_worker;
+    stats.lanes[slot->job.lane].pending--;
+    stats.lanes[slot->job.lane].cancelled++;
+    memset(slot, 0, sizeof(*slot));
+    xSemaphoreGive(queue_mutex);
+
+    complete(on_done, on_worker, &result);
+    return ESP_OK;
+}
+
+void sd_queue_set_index(sd_index_t *idx) {
+    list_index = idx;
+}
+
+void sd_queue_get_stats(sd_queue_stats_t *out) {
+    if (queue_mutex == NULL || out == NULL) {
+        return;
+    }
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(queue_mutex);
+}
+
+const char *sd_queue_lane_name(sd_lane_t lane) {
+    return lane < SD_LANE_COUNT ? lane_names[lane] : "?";
+}
+
+const char *sd_queue_op_name(sd_op_t op) {
+    return op < SD_OP_COUNT ? op_names[op] : "?";
+}
@@ -0,0 +1,240 @@
+/**
+ * @file sd_queue.h
+ * @brief Asynchronous SD card I/O: request queue with priority lanes
+ *
+ * All card access goes through one worker task, so an LVGL callback only
+ * submits a request and returns; a slow card no longer stalls rendering.
+ * One worker matches the hardware: there is one SDMMC bus, and FatFs
+ * serializes a volume anyway.
+ *
+ * Pending requests are served by lane (STREAM before UI before
+ * BACKGROUND), in submission order within a lane. READ and WRITE are
+ * carried out in chunks of at most max_chunk bytes; between chunks the
+ * worker switches to a request of a higher lane if one is waiting, so a
+ * long background write delays an audio read by one chunk at most. MOUNT,
+ * LIST and CALL run to completion.
+ *
+ * Completion callbacks are handed to a dispatch function (e.g. one using
+ * lv_async_call) so they can update widgets directly, unless the request
+ * asks for its callback on the worker.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum number of pending + running requests
+#define SD_QUEUE_MAX_JOBS   24
+
+// Longest path accepted (copied on submit)
+#define SD_QUEUE_PATH_LEN   128
+
+// WRITE offset: append to the end of the file
+#define SD_QUEUE_APPEND     UINT32_MAX
+
+/**
+ * @brief Priority lane, highest first
+ */
+typedef enum {
+    SD_LANE_STREAM,          // Audio and other deadline-bound streaming
+    SD_LANE_UI,              // Listings and actions the user waits for
+    SD_LANE_BACKGROUND,      // Benchmarks, indexing, logs
+    SD_LANE_COUNT,
+} sd_lane_t;
+
+/**
+ * @brief Operation
+ */
+typedef enum {
+    SD_OP_MOUNT,             // Runs config.mount
+    SD_OP_UNMOUNT,           // Runs config.unmount, after READ / WRITE in progress
+    SD_OP_READ,              // len bytes at offset into buf
+    SD_OP_WRITE,             // len bytes from buf at offset (or SD_QUEUE_APPEND)
+    SD_OP_LIST,              // Page of a directory from the index into buf
+    SD_OP_CALL,              // fn(fn_arg) on the worker
+    SD_OP_COUNT,
+} sd_op_t;
+
+// WRITE flags
+#define SD_JOB_CREATE       (1 << 0)  // Create or truncate the file first
+#define SD_JOB_SYNC         (1 << 1)  // fsync() before completing
+
+// Request handle, 0 is never a valid id
+typedef uint32_t sd_job_id_t;
+
+/**
+ * @brief Completion report
+ */
+typedef struct {
+    sd_job_id_t id;
+    sd_op_t op;
+    sd_lane_t lane;
+    esp_err_t err;           // Result (ESP_FAIL if cancelled)
+    bool cancelled;
+    size_t bytes;            // READ / WRITE: bytes transferred (short at end of file)
+    size_t count;            // LIST: entries copied
+    sd_index_dir_info_t dir; // LIST: listing information
+    uint32_t wait_us;        // Submission to first start
+    uint32_t run_us;         // Time spent executing (all chunks)
+    void *ctx;               // Job context
+} sd_job_result_t;
+
+/**
+ * @brief Completion callback, called exactly once per submitted job
+ */
+typedef void (*sd_job_done_cb_t)(const sd_job_result_t *result);
+
+/**
+ * @brief Function run by SD_OP_CALL, MOUNT and UNMOUNT
+ */
+typedef esp_err_t (*sd_job_fn_t)(void *arg);
+
+/**
+ * @brief A request
+ *
+ * The path is copied on submit. buf must stay valid until the completion
+ * callback has run.
+ */
+typedef struct {
+    sd_op_t op;
+    sd_lane_t lane;
+    const char *path;        // READ / WRITE / LIST
+    uint32_t offset;         // READ / WRITE: file offset; LIST: first entry
+    void *buf;               // READ: destination; WRITE: source; LIST: sd_index_entry_t[]
+    size_t len;              // READ / WRITE: bytes; LIST: entries
+    uint8_t flags;           // SD_JOB_*
+    sd_job_fn_t fn;          // CALL
+    void *fn_arg;
+    sd_job_done_cb_t on_done; // Can be NULL
+    bool done_on_worker;     // Run on_done on the worker instead of dispatching it
+    void *ctx;
+} sd_job_t;
+
+/**
+ * @brief Runs fn(arg) on the thread that should see completions
+ */
+typedef void (*sd_queue_dispatch_t)(void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Queue configuration
+ */
+typedef struct {
+    int task_priority;
+    uint32_t stack_size;
+    size_t max_chunk;            // READ / WRITE chunk, 0: whole request at once
+    sd_job_fn_t mount;           // SD_OP_MOUNT
+    sd_job_fn_t unmount;         // SD_OP_UNMOUNT
+    void *mount_arg;
+    sd_queue_dispatch_t dispatch; // NULL: completions run on the worker
+} sd_queue_config_t;
+
+#define SD_QUEUE_CONFIG_DEFAULT() {  \
+    .task_priority = 6,              \
+    .stack_size = 8192,              \
+    .max_chunk = 32 * 1024,          \
+    .mount = NULL,                   \
+    .unmount = NULL,                 \
+    .mount_arg = NULL,               \
+    .dispatch = NULL,                \
+}
+
+/**
+ * @brief Per-lane queue metrics
+ */
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t cancelled;
+    uint8_t pending;         // Current depth
+    uint8_t max_pending;     // High-water mark
+    uint32_t started;
+    uint64_t total_wait_us;  // Sum of queue wait over started jobs
+    uint32_t max_wait_us;
+} sd_lane_stats_t;
+
+/**
+ * @brief Per-operation timing
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t errors;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint64_t bytes;
+} sd_op_stats_t;
+
+/**
+ * @brief Queue metrics
+ */
+typedef struct {
+    sd_lane_stats_t lanes[SD_LANE_COUNT];
+    sd_op_stats_t ops[SD_OP_COUNT];
+    uint32_t preempted;      // READ / WRITE paused for a higher lane
+} sd_queue_stats_t;
+
+/**
+ * @brief Start the worker task
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing configuration
+ *    - ESP_ERR_NO_MEM: Failed to create the task or semaphores
+ */
+esp_err_t sd_queue_init(const sd_queue_config_t *config);
+
+/**
+ * @brief Queue a request
+ *
+ * @param job: Request and completion callback
+ * @param id: Receives the job id, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Queued
+ *    - ESP_ERR_INVALID_ARG: Invalid request or too long path
+ *    - ESP_ERR_NO_MEM: Queue is full
+ */
+esp_err_t sd_queue_submit(const sd_job_t *job, sd_job_id_t *id);
+
+/**
+ * @brief Cancel a request
+ *
+ * A pending request is removed immediately; a READ / WRITE in progress
+ * stops after the current chunk. Its completion reports cancelled.
+ *
+ * @return
+ *    - ESP_OK: Cancellation requested
+ *    - ESP_ERR_NOT_FOUND: Unknown or already completed job
+ */
+esp_err_t sd_queue_cancel(sd_job_id_t id);
+
+/**
+ * @brief Set the directory index used by SD_OP_LIST
+ *
+ * Called by the mount / unmount functions, which run on the worker, so a
+ * LIST never sees an index being destroyed.
+ */
+void sd_queue_set_index(sd_index_t *idx);
+
+/**
+ * @brief Get queue metrics
+ */
+void sd_queue_get_stats(sd_queue_stats_t *out);
+
+/**
+ * @brief Names for logs and the UI
+ */
+const char *sd_queue_lane_name(sd_lane_t lane);
+const char *sd_queue_op_name(sd_op_t op);
+
+#ifdef __cplusplus
+}
+#endif
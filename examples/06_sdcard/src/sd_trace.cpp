@@ -0,0 +1,321 @@
+/**
+ * @file sd_trace.cpp
+ * @brief SD card latency tracing and health counters
+ *
+ * The traced driver mirrors the SDMMC diskio driver of ESP-IDF
+ * (diskio_sdmmc.c): the same sdmmc_*_sectors() calls and ioctl answers,
+ * wrapped in a timer and a retry loop. One card is traced at a time.
+ */
+
+#include "sd_trace.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#ifdef ESP_PLATFORM
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
+#include "ff.h"
+#include "nvs.h"
+#endif
+
+static const char *TAG = "sd_trace";
+
+static struct {
+    sd_trace_config_t config;
+    SemaphoreHandle_t lock;
+    sd_trace_stats_t stats;
+    uint64_t written_base;       // Bytes written to the card before the mark
+    uint64_t written_mark;       // Write bytes in the counters when the card was attached
+    bool attached;
+    uint32_t serial;             // CID serial of the traced card
+#ifdef ESP_PLATFORM
+    sdmmc_card_t *card;
+#endif
+} s;
+
+static uint64_t write_bytes(void) {
+    return s.stats.ops[SD_TRACE_WRITE].sectors * s.stats.sector_size;
+}
+
+const char *sd_trace_op_name(sd_trace_op_t op) {
+    static const char *names[] = {"read", "write", "erase", "sync"};
+    return op < SD_TRACE_OP_COUNT ? names[op] : "?";
+}
+
+esp_err_t sd_trace_init(const sd_trace_config_t *config) {
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s.lock) {
+        return ESP_OK;
+    }
+    s.lock = xSemaphoreCreateMutex();
+    if (!s.lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    s.config = *config;
+    s.stats.sector_size = 512;
+    s.stats.since_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    return ESP_OK;
+}
+
+void sd_trace_record(sd_trace_op_t op, uint32_t sector, uint32_t count, uint32_t us,
+                     uint32_t retries, bool ok) {
+    if (!s.lock || op >= SD_TRACE_OP_COUNT) {
+        return;
+    }
+    bool slow = us >= s.config.slow_us;
+
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    sd_trace_op_stats_t *o = &s.stats.ops[op];
+    o->count++;
+    o->errors += !ok;
+    o->retries += retries;
+    o->slow += slow;
+    o->sectors += ok ? count : 0;
+    o->total_us += us;
+    if (us > o->max_us) {
+        o->max_us = us;
+    }
+    int b = 0;
+    while (b < SD_TRACE_HIST_BUCKETS - 1 && us >= SD_TRACE_HIST_LIMIT_US(b)) {
+        b++;
+    }
+    o->hist[b]++;
+
+    if (slow) {
+        memmove(&s.stats.slow[1], &s.stats.slow[0],
+                (SD_TRACE_SLOW_MAX - 1) * sizeof(sd_trace_slow_t));
+        sd_trace_slow_t *e = &s.stats.slow[0];
+        e->op = op;
+        e->failed = !ok;
+        e->sector = sector;
+        e->count = count;
+        e->us = us;
+        e->at_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        if (s.stats.n_slow < SD_TRACE_SLOW_MAX) {
+            s.stats.n_slow++;
+        }
+    }
+    xSemaphoreGive(s.lock);
+
+    if (slow || !ok || retries) {
+        ESP_LOGW(TAG, "%s of %lu sectors at %lu: %lu us, %lu retries%s", sd_trace_op_name(op),
+                 (unsigned long)count, (unsigned long)sector, (unsigned long)us,
+                 (unsigned long)retries, ok ? "" : ", failed");
+    }
+}
+
+void sd_trace_get_stats(sd_trace_stats_t *out) {
+    if (!s.lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    *out = s.stats;
+    out->card_written = s.written_base + (s.attached ? write_bytes() - s.written_mark : 0);
+    xSemaphoreGive(s.lock);
+}
+
+void sd_trace_reset(void) {
+    if (!s.lock) {
+        return;
+    }
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    if (s.attached) {
+        s.written_base += write_bytes() - s.written_mark;
+        s.written_mark = 0;
+    }
+    memset(s.stats.ops, 0, sizeof(s.stats.ops));
+    memset(s.stats.slow, 0, sizeof(s.stats.slow));
+    s.stats.n_slow = 0;
+    s.stats.since_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    xSemaphoreGive(s.lock);
+}
+
+void sd_trace_write_csv(FILE *f, const sd_trace_stats_t *st) {
+    fprintf(f, "op,count,errors,retries,slow,bytes,avg_us,max_us");
+    for (int i = 0; i < SD_TRACE_HIST_BUCKETS - 1; i++) {
+        fprintf(f, ",lt_%lu_us", SD_TRACE_HIST_LIMIT_US(i));
+    }
+    fprintf(f, ",ge_%lu_us\n", SD_TRACE_HIST_LIMIT_US(SD_TRACE_HIST_BUCKETS - 2));
+    for (int op = 0; op < SD_TRACE_OP_COUNT; op++) {
+        const sd_trace_op_stats_t *o = &st->ops[op];
+        fprintf(f, "%s,%lu,%lu,%lu,%lu,%llu,%lu,%lu", sd_trace_op_name((sd_trace_op_t)op),
+                (unsigned long)o->count, (unsigned long)o->errors, (unsigned long)o->retries,
+                (unsigned long)o->slow, (unsigned long long)(o->sectors * st->sector_size),
+                (unsigned long)(o->count ? o->total_us / o->count : 0),
+                (unsigned long)o->max_us);
+        for (int i = 0; i < SD_TRACE_HIST_BUCKETS; i++) {
+            fprintf(f, ",%lu", (unsigned long)o->hist[i]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "\nslow_op,sector,sectors,us,at_ms,failed\n");
+    for (uint32_t i = 0; i < st->n_slow; i++) {
+        const sd_trace_slow_t *e = &st->slow[i];
+        fprintf(f, "%s,%lu,%lu,%lu,%lu,%d\n", sd_trace_op_name((sd_trace_op_t)e->op),
+                (unsigned long)e->sector, (unsigned long)e->count, (unsigned long)e->us,
+                (unsigned long)e->at_ms, e->failed ? 1 : 0);
+    }
+}
+
+#ifdef ESP_PLATFORM
+// ============================================================================
+// Traced diskio driver
+// ============================================================================
+
+static DSTATUS trace_disk_init(unsigned char pdrv) {
+    return s.card ? 0 : STA_NOINIT;
+}
+
+static DSTATUS trace_disk_status(unsigned char pdrv) {
+    return s.card ? 0 : STA_NOINIT;
+}
+
+static DRESULT trace_disk_read(unsigned char pdrv, unsigned char *buff, uint32_t sector,
+                               unsigned count) {
+    int64_t start = esp_timer_get_time();
+    uint32_t retries = 0;
+    esp_err_t err;
+    while ((err = sdmmc_read_sectors(s.card, buff, sector, count)) != ESP_OK &&
+           retries < s.config.max_retries) {
+        retries++;
+    }
+    sd_trace_record(SD_TRACE_READ, sector, count, (uint32_t)(esp_timer_get_time() - start),
+                    retries, err == ESP_OK);
+    return err == ESP_OK ? RES_OK : RES_ERROR;
+}
+
+static DRESULT trace_disk_write(unsigned char pdrv, const unsigned char *buff, uint32_t sector,
+                                unsigned count) {
+    int64_t start = esp_timer_get_time();
+    uint32_t retries = 0;
+    esp_err_t err;
+    while ((err = sdmmc_write_sectors(s.card, buff, sector, count)) != ESP_OK &&
+           retries < s.config.max_retries) {
+        retries++;
+    }
+    sd_trace_record(SD_TRACE_WRITE, sector, count, (uint32_t)(esp_timer_get_time() - start),
+                    retries, err == ESP_OK);
+    return err == ESP_OK ? RES_OK : RES_ERROR;
+}
+
+static DRESULT trace_disk_ioctl(unsigned char pdrv, unsigned char cmd, void *buff) {
+    switch (cmd) {
+        case CTRL_SYNC:
+            // Writes are complete when sdmmc_write_sectors() returns, so
+            // there is nothing to wait for; counted to see how often FatFs syncs
+            sd_trace_record(SD_TRACE_SYNC, 0, 0, 0, 0, true);
+            return RES_OK;
+        case GET_SECTOR_COUNT:
+            *((DWORD *)buff) = s.card->csd.capacity;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *((WORD *)buff) = s.card->csd.sector_size;
+            return RES_OK;
+#if FF_USE_TRIM
+        case CTRL_TRIM: {
+            if (sdmmc_can_trim(s.card) != ESP_OK) {
+                return RES_PARERR;
+            }
+            uint32_t first = ((DWORD *)buff)[0];
+            uint32_t count = ((DWORD *)buff)[1] - first + 1;
+            int64_t start = esp_timer_get_time();
+            esp_err_t err = sdmmc_erase_sectors(s.card, first, count, SDMMC_TRIM_ARG);
+            sd_trace_record(SD_TRACE_ERASE, first, count,
+                            (uint32_t)(esp_timer_get_time() - start), 0, err == ESP_OK);
+            return err == ESP_OK ? RES_OK : RES_ERROR;
+        }
+#endif
+    }
+    return RES_ERROR;
+}
+
+// ============================================================================
+// Bytes written per card
+// ============================================================================
+
+static void wear_key(uint32_t serial, char *key) {
+    snprintf(key, 16, "w%08lx", (unsigned long)serial);
+}
+
+static uint64_t wear_load(uint32_t serial) {
+    uint64_t value = 0;
+    nvs_handle_t nvs;
+    if (s.config.nvs_namespace && nvs_open(s.config.nvs_namespace, NVS_READONLY, &nvs) == ESP_OK) {
+        char key[16];
+        wear_key(serial, key);
+        nvs_get_u64(nvs, key, &value);
+        nvs_close(nvs);
+    }
+    return value;
+}
+
+static void wear_save(uint32_t serial, uint64_t value) {
+    nvs_handle_t nvs;
+    if (s.config.nvs_namespace && nvs_open(s.config.nvs_namespace, NVS_READWRITE, &nvs) == ESP_OK) {
+        char key[16];
+        wear_key(serial, key);
+        if (nvs_set_u64(nvs, key, value) == ESP_OK) {
+            nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+}
+
+esp_err_t sd_trace_attach(sdmmc_card_t *card) {
+    BYTE pdrv = card ? ff_diskio_get_pdrv_card(card) : 0xFF;
+    if (!s.lock || pdrv == 0xFF) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint64_t written = wear_load(card->cid.serial);
+
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    s.card = card;
+    s.serial = card->cid.serial;
+    s.stats.sector_size = card->csd.sector_size;
+    s.stats.capacity = (uint64_t)card->csd.capacity * card->csd.sector_size;
+    s.written_base = written;
+    s.written_mark = write_bytes();
+    s.attached = true;
+    xSemaphoreGive(s.lock);
+
+    static const ff_diskio_impl_t impl = {
+        .init = trace_disk_init,
+        .status = trace_disk_status,
+        .read = trace_disk_read,
+        .write = trace_disk_write,
+        .ioctl = trace_disk_ioctl,
+    };
+    ff_diskio_register(pdrv, &impl);
+    ESP_LOGI(TAG, "Tracing drive %u, %llu bytes written to this card so far", (unsigned)pdrv,
+             (unsigned long long)written);
+    return ESP_OK;
+}
+
+void sd_trace_detach(void) {
+    if (!s.lock) {
+        return;
+    }
+    xSemaphoreTake(s.lock, portMAX_DELAY);
+    bool attached = s.attached;
+    uint32_t serial = s.serial;
+    if (attached) {
+        s.written_base += write_bytes() - s.written_mark;
+        s.attached = false;
+    }
+    uint64_t written = s.written_base;
+    s.stats.capacity = 0;
+    xSemaphoreGive(s.lock);
+
+    if (attached) {
+        wear_save(serial, written);
+    }
+}
+#endif
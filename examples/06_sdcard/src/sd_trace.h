@@ -0,0 +1,170 @@
+/**
+ * @file sd_trace.h
+ * @brief SD card latency tracing and health counters
+ *
+ * Every sector command FatFs sends to the card is timed: the trace
+ * replaces the SDMMC diskio driver of the mounted drive with one that
+ * calls the same sdmmc_* functions and records each call.
+ *
+ * - Per operation (read, write, erase, sync): count, errors, sectors,
+ *   average and maximum latency, and a log2 latency histogram
+ * - Slow operations (above slow_us) are counted, logged and kept in a
+ *   small ring with sector, size and time, so a UI stall can be matched
+ *   to the card command behind it
+ * - A failed command is retried up to max_retries times; retries are
+ *   counted per operation
+ * - Bytes written are kept per card (by CID serial) in NVS across
+ *   mounts and reboots, as a wear estimate in full-card writes
+ *
+ * Commands issued outside FatFs (card detection, CMD13 polling) are not
+ * seen.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef ESP_PLATFORM
+#include "sdmmc_cmd.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Latency histogram: bucket i < last counts latencies below SD_TRACE_HIST_LIMIT_US(i)
+#define SD_TRACE_HIST_BUCKETS   15
+#define SD_TRACE_HIST_LIMIT_US(i) (64UL << (i))
+
+// Slow operations kept
+#define SD_TRACE_SLOW_MAX       8
+
+/**
+ * @brief Traced operation
+ */
+typedef enum {
+    SD_TRACE_READ,
+    SD_TRACE_WRITE,
+    SD_TRACE_ERASE,          // TRIM of freed clusters
+    SD_TRACE_SYNC,
+    SD_TRACE_OP_COUNT,
+} sd_trace_op_t;
+
+/**
+ * @brief Counters of one operation
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t errors;         // Failed after all retries
+    uint32_t retries;
+    uint32_t slow;           // Above slow_us
+    uint64_t sectors;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t hist[SD_TRACE_HIST_BUCKETS];
+} sd_trace_op_stats_t;
+
+/**
+ * @brief One slow operation
+ */
+typedef struct {
+    uint8_t op;              // sd_trace_op_t
+    bool failed;
+    uint32_t sector;
+    uint32_t count;          // Sectors
+    uint32_t us;
+    uint32_t at_ms;          // Since boot
+} sd_trace_slow_t;
+
+/**
+ * @brief Accumulated statistics
+ */
+typedef struct {
+    sd_trace_op_stats_t ops[SD_TRACE_OP_COUNT];
+    sd_trace_slow_t slow[SD_TRACE_SLOW_MAX];   // Newest first
+    uint32_t n_slow;
+    uint32_t sector_size;
+    uint64_t capacity;       // Bytes of the traced card, 0 if none
+    uint64_t card_written;   // Bytes written to this card, all sessions (NVS)
+    uint32_t since_ms;       // Counters started (boot or sd_trace_reset())
+} sd_trace_stats_t;
+
+/**
+ * @brief Trace configuration
+ */
+typedef struct {
+    uint32_t slow_us;            // Slow operation threshold
+    uint8_t max_retries;         // Extra attempts of a failed command
+    const char *nvs_namespace;   // Bytes written per card; NULL: not kept
+} sd_trace_config_t;
+
+#define SD_TRACE_CONFIG_DEFAULT() {     \
+    .slow_us = 50000,                   \
+    .max_retries = 2,                   \
+    .nvs_namespace = "sd_trace",        \
+}
+
+/**
+ * @brief Set up the counters (once)
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing configuration
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t sd_trace_init(const sd_trace_config_t *config);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Trace the FatFs drive of a mounted card
+ *
+ * Call after mounting, while no file I/O is in flight. Unmounting
+ * unregisters the drive and with it the trace; call sd_trace_detach()
+ * before, to save the bytes written.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_STATE: Not initialized, or the card has no drive
+ */
+esp_err_t sd_trace_attach(sdmmc_card_t *card);
+
+/**
+ * @brief Save the bytes written of the card and stop tracing it
+ */
+void sd_trace_detach(void);
+#endif
+
+/**
+ * @brief Record one operation
+ *
+ * Called by the traced driver; can also be called by other layers.
+ */
+void sd_trace_record(sd_trace_op_t op, uint32_t sector, uint32_t count, uint32_t us,
+                     uint32_t retries, bool ok);
+
+/**
+ * @brief Get accumulated statistics
+ */
+void sd_trace_get_stats(sd_trace_stats_t *out);
+
+/**
+ * @brief Clear the counters (not the bytes written per card)
+ */
+void sd_trace_reset(void);
+
+/**
+ * @brief Write the counters as CSV: one line per operation, then the slow operations
+ */
+void sd_trace_write_csv(FILE *f, const sd_trace_stats_t *stats);
+
+/**
+ * @brief Short name of an operation
+ */
+const char *sd_trace_op_name(sd_trace_op_t op);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,277 @@
+/**
+ * @file sd_writer.cpp
+ * @brief Preallocated, cluster-aligned file writer for continuous recording
+ */
+
+#include "sd_writer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#ifdef ESP_PLATFORM
+#include "ff.h"
+#endif
+
+static const char *TAG = "sd_writer";
+
+#define BUFFER_ALIGN     64         // Cache line, for DMA straight from the buffer
+#define PATH_MAX_LEN     256
+#define DEFAULT_CLUSTER  (32 * 1024)
+
+struct sd_writer {
+    bool fatfs;
+#ifdef ESP_PLATFORM
+    FIL fil;
+#endif
+    int fd;
+    uint8_t *buf;
+    uint32_t fill;
+    uint64_t written;            // Bytes on the card
+    esp_err_t err;               // First write error, sticky
+    sd_writer_stats_t stats;
+};
+
+// ============================================================================
+// Backends
+// ============================================================================
+
+#ifdef ESP_PLATFORM
+static esp_err_t open_fatfs(sd_writer_t *w, const char *fpath, uint32_t reserve) {
+    FRESULT fr = f_open(&w->fil, fpath, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK) {
+        ESP_LOGE(TAG, "f_open(%s): %d", fpath, fr);
+        return ESP_FAIL;
+    }
+
+    FATFS *fs = w->fil.obj.fs;
+#if FF_MAX_SS == FF_MIN_SS
+    w->stats.cluster_size = (uint32_t)fs->csize * FF_MAX_SS;
+#else
+    w->stats.cluster_size = (uint32_t)fs->csize * fs->ssize;
+#endif
+
+#if FF_USE_EXPAND
+    if (reserve) {
+        uint64_t size = (reserve + w->stats.cluster_size - 1) / w->stats.cluster_size *
+                        (uint64_t)w->stats.cluster_size;
+        fr = f_expand(&w->fil, (FSIZE_t)size, 1);
+        if (fr == FR_OK) {
+            // Record the allocation, so a crash does not leave lost clusters
+            f_sync(&w->fil);
+            w->stats.reserved = size;
+            w->stats.contiguous = true;
+        } else {
+            ESP_LOGW(TAG, "No contiguous %lu bytes free (%d), allocating while writing",
+                     (unsigned long)size, fr);
+        }
+    }
+#else
+    (void)reserve;
+    ESP_LOGW(TAG, "FF_USE_EXPAND is off, allocating while writing");
+#endif
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t open_posix(sd_writer_t *w, const char *path, uint32_t reserve) {
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        ESP_LOGE(TAG, "open(%s) failed", path);
+        return ESP_FAIL;
+    }
+
+    struct stat st;
+    w->stats.cluster_size = (fstat(w->fd, &st) == 0 && st.st_blksize > 0)
+                                ? (uint32_t)st.st_blksize
+                                : DEFAULT_CLUSTER;
+#ifdef __linux__
+    if (reserve && posix_fallocate(w->fd, 0, reserve) == 0) {
+        w->stats.reserved = reserve;
+    }
+#else
+    (void)reserve;
+#endif
+    return ESP_OK;
+}
+
+static esp_err_t write_out(sd_writer_t *w, const uint8_t *data, uint32_t len) {
+    int64_t t0 = esp_timer_get_time();
+    bool ok;
+#ifdef ESP_PLATFORM
+    if (w->fatfs) {
+        UINT done = 0;
+        ok = (f_write(&w->fil, data, len, &done) == FR_OK && done == len);
+    } else
+#endif
+    {
+        ok = (write(w->fd, data, len) == (ssize_t)len);
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+
+    w->stats.flushes++;
+    w->stats.flush_total_us += us;
+    if (us > w->stats.flush_max_us) {
+        w->stats.flush_max_us = us;
+    }
+    if (w->written + len > w->stats.reserved) {
+        uint64_t from = w->written > w->stats.reserved ? w->written : w->stats.reserved;
+        w->stats.overflow_bytes += w->written + len - from;
+    }
+    w->written += len;
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Write of %lu bytes at %llu failed", (unsigned long)len,
+                 (unsigned long long)(w->written - len));
+        w->err = ESP_FAIL;
+    }
+    return w->err;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t sd_writer_open(const char *path, const sd_writer_config_t *config, sd_writer_t **out) {
+    if (!path || !config || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    // FatFs path: the drive plus the path below the mount point
+    bool fatfs = false;
+#ifdef ESP_PLATFORM
+    char fpath[PATH_MAX_LEN + 8];
+    if (config->fatfs_drive) {
+        size_t mlen = config->mount_point ? strlen(config->mount_point) : 0;
+        if (mlen == 0 || strncmp(path, config->mount_point, mlen) != 0 || path[mlen] != '/') {
+            return ESP_ERR_INVALID_ARG;
+        }
+        snprintf(fpath, sizeof(fpath), "%s%s", config->fatfs_drive, path + mlen);
+        fatfs = true;
+    }
+#endif
+
+    sd_writer_t *w = (sd_writer_t *)heap_caps_calloc(1, sizeof(sd_writer_t),
+                                                     MALLOC_CAP_INTERNAL);
+    if (!w) {
+        return ESP_ERR_NO_MEM;
+    }
+    w->fatfs = fatfs;
+    w->fd = -1;
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err;
+#ifdef ESP_PLATFORM
+    if (fatfs) {
+        err = open_fatfs(w, fpath, config->reserve_bytes);
+    } else
+#endif
+    {
+        err = open_posix(w, path, config->reserve_bytes);
+    }
+    if (err != ESP_OK) {
+        heap_caps_free(w);
+        return err;
+    }
+
+    // Whole clusters, so every flush starts on a cluster boundary
+    uint32_t cluster = w->stats.cluster_size;
+    uint32_t size = config->buffer_size ? config->buffer_size : cluster;
+    w->stats.buffer_size = (size + cluster - 1) / cluster * cluster;
+    w->buf = (uint8_t *)heap_caps_aligned_alloc(BUFFER_ALIGN, w->stats.buffer_size,
+                                                MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (!w->buf) {
+        ESP_LOGE(TAG, "No DMA memory for a %lu byte buffer", (unsigned long)w->stats.buffer_size);
+        sd_writer_close(w, NULL);
+        unlink(path);
+        return ESP_ERR_NO_MEM;
+    }
+    w->stats.open_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    ESP_LOGI(TAG, "%s: cluster %lu, buffer %lu, reserved %llu%s", path,
+             (unsigned long)cluster, (unsigned long)w->stats.buffer_size,
+             (unsigned long long)w->stats.reserved, w->stats.contiguous ? " contiguous" : "");
+    *out = w;
+    return ESP_OK;
+}
+
+esp_err_t sd_writer_write(sd_writer_t *w, const void *data, size_t len) {
+    if (!w || (!data && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (w->err != ESP_OK) {
+        return w->err;
+    }
+
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        uint32_t n = w->stats.buffer_size - w->fill;
+        if (n > len) {
+            n = (uint32_t)len;
+        }
+        memcpy(w->buf + w->fill, p, n);
+        w->fill += n;
+        w->stats.bytes += n;
+        p += n;
+        len -= n;
+
+        if (w->fill == w->stats.buffer_size) {
+            w->fill = 0;
+            if (write_out(w, w->buf, w->stats.buffer_size) != ESP_OK) {
+                return w->err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+void sd_writer_get_stats(const sd_writer_t *w, sd_writer_stats_t *out) {
+    if (w && out) {
+        *out = w->stats;
+    }
+}
+
+esp_err_t sd_writer_close(sd_writer_t *w, sd_writer_stats_t *stats) {
+    if (!w) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (w->fill && w->err == ESP_OK) {
+        write_out(w, w->buf, w->fill);
+    }
+
+    // Drop the unused part of the reservation
+    bool ok = true;
+#ifdef ESP_PLATFORM
+    if (w->fatfs) {
+        ok = (f_truncate(&w->fil) == FR_OK);
+        ok = (f_close(&w->fil) == FR_OK) && ok;
+    } else
+#endif
+    if (w->fd >= 0) {
+        ok = (ftruncate(w->fd, (off_t)w->written) == 0);
+        ok = (fsync(w->fd) == 0) && ok;
+        ok = (close(w->fd) == 0) && ok;
+    }
+    if (!ok && w->err == ESP_OK) {
+        ESP_LOGE(TAG, "Truncate / close failed");
+        w->err = ESP_FAIL;
+    }
+    w->stats.close_us = (uint32_t)(esp_timer_get_time() - t0);
+
+    if (stats) {
+        *stats = w->stats;
+    }
+    esp_err_t err = w->err;
+    heap_caps_free(w->buf);
+    heap_caps_free(w);
+    return err;
+}
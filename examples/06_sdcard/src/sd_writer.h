@@ -0,0 +1,125 @@
+/**
+ * @file sd_writer.h
+ * @brief Preallocated, cluster-aligned file writer for continuous recording
+ *
+ * Appending with fwrite() makes FatFs allocate a cluster each time the
+ * file grows past the last one: a FAT lookup for a free cluster, a FAT
+ * sector update and, on small writes, a read-modify-write of the sector
+ * window. These show up as periodic multi-millisecond stalls that a
+ * recorder with a small buffer cannot absorb.
+ *
+ * The writer allocates the whole expected size up front as one contiguous
+ * run (FatFs f_expand()), collects data in a DMA-capable buffer of whole
+ * clusters and writes it with one f_write() per buffer, so the SDMMC
+ * driver transfers straight from the buffer and no cluster is allocated
+ * while recording. On close the file is truncated to the bytes written
+ * and the unused clusters are freed.
+ *
+ * Without a FatFs drive (Linux bench, other file systems) it uses POSIX
+ * open() / write() / ftruncate(), with posix_fallocate() on Linux.
+ *
+ * After a power loss before close, the file has the reserved length; the
+ * recording's own framing tells where the data ends.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sd_writer sd_writer_t;
+
+/**
+ * @brief Writer configuration
+ */
+typedef struct {
+    const char *mount_point;     // VFS prefix of the volume, e.g. "/sdcard"
+    const char *fatfs_drive;     // FatFs drive of the volume, e.g. "0:"; NULL: POSIX I/O
+    uint32_t reserve_bytes;      // Space allocated at open (rounded up to clusters)
+    uint32_t buffer_size;        // Staging buffer, 0: one cluster; rounded up to clusters
+} sd_writer_config_t;
+
+#define SD_WRITER_CONFIG_DEFAULT() {        \
+    .mount_point = "/sdcard",               \
+    .fatfs_drive = NULL,                    \
+    .reserve_bytes = 16 * 1024 * 1024,      \
+    .buffer_size = 0,                       \
+}
+
+/**
+ * @brief Writer metrics
+ */
+typedef struct {
+    uint64_t bytes;              // Accepted by sd_writer_write()
+    uint32_t cluster_size;       // Allocation unit of the volume
+    uint32_t buffer_size;        // Staging buffer in use
+    uint64_t reserved;           // Allocated at open, 0 if preallocation failed
+    bool contiguous;             // The reservation is one contiguous run
+    uint64_t overflow_bytes;     // Written past the reservation (allocated while writing)
+    uint32_t flushes;            // Buffer writes to the card
+    uint64_t flush_total_us;
+    uint32_t flush_max_us;
+    uint32_t open_us;            // Open and reservation
+    uint32_t close_us;           // Last flush, truncate and close
+} sd_writer_stats_t;
+
+/**
+ * @brief Create or truncate `path` and reserve space
+ *
+ * A failed reservation (e.g. no contiguous free run that large) is not an
+ * error: the writer then allocates as it goes, like fwrite().
+ *
+ * @param path: VFS path of the file
+ * @param config: Writer configuration
+ * @param out: Receives the writer
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid arguments, or path outside mount_point
+ *    - ESP_ERR_NO_MEM: Out of memory for the buffer
+ *    - ESP_FAIL: File could not be created
+ */
+esp_err_t sd_writer_open(const char *path, const sd_writer_config_t *config, sd_writer_t **out);
+
+/**
+ * @brief Append data
+ *
+ * Copies into the buffer; writes to the card each time the buffer is full,
+ * so the call that fills it takes the time of one buffer write.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: NULL writer or data
+ *    - ESP_FAIL: Write error (also returned by later calls)
+ */
+esp_err_t sd_writer_write(sd_writer_t *w, const void *data, size_t len);
+
+/**
+ * @brief Get metrics of an open writer
+ */
+void sd_writer_get_stats(const sd_writer_t *w, sd_writer_stats_t *out);
+
+/**
+ * @brief Write the rest of the buffer, truncate to the bytes written, close
+ *
+ * The writer is freed even on error.
+ *
+ * @param w: Writer
+ * @param stats: Receives the final metrics, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: NULL writer
+ *    - ESP_FAIL: A write, truncate or close failed
+ */
+esp_err_t sd_writer_close(sd_writer_t *w, sd_writer_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
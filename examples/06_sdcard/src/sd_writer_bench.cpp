@@ -0,0 +1,114 @@
+/**
+ * @file sd_writer_bench.cpp
+ * @brief Recording benchmark: fwrite() vs the preallocated writer
+ */
+
+#include "sd_writer_bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sd_writer_bench";
+
+#define DEFAULT_VBUF (64 * 1024)
+
+static const char *method_names[SD_REC_METHOD_COUNT] = {"fwrite", "fwrite+vbuf", "writer"};
+
+esp_err_t sd_writer_bench_run(const char *path, const sd_rec_params_t *p,
+                              const sd_writer_config_t *writer, sd_io_result_t *out,
+                              sd_writer_stats_t *stats) {
+    if (!path || !p || !writer || !out || p->method >= SD_REC_METHOD_COUNT || p->chunk == 0 ||
+        p->total < p->chunk) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+
+    uint32_t n_ops = p->total / p->chunk;
+    uint32_t vbuf_size = writer->buffer_size ? writer->buffer_size : DEFAULT_VBUF;
+    uint8_t *chunk = (uint8_t *)malloc(p->chunk);
+    uint32_t *lat = (uint32_t *)heap_caps_malloc(n_ops * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    char *vbuf = (p->method == SD_REC_FWRITE_VBUF) ? (char *)malloc(vbuf_size) : NULL;
+    if (!chunk || !lat || (p->method == SD_REC_FWRITE_VBUF && !vbuf)) {
+        free(chunk);
+        heap_caps_free(lat);
+        free(vbuf);
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < p->chunk; i++) {
+        chunk[i] = (uint8_t)(i * 13 + 1);
+    }
+    unlink(path);
+
+    esp_err_t err = ESP_OK;
+    FILE *f = NULL;
+    sd_writer_t *w = NULL;
+    int64_t start = esp_timer_get_time();
+    if (p->method == SD_REC_WRITER) {
+        sd_writer_config_t cfg = *writer;
+        cfg.reserve_bytes = n_ops * p->chunk;
+        err = sd_writer_open(path, &cfg, &w);
+    } else {
+        f = fopen(path, "wb");
+        if (!f) {
+            err = ESP_FAIL;
+        } else if (vbuf) {
+            setvbuf(f, vbuf, _IOFBF, vbuf_size);
+        }
+    }
+
+    uint32_t n = 0;
+    while (err == ESP_OK && n < n_ops) {
+        int64_t t0 = esp_timer_get_time();
+        if (w) {
+            err = sd_writer_write(w, chunk, p->chunk);
+        } else if (fwrite(chunk, 1, p->chunk, f) != p->chunk) {
+            err = ESP_FAIL;
+        }
+        lat[n++] = (uint32_t)(esp_timer_get_time() - t0);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: %s failed at append %lu", path, method_names[p->method],
+                 (unsigned long)n);
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (w) {
+        esp_err_t cerr = sd_writer_close(w, stats);
+        err = (err == ESP_OK) ? cerr : err;
+    } else if (f) {
+        bool ok = (fflush(f) == 0 && fsync(fileno(f)) == 0);
+        ok = (fclose(f) == 0) && ok;
+        if (!ok && err == ESP_OK) {
+            err = ESP_FAIL;
+        }
+    }
+    int64_t end = esp_timer_get_time();
+    out->sync_us = (uint32_t)(end - t0);
+    out->elapsed_us = (uint32_t)(end - start);
+
+    if (err == ESP_OK) {
+        out->ops = n;
+        out->bytes = (uint64_t)n * p->chunk;
+        double secs = out->elapsed_us / 1e6;
+        if (secs > 0) {
+            out->mb_per_s = (float)(out->bytes / 1e6 / secs);
+            out->iops = (float)(n / secs);
+        }
+        sd_io_bench_fill_latency(out, lat, n);
+    }
+
+    unlink(path);
+    free(chunk);
+    heap_caps_free(lat);
+    free(vbuf);
+    return err;
+}
+
+const char *sd_writer_bench_method_name(sd_rec_method_t method) {
+    return method < SD_REC_METHOD_COUNT ? method_names[method] : "?";
+}
@@ -0,0 +1,72 @@
+/**
+ * @file sd_writer_bench.h
+ * @brief Recording benchmark: fwrite() vs the preallocated writer
+ *
+ * Simulates a recorder that appends fixed-size chunks (e.g. 4 KB of audio
+ * or RS485 frames) to a new file as fast as the card takes them, and times
+ * every append. The worst case is what matters: a recorder needs a buffer
+ * that covers its longest stall.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sd_io_bench.h"
+#include "sd_writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How the chunks are written
+ */
+typedef enum {
+    SD_REC_FWRITE,           // fwrite() with the newlib stdio buffer
+    SD_REC_FWRITE_VBUF,      // fwrite() with a stdio buffer as large as the writer's
+    SD_REC_WRITER,           // sd_writer: preallocated, whole-cluster writes
+    SD_REC_METHOD_COUNT,
+} sd_rec_method_t;
+
+/**
+ * @brief Parameters of one run
+ */
+typedef struct {
+    sd_rec_method_t method;
+    uint32_t chunk;          // Bytes per append
+    uint32_t total;          // Bytes per recording
+} sd_rec_params_t;
+
+/**
+ * @brief Record `total` bytes to a new file at `path`, timing each append
+ *
+ * mb_per_s and elapsed_us include closing the file. The file is deleted
+ * afterwards.
+ *
+ * @param path: Test file (deleted first)
+ * @param params: Method, chunk and total size
+ * @param writer: Writer configuration (reserve_bytes is set to total);
+ *                buffer_size (0: 64 KB) is also the stdio buffer of
+ *                SD_REC_FWRITE_VBUF
+ * @param out: Per-append latency results
+ * @param stats: Writer metrics for SD_REC_WRITER, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid parameters
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: I/O error
+ */
+esp_err_t sd_writer_bench_run(const char *path, const sd_rec_params_t *params,
+                              const sd_writer_config_t *writer, sd_io_result_t *out,
+                              sd_writer_stats_t *stats);
+
+/**
+ * @brief Short name of a method
+ */
+const char *sd_writer_bench_method_name(sd_rec_method_t method);
+
+#ifdef __cplusplus
+}
+#endif
@@ -30,10 +30,8 @@
 #include "freertos/semphr.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
-#include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
-#include "driver/sdmmc_host.h"
-#include "sd_pwr_ctrl_by_on_chip_ldo.h"
+#include "sd_service.h"
 
 // BSP includes
 #include "bsp/esp-bsp.h"
@@ -50,9 +48,8 @@ static const char* TAG = "audio_mp3";
 #define MAX_TRACKS          50
 #define MAX_FILENAME_LEN    64
 
-// SD card handles
+// SD card, held for the lifetime of the player (see sd_service)
 static sdmmc_card_t* sd_card = NULL;
-static sd_pwr_ctrl_handle_t sd_pwr_ctrl_handle = NULL;
 
 // Audio state
 static file_iterator_instance_t* file_iterator = NULL;
@@ -76,44 +73,37 @@ static lv_obj_t* track_list = NULL;
 static lv_obj_t* track_count_label = NULL;
 
 /**
- * @brief Mount SD card with LDO power control
+ * @brief SD service events, on the service task
  */
-static esp_err_t mount_sd_card(void) {
-    const esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 5,
-        .allocation_unit_size = 64 * 1024
-    };
-
-    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
-    host.slot = SDMMC_HOST_SLOT_0;
-    host.max_freq_khz = SDMMC_FREQ_HIGHSPEED;
+static void sd_event(sd_service_event_t event, void* arg) {
+    bsp_display_lock(0);
+    // Tracks are scanned once at startup; a card found later needs a restart
+    lv_label_set_text(status_label, event == SD_SERVICE_EVENT_REMOVED
+                                        ? "SD card removed"
+                                        : "SD card inserted - restart to load music");
+    bsp_display_unlock();
+}
 
-    // Create LDO power control
-    sd_pwr_ctrl_ldo_config_t ldo_config = {
-        .ldo_chan_id = 4,
-    };
-    esp_err_t ret = sd_pwr_ctrl_new_on_chip_ldo(&ldo_config, &sd_pwr_ctrl_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create LDO power control: %s", esp_err_to_name(ret));
-        return ret;
+/**
+ * @brief Mount the SD card through the shared SD service
+ */
+static esp_err_t mount_sd_card(void) {
+    sd_service_config_t cfg = SD_SERVICE_CONFIG_DEFAULT();
+    cfg.mount_point = BSP_SD_MOUNT_POINT;
+    cfg.on_event = sd_event;
+    esp_err_t ret = sd_service_init(&cfg);
+    if (ret == ESP_OK) {
+        ret = sd_service_acquire(&sd_card);
     }
-    host.pwr_ctrl_handle = sd_pwr_ctrl_handle;
-
-    const sdmmc_slot_config_t slot_config = {
-        .cd = SDMMC_SLOT_NO_CD,
-        .wp = SDMMC_SLOT_NO_WP,
-        .width = 4,
-        .flags = 0,
-    };
-
-    ret = esp_vfs_fat_sdmmc_mount(BSP_SD_MOUNT_POINT, &host, &slot_config, &mount_config, &sd_card);
     if (ret != ESP_OK) {
-        sd_pwr_ctrl_del_on_chip_ldo(sd_pwr_ctrl_handle);
-        sd_pwr_ctrl_handle = NULL;
         ESP_LOGE(TAG, "Failed to mount SD card: %s", esp_err_to_name(ret));
+        return ret;
     }
-    return ret;
+
+    sd_service_stats_t st;
+    sd_service_get_stats(&st);
+    ESP_LOGI(TAG, "SD card mounted in %lu ms", (unsigned long)(st.last_mount_us / 1000));
+    return ESP_OK;
 }
 
 /**
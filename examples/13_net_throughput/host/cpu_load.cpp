@@ -0,0 +1,34 @@
+/**
+ * @file cpu_load.cpp
+ * @brief CPU load of the peer process (Linux build of src/cpu_load.h)
+ *
+ * The peer is single-threaded, so its CPU time over wall time is the load
+ * of the core it runs on. Reported as one core.
+ */
+
+#include "cpu_load.h"
+
+#include <sys/resource.h>
+#include "esp_timer.h"
+
+static uint64_t process_cpu_us(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+void cpu_load_start(cpu_load_mark_t *mark) {
+    mark->wall_us = esp_timer_get_time();
+    mark->counter[0] = process_cpu_us();
+}
+
+int cpu_load_get(const cpu_load_mark_t *mark, uint16_t *permille, int max_cores) {
+    int64_t wall = esp_timer_get_time() - mark->wall_us;
+    if (wall <= 0 || max_cores < 1) {
+        return 0;
+    }
+    uint64_t busy = process_cpu_us() - mark->counter[0];
+    permille[0] = busy >= (uint64_t)wall ? 1000 : (uint16_t)(busy * 1000 / wall);
+    return 1;
+}
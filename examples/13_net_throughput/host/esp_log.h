@@ -0,0 +1,21 @@
+/**
+ * @file esp_log.h
+ * @brief Minimal esp_log.h for building src/net_perf.cpp on Linux
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+// Set by the peer's -v option
+extern int esp_log_verbose;
+
+#define ESP_LOG_LINE(letter, tag, fmt, ...) \
+    fprintf(stderr, letter " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_LINE("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_LINE("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) \
+    do { if (esp_log_verbose) ESP_LOG_LINE("I", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...) \
+    do { if (esp_log_verbose > 1) ESP_LOG_LINE("D", tag, fmt, ##__VA_ARGS__); } while (0)
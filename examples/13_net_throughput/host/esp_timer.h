@@ -0,0 +1,15 @@
+/**
+ * @file esp_timer.h
+ * @brief Minimal esp_timer.h for building src/net_perf.cpp on Linux
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file net_perf_peer.cpp
+ * @brief Linux peer for the throughput example
+ *
+ * Runs the same test code as the device (src/net_perf.cpp), as server or
+ * client, so a PC can be either end of a test. Two instances on the same
+ * machine talk over loopback, which is handy when working on the test
+ * itself.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -o net_perf_peer host/net_perf_peer.cpp \
+ *       host/cpu_load.cpp src/net_perf.cpp
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "net_perf.h"
+
+int esp_log_verbose = 0;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s -s [options]          serve tests\n"
+            "       %s -c <host> [options]   run a test against a server\n"
+            "\n"
+            "  -p <port>     Port (default %d)\n"
+            "  -1            Server: exit after one test\n"
+            "  -u            UDP instead of TCP\n"
+            "  -R            Reverse: server sends, client receives\n"
+            "  -P <n>        Parallel streams (1-%d)\n"
+            "  -l <bytes>    Bytes per send/datagram (TCP %d, UDP %d)\n"
+            "  -w <bytes>    Socket buffer size\n"
+            "  -t <sec>      Duration (default %d)\n"
+            "  -b <rate>     UDP target rate in bit/s, K/M suffix (default unlimited)\n"
+            "  -i <sec>      Progress interval (default 1, 0 to disable)\n"
+            "  -v            Log protocol steps (-vv for more)\n",
+            prog, prog, NET_PERF_DEFAULT_PORT, NET_PERF_MAX_STREAMS, NET_PERF_TCP_LEN,
+            NET_PERF_UDP_LEN, NET_PERF_DURATION_MS / 1000);
+}
+
+static uint32_t parse_rate_kbps(const char *arg) {
+    char *end = NULL;
+    double rate = strtod(arg, &end);
+    if (*end == 'k' || *end == 'K') {
+        rate *= 1e3;
+    } else if (*end == 'm' || *end == 'M') {
+        rate *= 1e6;
+    } else if (*end == 'g' || *end == 'G') {
+        rate *= 1e9;
+    }
+    return (uint32_t)(rate / 1000);
+}
+
+static void print_interval(void *ctx, const net_perf_interval_t *iv) {
+    (void)ctx;
+    if (iv->end_ms == 0) {
+        return;  // Start marker
+    }
+    printf("%6.1f-%-6.1f s  %10.2f MB  %8.2f Mbit/s\n", iv->start_ms / 1000.0,
+           iv->end_ms / 1000.0, iv->bytes / 1e6, iv->mbps);
+    fflush(stdout);
+}
+
+static void print_side(const char *name, const net_perf_result_t *res,
+                       const net_perf_side_t *side, bool sender) {
+    printf("%-9s %-8s %10.2f MB in %6.2f s", name, sender ? "sent" : "received", side->bytes / 1e6,
+           side->duration_us / 1e6);
+    if (res->protocol == NET_PERF_UDP) {
+        if (sender) {
+            printf("  %lu datagrams, %lu stalls", (unsigned long)side->packets,
+                   (unsigned long)side->send_stalls);
+        } else {
+            uint32_t expected = side->packets + side->lost;
+            printf("  %lu/%lu lost (%.2f%%), %lu reordered, jitter %.3f ms",
+                   (unsigned long)side->lost, (unsigned long)expected,
+                   expected > 0 ? 100.0 * side->lost / expected : 0.0,
+                   (unsigned long)side->out_of_order, side->jitter_us / 1000.0);
+        }
+    }
+    if (side->cpu_count == 1) {
+        printf("  CPU %.1f%%", side->cpu_permille[0] / 10.0);
+    } else {
+        for (int i = 0; i < side->cpu_count; i++) {
+            printf("  CPU%d %.1f%%", i, side->cpu_permille[i] / 10.0);
+        }
+    }
+    printf("\n");
+}
+
+static void print_result(void *ctx, const net_perf_result_t *res) {
+    (void)ctx;
+    printf("--- %s %s %s, %u stream(s) x %lu bytes\n",
+           res->protocol == NET_PERF_TCP ? "TCP" : "UDP", res->sender ? "to" : "from", res->peer,
+           res->streams, (unsigned long)res->buf_len);
+    print_side("local", res, &res->local, res->sender);
+    print_side("peer", res, &res->remote, !res->sender);
+    printf("Throughput: %.2f Mbit/s received, %.2f Mbit/s sent\n", res->mbps, res->send_mbps);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    bool server = false;
+    bool once = false;
+    uint32_t interval_s = 1;
+    net_perf_config_t cfg = {};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "sc:p:1uRP:l:w:t:b:i:vh")) != -1) {
+        switch (opt) {
+            case 's': server = true; break;
+            case 'c': cfg.host = optarg; break;
+            case 'p': cfg.port = (uint16_t)atoi(optarg); break;
+            case '1': once = true; break;
+            case 'u': cfg.protocol = NET_PERF_UDP; break;
+            case 'R': cfg.reverse = true; break;
+            case 'P': cfg.streams = (uint8_t)atoi(optarg); break;
+            case 'l': cfg.buf_len = (uint32_t)atoi(optarg); break;
+            case 'w': cfg.window = (uint32_t)atoi(optarg); break;
+            case 't': cfg.duration_ms = (uint32_t)(atof(optarg) * 1000); break;
+            case 'b': cfg.rate_kbps = parse_rate_kbps(optarg); break;
+            case 'i': interval_s = (uint32_t)atoi(optarg); break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (server == (cfg.host != NULL)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // A peer that goes away must not kill us in send()
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (server) {
+        net_perf_server_config_t srv = {};
+        srv.port = cfg.port;
+        srv.sessions = once ? 1 : 0;
+        srv.interval_ms = interval_s * 1000;
+        srv.on_interval = interval_s > 0 ? print_interval : NULL;
+        srv.on_result = print_result;
+        printf("Serving on port %d\n", cfg.port != 0 ? cfg.port : NET_PERF_DEFAULT_PORT);
+        return net_perf_serve(&srv) == ESP_OK ? 0 : 1;
+    }
+
+    cfg.interval_ms = interval_s * 1000;
+    cfg.on_interval = interval_s > 0 ? print_interval : NULL;
+    net_perf_result_t res;
+    esp_err_t err = net_perf_run(&cfg, &res);
+    if (err != ESP_OK) {
+        fprintf(stderr, "Test failed: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    print_result(NULL, &res);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file cpu_load.cpp
+ * @brief Per-core CPU load from idle task run time
+ */
+
+#include "cpu_load.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+/**
+ * @brief Run time of the idle task of a core, in microseconds
+ */
+static uint64_t idle_run_time(int core) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    TaskStatus_t status;
+    vTaskGetInfo(xTaskGetIdleTaskHandleForCore(core), &status, pdFALSE, eRunning);
+    return status.ulRunTimeCounter;
+#else
+    (void)core;
+    return 0;
+#endif
+}
+
+void cpu_load_start(cpu_load_mark_t *mark) {
+    mark->wall_us = esp_timer_get_time();
+    for (int i = 0; i < CPU_LOAD_MAX_CORES && i < portNUM_PROCESSORS; i++) {
+        mark->counter[i] = idle_run_time(i);
+    }
+}
+
+int cpu_load_get(const cpu_load_mark_t *mark, uint16_t *permille, int max_cores) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    int64_t wall = esp_timer_get_time() - mark->wall_us;
+    if (wall <= 0) {
+        return 0;
+    }
+
+    int n = 0;
+    for (; n < max_cores && n < CPU_LOAD_MAX_CORES && n < portNUM_PROCESSORS; n++) {
+        uint64_t idle = idle_run_time(n) - mark->counter[n];
+        permille[n] = idle >= (uint64_t)wall ? 0 : (uint16_t)(1000 - idle * 1000 / wall);
+    }
+    return n;
+#else
+    (void)mark;
+    (void)permille;
+    (void)max_cores;
+    return 0;
+#endif
+}
@@ -0,0 +1,48 @@
+/**
+ * @file cpu_load.h
+ * @brief CPU load over a measurement window
+ *
+ * On the P4 the load of each core is derived from the run time of its idle
+ * task (needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS). The Linux build in
+ * host/ reports the CPU time of the process instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CPU_LOAD_MAX_CORES 2
+
+/**
+ * @brief Start of a measurement window
+ */
+typedef struct {
+    int64_t wall_us;
+    uint64_t counter[CPU_LOAD_MAX_CORES];  // Idle run time per core (P4), CPU time (Linux)
+} cpu_load_mark_t;
+
+/**
+ * @brief Open a measurement window
+ *
+ * @param mark: Filled with the current counters
+ */
+void cpu_load_start(cpu_load_mark_t *mark);
+
+/**
+ * @brief Load since cpu_load_start()
+ *
+ * @param mark: Start of the window
+ * @param permille: Load per core, 0-1000
+ * @param max_cores: Entries in permille
+ *
+ * @return Number of entries filled, 0 if load is not available
+ */
+int cpu_load_get(const cpu_load_mark_t *mark, uint16_t *permille, int max_cores);
+
+#ifdef __cplusplus
+}
+#endif
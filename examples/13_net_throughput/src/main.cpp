@@ -0,0 +1,539 @@
+/**
+ * @file main.cpp
+ * @brief Example 13: Network Throughput for JC4880P443C (ESP32-P4)
+ *
+ * This example demonstrates:
+ * - WiFi connection via ESP-HOSTED (C6 co-processor)
+ * - iperf-style TCP/UDP throughput tests through the C6 and its SDIO link
+ * - Sending and receiving, parallel streams, configurable buffer sizes
+ * - UDP loss, reordering and jitter
+ * - CPU load of both P4 cores during a test
+ * - A test server on the device, driven by host/net_perf_peer on a PC
+ *
+ * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
+ * WiFi: Via ESP32-C6 co-processor using ESP-HOSTED
+ *
+ * NOTE: Configure WIFI_SSID, WIFI_PASSWORD and PEER_HOST below!
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+
+// ESP-HOSTED for WiFi via C6 co-processor
+#include "esp_hosted.h"
+
+#include "net_perf.h"
+
+// BSP includes
+#include "bsp/esp-bsp.h"
+#include "bsp/display.h"
+
+// LVGL
+#include "lvgl.h"
+
+static const char *TAG = "net_throughput";
+
+// ============================================================================
+// Configuration - CHANGE THESE!
+// ============================================================================
+#define WIFI_SSID      "YOUR_WIFI_SSID"
+#define WIFI_PASSWORD  "YOUR_WIFI_PASSWORD"
+
+// PC running "net_perf_peer -s" (see host/), used by the test buttons
+#define PEER_HOST      "192.168.1.100"
+
+// Parameters of the tests started from the screen
+#define TEST_DURATION_MS   10000
+#define TEST_STREAMS       1
+#define TEST_BUF_LEN       0      // 0: 16 KB for TCP, 1470 bytes for UDP
+#define TEST_WINDOW        0      // Socket receive buffer, 0: lwIP default
+#define TEST_UDP_RATE_KBPS 40000  // UDP target rate, 0: as fast as possible
+
+// ============================================================================
+
+// Event group for WiFi events
+static EventGroupHandle_t wifi_event_group;
+#define WIFI_CONNECTED_BIT BIT0
+#define WIFI_FAIL_BIT      BIT1
+
+// LVGL UI elements
+static lv_obj_t *status_label = NULL;
+static lv_obj_t *ip_label = NULL;
+static lv_obj_t *rate_label = NULL;
+static lv_obj_t *result_label = NULL;
+static lv_obj_t *chart = NULL;
+static lv_chart_series_t *chart_series = NULL;
+static lv_obj_t *test_btns[4] = {};
+
+// Tests started from the screen, in button order
+typedef struct {
+    const char *name;
+    net_perf_protocol_t protocol;
+    bool reverse;
+} test_kind_t;
+
+static const test_kind_t test_kinds[] = {
+    {"TCP TX", NET_PERF_TCP, false},
+    {"TCP RX", NET_PERF_TCP, true},
+    {"UDP TX", NET_PERF_UDP, false},
+    {"UDP RX", NET_PERF_UDP, true},
+};
+
+#define CHART_POINTS 30
+
+static QueueHandle_t test_queue = NULL;
+
+// WiFi retry counter
+static int wifi_retry_count = 0;
+#define WIFI_MAX_RETRY 5
+
+/**
+ * @brief WiFi event handler
+ */
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data) {
+    if (event_base == WIFI_EVENT) {
+        switch (event_id) {
+            case WIFI_EVENT_STA_START:
+                ESP_LOGI(TAG, "WiFi STA started, connecting...");
+                esp_wifi_connect();
+                break;
+
+            case WIFI_EVENT_STA_DISCONNECTED:
+                if (wifi_retry_count < WIFI_MAX_RETRY) {
+                    ESP_LOGI(TAG, "WiFi disconnected, retrying (%d/%d)...",
+                             wifi_retry_count + 1, WIFI_MAX_RETRY);
+                    esp_wifi_connect();
+                    wifi_retry_count++;
+                } else {
+                    ESP_LOGE(TAG, "WiFi connection failed after %d retries", WIFI_MAX_RETRY);
+                    xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);
+                }
+                break;
+
+            default:
+                break;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        wifi_retry_count = 0;
+        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+        // Update IP label
+        if (ip_label) {
+            bsp_display_lock(0);
+            lv_label_set_text_fmt(ip_label, "IP: " IPSTR "   server port %d",
+                                  IP2STR(&event->ip_info.ip), NET_PERF_DEFAULT_PORT);
+            bsp_display_unlock();
+        }
+    }
+}
+
+/**
+ * @brief Initialize WiFi in station mode and connect
+ */
+static esp_err_t wifi_init_and_connect(void) {
+    ESP_LOGI(TAG, "Initializing WiFi...");
+
+    wifi_event_group = xEventGroupCreate();
+
+    // Initialize TCP/IP stack
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    // Create default WiFi station
+    esp_netif_create_default_wifi_sta();
+
+    // Initialize WiFi with default config
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    // Register event handlers
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+
+    // Configure WiFi
+    wifi_config_t wifi_config = {};
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    // Power save adds latency to every frame and caps throughput
+    esp_wifi_set_ps(WIFI_PS_NONE);
+
+    ESP_LOGI(TAG, "WiFi init complete, waiting for connection...");
+
+    // Wait for connection or failure
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(30000));
+
+    if (bits & WIFI_CONNECTED_BIT) {
+        ESP_LOGI(TAG, "Connected to WiFi SSID: %s", WIFI_SSID);
+        return ESP_OK;
+    } else if (bits & WIFI_FAIL_BIT) {
+        ESP_LOGE(TAG, "Failed to connect to SSID: %s", WIFI_SSID);
+        return ESP_FAIL;
+    } else {
+        ESP_LOGE(TAG, "WiFi connection timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+}
+
+// ============================================================================
+// Test progress and results
+// ============================================================================
+
+static void set_buttons_enabled(bool enabled) {
+    for (int i = 0; i < 4; i++) {
+        if (enabled) {
+            lv_obj_clear_state(test_btns[i], LV_STATE_DISABLED);
+        } else {
+            lv_obj_add_state(test_btns[i], LV_STATE_DISABLED);
+        }
+    }
+}
+
+/**
+ * @brief Progress of a test, started from the screen or by the peer
+ *
+ * Called from the test task.
+ */
+static void on_interval(void *ctx, const net_perf_interval_t *iv) {
+    const char *what = (const char *)ctx;
+
+    bsp_display_lock(0);
+    if (iv->end_ms == 0) {
+        // Test starting: clear the chart
+        lv_chart_set_all_value(chart, chart_series, LV_CHART_POINT_NONE);
+        lv_label_set_text_fmt(status_label, "Status: %s running...", what);
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+        lv_label_set_text(rate_label, "--- Mbit/s");
+    } else {
+        lv_chart_set_next_value(chart, chart_series, (int32_t)(iv->mbps + 0.5f));
+        lv_label_set_text_fmt(rate_label, "%.1f Mbit/s", iv->mbps);
+    }
+    bsp_display_unlock();
+}
+
+/**
+ * @brief Append one side of a result to a text buffer
+ */
+static int format_side(char *buf, size_t len, const char *name, const net_perf_result_t *res,
+                       const net_perf_side_t *side, bool sender) {
+    int n = snprintf(buf, len, "%s: %s %.2f MB in %.1f s", name, sender ? "sent" : "received",
+                     side->bytes / 1e6, side->duration_us / 1e6);
+    if (res->protocol == NET_PERF_UDP && !sender) {
+        uint32_t expected = side->packets + side->lost;
+        n += snprintf(buf + n, len - n, ", lost %lu/%lu, jitter %.2f ms",
+                      (unsigned long)side->lost, (unsigned long)expected,
+                      side->jitter_us / 1000.0);
+    }
+    if (side->cpu_count == 1) {
+        n += snprintf(buf + n, len - n, "\n    CPU %.1f%%", side->cpu_permille[0] / 10.0);
+    } else if (side->cpu_count > 1) {
+        n += snprintf(buf + n, len - n, "\n    CPU0 %.1f%%  CPU1 %.1f%%",
+                      side->cpu_permille[0] / 10.0, side->cpu_permille[1] / 10.0);
+    }
+    n += snprintf(buf + n, len - n, "\n");
+    return n;
+}
+
+/**
+ * @brief Show and log a finished test
+ *
+ * Called from the test task.
+ */
+static void on_result(void *ctx, const net_perf_result_t *res) {
+    const char *what = (const char *)ctx;
+
+    char text[512];
+    int n = snprintf(text, sizeof(text), "%s %s %s, %u stream(s) x %lu bytes\n",
+                     res->protocol == NET_PERF_TCP ? "TCP" : "UDP", res->sender ? "to" : "from",
+                     res->peer, res->streams, (unsigned long)res->buf_len);
+    n += format_side(text + n, sizeof(text) - n, "P4", res, &res->local, res->sender);
+    n += format_side(text + n, sizeof(text) - n, "Peer", res, &res->remote, !res->sender);
+    snprintf(text + n, sizeof(text) - n, "Sender %.2f Mbit/s", res->send_mbps);
+
+    ESP_LOGI(TAG, "%s: %.2f Mbit/s\n%s", what, res->mbps, text);
+
+    bsp_display_lock(0);
+    lv_label_set_text_fmt(status_label, "Status: %s done", what);
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
+    lv_label_set_text_fmt(rate_label, "%.2f Mbit/s", res->mbps);
+    lv_label_set_text(result_label, text);
+    bsp_display_unlock();
+}
+
+/**
+ * @brief Serve tests started by a peer ("net_perf_peer -c <device ip>")
+ */
+static void server_task(void *arg) {
+    net_perf_server_config_t cfg = {};
+    cfg.on_interval = on_interval;
+    cfg.on_result = on_result;
+    cfg.ctx = (void *)"Peer test";
+
+    esp_err_t err = net_perf_serve(&cfg);
+    ESP_LOGE(TAG, "Test server stopped: %s", esp_err_to_name(err));
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Run the tests queued by the buttons against PEER_HOST
+ */
+static void client_task(void *arg) {
+    int kind;
+    while (xQueueReceive(test_queue, &kind, portMAX_DELAY) == pdTRUE) {
+        const test_kind_t *test = &test_kinds[kind];
+
+        net_perf_config_t cfg = {};
+        cfg.host = PEER_HOST;
+        cfg.protocol = test->protocol;
+        cfg.reverse = test->reverse;
+        cfg.streams = TEST_STREAMS;
+        cfg.buf_len = TEST_BUF_LEN;
+        cfg.window = TEST_WINDOW;
+        cfg.duration_ms = TEST_DURATION_MS;
+        cfg.rate_kbps = TEST_UDP_RATE_KBPS;
+        cfg.on_interval = on_interval;
+        cfg.ctx = (void *)test->name;
+
+        net_perf_result_t res;
+        esp_err_t err = net_perf_run(&cfg, &res);
+        if (err == ESP_OK) {
+            on_result((void *)test->name, &res);
+        }
+
+        bsp_display_lock(0);
+        if (err != ESP_OK) {
+            lv_label_set_text_fmt(status_label, "Status: %s failed", test->name);
+            lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+            lv_label_set_text_fmt(result_label, "Error: %s\nIs net_perf_peer -s running on %s?",
+                                  esp_err_to_name(err), PEER_HOST);
+        }
+        set_buttons_enabled(true);
+        bsp_display_unlock();
+    }
+}
+
+/**
+ * @brief Test button click callback
+ */
+static void test_btn_click_cb(lv_event_t *e) {
+    int kind = (int)(intptr_t)lv_event_get_user_data(e);
+    ESP_LOGI(TAG, "%s button clicked", test_kinds[kind].name);
+
+    // Runs in the LVGL task, which already holds the display lock
+    set_buttons_enabled(false);
+    lv_label_set_text_fmt(status_label, "Status: %s connecting...", test_kinds[kind].name);
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+    xQueueSend(test_queue, &kind, 0);
+}
+
+/**
+ * @brief Create the UI
+ */
+static void create_ui(void) {
+    lv_obj_t *scr = lv_scr_act();
+
+    // Set dark background
+    lv_obj_set_style_bg_color(scr, lv_color_hex(0x0f0f1a), LV_PART_MAIN);
+
+    // Title
+    lv_obj_t *title = lv_label_create(scr);
+    lv_label_set_text(title, "Network Throughput");
+    lv_obj_set_style_text_color(title, lv_color_white(), 0);
+    lv_obj_set_style_text_font(title, &lv_font_montserrat_18, 0);
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 15);
+
+    // SSID label
+    lv_obj_t *ssid_label = lv_label_create(scr);
+    lv_label_set_text_fmt(ssid_label, "SSID: %s", WIFI_SSID);
+    lv_obj_set_style_text_color(ssid_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(ssid_label, LV_ALIGN_TOP_LEFT, 10, 50);
+
+    // IP label
+    ip_label = lv_label_create(scr);
+    lv_label_set_text(ip_label, "IP: Connecting...");
+    lv_obj_set_style_text_color(ip_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(ip_label, LV_ALIGN_TOP_LEFT, 10, 75);
+
+    // Peer label
+    lv_obj_t *peer_label = lv_label_create(scr);
+    lv_label_set_text_fmt(peer_label, "Peer: %s:%d", PEER_HOST, NET_PERF_DEFAULT_PORT);
+    lv_obj_set_style_text_color(peer_label, lv_color_hex(0xFFCC88), 0);
+    lv_obj_align(peer_label, LV_ALIGN_TOP_LEFT, 10, 100);
+
+    // Status label
+    status_label = lv_label_create(scr);
+    lv_label_set_text(status_label, "Status: Ready");
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0x888888), 0);
+    lv_obj_align(status_label, LV_ALIGN_TOP_LEFT, 10, 125);
+
+    // Test buttons, two rows of two
+    for (int i = 0; i < 4; i++) {
+        test_btns[i] = lv_btn_create(scr);
+        lv_obj_set_size(test_btns[i], 200, 50);
+        lv_obj_align(test_btns[i], LV_ALIGN_TOP_MID, (i % 2) ? 110 : -110, 160 + (i / 2) * 60);
+        lv_obj_add_event_cb(test_btns[i], test_btn_click_cb, LV_EVENT_CLICKED,
+                            (void *)(intptr_t)i);
+        lv_obj_add_state(test_btns[i], LV_STATE_DISABLED);
+
+        lv_obj_t *btn_label = lv_label_create(test_btns[i]);
+        lv_label_set_text(btn_label, test_kinds[i].name);
+        lv_obj_center(btn_label);
+    }
+
+    // Current rate
+    rate_label = lv_label_create(scr);
+    lv_label_set_text(rate_label, "--- Mbit/s");
+    lv_obj_set_style_text_color(rate_label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(rate_label, &lv_font_montserrat_18, 0);
+    lv_obj_align(rate_label, LV_ALIGN_TOP_MID, 0, 290);
+
+    // Rate per interval
+    chart = lv_chart_create(scr);
+    lv_obj_set_size(chart, LV_PCT(90), 200);
+    lv_obj_align(chart, LV_ALIGN_TOP_MID, 0, 320);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(chart, CHART_POINTS);
+    lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_SHIFT);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_obj_set_style_bg_color(chart, lv_color_hex(0x16213e), 0);
+    lv_obj_set_style_border_width(chart, 0, 0);
+    lv_obj_set_style_size(chart, 0, 0, LV_PART_INDICATOR);
+    chart_series = lv_chart_add_series(chart, lv_color_hex(0x88FF88), LV_CHART_AXIS_PRIMARY_Y);
+    lv_chart_set_all_value(chart, chart_series, LV_CHART_POINT_NONE);
+
+    // Result of the last test
+    lv_obj_t *result_container = lv_obj_create(scr);
+    lv_obj_set_size(result_container, LV_PCT(95), 240);
+    lv_obj_align(result_container, LV_ALIGN_BOTTOM_MID, 0, -20);
+    lv_obj_set_style_bg_color(result_container, lv_color_hex(0x16213e), 0);
+    lv_obj_set_style_border_width(result_container, 0, 0);
+    lv_obj_set_style_pad_all(result_container, 10, 0);
+
+    result_label = lv_label_create(result_container);
+    lv_label_set_text(result_label, "Press a button to test against the peer,\n"
+                                    "or run net_perf_peer -c <device ip> on the PC");
+    lv_obj_set_style_text_color(result_label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(result_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_width(result_label, LV_PCT(95));
+    lv_label_set_long_mode(result_label, LV_LABEL_LONG_WRAP);
+    lv_obj_align(result_label, LV_ALIGN_TOP_LEFT, 0, 0);
+}
+
+extern "C" void app_main(void) {
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  JC4880P443C Network Throughput Example");
+    ESP_LOGI(TAG, "  ESP32-P4 + ESP-HOSTED + LVGL 9");
+    ESP_LOGI(TAG, "========================================");
+
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_LOGI(TAG, "NVS initialized");
+
+    // Initialize display using BSP
+    ESP_LOGI(TAG, "Initializing display...");
+
+    bsp_display_cfg_t disp_cfg = {
+        .lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG(),
+        .buffer_size = BSP_LCD_H_RES * 50,
+        .double_buffer = false,
+        .flags = {
+            .buff_dma = false,
+            .buff_spiram = true,
+            .sw_rotate = true,
+        }
+    };
+
+    lv_display_t *disp = bsp_display_start_with_config(&disp_cfg);
+    if (disp == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize display!");
+        return;
+    }
+    ESP_LOGI(TAG, "Display initialized");
+
+    // Turn on backlight
+    bsp_display_backlight_on();
+    bsp_display_brightness_set(100);
+
+    // Create UI
+    bsp_display_lock(0);
+    create_ui();
+    bsp_display_unlock();
+    ESP_LOGI(TAG, "UI created");
+
+    // Initialize ESP-HOSTED transport to C6 co-processor
+    ESP_LOGI(TAG, "Initializing ESP-HOSTED...");
+    ret = esp_hosted_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ESP-HOSTED init failed: %s", esp_err_to_name(ret));
+        bsp_display_lock(0);
+        lv_label_set_text(status_label, "ESP-HOSTED init failed!");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        bsp_display_unlock();
+        return;
+    }
+    ESP_LOGI(TAG, "ESP-HOSTED initialized");
+
+    // Wait for transport to stabilize
+    vTaskDelay(pdMS_TO_TICKS(500));
+
+    // Initialize WiFi and connect
+    ret = wifi_init_and_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi connection failed!");
+        bsp_display_lock(0);
+        lv_label_set_text(ip_label, "IP: Connection failed");
+        lv_label_set_text(status_label, "WiFi connection failed!");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        bsp_display_unlock();
+        return;
+    }
+
+    // Tests started from the screen and tests started by a peer run in
+    // separate tasks, so the server keeps listening during a local test
+    test_queue = xQueueCreate(4, sizeof(int));
+    xTaskCreate(server_task, "perf_server", 6144, NULL, 5, NULL);
+    xTaskCreate(client_task, "perf_client", 6144, NULL, 5, NULL);
+
+    ESP_LOGI(TAG, "WiFi connected successfully");
+    bsp_display_lock(0);
+    lv_label_set_text(status_label, "Status: Connected");
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
+    set_buttons_enabled(true);
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  Throughput demo ready!");
+    ESP_LOGI(TAG, "========================================");
+
+    // Main loop
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(5000));
+        ESP_LOGI(TAG, "Free heap: %lu bytes", (unsigned long)esp_get_free_heap_size());
+    }
+}
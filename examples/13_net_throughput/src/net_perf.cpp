@@ -0,0 +1,1130 @@
+/**
+ * @file net_perf.cpp
+ * @brief iperf-style TCP/UDP throughput test
+ *
+ * Only BSD sockets, esp_timer and esp_log are used here, so the same file
+ * builds for Linux (see host/).
+ */
+
+#include "net_perf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "cpu_load.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "net_perf";
+
+// ============================================================================
+// Wire format (all fields are 32-bit, big-endian)
+// ============================================================================
+
+#define WIRE_MAGIC      0x4e505246  // "NPRF"
+#define WIRE_VERSION    1
+
+// First message on every TCP connection
+#define KIND_CONTROL    1
+#define KIND_DATA       2
+
+// Server replies on the control connection
+#define REPLY_OK        0  // Parameters accepted, open the data streams
+#define REPLY_START     1  // All streams are set up, go
+#define REPLY_REJECTED  2
+
+// UDP datagram flags
+#define UDP_FLAG_HELLO  0x1  // Client announcing a stream's address (reverse)
+#define UDP_FLAG_FIN    0x2  // End of a stream, sent a few times
+
+#define UDP_FIN_COUNT   3
+
+// Datagrams sent per stream in one go when the sender has fallen behind
+#define UDP_MAX_BURST   16
+
+// A datagram is sent when it is due within this much, so pacing never
+// needs to sleep for less than a tick
+#define UDP_PACE_SLACK_US 1000
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint32_t cookie;       // Ties data streams to their control connection
+    uint32_t stream;       // KIND_DATA: stream index
+    uint32_t protocol;
+    uint32_t reverse;
+    uint32_t streams;
+    uint32_t buf_len;
+    uint32_t window;
+    uint32_t duration_ms;
+    uint32_t rate_kbps;
+} wire_hello_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t reply;
+} wire_reply_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t bytes_hi;
+    uint32_t bytes_lo;
+    uint32_t duration_us;
+    uint32_t packets;
+    uint32_t lost;
+    uint32_t out_of_order;
+    uint32_t jitter_us;
+    uint32_t send_stalls;
+    uint32_t cpu_count;
+    uint32_t cpu_permille[NET_PERF_MAX_CPUS];
+} wire_report_t;
+
+typedef struct {
+    uint32_t cookie;
+    uint32_t stream;
+    uint32_t seq;
+    uint32_t flags;
+    uint32_t ts_hi;        // Sender esp_timer_get_time()
+    uint32_t ts_lo;
+} wire_udp_t;
+
+/**
+ * @brief Convert a message between host and network byte order (in place)
+ */
+static void wire_swap(void *msg, size_t len) {
+    uint32_t *w = (uint32_t *)msg;
+    for (size_t i = 0; i < len / sizeof(uint32_t); i++) {
+        w[i] = htonl(w[i]);
+    }
+}
+
+// ============================================================================
+// Session state
+// ============================================================================
+
+typedef struct {
+    int fd;                      // TCP connection or client UDP socket, -1 if shared
+    struct sockaddr_in addr;     // UDP destination
+    bool done;                   // TCP: EOF seen. UDP: FIN seen.
+
+    // UDP sender
+    uint32_t seq;
+    int64_t next_send_us;
+
+    // UDP receiver
+    uint32_t next_seq;
+    uint32_t received;
+    uint32_t out_of_order;
+    bool have_transit;
+    int64_t last_transit_us;
+    float jitter_us;
+} stream_t;
+
+typedef struct {
+    net_perf_protocol_t protocol;
+    bool sender;
+    uint8_t streams;
+    uint32_t buf_len;
+    uint32_t window;
+    uint32_t duration_ms;
+    uint32_t rate_kbps;
+    uint32_t cookie;
+
+    int ctrl;
+    int udp_fd;                  // Server: one UDP socket for all streams
+    stream_t st[NET_PERF_MAX_STREAMS];
+    uint8_t *buf;
+
+    net_perf_interval_cb_t on_interval;
+    void *ctx;
+    uint32_t interval_ms;
+    int64_t start_us;
+    int64_t interval_start_us;
+    uint64_t interval_bytes;
+
+    cpu_load_mark_t cpu;
+    net_perf_side_t local;
+} session_t;
+
+static void session_init(session_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->ctrl = -1;
+    s->udp_fd = -1;
+    for (int i = 0; i < NET_PERF_MAX_STREAMS; i++) {
+        s->st[i].fd = -1;
+    }
+}
+
+static void session_close(session_t *s) {
+    for (int i = 0; i < NET_PERF_MAX_STREAMS; i++) {
+        if (s->st[i].fd >= 0) {
+            close(s->st[i].fd);
+        }
+    }
+    if (s->ctrl >= 0) {
+        close(s->ctrl);
+    }
+    free(s->buf);
+    s->buf = NULL;
+}
+
+/**
+ * @brief Validate parameters and fill in defaults
+ */
+static esp_err_t session_params(session_t *s, net_perf_protocol_t protocol, uint32_t streams,
+                                uint32_t buf_len, uint32_t duration_ms) {
+    if (protocol != NET_PERF_TCP && protocol != NET_PERF_UDP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s->protocol = protocol;
+    s->streams = streams == 0 ? 1 : streams;
+    s->buf_len = buf_len != 0 ? buf_len
+                 : protocol == NET_PERF_TCP ? NET_PERF_TCP_LEN : NET_PERF_UDP_LEN;
+    s->duration_ms = duration_ms == 0 ? NET_PERF_DURATION_MS : duration_ms;
+    if (streams > NET_PERF_MAX_STREAMS || s->buf_len > NET_PERF_MAX_LEN ||
+        s->buf_len < sizeof(wire_udp_t) || s->duration_ms > NET_PERF_MAX_DURATION_MS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s->buf = (uint8_t *)malloc(s->buf_len);
+    if (s->buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < s->buf_len; i++) {
+        s->buf[i] = (uint8_t)i;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Socket helpers
+// ============================================================================
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void set_window(int fd, uint32_t window) {
+    if (window == 0) {
+        return;
+    }
+    int size = (int)window;
+    // lwIP has no SO_SNDBUF, the send buffer is CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0) {
+        ESP_LOGD(TAG, "Socket buffer size not fully applied (errno %d)", errno);
+    }
+}
+
+/**
+ * @brief Wait until fd is readable
+ *
+ * @return true if readable, false on timeout or error
+ */
+static bool wait_readable(int fd, uint32_t timeout_ms) {
+    fd_set rd;
+    FD_ZERO(&rd);
+    FD_SET(fd, &rd);
+    struct timeval tv = {(time_t)(timeout_ms / 1000), (suseconds_t)(timeout_ms % 1000) * 1000};
+    return select(fd + 1, &rd, NULL, NULL, &tv) > 0;
+}
+
+static esp_err_t send_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0) {
+        int n = send(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t recv_all(int fd, void *data, size_t len, uint32_t timeout_ms) {
+    uint8_t *p = (uint8_t *)data;
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (len > 0) {
+        int64_t left_ms = (deadline - esp_timer_get_time()) / 1000;
+        if (left_ms <= 0 || !wait_readable(fd, (uint32_t)left_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        int n = recv(fd, p, len, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_msg(int fd, const void *msg, size_t len) {
+    uint32_t wire[16];
+    if (len > sizeof(wire)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(wire, msg, len);
+    wire_swap(wire, len);
+    return send_all(fd, wire, len);
+}
+
+static esp_err_t recv_msg(int fd, void *msg, size_t len, uint32_t timeout_ms) {
+    esp_err_t err = recv_all(fd, msg, len, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+    wire_swap(msg, len);
+    return *(uint32_t *)msg == WIRE_MAGIC ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+static esp_err_t send_reply(int fd, uint32_t reply) {
+    wire_reply_t msg = {WIRE_MAGIC, reply};
+    return send_msg(fd, &msg, sizeof(msg));
+}
+
+static esp_err_t recv_reply(int fd, uint32_t expected, uint32_t timeout_ms) {
+    wire_reply_t msg;
+    esp_err_t err = recv_msg(fd, &msg, sizeof(msg), timeout_ms);
+    if (err == ESP_OK && msg.reply != expected) {
+        err = ESP_ERR_INVALID_RESPONSE;
+    }
+    return err;
+}
+
+static void fill_udp_header(const session_t *s, int stream, uint32_t flags) {
+    int64_t now = esp_timer_get_time();
+    wire_udp_t hdr = {s->cookie, (uint32_t)stream, s->st[stream].seq, flags,
+                      (uint32_t)((uint64_t)now >> 32), (uint32_t)now};
+    wire_swap(&hdr, sizeof(hdr));
+    memcpy(s->buf, &hdr, sizeof(hdr));
+}
+
+static int udp_fd(const session_t *s, int stream) {
+    return s->udp_fd >= 0 ? s->udp_fd : s->st[stream].fd;
+}
+
+// ============================================================================
+// Data phase
+// ============================================================================
+
+/**
+ * @brief Account for transferred bytes and report progress when due
+ */
+static void progress(session_t *s, size_t bytes, int64_t now) {
+    s->interval_bytes += bytes;
+    if (s->on_interval == NULL || now - s->interval_start_us < (int64_t)s->interval_ms * 1000) {
+        return;
+    }
+
+    net_perf_interval_t iv;
+    iv.start_ms = (uint32_t)((s->interval_start_us - s->start_us) / 1000);
+    iv.end_ms = (uint32_t)((now - s->start_us) / 1000);
+    iv.bytes = s->interval_bytes;
+    iv.mbps = (float)(s->interval_bytes * 8) / (float)(now - s->interval_start_us);
+    s->on_interval(s->ctx, &iv);
+
+    s->interval_start_us = now;
+    s->interval_bytes = 0;
+}
+
+/**
+ * @brief select() timeout until the deadline or the next progress report
+ */
+static struct timeval wait_until(const session_t *s, int64_t now, int64_t deadline) {
+    int64_t wake = deadline;
+    if (s->on_interval != NULL) {
+        int64_t report = s->interval_start_us + (int64_t)s->interval_ms * 1000;
+        if (report < wake) {
+            wake = report;
+        }
+    }
+    int64_t us = wake > now ? wake - now : 0;
+    struct timeval tv = {(time_t)(us / 1000000), (suseconds_t)(us % 1000000)};
+    return tv;
+}
+
+static esp_err_t tcp_send(session_t *s) {
+    int64_t end = s->start_us + (int64_t)s->duration_ms * 1000;
+    int64_t now;
+
+    while ((now = esp_timer_get_time()) < end) {
+        fd_set wr;
+        FD_ZERO(&wr);
+        int max_fd = -1;
+        for (int i = 0; i < s->streams; i++) {
+            FD_SET(s->st[i].fd, &wr);
+            if (s->st[i].fd > max_fd) {
+                max_fd = s->st[i].fd;
+            }
+        }
+
+        struct timeval tv = wait_until(s, now, end);
+        int ready = select(max_fd + 1, NULL, &wr, NULL, &tv);
+        if (ready < 0 && errno != EINTR) {
+            return ESP_FAIL;
+        }
+
+        for (int i = 0; ready > 0 && i < s->streams; i++) {
+            if (!FD_ISSET(s->st[i].fd, &wr)) {
+                continue;
+            }
+            int n = send(s->st[i].fd, s->buf, s->buf_len, 0);
+            if (n > 0) {
+                s->local.bytes += n;
+                progress(s, n, esp_timer_get_time());
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ESP_LOGE(TAG, "Stream %d send failed (errno %d)", i, errno);
+                return ESP_FAIL;
+            }
+        }
+        progress(s, 0, esp_timer_get_time());
+    }
+
+    s->local.duration_us = (uint32_t)(now - s->start_us);
+    for (int i = 0; i < s->streams; i++) {
+        shutdown(s->st[i].fd, SHUT_WR);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t tcp_receive(session_t *s) {
+    int64_t deadline = s->start_us + ((int64_t)s->duration_ms + NET_PERF_GRACE_MS) * 1000;
+    int64_t last_us = s->start_us;
+    int open = s->streams;
+
+    while (open > 0) {
+        int64_t now = esp_timer_get_time();
+        if (now >= deadline) {
+            ESP_LOGW(TAG, "%d stream(s) still open at the deadline", open);
+            break;
+        }
+
+        fd_set rd;
+        FD_ZERO(&rd);
+        int max_fd = -1;
+        for (int i = 0; i < s->streams; i++) {
+            if (!s->st[i].done) {
+                FD_SET(s->st[i].fd, &rd);
+                if (s->st[i].fd > max_fd) {
+                    max_fd = s->st[i].fd;
+                }
+            }
+        }
+
+        struct timeval tv = wait_until(s, now, deadline);
+        int ready = select(max_fd + 1, &rd, NULL, NULL, &tv);
+        if (ready < 0 && errno != EINTR) {
+            return ESP_FAIL;
+        }
+
+        for (int i = 0; ready > 0 && i < s->streams; i++) {
+            stream_t *st = &s->st[i];
+            if (st->done || !FD_ISSET(st->fd, &rd)) {
+                continue;
+            }
+            int n = recv(st->fd, s->buf, s->buf_len, 0);
+            if (n > 0) {
+                last_us = esp_timer_get_time();
+                s->local.bytes += n;
+                progress(s, n, last_us);
+            } else if (n == 0) {
+                st->done = true;
+                open--;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ESP_LOGE(TAG, "Stream %d receive failed (errno %d)", i, errno);
+                return ESP_FAIL;
+            }
+        }
+        progress(s, 0, esp_timer_get_time());
+    }
+
+    s->local.duration_us = (uint32_t)(last_us - s->start_us);
+    return ESP_OK;
+}
+
+static esp_err_t udp_send(session_t *s) {
+    int64_t end = s->start_us + (int64_t)s->duration_ms * 1000;
+
+    // Gap between datagrams of one stream, 0 when unlimited
+    int64_t gap_us = 0;
+    if (s->rate_kbps > 0) {
+        gap_us = (int64_t)s->buf_len * 8 * 1000 * s->streams / s->rate_kbps;
+        if (gap_us == 0) {
+            gap_us = 1;
+        }
+    }
+    for (int i = 0; i < s->streams; i++) {
+        s->st[i].next_send_us = s->start_us;
+    }
+
+    int64_t now;
+    while ((now = esp_timer_get_time()) < end) {
+        int64_t wake = end;
+        bool stalled = true;
+
+        for (int i = 0; i < s->streams; i++) {
+            stream_t *st = &s->st[i];
+            for (int burst = 0; burst < UDP_MAX_BURST; burst++) {
+                if (gap_us > 0 && st->next_send_us > now + UDP_PACE_SLACK_US) {
+                    break;
+                }
+                fill_udp_header(s, i, 0);
+                int n = sendto(udp_fd(s, i), s->buf, s->buf_len, 0,
+                               (const struct sockaddr *)&st->addr, sizeof(st->addr));
+                if (n < 0) {
+                    // Out of buffers (lwIP reports ENOMEM): back off, not an error
+                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOMEM ||
+                        errno == ENOBUFS || errno == EINTR) {
+                        s->local.send_stalls++;
+                        break;
+                    }
+                    ESP_LOGE(TAG, "Stream %d sendto failed (errno %d)", i, errno);
+                    return ESP_FAIL;
+                }
+                stalled = false;
+                st->seq++;
+                st->next_send_us += gap_us;
+                s->local.bytes += n;
+                s->local.packets++;
+                progress(s, n, now);
+            }
+            if (gap_us > 0 && st->next_send_us < wake) {
+                wake = st->next_send_us;
+            }
+        }
+        progress(s, 0, now);
+
+        // usleep() below a tick busy-waits on the P4, so sleep whole ticks
+        now = esp_timer_get_time();
+        int64_t sleep_us = gap_us > 0 ? wake - now : (stalled ? 1000 : 0);
+        if (sleep_us >= 1000) {
+            usleep((useconds_t)(sleep_us - sleep_us % 1000));
+        }
+    }
+    s->local.duration_us = (uint32_t)(now - s->start_us);
+
+    for (int i = 0; i < s->streams; i++) {
+        for (int k = 0; k < UDP_FIN_COUNT; k++) {
+            fill_udp_header(s, i, UDP_FLAG_FIN);
+            sendto(udp_fd(s, i), s->buf, sizeof(wire_udp_t), 0,
+                   (const struct sockaddr *)&s->st[i].addr, sizeof(s->st[i].addr));
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Account for one received datagram
+ */
+static void udp_account(session_t *s, const wire_udp_t *hdr, int len, int64_t now) {
+    stream_t *st = &s->st[hdr->stream];
+    st->received++;
+    s->local.packets++;
+    s->local.bytes += len;
+
+    if (hdr->seq < st->next_seq) {
+        st->out_of_order++;
+    } else {
+        st->next_seq = hdr->seq + 1;
+    }
+
+    // RFC 3550 interarrival jitter. The clocks are not synchronized, but
+    // their offset cancels out in the difference of two transit times.
+    int64_t sent_us = (int64_t)(((uint64_t)hdr->ts_hi << 32) | hdr->ts_lo);
+    int64_t transit = now - sent_us;
+    if (st->have_transit) {
+        int64_t d = transit - st->last_transit_us;
+        if (d < 0) {
+            d = -d;
+        }
+        st->jitter_us += ((float)d - st->jitter_us) / 16.0f;
+    }
+    st->have_transit = true;
+    st->last_transit_us = transit;
+}
+
+static esp_err_t udp_receive(session_t *s) {
+    int64_t deadline = s->start_us + ((int64_t)s->duration_ms + NET_PERF_GRACE_MS) * 1000;
+    int64_t last_us = s->start_us;
+    int open = s->streams;
+
+    while (open > 0) {
+        int64_t now = esp_timer_get_time();
+        if (now >= deadline) {
+            ESP_LOGW(TAG, "No end marker from %d stream(s)", open);
+            break;
+        }
+
+        fd_set rd;
+        FD_ZERO(&rd);
+        int max_fd = -1;
+        int fd_count = s->udp_fd >= 0 ? 1 : s->streams;
+        for (int i = 0; i < fd_count; i++) {
+            int fd = udp_fd(s, i);
+            FD_SET(fd, &rd);
+            if (fd > max_fd) {
+                max_fd = fd;
+            }
+        }
+
+        struct timeval tv = wait_until(s, now, deadline);
+        int ready = select(max_fd + 1, &rd, NULL, NULL, &tv);
+        if (ready < 0 && errno != EINTR) {
+            return ESP_FAIL;
+        }
+
+        for (int i = 0; ready > 0 && i < fd_count; i++) {
+            int fd = udp_fd(s, i);
+            if (!FD_ISSET(fd, &rd)) {
+                continue;
+            }
+            // Drain what is queued before going back to select()
+            for (;;) {
+                int n = recv(fd, s->buf, s->buf_len, 0);
+                if (n < 0) {
+                    break;
+                }
+                now = esp_timer_get_time();
+                if (n < (int)sizeof(wire_udp_t)) {
+                    continue;
+                }
+                wire_udp_t hdr;
+                memcpy(&hdr, s->buf, sizeof(hdr));
+                wire_swap(&hdr, sizeof(hdr));
+                if (hdr.cookie != s->cookie || hdr.stream >= s->streams ||
+                    (hdr.flags & UDP_FLAG_HELLO)) {
+                    continue;
+                }
+                if (hdr.flags & UDP_FLAG_FIN) {
+                    if (!s->st[hdr.stream].done) {
+                        s->st[hdr.stream].done = true;
+                        open--;
+                    }
+                    continue;
+                }
+                udp_account(s, &hdr, n, now);
+                last_us = now;
+                progress(s, n, now);
+            }
+        }
+        progress(s, 0, esp_timer_get_time());
+    }
+
+    s->local.duration_us = (uint32_t)(last_us - s->start_us);
+
+    float jitter = 0;
+    int jitter_streams = 0;
+    for (int i = 0; i < s->streams; i++) {
+        stream_t *st = &s->st[i];
+        if (st->next_seq > st->received) {
+            s->local.lost += st->next_seq - st->received;
+        }
+        s->local.out_of_order += st->out_of_order;
+        if (st->have_transit) {
+            jitter += st->jitter_us;
+            jitter_streams++;
+        }
+    }
+    s->local.jitter_us = jitter_streams > 0 ? (uint32_t)(jitter / jitter_streams) : 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief Run the data phase, starting now
+ */
+static esp_err_t session_transfer(session_t *s) {
+    cpu_load_start(&s->cpu);
+    s->start_us = esp_timer_get_time();
+    s->interval_start_us = s->start_us;
+
+    // Mark the start of the test for the UI
+    if (s->on_interval != NULL) {
+        net_perf_interval_t iv = {};
+        s->on_interval(s->ctx, &iv);
+    }
+
+    esp_err_t err;
+    if (s->protocol == NET_PERF_TCP) {
+        err = s->sender ? tcp_send(s) : tcp_receive(s);
+    } else {
+        err = s->sender ? udp_send(s) : udp_receive(s);
+    }
+
+    if (s->on_interval != NULL && s->interval_bytes > 0) {
+        // Flush the last partial interval
+        uint32_t interval_ms = s->interval_ms;
+        s->interval_ms = 0;
+        progress(s, 0, esp_timer_get_time());
+        s->interval_ms = interval_ms;
+    }
+
+    s->local.cpu_count = (uint8_t)cpu_load_get(&s->cpu, s->local.cpu_permille,
+                                               NET_PERF_MAX_CPUS);
+    return err;
+}
+
+// ============================================================================
+// Reports
+// ============================================================================
+
+static esp_err_t send_report(const session_t *s) {
+    const net_perf_side_t *l = &s->local;
+    wire_report_t msg = {};
+    msg.magic = WIRE_MAGIC;
+    msg.bytes_hi = (uint32_t)(l->bytes >> 32);
+    msg.bytes_lo = (uint32_t)l->bytes;
+    msg.duration_us = l->duration_us;
+    msg.packets = l->packets;
+    msg.lost = l->lost;
+    msg.out_of_order = l->out_of_order;
+    msg.jitter_us = l->jitter_us;
+    msg.send_stalls = l->send_stalls;
+    msg.cpu_count = l->cpu_count;
+    for (int i = 0; i < NET_PERF_MAX_CPUS; i++) {
+        msg.cpu_permille[i] = l->cpu_permille[i];
+    }
+    return send_msg(s->ctrl, &msg, sizeof(msg));
+}
+
+static esp_err_t recv_report(const session_t *s, net_perf_side_t *remote) {
+    wire_report_t msg;
+    esp_err_t err = recv_msg(s->ctrl, &msg, sizeof(msg),
+                             NET_PERF_GRACE_MS + NET_PERF_SETUP_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        return err;
+    }
+    remote->bytes = ((uint64_t)msg.bytes_hi << 32) | msg.bytes_lo;
+    remote->duration_us = msg.duration_us;
+    remote->packets = msg.packets;
+    remote->lost = msg.lost;
+    remote->out_of_order = msg.out_of_order;
+    remote->jitter_us = msg.jitter_us;
+    remote->send_stalls = msg.send_stalls;
+    remote->cpu_count = msg.cpu_count > NET_PERF_MAX_CPUS ? NET_PERF_MAX_CPUS : msg.cpu_count;
+    for (int i = 0; i < NET_PERF_MAX_CPUS; i++) {
+        remote->cpu_permille[i] = (uint16_t)msg.cpu_permille[i];
+    }
+    return ESP_OK;
+}
+
+static float side_mbps(const net_perf_side_t *side) {
+    return side->duration_us > 0 ? (float)(side->bytes * 8) / (float)side->duration_us : 0;
+}
+
+static void result_fill(const session_t *s, const net_perf_side_t *remote,
+                        const struct sockaddr_in *peer, net_perf_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->protocol = s->protocol;
+    out->sender = s->sender;
+    out->streams = s->streams;
+    out->buf_len = s->buf_len;
+    inet_ntop(AF_INET, &peer->sin_addr, out->peer, sizeof(out->peer));
+    out->local = s->local;
+    out->remote = *remote;
+    out->mbps = side_mbps(s->sender ? remote : &s->local);
+    out->send_mbps = side_mbps(s->sender ? &s->local : remote);
+}
+
+// ============================================================================
+// Client
+// ============================================================================
+
+static esp_err_t resolve(const char *host, uint16_t port, struct sockaddr_in *addr) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memcpy(addr, res->ai_addr, sizeof(*addr));
+    addr->sin_port = htons(port);
+    freeaddrinfo(res);
+    return ESP_OK;
+}
+
+static int tcp_connect(const struct sockaddr_in *addr) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Announce the client's UDP streams until the server says start
+ */
+static esp_err_t udp_announce(session_t *s) {
+    int64_t deadline = esp_timer_get_time() + (int64_t)NET_PERF_SETUP_TIMEOUT_MS * 1000;
+    while (esp_timer_get_time() < deadline) {
+        for (int i = 0; i < s->streams; i++) {
+            fill_udp_header(s, i, UDP_FLAG_HELLO);
+            sendto(s->st[i].fd, s->buf, sizeof(wire_udp_t), 0,
+                   (const struct sockaddr *)&s->st[i].addr, sizeof(s->st[i].addr));
+        }
+        if (wait_readable(s->ctrl, 100)) {
+            return recv_reply(s->ctrl, REPLY_START, NET_PERF_SETUP_TIMEOUT_MS);
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Open the data streams and wait for the server's start signal
+ */
+static esp_err_t client_open_streams(session_t *s, const struct sockaddr_in *server) {
+    for (int i = 0; i < s->streams; i++) {
+        stream_t *st = &s->st[i];
+        st->addr = *server;
+
+        if (s->protocol == NET_PERF_TCP) {
+            st->fd = tcp_connect(server);
+            if (st->fd < 0) {
+                return ESP_FAIL;
+            }
+            set_window(st->fd, s->window);
+            wire_hello_t hello = {};
+            hello.magic = WIRE_MAGIC;
+            hello.version = WIRE_VERSION;
+            hello.kind = KIND_DATA;
+            hello.cookie = s->cookie;
+            hello.stream = i;
+            esp_err_t err = send_msg(st->fd, &hello, sizeof(hello));
+            if (err != ESP_OK) {
+                return err;
+            }
+        } else {
+            st->fd = socket(AF_INET, SOCK_DGRAM, 0);
+            if (st->fd < 0) {
+                return ESP_ERR_NO_MEM;
+            }
+            set_window(st->fd, s->window);
+        }
+        set_nonblocking(st->fd);
+    }
+
+    if (s->protocol == NET_PERF_UDP && !s->sender) {
+        return udp_announce(s);
+    }
+    return recv_reply(s->ctrl, REPLY_START, NET_PERF_SETUP_TIMEOUT_MS);
+}
+
+esp_err_t net_perf_run(const net_perf_config_t *cfg, net_perf_result_t *out) {
+    if (cfg == NULL || cfg->host == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    session_t s;
+    session_init(&s);
+    esp_err_t err = session_params(&s, cfg->protocol, cfg->streams, cfg->buf_len,
+                                   cfg->duration_ms);
+    if (err != ESP_OK) {
+        session_close(&s);
+        return err;
+    }
+    s.sender = !cfg->reverse;
+    s.window = cfg->window;
+    s.rate_kbps = cfg->protocol == NET_PERF_UDP ? cfg->rate_kbps : 0;
+    s.on_interval = cfg->on_interval;
+    s.ctx = cfg->ctx;
+    s.interval_ms = cfg->interval_ms == 0 ? 1000 : cfg->interval_ms;
+    s.cookie = (uint32_t)esp_timer_get_time() ^ ((uint32_t)rand() << 8);
+
+    struct sockaddr_in server;
+    err = resolve(cfg->host, cfg->port == 0 ? NET_PERF_DEFAULT_PORT : cfg->port, &server);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot resolve %s", cfg->host);
+        session_close(&s);
+        return err;
+    }
+
+    s.ctrl = tcp_connect(&server);
+    if (s.ctrl < 0) {
+        ESP_LOGE(TAG, "Cannot connect to %s:%u (errno %d)", cfg->host, ntohs(server.sin_port),
+                 errno);
+        session_close(&s);
+        return ESP_FAIL;
+    }
+
+    wire_hello_t hello = {};
+    hello.magic = WIRE_MAGIC;
+    hello.version = WIRE_VERSION;
+    hello.kind = KIND_CONTROL;
+    hello.cookie = s.cookie;
+    hello.protocol = s.protocol;
+    hello.reverse = cfg->reverse;
+    hello.streams = s.streams;
+    hello.buf_len = s.buf_len;
+    hello.window = s.window;
+    hello.duration_ms = s.duration_ms;
+    hello.rate_kbps = s.rate_kbps;
+
+    err = send_msg(s.ctrl, &hello, sizeof(hello));
+    if (err == ESP_OK) {
+        err = recv_reply(s.ctrl, REPLY_OK, NET_PERF_SETUP_TIMEOUT_MS);
+    }
+    if (err == ESP_OK) {
+        err = client_open_streams(&s, &server);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Test setup with %s failed: %s", cfg->host, esp_err_to_name(err));
+        session_close(&s);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "%s %s test with %s: %u stream(s) x %lu bytes, %lu ms",
+             s.protocol == NET_PERF_TCP ? "TCP" : "UDP", s.sender ? "send" : "receive",
+             cfg->host, s.streams, (unsigned long)s.buf_len, (unsigned long)s.duration_ms);
+
+    err = session_transfer(&s);
+
+    // The client reports first, the server answers with its own
+    net_perf_side_t remote = {};
+    if (err == ESP_OK) {
+        err = send_report(&s);
+    }
+    if (err == ESP_OK) {
+        err = recv_report(&s, &remote);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Test with %s failed: %s", cfg->host, esp_err_to_name(err));
+    } else if (out != NULL) {
+        result_fill(&s, &remote, &server, out);
+    }
+
+    session_close(&s);
+    return err;
+}
+
+// ============================================================================
+// Server
+// ============================================================================
+
+/**
+ * @brief Accept a TCP connection and read its hello
+ *
+ * @return Connected socket, or -1 on timeout/error
+ */
+static int accept_hello(int listen_fd, wire_hello_t *hello, struct sockaddr_in *peer,
+                        uint32_t timeout_ms) {
+    if (timeout_ms > 0 && !wait_readable(listen_fd, timeout_ms)) {
+        return -1;
+    }
+    socklen_t len = sizeof(*peer);
+    int fd = accept(listen_fd, (struct sockaddr *)peer, &len);
+    if (fd < 0) {
+        return -1;
+    }
+    esp_err_t err = recv_msg(fd, hello, sizeof(*hello), NET_PERF_SETUP_TIMEOUT_MS);
+    if (err != ESP_OK || hello->version != WIRE_VERSION) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Accept the data connections (TCP) or stream addresses (UDP)
+ */
+static esp_err_t server_open_streams(session_t *s, int listen_fd) {
+    if (s->protocol == NET_PERF_TCP) {
+        int open = 0;
+        while (open < s->streams) {
+            wire_hello_t hello;
+            struct sockaddr_in peer;
+            int fd = accept_hello(listen_fd, &hello, &peer, NET_PERF_SETUP_TIMEOUT_MS);
+            if (fd < 0) {
+                return ESP_ERR_TIMEOUT;
+            }
+            if (hello.kind != KIND_DATA || hello.cookie != s->cookie ||
+                hello.stream >= s->streams || s->st[hello.stream].fd >= 0) {
+                // Another client or a stale connection, we are busy
+                close(fd);
+                continue;
+            }
+            set_window(fd, s->window);
+            set_nonblocking(fd);
+            s->st[hello.stream].fd = fd;
+            open++;
+        }
+        return ESP_OK;
+    }
+
+    if (!s->sender) {
+        return ESP_OK;
+    }
+
+    // Reverse UDP: learn where to send each stream from its hello
+    bool announced[NET_PERF_MAX_STREAMS] = {};
+    int known = 0;
+    int64_t deadline = esp_timer_get_time() + (int64_t)NET_PERF_SETUP_TIMEOUT_MS * 1000;
+    while (known < s->streams) {
+        int64_t left_ms = (deadline - esp_timer_get_time()) / 1000;
+        if (left_ms <= 0 || !wait_readable(s->udp_fd, (uint32_t)left_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        struct sockaddr_in from;
+        socklen_t len = sizeof(from);
+        int n = recvfrom(s->udp_fd, s->buf, s->buf_len, 0, (struct sockaddr *)&from, &len);
+        if (n < (int)sizeof(wire_udp_t)) {
+            continue;
+        }
+        wire_udp_t hdr;
+        memcpy(&hdr, s->buf, sizeof(hdr));
+        wire_swap(&hdr, sizeof(hdr));
+        if (hdr.cookie == s->cookie && (hdr.flags & UDP_FLAG_HELLO) &&
+            hdr.stream < s->streams && !announced[hdr.stream]) {
+            s->st[hdr.stream].addr = from;
+            announced[hdr.stream] = true;
+            known++;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Serve one test on an accepted control connection
+ */
+static esp_err_t server_session(const net_perf_server_config_t *cfg, int listen_fd, int udp,
+                                int ctrl, const wire_hello_t *hello,
+                                const struct sockaddr_in *peer) {
+    session_t s;
+    session_init(&s);
+    s.ctrl = ctrl;
+
+    esp_err_t err = ESP_ERR_INVALID_RESPONSE;
+    if (hello->kind == KIND_CONTROL) {
+        err = session_params(&s, (net_perf_protocol_t)hello->protocol, hello->streams,
+                             hello->buf_len, hello->duration_ms);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Rejecting test request: %s", esp_err_to_name(err));
+        send_reply(ctrl, REPLY_REJECTED);
+        session_close(&s);
+        return err;
+    }
+    s.sender = hello->reverse != 0;
+    s.window = hello->window;
+    s.rate_kbps = hello->rate_kbps;
+    s.cookie = hello->cookie;
+    s.on_interval = cfg->on_interval;
+    s.ctx = cfg->ctx;
+    s.interval_ms = cfg->interval_ms == 0 ? 1000 : cfg->interval_ms;
+    if (s.protocol == NET_PERF_UDP) {
+        s.udp_fd = udp;
+        // Drop leftovers of an earlier test
+        while (recv(udp, s.buf, s.buf_len, 0) >= 0) {
+        }
+    }
+
+    err = send_reply(ctrl, REPLY_OK);
+    if (err == ESP_OK) {
+        err = server_open_streams(&s, listen_fd);
+    }
+    if (err == ESP_OK) {
+        err = send_reply(ctrl, REPLY_START);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Test setup failed: %s", esp_err_to_name(err));
+        session_close(&s);
+        return err;
+    }
+
+    char peer_ip[16];
+    inet_ntop(AF_INET, &peer->sin_addr, peer_ip, sizeof(peer_ip));
+    ESP_LOGI(TAG, "%s %s test from %s: %u stream(s) x %lu bytes, %lu ms",
+             s.protocol == NET_PERF_TCP ? "TCP" : "UDP", s.sender ? "send" : "receive", peer_ip,
+             s.streams, (unsigned long)s.buf_len, (unsigned long)s.duration_ms);
+
+    err = session_transfer(&s);
+
+    net_perf_side_t remote = {};
+    if (err == ESP_OK) {
+        err = recv_report(&s, &remote);
+    }
+    if (err == ESP_OK) {
+        err = send_report(&s);
+    }
+    if (err == ESP_OK && cfg->on_result != NULL) {
+        net_perf_result_t result;
+        result_fill(&s, &remote, peer, &result);
+        cfg->on_result(cfg->ctx, &result);
+    }
+
+    session_close(&s);
+    return err;
+}
+
+esp_err_t net_perf_serve(const net_perf_server_config_t *cfg) {
+    if (cfg == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(cfg->port == 0 ? NET_PERF_DEFAULT_PORT : cfg->port);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    int one = 1;
+    if (listen_fd >= 0) {
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (listen_fd < 0 || udp < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, NET_PERF_MAX_STREAMS + 1) != 0 ||
+        bind(udp, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %u (errno %d)", ntohs(addr.sin_port), errno);
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        if (udp >= 0) {
+            close(udp);
+        }
+        return ESP_FAIL;
+    }
+    set_nonblocking(udp);
+
+    ESP_LOGI(TAG, "Listening on TCP/UDP port %u", ntohs(addr.sin_port));
+
+    for (uint32_t served = 0; cfg->sessions == 0 || served < cfg->sessions;) {
+        wire_hello_t hello;
+        struct sockaddr_in peer;
+        int ctrl = accept_hello(listen_fd, &hello, &peer, 0);
+        if (ctrl < 0) {
+            continue;
+        }
+        // A data connection without a test is a leftover of a failed one
+        if (hello.kind != KIND_CONTROL) {
+            close(ctrl);
+            continue;
+        }
+        server_session(cfg, listen_fd, udp, ctrl, &hello, &peer);
+        served++;
+    }
+
+    close(udp);
+    close(listen_fd);
+    return ESP_OK;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file net_perf.h
+ * @brief iperf-style TCP/UDP throughput test
+ *
+ * Measures what the P4 actually gets through the C6 (ESP-HOSTED over
+ * SDIO) by streaming data to or from a peer. One side runs
+ * net_perf_serve(), the other net_perf_run(); the peer program in host/
+ * builds the same code for Linux, so either end can be the device or a PC.
+ *
+ * A test uses one TCP control connection on the port plus one data
+ * connection (TCP) or socket (UDP, same port number) per stream. All
+ * streams of a test run in the calling task, multiplexed with select().
+ * At the end both sides exchange reports, so each result carries the
+ * sender's and the receiver's view, including the CPU load of each.
+ *
+ * UDP datagrams carry a sequence number and a send timestamp; the receiver
+ * reports loss, reordering and RFC 3550 interarrival jitter.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NET_PERF_DEFAULT_PORT     5201
+
+// Parallel streams per test
+#define NET_PERF_MAX_STREAMS      8
+
+// Defaults for a zero buf_len: one lwIP send window chunk for TCP, one
+// unfragmented datagram for UDP
+#define NET_PERF_TCP_LEN          16384
+#define NET_PERF_UDP_LEN          1470
+#define NET_PERF_MAX_LEN          65507
+
+#define NET_PERF_DURATION_MS      10000
+#define NET_PERF_MAX_DURATION_MS  3600000
+
+// Time allowed for connection setup and for the receiver to drain
+#define NET_PERF_SETUP_TIMEOUT_MS 5000
+#define NET_PERF_GRACE_MS         3000
+
+// CPU cores reported per side
+#define NET_PERF_MAX_CPUS         2
+
+typedef enum {
+    NET_PERF_TCP,
+    NET_PERF_UDP,
+} net_perf_protocol_t;
+
+/**
+ * @brief Progress of the running test on this side
+ */
+typedef struct {
+    uint32_t start_ms;  // Interval start, relative to the test start
+    uint32_t end_ms;
+    uint64_t bytes;     // Sent or received in the interval
+    float mbps;
+} net_perf_interval_t;
+
+// Also called once with an empty interval when the data phase starts
+typedef void (*net_perf_interval_cb_t)(void *ctx, const net_perf_interval_t *interval);
+
+/**
+ * @brief Measurements of one side of a test
+ */
+typedef struct {
+    uint64_t bytes;          // Payload sent or received, UDP headers included
+    uint32_t duration_us;    // Test start to last byte sent or received
+    uint32_t packets;        // UDP datagrams
+    uint32_t lost;           // UDP receiver: sequence numbers never seen
+    uint32_t out_of_order;   // UDP receiver
+    uint32_t jitter_us;      // UDP receiver: mean over streams
+    uint32_t send_stalls;    // UDP sender: datagrams refused by the stack
+    uint8_t cpu_count;       // 0 if CPU load is not available
+    uint16_t cpu_permille[NET_PERF_MAX_CPUS];  // Load per core (per process on Linux)
+} net_perf_side_t;
+
+/**
+ * @brief Result of a test
+ */
+typedef struct {
+    net_perf_protocol_t protocol;
+    bool sender;             // This side sent the data
+    uint8_t streams;
+    uint32_t buf_len;
+    char peer[16];           // Peer IPv4 address
+    net_perf_side_t local;
+    net_perf_side_t remote;  // As reported by the peer
+    float mbps;              // Receiver throughput
+    float send_mbps;         // Sender throughput
+} net_perf_result_t;
+
+/**
+ * @brief Client-side test parameters
+ *
+ * Zero-initialize and set what you need: zero fields take the defaults.
+ */
+typedef struct {
+    const char *host;               // Server name or IPv4 address
+    uint16_t port;                  // 0: NET_PERF_DEFAULT_PORT
+    net_perf_protocol_t protocol;
+    bool reverse;                   // Server sends, client receives
+    uint8_t streams;                // 0: 1
+    uint32_t buf_len;               // Bytes per send()/datagram, 0: protocol default
+    uint32_t window;                // SO_SNDBUF/SO_RCVBUF, 0: stack default
+    uint32_t duration_ms;           // 0: NET_PERF_DURATION_MS
+    uint32_t rate_kbps;             // UDP target rate over all streams, 0: unlimited
+    uint32_t interval_ms;           // Progress period, 0: 1000
+    net_perf_interval_cb_t on_interval;  // Optional
+    void *ctx;
+} net_perf_config_t;
+
+/**
+ * @brief Server parameters
+ */
+typedef struct {
+    uint16_t port;                  // 0: NET_PERF_DEFAULT_PORT
+    uint32_t sessions;              // Return after this many tests, 0: serve forever
+    uint32_t interval_ms;           // Progress period, 0: 1000
+    net_perf_interval_cb_t on_interval;  // Optional
+    void (*on_result)(void *ctx, const net_perf_result_t *result);  // Optional
+    void *ctx;
+} net_perf_server_config_t;
+
+/**
+ * @brief Run one test against a server
+ *
+ * Blocks for the test duration plus setup.
+ *
+ * @param cfg: Test parameters
+ * @param out: Result, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Test completed
+ *    - ESP_ERR_INVALID_ARG: Invalid parameters
+ *    - ESP_ERR_NOT_FOUND: Host does not resolve
+ *    - ESP_ERR_NO_MEM: Out of memory or sockets
+ *    - ESP_ERR_TIMEOUT: Peer stopped responding
+ *    - ESP_ERR_INVALID_RESPONSE: Peer rejected the test or spoke another protocol
+ *    - ESP_FAIL: Connection failed
+ */
+esp_err_t net_perf_run(const net_perf_config_t *cfg, net_perf_result_t *out);
+
+/**
+ * @brief Serve tests, one at a time
+ *
+ * Blocks until cfg->sessions tests have run (forever if 0). A failed test
+ * is logged and does not stop the server.
+ *
+ * @param cfg: Server parameters
+ *
+ * @return
+ *    - ESP_OK: cfg->sessions tests served
+ *    - ESP_ERR_INVALID_ARG: cfg is NULL
+ *    - ESP_FAIL: Could not open the listening sockets
+ */
+esp_err_t net_perf_serve(const net_perf_server_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
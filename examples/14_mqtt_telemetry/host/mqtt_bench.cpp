@@ -0,0 +1,351 @@
+/**
+ * @file mqtt_bench.cpp
+ * @brief Linux bench for the MQTT client and spool of the telemetry example
+ *
+ * Publish mode measures what batching buys: the same messages are sent
+ * one packet per write and in batches, at QoS 0 and 1, against a real
+ * broker. A second connection subscribes to the topic and checks that
+ * every message arrives.
+ *
+ * Spool mode exercises src/mqtt_spool.cpp on a local file: ordering,
+ * wrap-around with dropping of the oldest messages, consume, reopen, and
+ * recovery of messages appended after the last header sync.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -o mqtt_bench host/mqtt_bench.cpp \
+ *       src/mqtt_client.cpp src/mqtt_spool.cpp
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "mqtt_spool.h"
+
+int esp_log_verbose = 0;
+
+#define MAX_BATCH 64
+
+// The subscriber skips packets larger than its receive buffer
+#define MAX_PAYLOAD (MQTT_CLIENT_RX_BUF - 64)
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s -h <broker> [options]   publish benchmark\n"
+            "       %s -S <file>               spool self-test\n"
+            "\n"
+            "  -p <port>     Broker port (default %d)\n"
+            "  -n <count>    Messages per run (default 2000)\n"
+            "  -s <bytes>    Payload size (default 64, max %d)\n"
+            "  -q <qos>      Only run this QoS (default 0 and 1)\n"
+            "  -b <n>        Only run this batch size (default 1 and 16, max %d)\n"
+            "  -v            Log client steps (-vv for more)\n",
+            prog, prog, MQTT_DEFAULT_PORT, MAX_PAYLOAD, MAX_BATCH);
+}
+
+// ============================================================================
+// Publish benchmark
+// ============================================================================
+
+typedef struct {
+    uint32_t acked;
+    uint32_t received;
+    uint32_t bad;
+    size_t payload_len;
+} bench_ctx_t;
+
+static void on_puback(void *ctx, uint16_t packet_id) {
+    (void)packet_id;
+    ((bench_ctx_t *)ctx)->acked++;
+}
+
+static void on_message(void *ctx, const char *topic, const uint8_t *payload, size_t len) {
+    (void)topic;
+    (void)payload;
+    bench_ctx_t *b = (bench_ctx_t *)ctx;
+    b->received++;
+    if (len != b->payload_len) {
+        b->bad++;
+    }
+}
+
+static int run_bench(const char *host, uint16_t port, uint32_t count, size_t size, uint8_t qos,
+                     int batch) {
+    char topic[64];
+    snprintf(topic, sizeof(topic), "bench/%d/q%u/b%d", (int)getpid(), qos, batch);
+    char pub_id[32], sub_id[32];
+    snprintf(pub_id, sizeof(pub_id), "bench-pub-%d", (int)getpid());
+    snprintf(sub_id, sizeof(sub_id), "bench-sub-%d", (int)getpid());
+
+    mqtt_client_config_t cfg = {};
+    cfg.host = host;
+    cfg.port = port;
+    cfg.keepalive_s = 30;
+
+    mqtt_client_t *pub = NULL;
+    mqtt_client_t *sub = NULL;
+    cfg.client_id = sub_id;
+    if (mqtt_client_connect(&cfg, &sub) != ESP_OK) {
+        fprintf(stderr, "Cannot connect to %s:%u\n", host, port);
+        return 2;
+    }
+    cfg.client_id = pub_id;
+    if (mqtt_client_connect(&cfg, &pub) != ESP_OK) {
+        mqtt_client_close(sub);
+        return 2;
+    }
+
+    bench_ctx_t ctx = {};
+    ctx.payload_len = size;
+    mqtt_client_handlers_t handlers = {};
+    handlers.on_puback = on_puback;
+    handlers.on_message = on_message;
+    handlers.ctx = &ctx;
+
+    // QoS 0 delivery to the subscriber, only the publisher side is measured
+    mqtt_client_subscribe(sub, topic, 0);
+    mqtt_client_poll(sub, 200, &handlers);
+
+    uint8_t *payload = (uint8_t *)malloc(size);
+    memset(payload, 'x', size);
+    mqtt_message_t msgs[MAX_BATCH];
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = ESP_OK;
+    for (uint32_t sent = 0; sent < count && err == ESP_OK;) {
+        int n = count - sent < (uint32_t)batch ? count - sent : batch;
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < n; i++) {
+            msgs[i].topic = topic;
+            msgs[i].payload = payload;
+            msgs[i].len = size;
+            msgs[i].qos = qos;
+        }
+        err = mqtt_client_publish(pub, msgs, n);
+        sent += n;
+
+        // Keep both sockets drained so the broker never blocks on us
+        if (err == ESP_OK) {
+            err = mqtt_client_poll(pub, 0, &handlers);
+        }
+        if (err == ESP_OK) {
+            err = mqtt_client_poll(sub, 0, &handlers);
+        }
+    }
+    int64_t sent_us = esp_timer_get_time() - start;
+
+    int64_t deadline = esp_timer_get_time() + 10000000;
+    while (err == ESP_OK && (ctx.received < count || (qos > 0 && ctx.acked < count)) &&
+           esp_timer_get_time() < deadline) {
+        err = mqtt_client_poll(pub, 5, &handlers);
+        if (err == ESP_OK) {
+            err = mqtt_client_poll(sub, 5, &handlers);
+        }
+    }
+    int64_t done_us = esp_timer_get_time() - start;
+
+    mqtt_client_counters_t c;
+    mqtt_client_get_counters(pub, &c);
+    printf("QoS %u  batch %3d  %6lu msgs  %5.0f ms  %8.0f msg/s  %6lu writes  %5.1f msg/write"
+           "  %4.1f B/msg  acked %lu  received %lu%s\n",
+           qos, batch, (unsigned long)count, done_us / 1000.0, count * 1e6 / done_us,
+           (unsigned long)c.writes, (double)c.publishes / (c.writes ? c.writes : 1),
+           (double)c.bytes_sent / count, (unsigned long)ctx.acked, (unsigned long)ctx.received,
+           err != ESP_OK ? "  CONNECTION FAILED" : ctx.bad ? "  BAD LENGTH" : "");
+    if (esp_log_verbose) {
+        printf("    handed to the socket in %.0f ms\n", sent_us / 1000.0);
+    }
+
+    free(payload);
+    mqtt_client_close(pub);
+    mqtt_client_close(sub);
+    bool ok = err == ESP_OK && ctx.bad == 0 && ctx.received == count &&
+              (qos == 0 || ctx.acked == count);
+    return ok ? 0 : 1;
+}
+
+// ============================================================================
+// Spool self-test
+// ============================================================================
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            return 1;                                                        \
+        }                                                                    \
+    } while (0)
+
+static esp_err_t append_n(mqtt_spool_t *s, uint32_t first, uint32_t n, size_t size) {
+    uint8_t payload[MQTT_SPOOL_MAX_PAYLOAD];
+    for (uint32_t i = first; i < first + n; i++) {
+        char topic[32];
+        snprintf(topic, sizeof(topic), "t/%lu", (unsigned long)i);
+        // Payload length varies so records wrap at odd places
+        size_t len = size + i % 7;
+        memset(payload, (uint8_t)i, len);
+        esp_err_t err = mqtt_spool_append(s, topic, payload, len, i % 2);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Check that the spool holds messages first..first+n-1 in order
+ */
+static int expect_range(mqtt_spool_t *s, uint32_t first, uint32_t n, size_t size) {
+    mqtt_spool_info_t info;
+    mqtt_spool_get_info(s, &info);
+    CHECK(info.count == n);
+
+    // Read everything without consuming, then check
+    mqtt_spool_record_t *recs = (mqtt_spool_record_t *)malloc(n * sizeof(mqtt_spool_record_t) + 1);
+    size_t got = 0;
+    CHECK(mqtt_spool_peek(s, recs, n, &got) == ESP_OK);
+    CHECK(got == n);
+    for (uint32_t i = 0; i < n; i++) {
+        char topic[32];
+        snprintf(topic, sizeof(topic), "t/%lu", (unsigned long)(first + i));
+        CHECK(strcmp(recs[i].topic, topic) == 0);
+        CHECK(recs[i].len == size + (first + i) % 7);
+        CHECK(recs[i].payload[0] == (uint8_t)(first + i));
+        CHECK(recs[i].qos == (first + i) % 2);
+    }
+    free(recs);
+    return 0;
+}
+
+static int spool_test(const char *path) {
+    const uint32_t capacity = 64 * 1024;
+    const size_t size = 100;
+    mqtt_spool_t *s = NULL;
+    mqtt_spool_info_t info;
+    unlink(path);
+
+    // Append, reopen, read back in order
+    CHECK(mqtt_spool_open(path, capacity, &s) == ESP_OK);
+    CHECK(append_n(s, 0, 200, size) == ESP_OK);
+    mqtt_spool_close(s);
+    CHECK(mqtt_spool_open(path, capacity, &s) == ESP_OK);
+    CHECK(expect_range(s, 0, 200, size) == 0);
+    printf("reopen:    200 messages back in order\n");
+
+    // Consume some, the rest stays
+    mqtt_spool_record_t rec;
+    size_t got = 0;
+    CHECK(mqtt_spool_peek(s, &rec, 1, &got) == ESP_OK && got == 1);
+    CHECK(mqtt_spool_consume(s, rec.seq + 49) == ESP_OK);
+    CHECK(expect_range(s, 50, 150, size) == 0);
+    printf("consume:   50 removed, 150 left\n");
+
+    // Overfill: the oldest messages are dropped, the newest kept in order
+    CHECK(append_n(s, 200, 2000, size) == ESP_OK);
+    mqtt_spool_get_info(s, &info);
+    CHECK(info.dropped > 0);
+    CHECK(info.used <= info.capacity);
+    uint32_t kept = info.count;
+    CHECK(expect_range(s, 2200 - kept, kept, size) == 0);
+    printf("wrap:      %lu kept, %lu dropped, %lu/%lu bytes used\n", (unsigned long)kept,
+           (unsigned long)info.dropped, (unsigned long)info.used, (unsigned long)info.capacity);
+
+    // Drain completely and refill across the wrap point
+    CHECK(mqtt_spool_consume(s, 0xFFFFFFFF >> 1) == ESP_OK);
+    mqtt_spool_get_info(s, &info);
+    CHECK(info.count == 0 && info.used == 0);
+    CHECK(append_n(s, 5000, 300, size) == ESP_OK);
+    CHECK(expect_range(s, 5000, 300, size) == 0);
+
+    // Crash after the last sync: records reach the file, the header does not
+    CHECK(mqtt_spool_sync(s) == ESP_OK);
+    CHECK(append_n(s, 5300, 100, size) == ESP_OK);
+    fflush(NULL);
+    char crash_path[512];
+    snprintf(crash_path, sizeof(crash_path), "%s.crash", path);
+    char cmd[1100];
+    snprintf(cmd, sizeof(cmd), "cp '%s' '%s'", path, crash_path);
+    CHECK(system(cmd) == 0);
+    mqtt_spool_close(s);
+
+    CHECK(mqtt_spool_open(crash_path, capacity, &s) == ESP_OK);
+    mqtt_spool_get_info(s, &info);
+    CHECK(info.recovered == 100);
+    CHECK(expect_range(s, 5000, 400, size) == 0);
+    mqtt_spool_close(s);
+    printf("recovery:  100 messages found past the stored tail\n");
+
+    // A different capacity starts over
+    CHECK(mqtt_spool_open(crash_path, capacity * 2, &s) == ESP_OK);
+    mqtt_spool_get_info(s, &info);
+    CHECK(info.count == 0);
+    mqtt_spool_close(s);
+
+    unlink(crash_path);
+    unlink(path);
+    printf("Spool self-test passed\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *host = NULL;
+    const char *spool_path = NULL;
+    uint16_t port = MQTT_DEFAULT_PORT;
+    uint32_t count = 2000;
+    size_t size = 64;
+    int only_qos = -1;
+    int only_batch = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:S:p:n:s:q:b:v")) != -1) {
+        switch (opt) {
+            case 'h': host = optarg; break;
+            case 'S': spool_path = optarg; break;
+            case 'p': port = (uint16_t)atoi(optarg); break;
+            case 'n': count = (uint32_t)atoi(optarg); break;
+            case 's': size = (size_t)atoi(optarg); break;
+            case 'q': only_qos = atoi(optarg); break;
+            case 'b': only_batch = atoi(optarg); break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if ((host == NULL) == (spool_path == NULL) || only_batch < 0 || only_batch > MAX_BATCH ||
+        only_qos > 1 || count == 0 || size > MAX_PAYLOAD) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // A broker that goes away must not kill us in send()
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if (spool_path != NULL) {
+        return spool_test(spool_path);
+    }
+
+    int batches[2] = {1, 16};
+    int runs = 2;
+    if (only_batch > 0) {
+        batches[0] = only_batch;
+        runs = 1;
+    }
+
+    int failed = 0;
+    for (int qos = 0; qos <= 1; qos++) {
+        if (only_qos >= 0 && qos != only_qos) {
+            continue;
+        }
+        for (int i = 0; i < runs; i++) {
+            int rc = run_bench(host, port, count, size, (uint8_t)qos, batches[i]);
+            if (rc == 2) {
+                return 1;  // No broker
+            }
+            failed |= rc;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,584 @@
+/**
+ * @file main.cpp
+ * @brief Example 14: MQTT Telemetry for JC4880P443C (ESP32-P4)
+ *
+ * This example demonstrates:
+ * - WiFi connection via ESP-HOSTED (C6 co-processor)
+ * - Periodic telemetry (battery voltage, RSSI, free heap, uptime) over MQTT
+ * - Batched publishing: many messages per socket write, so per-message
+ *   SDIO transfers to the C6 are avoided
+ * - Store-and-forward to the SD card while the broker is unreachable, with
+ *   in-order replay after reconnecting (QoS 1 at-least-once)
+ * - Live delivery metrics on screen
+ *
+ * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
+ * WiFi: Via ESP32-C6 co-processor using ESP-HOSTED
+ *
+ * NOTE: Configure WIFI_SSID, WIFI_PASSWORD and MQTT_BROKER below!
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+// ESP-HOSTED for WiFi via C6 co-processor
+#include "esp_hosted.h"
+
+// SD card for the message spool
+#include "sd_service.h"
+
+#include "mqtt_service.h"
+
+// BSP includes
+#include "bsp/esp-bsp.h"
+#include "bsp/display.h"
+
+// LVGL
+#include "lvgl.h"
+
+static const char *TAG = "mqtt_telemetry";
+
+// ============================================================================
+// Configuration - CHANGE THESE!
+// ============================================================================
+#define WIFI_SSID      "YOUR_WIFI_SSID"
+#define WIFI_PASSWORD  "YOUR_WIFI_PASSWORD"
+
+// MQTT broker (e.g. "mosquitto -p 1883 -v" on a PC)
+#define MQTT_BROKER    "192.168.1.100"
+#define MQTT_PORT      1883
+#define MQTT_USERNAME  NULL
+#define MQTT_PASSWORD  NULL
+#define DEVICE_ID      "jc4880p443c"
+
+#define TELEMETRY_PERIOD_MS 1000
+#define TELEMETRY_QOS       1
+
+// Messages sent by the Burst button (QoS 0, to show batching)
+#define BURST_COUNT         200
+
+// Spool file on the SD card
+#define SPOOL_PATH          BSP_SD_MOUNT_POINT "/mqtt.spl"
+#define SPOOL_CAPACITY      (1024 * 1024)
+
+// ============================================================================
+
+// Battery ADC (see example 10)
+#define ADC_CHANNEL         ADC_CHANNEL_4
+#define ADC_ATTEN           ADC_ATTEN_DB_12
+#define ADC_SAMPLES         64
+
+// Event group for WiFi events
+static EventGroupHandle_t wifi_event_group;
+#define WIFI_CONNECTED_BIT BIT0
+#define WIFI_FAIL_BIT      BIT1
+
+// LVGL UI elements
+static lv_obj_t *status_label = NULL;
+static lv_obj_t *ip_label = NULL;
+static lv_obj_t *telemetry_label = NULL;
+static lv_obj_t *stats_label = NULL;
+static lv_obj_t *burst_btn = NULL;
+
+// ADC handles
+static adc_oneshot_unit_handle_t adc_handle = NULL;
+static adc_cali_handle_t adc_cali_handle = NULL;
+static bool adc_calibrated = false;
+
+// WiFi retry counter (initial connection only, afterwards WiFi retries forever)
+static int wifi_retry_count = 0;
+static bool wifi_was_connected = false;
+#define WIFI_MAX_RETRY 5
+
+/**
+ * @brief WiFi event handler
+ */
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data) {
+    if (event_base == WIFI_EVENT) {
+        switch (event_id) {
+            case WIFI_EVENT_STA_START:
+                ESP_LOGI(TAG, "WiFi STA started, connecting...");
+                esp_wifi_connect();
+                break;
+
+            case WIFI_EVENT_STA_DISCONNECTED:
+                if (wifi_was_connected) {
+                    // Telemetry keeps being spooled meanwhile
+                    ESP_LOGW(TAG, "WiFi lost, reconnecting...");
+                    esp_wifi_connect();
+                } else if (wifi_retry_count < WIFI_MAX_RETRY) {
+                    ESP_LOGI(TAG, "WiFi disconnected, retrying (%d/%d)...",
+                             wifi_retry_count + 1, WIFI_MAX_RETRY);
+                    esp_wifi_connect();
+                    wifi_retry_count++;
+                } else {
+                    ESP_LOGE(TAG, "WiFi connection failed after %d retries", WIFI_MAX_RETRY);
+                    xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);
+                }
+                break;
+
+            default:
+                break;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        wifi_retry_count = 0;
+        wifi_was_connected = true;
+        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+        // Update IP label
+        if (ip_label) {
+            bsp_display_lock(0);
+            lv_label_set_text_fmt(ip_label, "IP: " IPSTR, IP2STR(&event->ip_info.ip));
+            bsp_display_unlock();
+        }
+    }
+}
+
+/**
+ * @brief Initialize WiFi in station mode and connect
+ */
+static esp_err_t wifi_init_and_connect(void) {
+    ESP_LOGI(TAG, "Initializing WiFi...");
+
+    wifi_event_group = xEventGroupCreate();
+
+    // Initialize TCP/IP stack
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    // Create default WiFi station
+    esp_netif_create_default_wifi_sta();
+
+    // Initialize WiFi with default config
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    // Register event handlers
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+
+    // Configure WiFi
+    wifi_config_t wifi_config = {};
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    ESP_LOGI(TAG, "WiFi init complete, waiting for connection...");
+
+    // Wait for connection or failure
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(30000));
+
+    if (bits & WIFI_CONNECTED_BIT) {
+        ESP_LOGI(TAG, "Connected to WiFi SSID: %s", WIFI_SSID);
+        return ESP_OK;
+    } else if (bits & WIFI_FAIL_BIT) {
+        ESP_LOGE(TAG, "Failed to connect to SSID: %s", WIFI_SSID);
+        return ESP_FAIL;
+    } else {
+        ESP_LOGE(TAG, "WiFi connection timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+}
+
+/**
+ * @brief Mount the SD card for the message spool
+ *
+ * The card is held for the lifetime of the app (see sd_service).
+ */
+static esp_err_t sd_mount(void) {
+    sd_service_config_t cfg = SD_SERVICE_CONFIG_DEFAULT();
+    cfg.mount_point = BSP_SD_MOUNT_POINT;
+    cfg.poll_ms = 0;  // Mounted once at boot, no hot plug
+    esp_err_t ret = sd_service_init(&cfg);
+    if (ret == ESP_OK) {
+        ret = sd_service_acquire(NULL);
+        if (ret != ESP_OK) {
+            sd_service_deinit();  // Powers the slot down again
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No SD card (%s), telemetry is dropped while offline",
+                 esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// ============================================================================
+// Telemetry sources
+// ============================================================================
+
+/**
+ * @brief Initialize the battery ADC with calibration if available
+ */
+static void adc_init(void) {
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = ADC_UNIT_2,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    ESP_ERROR_CHECK(adc_oneshot_new_unit(&unit_config, &adc_handle));
+
+    adc_oneshot_chan_cfg_t chan_config = {
+        .atten = ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle, ADC_CHANNEL, &chan_config));
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_2,
+        .chan = ADC_CHANNEL,
+        .atten = ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    adc_calibrated = adc_cali_create_scheme_curve_fitting(&cali_config, &adc_cali_handle) == ESP_OK;
+#endif
+    if (!adc_calibrated) {
+        ESP_LOGW(TAG, "ADC not calibrated, battery voltage is approximate");
+    }
+}
+
+/**
+ * @brief Read the battery voltage, averaged
+ */
+static int read_battery_mv(void) {
+    int raw_sum = 0;
+    for (int i = 0; i < ADC_SAMPLES; i++) {
+        int raw = 0;
+        adc_oneshot_read(adc_handle, ADC_CHANNEL, &raw);
+        raw_sum += raw;
+    }
+    int raw_avg = raw_sum / ADC_SAMPLES;
+
+    int voltage_mv = 0;
+    if (adc_calibrated) {
+        adc_cali_raw_to_voltage(adc_cali_handle, raw_avg, &voltage_mv);
+    } else {
+        voltage_mv = (raw_avg * 3300) / 4095;
+    }
+    return voltage_mv;
+}
+
+/**
+ * @brief Publish one telemetry sample per period
+ */
+static void telemetry_task(void *arg) {
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t sample = 0;
+
+    while (1) {
+        int battery_mv = read_battery_mv();
+        wifi_ap_record_t ap = {};
+        int rssi = esp_wifi_sta_get_ap_info(&ap) == ESP_OK ? ap.rssi : 0;
+        uint32_t heap = esp_get_free_heap_size();
+        uint32_t uptime_s = (uint32_t)(esp_timer_get_time() / 1000000);
+
+        char payload[160];
+        int len = snprintf(payload, sizeof(payload),
+                           "{\"n\":%lu,\"battery_mv\":%d,\"rssi\":%d,\"heap\":%lu,\"uptime\":%lu}",
+                           (unsigned long)sample++, battery_mv, rssi, (unsigned long)heap,
+                           (unsigned long)uptime_s);
+        if (mqtt_service_publish("telemetry/" DEVICE_ID, payload, len, TELEMETRY_QOS) != ESP_OK) {
+            ESP_LOGW(TAG, "Telemetry sample dropped");
+        }
+
+        bsp_display_lock(0);
+        lv_label_set_text_fmt(telemetry_label,
+                              "Battery %d mV   RSSI %d dBm\nHeap %lu KB   Uptime %lu s",
+                              battery_mv, rssi, (unsigned long)(heap / 1024),
+                              (unsigned long)uptime_s);
+        bsp_display_unlock();
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TELEMETRY_PERIOD_MS));
+    }
+}
+
+/**
+ * @brief Publish BURST_COUNT small messages at once
+ */
+static void burst_task(void *arg) {
+    int64_t start = esp_timer_get_time();
+    int queued = 0;
+    for (int i = 0; i < BURST_COUNT; i++) {
+        char payload[32];
+        int len = snprintf(payload, sizeof(payload), "{\"i\":%d}", i);
+        // The queue holds MQTT_SERVICE_QUEUE_LEN messages; let it drain
+        while (mqtt_service_publish("telemetry/" DEVICE_ID "/burst", payload, len, 0) ==
+               ESP_ERR_NO_MEM) {
+            vTaskDelay(1);
+        }
+        queued++;
+    }
+    ESP_LOGI(TAG, "Burst of %d messages queued in %lu ms", queued,
+             (unsigned long)((esp_timer_get_time() - start) / 1000));
+
+    bsp_display_lock(0);
+    lv_obj_clear_state(burst_btn, LV_STATE_DISABLED);
+    bsp_display_unlock();
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// UI
+// ============================================================================
+
+/**
+ * @brief Burst button click callback
+ */
+static void burst_btn_click_cb(lv_event_t *e) {
+    // Runs in the LVGL task, which already holds the display lock
+    lv_obj_add_state(burst_btn, LV_STATE_DISABLED);
+    xTaskCreate(burst_task, "mqtt_burst", 3072, NULL, 4, NULL);
+}
+
+/**
+ * @brief Show the delivery metrics
+ */
+static void update_stats(void) {
+    mqtt_service_stats_t s;
+    mqtt_service_get_stats(&s);
+
+    float per_batch = s.batches > 0 ? (float)s.sent / s.batches : 0.0f;
+    float per_write = s.writes > 0 ? (float)s.sent / s.writes : 0.0f;
+
+    bsp_display_lock(0);
+    if (s.connected) {
+        lv_label_set_text(status_label, "Broker: Connected");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0x00FF00), 0);
+    } else {
+        lv_label_set_text_fmt(status_label, "Broker: Offline, spooling (%lu waiting)",
+                              (unsigned long)s.spool_count);
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFFFF00), 0);
+    }
+    lv_label_set_text_fmt(stats_label,
+                          "Rate: %.1f msg/s  %.1f kbit/s\n"
+                          "Published: %lu  Sent: %lu (QoS0 %lu, QoS1 %lu)\n"
+                          "Acked: %lu  In flight: %u  Ack: avg %lu ms, max %lu ms\n"
+                          "Batches: %lu (%.1f msg/batch)  Writes: %lu (%.1f msg/write)\n"
+                          "Bytes: %llu\n"
+                          "Spool: %lu msgs, %lu/%lu KB  Spooled: %lu  Replayed: %lu\n"
+                          "Dropped: %lu  Reconnects: %lu",
+                          s.msgs_per_s, s.kbps, (unsigned long)s.published,
+                          (unsigned long)s.sent, (unsigned long)s.sent_qos0,
+                          (unsigned long)s.sent_qos1, (unsigned long)s.acked, s.inflight,
+                          (unsigned long)s.ack_avg_ms, (unsigned long)s.ack_max_ms,
+                          (unsigned long)s.batches, per_batch, (unsigned long)s.writes, per_write,
+                          (unsigned long long)s.bytes_sent, (unsigned long)s.spool_count,
+                          (unsigned long)(s.spool_used / 1024),
+                          (unsigned long)(s.spool_capacity / 1024), (unsigned long)s.spooled,
+                          (unsigned long)s.replayed, (unsigned long)s.dropped,
+                          (unsigned long)s.reconnects);
+    bsp_display_unlock();
+}
+
+/**
+ * @brief Create the UI
+ */
+static void create_ui(void) {
+    lv_obj_t *scr = lv_scr_act();
+
+    // Set dark background
+    lv_obj_set_style_bg_color(scr, lv_color_hex(0x0f0f1a), LV_PART_MAIN);
+
+    // Title
+    lv_obj_t *title = lv_label_create(scr);
+    lv_label_set_text(title, "MQTT Telemetry");
+    lv_obj_set_style_text_color(title, lv_color_white(), 0);
+    lv_obj_set_style_text_font(title, &lv_font_montserrat_18, 0);
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 15);
+
+    // SSID label
+    lv_obj_t *ssid_label = lv_label_create(scr);
+    lv_label_set_text_fmt(ssid_label, "SSID: %s", WIFI_SSID);
+    lv_obj_set_style_text_color(ssid_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(ssid_label, LV_ALIGN_TOP_LEFT, 10, 50);
+
+    // IP label
+    ip_label = lv_label_create(scr);
+    lv_label_set_text(ip_label, "IP: Connecting...");
+    lv_obj_set_style_text_color(ip_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(ip_label, LV_ALIGN_TOP_LEFT, 10, 75);
+
+    // Broker label
+    lv_obj_t *broker_label = lv_label_create(scr);
+    lv_label_set_text_fmt(broker_label, "Broker: %s:%d, topic telemetry/%s", MQTT_BROKER,
+                          MQTT_PORT, DEVICE_ID);
+    lv_obj_set_style_text_color(broker_label, lv_color_hex(0xFFCC88), 0);
+    lv_obj_align(broker_label, LV_ALIGN_TOP_LEFT, 10, 100);
+
+    // Status label
+    status_label = lv_label_create(scr);
+    lv_label_set_text(status_label, "Status: Ready");
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0x888888), 0);
+    lv_obj_align(status_label, LV_ALIGN_TOP_LEFT, 10, 125);
+
+    // Last telemetry sample
+    telemetry_label = lv_label_create(scr);
+    lv_label_set_text(telemetry_label, "");
+    lv_obj_set_style_text_color(telemetry_label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(telemetry_label, &lv_font_montserrat_18, 0);
+    lv_obj_align(telemetry_label, LV_ALIGN_TOP_LEFT, 10, 160);
+
+    // Burst button
+    burst_btn = lv_btn_create(scr);
+    lv_obj_set_size(burst_btn, 200, 50);
+    lv_obj_align(burst_btn, LV_ALIGN_TOP_MID, 0, 230);
+    lv_obj_add_event_cb(burst_btn, burst_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_state(burst_btn, LV_STATE_DISABLED);
+
+    lv_obj_t *btn_label = lv_label_create(burst_btn);
+    lv_label_set_text_fmt(btn_label, "Burst %d", BURST_COUNT);
+    lv_obj_center(btn_label);
+
+    // Delivery metrics
+    lv_obj_t *stats_container = lv_obj_create(scr);
+    lv_obj_set_size(stats_container, LV_PCT(95), 400);
+    lv_obj_align(stats_container, LV_ALIGN_BOTTOM_MID, 0, -20);
+    lv_obj_set_style_bg_color(stats_container, lv_color_hex(0x16213e), 0);
+    lv_obj_set_style_border_width(stats_container, 0, 0);
+    lv_obj_set_style_pad_all(stats_container, 10, 0);
+
+    stats_label = lv_label_create(stats_container);
+    lv_label_set_text(stats_label, "");
+    lv_obj_set_style_text_color(stats_label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(stats_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_width(stats_label, LV_PCT(95));
+    lv_label_set_long_mode(stats_label, LV_LABEL_LONG_WRAP);
+    lv_obj_align(stats_label, LV_ALIGN_TOP_LEFT, 0, 0);
+}
+
+extern "C" void app_main(void) {
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  JC4880P443C MQTT Telemetry Example");
+    ESP_LOGI(TAG, "  ESP32-P4 + ESP-HOSTED + LVGL 9");
+    ESP_LOGI(TAG, "========================================");
+
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_LOGI(TAG, "NVS initialized");
+
+    // Initialize display using BSP
+    ESP_LOGI(TAG, "Initializing display...");
+
+    bsp_display_cfg_t disp_cfg = {
+        .lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG(),
+        .buffer_size = BSP_LCD_H_RES * 50,
+        .double_buffer = false,
+        .flags = {
+            .buff_dma = false,
+            .buff_spiram = true,
+            .sw_rotate = true,
+        }
+    };
+
+    lv_display_t *disp = bsp_display_start_with_config(&disp_cfg);
+    if (disp == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize display!");
+        return;
+    }
+    ESP_LOGI(TAG, "Display initialized");
+
+    // Turn on backlight
+    bsp_display_backlight_on();
+    bsp_display_brightness_set(100);
+
+    // Create UI
+    bsp_display_lock(0);
+    create_ui();
+    bsp_display_unlock();
+    ESP_LOGI(TAG, "UI created");
+
+    adc_init();
+    bool sd_mounted = (sd_mount() == ESP_OK);
+
+    // Initialize ESP-HOSTED transport to C6 co-processor
+    ESP_LOGI(TAG, "Initializing ESP-HOSTED...");
+    ret = esp_hosted_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ESP-HOSTED init failed: %s", esp_err_to_name(ret));
+        bsp_display_lock(0);
+        lv_label_set_text(status_label, "ESP-HOSTED init failed!");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        bsp_display_unlock();
+        return;
+    }
+    ESP_LOGI(TAG, "ESP-HOSTED initialized");
+
+    // Wait for transport to stabilize
+    vTaskDelay(pdMS_TO_TICKS(500));
+
+    // Initialize WiFi and connect
+    ret = wifi_init_and_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi connection failed!");
+        bsp_display_lock(0);
+        lv_label_set_text(ip_label, "IP: Connection failed");
+        lv_label_set_text(status_label, "WiFi connection failed!");
+        lv_obj_set_style_text_color(status_label, lv_color_hex(0xFF0000), 0);
+        bsp_display_unlock();
+        return;
+    }
+
+    // The service connects (and reconnects) to the broker in the background
+    mqtt_service_config_t mqtt_cfg = MQTT_SERVICE_CONFIG_DEFAULT();
+    mqtt_cfg.client.host = MQTT_BROKER;
+    mqtt_cfg.client.port = MQTT_PORT;
+    mqtt_cfg.client.client_id = DEVICE_ID;
+    mqtt_cfg.client.username = MQTT_USERNAME;
+    mqtt_cfg.client.password = MQTT_PASSWORD;
+    mqtt_cfg.client.keepalive_s = 30;
+    mqtt_cfg.spool_path = sd_mounted ? SPOOL_PATH : NULL;
+    mqtt_cfg.spool_capacity = SPOOL_CAPACITY;
+    ESP_ERROR_CHECK(mqtt_service_init(&mqtt_cfg));
+
+    xTaskCreate(telemetry_task, "telemetry", 4096, NULL, 3, NULL);
+
+    bsp_display_lock(0);
+    lv_obj_clear_state(burst_btn, LV_STATE_DISABLED);
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  MQTT telemetry running!");
+    ESP_LOGI(TAG, "========================================");
+
+    // Main loop: refresh the metrics
+    uint32_t ticks = 0;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        update_stats();
+        if (++ticks % 10 == 0) {
+            mqtt_service_stats_t s;
+            mqtt_service_get_stats(&s);
+            ESP_LOGI(TAG, "sent %lu, acked %lu, %.1f msg/batch, spool %lu, dropped %lu, heap %lu",
+                     (unsigned long)s.sent, (unsigned long)s.acked,
+                     s.batches > 0 ? (float)s.sent / s.batches : 0.0f,
+                     (unsigned long)s.spool_count, (unsigned long)s.dropped,
+                     (unsigned long)esp_get_free_heap_size());
+        }
+    }
+}
@@ -0,0 +1,591 @@
+/**
+ * @file mqtt_client.cpp
+ * @brief Minimal MQTT 3.1.1 client with batched publish
+ */
+
+#include "mqtt_client.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "mqtt_client";
+
+// Control packet types (upper nibble of the first byte)
+#define PKT_CONNECT     0x10
+#define PKT_CONNACK     0x20
+#define PKT_PUBLISH     0x30
+#define PKT_PUBACK      0x40
+#define PKT_SUBSCRIBE   0x82  // Flags 0b0010 are mandatory
+#define PKT_SUBACK      0x90
+#define PKT_PINGREQ     0xC0
+#define PKT_PINGRESP    0xD0
+#define PKT_DISCONNECT  0xE0
+
+// CONNECT flags
+#define CONNECT_CLEAN_SESSION 0x02
+#define CONNECT_PASSWORD      0x40
+#define CONNECT_USERNAME      0x80
+
+// Largest value of the remaining length field
+#define MAX_REMAINING   268435455
+
+// Fixed header (1) + remaining length (4) + topic length (2) + packet id (2)
+#define PUBLISH_OVERHEAD 9
+
+// Longest topic passed to on_message
+#define MAX_RX_TOPIC    128
+
+struct mqtt_client {
+    int fd;
+    bool failed;
+    uint16_t keepalive_s;
+    uint16_t next_id;
+    int64_t last_tx_us;
+    int64_t ping_sent_us;          // 0 if no ping is outstanding
+
+    uint8_t tx[MQTT_CLIENT_TX_BUF];
+    size_t tx_len;
+    uint8_t rx[MQTT_CLIENT_RX_BUF];
+    size_t rx_len;
+    size_t rx_skip;                // Bytes of an oversized packet still to drop
+
+    mqtt_client_counters_t counters;
+};
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+static size_t put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+    return 2;
+}
+
+static size_t put_str(uint8_t *p, const char *s, size_t len) {
+    put_u16(p, (uint16_t)len);
+    memcpy(p + 2, s, len);
+    return 2 + len;
+}
+
+static size_t put_remaining(uint8_t *p, size_t len) {
+    size_t n = 0;
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        p[n++] = len > 0 ? (b | 0x80) : b;
+    } while (len > 0);
+    return n;
+}
+
+static size_t remaining_size(size_t len) {
+    return len < 128 ? 1 : len < 16384 ? 2 : len < 2097152 ? 3 : 4;
+}
+
+/**
+ * @brief Encode everything of a PUBLISH but the payload
+ *
+ * @return Header length, 0 if the message is invalid
+ */
+static size_t publish_header(const mqtt_message_t *msg, uint8_t *p) {
+    size_t topic_len = msg->topic != NULL ? strlen(msg->topic) : 0;
+    size_t remaining = 2 + topic_len + (msg->qos > 0 ? 2 : 0) + msg->len;
+    if (topic_len == 0 || topic_len > 0xFFFF || msg->qos > 1 || remaining > MAX_REMAINING) {
+        return 0;
+    }
+
+    size_t n = 0;
+    p[n++] = PKT_PUBLISH | (msg->dup ? 0x08 : 0) | (msg->qos << 1) | (msg->retain ? 0x01 : 0);
+    n += put_remaining(p + n, remaining);
+    n += put_u16(p + n, (uint16_t)topic_len);
+    memcpy(p + n, msg->topic, topic_len);
+    n += topic_len;
+    if (msg->qos > 0) {
+        n += put_u16(p + n, msg->packet_id);
+    }
+    return n;
+}
+
+size_t mqtt_client_encoded_size(const mqtt_message_t *msg) {
+    size_t topic_len = msg->topic != NULL ? strlen(msg->topic) : 0;
+    size_t remaining = 2 + topic_len + (msg->qos > 0 ? 2 : 0) + msg->len;
+    return 1 + remaining_size(remaining) + remaining;
+}
+
+// ============================================================================
+// Socket I/O
+// ============================================================================
+
+static bool wait_fd(int fd, bool write, uint32_t timeout_ms) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval tv = {(time_t)(timeout_ms / 1000), (suseconds_t)(timeout_ms % 1000) * 1000};
+    return select(fd + 1, write ? NULL : &set, write ? &set : NULL, NULL, &tv) > 0;
+}
+
+/**
+ * @brief Write all bytes to the non-blocking socket
+ */
+static esp_err_t send_all(mqtt_client_t *c, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        int n = send(c->fd, data, len, 0);
+        if (n > 0) {
+            data += n;
+            len -= n;
+            c->counters.bytes_sent += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            // Socket buffer full: the broker or the link is slower than us
+            if (wait_fd(c->fd, true, 5000)) {
+                continue;
+            }
+        }
+        c->failed = true;
+        return ESP_FAIL;
+    }
+    c->last_tx_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+static esp_err_t tx_flush(mqtt_client_t *c) {
+    if (c->tx_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = send_all(c, c->tx, c->tx_len);
+    c->tx_len = 0;
+    c->counters.writes++;
+    return err;
+}
+
+static esp_err_t send_short(mqtt_client_t *c, uint8_t type, const uint8_t *body, size_t len) {
+    uint8_t pkt[8];
+    pkt[0] = type;
+    pkt[1] = (uint8_t)len;
+    if (len > 0) {
+        memcpy(pkt + 2, body, len);
+    }
+    return send_all(c, pkt, 2 + len);
+}
+
+// ============================================================================
+// Connection
+// ============================================================================
+
+static esp_err_t tcp_connect(mqtt_client_t *c, const char *host, uint16_t port,
+                             uint32_t timeout_ms) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    struct sockaddr_in addr;
+    memcpy(&addr, res->ai_addr, sizeof(addr));
+    addr.sin_port = htons(port);
+    freeaddrinfo(res);
+
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c->fd < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL, 0) | O_NONBLOCK);
+
+    // Non-blocking connect, so an unreachable broker fails within the timeout
+    if (connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (errno != EINPROGRESS || !wait_fd(c->fd, true, timeout_ms)) {
+            return ESP_FAIL;
+        }
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+        if (so_error != 0) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_connect(mqtt_client_t *c, const mqtt_client_config_t *cfg) {
+    size_t id_len = strlen(cfg->client_id);
+    size_t user_len = cfg->username != NULL ? strlen(cfg->username) : 0;
+    size_t pass_len = cfg->password != NULL ? strlen(cfg->password) : 0;
+    size_t remaining = 10 + 2 + id_len + (cfg->username ? 2 + user_len : 0) +
+                       (cfg->password ? 2 + pass_len : 0);
+    if (remaining + 5 > sizeof(c->tx) || id_len > 0xFFFF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t flags = CONNECT_CLEAN_SESSION;
+    flags |= cfg->username != NULL ? CONNECT_USERNAME : 0;
+    flags |= cfg->password != NULL ? CONNECT_PASSWORD : 0;
+
+    uint8_t *p = c->tx;
+    size_t n = 0;
+    p[n++] = PKT_CONNECT;
+    n += put_remaining(p + n, remaining);
+    n += put_str(p + n, "MQTT", 4);
+    p[n++] = 4;  // Protocol level 3.1.1
+    p[n++] = flags;
+    n += put_u16(p + n, cfg->keepalive_s);
+    n += put_str(p + n, cfg->client_id, id_len);
+    if (cfg->username != NULL) {
+        n += put_str(p + n, cfg->username, user_len);
+    }
+    if (cfg->password != NULL) {
+        n += put_str(p + n, cfg->password, pass_len);
+    }
+    return send_all(c, p, n);
+}
+
+static esp_err_t recv_connack(mqtt_client_t *c, uint32_t timeout_ms) {
+    uint8_t ack[4];
+    size_t got = 0;
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (got < sizeof(ack)) {
+        int64_t left_ms = (deadline - esp_timer_get_time()) / 1000;
+        if (left_ms <= 0 || !wait_fd(c->fd, false, (uint32_t)left_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        int n = recv(c->fd, ack + got, sizeof(ack) - got, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            return ESP_FAIL;
+        }
+        got += n > 0 ? n : 0;
+    }
+    if (ack[0] != PKT_CONNACK || ack[1] != 2) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (ack[3] != 0) {
+        ESP_LOGE(TAG, "Broker refused the connection (code %u)", ack[3]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t mqtt_client_connect(const mqtt_client_config_t *cfg, mqtt_client_t **out) {
+    if (cfg == NULL || cfg->host == NULL || cfg->client_id == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_client_t *c = (mqtt_client_t *)calloc(1, sizeof(mqtt_client_t));
+    if (c == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    c->fd = -1;
+    c->keepalive_s = cfg->keepalive_s;
+    c->next_id = 1;
+
+    uint32_t timeout_ms = cfg->timeout_ms == 0 ? 5000 : cfg->timeout_ms;
+    uint16_t port = cfg->port == 0 ? MQTT_DEFAULT_PORT : cfg->port;
+    esp_err_t err = tcp_connect(c, cfg->host, port, timeout_ms);
+    if (err == ESP_OK) {
+        err = send_connect(c, cfg);
+    }
+    if (err == ESP_OK) {
+        err = recv_connack(c, timeout_ms);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Connect to %s:%u failed: %s", cfg->host, port, esp_err_to_name(err));
+        if (c->fd >= 0) {
+            close(c->fd);
+        }
+        free(c);
+        return err;
+    }
+
+    memset(&c->counters, 0, sizeof(c->counters));
+    *out = c;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Publish / subscribe
+// ============================================================================
+
+static uint16_t next_packet_id(mqtt_client_t *c) {
+    uint16_t id = c->next_id++;
+    if (c->next_id == 0) {
+        c->next_id = 1;
+    }
+    return id;
+}
+
+esp_err_t mqtt_client_publish(mqtt_client_t *c, mqtt_message_t *msgs, size_t count) {
+    if (c == NULL || c->failed) {
+        return ESP_FAIL;
+    }
+
+    // Validate first, so a bad message does not leave half a batch behind
+    for (size_t i = 0; i < count; i++) {
+        size_t topic_len = msgs[i].topic != NULL ? strlen(msgs[i].topic) : 0;
+        if (topic_len == 0 || topic_len + PUBLISH_OVERHEAD > sizeof(c->tx) || msgs[i].qos > 1 ||
+            msgs[i].len > MAX_REMAINING - topic_len - 4) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mqtt_message_t *msg = &msgs[i];
+        if (msg->qos > 0 && !msg->dup) {
+            msg->packet_id = next_packet_id(c);
+        }
+
+        size_t hdr_len = 0;
+        size_t total = mqtt_client_encoded_size(msg);
+        if (c->tx_len + total > sizeof(c->tx) && tx_flush(c) != ESP_OK) {
+            return ESP_FAIL;
+        }
+
+        if (total <= sizeof(c->tx)) {
+            // Common case: append to the batch
+            hdr_len = publish_header(msg, c->tx + c->tx_len);
+            if (hdr_len == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            memcpy(c->tx + c->tx_len + hdr_len, msg->payload, msg->len);
+            c->tx_len += hdr_len + msg->len;
+        } else {
+            // Larger than the whole buffer (which is empty now): header, then
+            // the payload straight from the caller
+            hdr_len = publish_header(msg, c->tx);
+            if (hdr_len == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (send_all(c, c->tx, hdr_len) != ESP_OK ||
+                send_all(c, msg->payload, msg->len) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            c->counters.writes++;
+        }
+        c->counters.publishes++;
+    }
+    return tx_flush(c);
+}
+
+esp_err_t mqtt_client_subscribe(mqtt_client_t *c, const char *filter, uint8_t qos) {
+    if (c == NULL || c->failed) {
+        return ESP_FAIL;
+    }
+    size_t len = strlen(filter);
+    if (len == 0 || len + 10 > sizeof(c->tx) || qos > 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t *p = c->tx;
+    size_t n = 0;
+    p[n++] = PKT_SUBSCRIBE;
+    n += put_remaining(p + n, 2 + 2 + len + 1);
+    n += put_u16(p + n, next_packet_id(c));
+    n += put_str(p + n, filter, len);
+    p[n++] = qos;
+    return send_all(c, p, n);
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+/**
+ * @brief Handle one complete incoming packet
+ */
+static esp_err_t handle_packet(mqtt_client_t *c, const uint8_t *pkt, size_t hdr_len,
+                               size_t body_len, const mqtt_client_handlers_t *h) {
+    const uint8_t *body = pkt + hdr_len;
+    switch (pkt[0] & 0xF0) {
+        case PKT_PUBACK:
+            if (body_len >= 2) {
+                c->counters.pubacks++;
+                if (h != NULL && h->on_puback != NULL) {
+                    h->on_puback(h->ctx, (uint16_t)((body[0] << 8) | body[1]));
+                }
+            }
+            break;
+
+        case PKT_PINGRESP:
+            c->ping_sent_us = 0;
+            break;
+
+        case PKT_SUBACK:
+            if (body_len >= 3 && body[2] == 0x80) {
+                ESP_LOGW(TAG, "Subscription refused by the broker");
+            }
+            break;
+
+        case PKT_PUBLISH: {
+            uint8_t qos = (pkt[0] >> 1) & 0x03;
+            if (body_len < 2) {
+                return ESP_FAIL;
+            }
+            size_t topic_len = (body[0] << 8) | body[1];
+            size_t pos = 2 + topic_len + (qos > 0 ? 2 : 0);
+            if (pos > body_len) {
+                return ESP_FAIL;
+            }
+            if (qos > 0) {
+                uint8_t id[2] = {body[2 + topic_len], body[3 + topic_len]};
+                if (send_short(c, PKT_PUBACK, id, sizeof(id)) != ESP_OK) {
+                    return ESP_FAIL;
+                }
+            }
+            c->counters.received++;
+            if (h != NULL && h->on_message != NULL && topic_len < MAX_RX_TOPIC) {
+                char topic[MAX_RX_TOPIC];
+                memcpy(topic, body + 2, topic_len);
+                topic[topic_len] = '\0';
+                h->on_message(h->ctx, topic, body + pos, body_len - pos);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Parse the complete packets in the receive buffer
+ */
+static esp_err_t parse_rx(mqtt_client_t *c, const mqtt_client_handlers_t *h) {
+    size_t pos = 0;
+    for (;;) {
+        if (c->rx_skip > 0) {
+            size_t n = c->rx_len - pos < c->rx_skip ? c->rx_len - pos : c->rx_skip;
+            pos += n;
+            c->rx_skip -= n;
+            if (c->rx_skip > 0) {
+                break;
+            }
+        }
+
+        size_t avail = c->rx_len - pos;
+        if (avail < 2) {
+            break;
+        }
+        // Remaining length: up to 4 bytes, 7 bits each
+        size_t body_len = 0;
+        size_t hdr_len = 1;
+        bool complete = false;
+        for (int shift = 0; hdr_len < avail && shift <= 21; shift += 7) {
+            uint8_t b = c->rx[pos + hdr_len++];
+            body_len |= (size_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            if (hdr_len > 4) {
+                return ESP_FAIL;  // Malformed length
+            }
+            break;
+        }
+
+        if (hdr_len + body_len > sizeof(c->rx)) {
+            ESP_LOGW(TAG, "Skipping %u byte packet", (unsigned)(hdr_len + body_len));
+            c->rx_skip = hdr_len + body_len;
+            continue;
+        }
+        if (hdr_len + body_len > avail) {
+            break;
+        }
+        esp_err_t err = handle_packet(c, c->rx + pos, hdr_len, body_len, h);
+        if (err != ESP_OK) {
+            return err;
+        }
+        pos += hdr_len + body_len;
+    }
+
+    memmove(c->rx, c->rx + pos, c->rx_len - pos);
+    c->rx_len -= pos;
+    return ESP_OK;
+}
+
+esp_err_t mqtt_client_poll(mqtt_client_t *c, uint32_t timeout_ms,
+                           const mqtt_client_handlers_t *handlers) {
+    if (c == NULL || c->failed) {
+        return ESP_FAIL;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t keepalive_us = (int64_t)c->keepalive_s * 1000000;
+    if (keepalive_us > 0) {
+        // Wake up in time for the next ping
+        int64_t ping_due_ms = (c->last_tx_us + keepalive_us / 2 - now) / 1000;
+        if (ping_due_ms < 0) {
+            ping_due_ms = 0;
+        }
+        if ((int64_t)timeout_ms > ping_due_ms) {
+            timeout_ms = (uint32_t)ping_due_ms;
+        }
+    }
+
+    if (timeout_ms == 0 || wait_fd(c->fd, false, timeout_ms)) {
+        for (;;) {
+            int n = recv(c->fd, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len, 0);
+            if (n == 0) {
+                ESP_LOGW(TAG, "Connection closed by the broker");
+                c->failed = true;
+                return ESP_FAIL;
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    break;
+                }
+                c->failed = true;
+                return ESP_FAIL;
+            }
+            c->rx_len += n;
+            if (parse_rx(c, handlers) != ESP_OK) {
+                ESP_LOGW(TAG, "Protocol error");
+                c->failed = true;
+                return ESP_FAIL;
+            }
+        }
+    }
+
+    if (keepalive_us > 0) {
+        now = esp_timer_get_time();
+        if (c->ping_sent_us != 0 && now - c->ping_sent_us > keepalive_us) {
+            ESP_LOGW(TAG, "No PINGRESP within %u s", c->keepalive_s);
+            c->failed = true;
+            return ESP_ERR_TIMEOUT;
+        }
+        if (c->ping_sent_us == 0 && now - c->last_tx_us >= keepalive_us / 2) {
+            if (send_short(c, PKT_PINGREQ, NULL, 0) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            c->ping_sent_us = now;
+        }
+    }
+    return ESP_OK;
+}
+
+void mqtt_client_get_counters(const mqtt_client_t *c, mqtt_client_counters_t *out) {
+    if (c != NULL && out != NULL) {
+        *out = c->counters;
+    }
+}
+
+void mqtt_client_close(mqtt_client_t *c) {
+    if (c == NULL) {
+        return;
+    }
+    if (!c->failed) {
+        send_short(c, PKT_DISCONNECT, NULL, 0);
+    }
+    close(c->fd);
+    free(c);
+}
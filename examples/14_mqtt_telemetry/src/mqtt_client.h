@@ -0,0 +1,169 @@
+/**
+ * @file mqtt_client.h
+ * @brief Minimal MQTT 3.1.1 client with batched publish
+ *
+ * A synchronous client for one broker connection, driven by the caller's
+ * task: connect, publish, then call mqtt_client_poll() regularly to read
+ * acknowledgements and keep the connection alive.
+ *
+ * mqtt_client_publish() encodes several PUBLISH packets back to back and
+ * hands them to the socket in one send(), so a burst of small messages
+ * crosses the SDIO link to the C6 as a few large transfers instead of one
+ * per message.
+ *
+ * QoS 0 and 1 are supported. The client only assigns packet ids and
+ * reports PUBACKs; keeping unacknowledged messages for redelivery is up
+ * to the caller (see mqtt_service.h).
+ *
+ * Only BSD sockets, esp_timer and esp_log are used, so the file also
+ * builds for Linux (see host/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_DEFAULT_PORT     1883
+
+// Publishes are encoded into this buffer; a batch that does not fit is
+// sent in several writes
+#define MQTT_CLIENT_TX_BUF    8192
+
+// Incoming packets larger than this are skipped
+#define MQTT_CLIENT_RX_BUF    1024
+
+/**
+ * @brief Connection parameters
+ */
+typedef struct {
+    const char *host;
+    uint16_t port;              // 0: MQTT_DEFAULT_PORT
+    const char *client_id;
+    const char *username;       // Optional
+    const char *password;       // Optional
+    uint16_t keepalive_s;       // 0: no keep-alive
+    uint32_t timeout_ms;        // Connect and CONNACK timeout, 0: 5000
+} mqtt_client_config_t;
+
+/**
+ * @brief A message to publish
+ */
+typedef struct {
+    const char *topic;
+    const uint8_t *payload;
+    size_t len;
+    uint8_t qos;                // 0 or 1
+    bool retain;
+    bool dup;                   // Redelivery of a QoS 1 message
+    uint16_t packet_id;         // Out: id assigned to a QoS 1 message
+} mqtt_message_t;
+
+/**
+ * @brief Callbacks for mqtt_client_poll()
+ */
+typedef struct {
+    void (*on_puback)(void *ctx, uint16_t packet_id);
+    // Message on a subscribed topic (acknowledged by the client for QoS 1)
+    void (*on_message)(void *ctx, const char *topic, const uint8_t *payload, size_t len);
+    void *ctx;
+} mqtt_client_handlers_t;
+
+/**
+ * @brief Traffic counters of one connection
+ */
+typedef struct {
+    uint32_t writes;            // send() calls that carried publishes
+    uint32_t publishes;
+    uint64_t bytes_sent;        // All packets, MQTT framing included
+    uint32_t pubacks;
+    uint32_t received;          // Messages on subscribed topics
+} mqtt_client_counters_t;
+
+typedef struct mqtt_client mqtt_client_t;
+
+/**
+ * @brief Connect to a broker (clean session)
+ *
+ * @param cfg: Connection parameters
+ * @param out: Client handle
+ *
+ * @return
+ *    - ESP_OK: Connected
+ *    - ESP_ERR_INVALID_ARG: Missing host or client id
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_ERR_NOT_FOUND: Host does not resolve
+ *    - ESP_ERR_TIMEOUT: No CONNACK
+ *    - ESP_ERR_INVALID_RESPONSE: Broker refused the connection
+ *    - ESP_FAIL: TCP connect failed
+ */
+esp_err_t mqtt_client_connect(const mqtt_client_config_t *cfg, mqtt_client_t **out);
+
+/**
+ * @brief Publish messages, coalesced into as few writes as possible
+ *
+ * Assigns packet ids to QoS 1 messages. On failure the connection is
+ * unusable and some messages may have been sent.
+ *
+ * @param client: Client handle
+ * @param msgs: Messages
+ * @param count: Number of messages
+ *
+ * @return
+ *    - ESP_OK: All messages handed to the socket
+ *    - ESP_ERR_INVALID_ARG: Invalid message
+ *    - ESP_FAIL: Connection lost
+ */
+esp_err_t mqtt_client_publish(mqtt_client_t *client, mqtt_message_t *msgs, size_t count);
+
+/**
+ * @brief Subscribe to a topic filter
+ *
+ * @return
+ *    - ESP_OK: Subscription sent (the SUBACK is consumed by mqtt_client_poll)
+ *    - ESP_FAIL: Connection lost
+ */
+esp_err_t mqtt_client_subscribe(mqtt_client_t *client, const char *filter, uint8_t qos);
+
+/**
+ * @brief Process incoming packets and keep the connection alive
+ *
+ * Waits up to timeout_ms for data, handles everything that arrived and
+ * sends a PINGREQ when the keep-alive interval is due.
+ *
+ * @param client: Client handle
+ * @param timeout_ms: Maximum wait, 0 to only handle what is queued
+ * @param handlers: Callbacks, can be NULL
+ *
+ * @return
+ *    - ESP_OK: Connection alive
+ *    - ESP_ERR_TIMEOUT: Broker stopped answering pings
+ *    - ESP_FAIL: Connection lost or protocol error
+ */
+esp_err_t mqtt_client_poll(mqtt_client_t *client, uint32_t timeout_ms,
+                           const mqtt_client_handlers_t *handlers);
+
+/**
+ * @brief Bytes a message takes on the wire
+ */
+size_t mqtt_client_encoded_size(const mqtt_message_t *msg);
+
+/**
+ * @brief Get the traffic counters of the connection
+ */
+void mqtt_client_get_counters(const mqtt_client_t *client, mqtt_client_counters_t *out);
+
+/**
+ * @brief Disconnect (politely if the connection is still up) and free the client
+ */
+void mqtt_client_close(mqtt_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,499 @@
+/**
+ * @file mqtt_service.cpp
+ * @brief Batched MQTT publishing with store-and-forward to SD
+ */
+
+#include "mqtt_service.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_spool.h"
+
+static const char *TAG = "mqtt_service";
+
+/**
+ * @brief Queued message
+ */
+typedef struct {
+    char topic[MQTT_SERVICE_MAX_TOPIC];
+    uint8_t payload[MQTT_SERVICE_MAX_PAYLOAD];
+    uint16_t len;
+    uint8_t qos;
+} item_t;
+
+/**
+ * @brief Live QoS 1 message awaiting its PUBACK
+ */
+typedef struct {
+    bool used;
+    uint16_t packet_id;
+    int64_t sent_us;
+    item_t item;
+} inflight_t;
+
+static mqtt_service_config_t cfg;
+static QueueHandle_t queue = NULL;
+static SemaphoreHandle_t stats_mutex = NULL;
+static mqtt_service_stats_t stats = {};
+static uint64_t ack_total_ms = 0;
+static uint32_t ack_samples = 0;
+
+// Owned by the service task
+static mqtt_client_t *client = NULL;
+static mqtt_client_counters_t client_seen;  // Counters already added to stats
+static bool ever_connected = false;
+static inflight_t inflight[MQTT_SERVICE_MAX_INFLIGHT];
+static uint8_t inflight_count = 0;
+static mqtt_spool_t *spool = NULL;
+static bool spool_dirty = false;
+static uint32_t spool_dropped_seen = 0;  // Overwritten messages already counted
+
+// Spooled messages on the wire: removed from the spool once all are acked
+static mqtt_spool_record_t *replay_recs = NULL;
+static uint16_t replay_ids[MQTT_SERVICE_REPLAY_BATCH];  // 0: QoS 0 or acked
+static size_t replay_count = 0;
+static size_t replay_waiting = 0;
+static uint32_t replay_last_seq = 0;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Add the client's traffic since the last call to the stats
+ */
+static void account_client(void) {
+    mqtt_client_counters_t now;
+    mqtt_client_get_counters(client, &now);
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.writes += now.writes - client_seen.writes;
+    stats.bytes_sent += now.bytes_sent - client_seen.bytes_sent;
+    xSemaphoreGive(stats_mutex);
+    client_seen = now;
+}
+
+static void spool_item(const item_t *item) {
+    esp_err_t err = ESP_FAIL;
+    if (spool != NULL) {
+        err = mqtt_spool_append(spool, item->topic, item->payload, item->len, item->qos);
+        spool_dirty = true;
+    }
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    if (err == ESP_OK) {
+        stats.spooled++;
+    } else {
+        stats.dropped++;
+    }
+    xSemaphoreGive(stats_mutex);
+}
+
+static bool spool_empty(void) {
+    if (spool == NULL) {
+        return true;
+    }
+    mqtt_spool_info_t info;
+    mqtt_spool_get_info(spool, &info);
+    return info.count == 0;
+}
+
+/**
+ * @brief Drop the connection and keep what was not acknowledged
+ *
+ * Unacknowledged live QoS 1 messages go to the spool. A replay batch in
+ * flight is still in the spool and is simply sent again.
+ */
+static void connection_lost(void) {
+    ESP_LOGW(TAG, "Connection lost, %u messages unacknowledged", inflight_count);
+    mqtt_client_close(client);
+    client = NULL;
+
+    for (int i = 0; i < MQTT_SERVICE_MAX_INFLIGHT; i++) {
+        if (inflight[i].used) {
+            spool_item(&inflight[i].item);
+            inflight[i].used = false;
+        }
+    }
+    inflight_count = 0;
+    replay_count = 0;
+    replay_waiting = 0;
+    if (spool != NULL) {
+        mqtt_spool_sync(spool);
+        spool_dirty = false;
+    }
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.connected = false;
+    stats.inflight = 0;
+    xSemaphoreGive(stats_mutex);
+}
+
+static esp_err_t try_connect(void) {
+    esp_err_t err = mqtt_client_connect(&cfg.client, &client);
+    if (err != ESP_OK) {
+        return err;
+    }
+    memset(&client_seen, 0, sizeof(client_seen));
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.connected = true;
+    if (ever_connected) {
+        stats.reconnects++;
+    }
+    xSemaphoreGive(stats_mutex);
+    ever_connected = true;
+
+    ESP_LOGI(TAG, "Connected to %s", cfg.client.host);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Acknowledgements
+// ============================================================================
+
+static void finish_replay(void) {
+    mqtt_spool_consume(spool, replay_last_seq);
+    spool_dirty = true;
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.replayed += replay_count;
+    xSemaphoreGive(stats_mutex);
+    replay_count = 0;
+}
+
+static void on_puback(void *ctx, uint16_t packet_id) {
+    for (int i = 0; i < MQTT_SERVICE_MAX_INFLIGHT; i++) {
+        if (inflight[i].used && inflight[i].packet_id == packet_id) {
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - inflight[i].sent_us) / 1000);
+            inflight[i].used = false;
+            inflight_count--;
+
+            ack_total_ms += ms;
+            ack_samples++;
+            xSemaphoreTake(stats_mutex, portMAX_DELAY);
+            stats.acked++;
+            stats.inflight = inflight_count;
+            stats.ack_avg_ms = (uint32_t)(ack_total_ms / ack_samples);
+            if (ms > stats.ack_max_ms) {
+                stats.ack_max_ms = ms;
+            }
+            xSemaphoreGive(stats_mutex);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < replay_count; i++) {
+        if (replay_ids[i] != 0 && replay_ids[i] == packet_id) {
+            replay_ids[i] = 0;
+            xSemaphoreTake(stats_mutex, portMAX_DELAY);
+            stats.acked++;
+            xSemaphoreGive(stats_mutex);
+            if (--replay_waiting == 0) {
+                finish_replay();
+            }
+            return;
+        }
+    }
+}
+
+static const mqtt_client_handlers_t handlers = {
+    .on_puback = on_puback,
+    .on_message = NULL,
+    .ctx = NULL,
+};
+
+/**
+ * @brief Wait (briefly) until need more QoS 1 messages can be in flight
+ */
+static bool inflight_room(size_t need) {
+    int64_t deadline = esp_timer_get_time() + 1000000;
+    while (inflight_count + need > MQTT_SERVICE_MAX_INFLIGHT) {
+        if (esp_timer_get_time() > deadline) {
+            return false;
+        }
+        if (mqtt_client_poll(client, 50, &handlers) != ESP_OK) {
+            connection_lost();
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+static void count_sent(const mqtt_message_t *msgs, size_t n) {
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.batches++;
+    stats.sent += n;
+    for (size_t i = 0; i < n; i++) {
+        if (msgs[i].qos > 0) {
+            stats.sent_qos1++;
+        } else {
+            stats.sent_qos0++;
+        }
+    }
+    stats.inflight = inflight_count;
+    xSemaphoreGive(stats_mutex);
+}
+
+/**
+ * @brief Publish a batch of new messages in one write
+ */
+static void send_batch(const item_t *items, size_t n) {
+    mqtt_message_t msgs[MQTT_SERVICE_MAX_BATCH] = {};
+    for (size_t i = 0; i < n; i++) {
+        msgs[i].topic = items[i].topic;
+        msgs[i].payload = items[i].payload;
+        msgs[i].len = items[i].len;
+        msgs[i].qos = items[i].qos;
+    }
+
+    esp_err_t err = mqtt_client_publish(client, msgs, n);
+    account_client();
+
+    // Keep QoS 1 copies even on failure, connection_lost() spools them
+    int64_t now = esp_timer_get_time();
+    int slot = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (msgs[i].qos == 0) {
+            continue;
+        }
+        while (inflight[slot].used) {
+            slot++;
+        }
+        inflight[slot].used = true;
+        inflight[slot].packet_id = msgs[i].packet_id;
+        inflight[slot].sent_us = now;
+        inflight[slot].item = items[i];
+        inflight_count++;
+    }
+
+    if (err != ESP_OK) {
+        connection_lost();
+        return;
+    }
+    count_sent(msgs, n);
+}
+
+/**
+ * @brief Send the oldest spooled messages, if no replay is in flight
+ */
+static void replay_next(void) {
+    if (replay_count > 0 || spool_empty()) {
+        return;
+    }
+    size_t n = 0;
+    if (mqtt_spool_peek(spool, replay_recs, MQTT_SERVICE_REPLAY_BATCH, &n) != ESP_OK || n == 0) {
+        return;
+    }
+
+    mqtt_message_t msgs[MQTT_SERVICE_REPLAY_BATCH] = {};
+    for (size_t i = 0; i < n; i++) {
+        msgs[i].topic = replay_recs[i].topic;
+        msgs[i].payload = replay_recs[i].payload;
+        msgs[i].len = replay_recs[i].len;
+        msgs[i].qos = replay_recs[i].qos;
+    }
+    esp_err_t err = mqtt_client_publish(client, msgs, n);
+    account_client();
+    if (err != ESP_OK) {
+        connection_lost();
+        return;
+    }
+    count_sent(msgs, n);
+
+    replay_count = n;
+    replay_waiting = 0;
+    replay_last_seq = replay_recs[n - 1].seq;
+    for (size_t i = 0; i < n; i++) {
+        replay_ids[i] = msgs[i].qos > 0 ? msgs[i].packet_id : 0;
+        replay_waiting += msgs[i].qos > 0 ? 1 : 0;
+    }
+    if (replay_waiting == 0) {
+        finish_replay();
+    }
+}
+
+/**
+ * @brief Send a batch directly, or spool it
+ *
+ * New messages only go out directly when nothing older is spooled, so
+ * the broker sees messages in order.
+ */
+static void handle_batch(const item_t *items, size_t n) {
+    size_t qos1 = 0;
+    for (size_t i = 0; i < n; i++) {
+        qos1 += items[i].qos > 0 ? 1 : 0;
+    }
+    if (client != NULL && spool_empty() && inflight_room(qos1)) {
+        send_batch(items, n);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        spool_item(&items[i]);
+    }
+}
+
+// ============================================================================
+// Task
+// ============================================================================
+
+static void service_task(void *arg) {
+    item_t *batch = (item_t *)malloc(MQTT_SERVICE_MAX_BATCH * sizeof(item_t));
+    if (batch == NULL) {
+        ESP_LOGE(TAG, "Out of memory");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    uint32_t retry_ms = cfg.retry_min_ms;
+    int64_t next_attempt_us = 0;
+    int64_t window_start_us = esp_timer_get_time();
+    uint32_t window_sent = 0;
+    uint64_t window_bytes = 0;
+
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        if (client == NULL && now >= next_attempt_us) {
+            if (try_connect() == ESP_OK) {
+                retry_ms = cfg.retry_min_ms;
+            } else {
+                next_attempt_us = now + (int64_t)retry_ms * 1000;
+                retry_ms = retry_ms * 2 > cfg.retry_max_ms ? cfg.retry_max_ms : retry_ms * 2;
+            }
+        }
+
+        // Block for the first message, then collect more for the batch window
+        size_t n = 0;
+        TickType_t wait = pdMS_TO_TICKS(client != NULL ? 10 : 100);
+        if (xQueueReceive(queue, &batch[0], wait) == pdTRUE) {
+            n = 1;
+            int64_t window_end = esp_timer_get_time() + (int64_t)cfg.batch_window_ms * 1000;
+            while (n < cfg.batch_max) {
+                int64_t left_us = window_end - esp_timer_get_time();
+                TickType_t ticks = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) : 0;
+                if (xQueueReceive(queue, &batch[n], ticks) != pdTRUE) {
+                    break;
+                }
+                n++;
+            }
+            handle_batch(batch, n);
+        }
+
+        if (client != NULL && mqtt_client_poll(client, 0, &handlers) != ESP_OK) {
+            connection_lost();
+        }
+        if (client != NULL) {
+            replay_next();
+        }
+
+        // Once a second: flush the spool and update the rates
+        now = esp_timer_get_time();
+        if (now - window_start_us >= 1000000) {
+            if (spool != NULL && spool_dirty) {
+                mqtt_spool_sync(spool);
+                spool_dirty = false;
+            }
+            mqtt_spool_info_t info = {};
+            if (spool != NULL) {
+                mqtt_spool_get_info(spool, &info);
+            }
+
+            float secs = (now - window_start_us) / 1e6f;
+            xSemaphoreTake(stats_mutex, portMAX_DELAY);
+            stats.msgs_per_s = (stats.sent - window_sent) / secs;
+            stats.kbps = (stats.bytes_sent - window_bytes) * 8 / 1000.0f / secs;
+            stats.spool_count = info.count;
+            stats.spool_used = info.used;
+            stats.spool_capacity = info.capacity;
+            stats.dropped += info.dropped - spool_dropped_seen;
+            spool_dropped_seen = info.dropped;
+            window_sent = stats.sent;
+            window_bytes = stats.bytes_sent;
+            xSemaphoreGive(stats_mutex);
+            window_start_us = now;
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t mqtt_service_init(const mqtt_service_config_t *config) {
+    if (config == NULL || config->client.host == NULL || config->client.client_id == NULL ||
+        config->batch_max < 1 || config->batch_max > MQTT_SERVICE_MAX_BATCH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (queue != NULL) {
+        return ESP_OK;  // Already running
+    }
+    cfg = *config;
+
+    stats_mutex = xSemaphoreCreateMutex();
+    queue = xQueueCreate(MQTT_SERVICE_QUEUE_LEN, sizeof(item_t));
+    if (stats_mutex == NULL || queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (cfg.spool_path != NULL) {
+        replay_recs = (mqtt_spool_record_t *)malloc(MQTT_SERVICE_REPLAY_BATCH *
+                                                    sizeof(mqtt_spool_record_t));
+        if (replay_recs == NULL ||
+            mqtt_spool_open(cfg.spool_path, cfg.spool_capacity, &spool) != ESP_OK) {
+            ESP_LOGW(TAG, "No spool, messages published while offline are dropped");
+            free(replay_recs);
+            replay_recs = NULL;
+            spool = NULL;
+        }
+    }
+
+    if (xTaskCreate(service_task, "mqtt_service", cfg.stack_size, NULL, cfg.task_priority,
+                    NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Publishing to %s:%u, batches of up to %u within %lu ms", cfg.client.host,
+             cfg.client.port != 0 ? cfg.client.port : MQTT_DEFAULT_PORT, cfg.batch_max,
+             (unsigned long)cfg.batch_window_ms);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_service_publish(const char *topic, const void *payload, size_t len, uint8_t qos) {
+    if (queue == NULL || topic == NULL || strlen(topic) >= MQTT_SERVICE_MAX_TOPIC ||
+        len > MQTT_SERVICE_MAX_PAYLOAD || qos > 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    item_t item;
+    strcpy(item.topic, topic);
+    memcpy(item.payload, payload, len);
+    item.len = (uint16_t)len;
+    item.qos = qos;
+
+    bool queued = xQueueSend(queue, &item, 0) == pdTRUE;
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    if (queued) {
+        stats.published++;
+    } else {
+        stats.dropped++;
+    }
+    xSemaphoreGive(stats_mutex);
+    return queued ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void mqtt_service_get_stats(mqtt_service_stats_t *out) {
+    if (stats_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(stats_mutex);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file mqtt_service.h
+ * @brief Batched MQTT publishing with store-and-forward to SD
+ *
+ * mqtt_service_publish() copies the message into a queue and returns. A
+ * task collects what arrives within a short window into one batch and
+ * publishes it with a single socket write (see mqtt_client.h), so the cost
+ * of each SDIO transfer to the C6 is shared by several messages.
+ *
+ * While the broker is unreachable, messages are appended to a spool file
+ * (see mqtt_spool.h). After reconnecting, the spool is replayed oldest
+ * first before any new message goes out directly, and replayed messages
+ * are only removed from the file once the broker has acknowledged them.
+ * QoS 1 messages still unacknowledged when the connection drops are
+ * spooled as well, so QoS 1 delivery is at-least-once across outages and
+ * reboots. Without a spool, messages published while offline are dropped.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_SERVICE_MAX_TOPIC     64    // Including the terminating NUL
+#define MQTT_SERVICE_MAX_PAYLOAD   256
+#define MQTT_SERVICE_QUEUE_LEN     32    // Messages waiting for the task
+#define MQTT_SERVICE_MAX_BATCH     32
+#define MQTT_SERVICE_MAX_INFLIGHT  32    // Unacknowledged QoS 1 messages
+#define MQTT_SERVICE_REPLAY_BATCH  8     // Spooled messages replayed per write
+
+/**
+ * @brief Service configuration
+ *
+ * The strings in client must stay valid while the service runs.
+ */
+typedef struct {
+    mqtt_client_config_t client;
+    const char *spool_path;          // NULL: no spool, offline messages are dropped
+    uint32_t spool_capacity;         // Bytes
+    uint32_t batch_window_ms;        // How long to wait for more messages after the first
+    uint8_t batch_max;               // 1: no batching, up to MQTT_SERVICE_MAX_BATCH
+    uint32_t retry_min_ms;           // Reconnect backoff, doubled per failure
+    uint32_t retry_max_ms;
+    int task_priority;
+    uint32_t stack_size;
+} mqtt_service_config_t;
+
+#define MQTT_SERVICE_CONFIG_DEFAULT() {  \
+    .client = {},                        \
+    .spool_path = NULL,                  \
+    .spool_capacity = 256 * 1024,        \
+    .batch_window_ms = 20,               \
+    .batch_max = 16,                     \
+    .retry_min_ms = 1000,                \
+    .retry_max_ms = 30000,               \
+    .task_priority = 4,                  \
+    .stack_size = 6144,                  \
+}
+
+/**
+ * @brief Delivery and batching metrics
+ */
+typedef struct {
+    bool connected;
+    uint32_t reconnects;       // Successful connects after the first
+    uint32_t published;        // Accepted by mqtt_service_publish()
+    uint32_t sent;             // PUBLISH packets written, replays included
+    uint32_t sent_qos0;
+    uint32_t sent_qos1;
+    uint32_t acked;            // PUBACKs received
+    uint32_t batches;          // Batches published
+    uint32_t writes;           // Socket writes carrying publishes
+    uint64_t bytes_sent;       // MQTT bytes written, framing included
+    uint32_t spooled;          // Messages written to the spool
+    uint32_t replayed;         // Spooled messages delivered
+    uint32_t dropped;          // Queue full, no spool, or oldest spooled overwritten
+    uint8_t inflight;          // QoS 1 messages awaiting PUBACK
+    uint32_t spool_count;      // Messages in the spool
+    uint32_t spool_used;       // Bytes
+    uint32_t spool_capacity;
+    uint32_t ack_avg_ms;       // PUBACK latency of live messages, since start
+    uint32_t ack_max_ms;
+    float msgs_per_s;          // Sent over the last second
+    float kbps;                // Sent over the last second
+} mqtt_service_stats_t;
+
+/**
+ * @brief Open the spool and start the publishing task
+ *
+ * Connecting happens in the background; messages published before the
+ * connection is up are spooled.
+ *
+ * @param config: Service configuration
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing broker or client id, bad batch size
+ *    - ESP_ERR_NO_MEM: Failed to create the task or queue
+ */
+esp_err_t mqtt_service_init(const mqtt_service_config_t *config);
+
+/**
+ * @brief Queue a message for publishing (copied, never blocks)
+ *
+ * @param topic: Topic
+ * @param payload: Payload
+ * @param len: Payload length
+ * @param qos: 0 or 1
+ *
+ * @return
+ *    - ESP_OK: Queued
+ *    - ESP_ERR_INVALID_ARG: Topic or payload too long, bad QoS
+ *    - ESP_ERR_NO_MEM: Queue full, message dropped
+ */
+esp_err_t mqtt_service_publish(const char *topic, const void *payload, size_t len, uint8_t qos);
+
+/**
+ * @brief Get delivery metrics
+ *
+ * @param out: Destination structure
+ */
+void mqtt_service_get_stats(mqtt_service_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
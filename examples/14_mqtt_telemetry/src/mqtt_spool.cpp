@@ -0,0 +1,407 @@
+/**
+ * @file mqtt_spool.cpp
+ * @brief Store-and-forward queue for MQTT messages in a file
+ *
+ * File layout: a header at offset 0, then the ring of `capacity` bytes.
+ * Records are 4-byte aligned. A record that does not fit before the end of
+ * the ring is preceded by a wrap marker and written at the start instead;
+ * the bytes after the marker count as used until the reader passes them.
+ */
+
+#include "mqtt_spool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_log.h"
+
+static const char *TAG = "mqtt_spool";
+
+#define SPOOL_MAGIC     0x5053514D  // "MQSP"
+#define SPOOL_VERSION   1
+#define RECORD_MAGIC    0x4345524D  // "MREC"
+#define WRAP_MAGIC      0x5041524D  // "MRAP"
+
+// The ring starts after the header, leaving room for it to grow
+#define DATA_OFFSET     64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t count;
+    uint32_t next_seq;
+    uint32_t crc;               // Over all fields above
+} file_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t topic_len;
+    uint16_t payload_len;
+    uint8_t qos;
+    uint8_t reserved[3];
+    uint32_t crc;               // Over seq..reserved, topic and payload
+} record_header_t;
+
+struct mqtt_spool {
+    FILE *f;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t count;
+    uint32_t next_seq;
+    uint32_t dropped;
+    uint32_t recovered;
+};
+
+#define ALIGN4(x)       (((x) + 3) & ~(size_t)3)
+
+// Largest record, used for the minimum capacity
+#define MAX_RECORD_SIZE ALIGN4(sizeof(record_header_t) + MQTT_SPOOL_MAX_TOPIC + MQTT_SPOOL_MAX_PAYLOAD)
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t record_crc(const record_header_t *h, const char *topic, const uint8_t *payload) {
+    uint32_t crc = crc32_update(0, &h->seq,
+                                offsetof(record_header_t, crc) - offsetof(record_header_t, seq));
+    crc = crc32_update(crc, topic, h->topic_len);
+    return crc32_update(crc, payload, h->payload_len);
+}
+
+static uint32_t record_size(const record_header_t *h) {
+    return ALIGN4(sizeof(record_header_t) + h->topic_len + h->payload_len);
+}
+
+static bool file_read(mqtt_spool_t *s, uint32_t off, void *buf, size_t len) {
+    return fseek(s->f, DATA_OFFSET + off, SEEK_SET) == 0 && fread(buf, 1, len, s->f) == len;
+}
+
+static bool file_write(mqtt_spool_t *s, uint32_t off, const void *buf, size_t len) {
+    return fseek(s->f, DATA_OFFSET + off, SEEK_SET) == 0 && fwrite(buf, 1, len, s->f) == len;
+}
+
+static void reset(mqtt_spool_t *s) {
+    s->head = 0;
+    s->tail = 0;
+    s->used = 0;
+    s->count = 0;
+}
+
+/**
+ * @brief Read the record starting at off, following a wrap marker
+ *
+ * @param pos: Offset of the record
+ * @param skipped: Bytes skipped at the end of the ring
+ * @param rec: Also read and verify topic and payload, can be NULL
+ */
+static bool read_at(mqtt_spool_t *s, uint32_t off, uint32_t *pos, uint32_t *skipped,
+                    record_header_t *h, mqtt_spool_record_t *rec) {
+    *skipped = 0;
+    if (off >= s->capacity) {
+        off = 0;
+    } else {
+        uint32_t magic;
+        if (!file_read(s, off, &magic, sizeof(magic))) {
+            return false;
+        }
+        if (magic == WRAP_MAGIC) {
+            *skipped = s->capacity - off;
+            off = 0;
+        }
+    }
+    *pos = off;
+
+    if (off + sizeof(*h) > s->capacity || !file_read(s, off, h, sizeof(*h))) {
+        return false;
+    }
+    if (h->magic != RECORD_MAGIC || h->topic_len == 0 || h->topic_len >= MQTT_SPOOL_MAX_TOPIC ||
+        h->payload_len > MQTT_SPOOL_MAX_PAYLOAD || off + record_size(h) > s->capacity) {
+        return false;
+    }
+    if (rec == NULL) {
+        return true;
+    }
+
+    if (!file_read(s, off + sizeof(*h), rec->topic, h->topic_len) ||
+        !file_read(s, off + sizeof(*h) + h->topic_len, rec->payload, h->payload_len)) {
+        return false;
+    }
+    if (record_crc(h, rec->topic, rec->payload) != h->crc) {
+        return false;
+    }
+    rec->topic[h->topic_len] = '\0';
+    rec->len = h->payload_len;
+    rec->qos = h->qos;
+    rec->seq = h->seq;
+    return true;
+}
+
+/**
+ * @brief Remove the oldest record
+ */
+static esp_err_t pop_head(mqtt_spool_t *s) {
+    uint32_t pos, skipped;
+    record_header_t h;
+    if (!read_at(s, s->head, &pos, &skipped, &h, NULL)) {
+        ESP_LOGE(TAG, "Corrupt record at %lu, discarding %lu messages", (unsigned long)s->head,
+                 (unsigned long)s->count);
+        reset(s);
+        return ESP_FAIL;
+    }
+    s->head = pos + record_size(&h);
+    s->used -= skipped + record_size(&h);
+    if (--s->count == 0) {
+        reset(s);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t write_header(mqtt_spool_t *s) {
+    file_header_t hdr = {};
+    hdr.magic = SPOOL_MAGIC;
+    hdr.version = SPOOL_VERSION;
+    hdr.capacity = s->capacity;
+    hdr.head = s->head;
+    hdr.tail = s->tail;
+    hdr.used = s->used;
+    hdr.count = s->count;
+    hdr.next_seq = s->next_seq;
+    hdr.crc = crc32_update(0, &hdr, offsetof(file_header_t, crc));
+    if (fseek(s->f, 0, SEEK_SET) != 0 || fwrite(&hdr, 1, sizeof(hdr), s->f) != sizeof(hdr)) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static bool load_header(mqtt_spool_t *s) {
+    file_header_t hdr;
+    if (fseek(s->f, 0, SEEK_SET) != 0 || fread(&hdr, 1, sizeof(hdr), s->f) != sizeof(hdr)) {
+        return false;
+    }
+    if (hdr.magic != SPOOL_MAGIC || hdr.version != SPOOL_VERSION ||
+        hdr.crc != crc32_update(0, &hdr, offsetof(file_header_t, crc))) {
+        return false;
+    }
+    if (hdr.capacity != s->capacity) {
+        ESP_LOGW(TAG, "Capacity changed, starting over");
+        return false;
+    }
+    if (hdr.head > hdr.capacity || hdr.tail > hdr.capacity || hdr.used > hdr.capacity) {
+        return false;
+    }
+    s->head = hdr.head;
+    s->tail = hdr.tail;
+    s->used = hdr.used;
+    s->count = hdr.count;
+    s->next_seq = hdr.next_seq;
+    return true;
+}
+
+/**
+ * @brief Pick up records appended after the last sync
+ */
+static void recover(mqtt_spool_t *s, mqtt_spool_record_t *tmp) {
+    for (;;) {
+        uint32_t pos, skipped;
+        record_header_t h;
+        if (!read_at(s, s->tail, &pos, &skipped, &h, tmp) || h.seq != s->next_seq) {
+            break;
+        }
+        uint32_t size = record_size(&h);
+        if (s->used + skipped + size > s->capacity) {
+            break;  // Would run into the head
+        }
+        s->tail = pos + size;
+        s->used += skipped + size;
+        s->count++;
+        s->next_seq++;
+        s->recovered++;
+    }
+
+    // The oldest record must be intact, or nothing can be trusted
+    if (s->count > 0) {
+        uint32_t pos, skipped;
+        record_header_t h;
+        if (!read_at(s, s->head, &pos, &skipped, &h, tmp)) {
+            ESP_LOGW(TAG, "Oldest record unreadable, discarding %lu messages",
+                     (unsigned long)s->count);
+            reset(s);
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t mqtt_spool_open(const char *path, uint32_t capacity, mqtt_spool_t **out) {
+    capacity &= ~(uint32_t)3;
+    if (path == NULL || out == NULL || capacity < 4 * MAX_RECORD_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_spool_t *s = (mqtt_spool_t *)calloc(1, sizeof(mqtt_spool_t));
+    mqtt_spool_record_t *tmp = (mqtt_spool_record_t *)malloc(sizeof(mqtt_spool_record_t));
+    if (s == NULL || tmp == NULL) {
+        free(s);
+        free(tmp);
+        return ESP_ERR_NO_MEM;
+    }
+    s->capacity = capacity;
+
+    s->f = fopen(path, "r+b");
+    if (s->f != NULL && load_header(s)) {
+        recover(s, tmp);
+    } else {
+        if (s->f == NULL) {
+            s->f = fopen(path, "w+b");
+        }
+        reset(s);
+        s->next_seq = 1;
+    }
+    free(tmp);
+
+    if (s->f == NULL || mqtt_spool_sync(s) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        if (s->f != NULL) {
+            fclose(s->f);
+        }
+        free(s);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "%s: %lu messages (%lu recovered), %lu/%lu bytes", path, (unsigned long)s->count,
+             (unsigned long)s->recovered, (unsigned long)s->used, (unsigned long)s->capacity);
+    *out = s;
+    return ESP_OK;
+}
+
+esp_err_t mqtt_spool_append(mqtt_spool_t *s, const char *topic, const uint8_t *payload,
+                            size_t len, uint8_t qos) {
+    size_t topic_len = strlen(topic);
+    if (topic_len == 0 || topic_len >= MQTT_SPOOL_MAX_TOPIC || len > MQTT_SPOOL_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    record_header_t h = {};
+    h.magic = RECORD_MAGIC;
+    h.seq = s->next_seq;
+    h.topic_len = (uint16_t)topic_len;
+    h.payload_len = (uint16_t)len;
+    h.qos = qos;
+    h.crc = record_crc(&h, topic, payload);
+    uint32_t size = record_size(&h);
+
+    // Make room, oldest messages first
+    bool dropped = false;
+    uint32_t waste;
+    for (;;) {
+        waste = s->tail + size > s->capacity ? s->capacity - s->tail : 0;
+        if (s->used + waste + size <= s->capacity) {
+            break;
+        }
+        pop_head(s);
+        s->dropped++;
+        dropped = true;
+    }
+
+    if (waste > 0 || s->tail == s->capacity) {
+        uint32_t marker = WRAP_MAGIC;
+        if (waste > 0 && !file_write(s, s->tail, &marker, sizeof(marker))) {
+            return ESP_FAIL;
+        }
+        s->tail = 0;
+    }
+
+    static const uint8_t pad[3] = {0};
+    size_t pad_len = size - sizeof(h) - topic_len - len;
+    if (!file_write(s, s->tail, &h, sizeof(h)) || fwrite(topic, 1, topic_len, s->f) != topic_len ||
+        fwrite(payload, 1, len, s->f) != len || fwrite(pad, 1, pad_len, s->f) != pad_len) {
+        return ESP_FAIL;
+    }
+    s->tail += size;
+    s->used += waste + size;
+    s->count++;
+    s->next_seq++;
+
+    // The stored head must never point at overwritten data
+    return dropped ? mqtt_spool_sync(s) : ESP_OK;
+}
+
+esp_err_t mqtt_spool_peek(mqtt_spool_t *s, mqtt_spool_record_t *records, size_t max,
+                          size_t *count) {
+    *count = 0;
+    uint32_t off = s->head;
+    while (*count < max && *count < s->count) {
+        uint32_t pos, skipped;
+        record_header_t h;
+        if (!read_at(s, off, &pos, &skipped, &h, &records[*count])) {
+            ESP_LOGE(TAG, "Corrupt record at %lu, discarding %lu messages", (unsigned long)off,
+                     (unsigned long)s->count);
+            reset(s);
+            *count = 0;
+            return ESP_FAIL;
+        }
+        off = pos + record_size(&h);
+        (*count)++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t mqtt_spool_consume(mqtt_spool_t *s, uint32_t seq) {
+    while (s->count > 0) {
+        uint32_t pos, skipped;
+        record_header_t h;
+        if (read_at(s, s->head, &pos, &skipped, &h, NULL) && (int32_t)(h.seq - seq) > 0) {
+            break;
+        }
+        if (pop_head(s) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t mqtt_spool_sync(mqtt_spool_t *s) {
+    if (write_header(s) != ESP_OK || fflush(s->f) != 0 || fsync(fileno(s->f)) != 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void mqtt_spool_get_info(const mqtt_spool_t *s, mqtt_spool_info_t *info) {
+    info->count = s->count;
+    info->used = s->used;
+    info->capacity = s->capacity;
+    info->dropped = s->dropped;
+    info->recovered = s->recovered;
+}
+
+void mqtt_spool_close(mqtt_spool_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    mqtt_spool_sync(s);
+    fclose(s->f);
+    free(s);
+}
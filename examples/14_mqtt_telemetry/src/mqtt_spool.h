@@ -0,0 +1,126 @@
+/**
+ * @file mqtt_spool.h
+ * @brief Store-and-forward queue for MQTT messages in a file
+ *
+ * Messages that cannot be sent while the broker is unreachable are
+ * appended to a fixed-size ring inside one file on the SD card, and
+ * replayed in order once the connection is back. When the ring is full the
+ * oldest messages are dropped.
+ *
+ * Every record has a sequence number and a CRC. The file header (head,
+ * tail, next sequence number) is only written by mqtt_spool_sync(), so on
+ * open the records appended after the last sync are found again by
+ * scanning forward from the stored tail. A crash can therefore replay
+ * messages consumed since the last sync, but does not lose appended ones
+ * that reached the card.
+ *
+ * Uses stdio only, so it also builds for Linux (see host/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_SPOOL_MAX_TOPIC    128   // Including the terminating NUL
+#define MQTT_SPOOL_MAX_PAYLOAD  1024
+
+/**
+ * @brief A spooled message
+ */
+typedef struct {
+    uint32_t seq;
+    uint8_t qos;
+    size_t len;
+    char topic[MQTT_SPOOL_MAX_TOPIC];
+    uint8_t payload[MQTT_SPOOL_MAX_PAYLOAD];
+} mqtt_spool_record_t;
+
+/**
+ * @brief Spool state
+ */
+typedef struct {
+    uint32_t count;             // Messages waiting
+    uint32_t used;              // Bytes of the ring in use
+    uint32_t capacity;          // Ring size in bytes
+    uint32_t dropped;           // Oldest messages dropped because the ring was full
+    uint32_t recovered;         // Messages found past the stored tail at open
+} mqtt_spool_info_t;
+
+typedef struct mqtt_spool mqtt_spool_t;
+
+/**
+ * @brief Open or create a spool file
+ *
+ * An existing file with a different capacity, or an unreadable header, is
+ * started over empty.
+ *
+ * @param path: File path
+ * @param capacity: Ring size in bytes (rounded down to a multiple of 4)
+ * @param out: Spool handle
+ *
+ * @return
+ *    - ESP_OK: Spool ready
+ *    - ESP_ERR_INVALID_ARG: Capacity too small for one maximum size message
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: File cannot be opened or created
+ */
+esp_err_t mqtt_spool_open(const char *path, uint32_t capacity, mqtt_spool_t **out);
+
+/**
+ * @brief Append a message, dropping the oldest ones if the ring is full
+ *
+ * @return
+ *    - ESP_OK: Message stored
+ *    - ESP_ERR_INVALID_SIZE: Topic or payload too long
+ *    - ESP_FAIL: Write error
+ */
+esp_err_t mqtt_spool_append(mqtt_spool_t *spool, const char *topic, const uint8_t *payload,
+                            size_t len, uint8_t qos);
+
+/**
+ * @brief Read the oldest messages without removing them
+ *
+ * @param spool: Spool handle
+ * @param records: Output array
+ * @param max: Size of the array
+ * @param count: Number of records read
+ *
+ * @return
+ *    - ESP_OK: Success (count can be 0)
+ *    - ESP_FAIL: Read error or corrupt record (the spool is emptied)
+ */
+esp_err_t mqtt_spool_peek(mqtt_spool_t *spool, mqtt_spool_record_t *records, size_t max,
+                          size_t *count);
+
+/**
+ * @brief Remove the oldest messages up to and including sequence number seq
+ *
+ * Messages dropped in the meantime are simply no longer there.
+ */
+esp_err_t mqtt_spool_consume(mqtt_spool_t *spool, uint32_t seq);
+
+/**
+ * @brief Write the header and flush the file to the card
+ */
+esp_err_t mqtt_spool_sync(mqtt_spool_t *spool);
+
+/**
+ * @brief Get the spool state
+ */
+void mqtt_spool_get_info(const mqtt_spool_t *spool, mqtt_spool_info_t *info);
+
+/**
+ * @brief Sync and close the spool
+ */
+void mqtt_spool_close(mqtt_spool_t *spool);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @file c6_bench_main.cpp
+ * @brief Linux bench for the P4 <-> C6 protocol library
+ *
+ * Bench mode connects two links over a socketpair. A server thread answers
+ * ECHO requests (the simulated C6); the main thread keeps a window of
+ * requests in flight and checks every echoed payload. With -r the server
+ * holds requests back and answers them in reverse order, to exercise the
+ * response demultiplexing.
+ *
+ * Codec mode (-t) encodes random frames into one buffer and feeds it to
+ * the stream decoder in random-sized chunks, checking every frame.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -o c6_bench host/c6_bench_main.cpp \
+ *       host/c6_transport_socket.cpp src/c6_proto.cpp src/c6_link.cpp \
+ *       src/c6_bench.cpp -lpthread
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "c6_bench.h"
+#include "c6_link.h"
+#include "c6_proto.h"
+#include "c6_transport_socket.h"
+
+int esp_log_verbose = 0;
+
+#define SOCKET_BUF_SIZE (256 * 1024)
+#define MAX_HELD        8
+
+static const size_t default_sizes[] = {16, 256, 4096, 65536, 131072};
+static const size_t default_windows[] = {1, 8, 32};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]   echo benchmark over a socketpair\n"
+            "       %s -t          codec self-test\n"
+            "\n"
+            "  -n <count>    Requests per run (default: 8 MB worth, max 20000)\n"
+            "  -s <bytes>    Only run this payload size\n"
+            "  -w <n>        Only run this window (max 64)\n"
+            "  -f <bytes>    Frame payload limit (default 65535)\n"
+            "  -r            Server answers out of order\n"
+            "  -v            Log link steps\n",
+            prog, prog);
+}
+
+// ============================================================================
+// Server thread (simulated C6)
+// ============================================================================
+
+// Request held back by the out-of-order server
+typedef struct {
+    uint16_t seq;
+    uint8_t *data;
+    size_t len;
+} held_t;
+
+typedef struct {
+    c6_link_t *link;
+    volatile bool running;
+    bool reorder;
+    held_t held[MAX_HELD];
+    int held_count;
+} server_t;
+
+static void flush_held(server_t *srv) {
+    // Newest first
+    while (srv->held_count > 0) {
+        held_t *h = &srv->held[--srv->held_count];
+        c6_link_respond(srv->link, h->seq, C6_STATUS_OK, h->data, h->len);
+        free(h->data);
+    }
+}
+
+static void reorder_handler(void *ctx, c6_link_t *link, const c6_request_t *req) {
+    server_t *srv = (server_t *)ctx;
+    if (req->cmd != C6_CMD_ECHO) {
+        c6_bench_echo_handler(NULL, link, req);
+        return;
+    }
+
+    held_t *h = &srv->held[srv->held_count++];
+    h->seq = req->seq;
+    h->len = req->len;
+    h->data = (uint8_t *)malloc(req->len ? req->len : 1);
+    memcpy(h->data, req->payload, req->len);
+    if (srv->held_count == MAX_HELD) {
+        flush_held(srv);
+    }
+}
+
+static void *server_thread(void *arg) {
+    server_t *srv = (server_t *)arg;
+    while (srv->running) {
+        c6_link_counters_t before, after;
+        c6_link_get_counters(srv->link, &before);
+        if (c6_link_poll(srv->link, srv->held_count ? 1 : 50) != ESP_OK) {
+            break;
+        }
+        c6_link_get_counters(srv->link, &after);
+        // Nothing more coming for now: answer what was held back
+        if (after.bytes_received == before.bytes_received) {
+            flush_held(srv);
+        }
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+static int run_bench(uint32_t count, size_t only_size, size_t only_window,
+                     size_t max_fragment, bool reorder) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+    for (int i = 0; i < 2; i++) {
+        int size = SOCKET_BUF_SIZE;
+        setsockopt(sv[i], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        setsockopt(sv[i], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    server_t srv = {};
+    srv.reorder = reorder;
+    c6_link_config_t cfg = C6_LINK_CONFIG_DEFAULT();
+    c6_transport_socket_init(sv[1], max_fragment, &cfg.transport);
+    cfg.on_request = reorder ? reorder_handler : c6_bench_echo_handler;
+    cfg.request_ctx = &srv;
+    if (c6_link_create(&cfg, &srv.link) != ESP_OK) {
+        return 1;
+    }
+
+    // Outstanding bytes stay below the socket buffer, see c6_link_request()
+    c6_link_t *client = NULL;
+    cfg = C6_LINK_CONFIG_DEFAULT();
+    c6_transport_socket_init(sv[0], max_fragment, &cfg.transport);
+    cfg.max_inflight = 64;
+    cfg.max_inflight_bytes = SOCKET_BUF_SIZE / 2;
+    cfg.timeout_ms = 5000;
+    if (c6_link_create(&cfg, &client) != ESP_OK) {
+        return 1;
+    }
+
+    srv.running = true;
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, &srv);
+
+    printf("%8s %4s %7s %10s %9s %8s %8s %8s %8s %6s\n", "bytes", "win", "count", "msg/s",
+           "MB/s", "avg us", "p50 us", "p99 us", "max us", "errors");
+
+    int failed = 0;
+    size_t n_sizes = only_size ? 1 : sizeof(default_sizes) / sizeof(default_sizes[0]);
+    size_t n_windows = only_window ? 1 : sizeof(default_windows) / sizeof(default_windows[0]);
+    for (size_t i = 0; i < n_sizes && !failed; i++) {
+        for (size_t j = 0; j < n_windows && !failed; j++) {
+            c6_bench_params_t params;
+            params.size = only_size ? only_size : default_sizes[i];
+            params.window = only_window ? only_window : default_windows[j];
+            params.count = count;
+            if (params.count == 0) {
+                params.count = (8 * 1024 * 1024) / (params.size + 64);
+                if (params.count > 20000) {
+                    params.count = 20000;
+                }
+            }
+
+            c6_bench_result_t r;
+            esp_err_t err = c6_bench_run(client, &params, &r);
+            printf("%8zu %4zu %7lu %10.0f %9.1f %8lu %8lu %8lu %8lu %6lu\n", params.size,
+                   params.window, (unsigned long)r.completed, r.msgs_per_s, r.mbytes_per_s,
+                   (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p50_us,
+                   (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us,
+                   (unsigned long)r.errors);
+            if (err != ESP_OK) {
+                fprintf(stderr, "Link failed: %s\n", esp_err_to_name(err));
+                failed = 1;
+            } else if (r.errors) {
+                failed = 1;
+            }
+        }
+    }
+
+    c6_link_counters_t c;
+    c6_link_get_counters(client, &c);
+    printf("\nClient: %u requests, %u frames sent, %u received, %u assembled from "
+           "several reads, %u timeouts, %u stale\n",
+           c.requests_sent, c.frames_sent, c.frames_received, c.frames_copied, c.timeouts,
+           c.stale);
+
+    srv.running = false;
+    pthread_join(thread, NULL);
+    c6_link_destroy(client);
+    c6_link_destroy(srv.link);
+    close(sv[0]);
+    close(sv[1]);
+    return failed;
+}
+
+// ============================================================================
+// Codec self-test
+// ============================================================================
+
+typedef struct {
+    const c6_frame_hdr_t *expected;
+    const uint8_t *const *payloads;
+    size_t next;
+    size_t bad;
+} codec_check_t;
+
+static void on_test_frame(void *ctx, const c6_frame_hdr_t *hdr, const uint8_t *payload) {
+    codec_check_t *chk = (codec_check_t *)ctx;
+    const c6_frame_hdr_t *e = &chk->expected[chk->next];
+    if (hdr->code != e->code || hdr->flags != e->flags || hdr->seq != e->seq ||
+        hdr->len != e->len || memcmp(payload, chk->payloads[chk->next], hdr->len) != 0) {
+        chk->bad++;
+    }
+    chk->next++;
+}
+
+static int run_codec_test(void) {
+    const size_t frames = 2000;
+    c6_frame_hdr_t *hdrs = (c6_frame_hdr_t *)calloc(frames, sizeof(c6_frame_hdr_t));
+    const uint8_t **payloads = (const uint8_t **)calloc(frames, sizeof(uint8_t *));
+    size_t total = 0;
+
+    srand(1);
+    for (size_t i = 0; i < frames; i++) {
+        hdrs[i].code = (uint8_t)rand();
+        hdrs[i].flags = (uint8_t)(rand() & (C6_FLAG_RESPONSE | C6_FLAG_MORE));
+        hdrs[i].seq = (uint16_t)rand();
+        // Mostly small frames, some up to the limit
+        hdrs[i].len = (uint16_t)(rand() % 10 == 0 ? rand() % 65536 : rand() % 300);
+        total += C6_PROTO_HDR_LEN + hdrs[i].len;
+    }
+
+    uint8_t *stream = (uint8_t *)malloc(total);
+    size_t off = 0;
+    for (size_t i = 0; i < frames; i++) {
+        c6_proto_encode_header(&hdrs[i], stream + off);
+        off += C6_PROTO_HDR_LEN;
+        payloads[i] = stream + off;
+        for (size_t k = 0; k < hdrs[i].len; k++) {
+            stream[off + k] = (uint8_t)rand();
+        }
+        off += hdrs[i].len;
+    }
+
+    int failed = 0;
+    const size_t max_chunks[] = {1, 7, 1500, 70000, total};
+    for (size_t m = 0; m < sizeof(max_chunks) / sizeof(max_chunks[0]); m++) {
+        c6_proto_decoder_t dec;
+        c6_proto_decoder_init(&dec, 0);
+        codec_check_t chk = {hdrs, payloads, 0, 0};
+
+        esp_err_t err = ESP_OK;
+        for (off = 0; off < total && err == ESP_OK;) {
+            size_t n = 1 + (size_t)rand() % max_chunks[m];
+            if (n > total - off) {
+                n = total - off;
+            }
+            err = c6_proto_decoder_feed(&dec, stream + off, n, on_test_frame, &chk);
+            off += n;
+        }
+
+        bool ok = err == ESP_OK && chk.next == frames && chk.bad == 0 && dec.len == 0;
+        printf("Chunks up to %6zu bytes: %zu frames, %zu bad, %lu zero-copy, %lu copied: %s\n",
+               max_chunks[m], chk.next, chk.bad, (unsigned long)(dec.frames - dec.copied),
+               (unsigned long)dec.copied, ok ? "OK" : "FAIL");
+        failed |= !ok;
+        c6_proto_decoder_free(&dec);
+    }
+
+    // A corrupt header must be reported, not skipped
+    c6_proto_decoder_t dec;
+    c6_proto_decoder_init(&dec, 0);
+    codec_check_t chk = {hdrs, payloads, 0, 0};
+    uint8_t bad[C6_PROTO_HDR_LEN] = {0x01, 0x80, 0, 0, 0, 0};
+    bool ok = c6_proto_decoder_feed(&dec, bad, sizeof(bad), on_test_frame, &chk) ==
+              ESP_ERR_INVALID_RESPONSE;
+    printf("Unknown flags rejected: %s\n", ok ? "OK" : "FAIL");
+    failed |= !ok;
+    c6_proto_decoder_free(&dec);
+
+    free(stream);
+    free(payloads);
+    free(hdrs);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 0;
+    size_t size = 0;
+    size_t window = 0;
+    size_t max_fragment = 0;
+    bool reorder = false;
+    bool codec_test = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:w:f:rtv")) != -1) {
+        switch (opt) {
+            case 'n': count = (uint32_t)atoi(optarg); break;
+            case 's': size = (size_t)atoi(optarg); break;
+            case 'w': window = (size_t)atoi(optarg); break;
+            case 'f': max_fragment = (size_t)atoi(optarg); break;
+            case 'r': reorder = true; break;
+            case 't': codec_test = true; break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (window > 64) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (codec_test) {
+        return run_codec_test();
+    }
+    return run_bench(count, size, window, max_fragment, reorder);
+}
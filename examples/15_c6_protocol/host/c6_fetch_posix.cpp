@@ -0,0 +1,153 @@
+/**
+ * @file c6_fetch_posix.cpp
+ * @brief c6_fetch_fn_t for Linux: http:// over BSD sockets and file://
+ */
+
+#include "c6_fetch_posix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#define FETCH_BUFFER_SIZE 4096
+
+static esp_err_t fetch_file(const char *path, c6_offload_data_cb_t on_data, void *data_ctx,
+                            c6_fetch_result_t *res) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t buf[FETCH_BUFFER_SIZE];
+    esp_err_t err = ESP_OK;
+    size_t n;
+    res->status = 200;
+    while (err == ESP_OK && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        res->body_bytes += n;
+        err = on_data(data_ctx, buf, n);
+    }
+    fclose(f);
+    return err;
+}
+
+static int connect_to(const char *host, const char *port) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *ai;
+    if (getaddrinfo(host, port, &hints, &ai) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *a = ai; a; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+            break;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(ai);
+    return fd;
+}
+
+static esp_err_t fetch_http(const char *url, c6_offload_data_cb_t on_data, void *data_ctx,
+                            c6_fetch_result_t *res) {
+    // http://host[:port][/path]
+    char host[256];
+    char port[8] = "80";
+    const char *p = url + strlen("http://");
+    const char *path = strchr(p, '/');
+    size_t host_len = path ? (size_t)(path - p) : strlen(p);
+    if (!path) {
+        path = "/";
+    }
+    if (host_len == 0 || host_len >= sizeof(host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(host, p, host_len);
+    host[host_len] = '\0';
+    char *colon = strchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+
+    int fd = connect_to(host, port);
+    if (fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char req[1024];
+    int req_len = snprintf(req, sizeof(req),
+                           "GET %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: c6_offload\r\n\r\n",
+                           path, host);
+    if (req_len >= (int)sizeof(req) || send(fd, req, req_len, 0) != req_len) {
+        close(fd);
+        return ESP_FAIL;
+    }
+    res->request_bytes += req_len;
+
+    // Collect the headers, then stream the rest of the body
+    char buf[FETCH_BUFFER_SIZE + 1];
+    size_t len = 0;
+    char *body = NULL;
+    while (!body) {
+        if (len == FETCH_BUFFER_SIZE) {
+            close(fd);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        ssize_t n = recv(fd, buf + len, FETCH_BUFFER_SIZE - len, 0);
+        if (n <= 0) {
+            close(fd);
+            return n == 0 ? ESP_ERR_INVALID_RESPONSE : ESP_FAIL;
+        }
+        len += n;
+        buf[len] = '\0';
+        body = strstr(buf, "\r\n\r\n");
+    }
+    body += 4;
+    res->header_bytes = body - buf;
+    if (sscanf(buf, "HTTP/%*d.%*d %d", &res->status) != 1) {
+        close(fd);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    esp_err_t err = ESP_OK;
+    size_t n = len - res->header_bytes;
+    if (n > 0) {
+        res->body_bytes += n;
+        err = on_data(data_ctx, (const uint8_t *)body, n);
+    }
+    while (err == ESP_OK) {
+        ssize_t r = recv(fd, buf, FETCH_BUFFER_SIZE, 0);
+        if (r < 0) {
+            err = ESP_FAIL;
+        }
+        if (r <= 0) {
+            break;
+        }
+        res->body_bytes += r;
+        err = on_data(data_ctx, (const uint8_t *)buf, r);
+    }
+    close(fd);
+    return err;
+}
+
+esp_err_t c6_fetch_posix(void *ctx, const char *url, c6_offload_data_cb_t on_data,
+                         void *data_ctx, c6_fetch_result_t *res) {
+    (void)ctx;
+    if (strncmp(url, "file://", 7) == 0) {
+        return fetch_file(url + 7, on_data, data_ctx, res);
+    }
+    if (strncmp(url, "http://", 7) == 0) {
+        return fetch_http(url, on_data, data_ctx, res);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file c6_fetch_posix.h
+ * @brief c6_fetch_fn_t for Linux: http:// over BSD sockets and file://
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "c6_offload.h"
+
+/**
+ * @brief Fetch http://host[:port]/path (HTTP/1.0) or file://path (ctx unused)
+ *
+ * HTTP/1.0 keeps the body unchunked. Request and header bytes are exact.
+ * A file is reported as status 200 without headers.
+ *
+ * @return
+ *    - ESP_OK: Body complete
+ *    - ESP_ERR_INVALID_ARG: Unsupported URL
+ *    - ESP_ERR_NOT_FOUND: File not found, host unknown or refusing
+ *    - ESP_ERR_INVALID_RESPONSE: Malformed response
+ *    - ESP_FAIL: Connection error
+ *    - Others: Error from on_data
+ */
+esp_err_t c6_fetch_posix(void *ctx, const char *url, c6_offload_data_cb_t on_data,
+                         void *data_ctx, c6_fetch_result_t *res);
@@ -0,0 +1,260 @@
+/**
+ * @file c6_offload_main.cpp
+ * @brief Linux tool for the HTTP_GET offload
+ *
+ * Runs the offload server (the C6 side) in a thread on one end of a
+ * socketpair and sends HTTP_GET requests from the other end: once with
+ * JSON Pointers, getting a binary record, and once without, getting the
+ * whole body. Prints the decoded values and the bytes each variant puts
+ * on the link, next to the estimate for the P4 fetching the URL itself
+ * through ESP-HOSTED.
+ *
+ * Build:
+ *   g++ -O2 -Ihost -Isrc -I../../components/json_stream/include -o c6_offload \
+ *       host/c6_offload_main.cpp host/c6_fetch_posix.cpp \
+ *       host/c6_transport_socket.cpp src/c6_proto.cpp src/c6_link.cpp \
+ *       src/c6_bench.cpp src/c6_offload.cpp \
+ *       ../../components/json_stream/json_stream.cpp -lpthread
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "esp_timer.h"
+#include "c6_bench.h"
+#include "c6_fetch_posix.h"
+#include "c6_link.h"
+#include "c6_offload.h"
+#include "c6_transport_socket.h"
+
+int esp_log_verbose = 0;
+
+#define DEFAULT_URL     "file://host/forecast.json"
+#define MAX_BODY        (256 * 1024)
+
+static const char *default_pointers[] = {
+    "/current_weather/time",
+    "/current_weather/temperature",
+    "/current_weather/windspeed",
+    "/current_weather/weathercode",
+    "/current_weather/is_day",
+    "/hourly/temperature_2m/0",
+    "/timezone",
+    "/no_such_field",
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "  -u <url>      http://host[:port]/path or file://path (default %s)\n"
+            "  -p <pointer>  JSON Pointer to extract, repeatable (default: weather fields)\n"
+            "  -n <count>    Requests per variant (default 10)\n"
+            "  -v            Log link and offload steps\n",
+            prog, DEFAULT_URL);
+}
+
+typedef struct {
+    c6_link_t *link;
+    volatile bool running;
+} server_t;
+
+static void *server_thread(void *arg) {
+    server_t *srv = (server_t *)arg;
+    while (srv->running && c6_link_poll(srv->link, 50) == ESP_OK) {
+    }
+    return NULL;
+}
+
+static void print_value(const char *pointer, const c6_value_t *v) {
+    printf("  %-32s ", pointer);
+    switch (v->type) {
+        case C6_VALUE_MISSING: printf("(missing)\n"); break;
+        case C6_VALUE_NULL: printf("null\n"); break;
+        case C6_VALUE_FALSE: printf("false\n"); break;
+        case C6_VALUE_TRUE: printf("true\n"); break;
+        case C6_VALUE_INT: printf("%lld (int)\n", (long long)v->i); break;
+        case C6_VALUE_F32: printf("%g (f32)\n", v->f); break;
+        case C6_VALUE_F64: printf("%.17g (f64)\n", v->f); break;
+        case C6_VALUE_STRING: printf("\"%.*s\"\n", (int)v->len, v->str); break;
+        default: printf("?\n"); break;
+    }
+}
+
+/**
+ * @brief Send the same request count times
+ *
+ * @return Link bytes (both directions) of the last request, 0 on error
+ */
+static uint64_t run_variant(c6_link_t *client, const uint8_t *req, size_t req_len, int count,
+                            uint8_t *resp, size_t resp_size, size_t *resp_len,
+                            int64_t *avg_us) {
+    uint64_t bytes = 0;
+    int64_t total_us = 0;
+
+    for (int i = 0; i < count; i++) {
+        c6_link_counters_t before, after;
+        c6_link_get_counters(client, &before);
+        int64_t start = esp_timer_get_time();
+
+        uint8_t status;
+        esp_err_t err = c6_link_call(client, C6_CMD_HTTP_GET, req, req_len, &status, resp,
+                                     resp_size, resp_len);
+        total_us += esp_timer_get_time() - start;
+        if (err != ESP_OK || status != C6_STATUS_OK) {
+            fprintf(stderr, "HTTP_GET failed: %s, status %u\n", esp_err_to_name(err), status);
+            return 0;
+        }
+
+        c6_link_get_counters(client, &after);
+        bytes = (after.bytes_sent - before.bytes_sent) +
+                (after.bytes_received - before.bytes_received);
+    }
+
+    *avg_us = total_us / count;
+    return bytes;
+}
+
+int main(int argc, char **argv) {
+    const char *url = DEFAULT_URL;
+    const char *pointers[C6_OFFLOAD_MAX_FIELDS];
+    size_t n_pointers = 0;
+    int count = 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "u:p:n:v")) != -1) {
+        switch (opt) {
+            case 'u': url = optarg; break;
+            case 'p':
+                if (n_pointers == C6_OFFLOAD_MAX_FIELDS) {
+                    fprintf(stderr, "At most %d pointers\n", C6_OFFLOAD_MAX_FIELDS);
+                    return 2;
+                }
+                pointers[n_pointers++] = optarg;
+                break;
+            case 'n': count = atoi(optarg); break;
+            case 'v': esp_log_verbose++; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (count < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (n_pointers == 0) {
+        n_pointers = sizeof(default_pointers) / sizeof(default_pointers[0]);
+        memcpy(pointers, default_pointers, sizeof(default_pointers));
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+
+    // C6 side
+    c6_offload_config_t ocfg = {};
+    ocfg.fetch = c6_fetch_posix;
+    ocfg.max_body = MAX_BODY;
+    ocfg.next = c6_bench_echo_handler;
+    c6_offload_server_t *offload = NULL;
+    c6_offload_server_create(&ocfg, &offload);
+
+    server_t srv = {};
+    c6_link_config_t cfg = C6_LINK_CONFIG_DEFAULT();
+    c6_transport_socket_init(sv[1], 0, &cfg.transport);
+    cfg.max_message = MAX_BODY + 2;
+    cfg.on_request = c6_offload_handle_request;
+    cfg.request_ctx = offload;
+    if (c6_link_create(&cfg, &srv.link) != ESP_OK) {
+        return 1;
+    }
+
+    // P4 side
+    c6_link_t *client = NULL;
+    cfg = C6_LINK_CONFIG_DEFAULT();
+    c6_transport_socket_init(sv[0], 0, &cfg.transport);
+    cfg.max_message = MAX_BODY + 2;
+    cfg.timeout_ms = 15000;
+    if (c6_link_create(&cfg, &client) != ESP_OK) {
+        return 1;
+    }
+
+    srv.running = true;
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, &srv);
+
+    uint8_t req[2048];
+    size_t req_len = 0;
+    uint8_t *resp = (uint8_t *)malloc(MAX_BODY + 2);
+    size_t resp_len = 0;
+    int failed = 0;
+
+    // With pointers: binary record
+    if (c6_offload_encode_request(url, pointers, n_pointers, req, sizeof(req), &req_len) !=
+        ESP_OK) {
+        fprintf(stderr, "Request too long\n");
+        return 2;
+    }
+    int64_t record_us = 0;
+    uint64_t record_bytes = run_variant(client, req, req_len, count, resp, MAX_BODY + 2,
+                                        &resp_len, &record_us);
+    size_t record_len = resp_len;
+
+    uint16_t http_status = 0;
+    uint8_t flags = 0;
+    c6_value_t values[C6_OFFLOAD_MAX_FIELDS];
+    size_t n_values = 0;
+    if (record_bytes == 0 ||
+        c6_offload_decode_record(resp, resp_len, &http_status, &flags, values,
+                                 C6_OFFLOAD_MAX_FIELDS, &n_values) != ESP_OK) {
+        fprintf(stderr, "No valid record\n");
+        failed = 1;
+    } else {
+        printf("%s: HTTP %u%s, %zu-byte record\n", url, http_status,
+               (flags & C6_OFFLOAD_JSON_ERROR) ? ", JSON error" : "", record_len);
+        for (size_t i = 0; i < n_values; i++) {
+            print_value(pointers[i], &values[i]);
+        }
+    }
+
+    // Without pointers: the whole body
+    c6_offload_encode_request(url, NULL, 0, req, sizeof(req), &req_len);
+    int64_t raw_us = 0;
+    uint64_t raw_bytes = run_variant(client, req, req_len, count, resp, MAX_BODY + 2, &resp_len,
+                                     &raw_us);
+    failed |= (raw_bytes == 0);
+
+    srv.running = false;
+    pthread_join(thread, NULL);
+
+    c6_offload_stats_t st;
+    c6_offload_get_stats(offload, &st);
+    uint64_t hosted = st.requests ? st.hosted_bytes / st.requests : 0;
+
+    printf("\nBytes per request (%d requests each)\n", count);
+    printf("  %-34s %10s %10s\n", "", "bytes", "avg us");
+    printf("  %-34s %10llu %10lld\n", "Offload, record over the link", (unsigned long long)record_bytes,
+           (long long)record_us);
+    printf("  %-34s %10llu %10lld\n", "Offload, whole body over the link",
+           (unsigned long long)raw_bytes, (long long)raw_us);
+    printf("  %-34s %10llu %10s\n", "ESP-HOSTED fetch by the P4 (est.)",
+           (unsigned long long)hosted, "-");
+    if (record_bytes > 0) {
+        printf("\n  Record vs ESP-HOSTED: %.1fx fewer bytes on SDIO\n",
+               (double)hosted / record_bytes);
+    }
+    printf("  Fetched %llu HTTP bytes, %u errors\n",
+           (unsigned long long)(st.fetched_bytes / (st.requests ? st.requests : 1)), st.errors);
+
+    c6_link_destroy(client);
+    c6_link_destroy(srv.link);
+    c6_offload_server_destroy(offload);
+    close(sv[0]);
+    close(sv[1]);
+    free(resp);
+    return failed;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file c6_transport_socket.cpp
+ * @brief c6_transport_t on a Linux stream socket
+ */
+
+#include "c6_transport_socket.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+static esp_err_t socket_send(void *ctx, const uint8_t *hdr, size_t hdr_len,
+                             const uint8_t *payload, size_t len) {
+    int fd = (int)(intptr_t)ctx;
+    struct iovec iov[2] = {
+        {(void *)hdr, hdr_len},
+        {(void *)payload, len},
+    };
+    struct iovec *v = iov;
+    int cnt = len > 0 ? 2 : 1;
+
+    while (cnt > 0) {
+        ssize_t n = writev(fd, v, cnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return ESP_FAIL;
+        }
+        // Skip what was written, possibly part of an iovec
+        while (cnt > 0 && (size_t)n >= v->iov_len) {
+            n -= v->iov_len;
+            v++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            v->iov_base = (uint8_t *)v->iov_base + n;
+            v->iov_len -= n;
+        }
+    }
+    return ESP_OK;
+}
+
+static int socket_recv(void *ctx, uint8_t *buf, size_t len, int timeout_ms) {
+    int fd = (int)(intptr_t)ctx;
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ret == 0) {
+        return 0;
+    }
+
+    ssize_t n = read(fd, buf, len);
+    if (n < 0) {
+        return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+    }
+    // 0 is end of stream
+    return n > 0 ? (int)n : -1;
+}
+
+void c6_transport_socket_init(int fd, size_t max_fragment, c6_transport_t *out) {
+    out->send = socket_send;
+    out->recv = socket_recv;
+    out->ctx = (void *)(intptr_t)fd;
+    out->max_fragment = max_fragment;
+}
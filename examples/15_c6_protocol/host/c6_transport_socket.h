@@ -0,0 +1,21 @@
+/**
+ * @file c6_transport_socket.h
+ * @brief c6_transport_t on a Linux stream socket (socketpair, TCP, UART pty)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "c6_link.h"
+
+/**
+ * @brief Wrap a connected stream socket
+ *
+ * Frames are sent with writev(), header and payload without copying.
+ *
+ * @param fd: Connected socket, still owned by the caller
+ * @param max_fragment: Largest frame payload, 0: C6_PROTO_MAX_FRAGMENT
+ * @param out: Transport
+ */
+void c6_transport_socket_init(int fd, size_t max_fragment, c6_transport_t *out);
@@ -0,0 +1,76 @@
+/**
+ * @file lv_conf.h
+ * @brief LVGL configuration for JC4880P443C example
+ */
+
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+#include <stdint.h>
+
+/*====================
+   COLOR SETTINGS
+ *====================*/
+#define LV_COLOR_DEPTH 16
+
+/*====================
+   MEMORY SETTINGS
+ *====================*/
+#define LV_MEM_CUSTOM 1
+#if LV_MEM_CUSTOM
+#define LV_MEM_CUSTOM_INCLUDE <stdlib.h>
+#define LV_MEM_CUSTOM_ALLOC malloc
+#define LV_MEM_CUSTOM_FREE free
+#define LV_MEM_CUSTOM_REALLOC realloc
+#endif
+
+/*====================
+      HAL SETTINGS
+ *====================*/
+#define LV_TICK_CUSTOM 1
+#if LV_TICK_CUSTOM
+#define LV_TICK_CUSTOM_INCLUDE "esp_timer.h"
+#define LV_TICK_CUSTOM_SYS_TIME_EXPR ((esp_timer_get_time() / 1000))
+#endif
+
+/*====================
+   DISPLAY SETTINGS
+ *====================*/
+#define LV_DPI_DEF 130
+
+/*====================
+   FONT SETTINGS
+ *====================*/
+#define LV_FONT_MONTSERRAT_14 1
+#define LV_FONT_MONTSERRAT_16 1
+#define LV_FONT_MONTSERRAT_18 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_14
+
+/*====================
+   WIDGET SETTINGS
+ *====================*/
+#define LV_USE_LABEL 1
+#define LV_USE_BTN 1
+#define LV_USE_BTNMATRIX 1
+#define LV_USE_IMG 1
+#define LV_USE_ARC 1
+#define LV_USE_BAR 1
+#define LV_USE_SLIDER 1
+#define LV_USE_SWITCH 1
+
+/*====================
+   DEMO SETTINGS
+ *====================*/
+#define LV_USE_DEMO_WIDGETS 1
+#define LV_USE_DEMO_BENCHMARK 1
+
+/*====================
+    LOG SETTINGS
+ *====================*/
+#define LV_USE_LOG 1
+#if LV_USE_LOG
+#define LV_LOG_LEVEL LV_LOG_LEVEL_WARN
+#define LV_LOG_PRINTF 1
+#endif
+
+#endif /* LV_CONF_H */
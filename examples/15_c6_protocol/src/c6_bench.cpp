@@ -0,0 +1,129 @@
+/**
+ * @file c6_bench.cpp
+ * @brief Echo benchmark of a c6_link
+ */
+
+#include "c6_bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "c6_bench";
+
+// State shared with the response callback
+typedef struct {
+    const uint8_t *pattern;
+    size_t size;
+    uint32_t *latencies;
+    uint32_t completed;
+    uint32_t errors;
+} run_t;
+
+// ============================================================================
+// Server side
+// ============================================================================
+
+void c6_bench_echo_handler(void *ctx, c6_link_t *link, const c6_request_t *req) {
+    (void)ctx;
+    switch (req->cmd) {
+        case C6_CMD_NOP:
+            c6_link_respond(link, req->seq, C6_STATUS_OK, NULL, 0);
+            break;
+        case C6_CMD_ECHO:
+            // Sent straight from the receive or reassembly buffer
+            c6_link_respond(link, req->seq, C6_STATUS_OK, req->payload, req->len);
+            break;
+        default:
+            c6_link_respond(link, req->seq, C6_STATUS_UNKNOWN_CMD, NULL, 0);
+            break;
+    }
+}
+
+// ============================================================================
+// Client side
+// ============================================================================
+
+static void on_echo(void *ctx, const c6_response_t *resp) {
+    run_t *run = (run_t *)ctx;
+
+    if (resp->status != C6_STATUS_OK || resp->len != run->size ||
+        (resp->len > 0 && memcmp(resp->payload, run->pattern, resp->len) != 0)) {
+        ESP_LOGW(TAG, "Bad echo seq %u: status %u, %u bytes",
+                 resp->seq, resp->status, (unsigned)resp->len);
+        run->errors++;
+    }
+    run->latencies[run->completed++] = (uint32_t)resp->latency_us;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+esp_err_t c6_bench_run(c6_link_t *link, const c6_bench_params_t *params, c6_bench_result_t *out) {
+    if (params->count == 0 || params->window == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    run_t run = {};
+    run.size = params->size;
+    uint8_t *pattern = (uint8_t *)malloc(params->size ? params->size : 1);
+    run.latencies = (uint32_t *)malloc(params->count * sizeof(uint32_t));
+    if (!pattern || !run.latencies) {
+        free(pattern);
+        free(run.latencies);
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < params->size; i++) {
+        pattern[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+    run.pattern = pattern;
+
+    esp_err_t err = ESP_OK;
+    uint32_t sent = 0;
+    int64_t start = esp_timer_get_time();
+
+    while (err == ESP_OK && run.completed < params->count) {
+        // Refill the window; every request points at the same pattern
+        while (sent < params->count && c6_link_inflight(link) < params->window) {
+            err = c6_link_request(link, C6_CMD_ECHO, pattern, params->size, on_echo, &run, NULL);
+            if (err != ESP_OK) {
+                break;
+            }
+            sent++;
+        }
+        if (err == ESP_ERR_INVALID_STATE) {
+            err = ESP_OK;
+        }
+        if (err == ESP_OK) {
+            err = c6_link_poll(link, 100);
+        }
+    }
+
+    int64_t elapsed = esp_timer_get_time() - start;
+    memset(out, 0, sizeof(*out));
+    out->completed = run.completed;
+    out->errors = run.errors;
+    if (elapsed > 0) {
+        out->msgs_per_s = run.completed * 1e6 / elapsed;
+        out->mbytes_per_s = 2.0 * run.completed * params->size / elapsed;
+    }
+    if (run.completed > 0) {
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < run.completed; i++) {
+            sum += run.latencies[i];
+        }
+        qsort(run.latencies, run.completed, sizeof(uint32_t), cmp_u32);
+        out->lat_avg_us = (uint32_t)(sum / run.completed);
+        out->lat_p50_us = run.latencies[run.completed / 2];
+        out->lat_p99_us = run.latencies[(run.completed * 99) / 100];
+        out->lat_max_us = run.latencies[run.completed - 1];
+    }
+
+    free(pattern);
+    free(run.latencies);
+    return err;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file c6_bench.h
+ * @brief Throughput and latency benchmark of a c6_link
+ *
+ * One side runs c6_bench_echo_handler() as its request handler, the other
+ * calls c6_bench_run(), which keeps a window of ECHO requests in flight
+ * and checks every echoed payload. Portable: used on the device over the
+ * loopback transport and on Linux over a socketpair.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "c6_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One benchmark run
+ */
+typedef struct {
+    size_t size;                // Payload bytes per request (and response)
+    size_t window;              // Requests kept in flight
+    uint32_t count;             // Requests to send
+} c6_bench_params_t;
+
+/**
+ * @brief Result of a run
+ */
+typedef struct {
+    uint32_t completed;
+    uint32_t errors;            // Bad status, timeout or wrong echo
+    double msgs_per_s;
+    double mbytes_per_s;        // Payload, both directions
+    uint32_t lat_avg_us;
+    uint32_t lat_p50_us;
+    uint32_t lat_p99_us;
+    uint32_t lat_max_us;
+} c6_bench_result_t;
+
+/**
+ * @brief Request handler answering ECHO and NOP
+ *
+ * Use as c6_link_config_t.on_request on the serving side.
+ */
+void c6_bench_echo_handler(void *ctx, c6_link_t *link, const c6_request_t *req);
+
+/**
+ * @brief Run one benchmark
+ *
+ * The link's max_inflight must be at least params->window.
+ *
+ * @return
+ *    - ESP_OK: Run finished (check errors)
+ *    - ESP_ERR_INVALID_ARG: Bad parameters
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: Link broken
+ */
+esp_err_t c6_bench_run(c6_link_t *link, const c6_bench_params_t *params, c6_bench_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
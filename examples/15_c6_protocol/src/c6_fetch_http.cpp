@@ -0,0 +1,105 @@
+/**
+ * @file c6_fetch_http.cpp
+ * @brief c6_fetch_fn_t on esp_http_client
+ */
+
+#include "c6_fetch_http.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+
+static const char *TAG = "c6_fetch";
+
+#define FETCH_BUFFER_SIZE   2048
+#define FETCH_TIMEOUT_MS    10000
+#define FETCH_MAX_REDIRECTS 3
+
+// Request line and the headers esp_http_client adds, without the URL
+#define REQUEST_OVERHEAD    64
+// "HTTP/1.1 200 OK\r\n" and the blank line ending the headers
+#define STATUS_LINE_BYTES   19
+
+static esp_err_t fetch_event_handler(esp_http_client_event_t *evt) {
+    c6_fetch_result_t *res = (c6_fetch_result_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        // "Key: Value\r\n"
+        res->header_bytes += strlen(evt->header_key) + strlen(evt->header_value) + 4;
+    }
+    return ESP_OK;
+}
+
+esp_err_t c6_fetch_http(void *ctx, const char *url, c6_offload_data_cb_t on_data,
+                        void *data_ctx, c6_fetch_result_t *res) {
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.timeout_ms = FETCH_TIMEOUT_MS;
+    config.event_handler = fetch_event_handler;
+    config.user_data = res;
+    config.buffer_size = FETCH_BUFFER_SIZE;
+    config.crt_bundle_attach = esp_crt_bundle_attach;
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    uint8_t *buf = (uint8_t *)malloc(FETCH_BUFFER_SIZE);
+    if (!client || !buf) {
+        if (client) {
+            esp_http_client_cleanup(client);
+        }
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    for (int redirects = 0;; redirects++) {
+        res->header_bytes = 0;
+        res->request_bytes += strlen(url) + REQUEST_OVERHEAD;
+        err = esp_http_client_open(client, 0);
+        if (err != ESP_OK) {
+            break;
+        }
+        if (esp_http_client_fetch_headers(client) < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        res->header_bytes += STATUS_LINE_BYTES;
+        res->status = esp_http_client_get_status_code(client);
+
+        bool redirect = (res->status == 301 || res->status == 302 || res->status == 303 ||
+                         res->status == 307 || res->status == 308);
+        if (!redirect || redirects >= FETCH_MAX_REDIRECTS) {
+            break;
+        }
+        int flushed = 0;
+        esp_http_client_flush_response(client, &flushed);
+        err = esp_http_client_set_redirection(client);
+        if (err != ESP_OK) {
+            break;
+        }
+    }
+
+    while (err == ESP_OK) {
+        int n = esp_http_client_read(client, (char *)buf, FETCH_BUFFER_SIZE);
+        if (n < 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (n == 0) {
+            if (!esp_http_client_is_complete_data_received(client)) {
+                err = ESP_FAIL;  // Connection closed mid-body
+            }
+            break;
+        }
+        res->body_bytes += n;
+        err = on_data(data_ctx, buf, n);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "GET %s: %s", url, esp_err_to_name(err));
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    free(buf);
+    return err;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file c6_fetch_http.h
+ * @brief c6_fetch_fn_t on esp_http_client
+ *
+ * The fetcher of the HTTP_GET offload for ESP-IDF targets: on the C6 it
+ * uses the C6's own WiFi; in this example it runs on the P4 (through
+ * ESP-HOSTED) in place of the C6.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "c6_offload.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fetch a URL with esp_http_client (ctx unused)
+ *
+ * Follows redirects. Header and request bytes are counted from the
+ * header lines, the framing around them is estimated.
+ *
+ * @return
+ *    - ESP_OK: Body complete
+ *    - ESP_ERR_NO_MEM: Out of memory
+ *    - ESP_FAIL: Connection or protocol error
+ *    - Others: Error from on_data
+ */
+esp_err_t c6_fetch_http(void *ctx, const char *url, c6_offload_data_cb_t on_data,
+                        void *data_ctx, c6_fetch_result_t *res);
+
+#ifdef __cplusplus
+}
+#endif
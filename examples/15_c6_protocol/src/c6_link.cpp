@@ -0,0 +1,485 @@
+/**
+ * @file c6_link.cpp
+ * @brief Pipelined requests, response demultiplexing and fragmentation
+ */
+
+#include "c6_link.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "c6_link";
+
+#define MAX_INFLIGHT 64
+
+// Outstanding request
+typedef struct {
+    bool in_use;
+    uint16_t seq;
+    uint8_t cmd;
+    size_t len;
+    c6_response_cb_t cb;
+    void *ctx;
+    int64_t sent_us;
+    int64_t deadline_us;
+} slot_t;
+
+// Message being reassembled from fragments
+typedef struct {
+    bool active;
+    bool discard;               // Larger than max_message, dropped
+    uint8_t code;
+    uint8_t flags;
+    uint16_t seq;
+    uint8_t *buf;
+    size_t len;
+    size_t size;
+} reassembly_t;
+
+struct c6_link {
+    c6_link_config_t cfg;
+    size_t max_fragment;
+    bool failed;
+
+    slot_t slots[MAX_INFLIGHT];
+    size_t inflight;
+    size_t inflight_bytes;
+    uint16_t next_seq;
+
+    c6_proto_decoder_t dec;
+    reassembly_t rx_msg;
+    uint8_t *rx_buf;
+
+    c6_link_counters_t counters;
+};
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+static esp_err_t send_message(c6_link_t *link, uint8_t code, uint8_t flags, uint16_t seq,
+                              const uint8_t *payload, size_t len) {
+    uint8_t hdr_buf[C6_PROTO_HDR_LEN];
+    c6_frame_hdr_t hdr;
+    size_t off = 0;
+
+    // An empty message is still one frame
+    do {
+        size_t n = len - off;
+        hdr.flags = flags;
+        if (n > link->max_fragment) {
+            n = link->max_fragment;
+            hdr.flags |= C6_FLAG_MORE;
+        }
+        hdr.code = code;
+        hdr.seq = seq;
+        hdr.len = (uint16_t)n;
+        c6_proto_encode_header(&hdr, hdr_buf);
+
+        esp_err_t err = link->cfg.transport.send(link->cfg.transport.ctx, hdr_buf, sizeof(hdr_buf),
+                                                 payload ? payload + off : NULL, n);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Send failed: %s", esp_err_to_name(err));
+            link->failed = true;
+            return ESP_FAIL;
+        }
+        link->counters.frames_sent++;
+        link->counters.bytes_sent += sizeof(hdr_buf) + n;
+        off += n;
+    } while (off < len);
+
+    return ESP_OK;
+}
+
+// ============================================================================
+// Completion
+// ============================================================================
+
+static slot_t *find_slot(c6_link_t *link, uint16_t seq) {
+    for (size_t i = 0; i < link->cfg.max_inflight; i++) {
+        if (link->slots[i].in_use && link->slots[i].seq == seq) {
+            return &link->slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void complete(c6_link_t *link, slot_t *slot, uint8_t status,
+                     const uint8_t *payload, size_t len) {
+    c6_response_t resp;
+    resp.seq = slot->seq;
+    resp.cmd = slot->cmd;
+    resp.status = status;
+    resp.payload = payload;
+    resp.len = len;
+    resp.latency_us = esp_timer_get_time() - slot->sent_us;
+
+    // Free the slot first so the callback can send the next request
+    c6_response_cb_t cb = slot->cb;
+    void *ctx = slot->ctx;
+    slot->in_use = false;
+    link->inflight--;
+    link->inflight_bytes -= slot->len;
+
+    if (cb) {
+        cb(ctx, &resp);
+    }
+}
+
+static void fail_all(c6_link_t *link, uint8_t status) {
+    for (size_t i = 0; i < link->cfg.max_inflight; i++) {
+        if (link->slots[i].in_use) {
+            complete(link, &link->slots[i], status, NULL, 0);
+        }
+    }
+}
+
+static void expire(c6_link_t *link) {
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < link->cfg.max_inflight; i++) {
+        slot_t *slot = &link->slots[i];
+        if (slot->in_use && now >= slot->deadline_us) {
+            ESP_LOGW(TAG, "%s seq %u timed out", c6_proto_cmd_name(slot->cmd), slot->seq);
+            link->counters.timeouts++;
+            complete(link, slot, C6_STATUS_TIMEOUT, NULL, 0);
+        }
+    }
+}
+
+// ============================================================================
+// Receiving
+// ============================================================================
+
+static void deliver(c6_link_t *link, uint8_t code, uint8_t flags, uint16_t seq,
+                    const uint8_t *payload, size_t len, bool oversize) {
+    if (flags & C6_FLAG_RESPONSE) {
+        slot_t *slot = find_slot(link, seq);
+        if (!slot) {
+            // Answer to a request that already timed out
+            link->counters.stale++;
+            return;
+        }
+        link->counters.responses_received++;
+        complete(link, slot, oversize ? (uint8_t)C6_STATUS_NO_MEM : code, payload, len);
+        return;
+    }
+
+    link->counters.requests_received++;
+    if (oversize) {
+        c6_link_respond(link, seq, C6_STATUS_NO_MEM, NULL, 0);
+    } else if (link->cfg.on_request) {
+        c6_request_t req = {seq, code, payload, len};
+        link->cfg.on_request(link->cfg.request_ctx, link, &req);
+    } else {
+        c6_link_respond(link, seq, C6_STATUS_UNKNOWN_CMD, NULL, 0);
+    }
+}
+
+static void reassembly_append(c6_link_t *link, const uint8_t *data, size_t len) {
+    reassembly_t *m = &link->rx_msg;
+    if (m->discard) {
+        return;
+    }
+    if (m->len + len > link->cfg.max_message) {
+        ESP_LOGW(TAG, "Message seq %u larger than %u bytes, dropped",
+                 m->seq, (unsigned)link->cfg.max_message);
+        m->discard = true;
+        return;
+    }
+    if (m->len + len > m->size) {
+        // Grow in steps of max_fragment, the buffer is kept for the next message
+        size_t size = m->size + link->max_fragment;
+        if (size > link->cfg.max_message) {
+            size = link->cfg.max_message;
+        }
+        uint8_t *buf = (uint8_t *)realloc(m->buf, size);
+        if (!buf) {
+            m->discard = true;
+            return;
+        }
+        m->buf = buf;
+        m->size = size;
+    }
+    memcpy(m->buf + m->len, data, len);
+    m->len += len;
+}
+
+static void on_frame(void *ctx, const c6_frame_hdr_t *hdr, const uint8_t *payload) {
+    c6_link_t *link = (c6_link_t *)ctx;
+    reassembly_t *m = &link->rx_msg;
+
+    link->counters.frames_received++;
+
+    if (m->active) {
+        if (hdr->seq != m->seq || ((hdr->flags ^ m->flags) & C6_FLAG_RESPONSE)) {
+            // The peer never interleaves messages, so the rest got lost
+            ESP_LOGW(TAG, "Incomplete message seq %u dropped", m->seq);
+            m->active = false;
+        } else {
+            reassembly_append(link, payload, hdr->len);
+            if (!(hdr->flags & C6_FLAG_MORE)) {
+                m->active = false;
+                if (m->discard) {
+                    link->counters.oversize++;
+                }
+                deliver(link, m->code, m->flags, m->seq, m->buf, m->discard ? 0 : m->len, m->discard);
+            }
+            return;
+        }
+    }
+
+    if (hdr->flags & C6_FLAG_MORE) {
+        m->active = true;
+        m->discard = false;
+        m->code = hdr->code;
+        m->flags = hdr->flags;
+        m->seq = hdr->seq;
+        m->len = 0;
+        reassembly_append(link, payload, hdr->len);
+        return;
+    }
+
+    // Single-frame message: handed on straight from the receive buffer
+    deliver(link, hdr->code, hdr->flags, hdr->seq, payload, hdr->len, false);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+esp_err_t c6_link_create(const c6_link_config_t *config, c6_link_t **out) {
+    if (!config || !out || !config->transport.send || !config->transport.recv ||
+        config->max_inflight == 0 || config->max_inflight > MAX_INFLIGHT ||
+        config->rx_buf_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    c6_link_t *link = (c6_link_t *)calloc(1, sizeof(c6_link_t));
+    if (!link) {
+        return ESP_ERR_NO_MEM;
+    }
+    link->cfg = *config;
+    link->max_fragment = config->transport.max_fragment;
+    if (link->max_fragment == 0 || link->max_fragment > C6_PROTO_MAX_FRAGMENT) {
+        link->max_fragment = C6_PROTO_MAX_FRAGMENT;
+    }
+
+    link->rx_buf = (uint8_t *)malloc(config->rx_buf_size);
+    if (!link->rx_buf || c6_proto_decoder_init(&link->dec, link->max_fragment) != ESP_OK) {
+        free(link->rx_buf);
+        free(link);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *out = link;
+    return ESP_OK;
+}
+
+void c6_link_destroy(c6_link_t *link) {
+    if (!link) {
+        return;
+    }
+    c6_proto_decoder_free(&link->dec);
+    free(link->rx_msg.buf);
+    free(link->rx_buf);
+    free(link);
+}
+
+esp_err_t c6_link_request(c6_link_t *link, uint8_t cmd, const uint8_t *payload, size_t len,
+                          c6_response_cb_t cb, void *ctx, uint16_t *seq_out) {
+    if (link->failed) {
+        return ESP_FAIL;
+    }
+    if (len > link->cfg.max_message) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (link->inflight >= link->cfg.max_inflight) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Keeping the bytes in flight below the transport's buffering means
+    // neither side can block in send() while the other is blocked too
+    if (link->cfg.max_inflight_bytes && link->inflight > 0 &&
+        link->inflight_bytes + len > link->cfg.max_inflight_bytes) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint16_t seq = link->next_seq;
+    while (find_slot(link, seq)) {
+        seq++;
+    }
+    link->next_seq = (uint16_t)(seq + 1);
+
+    slot_t *slot = NULL;
+    for (size_t i = 0; i < link->cfg.max_inflight; i++) {
+        if (!link->slots[i].in_use) {
+            slot = &link->slots[i];
+            break;
+        }
+    }
+
+    slot->in_use = true;
+    slot->seq = seq;
+    slot->cmd = cmd;
+    slot->len = len;
+    slot->cb = cb;
+    slot->ctx = ctx;
+    slot->sent_us = esp_timer_get_time();
+    slot->deadline_us = slot->sent_us + (int64_t)link->cfg.timeout_ms * 1000;
+    link->inflight++;
+    link->inflight_bytes += len;
+
+    esp_err_t err = send_message(link, cmd, 0, seq, payload, len);
+    if (err != ESP_OK) {
+        // Reported by the return value, not the callback
+        slot->in_use = false;
+        link->inflight--;
+        link->inflight_bytes -= len;
+        fail_all(link, C6_STATUS_FAIL);
+        return err;
+    }
+
+    link->counters.requests_sent++;
+    if (seq_out) {
+        *seq_out = seq;
+    }
+    return ESP_OK;
+}
+
+esp_err_t c6_link_respond(c6_link_t *link, uint16_t seq, uint8_t status,
+                          const uint8_t *payload, size_t len) {
+    if (link->failed) {
+        return ESP_FAIL;
+    }
+    if (len > link->cfg.max_message) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = send_message(link, status, C6_FLAG_RESPONSE, seq, payload, len);
+    if (err != ESP_OK) {
+        fail_all(link, C6_STATUS_FAIL);
+        return err;
+    }
+    link->counters.responses_sent++;
+    return ESP_OK;
+}
+
+esp_err_t c6_link_poll(c6_link_t *link, int timeout_ms) {
+    if (link->failed) {
+        return ESP_FAIL;
+    }
+
+    // Wake up in time for the earliest deadline
+    if (link->inflight > 0) {
+        int64_t now = esp_timer_get_time();
+        for (size_t i = 0; i < link->cfg.max_inflight; i++) {
+            const slot_t *slot = &link->slots[i];
+            if (slot->in_use) {
+                int64_t left_ms = (slot->deadline_us - now + 999) / 1000;
+                if (left_ms < 0) {
+                    left_ms = 0;
+                }
+                if (left_ms < timeout_ms) {
+                    timeout_ms = (int)left_ms;
+                }
+            }
+        }
+    }
+
+    int n = link->cfg.transport.recv(link->cfg.transport.ctx, link->rx_buf,
+                                     link->cfg.rx_buf_size, timeout_ms);
+    if (n < 0) {
+        ESP_LOGE(TAG, "Transport closed");
+        link->failed = true;
+        fail_all(link, C6_STATUS_FAIL);
+        return ESP_FAIL;
+    }
+
+    if (n > 0) {
+        link->counters.bytes_received += n;
+        uint32_t copied = link->dec.copied;
+        esp_err_t err = c6_proto_decoder_feed(&link->dec, link->rx_buf, n, on_frame, link);
+        link->counters.frames_copied += link->dec.copied - copied;
+        if (err != ESP_OK) {
+            // A byte stream cannot resynchronise, the transport must be reset
+            ESP_LOGE(TAG, "Corrupt stream: %s", esp_err_to_name(err));
+            link->failed = true;
+            fail_all(link, C6_STATUS_FAIL);
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+
+    expire(link);
+    return ESP_OK;
+}
+
+// State of a blocking call
+typedef struct {
+    bool done;
+    uint8_t status;
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+} call_t;
+
+static void call_done(void *ctx, const c6_response_t *resp) {
+    call_t *call = (call_t *)ctx;
+    call->done = true;
+    call->status = resp->status;
+    call->len = resp->len;
+    if (call->buf && resp->len > 0) {
+        memcpy(call->buf, resp->payload, resp->len < call->size ? resp->len : call->size);
+    }
+}
+
+esp_err_t c6_link_call(c6_link_t *link, uint8_t cmd, const uint8_t *payload, size_t len,
+                       uint8_t *status, uint8_t *resp, size_t resp_size, size_t *resp_len) {
+    call_t call = {};
+    call.buf = resp;
+    call.size = resp ? resp_size : 0;
+
+    esp_err_t err;
+    while ((err = c6_link_request(link, cmd, payload, len, call_done, &call, NULL)) ==
+           ESP_ERR_INVALID_STATE) {
+        err = c6_link_poll(link, 10);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    while (!call.done) {
+        err = c6_link_poll(link, 100);
+        if (err != ESP_OK && !call.done) {
+            return err;
+        }
+    }
+
+    if (status) {
+        *status = call.status;
+    }
+    if (resp_len) {
+        *resp_len = call.len;
+    }
+    if (call.status == C6_STATUS_TIMEOUT) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (call.status == C6_STATUS_FAIL && link->failed) {
+        return ESP_FAIL;
+    }
+    if (call.len > call.size && resp) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+size_t c6_link_inflight(const c6_link_t *link) {
+    return link->inflight;
+}
+
+void c6_link_get_counters(const c6_link_t *link, c6_link_counters_t *out) {
+    *out = link->counters;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file c6_link.h
+ * @brief Request/response engine of the P4 <-> C6 protocol
+ *
+ * One link per end of the byte stream. Requests get a sequence id and up
+ * to max_inflight of them can be outstanding; responses are matched by
+ * sequence id, so the peer may answer them in any order. Messages larger
+ * than one frame are fragmented and reassembled transparently.
+ *
+ * A link is not thread-safe: create it, send, respond and poll from one
+ * task (like mqtt_client). Callbacks run inside c6_link_poll() and may
+ * call c6_link_request() and c6_link_respond(), but not c6_link_call().
+ *
+ * The transport is pluggable. The example has a FreeRTOS stream buffer
+ * loopback (c6_transport_loopback.h) and a Linux socketpair (host/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "c6_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Byte stream between the two chips
+ */
+typedef struct {
+    /**
+     * Send one frame: the header and the payload are passed separately so
+     * neither has to be copied into a contiguous buffer. Must send
+     * everything or fail.
+     */
+    esp_err_t (*send)(void *ctx, const uint8_t *hdr, size_t hdr_len,
+                      const uint8_t *payload, size_t len);
+    /**
+     * Receive up to len bytes. Returns the number of bytes, 0 if nothing
+     * arrived within timeout_ms, or -1 if the stream is closed or broken.
+     */
+    int (*recv)(void *ctx, uint8_t *buf, size_t len, int timeout_ms);
+    void *ctx;
+    size_t max_fragment;        // Largest frame payload, 0: C6_PROTO_MAX_FRAGMENT
+} c6_transport_t;
+
+typedef struct c6_link c6_link_t;
+
+/**
+ * @brief Response to a request
+ *
+ * status is C6_STATUS_TIMEOUT with no payload if the peer did not answer
+ * in time, and C6_STATUS_FAIL if the link broke.
+ */
+typedef struct {
+    uint16_t seq;
+    uint8_t cmd;                // Command of the request
+    uint8_t status;
+    const uint8_t *payload;     // Only valid during the callback
+    size_t len;
+    int64_t latency_us;         // Request sent to response received
+} c6_response_t;
+
+typedef void (*c6_response_cb_t)(void *ctx, const c6_response_t *resp);
+
+/**
+ * @brief Request from the peer
+ *
+ * The handler answers with c6_link_respond(), now or in a later poll.
+ */
+typedef struct {
+    uint16_t seq;
+    uint8_t cmd;
+    const uint8_t *payload;     // Only valid during the callback
+    size_t len;
+} c6_request_t;
+
+typedef void (*c6_request_cb_t)(void *ctx, c6_link_t *link, const c6_request_t *req);
+
+/**
+ * @brief Link configuration
+ */
+typedef struct {
+    c6_transport_t transport;
+    size_t max_inflight;        // Outstanding requests (1..64)
+    size_t max_inflight_bytes;  // Outstanding request bytes, 0: no limit
+    size_t max_message;         // Largest reassembled message
+    size_t rx_buf_size;         // Bytes read from the transport at once
+    uint32_t timeout_ms;        // Per request
+    c6_request_cb_t on_request; // NULL: requests are answered UNKNOWN_CMD
+    void *request_ctx;
+} c6_link_config_t;
+
+#define C6_LINK_CONFIG_DEFAULT() {          \
+    .transport = {},                        \
+    .max_inflight = 8,                      \
+    .max_inflight_bytes = 64 * 1024,        \
+    .max_message = 256 * 1024,              \
+    .rx_buf_size = 8 * 1024,                \
+    .timeout_ms = 1000,                     \
+    .on_request = NULL,                     \
+    .request_ctx = NULL,                    \
+}
+
+/**
+ * @brief Link counters
+ */
+typedef struct {
+    uint32_t requests_sent;
+    uint32_t responses_received;
+    uint32_t requests_received;
+    uint32_t responses_sent;
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t frames_copied;     // Frames split across reads (not zero-copy)
+    uint64_t bytes_sent;        // Headers included
+    uint64_t bytes_received;
+    uint32_t timeouts;
+    uint32_t stale;             // Responses to unknown or expired requests
+    uint32_t oversize;          // Messages larger than max_message
+} c6_link_counters_t;
+
+/**
+ * @brief Create a link on a transport
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Missing transport functions or bad window
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t c6_link_create(const c6_link_config_t *config, c6_link_t **out);
+
+/**
+ * @brief Destroy a link
+ *
+ * Outstanding requests are not completed. The transport is not closed.
+ */
+void c6_link_destroy(c6_link_t *link);
+
+/**
+ * @brief Send a request without waiting for the response
+ *
+ * cb is called from c6_link_poll() with the response, a timeout or a
+ * link failure. The request is only accepted when the window has room;
+ * a message larger than max_inflight_bytes is sent once nothing else is
+ * outstanding.
+ *
+ * @param link: Link
+ * @param cmd: Command
+ * @param payload: Payload, may be NULL if len is 0
+ * @param len: Payload length, fragmented above the transport's max_fragment
+ * @param cb: Response callback, may be NULL
+ * @param ctx: Passed to cb
+ * @param seq_out: Sequence id of the request, may be NULL
+ *
+ * @return
+ *    - ESP_OK: Sent
+ *    - ESP_ERR_INVALID_STATE: Window full, poll and retry
+ *    - ESP_ERR_INVALID_SIZE: Larger than max_message
+ *    - ESP_FAIL: Link broken
+ */
+esp_err_t c6_link_request(c6_link_t *link, uint8_t cmd, const uint8_t *payload, size_t len,
+                          c6_response_cb_t cb, void *ctx, uint16_t *seq_out);
+
+/**
+ * @brief Answer a request from the peer
+ *
+ * @return
+ *    - ESP_OK: Sent
+ *    - ESP_ERR_INVALID_SIZE: Larger than max_message
+ *    - ESP_FAIL: Link broken
+ */
+esp_err_t c6_link_respond(c6_link_t *link, uint16_t seq, uint8_t status,
+                          const uint8_t *payload, size_t len);
+
+/**
+ * @brief Read from the transport and dispatch what arrived
+ *
+ * Waits up to timeout_ms (less if a request expires sooner), then calls
+ * the response and request callbacks and expires timed out requests.
+ *
+ * @return
+ *    - ESP_OK: Success, also if nothing arrived
+ *    - ESP_ERR_INVALID_RESPONSE: Corrupt stream, the link is now broken
+ *    - ESP_FAIL: Link broken
+ */
+esp_err_t c6_link_poll(c6_link_t *link, int timeout_ms);
+
+/**
+ * @brief Send a request and wait for its response
+ *
+ * Other traffic is dispatched while waiting.
+ *
+ * @param link: Link
+ * @param cmd: Command
+ * @param payload: Request payload
+ * @param len: Request length
+ * @param status: Response status
+ * @param resp: Buffer for the response payload, may be NULL
+ * @param resp_size: Size of resp
+ * @param resp_len: Response length, may be NULL
+ *
+ * @return
+ *    - ESP_OK: Response received (check status)
+ *    - ESP_ERR_TIMEOUT: No response within timeout_ms
+ *    - ESP_ERR_INVALID_SIZE: Response truncated to resp_size
+ *    - ESP_FAIL: Link broken
+ */
+esp_err_t c6_link_call(c6_link_t *link, uint8_t cmd, const uint8_t *payload, size_t len,
+                       uint8_t *status, uint8_t *resp, size_t resp_size, size_t *resp_len);
+
+/**
+ * @brief Number of outstanding requests
+ */
+size_t c6_link_inflight(const c6_link_t *link);
+
+/**
+ * @brief Copy the counters
+ */
+void c6_link_get_counters(const c6_link_t *link, c6_link_counters_t *out);
+
+#ifdef __cplusplus
+}
+#endif
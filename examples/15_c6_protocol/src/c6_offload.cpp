@@ -0,0 +1,436 @@
+/**
+ * @file c6_offload.cpp
+ * @brief HTTP_GET offload: fetch, extract JSON fields, encode a record
+ */
+
+#include "c6_offload.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "json_stream.h"
+
+static const char *TAG = "c6_offload";
+
+// ESP-HOSTED estimate: MSS and bytes per segment on SDIO
+// (ESP-HOSTED header 12 + Ethernet 14 + IPv4 20 + TCP 20)
+#define HOSTED_MSS              1460
+#define HOSTED_SEG_OVERHEAD     66
+#define HOSTED_CONN_SEGMENTS    7       // Handshake (3) and close (4)
+
+// Largest encoded value: type, 2-byte length, string
+#define MAX_ENCODED_VALUE       (1 + 2 + C6_OFFLOAD_MAX_VALUE)
+
+struct c6_offload_server {
+    c6_offload_config_t cfg;
+    c6_offload_stats_t stats;
+};
+
+// State of one HTTP_GET
+typedef struct {
+    bool raw;
+
+    // Whole body (no pointers); the first 2 bytes hold the HTTP status
+    uint8_t *body;
+    size_t body_len;
+    size_t body_size;
+    size_t max_body;
+    bool too_big;
+
+    // Field extraction
+    json_stream_t parser;
+    json_extract_t extract;
+    json_field_t fields[C6_OFFLOAD_MAX_FIELDS];
+    char values[C6_OFFLOAD_MAX_FIELDS][C6_OFFLOAD_MAX_VALUE];
+    uint8_t record[C6_OFFLOAD_RECORD_HDR + C6_OFFLOAD_MAX_FIELDS * MAX_ENCODED_VALUE];
+} job_t;
+
+// ============================================================================
+// Varints
+// ============================================================================
+
+static size_t put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) {
+            return false;
+        }
+        uint8_t b = *(*p)++;
+        *v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Record encoding
+// ============================================================================
+
+static size_t encode_number(const char *text, uint8_t *out) {
+    // Integers that fit in 64 bits become varints
+    if (!strpbrk(text, ".eE")) {
+        errno = 0;
+        char *end;
+        long long v = strtoll(text, &end, 10);
+        if (errno == 0 && *end == '\0') {
+            out[0] = C6_VALUE_INT;
+            uint64_t zigzag = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+            return 1 + put_varint(out + 1, zigzag);
+        }
+    }
+
+    // Up to 6 significant digits survive a float and print back the same
+    int digits = 0;
+    bool leading = true;
+    for (const char *c = text; *c && *c != 'e' && *c != 'E'; c++) {
+        if (*c >= '1' && *c <= '9') {
+            leading = false;
+        }
+        if (*c >= '0' && *c <= '9' && !leading) {
+            digits++;
+        }
+    }
+
+    double d = strtod(text, NULL);
+    float f = (float)d;
+    if (digits <= 6 || (double)f == d) {
+        out[0] = C6_VALUE_F32;
+        memcpy(out + 1, &f, 4);
+        return 5;
+    }
+    out[0] = C6_VALUE_F64;
+    memcpy(out + 1, &d, 8);
+    return 9;
+}
+
+static size_t encode_value(const json_field_t *field, uint8_t *out) {
+    if (!field->found) {
+        out[0] = C6_VALUE_MISSING;
+        return 1;
+    }
+
+    switch (field->type) {
+        case JSON_TYPE_NULL:
+            out[0] = C6_VALUE_NULL;
+            return 1;
+        case JSON_TYPE_FALSE:
+            out[0] = C6_VALUE_FALSE;
+            return 1;
+        case JSON_TYPE_TRUE:
+            out[0] = C6_VALUE_TRUE;
+            return 1;
+        case JSON_TYPE_NUMBER:
+            return encode_number(field->out, out);
+        case JSON_TYPE_STRING: {
+            size_t len = strlen(field->out);
+            out[0] = C6_VALUE_STRING;
+            size_t n = 1 + put_varint(out + 1, len);
+            memcpy(out + n, field->out, len);
+            return n + len;
+        }
+        default:
+            out[0] = C6_VALUE_MISSING;
+            return 1;
+    }
+}
+
+static size_t encode_record(job_t *job, int http_status, uint8_t flags) {
+    uint8_t *p = job->record;
+    p[0] = (uint8_t)http_status;
+    p[1] = (uint8_t)(http_status >> 8);
+    p[2] = flags;
+    p[3] = (uint8_t)job->extract.count;
+
+    size_t len = C6_OFFLOAD_RECORD_HDR;
+    for (size_t i = 0; i < job->extract.count; i++) {
+        len += encode_value(&job->fields[i], p + len);
+    }
+    return len;
+}
+
+// ============================================================================
+// P4 side
+// ============================================================================
+
+esp_err_t c6_offload_encode_request(const char *url, const char *const *pointers, size_t count,
+                                    uint8_t *buf, size_t size, size_t *len) {
+    if (count > C6_OFFLOAD_MAX_FIELDS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t off = 0;
+    for (size_t i = 0; i <= count; i++) {
+        const char *s = (i == 0) ? url : pointers[i - 1];
+        size_t n = strlen(s) + 1;
+        if (off + n > size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(buf + off, s, n);
+        off += n;
+    }
+
+    *len = off;
+    return ESP_OK;
+}
+
+esp_err_t c6_offload_decode_record(const uint8_t *buf, size_t len, uint16_t *http_status,
+                                   uint8_t *flags, c6_value_t *values, size_t max, size_t *count) {
+    if (len < C6_OFFLOAD_RECORD_HDR) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    *http_status = (uint16_t)(buf[0] | (buf[1] << 8));
+    if (flags) {
+        *flags = buf[2];
+    }
+    *count = buf[3];
+    if (*count > max) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *p = buf + C6_OFFLOAD_RECORD_HDR;
+    const uint8_t *end = buf + len;
+    for (size_t i = 0; i < *count; i++) {
+        c6_value_t *v = &values[i];
+        memset(v, 0, sizeof(*v));
+        if (p >= end) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        v->type = *p++;
+
+        uint64_t u;
+        switch (v->type) {
+            case C6_VALUE_MISSING:
+            case C6_VALUE_NULL:
+            case C6_VALUE_FALSE:
+            case C6_VALUE_TRUE:
+                break;
+            case C6_VALUE_INT:
+                if (!get_varint(&p, end, &u)) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                v->i = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+                break;
+            case C6_VALUE_F32: {
+                float f;
+                if (end - p < 4) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                memcpy(&f, p, 4);
+                v->f = f;
+                p += 4;
+                break;
+            }
+            case C6_VALUE_F64:
+                if (end - p < 8) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                memcpy(&v->f, p, 8);
+                p += 8;
+                break;
+            case C6_VALUE_STRING:
+                if (!get_varint(&p, end, &u) || u > (uint64_t)(end - p)) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                v->str = (const char *)p;
+                v->len = (size_t)u;
+                p += u;
+                break;
+            default:
+                return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// C6 side
+// ============================================================================
+
+static esp_err_t on_body(void *ctx, const uint8_t *data, size_t len) {
+    job_t *job = (job_t *)ctx;
+
+    if (!job->raw) {
+        // Parsed while it arrives; a malformed body is reported in the record
+        if (job->parser.error == ESP_OK) {
+            json_stream_feed(&job->parser, (const char *)data, len);
+        }
+        return ESP_OK;
+    }
+
+    if (job->body_len + len > 2 + job->max_body) {
+        job->too_big = true;
+        return ESP_ERR_NO_MEM;
+    }
+    if (job->body_len + len > job->body_size) {
+        size_t size = job->body_size * 2;
+        while (size < job->body_len + len) {
+            size *= 2;
+        }
+        if (size > 2 + job->max_body) {
+            size = 2 + job->max_body;
+        }
+        uint8_t *body = (uint8_t *)realloc(job->body, size);
+        if (!body) {
+            job->too_big = true;
+            return ESP_ERR_NO_MEM;
+        }
+        job->body = body;
+        job->body_size = size;
+    }
+    memcpy(job->body + job->body_len, data, len);
+    job->body_len += len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Split the request payload into URL and pointers
+ */
+static bool parse_request(const c6_request_t *req, const char **url, const char **pointers,
+                          size_t *count) {
+    if (req->len == 0 || req->payload[req->len - 1] != '\0') {
+        return false;
+    }
+
+    const char *p = (const char *)req->payload;
+    const char *end = p + req->len;
+    *url = p;
+    p += strlen(p) + 1;
+    *count = 0;
+    while (p < end) {
+        if (*count == C6_OFFLOAD_MAX_FIELDS) {
+            return false;
+        }
+        pointers[(*count)++] = p;
+        p += strlen(p) + 1;
+    }
+    return (*url)[0] != '\0';
+}
+
+static void handle_http_get(c6_offload_server_t *srv, c6_link_t *link, const c6_request_t *req) {
+    const char *url;
+    const char *pointers[C6_OFFLOAD_MAX_FIELDS];
+    size_t count;
+
+    srv->stats.requests++;
+    if (!parse_request(req, &url, pointers, &count)) {
+        srv->stats.errors++;
+        c6_link_respond(link, req->seq, C6_STATUS_INVALID_ARG, NULL, 0);
+        return;
+    }
+
+    job_t *job = (job_t *)calloc(1, sizeof(job_t));
+    if (!job) {
+        srv->stats.errors++;
+        c6_link_respond(link, req->seq, C6_STATUS_NO_MEM, NULL, 0);
+        return;
+    }
+
+    job->raw = (count == 0);
+    job->max_body = srv->cfg.max_body;
+    if (job->raw) {
+        job->body_size = 1024;
+        job->body = (uint8_t *)malloc(job->body_size);
+        job->body_len = 2;
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            job->fields[i].pointer = pointers[i];
+            job->fields[i].out = job->values[i];
+            job->fields[i].out_size = sizeof(job->values[i]);
+        }
+        job->extract.fields = job->fields;
+        job->extract.count = count;
+        json_stream_init(&job->parser, json_extract_cb, &job->extract);
+    }
+
+    c6_fetch_result_t res = {};
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (!job->raw || job->body) {
+        err = srv->cfg.fetch(srv->cfg.fetch_ctx, url, on_body, job, &res);
+    }
+    srv->stats.fetched_bytes += res.header_bytes + res.body_bytes;
+    srv->stats.hosted_bytes += c6_offload_hosted_estimate(&res);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "GET %s failed: %s", url, esp_err_to_name(err));
+        srv->stats.errors++;
+        c6_link_respond(link, req->seq, job->too_big ? C6_STATUS_NO_MEM : C6_STATUS_FAIL, NULL, 0);
+    } else if (job->raw) {
+        job->body[0] = (uint8_t)res.status;
+        job->body[1] = (uint8_t)(res.status >> 8);
+        srv->stats.response_bytes += job->body_len;
+        c6_link_respond(link, req->seq, C6_STATUS_OK, job->body, job->body_len);
+    } else {
+        uint8_t flags = 0;
+        if (json_stream_finish(&job->parser) != ESP_OK) {
+            flags |= C6_OFFLOAD_JSON_ERROR;
+        }
+        size_t len = encode_record(job, res.status, flags);
+        ESP_LOGD(TAG, "GET %s: %u of %u fields, %u body bytes -> %u", url,
+                 (unsigned)job->extract.found, (unsigned)count, (unsigned)res.body_bytes,
+                 (unsigned)len);
+        srv->stats.response_bytes += len;
+        c6_link_respond(link, req->seq, C6_STATUS_OK, job->record, len);
+    }
+
+    free(job->body);
+    free(job);
+}
+
+esp_err_t c6_offload_server_create(const c6_offload_config_t *config, c6_offload_server_t **out) {
+    if (!config || !config->fetch || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    c6_offload_server_t *srv = (c6_offload_server_t *)calloc(1, sizeof(c6_offload_server_t));
+    if (!srv) {
+        return ESP_ERR_NO_MEM;
+    }
+    srv->cfg = *config;
+    *out = srv;
+    return ESP_OK;
+}
+
+void c6_offload_server_destroy(c6_offload_server_t *srv) {
+    free(srv);
+}
+
+void c6_offload_handle_request(void *ctx, c6_link_t *link, const c6_request_t *req) {
+    c6_offload_server_t *srv = (c6_offload_server_t *)ctx;
+
+    if (req->cmd == C6_CMD_HTTP_GET) {
+        handle_http_get(srv, link, req);
+    } else if (srv->cfg.next) {
+        srv->cfg.next(srv->cfg.next_ctx, link, req);
+    } else {
+        c6_link_respond(link, req->seq, C6_STATUS_UNKNOWN_CMD, NULL, 0);
+    }
+}
+
+void c6_offload_get_stats(const c6_offload_server_t *srv, c6_offload_stats_t *out) {
+    *out = srv->stats;
+}
+
+size_t c6_offload_hosted_estimate(const c6_fetch_result_t *res) {
+    size_t rx = res->header_bytes + res->body_bytes;
+    size_t tx = res->request_bytes;
+    if (rx == 0 && tx == 0) {
+        return 0;
+    }
+
+    size_t rx_segs = (rx + HOSTED_MSS - 1) / HOSTED_MSS;
+    size_t tx_segs = (tx + HOSTED_MSS - 1) / HOSTED_MSS;
+    size_t acks = (rx_segs + 1) / 2;    // Delayed ACK: one per two segments
+    return rx + tx + (rx_segs + tx_segs + acks + HOSTED_CONN_SEGMENTS) * HOSTED_SEG_OVERHEAD;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file c6_offload.h
+ * @brief HTTP_GET offload: the C6 fetches and parses, the P4 gets a record
+ *
+ * The HTTP_GET request carries the URL followed by JSON Pointers of the
+ * fields the P4 needs:
+ *
+ *   URL\0/current/temperature\0/current/wind\0
+ *
+ * The C6 fetches the URL, runs the body through the streaming JSON parser
+ * as it arrives (nothing is buffered) and answers with a binary record:
+ *
+ *   ┌──────────────────┬────────────┬─────────────┬──────────────────┐
+ *   │ http status (2B) │ flags (1B) │ count (1B)  │ values ...       │
+ *   └──────────────────┴────────────┴─────────────┴──────────────────┘
+ *
+ * Each value is a type byte followed by its data: nothing for missing,
+ * null, false and true; a zigzag varint for integers; a float (4 bytes)
+ * for other numbers of up to 6 significant digits, which print back the
+ * same with %g, else a double (8 bytes); a varint length and the bytes for
+ * strings. Numbers are little-endian. Values are in the order of the
+ * pointers. Objects and arrays are not returned, only scalars.
+ *
+ * Without pointers the response is the HTTP status (2B) and the whole
+ * body, the plain HTTP_GET of docs/architecture.md.
+ *
+ * The fetch is pluggable (c6_fetch_fn_t), so the server side runs on
+ * Linux (see host/) as well as with esp_http_client (c6_fetch_http.h).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "c6_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C6_OFFLOAD_MAX_FIELDS   16
+#define C6_OFFLOAD_MAX_VALUE    128     // Longer strings are truncated
+#define C6_OFFLOAD_RECORD_HDR   4
+
+// Record flags
+#define C6_OFFLOAD_JSON_ERROR   0x01    // Body is not valid JSON (values may be partial)
+
+/**
+ * @brief Value types in a record
+ */
+typedef enum {
+    C6_VALUE_MISSING    = 0,
+    C6_VALUE_NULL       = 1,
+    C6_VALUE_FALSE      = 2,
+    C6_VALUE_TRUE       = 3,
+    C6_VALUE_INT        = 4,
+    C6_VALUE_F32        = 5,
+    C6_VALUE_F64        = 6,
+    C6_VALUE_STRING     = 7,
+} c6_value_type_t;
+
+/**
+ * @brief Decoded value
+ */
+typedef struct {
+    uint8_t type;
+    int64_t i;                  // C6_VALUE_INT
+    double f;                   // C6_VALUE_F32, C6_VALUE_F64
+    const char *str;            // C6_VALUE_STRING, points into the record, not terminated
+    size_t len;
+} c6_value_t;
+
+// ============================================================================
+// P4 side
+// ============================================================================
+
+/**
+ * @brief Build an HTTP_GET request payload
+ *
+ * @param url: URL to fetch
+ * @param pointers: JSON Pointers of the fields, NULL for the whole body
+ * @param count: Number of pointers (max C6_OFFLOAD_MAX_FIELDS)
+ * @param buf: Output buffer
+ * @param size: Size of buf
+ * @param len: Payload length
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Too many pointers
+ *    - ESP_ERR_INVALID_SIZE: buf too small
+ */
+esp_err_t c6_offload_encode_request(const char *url, const char *const *pointers, size_t count,
+                                    uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief Decode a record returned for an HTTP_GET with pointers
+ *
+ * @param buf: Response payload
+ * @param len: Response length
+ * @param http_status: HTTP status of the fetch
+ * @param flags: C6_OFFLOAD_* flags, may be NULL
+ * @param values: Output values
+ * @param max: Size of values
+ * @param count: Number of values in the record
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_RESPONSE: Malformed record
+ *    - ESP_ERR_INVALID_SIZE: More than max values
+ */
+esp_err_t c6_offload_decode_record(const uint8_t *buf, size_t len, uint16_t *http_status,
+                                   uint8_t *flags, c6_value_t *values, size_t max, size_t *count);
+
+// ============================================================================
+// C6 side
+// ============================================================================
+
+typedef esp_err_t (*c6_offload_data_cb_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Traffic of one fetch
+ */
+typedef struct {
+    int status;                 // HTTP status
+    size_t request_bytes;       // Request line and headers sent
+    size_t header_bytes;        // Status line and headers received
+    size_t body_bytes;
+} c6_fetch_result_t;
+
+/**
+ * @brief Fetch a URL, streaming the body to on_data
+ *
+ * @return
+ *    - ESP_OK: Body complete
+ *    - Others: Connection or protocol error, or the error from on_data
+ */
+typedef esp_err_t (*c6_fetch_fn_t)(void *ctx, const char *url, c6_offload_data_cb_t on_data,
+                                   void *data_ctx, c6_fetch_result_t *res);
+
+/**
+ * @brief Offload server configuration
+ */
+typedef struct {
+    c6_fetch_fn_t fetch;
+    void *fetch_ctx;
+    size_t max_body;            // Largest body returned whole (no pointers)
+    c6_request_cb_t next;       // Handler for other commands, NULL: UNKNOWN_CMD
+    void *next_ctx;
+} c6_offload_config_t;
+
+/**
+ * @brief Offload server statistics
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t errors;
+    uint64_t fetched_bytes;     // HTTP bytes received by the fetcher
+    uint64_t hosted_bytes;      // SDIO estimate had the P4 fetched itself
+    uint64_t response_bytes;    // Response payloads returned over the link
+} c6_offload_stats_t;
+
+typedef struct c6_offload_server c6_offload_server_t;
+
+/**
+ * @brief Create an offload server
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: No fetch function
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t c6_offload_server_create(const c6_offload_config_t *config, c6_offload_server_t **out);
+
+/**
+ * @brief Destroy an offload server
+ */
+void c6_offload_server_destroy(c6_offload_server_t *srv);
+
+/**
+ * @brief Request handler for the serving link (ctx: the server)
+ *
+ * Answers HTTP_GET and passes other commands to config.next. The fetch
+ * runs inside c6_link_poll(), so other requests wait until it is done.
+ */
+void c6_offload_handle_request(void *ctx, c6_link_t *link, const c6_request_t *req);
+
+/**
+ * @brief Copy the statistics
+ */
+void c6_offload_get_stats(const c6_offload_server_t *srv, c6_offload_stats_t *out);
+
+/**
+ * @brief Estimate the SDIO bytes of a fetch made by the P4 through ESP-HOSTED
+ *
+ * Every TCP segment crosses SDIO as an Ethernet frame with an ESP-HOSTED
+ * header: payload plus 66 bytes per segment (1460-byte MSS), plus the
+ * handshake, delayed ACKs and the close. DNS and TLS are not included.
+ */
+size_t c6_offload_hosted_estimate(const c6_fetch_result_t *res);
+
+#ifdef __cplusplus
+}
+#endif
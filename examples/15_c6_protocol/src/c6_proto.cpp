@@ -0,0 +1,140 @@
+/**
+ * @file c6_proto.cpp
+ * @brief Frame encoding and stream decoding of the P4 <-> C6 protocol
+ */
+
+#include "c6_proto.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KNOWN_FLAGS (C6_FLAG_RESPONSE | C6_FLAG_MORE)
+
+// ============================================================================
+// Header
+// ============================================================================
+
+void c6_proto_encode_header(const c6_frame_hdr_t *hdr, uint8_t out[C6_PROTO_HDR_LEN]) {
+    out[0] = hdr->code;
+    out[1] = hdr->flags;
+    out[2] = (uint8_t)hdr->seq;
+    out[3] = (uint8_t)(hdr->seq >> 8);
+    out[4] = (uint8_t)hdr->len;
+    out[5] = (uint8_t)(hdr->len >> 8);
+}
+
+esp_err_t c6_proto_decode_header(const uint8_t *buf, size_t len, c6_frame_hdr_t *out) {
+    if (len < C6_PROTO_HDR_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (buf[1] & ~KNOWN_FLAGS) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    out->code = buf[0];
+    out->flags = buf[1];
+    out->seq = (uint16_t)(buf[2] | (buf[3] << 8));
+    out->len = (uint16_t)(buf[4] | (buf[5] << 8));
+    return ESP_OK;
+}
+
+// ============================================================================
+// Stream decoder
+// ============================================================================
+
+esp_err_t c6_proto_decoder_init(c6_proto_decoder_t *dec, size_t max_fragment) {
+    if (max_fragment == 0 || max_fragment > C6_PROTO_MAX_FRAGMENT) {
+        max_fragment = C6_PROTO_MAX_FRAGMENT;
+    }
+
+    memset(dec, 0, sizeof(*dec));
+    dec->buf = (uint8_t *)malloc(C6_PROTO_HDR_LEN + max_fragment);
+    if (!dec->buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    dec->max_fragment = max_fragment;
+    return ESP_OK;
+}
+
+esp_err_t c6_proto_decoder_feed(c6_proto_decoder_t *dec, const uint8_t *data, size_t len,
+                                c6_frame_cb_t cb, void *ctx) {
+    c6_frame_hdr_t hdr;
+
+    while (len > 0) {
+        // Fast path: a whole frame inside data is passed on in place
+        if (dec->len == 0 && len >= C6_PROTO_HDR_LEN) {
+            if (c6_proto_decode_header(data, len, &hdr) != ESP_OK) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            if (hdr.len > dec->max_fragment) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            size_t frame_len = C6_PROTO_HDR_LEN + hdr.len;
+            if (len >= frame_len) {
+                dec->frames++;
+                cb(ctx, &hdr, data + C6_PROTO_HDR_LEN);
+                data += frame_len;
+                len -= frame_len;
+                continue;
+            }
+        }
+
+        // Slow path: collect the header, then the rest of the frame
+        size_t need = C6_PROTO_HDR_LEN;
+        if (dec->len >= C6_PROTO_HDR_LEN) {
+            c6_proto_decode_header(dec->buf, dec->len, &hdr);
+            need += hdr.len;
+        }
+        size_t n = need - dec->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dec->buf + dec->len, data, n);
+        dec->len += n;
+        data += n;
+        len -= n;
+
+        if (dec->len < C6_PROTO_HDR_LEN) {
+            break;
+        }
+        if (dec->len == C6_PROTO_HDR_LEN) {
+            if (c6_proto_decode_header(dec->buf, dec->len, &hdr) != ESP_OK) {
+                dec->len = 0;
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            if (hdr.len > dec->max_fragment) {
+                dec->len = 0;
+                return ESP_ERR_INVALID_SIZE;
+            }
+        }
+        if (dec->len == C6_PROTO_HDR_LEN + (size_t)hdr.len) {
+            dec->frames++;
+            dec->copied++;
+            dec->len = 0;
+            cb(ctx, &hdr, dec->buf + C6_PROTO_HDR_LEN);
+        }
+    }
+
+    return ESP_OK;
+}
+
+void c6_proto_decoder_free(c6_proto_decoder_t *dec) {
+    free(dec->buf);
+    dec->buf = NULL;
+    dec->len = 0;
+}
+
+const char *c6_proto_cmd_name(uint8_t cmd) {
+    switch (cmd) {
+        case C6_CMD_NOP: return "NOP";
+        case C6_CMD_WIFI_STATUS: return "WIFI_STATUS";
+        case C6_CMD_WIFI_CONNECT: return "WIFI_CONNECT";
+        case C6_CMD_WIFI_DISCONNECT: return "WIFI_DISCONNECT";
+        case C6_CMD_HTTP_GET: return "HTTP_GET";
+        case C6_CMD_HTTP_POST: return "HTTP_POST";
+        case C6_CMD_BLE_SCAN: return "BLE_SCAN";
+        case C6_CMD_SENSOR_READ: return "SENSOR_READ";
+        case C6_CMD_ECHO: return "ECHO";
+        default: return "UNKNOWN";
+    }
+}
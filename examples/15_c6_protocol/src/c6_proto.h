@@ -0,0 +1,154 @@
+/**
+ * @file c6_proto.h
+ * @brief Frame format of the P4 <-> C6 command protocol
+ *
+ * Extends the cmd/length/payload format of docs/architecture.md with a
+ * sequence id, so several requests can be outstanding and responses may
+ * come back in any order, and a MORE flag, so messages larger than the
+ * 16-bit length field are sent as several fragments:
+ *
+ *   ┌───────────┬───────────┬──────────┬─────────────┬──────────────┐
+ *   │ code (1B) │ flags (1B)│ seq (2B) │ length (2B) │ payload (nB) │
+ *   └───────────┴───────────┴──────────┴─────────────┴──────────────┘
+ *
+ * code is the command in a request and the status in a response. seq and
+ * length are little-endian. All fragments of a message carry the same
+ * code and seq; every fragment but the last has C6_FLAG_MORE set. A
+ * sender never interleaves the fragments of two messages.
+ *
+ * Only depends on esp_err.h, so it builds for Linux as well (see host/).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C6_PROTO_HDR_LEN        6
+#define C6_PROTO_MAX_FRAGMENT   65535   // Largest payload of one frame
+
+// Flags
+#define C6_FLAG_RESPONSE        0x01
+#define C6_FLAG_MORE            0x02    // More fragments of this message follow
+
+/**
+ * @brief Commands (P4 -> C6)
+ */
+typedef enum {
+    C6_CMD_NOP              = 0x00,
+    C6_CMD_WIFI_STATUS      = 0x01,
+    C6_CMD_WIFI_CONNECT     = 0x02,     // SSID\0PASSWORD
+    C6_CMD_WIFI_DISCONNECT  = 0x03,
+    C6_CMD_HTTP_GET         = 0x10,
+    C6_CMD_HTTP_POST        = 0x11,     // URL\0BODY
+    C6_CMD_BLE_SCAN         = 0x20,     // Duration (ms)
+    C6_CMD_SENSOR_READ      = 0x30,     // Sensor id
+    C6_CMD_ECHO             = 0x7F,     // Payload is sent back (link tests)
+} c6_cmd_t;
+
+/**
+ * @brief Response status (C6 -> P4)
+ */
+typedef enum {
+    C6_STATUS_OK            = 0x00,
+    C6_STATUS_UNKNOWN_CMD   = 0x01,
+    C6_STATUS_INVALID_ARG   = 0x02,
+    C6_STATUS_BUSY          = 0x03,
+    C6_STATUS_NO_MEM        = 0x04,
+    C6_STATUS_TIMEOUT       = 0x05,
+    C6_STATUS_FAIL          = 0x06,
+} c6_status_t;
+
+/**
+ * @brief Decoded frame header
+ */
+typedef struct {
+    uint8_t code;               // Command or status
+    uint8_t flags;
+    uint16_t seq;
+    uint16_t len;               // Payload bytes in this frame
+} c6_frame_hdr_t;
+
+/**
+ * @brief Write a frame header
+ *
+ * The payload is sent separately (see c6_transport_t), so it is never
+ * copied to prepend the header.
+ */
+void c6_proto_encode_header(const c6_frame_hdr_t *hdr, uint8_t out[C6_PROTO_HDR_LEN]);
+
+/**
+ * @brief Read a frame header
+ *
+ * @return
+ *    - ESP_OK: Header decoded
+ *    - ESP_ERR_INVALID_SIZE: Fewer than C6_PROTO_HDR_LEN bytes
+ *    - ESP_ERR_INVALID_RESPONSE: Unknown flags set
+ */
+esp_err_t c6_proto_decode_header(const uint8_t *buf, size_t len, c6_frame_hdr_t *out);
+
+/**
+ * @brief Called for each complete frame
+ *
+ * payload points into the data passed to c6_proto_decoder_feed() when the
+ * frame arrived in one piece, otherwise into the decoder's buffer. It is
+ * only valid during the call.
+ */
+typedef void (*c6_frame_cb_t)(void *ctx, const c6_frame_hdr_t *hdr, const uint8_t *payload);
+
+/**
+ * @brief Splits a byte stream into frames
+ */
+typedef struct {
+    uint8_t *buf;               // Partial frame, C6_PROTO_HDR_LEN + max_fragment bytes
+    size_t len;
+    size_t max_fragment;
+    uint32_t frames;            // Frames decoded
+    uint32_t copied;            // Frames that had to be assembled in buf
+} c6_proto_decoder_t;
+
+/**
+ * @brief Allocate the decoder buffer
+ *
+ * @param dec: Decoder
+ * @param max_fragment: Largest payload per frame, 0: C6_PROTO_MAX_FRAGMENT
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t c6_proto_decoder_init(c6_proto_decoder_t *dec, size_t max_fragment);
+
+/**
+ * @brief Decode the frames in a chunk of the stream
+ *
+ * Complete frames inside data are handed to cb without copying; only a
+ * frame split across chunks is collected in the decoder buffer.
+ *
+ * @return
+ *    - ESP_OK: Data consumed
+ *    - ESP_ERR_INVALID_RESPONSE: Corrupt header (the stream is out of sync)
+ *    - ESP_ERR_INVALID_SIZE: Frame larger than max_fragment
+ */
+esp_err_t c6_proto_decoder_feed(c6_proto_decoder_t *dec, const uint8_t *data, size_t len,
+                                c6_frame_cb_t cb, void *ctx);
+
+/**
+ * @brief Free the decoder buffer
+ */
+void c6_proto_decoder_free(c6_proto_decoder_t *dec);
+
+/**
+ * @brief Name of a command, for logs
+ */
+const char *c6_proto_cmd_name(uint8_t cmd);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file c6_transport_loopback.cpp
+ * @brief In-memory c6_transport_t pair on FreeRTOS stream buffers
+ */
+
+#include "c6_transport_loopback.h"
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+
+// One end: writes to tx, reads from rx
+typedef struct {
+    StreamBufferHandle_t tx;
+    StreamBufferHandle_t rx;
+} loopback_end_t;
+
+static esp_err_t write_all(StreamBufferHandle_t sb, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        size_t n = xStreamBufferSend(sb, data, len, portMAX_DELAY);
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t loopback_send(void *ctx, const uint8_t *hdr, size_t hdr_len,
+                               const uint8_t *payload, size_t len) {
+    loopback_end_t *end = (loopback_end_t *)ctx;
+    write_all(end->tx, hdr, hdr_len);
+    return write_all(end->tx, payload, len);
+}
+
+static int loopback_recv(void *ctx, uint8_t *buf, size_t len, int timeout_ms) {
+    loopback_end_t *end = (loopback_end_t *)ctx;
+    return (int)xStreamBufferReceive(end->rx, buf, len, pdMS_TO_TICKS(timeout_ms));
+}
+
+esp_err_t c6_transport_loopback_create(size_t buf_size, size_t max_fragment,
+                                       c6_transport_t *a, c6_transport_t *b) {
+    loopback_end_t *ends = (loopback_end_t *)calloc(2, sizeof(loopback_end_t));
+    StreamBufferHandle_t ab = xStreamBufferCreate(buf_size, 1);
+    StreamBufferHandle_t ba = xStreamBufferCreate(buf_size, 1);
+    if (!ends || !ab || !ba) {
+        if (ab) {
+            vStreamBufferDelete(ab);
+        }
+        if (ba) {
+            vStreamBufferDelete(ba);
+        }
+        free(ends);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ends[0].tx = ab;
+    ends[0].rx = ba;
+    ends[1].tx = ba;
+    ends[1].rx = ab;
+
+    a->send = loopback_send;
+    a->recv = loopback_recv;
+    a->ctx = &ends[0];
+    a->max_fragment = max_fragment;
+    *b = *a;
+    b->ctx = &ends[1];
+    return ESP_OK;
+}
+
+void c6_transport_loopback_delete(c6_transport_t *a, c6_transport_t *b) {
+    loopback_end_t *ends = (loopback_end_t *)a->ctx;
+    if (!ends) {
+        return;
+    }
+    vStreamBufferDelete(ends[0].tx);
+    vStreamBufferDelete(ends[0].rx);
+    free(ends);
+    a->ctx = NULL;
+    b->ctx = NULL;
+}
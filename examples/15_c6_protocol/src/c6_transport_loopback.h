@@ -0,0 +1,44 @@
+/**
+ * @file c6_transport_loopback.h
+ * @brief In-memory c6_transport_t pair on FreeRTOS stream buffers
+ *
+ * Connects two links inside the P4, one per task, to measure the protocol
+ * overhead without the SDIO bus. Each direction is one stream buffer, so
+ * each end must be used from a single task.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "c6_link.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a connected pair of transports
+ *
+ * @param buf_size: Bytes buffered per direction
+ * @param max_fragment: Largest frame payload, 0: C6_PROTO_MAX_FRAGMENT
+ * @param a: First end
+ * @param b: Second end
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t c6_transport_loopback_create(size_t buf_size, size_t max_fragment,
+                                       c6_transport_t *a, c6_transport_t *b);
+
+/**
+ * @brief Free a pair created by c6_transport_loopback_create()
+ *
+ * Both links must be destroyed first.
+ */
+void c6_transport_loopback_delete(c6_transport_t *a, c6_transport_t *b);
+
+#ifdef __cplusplus
+}
+#endif
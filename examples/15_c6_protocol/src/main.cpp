@@ -0,0 +1,652 @@
+/**
+ * @file main.cpp
+ * @brief Example 15: P4 <-> C6 Command Protocol for JC4880P443C (ESP32-P4)
+ *
+ * This example demonstrates:
+ * - The framed command protocol used between the P4 and the C6 co-processor:
+ *   sequence ids, several requests in flight, responses matched out of
+ *   order, fragmentation of messages above 64 KB
+ * - A pluggable transport, here a stream buffer loopback between two tasks
+ *   (P4 client <-> simulated C6 server)
+ * - Throughput and latency for several payload sizes and window sizes
+ * - HTTP_GET offload: the "C6" fetches a JSON document and returns only the
+ *   requested fields as a compact binary record, compared with the bytes
+ *   ESP-HOSTED moves when the P4 fetches the document itself
+ *
+ * Board: Guition JC4880P443C_I_W (JC-ESP32P4-M3-C6 module)
+ * WiFi: Via ESP32-C6 co-processor using ESP-HOSTED
+ *
+ * NOTE: The C6 runs ESP-HOSTED firmware, which does not speak this protocol.
+ * The simulated C6 runs on the P4 and fetches through ESP-HOSTED; a
+ * transport on the SDIO link plugs into the same c6_transport_t.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+#include "esp_wifi.h"
+
+// ESP-HOSTED for WiFi via C6 co-processor
+#include "esp_hosted.h"
+
+// BSP includes
+#include "bsp/esp-bsp.h"
+#include "bsp/display.h"
+
+// LVGL
+#include "lvgl.h"
+
+#include "c6_link.h"
+#include "c6_bench.h"
+#include "c6_offload.h"
+#include "c6_fetch_http.h"
+#include "c6_transport_loopback.h"
+
+static const char *TAG = "c6_protocol";
+
+// ============================================================================
+// Configuration - CHANGE THESE!
+// ============================================================================
+#define WIFI_SSID      "YOUR_WIFI_SSID"
+#define WIFI_PASSWORD  "YOUR_WIFI_PASSWORD"
+
+// Document fetched by the Offload button, and the fields the P4 wants
+#define OFFLOAD_URL    "http://api.open-meteo.com/v1/forecast?latitude=52.52&longitude=13.41" \
+                       "&current_weather=true&hourly=temperature_2m,relativehumidity_2m"
+static const char *offload_pointers[] = {
+    "/current_weather/time",
+    "/current_weather/temperature",
+    "/current_weather/windspeed",
+    "/current_weather/weathercode",
+    "/hourly/relativehumidity_2m/0",
+};
+
+#define LOOPBACK_BUF_SIZE   (64 * 1024)     // Per direction
+#define LOOPBACK_FRAGMENT   0               // 0: 65535-byte frames
+#define OFFLOAD_MAX_BODY    (128 * 1024)    // Whole-body comparison request
+
+// Payload sizes and windows of the benchmark
+static const size_t bench_sizes[] = {16, 256, 4096, 65536, 131072};
+static const size_t bench_windows[] = {1, 8};
+#define BENCH_BYTES_PER_RUN (4 * 1024 * 1024)
+#define BENCH_MAX_COUNT     2000
+
+// ============================================================================
+
+// Event group for WiFi events
+static EventGroupHandle_t wifi_event_group;
+#define WIFI_CONNECTED_BIT BIT0
+#define WIFI_FAIL_BIT      BIT1
+
+// WiFi retry counter
+static int wifi_retry_count = 0;
+#define WIFI_MAX_RETRY 5
+
+// LVGL UI elements
+static lv_obj_t *status_label = NULL;
+static lv_obj_t *ip_label = NULL;
+static lv_obj_t *results_label = NULL;
+static lv_obj_t *run_btn = NULL;
+static lv_obj_t *offload_btn = NULL;
+
+static char results_text[1024];
+static bool wifi_connected = false;
+
+// Both ends of the loopback. The client link is only used by one task at
+// a time: the buttons are disabled while a run is in progress.
+static c6_link_t *client_link = NULL;
+static c6_link_t *server_link = NULL;
+static c6_offload_server_t *offload_server = NULL;
+
+/**
+ * @brief WiFi event handler
+ */
+static void wifi_event_handler(void *arg, esp_event_base_t event_base,
+                               int32_t event_id, void *event_data) {
+    if (event_base == WIFI_EVENT) {
+        switch (event_id) {
+            case WIFI_EVENT_STA_START:
+                ESP_LOGI(TAG, "WiFi STA started, connecting...");
+                esp_wifi_connect();
+                break;
+
+            case WIFI_EVENT_STA_DISCONNECTED:
+                if (wifi_retry_count < WIFI_MAX_RETRY) {
+                    ESP_LOGI(TAG, "WiFi disconnected, retrying (%d/%d)...",
+                             wifi_retry_count + 1, WIFI_MAX_RETRY);
+                    esp_wifi_connect();
+                    wifi_retry_count++;
+                } else {
+                    ESP_LOGE(TAG, "WiFi connection failed after %d retries", WIFI_MAX_RETRY);
+                    xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);
+                }
+                break;
+
+            default:
+                break;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        wifi_retry_count = 0;
+        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+        // Update IP label
+        if (ip_label) {
+            bsp_display_lock(0);
+            lv_label_set_text_fmt(ip_label, "IP: " IPSTR, IP2STR(&event->ip_info.ip));
+            bsp_display_unlock();
+        }
+    }
+}
+
+/**
+ * @brief Initialize WiFi in station mode and connect
+ */
+static esp_err_t wifi_init_and_connect(void) {
+    ESP_LOGI(TAG, "Initializing WiFi...");
+
+    wifi_event_group = xEventGroupCreate();
+
+    // Initialize TCP/IP stack
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    // Create default WiFi station
+    esp_netif_create_default_wifi_sta();
+
+    // Initialize WiFi with default config
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    // Register event handlers
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+
+    // Configure WiFi
+    wifi_config_t wifi_config = {};
+    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid) - 1);
+    strncpy((char *)wifi_config.sta.password, WIFI_PASSWORD, sizeof(wifi_config.sta.password) - 1);
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    ESP_LOGI(TAG, "WiFi init complete, waiting for connection...");
+
+    // Wait for connection or failure
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group,
+                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(30000));
+
+    if (bits & WIFI_CONNECTED_BIT) {
+        ESP_LOGI(TAG, "Connected to WiFi SSID: %s", WIFI_SSID);
+        return ESP_OK;
+    } else if (bits & WIFI_FAIL_BIT) {
+        ESP_LOGE(TAG, "Failed to connect to SSID: %s", WIFI_SSID);
+        return ESP_FAIL;
+    } else {
+        ESP_LOGE(TAG, "WiFi connection timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+}
+
+// ============================================================================
+// Links
+// ============================================================================
+
+/**
+ * @brief Simulated C6: answers HTTP_GET, ECHO and NOP
+ */
+static void server_task(void *arg) {
+    while (c6_link_poll(server_link, 1000) == ESP_OK) {
+    }
+    ESP_LOGE(TAG, "Server link failed");
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Connect a client and a simulated C6 server over the loopback
+ */
+static esp_err_t links_init(void) {
+    c6_transport_t client_tr, server_tr;
+    esp_err_t err = c6_transport_loopback_create(LOOPBACK_BUF_SIZE, LOOPBACK_FRAGMENT,
+                                                 &client_tr, &server_tr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    c6_offload_config_t offload_cfg = {};
+    offload_cfg.fetch = c6_fetch_http;
+    offload_cfg.max_body = OFFLOAD_MAX_BODY;
+    offload_cfg.next = c6_bench_echo_handler;
+    err = c6_offload_server_create(&offload_cfg, &offload_server);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    c6_link_config_t cfg = C6_LINK_CONFIG_DEFAULT();
+    cfg.transport = server_tr;
+    cfg.on_request = c6_offload_handle_request;
+    cfg.request_ctx = offload_server;
+    err = c6_link_create(&cfg, &server_link);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // At most half a stream buffer of requests outstanding, so neither task
+    // can block in send() while the other one does too. The timeout covers
+    // a slow HTTP fetch on the server side.
+    cfg = C6_LINK_CONFIG_DEFAULT();
+    cfg.transport = client_tr;
+    cfg.max_inflight_bytes = LOOPBACK_BUF_SIZE / 2;
+    cfg.timeout_ms = 15000;
+    err = c6_link_create(&cfg, &client_link);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    xTaskCreate(server_task, "c6_server", 6144, NULL, 5, NULL);
+    return ESP_OK;
+}
+
+static void set_status(const char *text) {
+    bsp_display_lock(0);
+    lv_label_set_text(status_label, text);
+    bsp_display_unlock();
+}
+
+static void set_buttons_enabled(bool enabled) {
+    bsp_display_lock(0);
+    if (enabled) {
+        lv_obj_clear_state(run_btn, LV_STATE_DISABLED);
+        if (wifi_connected) {
+            lv_obj_clear_state(offload_btn, LV_STATE_DISABLED);
+        }
+    } else {
+        lv_obj_add_state(run_btn, LV_STATE_DISABLED);
+        lv_obj_add_state(offload_btn, LV_STATE_DISABLED);
+    }
+    bsp_display_unlock();
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+/**
+ * @brief Run every size and window, showing the results as they come in
+ */
+static esp_err_t run_benchmarks(c6_link_t *client) {
+    esp_err_t err = ESP_OK;
+
+    snprintf(results_text, sizeof(results_text), "%7s %3s %8s %7s %6s %6s %6s\n",
+             "bytes", "win", "msg/s", "MB/s", "avg", "p99", "max");
+
+    for (size_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+        for (size_t j = 0; j < sizeof(bench_windows) / sizeof(bench_windows[0]); j++) {
+            c6_bench_params_t params;
+            params.size = bench_sizes[i];
+            params.window = bench_windows[j];
+            params.count = BENCH_BYTES_PER_RUN / (params.size + 64);
+            if (params.count > BENCH_MAX_COUNT) {
+                params.count = BENCH_MAX_COUNT;
+            }
+
+            c6_bench_result_t r;
+            err = c6_bench_run(client, &params, &r);
+            ESP_LOGI(TAG, "%u bytes x%u: %.0f msg/s, %.2f MB/s, latency avg %lu p50 %lu "
+                     "p99 %lu max %lu us, %lu errors",
+                     (unsigned)params.size, (unsigned)params.window, r.msgs_per_s,
+                     r.mbytes_per_s, (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p50_us,
+                     (unsigned long)r.lat_p99_us, (unsigned long)r.lat_max_us,
+                     (unsigned long)r.errors);
+
+            size_t used = strlen(results_text);
+            snprintf(results_text + used, sizeof(results_text) - used,
+                     "%7u %3u %8.0f %7.2f %6lu %6lu %6lu%s\n",
+                     (unsigned)params.size, (unsigned)params.window, r.msgs_per_s,
+                     r.mbytes_per_s, (unsigned long)r.lat_avg_us, (unsigned long)r.lat_p99_us,
+                     (unsigned long)r.lat_max_us, r.errors ? " ERR" : "");
+            bsp_display_lock(0);
+            lv_label_set_text(results_label, results_text);
+            bsp_display_unlock();
+
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Link failed: %s", esp_err_to_name(err));
+                return err;
+            }
+        }
+    }
+
+    c6_link_counters_t c;
+    c6_link_get_counters(client, &c);
+    ESP_LOGI(TAG, "Client: %lu frames sent, %lu received (%lu reassembled from reads), "
+             "%lu timeouts",
+             (unsigned long)c.frames_sent, (unsigned long)c.frames_received,
+             (unsigned long)c.frames_copied, (unsigned long)c.timeouts);
+    return ESP_OK;
+}
+
+static void bench_task(void *arg) {
+    set_status("Benchmark running...");
+    esp_err_t err = run_benchmarks(client_link);
+    set_status(err == ESP_OK ? "Benchmark done (latency in us)" : "Link failed");
+    set_buttons_enabled(true);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// Offload
+// ============================================================================
+
+/**
+ * @brief Send one HTTP_GET and return the link bytes it took
+ */
+static esp_err_t offload_get(const char *const *pointers, size_t count, uint8_t *resp,
+                             size_t resp_size, size_t *resp_len, uint32_t *link_bytes) {
+    uint8_t req[512];
+    size_t req_len;
+    esp_err_t err = c6_offload_encode_request(OFFLOAD_URL, pointers, count, req, sizeof(req),
+                                              &req_len);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    c6_link_counters_t before, after;
+    c6_link_get_counters(client_link, &before);
+    uint8_t status;
+    err = c6_link_call(client_link, C6_CMD_HTTP_GET, req, req_len, &status, resp, resp_size,
+                       resp_len);
+    c6_link_get_counters(client_link, &after);
+    *link_bytes = (uint32_t)((after.bytes_sent - before.bytes_sent) +
+                             (after.bytes_received - before.bytes_received));
+
+    if (err == ESP_OK && status != C6_STATUS_OK) {
+        ESP_LOGW(TAG, "HTTP_GET status %u", status);
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+static void offload_task(void *arg) {
+    const size_t n_pointers = sizeof(offload_pointers) / sizeof(offload_pointers[0]);
+    size_t resp_size = OFFLOAD_MAX_BODY + 2;
+    uint8_t *resp = (uint8_t *)malloc(resp_size);
+    size_t resp_len = 0;
+    uint32_t record_bytes = 0;
+    uint32_t body_bytes = 0;
+    c6_offload_stats_t st0, st1;
+
+    set_status("Offload: fetching...");
+    c6_offload_get_stats(offload_server, &st0);
+
+    // Fields only, then the whole body for comparison
+    esp_err_t err = resp ? ESP_OK : ESP_ERR_NO_MEM;
+    if (err == ESP_OK) {
+        err = offload_get(offload_pointers, n_pointers, resp, resp_size, &resp_len,
+                          &record_bytes);
+    }
+
+    uint16_t http_status = 0;
+    c6_value_t values[C6_OFFLOAD_MAX_FIELDS];
+    size_t n_values = 0;
+    if (err == ESP_OK) {
+        err = c6_offload_decode_record(resp, resp_len, &http_status, NULL, values,
+                                       C6_OFFLOAD_MAX_FIELDS, &n_values);
+    }
+
+    int len = 0;
+    if (err == ESP_OK) {
+        len = snprintf(results_text, sizeof(results_text), "HTTP %u, %u-byte record\n",
+                       http_status, (unsigned)resp_len);
+        for (size_t i = 0; i < n_values && len < (int)sizeof(results_text); i++) {
+            const c6_value_t *v = &values[i];
+            char *out = results_text + len;
+            size_t room = sizeof(results_text) - len;
+            switch (v->type) {
+                case C6_VALUE_INT:
+                    len += snprintf(out, room, "%s = %lld\n", offload_pointers[i], (long long)v->i);
+                    break;
+                case C6_VALUE_F32:
+                case C6_VALUE_F64:
+                    len += snprintf(out, room, "%s = %g\n", offload_pointers[i], v->f);
+                    break;
+                case C6_VALUE_STRING:
+                    len += snprintf(out, room, "%s = %.*s\n", offload_pointers[i], (int)v->len,
+                                    v->str);
+                    break;
+                case C6_VALUE_TRUE:
+                case C6_VALUE_FALSE:
+                    len += snprintf(out, room, "%s = %s\n", offload_pointers[i],
+                                    v->type == C6_VALUE_TRUE ? "true" : "false");
+                    break;
+                default:
+                    len += snprintf(out, room, "%s: missing\n", offload_pointers[i]);
+                    break;
+            }
+        }
+        err = offload_get(NULL, 0, resp, resp_size, &resp_len, &body_bytes);
+    }
+
+    c6_offload_get_stats(offload_server, &st1);
+    if (err == ESP_OK && len < (int)sizeof(results_text)) {
+        // Both requests fetched the same document
+        uint32_t hosted = (uint32_t)((st1.hosted_bytes - st0.hosted_bytes) / 2);
+        snprintf(results_text + len, sizeof(results_text) - len,
+                 "\nBytes per request on SDIO:\n"
+                 "  Record over the link:      %6lu\n"
+                 "  Whole body over the link:  %6lu\n"
+                 "  ESP-HOSTED fetch (est.):   %6lu\n"
+                 "  -> %.1fx fewer bytes with the record\n",
+                 (unsigned long)record_bytes, (unsigned long)body_bytes, (unsigned long)hosted,
+                 record_bytes ? (double)hosted / record_bytes : 0.0);
+        ESP_LOGI(TAG, "Offload: record %lu B, whole body %lu B, ESP-HOSTED est. %lu B",
+                 (unsigned long)record_bytes, (unsigned long)body_bytes, (unsigned long)hosted);
+    }
+
+    bsp_display_lock(0);
+    lv_label_set_text(results_label, err == ESP_OK ? results_text : "");
+    lv_label_set_text_fmt(status_label, "Offload: %s",
+                          err == ESP_OK ? "done" : esp_err_to_name(err));
+    bsp_display_unlock();
+
+    free(resp);
+    set_buttons_enabled(true);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// UI
+// ============================================================================
+
+/**
+ * @brief Run button click callback
+ */
+static void run_btn_click_cb(lv_event_t *e) {
+    // Runs in the LVGL task, which already holds the display lock
+    lv_obj_add_state(run_btn, LV_STATE_DISABLED);
+    lv_obj_add_state(offload_btn, LV_STATE_DISABLED);
+    xTaskCreate(bench_task, "c6_bench", 6144, NULL, 4, NULL);
+}
+
+/**
+ * @brief Offload button click callback
+ */
+static void offload_btn_click_cb(lv_event_t *e) {
+    lv_obj_add_state(run_btn, LV_STATE_DISABLED);
+    lv_obj_add_state(offload_btn, LV_STATE_DISABLED);
+    xTaskCreate(offload_task, "c6_offload", 6144, NULL, 4, NULL);
+}
+
+/**
+ * @brief Create the UI
+ */
+static void create_ui(void) {
+    lv_obj_t *scr = lv_scr_act();
+
+    // Set dark background
+    lv_obj_set_style_bg_color(scr, lv_color_hex(0x0f0f1a), LV_PART_MAIN);
+
+    // Title
+    lv_obj_t *title = lv_label_create(scr);
+    lv_label_set_text(title, "P4 <-> C6 Protocol");
+    lv_obj_set_style_text_color(title, lv_color_white(), 0);
+    lv_obj_set_style_text_font(title, &lv_font_montserrat_18, 0);
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 15);
+
+    // Transport label
+    lv_obj_t *info_label = lv_label_create(scr);
+    lv_label_set_text_fmt(info_label, "Loopback transport, %d KB per direction",
+                          LOOPBACK_BUF_SIZE / 1024);
+    lv_obj_set_style_text_color(info_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(info_label, LV_ALIGN_TOP_LEFT, 10, 50);
+
+    // IP label
+    ip_label = lv_label_create(scr);
+    lv_label_set_text(ip_label, "IP: Connecting...");
+    lv_obj_set_style_text_color(ip_label, lv_color_hex(0x88CCFF), 0);
+    lv_obj_align(ip_label, LV_ALIGN_TOP_LEFT, 10, 75);
+
+    // Status label
+    status_label = lv_label_create(scr);
+    lv_label_set_text(status_label, "Press Run to start");
+    lv_obj_set_style_text_color(status_label, lv_color_hex(0x888888), 0);
+    lv_obj_align(status_label, LV_ALIGN_TOP_LEFT, 10, 100);
+
+    // Run button
+    run_btn = lv_btn_create(scr);
+    lv_obj_set_size(run_btn, 200, 50);
+    lv_obj_align(run_btn, LV_ALIGN_TOP_LEFT, 20, 135);
+    lv_obj_add_event_cb(run_btn, run_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_state(run_btn, LV_STATE_DISABLED);
+
+    lv_obj_t *btn_label = lv_label_create(run_btn);
+    lv_label_set_text(btn_label, "Run");
+    lv_obj_center(btn_label);
+
+    // Offload button (enabled once WiFi is up)
+    offload_btn = lv_btn_create(scr);
+    lv_obj_set_size(offload_btn, 200, 50);
+    lv_obj_align(offload_btn, LV_ALIGN_TOP_RIGHT, -20, 135);
+    lv_obj_add_event_cb(offload_btn, offload_btn_click_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_state(offload_btn, LV_STATE_DISABLED);
+
+    btn_label = lv_label_create(offload_btn);
+    lv_label_set_text(btn_label, "Offload GET");
+    lv_obj_center(btn_label);
+
+    // Results
+    lv_obj_t *results_container = lv_obj_create(scr);
+    lv_obj_set_size(results_container, LV_PCT(95), 560);
+    lv_obj_align(results_container, LV_ALIGN_BOTTOM_MID, 0, -20);
+    lv_obj_set_style_bg_color(results_container, lv_color_hex(0x16213e), 0);
+    lv_obj_set_style_border_width(results_container, 0, 0);
+    lv_obj_set_style_pad_all(results_container, 10, 0);
+
+    results_label = lv_label_create(results_container);
+    lv_label_set_text(results_label, "");
+    lv_obj_set_style_text_color(results_label, lv_color_hex(0x88FF88), 0);
+    lv_obj_set_style_text_font(results_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_width(results_label, LV_PCT(95));
+    lv_label_set_long_mode(results_label, LV_LABEL_LONG_WRAP);
+    lv_obj_align(results_label, LV_ALIGN_TOP_LEFT, 0, 0);
+}
+
+extern "C" void app_main(void) {
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  JC4880P443C P4 <-> C6 Protocol Example");
+    ESP_LOGI(TAG, "  ESP32-P4 + ESP-HOSTED + LVGL 9");
+    ESP_LOGI(TAG, "========================================");
+
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    ESP_LOGI(TAG, "NVS initialized");
+
+    // Initialize display using BSP
+    ESP_LOGI(TAG, "Initializing display...");
+
+    bsp_display_cfg_t disp_cfg = {
+        .lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG(),
+        .buffer_size = BSP_LCD_H_RES * 50,
+        .double_buffer = false,
+        .flags = {
+            .buff_dma = false,
+            .buff_spiram = true,
+            .sw_rotate = true,
+        }
+    };
+
+    lv_display_t *disp = bsp_display_start_with_config(&disp_cfg);
+    if (disp == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize display!");
+        return;
+    }
+    ESP_LOGI(TAG, "Display initialized");
+
+    // Turn on backlight
+    bsp_display_backlight_on();
+    bsp_display_brightness_set(100);
+
+    // Create UI
+    bsp_display_lock(0);
+    create_ui();
+    bsp_display_unlock();
+    ESP_LOGI(TAG, "UI created");
+
+    ret = links_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Link setup failed: %s", esp_err_to_name(ret));
+        set_status("Link setup failed (out of memory?)");
+        return;
+    }
+    set_buttons_enabled(true);
+
+    // The benchmark needs no network; the offload fetches through ESP-HOSTED
+    ESP_LOGI(TAG, "Initializing ESP-HOSTED...");
+    ret = esp_hosted_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ESP-HOSTED init failed: %s", esp_err_to_name(ret));
+        bsp_display_lock(0);
+        lv_label_set_text(ip_label, "IP: ESP-HOSTED init failed");
+        bsp_display_unlock();
+        return;
+    }
+
+    // Wait for transport to stabilize
+    vTaskDelay(pdMS_TO_TICKS(500));
+
+    ret = wifi_init_and_connect();
+    if (ret != ESP_OK) {
+        bsp_display_lock(0);
+        lv_label_set_text(ip_label, "IP: Connection failed");
+        bsp_display_unlock();
+        return;
+    }
+    wifi_connected = true;
+
+    // Enable the offload button unless a benchmark is running
+    bsp_display_lock(0);
+    if (!lv_obj_has_state(run_btn, LV_STATE_DISABLED)) {
+        lv_obj_clear_state(offload_btn, LV_STATE_DISABLED);
+    }
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  Ready: Run (benchmark) or Offload GET");
+    ESP_LOGI(TAG, "========================================");
+}